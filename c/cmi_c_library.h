@@ -54,4 +54,15 @@ void cmi_compute_neutral_fraction_sp(const float *x, const float *y,
                                      const float *z, const float *h,
                                      const float *m, float *nH, const size_t N);
 
+void cmi_register_particles_dp(const double *x, const double *y,
+                               const double *z, const double *h,
+                               const double *m, double *nH, const size_t N);
+void cmi_register_particles_mp(const double *x, const double *y,
+                               const double *z, const float *h, const float *m,
+                               float *nH, const size_t N);
+void cmi_register_particles_sp(const float *x, const float *y, const float *z,
+                               const float *h, const float *m, float *nH,
+                               const size_t N);
+void cmi_update_neutral_fraction();
+
 #endif // CMI_C_LIBRARY_H
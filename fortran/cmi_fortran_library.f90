@@ -228,6 +228,120 @@ module cmi_fortran_library
 
   end interface c_subroutines
 
+  !-
+  !> @brief Subroutines declared in the CMI library for the persistent coupling
+  !> mode.
+  !>
+  !> These are not part of the generic c_subroutines interface, since their
+  !> arguments cannot be distinguished from those of the other subroutines.
+  !-
+  interface
+
+    !-
+    !> @brief Fortran interface for
+    !> CMILibrary::cmi_register_particles_dp().
+    !>
+    !> The library stores pointers to the arrays, so they need to have the
+    !> target (and save, or allocatable in a module) attribute in the calling
+    !> code and should not be moved or deallocated while they are registered.
+    !>
+    !> @param x X coordinates (in internal length units).
+    !> @param y Y coordinates (in internal length units).
+    !> @param z Z coordinates (in internal length units).
+    !> @param h Smoothing lengths (in internal length units).
+    !> @param m Masses (in internal mass units).
+    !> @param nH Neutral fraction array to compute.
+    !> @param N Size of all arrays.
+    !-
+    subroutine cmi_register_particles_dp(x, y, z, h, m, nH, N) &
+      bind(C, name = "cmi_register_particles_dp")
+
+      use iso_c_binding
+      implicit none
+
+      real (kind = c_double), intent(in), target :: x(N)
+      real (kind = c_double), intent(in), target :: y(N)
+      real (kind = c_double), intent(in), target :: z(N)
+      real (kind = c_double), intent(in), target :: h(N)
+      real (kind = c_double), intent(in), target :: m(N)
+      real (kind = c_double), intent(inout), target :: nH(N)
+      integer (kind = c_size_t), intent(in), value :: N
+
+    end subroutine cmi_register_particles_dp
+
+    !-
+    !> @brief Fortran interface for
+    !> CMILibrary::cmi_register_particles_mp().
+    !>
+    !> The library stores pointers to the arrays, so they need to have the
+    !> target (and save, or allocatable in a module) attribute in the calling
+    !> code and should not be moved or deallocated while they are registered.
+    !>
+    !> @param x X coordinates (in internal length units).
+    !> @param y Y coordinates (in internal length units).
+    !> @param z Z coordinates (in internal length units).
+    !> @param h Smoothing lengths (in internal length units).
+    !> @param m Masses (in internal mass units).
+    !> @param nH Neutral fraction array to compute.
+    !> @param N Size of all arrays.
+    !-
+    subroutine cmi_register_particles_mp(x, y, z, h, m, nH, N) &
+      bind(C, name = "cmi_register_particles_mp")
+
+      use iso_c_binding
+      implicit none
+
+      real (kind = c_double), intent(in), target :: x(N)
+      real (kind = c_double), intent(in), target :: y(N)
+      real (kind = c_double), intent(in), target :: z(N)
+      real (kind = c_float), intent(in), target :: h(N)
+      real (kind = c_float), intent(in), target :: m(N)
+      real (kind = c_float), intent(inout), target :: nH(N)
+      integer (kind = c_size_t), intent(in), value :: N
+
+    end subroutine cmi_register_particles_mp
+
+    !-
+    !> @brief Fortran interface for
+    !> CMILibrary::cmi_register_particles_sp().
+    !>
+    !> The library stores pointers to the arrays, so they need to have the
+    !> target (and save, or allocatable in a module) attribute in the calling
+    !> code and should not be moved or deallocated while they are registered.
+    !>
+    !> @param x X coordinates (in internal length units).
+    !> @param y Y coordinates (in internal length units).
+    !> @param z Z coordinates (in internal length units).
+    !> @param h Smoothing lengths (in internal length units).
+    !> @param m Masses (in internal mass units).
+    !> @param nH Neutral fraction array to compute.
+    !> @param N Size of all arrays.
+    !-
+    subroutine cmi_register_particles_sp(x, y, z, h, m, nH, N) &
+      bind(C, name = "cmi_register_particles_sp")
+
+      use iso_c_binding
+      implicit none
+
+      real (kind = c_float), intent(in), target :: x(N)
+      real (kind = c_float), intent(in), target :: y(N)
+      real (kind = c_float), intent(in), target :: z(N)
+      real (kind = c_float), intent(in), target :: h(N)
+      real (kind = c_float), intent(in), target :: m(N)
+      real (kind = c_float), intent(inout), target :: nH(N)
+      integer (kind = c_size_t), intent(in), value :: N
+
+    end subroutine cmi_register_particles_sp
+
+    !-
+    !> @brief Fortran interface for CMILibrary::cmi_update_neutral_fraction().
+    !-
+    subroutine cmi_update_neutral_fraction() &
+      bind(C, name = "cmi_update_neutral_fraction")
+    end subroutine cmi_update_neutral_fraction
+
+  end interface
+
   contains
 
     !-
@@ -0,0 +1,197 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file AliasTable.hpp
+ *
+ * @brief Walker alias table for constant time sampling of a tabulated
+ * distribution.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#ifndef ALIASTABLE_HPP
+#define ALIASTABLE_HPP
+
+#include "Error.hpp"
+
+#include <cinttypes>
+#include <vector>
+
+/**
+ * @brief Walker alias table for constant time sampling of a tabulated
+ * distribution.
+ *
+ * The table is constructed from a cumulative distribution function tabulated
+ * on a number of nodes, using the algorithm of Vose (1991, IEEE Trans. Softw.
+ * Eng., 17, 972). Every bin of the table corresponds to an interval in between
+ * two nodes and stores an acceptance threshold and an alias bin.
+ *
+ * A single uniform random number is sufficient to sample a bin and a uniform
+ * relative position within that bin: the integer part of the scaled random
+ * number selects a table bin, while the fractional part decides between that
+ * bin and its alias and is then rescaled to a position within the selected bin.
+ * The result has exactly the same distribution as a binary search of the
+ * random number in the cumulative distribution function, but does not require
+ * a search.
+ */
+class AliasTable {
+private:
+  /**
+   * @brief Single bin of the alias table.
+   */
+  struct AliasTableBin {
+    /*! @brief Probability of selecting this bin rather than its alias. */
+    double _threshold;
+
+    /*! @brief Alias bin. */
+    uint_fast32_t _alias;
+  };
+
+  /*! @brief Bins of the table. */
+  std::vector< AliasTableBin > _bins;
+
+public:
+  /**
+   * @brief Empty constructor.
+   */
+  inline AliasTable() {}
+
+  /**
+   * @brief Constructor.
+   *
+   * @param cumulative_distribution Cumulative distribution function.
+   * @param number_of_nodes Number of nodes in the cumulative distribution
+   * function (the table will contain one bin less).
+   */
+  inline AliasTable(const double *cumulative_distribution,
+                    const uint_fast32_t number_of_nodes) {
+    initialize(cumulative_distribution, number_of_nodes);
+  }
+
+  /**
+   * @brief (Re)build the table for the given cumulative distribution function.
+   *
+   * @param cumulative_distribution Cumulative distribution function. Values
+   * should be monotonically increasing, but do not need to be normalised.
+   * @param number_of_nodes Number of nodes in the cumulative distribution
+   * function (the table will contain one bin less).
+   */
+  inline void initialize(const double *cumulative_distribution,
+                         const uint_fast32_t number_of_nodes) {
+
+    cmac_assert(number_of_nodes > 1);
+
+    const uint_fast32_t number_of_bins = number_of_nodes - 1;
+    const double total =
+        cumulative_distribution[number_of_bins] - cumulative_distribution[0];
+    if (!(total > 0.)) {
+      cmac_error("Cannot sample an empty distribution!");
+    }
+
+    _bins.resize(number_of_bins);
+    std::vector< uint_fast32_t > small, large;
+    small.reserve(number_of_bins);
+    large.reserve(number_of_bins);
+    const double norm = number_of_bins / total;
+    for (uint_fast32_t i = 0; i < number_of_bins; ++i) {
+      _bins[i]._threshold =
+          (cumulative_distribution[i + 1] - cumulative_distribution[i]) * norm;
+      _bins[i]._alias = i;
+      if (_bins[i]._threshold < 1.) {
+        small.push_back(i);
+      } else {
+        large.push_back(i);
+      }
+    }
+
+    // pair every bin with a probability below average with a bin with a
+    // probability above average that makes up for the difference
+    while (!small.empty() && !large.empty()) {
+      const uint_fast32_t ismall = small.back();
+      small.pop_back();
+      const uint_fast32_t ilarge = large.back();
+      _bins[ismall]._alias = ilarge;
+      _bins[ilarge]._threshold -= 1. - _bins[ismall]._threshold;
+      if (_bins[ilarge]._threshold < 1.) {
+        large.pop_back();
+        small.push_back(ilarge);
+      }
+    }
+
+    // the remaining bins have a threshold of 1 up to round off error
+    for (uint_fast32_t i = 0; i < small.size(); ++i) {
+      _bins[small[i]]._threshold = 1.;
+    }
+    for (uint_fast32_t i = 0; i < large.size(); ++i) {
+      _bins[large[i]]._threshold = 1.;
+    }
+  }
+
+  /**
+   * @brief Get the number of bins in the table.
+   *
+   * @return Number of bins.
+   */
+  inline uint_fast32_t get_number_of_bins() const { return _bins.size(); }
+
+  /**
+   * @brief Sample a bin from the table.
+   *
+   * @param uniform Uniform random number in the range [0, 1[.
+   * @param fraction Variable to store the uniformly distributed relative
+   * position within the sampled bin in (in the range [0, 1[).
+   * @return Index of the sampled bin, i.e. the sample lies in between nodes
+   * index and index+1 of the cumulative distribution function.
+   */
+  inline uint_fast32_t sample(const double uniform, double &fraction) const {
+
+    const uint_fast32_t number_of_bins = _bins.size();
+    const double u = uniform * number_of_bins;
+    uint_fast32_t index = u;
+    if (index >= number_of_bins) {
+      index = number_of_bins - 1;
+    }
+    const double f = u - index;
+    const AliasTableBin &bin = _bins[index];
+    if (f < bin._threshold) {
+      fraction = f / bin._threshold;
+      return index;
+    } else {
+      fraction = (f - bin._threshold) / (1. - bin._threshold);
+      return bin._alias;
+    }
+  }
+
+  /**
+   * @brief Sample a value from the table, assuming the sampled quantity
+   * varies linearly within each bin.
+   *
+   * @param uniform Uniform random number in the range [0, 1[.
+   * @param nodes Values of the sampled quantity at the nodes of the cumulative
+   * distribution function.
+   * @return Sampled value.
+   */
+  inline double sample_linear(const double uniform,
+                              const double *nodes) const {
+    double fraction;
+    const uint_fast32_t index = sample(uniform, fraction);
+    return nodes[index] + fraction * (nodes[index + 1] - nodes[index]);
+  }
+};
+
+#endif // ALIASTABLE_HPP
@@ -38,6 +38,23 @@
 
 /**
  * @brief Turbulence forcing using the method of Alvelius (1999).
+ *
+ * The force in a cell is the real part of a sum over all forcing modes
+ * \f[
+ *   \vec{F}(x, y, z) = \Re{} \sum_k \vec{A}_k
+ *     e^{2\pi{}i\left(k_x x + k_y y + k_z z\right)},
+ * \f]
+ * with \f$\vec{A}_k\f$ the complex amplitude of mode \f$k\f$. Evaluating this
+ * sum directly costs \f$O(N_{cells} N_{modes})\f$. If separable evaluation is
+ * enabled, we instead exploit the fact that the exponential factorises:
+ * for every \f$z\f$ coordinate, we first sum all modes with the same
+ * \f$(k_x, k_y)\f$ over \f$k_z\f$, then for every \f$(y, z)\f$ column we
+ * sum these partial sums over \f$k_y\f$, so that only the sum over the few
+ * different values of \f$k_x\f$ remains for every cell. Both evaluation modes
+ * only depend on the global cell indices and use a fixed summation order, so
+ * that the result does not depend on the number of threads or on the order in
+ * which subgrids are processed. The two modes differ at the level of round off
+ * error.
  */
 class AlveliusTurbulenceForcing {
 private:
@@ -91,6 +108,18 @@ private:
   /*! @brief Number of driving steps since the start of the simulation. */
   uint_fast32_t _number_of_driving_steps;
 
+  /*! @brief Use the separable evaluation of the forcing? */
+  bool _separable_evaluation;
+
+  /*! @brief Offsets of the groups of modes that have the same x and y wave
+   *  number in the mode list (the last element is the number of modes). */
+  std::vector< uint_fast32_t > _xy_groups;
+
+  /*! @brief Offsets of the groups of xy groups that have the same x wave
+   *  number in the xy group list (the last element is the number of xy
+   *  groups). */
+  std::vector< uint_fast32_t > _x_groups;
+
   /**
    * @brief Function gets the real and imaginary parts of the amplitudes
    * Aran and Bran of the unit vector e1 and e2, respectively, as in Eq. 11.
@@ -116,6 +145,189 @@ private:
     ImRand[1] = std::sin(theta2) * gb;
   }
 
+  /**
+   * @brief Check if the two given modes have the same precomputed waves in
+   * the given direction.
+   *
+   * @param ik1 Index of the first mode.
+   * @param ik2 Index of the second mode.
+   * @param sin_table Precomputed sine waves in the direction.
+   * @param cos_table Precomputed cosine waves in the direction.
+   * @return True if the waves are the same for all cells.
+   */
+  inline bool have_same_wave(const uint_fast32_t ik1, const uint_fast32_t ik2,
+                             const std::vector< double > &sin_table,
+                             const std::vector< double > &cos_table) const {
+
+    const uint_fast32_t nk = _kforce.size();
+    const uint_fast32_t ncell = sin_table.size() / nk;
+    for (uint_fast32_t i = 0; i < ncell; ++i) {
+      if (sin_table[i * nk + ik1] != sin_table[i * nk + ik2] ||
+          cos_table[i * nk + ik1] != cos_table[i * nk + ik2]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * @brief Group the modes for the separable evaluation.
+   *
+   * The modes are generated with the z wave number in the innermost loop and
+   * the x wave number in the outermost loop, so that modes with the same x and
+   * y wave number are contiguous. We detect the groups by comparing the
+   * precomputed waves (which are identical for identical wave numbers), so
+   * that this also works after a restart. Modes with different wave numbers
+   * that have the same waves on the grid can be safely grouped together.
+   */
+  inline void group_modes() {
+
+    const uint_fast32_t nk = _kforce.size();
+    _xy_groups.clear();
+    _x_groups.clear();
+    for (uint_fast32_t ik = 0; ik < nk; ++ik) {
+      const bool same_x =
+          ik > 0 && have_same_wave(ik - 1, ik, _sin_x, _cos_x);
+      const bool same_y =
+          ik > 0 && have_same_wave(ik - 1, ik, _sin_y, _cos_y);
+      if (!same_x) {
+        _x_groups.push_back(_xy_groups.size());
+      }
+      if (!same_x || !same_y) {
+        _xy_groups.push_back(ik);
+      }
+    }
+    _x_groups.push_back(_xy_groups.size());
+    _xy_groups.push_back(nk);
+  }
+
+  /**
+   * @brief Compute the turbulent force for all cells in the given subgrid by
+   * summing over all modes.
+   *
+   * @param offset Offset of the subgrid in the global cell grid.
+   * @param forces Output array to store the force in (in m s^-2).
+   */
+  inline void
+  compute_forces_direct(const CoordinateVector< int_fast32_t > offset,
+                        std::vector< CoordinateVector<> > &forces) const {
+
+    const uint_fast32_t nk = _kforce.size();
+
+    uint_fast32_t icell = 0;
+    for (int_fast32_t ix = 0; ix < _number_of_cells.x(); ++ix) {
+      const uint_fast32_t oix = (offset.x() + ix) * nk;
+      for (int_fast32_t iy = 0; iy < _number_of_cells.y(); ++iy) {
+        const uint_fast32_t oiy = (offset.y() + iy) * nk;
+        for (int_fast32_t iz = 0; iz < _number_of_cells.z(); ++iz) {
+          const uint_fast32_t oiz = (offset.z() + iz) * nk;
+          CoordinateVector<> force;
+          for (uint_fast32_t ik = 0; ik < nk; ++ik) {
+            const CoordinateVector<> fr = _amplitudes_real[ik];
+            const CoordinateVector<> fi = _amplitudes_imaginary[ik];
+
+            const double cosx = _cos_x[oix + ik];
+            const double cosy = _cos_y[oiy + ik];
+            const double cosz = _cos_z[oiz + ik];
+            const double sinx = _sin_x[oix + ik];
+            const double siny = _sin_y[oiy + ik];
+            const double sinz = _sin_z[oiz + ik];
+
+            const double cosyz = cosy * cosz - siny * sinz;
+            const double sinyz = siny * cosz + cosy * sinz;
+
+            const double cosxyz = cosx * cosyz - sinx * sinyz;
+            const double sinxyz = sinx * cosyz + cosx * sinyz;
+
+            force += fr * cosxyz - fi * sinxyz;
+          }
+          forces[icell] = force;
+          ++icell;
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Compute the turbulent force for all cells in the given subgrid
+   * using partial sums over the z and y wave numbers.
+   *
+   * @param offset Offset of the subgrid in the global cell grid.
+   * @param forces Output array to store the force in (in m s^-2).
+   */
+  inline void
+  compute_forces_separable(const CoordinateVector< int_fast32_t > offset,
+                           std::vector< CoordinateVector<> > &forces) const {
+
+    const uint_fast32_t nk = _kforce.size();
+    const uint_fast32_t nxy = _xy_groups.size() - 1;
+    const uint_fast32_t nx = _x_groups.size() - 1;
+    const int_fast32_t ncy = _number_of_cells.y();
+    const int_fast32_t ncz = _number_of_cells.z();
+
+    // sum over k_z for every z coordinate and every xy group
+    std::vector< CoordinateVector<> > sum_z_real(ncz * nxy);
+    std::vector< CoordinateVector<> > sum_z_imaginary(ncz * nxy);
+    for (int_fast32_t iz = 0; iz < ncz; ++iz) {
+      const uint_fast32_t oiz = (offset.z() + iz) * nk;
+      for (uint_fast32_t ixy = 0; ixy < nxy; ++ixy) {
+        CoordinateVector<> sum_real, sum_imaginary;
+        for (uint_fast32_t ik = _xy_groups[ixy]; ik < _xy_groups[ixy + 1];
+             ++ik) {
+          const CoordinateVector<> fr = _amplitudes_real[ik];
+          const CoordinateVector<> fi = _amplitudes_imaginary[ik];
+          const double cosz = _cos_z[oiz + ik];
+          const double sinz = _sin_z[oiz + ik];
+          sum_real += fr * cosz - fi * sinz;
+          sum_imaginary += fr * sinz + fi * cosz;
+        }
+        sum_z_real[iz * nxy + ixy] = sum_real;
+        sum_z_imaginary[iz * nxy + ixy] = sum_imaginary;
+      }
+    }
+
+    // sum over k_y for every (y, z) column and every x group
+    std::vector< CoordinateVector<> > sum_yz_real(ncy * ncz * nx);
+    std::vector< CoordinateVector<> > sum_yz_imaginary(ncy * ncz * nx);
+    for (int_fast32_t iy = 0; iy < ncy; ++iy) {
+      const uint_fast32_t oiy = (offset.y() + iy) * nk;
+      for (int_fast32_t iz = 0; iz < ncz; ++iz) {
+        for (uint_fast32_t ix = 0; ix < nx; ++ix) {
+          CoordinateVector<> sum_real, sum_imaginary;
+          for (uint_fast32_t ixy = _x_groups[ix]; ixy < _x_groups[ix + 1];
+               ++ixy) {
+            const CoordinateVector<> &fr = sum_z_real[iz * nxy + ixy];
+            const CoordinateVector<> &fi = sum_z_imaginary[iz * nxy + ixy];
+            const double cosy = _cos_y[oiy + _xy_groups[ixy]];
+            const double siny = _sin_y[oiy + _xy_groups[ixy]];
+            sum_real += fr * cosy - fi * siny;
+            sum_imaginary += fr * siny + fi * cosy;
+          }
+          sum_yz_real[(iy * ncz + iz) * nx + ix] = sum_real;
+          sum_yz_imaginary[(iy * ncz + iz) * nx + ix] = sum_imaginary;
+        }
+      }
+    }
+
+    // sum over k_x for every cell
+    uint_fast32_t icell = 0;
+    for (int_fast32_t ix = 0; ix < _number_of_cells.x(); ++ix) {
+      const uint_fast32_t oix = (offset.x() + ix) * nk;
+      for (int_fast32_t iyz = 0; iyz < ncy * ncz; ++iyz) {
+        CoordinateVector<> force;
+        for (uint_fast32_t jx = 0; jx < nx; ++jx) {
+          const uint_fast32_t ik = _xy_groups[_x_groups[jx]];
+          const double cosx = _cos_x[oix + ik];
+          const double sinx = _sin_x[oix + ik];
+          force += sum_yz_real[iyz * nx + jx] * cosx -
+                   sum_yz_imaginary[iyz * nx + jx] * sinx;
+        }
+        forces[icell] = force;
+        ++icell;
+      }
+    }
+  }
+
 public:
   /**
    * @brief Constructor.
@@ -132,6 +344,7 @@ public:
    * @param seed Seed for the random generator.
    * @param dtfor Forcing time step (in s).
    * @param starting_time Starting time of the simulation (in s).
+   * @param separable_evaluation Use the separable evaluation of the forcing?
    * @param log Log to write logging info to.
    */
   AlveliusTurbulenceForcing(
@@ -140,10 +353,11 @@ public:
       const double kmin, const double kmax, const double kforcing,
       const double concentration_factor, const double power_forcing,
       const int_fast32_t seed, const double dtfor, const double starting_time,
-      Log *log = nullptr)
+      const bool separable_evaluation = false, Log *log = nullptr)
       : _number_of_subgrids(number_of_subgrids),
         _number_of_cells(number_of_cells), _random_generator(seed),
-        _time_step(dtfor), _number_of_driving_steps(0) {
+        _time_step(dtfor), _number_of_driving_steps(0),
+        _separable_evaluation(separable_evaluation) {
 
     /* The force spectrum here prescribed is  Gaussian in shape:
      * F(k) = amplitude*exp^((k-kforcing)^2/concentration_factor)
@@ -268,6 +482,7 @@ public:
         _cos_z[index] = std::cos(angle);
       }
     }
+    group_modes();
 
     // evolve the simulation forward in time until the starting time
     while (_number_of_driving_steps * _time_step < starting_time) {
@@ -283,6 +498,11 @@ public:
 
     if (log) {
       log->write_status("Number of turbulent modes: ", number_of_modes);
+      if (_separable_evaluation) {
+        log->write_status("Using separable evaluation with ",
+                          _xy_groups.size() - 1, " (k_x, k_y) groups and ",
+                          _x_groups.size() - 1, " k_x groups.");
+      }
       log->write_status("Modes:");
       for (uint_fast32_t i = 0; i < number_of_modes; ++i) {
         const CoordinateVector<> k = ktable[i] * box.get_sides().x();
@@ -312,6 +532,10 @@ public:
    *  - starting time: Starting time of the simulation. The random number
    *    generator will be forwarded to this time to guarantee a consistent
    *    random sequence between runs (default: 0. s)
+   *  - separable evaluation: Evaluate the forcing using partial sums over the
+   *    z and y wave numbers rather than a direct sum over all modes for every
+   *    cell. This is much faster for large numbers of modes, but gives results
+   *    that differ at the level of round off (default: false)
    *
    * @param number_of_subgrids Number of subgrids in each coordinate direction.
    * @param number_of_cells Number of cells per coordinate direction for a
@@ -342,12 +566,21 @@ public:
                 "TurbulenceForcing:time step", "1.519e6 s"),
             params.get_physical_value< QUANTITY_TIME >(
                 "TurbulenceForcing:starting time", "0. s"),
+            params.get_value< bool >("TurbulenceForcing:separable evaluation",
+                                     false),
             log) {
 
     cmac_assert(box.get_sides().x() == box.get_sides().y());
     cmac_assert(box.get_sides().x() == box.get_sides().z());
   }
 
+  /**
+   * @brief Get the number of forcing modes.
+   *
+   * @return Number of forcing modes.
+   */
+  inline size_t get_number_of_modes() const { return _kforce.size(); }
+
   /**
    * @brief Update the turbulent amplitudes for the next time step.
    *
@@ -399,52 +632,34 @@ public:
         index - offset_x * _number_of_subgrids.y() * _number_of_subgrids.z() -
         offset_y * _number_of_subgrids.z();
 
-    const uint_fast32_t nk = _kforce.size();
-
-    auto cellit = subgrid.hydro_begin();
-    for (int_fast32_t ix = 0; ix < _number_of_cells.x(); ++ix) {
-      const uint_fast32_t oix = (offset_x * _number_of_cells.x() + ix) * nk;
-      for (int_fast32_t iy = 0; iy < _number_of_cells.y(); ++iy) {
-        const uint_fast32_t oiy = (offset_y * _number_of_cells.y() + iy) * nk;
-        for (int_fast32_t iz = 0; iz < _number_of_cells.z(); ++iz) {
-          const uint_fast32_t oiz = (offset_z * _number_of_cells.z() + iz) * nk;
-          CoordinateVector<> force;
-          for (uint_fast32_t ik = 0; ik < nk; ++ik) {
-            const CoordinateVector<> fr = _amplitudes_real[ik];
-            const CoordinateVector<> fi = _amplitudes_imaginary[ik];
-
-            const double cosx = _cos_x[oix + ik];
-            const double cosy = _cos_y[oiy + ik];
-            const double cosz = _cos_z[oiz + ik];
-            const double sinx = _sin_x[oix + ik];
-            const double siny = _sin_y[oiy + ik];
-            const double sinz = _sin_z[oiz + ik];
-
-            const double cosyz = cosy * cosz - siny * sinz;
-            const double sinyz = siny * cosz + cosy * sinz;
-
-            const double cosxyz = cosx * cosyz - sinx * sinyz;
-            const double sinxyz = sinx * cosyz + cosx * sinyz;
-
-            force += fr * cosxyz - fi * sinxyz;
-          }
+    const CoordinateVector< int_fast32_t > offset(
+        offset_x * _number_of_cells.x(), offset_y * _number_of_cells.y(),
+        offset_z * _number_of_cells.z());
+    std::vector< CoordinateVector<> > forces(
+        _number_of_cells.x() * _number_of_cells.y() * _number_of_cells.z());
+    if (_separable_evaluation) {
+      compute_forces_separable(offset, forces);
+    } else {
+      compute_forces_direct(offset, forces);
+    }
 
-          const double mdt =
-              cellit.get_hydro_variables().get_conserved_mass() * _time_step;
-          const CoordinateVector<> old_p =
-              cellit.get_hydro_variables().get_conserved_momentum();
-          cellit.get_hydro_variables().conserved(1) += mdt * force.x();
-          cellit.get_hydro_variables().conserved(2) += mdt * force.y();
-          cellit.get_hydro_variables().conserved(3) += mdt * force.z();
-          cellit.get_hydro_variables().conserved(4) +=
-              _time_step * CoordinateVector<>::dot_product(old_p, force);
-          cellit.get_hydro_variables().primitives(1) += _time_step * force.x();
-          cellit.get_hydro_variables().primitives(2) += _time_step * force.y();
-          cellit.get_hydro_variables().primitives(3) += _time_step * force.z();
-
-          ++cellit;
-        }
-      }
+    uint_fast32_t icell = 0;
+    for (auto cellit = subgrid.hydro_begin(); cellit != subgrid.hydro_end();
+         ++cellit) {
+      const CoordinateVector<> force = forces[icell];
+      const double mdt =
+          cellit.get_hydro_variables().get_conserved_mass() * _time_step;
+      const CoordinateVector<> old_p =
+          cellit.get_hydro_variables().get_conserved_momentum();
+      cellit.get_hydro_variables().conserved(1) += mdt * force.x();
+      cellit.get_hydro_variables().conserved(2) += mdt * force.y();
+      cellit.get_hydro_variables().conserved(3) += mdt * force.z();
+      cellit.get_hydro_variables().conserved(4) +=
+          _time_step * CoordinateVector<>::dot_product(old_p, force);
+      cellit.get_hydro_variables().primitives(1) += _time_step * force.x();
+      cellit.get_hydro_variables().primitives(2) += _time_step * force.y();
+      cellit.get_hydro_variables().primitives(3) += _time_step * force.z();
+      ++icell;
     }
   }
 
@@ -493,13 +708,20 @@ public:
   /**
    * @brief Restart constructor.
    *
+   * The evaluation mode does not change the state of the forcing and is not
+   * stored in the restart file, so that the restart file layout does not
+   * depend on it.
+   *
    * @param restart_reader Restart file to read from.
+   * @param separable_evaluation Use the separable evaluation of the forcing?
    */
-  inline AlveliusTurbulenceForcing(RestartReader &restart_reader)
+  inline AlveliusTurbulenceForcing(RestartReader &restart_reader,
+                                   const bool separable_evaluation = false)
       : _number_of_subgrids(restart_reader), _number_of_cells(restart_reader),
         _random_generator(restart_reader),
         _time_step(restart_reader.read< double >()),
-        _number_of_driving_steps(restart_reader.read< uint_fast32_t >()) {
+        _number_of_driving_steps(restart_reader.read< uint_fast32_t >()),
+        _separable_evaluation(separable_evaluation) {
 
     const size_t number_of_modes = restart_reader.read< size_t >();
     _amplitudes_real.resize(number_of_modes);
@@ -537,6 +759,7 @@ public:
       _sin_z[iz] = restart_reader.read< double >();
       _cos_z[iz] = restart_reader.read< double >();
     }
+    group_modes();
   }
 };
 
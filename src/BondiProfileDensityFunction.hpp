@@ -30,6 +30,7 @@
 
 #include "BondiProfile.hpp"
 #include "DensityFunction.hpp"
+#include "DensityFunctionBlock.hpp"
 
 /**
  * @brief Spherical Bondi accretion DensityFunction.
@@ -83,19 +84,18 @@ public:
             "DensityFunction:neutral fraction", 1.)) {}
 
   /**
-   * @brief Function that gives the density for a given cell.
+   * @brief Get the values at the given position.
    *
-   * @param cell Geometrical information about the cell.
-   * @return Initial physical field values for that cell.
+   * @param position Position (in m).
+   * @return Initial physical field values at that position.
    */
-  virtual DensityValues operator()(const Cell &cell) {
+  inline DensityValues get_values(const CoordinateVector<> position) const {
 
     const double hydrogen_mass =
         PhysicalConstants::get_physical_constant(PHYSICALCONSTANT_PROTON_MASS);
     const double boltzmann_k =
         PhysicalConstants::get_physical_constant(PHYSICALCONSTANT_BOLTZMANN);
 
-    const CoordinateVector<> position = cell.get_cell_midpoint();
     double density, pressure, neutral_fraction;
     CoordinateVector<> velocity;
     _bondi_profile.get_hydrodynamic_variables(position, density, velocity,
@@ -119,6 +119,36 @@ public:
 
     return values;
   }
+
+  /**
+   * @brief Function that gives the density for a given cell.
+   *
+   * @param cell Geometrical information about the cell.
+   * @return Initial physical field values for that cell.
+   */
+  virtual DensityValues operator()(const Cell &cell) {
+    return get_values(cell.get_cell_midpoint());
+  }
+
+  /**
+   * @brief Initialize all cells in the given block at once.
+   *
+   * @param block DensityFunctionBlock to initialize.
+   * @return True, since the block is always initialized.
+   */
+  virtual bool evaluate_block(DensityFunctionBlock &block) {
+    uint_fast32_t index = 0;
+    for (int_fast32_t ix = 0; ix < block.get_number_of_cells(0); ++ix) {
+      for (int_fast32_t iy = 0; iy < block.get_number_of_cells(1); ++iy) {
+        for (int_fast32_t iz = 0; iz < block.get_number_of_cells(2); ++iz) {
+          block.set_values(index,
+                           get_values(block.get_cell_midpoint(ix, iy, iz)));
+          ++index;
+        }
+      }
+    }
+    return true;
+  }
 };
 
 #endif // BONDIPROFILEDENSITYFUNCTION_HPP
@@ -28,21 +28,21 @@
 #define BUFFEREDCMACIONIZESNAPSHOTDENSITYFUNCTION_HPP
 
 #include "Box.hpp"
-#include "CPUCycle.hpp"
 #include "DensityFunction.hpp"
 #include "HDF5Tools.hpp"
 #include "Log.hpp"
 #include "ParameterFile.hpp"
+#include "SnapshotBlockBuffer.hpp"
 #include "ThreadLock.hpp"
 
 /**
  * @brief DensityFunction that reads a density grid from a task-based CMacIonize
  * snapshot in a buffered fashion.
  *
- * The snapshot is read per block, with blocks being kept in internal buffers
- * as long as there is space. If buffer space runs out, the oldest block is
- * discarded. This should allow reading snapshots that are much bigger than the
- * memory of the machine running the code.
+ * The snapshot is read per block, with blocks being kept in a
+ * SnapshotBlockBuffer as long as there is space. If buffer space runs out, the
+ * oldest block is discarded. This should allow reading snapshots that are much
+ * bigger than the memory of the machine running the code.
  *
  * On top of the improved memory usage, this variant of
  * CMacIonizeSnapshotDensityFunction also ensures mass conservation when
@@ -50,9 +50,6 @@
  */
 class BufferedCMacIonizeSnapshotDensityFunction : public DensityFunction {
 private:
-  /*! @brief Number of subgrids that can be buffered. */
-  const uint_fast32_t _buffer_size;
-
   /*! @brief Snapshot file. */
   HDF5Tools::HDF5File _file;
 
@@ -85,23 +82,10 @@ private:
   CoordinateVector< uint_fast32_t > _number_of_subgrids;
 
   /*! @brief Subgrid buffer. */
-  std::vector< DensityValues > _buffer;
-
-  /*! @brief Last usage timestamp for each buffer. */
-  std::vector< uint_fast64_t > _buffer_timestamps;
-
-  /*! @brief Index of each subgrid in the buffer (if buffered). */
-  std::vector< uint_fast32_t > _buffer_indices;
+  SnapshotBlockBuffer< DensityValues > _buffer;
 
-  /*! @brief Index of the subgrid that has been buffered (to make sure another
-   *  thread did not swap it out). */
-  std::vector< uint_fast32_t > _buffer_subgrid_indices;
-
-  /*! @brief Lock protecting the buffer and HDF5 file. */
-  ThreadLock _buffer_lock;
-
-  /*! @brief Locks per buffer element. */
-  std::vector< ThreadLock > _buffer_element_locks;
+  /*! @brief Lock protecting the HDF5 file. */
+  ThreadLock _file_lock;
 
   /*! @brief Read the number density (true) or density (false)? */
   bool _read_number_density;
@@ -132,9 +116,7 @@ public:
       const std::string filename, const uint_fast32_t buffer_size,
       const Box<> new_box, const CoordinateVector< uint_fast32_t > new_ncell,
       Log *log = nullptr)
-      : _buffer_size(buffer_size), _buffer_timestamps(buffer_size, 0),
-        _buffer_subgrid_indices(buffer_size),
-        _buffer_element_locks(buffer_size), _log(log) {
+      : _buffer(buffer_size), _log(log) {
 
     // check that the file can be opened
     std::ifstream file(filename);
@@ -407,10 +389,9 @@ public:
    * @brief Initialize the internal buffer.
    */
   virtual void initialize() {
-    _buffer.resize(_buffer_size * _mapped_subgrid_size);
-    _buffer_indices.resize(_number_of_subgrids.x() * _number_of_subgrids.y() *
-                               _number_of_subgrids.z(),
-                           0xffffffff);
+    _buffer.initialize(_number_of_subgrids.x() * _number_of_subgrids.y() *
+                           _number_of_subgrids.z(),
+                       _mapped_subgrid_size);
   }
 
   /**
@@ -419,51 +400,27 @@ public:
   virtual void free() {
     HDF5Tools::close_group(_particle_group);
     HDF5Tools::close_file(_file);
-    _buffer.clear();
-    _buffer_timestamps.clear();
-    _buffer_element_locks.clear();
-    _buffer_subgrid_indices.clear();
-    _buffer_indices.clear();
+    _buffer.free();
   }
 
   /**
-   * @brief Buffer the subgrid with the given index.
+   * @brief Read the subgrid with the given index into the given buffer element.
    *
    * This function uses its own lock to ensure thread safe access to the HDF5
    * file.
    *
-   * @param subgrid_index Index of the subgrid to buffer.
-   * @return Index within the buffer of the buffered subgrid. The corresponding
-   * element is locked and cannot be altered by any other thread until
-   * unlock_buffer_element() is called.
+   * @param subgrid_index Index of the subgrid to read.
+   * @param buffer Buffer element to store the (remapped) subgrid in.
    */
-  inline uint_fast32_t buffer_subgrid(const uint_fast32_t subgrid_index) {
-
-    // sort the buffers according to their last access time
-    const std::vector< uint_fast64_t > buffer_timestamps_copy(
-        _buffer_timestamps);
-    const std::vector< uint_fast32_t > timesort =
-        Utilities::argsort(buffer_timestamps_copy);
-    // try to lock an old buffer
-    uint_fast32_t ibuffer = 0;
-    while (ibuffer < timesort.size() &&
-           !_buffer_element_locks[timesort[ibuffer]].try_lock()) {
-      ++ibuffer;
-    }
-    if (ibuffer == timesort.size()) {
-      cmac_error("Unable to obtain a free subgrid buffer!");
-    }
-
-    // buffer_index is now locked and can be overwritten
-    const uint_fast32_t buffer_index = timesort[ibuffer];
+  inline void read_subgrid(const uint_fast32_t subgrid_index,
+                           DensityValues *buffer) {
 
     // we are going to read the HDF5 file, so from this point we need to be
     // thread-safe
-    _buffer_lock.lock();
+    _file_lock.lock();
 
     if (_log) {
-      _log->write_info("Reading subgrid ", subgrid_index,
-                       " into buffer element ", buffer_index);
+      _log->write_info("Reading subgrid ", subgrid_index);
     }
 
     const uint_fast32_t subgrid_offset = subgrid_index * _original_subgrid_size;
@@ -504,7 +461,7 @@ public:
 
     // we are done reading the file, unlock the file so that another thread
     // can access it
-    _buffer_lock.unlock();
+    _file_lock.unlock();
 
     if (!_read_number_density || !_read_temperature) {
       for (uint_fast32_t i = 0; i < _original_subgrid_size; ++i) {
@@ -557,8 +514,7 @@ public:
               }
             }
           }
-          DensityValues &cell = _buffer[buffer_index * _mapped_subgrid_size +
-                                        mapped_subgrid_index];
+          DensityValues &cell = buffer[mapped_subgrid_index];
           cell.set_number_density(cell_number_density * norm);
           cell.set_temperature(cell_temperature * norm);
           for (int_fast32_t j = 0; j < NUMBER_OF_IONNAMES; ++j) {
@@ -568,60 +524,6 @@ public:
         }
       }
     }
-    // invalidate the old subgrid pointer, this buffer will no longer contain
-    // that subgrid
-    _buffer_indices[_buffer_subgrid_indices[buffer_index]] = 0xffffffff;
-    // point the new subgrid to this buffer
-    _buffer_indices[subgrid_index] = buffer_index;
-    // make sure the cross check works
-    _buffer_subgrid_indices[buffer_index] = subgrid_index;
-
-    return buffer_index;
-  }
-
-  /**
-   * @brief Obtain the index within the buffer of the subgrid with the given
-   * index.
-   *
-   * @param subgrid_index Subgrid index.
-   * @return Index within the buffer. The corresponding element is locked and
-   * cannot be altered by any other thread until unlock_buffer_element() is
-   * called.
-   */
-  inline uint_fast32_t get_buffer_index(const uint_fast32_t subgrid_index) {
-
-    // first retrieve the index of the subgrid in the buffer
-    uint_fast32_t buffer_index = _buffer_indices[subgrid_index];
-    // check if the subgrid was buffered
-    if (buffer_index == 0xffffffff) {
-      // subgrid was not buffered, buffer it
-      buffer_index = buffer_subgrid(subgrid_index);
-    } else {
-      // subgrid might be buffered
-      // we need to lock it and check that is wasn't swapped out for another
-      // subgrid before we obtained the lock
-      _buffer_element_locks[buffer_index].lock();
-      if (_buffer_subgrid_indices[buffer_index] != subgrid_index) {
-        // too bad, another thread swapped it out! We need to release the lock
-        // and buffer it again
-        _buffer_element_locks[buffer_index].unlock();
-        buffer_index = buffer_subgrid(subgrid_index);
-      }
-    }
-    // update the access time for the buffer element
-    cpucycle_tick(_buffer_timestamps[buffer_index]);
-    return buffer_index;
-  }
-
-  /**
-   * @brief Unlock the given buffer element.
-   *
-   * @param buffer_index Index of a buffer element.
-   */
-  inline void unlock_buffer_element(const uint_fast32_t buffer_index) {
-    // update the access time for the buffer element
-    cpucycle_tick(_buffer_timestamps[buffer_index]);
-    _buffer_element_locks[buffer_index].unlock();
   }
 
   /**
@@ -657,7 +559,11 @@ public:
     //    }
 
     // obtain the buffer that contains the subgrid (and lock it)
-    const uint_fast32_t buffer_index = get_buffer_index(subgrid_index);
+    const uint_fast32_t buffer_index = _buffer.lock(
+        subgrid_index,
+        [this](const uint_fast32_t index, DensityValues *buffer) {
+          read_subgrid(index, buffer);
+        });
 
     //    if(_log){
     //      _log->write_info("buffer index: ", buffer_index);
@@ -686,13 +592,13 @@ public:
     //    }
 
     // obtain the cell values
-    const DensityValues values =
-        _buffer[buffer_index * _mapped_subgrid_size +
-                cix * _mapped_subgrid_ncell.y() * _mapped_subgrid_ncell.z() +
-                ciy * _mapped_subgrid_ncell.z() + ciz];
+    const DensityValues values = _buffer.get_values(
+        buffer_index)[cix * _mapped_subgrid_ncell.y() *
+                          _mapped_subgrid_ncell.z() +
+                      ciy * _mapped_subgrid_ncell.z() + ciz];
 
     // unlock the buffer
-    unlock_buffer_element(buffer_index);
+    _buffer.unlock(buffer_index);
 
     return values;
   }
@@ -635,20 +635,9 @@ public:
 
   virtual void get_sne_radii(DensitySubGridCreator< HydroDensitySubGrid > &grid_creator) {
 
-       for (uint_fast32_t i = 0; i < _to_do_feedback.size(); ++i) {
-
-        double r_inj,r_st,nbar,num_inj;
-
-
-        std::tie(r_inj,r_st,nbar,num_inj) = novahandler->get_r_inj(&grid_creator,_to_do_feedback[i]);
-
-         _r_inj.push_back(r_inj);
-         _r_st.push_back(r_st);
-         _nbar.push_back(nbar);
-         _num_cells_injected.push_back(num_inj);
-
-
-       }
+    // the supernovae are handled in parallel
+    novahandler->get_r_inj(&grid_creator, _to_do_feedback, _r_inj, _r_st,
+                           _nbar, _num_cells_injected);
   }
 
   virtual void add_stellar_feedback(HydroDensitySubGrid &subgrid, Hydro &hydro) {
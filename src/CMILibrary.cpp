@@ -24,15 +24,117 @@
  * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
  */
 #include "CMILibrary.hpp"
+#include "Error.hpp"
 #include "IonizationSimulation.hpp"
 #include "SPHArrayInterface.hpp"
 #include "TerminalLog.hpp"
 
+/**
+ * @brief Particle arrays that are owned by the caller and that were registered
+ * with the library.
+ *
+ * The library only stores pointers to the arrays, so that they can be read
+ * (and the neutral fractions written) without any copies at the interface.
+ */
+class CMIParticleArrays {
+public:
+  virtual ~CMIParticleArrays() {}
+
+  /**
+   * @brief Pass on the current contents of the arrays to the given
+   * SPHArrayInterface.
+   *
+   * @param interface SPHArrayInterface.
+   */
+  virtual void update(SPHArrayInterface &interface) const = 0;
+
+  /**
+   * @brief Fill the neutral fraction array with the result stored in the given
+   * SPHArrayInterface.
+   *
+   * @param interface SPHArrayInterface.
+   */
+  virtual void fill(SPHArrayInterface &interface) const = 0;
+};
+
+/**
+ * @brief CMIParticleArrays implementation for a specific precision.
+ *
+ * @tparam _position_type_ Data type of the coordinate arrays.
+ * @tparam _value_type_ Data type of the smoothing length, mass and neutral
+ * fraction arrays.
+ */
+template < typename _position_type_, typename _value_type_ >
+class CMIParticleArraysImplementation : public CMIParticleArrays {
+private:
+  /*! @brief X coordinates (in internal units). */
+  const _position_type_ *_x;
+
+  /*! @brief Y coordinates (in internal units). */
+  const _position_type_ *_y;
+
+  /*! @brief Z coordinates (in internal units). */
+  const _position_type_ *_z;
+
+  /*! @brief Smoothing lengths (in internal units). */
+  const _value_type_ *_h;
+
+  /*! @brief Masses (in internal units). */
+  const _value_type_ *_m;
+
+  /*! @brief Neutral fractions. */
+  _value_type_ *_nH;
+
+  /*! @brief Number of elements in each array. */
+  const size_t _N;
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param x X coordinates (in internal units).
+   * @param y Y coordinates (in internal units).
+   * @param z Z coordinates (in internal units).
+   * @param h Smoothing lengths (in internal units).
+   * @param m Masses (in internal units).
+   * @param nH Array to store the resulting neutral fractions in.
+   * @param N Number of elements in each array.
+   */
+  CMIParticleArraysImplementation(const _position_type_ *x,
+                                  const _position_type_ *y,
+                                  const _position_type_ *z,
+                                  const _value_type_ *h, const _value_type_ *m,
+                                  _value_type_ *nH, const size_t N)
+      : _x(x), _y(y), _z(z), _h(h), _m(m), _nH(nH), _N(N) {}
+
+  /**
+   * @brief Pass on the current contents of the arrays to the given
+   * SPHArrayInterface.
+   *
+   * @param interface SPHArrayInterface.
+   */
+  virtual void update(SPHArrayInterface &interface) const {
+    interface.update(_x, _y, _z, _h, _m, _N);
+  }
+
+  /**
+   * @brief Fill the neutral fraction array with the result stored in the given
+   * SPHArrayInterface.
+   *
+   * @param interface SPHArrayInterface.
+   */
+  virtual void fill(SPHArrayInterface &interface) const {
+    interface.fill_array(_nH);
+  }
+};
+
 IonizationSimulation *global_ionization_simulation = nullptr;
 SPHArrayInterface *global_interface = nullptr;
 
 Log *global_log = nullptr;
 
+CMIParticleArrays *global_particle_arrays = nullptr;
+
 /**
  * @brief Initialize the CMI library.
  *
@@ -130,6 +232,12 @@ void cmi_destroy() {
   delete global_ionization_simulation;
   delete global_interface;
   delete global_log;
+  delete global_particle_arrays;
+  // reset the pointers, so that the library can be initialized again
+  global_ionization_simulation = nullptr;
+  global_interface = nullptr;
+  global_log = nullptr;
+  global_particle_arrays = nullptr;
 }
 
 /**
@@ -206,3 +314,114 @@ void cmi_compute_neutral_fraction_sp(const float *x, const float *y,
   global_ionization_simulation->run(global_interface);
   global_interface->fill_array(nH);
 }
+
+/**
+ * @brief Register the given particle arrays with the library.
+ *
+ * Double precision version.
+ *
+ * The library does not copy the arrays, but stores pointers to them. The
+ * arrays are owned by the caller and need to remain valid until they are
+ * replaced by another call to one of the registration functions or until
+ * cmi_destroy() is called. Their contents can be changed in between calls to
+ * cmi_update_neutral_fraction().
+ *
+ * @param x X coordinates (in internal units).
+ * @param y Y coordinates (in internal units).
+ * @param z Z coordinates (in internal units).
+ * @param h Smoothing lengths (in internal units).
+ * @param m Masses (in internal units).
+ * @param nH Array to store the resulting neutral fractions in.
+ * @param N Number of elements in each array.
+ */
+void cmi_register_particles_dp(const double *x, const double *y,
+                               const double *z, const double *h,
+                               const double *m, double *nH, const size_t N) {
+
+  delete global_particle_arrays;
+  global_particle_arrays =
+      new CMIParticleArraysImplementation< double, double >(x, y, z, h, m, nH,
+                                                            N);
+}
+
+/**
+ * @brief Register the given particle arrays with the library.
+ *
+ * Mixed precision version.
+ *
+ * The library does not copy the arrays, but stores pointers to them. The
+ * arrays are owned by the caller and need to remain valid until they are
+ * replaced by another call to one of the registration functions or until
+ * cmi_destroy() is called. Their contents can be changed in between calls to
+ * cmi_update_neutral_fraction().
+ *
+ * @param x X coordinates (in internal units).
+ * @param y Y coordinates (in internal units).
+ * @param z Z coordinates (in internal units).
+ * @param h Smoothing lengths (in internal units).
+ * @param m Masses (in internal units).
+ * @param nH Array to store the resulting neutral fractions in.
+ * @param N Number of elements in each array.
+ */
+void cmi_register_particles_mp(const double *x, const double *y,
+                               const double *z, const float *h, const float *m,
+                               float *nH, const size_t N) {
+
+  delete global_particle_arrays;
+  global_particle_arrays =
+      new CMIParticleArraysImplementation< double, float >(x, y, z, h, m, nH,
+                                                           N);
+}
+
+/**
+ * @brief Register the given particle arrays with the library.
+ *
+ * Single precision version.
+ *
+ * The library does not copy the arrays, but stores pointers to them. The
+ * arrays are owned by the caller and need to remain valid until they are
+ * replaced by another call to one of the registration functions or until
+ * cmi_destroy() is called. Their contents can be changed in between calls to
+ * cmi_update_neutral_fraction().
+ *
+ * @param x X coordinates (in internal units).
+ * @param y Y coordinates (in internal units).
+ * @param z Z coordinates (in internal units).
+ * @param h Smoothing lengths (in internal units).
+ * @param m Masses (in internal units).
+ * @param nH Array to store the resulting neutral fractions in.
+ * @param N Number of elements in each array.
+ */
+void cmi_register_particles_sp(const float *x, const float *y, const float *z,
+                               const float *h, const float *m, float *nH,
+                               const size_t N) {
+
+  delete global_particle_arrays;
+  global_particle_arrays =
+      new CMIParticleArraysImplementation< float, float >(x, y, z, h, m, nH, N);
+}
+
+/**
+ * @brief Compute the neutral fractions for the current contents of the
+ * registered particle arrays and store them in the registered neutral fraction
+ * array.
+ *
+ * Contrary to the cmi_compute_neutral_fraction functions, this function keeps
+ * the state of the library between calls: the neighbour search tree is
+ * refitted rather than rebuilt if the number of particles did not change, and
+ * the temperatures and neutral fractions on the grid from the previous call
+ * are used as a warm start, so that fewer iterations are needed (see
+ * IonizationSimulation::update()). This is much cheaper if the particles only
+ * moved slightly since the previous call.
+ */
+void cmi_update_neutral_fraction() {
+
+  if (global_particle_arrays == nullptr) {
+    cmac_error("No particle arrays were registered with the library!");
+  }
+
+  global_particle_arrays->update(*global_interface);
+  global_ionization_simulation->update(global_interface);
+  global_ionization_simulation->run(global_interface);
+  global_particle_arrays->fill(*global_interface);
+}
@@ -43,6 +43,11 @@ class Log;
 /*! @brief Global Log object used by the library. */
 extern Log *global_log;
 
+class CMIParticleArrays;
+
+/*! @brief Global particle arrays registered with the library. */
+extern CMIParticleArrays *global_particle_arrays;
+
 extern "C" {
 void cmi_init(const char *parameter_file, const int num_thread,
               const double unit_length_in_SI, const double unit_mass_in_SI,
@@ -69,6 +74,17 @@ void cmi_compute_neutral_fraction_mp(const double *x, const double *y,
 void cmi_compute_neutral_fraction_sp(const float *x, const float *y,
                                      const float *z, const float *h,
                                      const float *m, float *nH, const size_t N);
+
+void cmi_register_particles_dp(const double *x, const double *y,
+                               const double *z, const double *h,
+                               const double *m, double *nH, const size_t N);
+void cmi_register_particles_mp(const double *x, const double *y,
+                               const double *z, const float *h, const float *m,
+                               float *nH, const size_t N);
+void cmi_register_particles_sp(const float *x, const float *y, const float *z,
+                               const float *h, const float *m, float *nH,
+                               const size_t N);
+void cmi_update_neutral_fraction();
 }
 
 #endif // CMILIBRARY_HPP
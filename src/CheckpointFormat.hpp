@@ -0,0 +1,164 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file CheckpointFormat.hpp
+ *
+ * @brief Layout of the binary checkpoint files written by the
+ * CheckpointWriter and read by the CheckpointReader.
+ *
+ * A checkpoint file consists of
+ *  - a header: CheckpointFormat::Header,
+ *  - an index table: one CheckpointFormat::IndexEntry per block,
+ *  - the raw data blocks, every block starting at a multiple of
+ *    CHECKPOINTFORMAT_ALIGNMENT bytes.
+ *
+ * Blocks are raw memory dumps of arrays of records, which means a checkpoint
+ * file can only be read by a program that was compiled with the same
+ * configuration and on the same architecture as the program that wrote it.
+ * The record size of every block is stored in the index table to catch the
+ * most common mismatches.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#ifndef CHECKPOINTFORMAT_HPP
+#define CHECKPOINTFORMAT_HPP
+
+#include <cstdint>
+#include <cstring>
+
+/*! @brief Magic number at the start of a checkpoint file ("CMICKPT1"). */
+#define CHECKPOINTFORMAT_MAGIC 0x3154504b43494d43ull
+
+/*! @brief Alignment of the data blocks within the file (in bytes). */
+#define CHECKPOINTFORMAT_ALIGNMENT 4096
+
+/**
+ * @brief Layout of the binary checkpoint files.
+ */
+namespace CheckpointFormat {
+
+/**
+ * @brief Checkpoint file header.
+ */
+struct Header {
+  /*! @brief Magic number (CHECKPOINTFORMAT_MAGIC). */
+  uint64_t _magic;
+
+  /*! @brief Number of blocks in the file. */
+  uint64_t _number_of_blocks;
+
+  /*! @brief Checksum of the index table. */
+  uint64_t _index_checksum;
+
+  /*! @brief Total size of the file (in bytes). */
+  uint64_t _file_size;
+};
+
+/**
+ * @brief Entry in the index table of a checkpoint file.
+ */
+struct IndexEntry {
+  /*! @brief Offset of the block within the file (in bytes). */
+  uint64_t _offset;
+
+  /*! @brief Size of the block (in bytes). */
+  uint64_t _size;
+
+  /*! @brief Size of a single record in the block (in bytes). */
+  uint64_t _record_size;
+
+  /*! @brief Checksum of the block. */
+  uint64_t _checksum;
+};
+
+/**
+ * @brief Rotate the given 64-bit value to the left.
+ *
+ * @param value Value.
+ * @param shift Number of bits to rotate.
+ * @return Rotated value.
+ */
+inline uint64_t rotate_left(const uint64_t value, const uint_fast8_t shift) {
+  return (value << shift) | (value >> (64 - shift));
+}
+
+/**
+ * @brief Compute the checksum of the given block of memory.
+ *
+ * This is a non-cryptographic 64-bit hash in the spirit of xxHash64: the data
+ * are processed in 8 byte words that are mixed into four independent lanes,
+ * so that the hash runs at close to memory bandwidth. It is a lot faster than
+ * the MD5Sum, which we do not need, since we only want to detect corruption.
+ *
+ * @param data Data.
+ * @param size Size of the data (in bytes).
+ * @return 64-bit checksum.
+ */
+inline uint64_t checksum(const char *data, const size_t size) {
+
+  const uint64_t prime1 = 0x9e3779b185ebca87ull;
+  const uint64_t prime2 = 0xc2b2ae3d27d4eb4full;
+  const uint64_t prime3 = 0x165667b19e3779f9ull;
+
+  uint64_t lanes[4] = {prime1 + prime2, prime2, 0, 0 - prime1};
+  const size_t number_of_stripes = size / 32;
+  for (size_t istripe = 0; istripe < number_of_stripes; ++istripe) {
+    for (uint_fast8_t ilane = 0; ilane < 4; ++ilane) {
+      uint64_t word;
+      std::memcpy(&word, data + 32 * istripe + 8 * ilane, 8);
+      lanes[ilane] = rotate_left(lanes[ilane] + word * prime2, 31) * prime1;
+    }
+  }
+
+  uint64_t hash = size;
+  for (uint_fast8_t ilane = 0; ilane < 4; ++ilane) {
+    hash = rotate_left(hash, 27) ^ (rotate_left(lanes[ilane], 31) * prime1);
+    hash = hash * prime1 + prime3;
+  }
+
+  // remaining bytes
+  for (size_t i = 32 * number_of_stripes; i < size; ++i) {
+    hash = rotate_left(hash ^ (static_cast< uint8_t >(data[i]) * prime3), 11) *
+           prime1;
+  }
+
+  // final avalanche
+  hash ^= hash >> 33;
+  hash *= prime2;
+  hash ^= hash >> 29;
+  hash *= prime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+/**
+ * @brief Round the given offset up to the next multiple of
+ * CHECKPOINTFORMAT_ALIGNMENT.
+ *
+ * @param offset Offset (in bytes).
+ * @return Aligned offset (in bytes).
+ */
+inline uint64_t align(const uint64_t offset) {
+  return ((offset + CHECKPOINTFORMAT_ALIGNMENT - 1) /
+          CHECKPOINTFORMAT_ALIGNMENT) *
+         CHECKPOINTFORMAT_ALIGNMENT;
+}
+} // namespace CheckpointFormat
+
+#endif // CHECKPOINTFORMAT_HPP
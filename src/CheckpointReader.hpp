@@ -0,0 +1,198 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file CheckpointReader.hpp
+ *
+ * @brief Binary checkpoint file reader.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#ifndef CHECKPOINTREADER_HPP
+#define CHECKPOINTREADER_HPP
+
+#include "CheckpointFormat.hpp"
+#include "Error.hpp"
+
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Binary checkpoint file reader.
+ *
+ * The file is memory mapped, so that blocks are only read from disk when they
+ * are accessed. Different threads can access different blocks simultaneously.
+ * The checksum of a block is verified when the block is accessed.
+ */
+class CheckpointReader {
+private:
+  /*! @brief Name of the checkpoint file. */
+  const std::string _filename;
+
+  /*! @brief File descriptor. */
+  int _file;
+
+  /*! @brief Size of the file (in bytes). */
+  size_t _size;
+
+  /*! @brief Memory mapped file contents. */
+  const char *_mapping;
+
+  /*! @brief Header of the file. */
+  CheckpointFormat::Header _header;
+
+  /*! @brief Index table (points into the memory mapped file). */
+  const CheckpointFormat::IndexEntry *_index;
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param filename Name of the checkpoint file.
+   */
+  inline CheckpointReader(const std::string filename) : _filename(filename) {
+
+    _file = open(_filename.c_str(), O_RDONLY);
+    if (_file < 0) {
+      cmac_error("Unable to open checkpoint file \"%s\"!", _filename.c_str());
+    }
+    struct stat file_stats;
+    if (fstat(_file, &file_stats) != 0) {
+      cmac_error("Unable to obtain size of checkpoint file \"%s\"!",
+                 _filename.c_str());
+    }
+    _size = file_stats.st_size;
+    if (_size < sizeof(CheckpointFormat::Header)) {
+      cmac_error("\"%s\" is not a valid checkpoint file!", _filename.c_str());
+    }
+
+    void *mapping = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _file, 0);
+    if (mapping == MAP_FAILED) {
+      cmac_error("Unable to memory map checkpoint file \"%s\"!",
+                 _filename.c_str());
+    }
+    _mapping = reinterpret_cast< const char * >(mapping);
+
+    std::memcpy(&_header, _mapping, sizeof(CheckpointFormat::Header));
+    if (_header._magic != CHECKPOINTFORMAT_MAGIC ||
+        _header._file_size != _size) {
+      cmac_error("\"%s\" is not a valid checkpoint file!", _filename.c_str());
+    }
+    const size_t index_size =
+        _header._number_of_blocks * sizeof(CheckpointFormat::IndexEntry);
+    if (sizeof(CheckpointFormat::Header) + index_size > _size) {
+      cmac_error("\"%s\" is not a valid checkpoint file!", _filename.c_str());
+    }
+    const char *index = _mapping + sizeof(CheckpointFormat::Header);
+    if (CheckpointFormat::checksum(index, index_size) !=
+        _header._index_checksum) {
+      cmac_error("Corrupt index table in checkpoint file \"%s\"!",
+                 _filename.c_str());
+    }
+    _index = reinterpret_cast< const CheckpointFormat::IndexEntry * >(index);
+  }
+
+  /**
+   * @brief Destructor.
+   *
+   * Unmaps and closes the file.
+   */
+  inline ~CheckpointReader() {
+    munmap(const_cast< char * >(_mapping), _size);
+    close(_file);
+  }
+
+  /**
+   * @brief Get the number of blocks in the file.
+   *
+   * @return Number of blocks.
+   */
+  inline size_t get_number_of_blocks() const {
+    return _header._number_of_blocks;
+  }
+
+  /**
+   * @brief Check whether the given block matches its checksum.
+   *
+   * @param index Index of the block.
+   * @return True if the checksum of the block contents matches the stored
+   * checksum.
+   */
+  inline bool verify_block(const size_t index) const {
+    cmac_assert(index < _header._number_of_blocks);
+    const CheckpointFormat::IndexEntry &entry = _index[index];
+    return entry._offset + entry._size <= _size &&
+           CheckpointFormat::checksum(_mapping + entry._offset, entry._size) ==
+               entry._checksum;
+  }
+
+  /**
+   * @brief Access the given block.
+   *
+   * @param index Index of the block.
+   * @param number_of_records Expected number of records in the block.
+   * @param record_size Expected size of a single record (in bytes).
+   * @return Pointer to the start of the block in the memory mapped file.
+   */
+  inline const char *get_block(const size_t index,
+                               const size_t number_of_records,
+                               const size_t record_size) const {
+
+    if (index >= _header._number_of_blocks) {
+      cmac_error("Checkpoint file \"%s\" has no block %zu!", _filename.c_str(),
+                 index);
+    }
+    const CheckpointFormat::IndexEntry &entry = _index[index];
+    if (entry._record_size != record_size ||
+        entry._size != number_of_records * record_size) {
+      cmac_error("Block %zu in checkpoint file \"%s\" does not have the "
+                 "expected layout (record size %zu instead of %zu, %zu bytes "
+                 "instead of %zu). Was the file written by a different "
+                 "version or configuration of the code?",
+                 index, _filename.c_str(), size_t(entry._record_size),
+                 record_size, size_t(entry._size),
+                 number_of_records * record_size);
+    }
+    if (!verify_block(index)) {
+      cmac_error("Checksum mismatch for block %zu in checkpoint file \"%s\"!",
+                 index, _filename.c_str());
+    }
+    return _mapping + entry._offset;
+  }
+
+  /**
+   * @brief Copy the given block into the given array.
+   *
+   * @param index Index of the block.
+   * @param destination Array to copy into.
+   * @param number_of_records Number of records in the array.
+   */
+  template < typename _datatype_ >
+  inline void read_block(const size_t index, _datatype_ *destination,
+                         const size_t number_of_records) const {
+    const char *block =
+        get_block(index, number_of_records, sizeof(_datatype_));
+    std::memcpy(reinterpret_cast< void * >(destination), block,
+                number_of_records * sizeof(_datatype_));
+  }
+};
+
+#endif // CHECKPOINTREADER_HPP
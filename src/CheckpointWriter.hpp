@@ -0,0 +1,182 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file CheckpointWriter.hpp
+ *
+ * @brief Binary checkpoint file writer.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#ifndef CHECKPOINTWRITER_HPP
+#define CHECKPOINTWRITER_HPP
+
+#include "CheckpointFormat.hpp"
+#include "Error.hpp"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @brief Binary checkpoint file writer.
+ *
+ * Large arrays are registered as blocks using add_block(). When write() is
+ * called, all offsets are computed up front and the blocks are written in
+ * parallel using pwrite(), every thread computing the checksum of the blocks
+ * it writes. The header and index table are written last, so that an
+ * interrupted write does not produce a file with a valid header.
+ *
+ * The writer does not copy the data: the registered memory needs to remain
+ * valid and unchanged until write() returns.
+ */
+class CheckpointWriter {
+private:
+  /*! @brief Name of the checkpoint file. */
+  const std::string _filename;
+
+  /*! @brief Start of the memory of each block. */
+  std::vector< const char * > _data;
+
+  /*! @brief Index table entries for each block. */
+  std::vector< CheckpointFormat::IndexEntry > _index;
+
+  /**
+   * @brief Write the given buffer to the given offset in the given file.
+   *
+   * @param file File descriptor.
+   * @param buffer Buffer to write.
+   * @param size Size of the buffer (in bytes).
+   * @param offset Offset within the file (in bytes).
+   */
+  inline void write_buffer(const int file, const char *buffer, size_t size,
+                           off_t offset) const {
+    while (size > 0) {
+      const ssize_t written = pwrite(file, buffer, size, offset);
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        cmac_error("Error while writing checkpoint file \"%s\"!",
+                   _filename.c_str());
+      }
+      buffer += written;
+      size -= written;
+      offset += written;
+    }
+  }
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param filename Name of the checkpoint file.
+   */
+  inline CheckpointWriter(const std::string filename) : _filename(filename) {}
+
+  /**
+   * @brief Register a block of memory.
+   *
+   * @param data Start of the block.
+   * @param number_of_records Number of records in the block.
+   * @param record_size Size of a single record (in bytes).
+   * @return Index of the block in the checkpoint file.
+   */
+  inline size_t add_block(const void *data, const size_t number_of_records,
+                          const size_t record_size) {
+    CheckpointFormat::IndexEntry entry;
+    entry._offset = 0;
+    entry._size = number_of_records * record_size;
+    entry._record_size = record_size;
+    entry._checksum = 0;
+    _data.push_back(reinterpret_cast< const char * >(data));
+    _index.push_back(entry);
+    return _index.size() - 1;
+  }
+
+  /**
+   * @brief Get the number of registered blocks.
+   *
+   * @return Number of blocks.
+   */
+  inline size_t get_number_of_blocks() const { return _index.size(); }
+
+  /**
+   * @brief Write all registered blocks to the file.
+   *
+   * @return Total size of the file (in bytes).
+   */
+  inline size_t write() {
+
+    // precompute the offsets of all blocks
+    uint64_t offset = CheckpointFormat::align(
+        sizeof(CheckpointFormat::Header) +
+        _index.size() * sizeof(CheckpointFormat::IndexEntry));
+    for (size_t i = 0; i < _index.size(); ++i) {
+      _index[i]._offset = offset;
+      offset = CheckpointFormat::align(offset + _index[i]._size);
+    }
+
+    const int file = open(_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+                          S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (file < 0) {
+      cmac_error("Unable to create checkpoint file \"%s\"!",
+                 _filename.c_str());
+    }
+    // make sure the file has its final size, so that the blocks can be
+    // written in any order
+    if (ftruncate(file, offset) != 0) {
+      cmac_error("Unable to resize checkpoint file \"%s\"!",
+                 _filename.c_str());
+    }
+
+    const int_fast64_t number_of_blocks = _index.size();
+#ifdef HAVE_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int_fast64_t i = 0; i < number_of_blocks; ++i) {
+      _index[i]._checksum =
+          CheckpointFormat::checksum(_data[i], _index[i]._size);
+      write_buffer(file, _data[i], _index[i]._size, _index[i]._offset);
+    }
+
+    CheckpointFormat::Header header;
+    header._magic = CHECKPOINTFORMAT_MAGIC;
+    header._number_of_blocks = _index.size();
+    header._index_checksum = CheckpointFormat::checksum(
+        reinterpret_cast< const char * >(_index.data()),
+        _index.size() * sizeof(CheckpointFormat::IndexEntry));
+    header._file_size = offset;
+    write_buffer(file, reinterpret_cast< const char * >(_index.data()),
+                 _index.size() * sizeof(CheckpointFormat::IndexEntry),
+                 sizeof(CheckpointFormat::Header));
+    write_buffer(file, reinterpret_cast< const char * >(&header),
+                 sizeof(CheckpointFormat::Header), 0);
+
+    if (close(file) != 0) {
+      cmac_error("Error while closing checkpoint file \"%s\"!",
+                 _filename.c_str());
+    }
+
+    return offset;
+  }
+};
+
+#endif // CHECKPOINTWRITER_HPP
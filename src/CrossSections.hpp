@@ -50,6 +50,28 @@ public:
                                    const double energy) const = 0;
 
   virtual double get_dust_opacity(const double energy) const {return 0;}
+
+  /**
+   * @brief Get the photoionization cross sections for all ions and the dust
+   * opacity at the given photon energy.
+   *
+   * The default implementation calls get_cross_section() for every ion and
+   * get_dust_opacity(). Implementations that can compute all values at once
+   * should override this function.
+   *
+   * @param energy Photon frequency (in Hz).
+   * @param cross_sections Array to store the photoionization cross sections
+   * for all ions in (in m^2).
+   * @param dust_opacity Variable to store the dust opacity in.
+   */
+  virtual void get_cross_sections(const double energy,
+                                  double cross_sections[NUMBER_OF_IONNAMES],
+                                  double &dust_opacity) const {
+    for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+      cross_sections[ion] = get_cross_section(ion, energy);
+    }
+    dust_opacity = get_dust_opacity(energy);
+  }
 };
 
 #endif // CROSSSECTIONS_HPP
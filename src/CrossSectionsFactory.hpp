@@ -32,6 +32,7 @@
 // implementations
 #include "BimodalCrossSections.hpp"
 #include "FixedValueCrossSections.hpp"
+#include "TabulatedCrossSections.hpp"
 #include "VernerCrossSections.hpp"
 
 /**
@@ -52,6 +53,11 @@ public:
    *  - Verner: Implementation that uses the Verner & Yakovlev (1995) and Verner
    *    et al. (1996) cross sections.
    *
+   * If "CrossSections:tabulate" is set to true (default: false), the chosen
+   * implementation is wrapped in a TabulatedCrossSections object that replaces
+   * the evaluation of the cross sections by a linear interpolation on a
+   * precomputed frequency table.
+   *
    * @param params ParameterFile to read from.
    * @param log Log to write logging info to.
    * @return Pointer to a newly created CrossSections implementation. Memory
@@ -66,15 +72,21 @@ public:
       log->write_info("Requested CrossSections type: ", type);
     }
 
+    CrossSections *cross_sections = nullptr;
     if (type == "Bimodal") {
-      return new BiModalCrossSections(params);
+      cross_sections = new BiModalCrossSections(params);
     } else if (type == "FixedValue") {
-      return new FixedValueCrossSections(params);
+      cross_sections = new FixedValueCrossSections(params);
     } else if (type == "Verner") {
-      return new VernerCrossSections();
+      cross_sections = new VernerCrossSections();
     } else {
       cmac_error("Unknown CrossSections type: \"%s\"!", type.c_str());
       return nullptr;
     }
+
+    if (params.get_value< bool >("CrossSections:tabulate", false)) {
+      cross_sections = new TabulatedCrossSections(cross_sections, params, log);
+    }
+    return cross_sections;
   }
 };
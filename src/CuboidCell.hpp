@@ -0,0 +1,124 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file CuboidCell.hpp
+ *
+ * @brief Cell implementation for an axis aligned cuboid.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#ifndef CUBOIDCELL_HPP
+#define CUBOIDCELL_HPP
+
+#include "Cell.hpp"
+
+/**
+ * @brief Cell implementation for an axis aligned cuboid.
+ *
+ * The faces are constructed in the same way as for the CartesianDensityGrid,
+ * so that the vertices have the orientation expected by the Petkova et al.
+ * (2018) mapping.
+ */
+class CuboidCell : public Cell {
+private:
+  /*! @brief Lower front left corner of the cuboid (in m). */
+  const CoordinateVector<> _anchor;
+
+  /*! @brief Side lengths of the cuboid (in m). */
+  const CoordinateVector<> _sides;
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param anchor Lower front left corner of the cuboid (in m).
+   * @param sides Side lengths of the cuboid (in m).
+   */
+  inline CuboidCell(const CoordinateVector<> anchor,
+                    const CoordinateVector<> sides)
+      : _anchor(anchor), _sides(sides) {}
+
+  /**
+   * @brief Get the midpoint of the cell.
+   *
+   * @return Coordinates of the midpoint of the cell (in m).
+   */
+  virtual CoordinateVector<> get_cell_midpoint() const {
+    return _anchor + 0.5 * _sides;
+  }
+
+  /**
+   * @brief Get the volume of the cell.
+   *
+   * @return Volume of the cell (in m^3).
+   */
+  virtual double get_volume() const {
+    return _sides.x() * _sides.y() * _sides.z();
+  }
+
+  /**
+   * @brief Get the faces of the cell.
+   *
+   * @return Faces of the cell.
+   */
+  virtual std::vector< Face > get_faces() const {
+
+    const CoordinateVector<> low = _anchor;
+    const CoordinateVector<> high = _anchor + _sides;
+    const CoordinateVector<> mid = _anchor + 0.5 * _sides;
+
+    std::vector< Face > faces;
+    faces.reserve(6);
+    std::vector< CoordinateVector<> > vertices(4);
+
+    // negative and positive x face
+    for (uint_fast8_t i = 0; i < 2; ++i) {
+      const double x = (i == 0) ? low.x() : high.x();
+      vertices[0] = CoordinateVector<>(x, low.y(), low.z());
+      vertices[1] = CoordinateVector<>(x, high.y(), low.z());
+      vertices[2] = CoordinateVector<>(x, high.y(), high.z());
+      vertices[3] = CoordinateVector<>(x, low.y(), high.z());
+      faces.push_back(Face(CoordinateVector<>(x, mid.y(), mid.z()), vertices));
+    }
+
+    // negative and positive y face
+    for (uint_fast8_t i = 0; i < 2; ++i) {
+      const double y = (i == 0) ? low.y() : high.y();
+      vertices[0] = CoordinateVector<>(low.x(), y, low.z());
+      vertices[1] = CoordinateVector<>(high.x(), y, low.z());
+      vertices[2] = CoordinateVector<>(high.x(), y, high.z());
+      vertices[3] = CoordinateVector<>(low.x(), y, high.z());
+      faces.push_back(Face(CoordinateVector<>(mid.x(), y, mid.z()), vertices));
+    }
+
+    // negative and positive z face
+    for (uint_fast8_t i = 0; i < 2; ++i) {
+      const double z = (i == 0) ? low.z() : high.z();
+      vertices[0] = CoordinateVector<>(low.x(), low.y(), z);
+      vertices[1] = CoordinateVector<>(high.x(), low.y(), z);
+      vertices[2] = CoordinateVector<>(high.x(), high.y(), z);
+      vertices[3] = CoordinateVector<>(low.x(), high.y(), z);
+      faces.push_back(Face(CoordinateVector<>(mid.x(), mid.y(), z), vertices));
+    }
+
+    return faces;
+  }
+};
+
+#endif // CUBOIDCELL_HPP
@@ -29,6 +29,9 @@
 #include "Cell.hpp"
 #include "DensityValues.hpp"
 
+class DensityFunctionBlock;
+class SPHScatterMapping;
+
 /**
  * @brief Interface for functors that can be used to fill a DensityGrid.
  */
@@ -55,6 +58,22 @@ public:
    */
   virtual void free() {}
 
+  /**
+   * @brief Get the SPHScatterMapping that should be used to deposit the
+   * particles of a particle based density function onto a subgrid based grid.
+   *
+   * If this function returns a valid pointer, operator() only returns
+   * background values and does not compute the density. The density field then
+   * needs to be set by calling SPHScatterMapping::deposit() after the grid has
+   * been initialized.
+   *
+   * @return Pointer to the SPHScatterMapping, or a null pointer if the density
+   * function does not use a scatter mapping (default).
+   */
+  virtual const SPHScatterMapping *get_scatter_mapping() const {
+    return nullptr;
+  }
+
   /**
    * @brief Function that gives the density for a given cell.
    *
@@ -62,6 +81,23 @@ public:
    * @return Initial physical field values for that cell.
    */
   virtual DensityValues operator()(const Cell &cell) = 0;
+
+  /**
+   * @brief Initialize all cells in the given regular block of cells at once.
+   *
+   * Implementations can use this to avoid a virtual function call and a
+   * DensityValues copy per cell, and to exploit the regular structure of the
+   * block, e.g. by evaluating separable profiles once per row of cells. The
+   * result should be identical to calling operator() for every cell in the
+   * block and storing the result using DensityFunctionBlock::set_values().
+   *
+   * This routine does not need to be implemented by all implementations.
+   *
+   * @param block DensityFunctionBlock to initialize.
+   * @return True if the block was initialized, false if the caller needs to
+   * fall back to calling operator() for every cell (default).
+   */
+  virtual bool evaluate_block(DensityFunctionBlock &block) { return false; }
 };
 
 #endif // DENSITYFUNCTION_HPP
@@ -0,0 +1,195 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file DensityFunctionBlock.hpp
+ *
+ * @brief Geometry and cell arrays of a regular block of cells that can be
+ * initialized in one go by DensityFunction::evaluate_block().
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#ifndef DENSITYFUNCTIONBLOCK_HPP
+#define DENSITYFUNCTIONBLOCK_HPP
+
+#include "CoordinateVector.hpp"
+#include "DensityValues.hpp"
+#include "HydroVariables.hpp"
+#include "IonizationVariables.hpp"
+
+/**
+ * @brief Geometry and cell arrays of a regular block of cells that can be
+ * initialized in one go by DensityFunction::evaluate_block().
+ *
+ * The block consists of a regular Cartesian grid of cells with the given anchor
+ * and cell size. Cells are stored in the same order as in a DensitySubGrid:
+ * index = (ix * ny + iy) * nz + iz. The hydrodynamical variables are optional:
+ * if the block has no hydro variables, velocities are simply ignored.
+ */
+class DensityFunctionBlock {
+private:
+  /*! @brief Anchor of the block (in m). */
+  const CoordinateVector<> _anchor;
+
+  /*! @brief Side lengths of a single cell (in m). */
+  const CoordinateVector<> _cell_size;
+
+  /*! @brief Number of cells in each coordinate direction. */
+  const CoordinateVector< int_fast32_t > _number_of_cells;
+
+  /*! @brief Ionization variables of the cells in the block. */
+  IonizationVariables *_ionization_variables;
+
+  /*! @brief Hydrodynamical variables of the cells in the block (can be a null
+   *  pointer). */
+  HydroVariables *_hydro_variables;
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param anchor Anchor of the block (in m).
+   * @param cell_size Side lengths of a single cell (in m).
+   * @param number_of_cells Number of cells in each coordinate direction.
+   * @param ionization_variables Ionization variables of the cells in the block.
+   * @param hydro_variables Hydrodynamical variables of the cells in the block
+   * (can be a null pointer).
+   */
+  inline DensityFunctionBlock(
+      const CoordinateVector<> anchor, const CoordinateVector<> cell_size,
+      const CoordinateVector< int_fast32_t > number_of_cells,
+      IonizationVariables *ionization_variables,
+      HydroVariables *hydro_variables = nullptr)
+      : _anchor(anchor), _cell_size(cell_size),
+        _number_of_cells(number_of_cells),
+        _ionization_variables(ionization_variables),
+        _hydro_variables(hydro_variables) {}
+
+  /**
+   * @brief Get the number of cells in the given coordinate direction.
+   *
+   * @param direction Coordinate direction (0, 1 or 2).
+   * @return Number of cells in that direction.
+   */
+  inline int_fast32_t get_number_of_cells(const uint_fast8_t direction) const {
+    return _number_of_cells[direction];
+  }
+
+  /**
+   * @brief Get the total number of cells in the block.
+   *
+   * @return Total number of cells.
+   */
+  inline int_fast32_t get_total_number_of_cells() const {
+    return _number_of_cells[0] * _number_of_cells[1] * _number_of_cells[2];
+  }
+
+  /**
+   * @brief Get the index of the cell with the given three index.
+   *
+   * @param ix X index of the cell.
+   * @param iy Y index of the cell.
+   * @param iz Z index of the cell.
+   * @return Index of the cell in the cell arrays.
+   */
+  inline uint_fast32_t get_index(const int_fast32_t ix, const int_fast32_t iy,
+                                 const int_fast32_t iz) const {
+    return (ix * _number_of_cells[1] + iy) * _number_of_cells[2] + iz;
+  }
+
+  /**
+   * @brief Get the midpoint coordinate of the cell with the given index in the
+   * given coordinate direction.
+   *
+   * Since the block is a regular grid, the midpoint of a cell factorizes per
+   * coordinate direction, so that separable density functions can evaluate
+   * their profiles per row of cells.
+   *
+   * @param direction Coordinate direction (0, 1 or 2).
+   * @param index Index of the cell in that direction.
+   * @return Midpoint coordinate (in m).
+   */
+  inline double get_cell_midpoint(const uint_fast8_t direction,
+                                  const int_fast32_t index) const {
+    return _anchor[direction] + (index + 0.5) * _cell_size[direction];
+  }
+
+  /**
+   * @brief Get the midpoint of the cell with the given three index.
+   *
+   * @param ix X index of the cell.
+   * @param iy Y index of the cell.
+   * @param iz Z index of the cell.
+   * @return Midpoint of the cell (in m).
+   */
+  inline CoordinateVector<> get_cell_midpoint(const int_fast32_t ix,
+                                              const int_fast32_t iy,
+                                              const int_fast32_t iz) const {
+    return CoordinateVector<>(get_cell_midpoint(0, ix),
+                              get_cell_midpoint(1, iy),
+                              get_cell_midpoint(2, iz));
+  }
+
+  /**
+   * @brief Get the volume of a single cell.
+   *
+   * @return Cell volume (in m^3).
+   */
+  inline double get_cell_volume() const {
+    return _cell_size[0] * _cell_size[1] * _cell_size[2];
+  }
+
+  /**
+   * @brief Does the block store hydrodynamical variables?
+   *
+   * @return True if velocities are stored.
+   */
+  inline bool has_hydro() const { return _hydro_variables != nullptr; }
+
+  /**
+   * @brief Set the variables of the cell with the given index.
+   *
+   * This is the only place where DensityValues are converted into cell
+   * variables during grid initialization, so that the per cell fallback and
+   * DensityFunction::evaluate_block() implementations give identical results.
+   *
+   * @param index Index of the cell in the cell arrays.
+   * @param values DensityValues to use.
+   */
+  inline void set_values(const uint_fast32_t index,
+                         const DensityValues &values) {
+
+    IonizationVariables &ionization_variables = _ionization_variables[index];
+    const double number_density = values.get_number_density();
+    ionization_variables.set_number_density(number_density);
+    ionization_variables.set_dust_density(values.get_dust_gas_ratio() *
+                                          number_density * 1.67e-27);
+    // ionization_variables.set_fraction_silicon(
+    //     values.get_fraction_silicates());
+    for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+      ionization_variables.set_ionic_fraction(ion,
+                                              values.get_ionic_fraction(ion));
+    }
+    ionization_variables.set_temperature(values.get_temperature());
+    if (_hydro_variables != nullptr) {
+      _hydro_variables[index].set_primitives_velocity(values.get_velocity());
+    }
+  }
+};
+
+#endif // DENSITYFUNCTIONBLOCK_HPP
@@ -41,6 +41,11 @@ void DensityGrid::set_densities(std::pair< cellsize_t, cellsize_t > &block,
                                 DensityFunction &function,
                                 int_fast32_t worksize) {
 
+  if (function.get_scatter_mapping() != nullptr) {
+    cmac_error("The scatter mapping can only be used with a task-based "
+               "(subgrid) grid!");
+  }
+
   DensityGridInitializationFunction init(function, _has_hydro);
   WorkDistributor<
       DensityGridTraversalJobMarket< DensityGridInitializationFunction >,
@@ -60,3 +65,45 @@ void DensityGrid::set_densities(std::pair< cellsize_t, cellsize_t > &block,
     _log->write_status("Done initializing grid.");
   }
 }
+
+/**
+ * @brief Update the number densities of the cells in the grid, while keeping
+ * the temperatures, ionic fractions and other variables from a previous
+ * calculation.
+ *
+ * This can be used to warm start a new calculation for a density field that
+ * only changed slightly.
+ *
+ * @param block Continuous block of indices to update.
+ * @param function DensityFunction that sets the density.
+ * @param worksize Number of parallel threads to use. If a negative number is
+ * given, all available threads will be used.
+ */
+void DensityGrid::update_densities(std::pair< cellsize_t, cellsize_t > &block,
+                                   DensityFunction &function,
+                                   int_fast32_t worksize) {
+
+  if (function.get_scatter_mapping() != nullptr) {
+    cmac_error("The scatter mapping can only be used with a task-based "
+               "(subgrid) grid!");
+  }
+
+  DensityGridDensityUpdateFunction update(function);
+  WorkDistributor<
+      DensityGridTraversalJobMarket< DensityGridDensityUpdateFunction >,
+      DensityGridTraversalJob< DensityGridDensityUpdateFunction > >
+      workers(worksize);
+
+  if (_log) {
+    _log->write_status("Updating grid densities using ",
+                       workers.get_worksize_string(), ".");
+  }
+
+  DensityGridTraversalJobMarket< DensityGridDensityUpdateFunction > jobs(
+      *this, update, block);
+  workers.do_in_parallel(jobs);
+
+  if (_log) {
+    _log->write_status("Done updating grid densities.");
+  }
+}
@@ -790,9 +790,45 @@ public:
     }
   };
 
+  /**
+   * @brief Functor class used to update the number densities in the
+   * DensityGrid, without touching the other variables.
+   */
+  class DensityGridDensityUpdateFunction {
+  private:
+    /*! @brief DensityFunction that sets the density for each cell in the grid.
+     */
+    DensityFunction &_function;
+
+  public:
+    /**
+     * @brief Constructor.
+     *
+     * @param function DensityFunction that set the density for each cell in the
+     * grid.
+     */
+    DensityGridDensityUpdateFunction(DensityFunction &function)
+        : _function(function) {}
+
+    /**
+     * @brief Routine that updates the number density for a single cell in the
+     * grid.
+     *
+     * @param it DensityGrid::iterator pointing to a single cell in the grid.
+     */
+    inline void operator()(iterator it) {
+      DensityValues vals = _function(it);
+      it.get_ionization_variables().set_number_density(
+          vals.get_number_density());
+    }
+  };
+
   void set_densities(std::pair< cellsize_t, cellsize_t > &block,
                      DensityFunction &function, int_fast32_t worksize = -1);
 
+  void update_densities(std::pair< cellsize_t, cellsize_t > &block,
+                        DensityFunction &function, int_fast32_t worksize = -1);
+
   /**
    * @brief Reset the mean intensity counters and update the reemission
    * probabilities for all cells.
@@ -29,14 +29,19 @@
 
 // local includes
 #include "AtomicValue.hpp"
+#include "Box.hpp"
 #include "Cell.hpp"
+#include "CheckpointReader.hpp"
+#include "CheckpointWriter.hpp"
 #include "CoordinateVector.hpp"
+#include "DensityFunctionBlock.hpp"
 #include "Error.hpp"
 #include "HydroVariables.hpp"
 #include "IonizationVariables.hpp"
 #include "MPITypes.hpp"
 #include "OpenMP.hpp"
 #include "PhotonPacket.hpp"
+#include "PrivateIntensityBuffers.hpp"
 #include "RestartReader.hpp"
 #include "RestartWriter.hpp"
 #include "ThreadLock.hpp"
@@ -48,6 +53,7 @@
 #include <cmath>
 #include <iostream>
 #include <ostream>
+#include <vector>
 
 #ifdef HAVE_MPI
 #include <mpi.h>
@@ -58,6 +64,13 @@ class DensityValues;
 /*! @brief Special neighbour index marking a neighbour that does not exist. */
 #define NEIGHBOUR_OUTSIDE 0xffffffff
 
+/*! @brief Keep track of the number of photon packets that leave the subgrid in
+ *  each direction. This is needed for the distributed memory domain
+ *  decomposition. */
+#if defined(HAVE_MPI) && !defined(DENSITYGRID_EDGECOST)
+#define DENSITYGRID_EDGECOST
+#endif
+
 /*! @brief Enable this to activate cell locking. */
 //#define SUBGRID_CELL_LOCK
 
@@ -112,6 +125,10 @@ class DensityValues;
 #define subgrid_cell_lock_unlock(cell)
 #endif
 
+/*! @brief Number of photon packets that are traversed simultaneously by
+ *  DensitySubGrid::interact_batch() (one photon packet per SIMD lane). */
+#define DENSITYSUBGRID_BATCH_LANES 8
+
 /*! @brief Size of the DensitySubGrid variables that need to be communicated
  *  over MPI, and whose size is known at compile time. */
 #define DENSITYSUBGRID_FIXED_MPI_SIZE                                          \
@@ -186,6 +203,9 @@ protected:
   /*! @brief Size of the largest active buffer. */
   uint_least32_t _largest_buffer_size;
 
+  /*! @brief Does this subgrid contain cells with a Tracker? */
+  bool _has_trackers;
+
   /// PHOTOIONIZATION VARIABLES
 
   /*! @brief Ionization calculation variables. */
@@ -545,6 +565,82 @@ protected:
     }
   }
 
+  /**
+   * @brief Get the cell variables that determine the optical depth of the
+   * given cell.
+   *
+   * Variables that are not used in the current configuration are not set.
+   *
+   * @param active_cell Index of the cell.
+   * @param number_density Variable to store the number density in (in m^-3).
+   * @param neutral_fraction_H Variable to store the neutral fraction of
+   * hydrogen in.
+   * @param neutral_fraction_He Variable to store the neutral fraction of
+   * helium in.
+   * @param abundance_He Variable to store the helium abundance in.
+   * @param dust_density Variable to store the dust density in.
+   */
+  inline void get_absorption_variables(const int_fast32_t active_cell,
+                                       double &number_density,
+                                       double &neutral_fraction_H,
+                                       double &neutral_fraction_He,
+                                       double &abundance_He,
+                                       double &dust_density) const {
+
+    const IonizationVariables &vars = _ionization_variables[active_cell];
+    number_density = vars.get_number_density();
+    neutral_fraction_H = vars.get_ionic_fraction(ION_H_n);
+#ifdef HAS_HELIUM
+    neutral_fraction_He = vars.get_ionic_fraction(ION_He_n);
+#ifdef VARIABLE_ABUNDANCES
+    abundance_He = vars.get_abundances().get_abundance(ELEMENT_He);
+#endif
+#endif
+    dust_density = vars.get_dust_density();
+  }
+
+  /**
+   * @brief Compute the optical depth corresponding to the given distance
+   * through a cell with the given variables.
+   *
+   * This function is shared by interact() and interact_batch(), so that both
+   * produce exactly the same result.
+   *
+   * @param distance Distance travelled through the cell (in m).
+   * @param number_density Number density (in m^-3).
+   * @param sigma_H Photoionization cross section of hydrogen (in m^2).
+   * @param neutral_fraction_H Neutral fraction of hydrogen.
+   * @param sigma_He Photoionization cross section of helium (in m^2).
+   * @param neutral_fraction_He Neutral fraction of helium.
+   * @param abundance_He Helium abundance.
+   * @param dust_opacity Dust opacity.
+   * @param dust_density Dust density.
+   * @return Corresponding optical depth.
+   */
+  static inline double compute_optical_depth(
+      const double distance, const double number_density, const double sigma_H,
+      const double neutral_fraction_H, const double sigma_He,
+      const double neutral_fraction_He, const double abundance_He,
+      const double dust_opacity, const double dust_density) {
+
+    const double dust_contr = distance * dust_opacity * dust_density;
+#ifdef HAS_HELIUM
+#ifdef VARIABLE_ABUNDANCES
+    return distance * number_density *
+               (sigma_H * neutral_fraction_H +
+                abundance_He * sigma_He * neutral_fraction_He) +
+           dust_contr;
+#else
+    return distance * number_density *
+               (sigma_H * neutral_fraction_H + sigma_He * neutral_fraction_He) +
+           dust_contr;
+#endif
+#else
+    return distance * number_density * sigma_H * neutral_fraction_H +
+           dust_contr;
+#endif
+  }
+
   /**
    * @brief Get the optical depth corresponding to the given distance for the
    * given photon packet and cell.
@@ -558,72 +654,89 @@ protected:
                                   const double distance,
                                   const PhotonPacket &photon) const {
 
-
-
-    double dust_opacity = photon.get_dust_opacity();
- 
-
-    double dust_contr = distance
-              * dust_opacity * _ionization_variables[active_cell].get_dust_density();
-
-
-
-
-
-
+    double number_density = 0.;
+    double neutral_fraction_H = 0.;
+    double neutral_fraction_He = 0.;
+    double abundance_He = 0.;
+    double dust_density = 0.;
+    get_absorption_variables(active_cell, number_density, neutral_fraction_H,
+                             neutral_fraction_He, abundance_He, dust_density);
 #ifdef HAS_HELIUM
-#ifdef VARIABLE_ABUNDANCES
-    return distance * _ionization_variables[active_cell].get_number_density() *
-           (photon.get_photoionization_cross_section(ION_H_n) *
-                _ionization_variables[active_cell].get_ionic_fraction(ION_H_n) +
-            _ionization_variables[active_cell].get_abundances().get_abundance(
-                ELEMENT_He) *
-                photon.get_photoionization_cross_section(ION_He_n) *
-                _ionization_variables[active_cell].get_ionic_fraction(
-                    ION_He_n)) + dust_contr;
-#else
-    return distance * _ionization_variables[active_cell].get_number_density() *
-           (photon.get_photoionization_cross_section(ION_H_n) *
-                _ionization_variables[active_cell].get_ionic_fraction(ION_H_n) +
-            photon.get_photoionization_cross_section(ION_He_n) *
-                _ionization_variables[active_cell].get_ionic_fraction(
-                    ION_He_n)) + dust_contr;
-#endif
+    const double sigma_He = photon.get_photoionization_cross_section(ION_He_n);
 #else
-
-    return distance * _ionization_variables[active_cell].get_number_density() *
-           photon.get_photoionization_cross_section(ION_H_n) *
-           _ionization_variables[active_cell].get_ionic_fraction(ION_H_n) + dust_contr;
+    const double sigma_He = 0.;
 #endif
+    return compute_optical_depth(
+        distance, number_density,
+        photon.get_photoionization_cross_section(ION_H_n), neutral_fraction_H,
+        sigma_He, neutral_fraction_He, abundance_He, photon.get_dust_opacity(),
+        dust_density);
   }
 
   /**
    * @brief Update the intensity counters for the given cell with the
    * contribution due to the given photon packet travelling the given distance.
    *
+   * If thread private accumulators are given, the contributions are added to
+   * those instead of to the cell variables, and no cell locking is required.
+   *
    * @param active_cell Index of the cell.
    * @param distance Distance travelled through the cell (in m).
    * @param photon Photon packet that travels through the cell.
+   * @param accumulators Thread private accumulators for this subgrid (can be
+   * a nullptr).
    */
   inline void update_intensity_counters(const int_fast32_t active_cell,
                                         const double distance,
-                                        PhotonPacket &photon) {
-    subgrid_cell_lock_lock(active_cell);
+                                        PhotonPacket &photon,
+                                        double *accumulators) {
+
     double dmean_intensity[NUMBER_OF_IONNAMES];
     for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
       dmean_intensity[ion] = distance *
                              photon.get_photoionization_cross_section(ion) *
                              photon.get_weight();
+    }
+    const double dheating_H =
+        dmean_intensity[ION_H_n] * (photon.get_energy() - 3.288e15);
+#ifdef HAS_HELIUM
+    const double dheating_He =
+        dmean_intensity[ION_He_n] * (photon.get_energy() - 5.948e15);
+#endif
+
+    if (accumulators != nullptr) {
+      double *cell_accumulators =
+          &accumulators[active_cell * PRIVATEINTENSITYBUFFERS_ACCUMULATOR_SIZE];
+      for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+        cell_accumulators[ion] += dmean_intensity[ion];
+      }
+      cell_accumulators[NUMBER_OF_IONNAMES + HEATINGTERM_H] += dheating_H;
+#ifdef HAS_HELIUM
+      cell_accumulators[NUMBER_OF_IONNAMES + HEATINGTERM_He] += dheating_He;
+#endif
+
+      Tracker *tracker = _ionization_variables[active_cell].get_tracker();
+      if (tracker != nullptr) {
+        // traversal tasks for subgrids with trackers own the subgrid (see
+        // get_traversal_dependency()), so no other thread can use the tracker
+        cmac_assert(_has_trackers);
+        tracker->count_photon(photon, dmean_intensity);
+      }
+
+      photon.add_distance_travelled(distance);
+      return;
+    }
+
+    subgrid_cell_lock_lock(active_cell);
+    for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
       _ionization_variables[active_cell].increase_mean_intensity(
           ion, dmean_intensity[ion]);
     }
-    _ionization_variables[active_cell].increase_heating(
-        HEATINGTERM_H,
-        dmean_intensity[ION_H_n] * (photon.get_energy() - 3.288e15));
+    _ionization_variables[active_cell].increase_heating(HEATINGTERM_H,
+                                                        dheating_H);
 #ifdef HAS_HELIUM
-    _ionization_variables[active_cell].increase_heating(
-        HEATINGTERM_He,
-        dmean_intensity[ION_He_n] * (photon.get_energy() - 5.948e15));
+    _ionization_variables[active_cell].increase_heating(HEATINGTERM_He,
+                                                        dheating_He);
 #endif
 
     Tracker *tracker = _ionization_variables[active_cell].get_tracker();
@@ -758,7 +871,7 @@ public:
         _inv_cell_size{ncell[0] / box[3], ncell[1] / box[4], ncell[2] / box[5]},
         _number_of_cells{ncell[0], ncell[1], ncell[2], ncell[1] * ncell[2]},
         _owning_thread(0), _largest_buffer_index(TRAVELDIRECTION_NUMBER),
-        _largest_buffer_size(0) {
+        _largest_buffer_size(0), _has_trackers(false) {
 
 #ifdef DENSITYGRID_EDGECOST
     // initialize edge communication costs
@@ -786,7 +899,8 @@ public:
             original._number_of_cells[0], original._number_of_cells[1],
             original._number_of_cells[2], original._number_of_cells[3]},
         _owning_thread(original._owning_thread),
-        _largest_buffer_index(TRAVELDIRECTION_NUMBER), _largest_buffer_size(0) {
+        _largest_buffer_index(TRAVELDIRECTION_NUMBER), _largest_buffer_size(0),
+        _has_trackers(false) {
 
 #ifdef DENSITYGRID_EDGECOST
     // initialize edge communication costs
@@ -823,6 +937,18 @@ public:
     return _number_of_cells[0] * _number_of_cells[3];
   }
 
+  /**
+   * @brief Get the box that contains the subgrid.
+   *
+   * @return Box that contains the subgrid (in m).
+   */
+  inline Box<> get_box() const {
+    return Box<>(_anchor, CoordinateVector<>(
+                              _number_of_cells[0] * _cell_size.x(),
+                              _number_of_cells[1] * _cell_size.y(),
+                              _number_of_cells[2] * _cell_size.z()));
+  }
+
   /**
    * @brief Get the midpoint of the subgrid box for domain decomposition
    * plotting.
@@ -873,7 +999,12 @@ public:
    */
   inline void add_communication_cost(const int_fast32_t direction,
                                      const uint_fast32_t cost) {
+#ifdef USE_PRIVATE_INTENSITY_BUFFERS
+    // multiple traversal tasks can run on this subgrid at the same time
+    __sync_fetch_and_add(&_communication_cost[direction], cost);
+#else
     _communication_cost[direction] += cost;
+#endif
   }
 
   /**
@@ -997,15 +1128,13 @@ public:
     MPI_Pack(_ngbs, TRAVELDIRECTION_NUMBER, MPI_UINT_LEAST32_T, buffer,
              buffer_size, &buffer_position, MPI_COMM_WORLD);
 
+    // the cell variables are communicated as raw bytes, since all processes
+    // run the same executable
     const int_fast32_t tot_num_cells =
         _number_of_cells[0] * _number_of_cells[3];
-    for (int_fast32_t i = 0; i < tot_num_cells; ++i) {
-      double vals[3] = {_ionization_variables[i].get_number_density(),
-                        _ionization_variables[i].get_ionic_fraction(ION_H_n),
-                        _ionization_variables[i].get_mean_intensity(ION_H_n)};
-      MPI_Pack(vals, 3, MPI_DOUBLE, buffer, buffer_size, &buffer_position,
-               MPI_COMM_WORLD);
-    }
+    MPI_Pack(_ionization_variables,
+             tot_num_cells * sizeof(IonizationVariables), MPI_BYTE, buffer,
+             buffer_size, &buffer_position, MPI_COMM_WORLD);
   }
 
   /**
@@ -1057,13 +1186,12 @@ public:
       delete[] _ionization_variables;
       _ionization_variables = new IonizationVariables[tot_num_cells];
     }
+    MPI_Unpack(buffer, buffer_size, &buffer_position, _ionization_variables,
+               tot_num_cells * sizeof(IonizationVariables), MPI_BYTE,
+               MPI_COMM_WORLD);
+    // trackers are process local and cannot be communicated
     for (int_fast32_t i = 0; i < tot_num_cells; ++i) {
-      double vals[3];
-      MPI_Unpack(buffer, buffer_size, &buffer_position, vals, 3, MPI_DOUBLE,
-                 MPI_COMM_WORLD);
-      _ionization_variables[i].set_number_density(vals[0]);
-      _ionization_variables[i].set_ionic_fraction(ION_H_n, vals[1]);
-      _ionization_variables[i].set_mean_intensity(ION_H_n, vals[2]);
+      _ionization_variables[i].add_tracker(nullptr);
     }
   }
 #endif
@@ -1117,6 +1245,29 @@ public:
     }
   }
 
+  /**
+   * @brief Add the given accumulated intensity integrals to the intensity
+   * counters of the cells.
+   *
+   * @param accumulators Accumulated intensity integrals, in the per cell
+   * layout used by PrivateIntensityBuffers.
+   */
+  inline void add_intensities(const double *accumulators) {
+    const int_fast32_t tot_ncell = _number_of_cells[3] * _number_of_cells[0];
+    for (int_fast32_t i = 0; i < tot_ncell; ++i) {
+      const double *cell_accumulators =
+          &accumulators[i * PRIVATEINTENSITYBUFFERS_ACCUMULATOR_SIZE];
+      for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+        _ionization_variables[i].increase_mean_intensity(
+            ion, cell_accumulators[ion]);
+      }
+      for (int_fast32_t term = 0; term < NUMBER_OF_HEATINGTERMS; ++term) {
+        _ionization_variables[i].increase_heating(
+            term, cell_accumulators[NUMBER_OF_IONNAMES + term]);
+      }
+    }
+  }
+
   /**
    * @brief Get the box containing the sub grid.
    *
@@ -1150,12 +1301,22 @@ public:
   /**
    * @brief Let the given Photon travel through the density grid.
    *
+   * If thread private accumulators are given, the intensity integrals are
+   * added to those, and other threads can traverse the same subgrid at the
+   * same time. The caller should then not hold the subgrid dependency lock.
+   *
    * @param photon Photon.
    * @param input_direction Direction from which the photon enters the grid.
+   * @param max_photon_distance Maximum distance a photon packet can travel
+   * before it is stopped (in m; only used if positive).
+   * @param accumulators Thread private accumulators for this subgrid (see
+   * PrivateIntensityBuffers; default: nullptr, use the cell variables).
    * @return TravelDirection of the photon after it has traversed this grid.
    */
   inline int_fast32_t interact(PhotonPacket &photon,
-                               const int_fast32_t input_direction, const double max_photon_distance) {
+                               const int_fast32_t input_direction,
+                               const double max_photon_distance,
+                               double *accumulators = nullptr) {
 
     cmac_assert_message(input_direction >= 0 &&
                             input_direction < TRAVELDIRECTION_NUMBER,
@@ -1259,7 +1420,7 @@ public:
         }
       }
       // add the pathlength to the intensity counter
-      update_intensity_counters(active_cell, lmin, photon);
+      update_intensity_counters(active_cell, lmin, photon, accumulators);
       if (max_photon_distance > 0 && photon.get_distance_travelled() >= max_photon_distance){
         return TRAVELDIRECTION_INSIDE;
       }
@@ -1296,6 +1457,319 @@ public:
     return output_direction;
   }
 
+  /**
+   * @brief Scratch space used by interact_batch() to record the path of every
+   * photon packet in a batch.
+   *
+   * Every thread that calls interact_batch() needs its own path buffer.
+   */
+  class PathBuffer {
+  private:
+    /*! @brief Maximum number of path segments per photon packet. */
+    uint_fast32_t _max_number_of_segments;
+
+    /*! @brief Number of path segments for every photon packet in the batch. */
+    uint_fast32_t _number_of_segments[DENSITYSUBGRID_BATCH_LANES];
+
+    /*! @brief Cell indices of the path segments. */
+    std::vector< int_fast32_t > _cells;
+
+    /*! @brief Lengths of the path segments (in m). */
+    std::vector< double > _lengths;
+
+    friend class DensitySubGrid;
+
+  public:
+    /**
+     * @brief Empty constructor.
+     */
+    inline PathBuffer() : _max_number_of_segments(0) {}
+  };
+
+  /**
+   * @brief Let the given photon packets travel through the density grid.
+   *
+   * The photon packets are traversed in batches of DENSITYSUBGRID_BATCH_LANES
+   * packets. The packets in a batch step through their cells simultaneously:
+   * the distances to the cell boundaries, the optical depths and the new
+   * positions are computed for all packets in a single loop without branches
+   * that the compiler can vectorize for the available SIMD instruction set (or
+   * compile into scalar code if no suitable instruction set is available).
+   * Packets that terminate are masked out until all packets in the batch are
+   * done.
+   *
+   * The path segments of every packet are recorded in the given path buffer.
+   * The intensity counters are only updated after the batch is done,
+   * serially and in the same order as interact() would update them, so that
+   * the result is bitwise identical to calling interact() for every packet
+   * (provided that the compiler does not contract floating point operations
+   * into fused multiply-adds differently in both functions, e.g. when compiled
+   * with -ffp-contract=off).
+   *
+   * @param photons Photon packets.
+   * @param number_of_photons Number of photon packets.
+   * @param input_direction Direction from which the photon packets enter the
+   * grid.
+   * @param max_photon_distance Maximum distance a photon packet can travel
+   * before it is stopped (in m; only used if positive).
+   * @param output_directions Array to store the TravelDirection of every photon
+   * packet after it has traversed this grid in.
+   * @param path_buffer Thread private scratch space.
+   * @param accumulators Thread private accumulators for this subgrid (see
+   * PrivateIntensityBuffers; default: nullptr, use the cell variables).
+   */
+  inline void interact_batch(PhotonPacket *photons,
+                             const uint_fast32_t number_of_photons,
+                             const int_fast32_t input_direction,
+                             const double max_photon_distance,
+                             int_fast32_t *output_directions,
+                             PathBuffer &path_buffer,
+                             double *accumulators = nullptr) {
+
+    cmac_assert_message(input_direction >= 0 &&
+                            input_direction < TRAVELDIRECTION_NUMBER,
+                        "input_direction: %" PRIiFAST32, input_direction);
+
+    // every step moves a photon packet into the next cell in at least one
+    // dimension, so that a packet cannot cross more cells than this
+    const uint_fast32_t max_number_of_segments =
+        _number_of_cells[0] + _number_of_cells[1] + _number_of_cells[2];
+    if (path_buffer._max_number_of_segments < max_number_of_segments) {
+      path_buffer._max_number_of_segments = max_number_of_segments;
+      path_buffer._cells.resize(DENSITYSUBGRID_BATCH_LANES *
+                                max_number_of_segments);
+      path_buffer._lengths.resize(DENSITYSUBGRID_BATCH_LANES *
+                                  max_number_of_segments);
+    }
+    const uint_fast32_t segment_stride = path_buffer._max_number_of_segments;
+    uint_fast32_t *number_of_segments = path_buffer._number_of_segments;
+    int_fast32_t *path_cells = path_buffer._cells.data();
+    double *path_lengths = path_buffer._lengths.data();
+
+    for (uint_fast32_t ifirst = 0; ifirst < number_of_photons;
+         ifirst += DENSITYSUBGRID_BATCH_LANES) {
+
+      PhotonPacket *batch = photons + ifirst;
+      const uint_fast32_t number_of_lanes =
+          std::min(number_of_photons - ifirst,
+                   static_cast< uint_fast32_t >(DENSITYSUBGRID_BATCH_LANES));
+
+      // lane variables (positions are relative w.r.t. _anchor!)
+      double position[3][DENSITYSUBGRID_BATCH_LANES];
+      double direction[3][DENSITYSUBGRID_BATCH_LANES];
+      double inverse_direction[3][DENSITYSUBGRID_BATCH_LANES];
+      int_fast32_t three_index[3][DENSITYSUBGRID_BATCH_LANES];
+      // floating point copy of three_index, used in the vectorized loop
+      double cell_index[3][DENSITYSUBGRID_BATCH_LANES];
+      int_fast32_t active_cell[DENSITYSUBGRID_BATCH_LANES];
+      double tau_done[DENSITYSUBGRID_BATCH_LANES];
+      double tau_target[DENSITYSUBGRID_BATCH_LANES];
+      double distance_travelled[DENSITYSUBGRID_BATCH_LANES];
+      double sigma_H[DENSITYSUBGRID_BATCH_LANES];
+      double sigma_He[DENSITYSUBGRID_BATCH_LANES];
+      double dust_opacity[DENSITYSUBGRID_BATCH_LANES];
+      // lane masks: is the packet still traversing the grid, and was it
+      // stopped because it reached the maximum distance?
+      int_fast32_t active[DENSITYSUBGRID_BATCH_LANES];
+      int_fast32_t stopped[DENSITYSUBGRID_BATCH_LANES];
+
+      for (uint_fast32_t lane = 0; lane < DENSITYSUBGRID_BATCH_LANES; ++lane) {
+        number_of_segments[lane] = 0;
+        stopped[lane] = 0;
+        if (lane < number_of_lanes) {
+          const PhotonPacket &photon = batch[lane];
+          const CoordinateVector<> photon_direction = photon.get_direction();
+
+          cmac_assert_message(
+              TravelDirections::is_compatible_input_direction(photon_direction,
+                                                              input_direction),
+              "direction: %g %g %g, input_direction: %" PRIiFAST32,
+              photon_direction[0], photon_direction[1], photon_direction[2],
+              input_direction);
+
+          const CoordinateVector<> photon_inverse_direction =
+              1. / photon_direction;
+          CoordinateVector<> photon_position = photon.get_position() - _anchor;
+          update_photon_position(input_direction, photon_position);
+          CoordinateVector< int_fast32_t > photon_three_index;
+          active_cell[lane] = get_start_index(photon_position, input_direction,
+                                              photon_three_index);
+          for (uint_fast8_t idim = 0; idim < 3; ++idim) {
+            position[idim][lane] = photon_position[idim];
+            direction[idim][lane] = photon_direction[idim];
+            inverse_direction[idim][lane] = photon_inverse_direction[idim];
+            three_index[idim][lane] = photon_three_index[idim];
+            cell_index[idim][lane] = photon_three_index[idim];
+          }
+          tau_done[lane] = 0.;
+          tau_target[lane] = photon.get_target_optical_depth();
+          distance_travelled[lane] = photon.get_distance_travelled();
+          sigma_H[lane] = photon.get_photoionization_cross_section(ION_H_n);
+#ifdef HAS_HELIUM
+          sigma_He[lane] = photon.get_photoionization_cross_section(ION_He_n);
+#else
+          sigma_He[lane] = 0.;
+#endif
+          dust_opacity[lane] = photon.get_dust_opacity();
+          active[lane] = 1;
+        } else {
+          // unused lane: give it valid values and mask it out
+          for (uint_fast8_t idim = 0; idim < 3; ++idim) {
+            position[idim][lane] = 0.;
+            direction[idim][lane] = 1.;
+            inverse_direction[idim][lane] = 1.;
+            three_index[idim][lane] = 0;
+            cell_index[idim][lane] = 0.;
+          }
+          active_cell[lane] = 0;
+          tau_done[lane] = 0.;
+          tau_target[lane] = 0.;
+          distance_travelled[lane] = 0.;
+          sigma_H[lane] = 0.;
+          sigma_He[lane] = 0.;
+          dust_opacity[lane] = 0.;
+          active[lane] = 0;
+        }
+      }
+
+      uint_fast32_t number_active = number_of_lanes;
+      while (number_active > 0) {
+
+        double segment_length[DENSITYSUBGRID_BATCH_LANES];
+
+        // SIMD part: take one step for all packets in the batch
+        // the operations below are exactly the same as in interact(), but all
+        // conditionals are replaced with selections between values that are
+        // always computed, so that the compiler can vectorize the loop
+        for (uint_fast32_t lane = 0; lane < DENSITYSUBGRID_BATCH_LANES;
+             ++lane) {
+
+          double old_position[3], old_cell_index[3];
+          double cell_low[3], cell_high[3], l[3];
+          for (uint_fast8_t idim = 0; idim < 3; ++idim) {
+            old_position[idim] = position[idim][lane];
+            old_cell_index[idim] = cell_index[idim][lane];
+            cell_low[idim] = old_cell_index[idim] * _cell_size[idim];
+            cell_high[idim] = (old_cell_index[idim] + 1.) * _cell_size[idim];
+            const double l_high = (cell_high[idim] - old_position[idim]) *
+                                  inverse_direction[idim][lane];
+            const double l_low = (cell_low[idim] - old_position[idim]) *
+                                 inverse_direction[idim][lane];
+            const double l_zero =
+                (direction[idim][lane] < 0.) ? l_low : DBL_MAX;
+            l[idim] = (direction[idim][lane] > 0.) ? l_high : l_zero;
+          }
+          const double lmin = std::min(l[0], std::min(l[1], l[2]));
+
+          double number_density = 0.;
+          double neutral_fraction_H = 0.;
+          double neutral_fraction_He = 0.;
+          double abundance_He = 0.;
+          double dust_density = 0.;
+          get_absorption_variables(active_cell[lane], number_density,
+                                   neutral_fraction_H, neutral_fraction_He,
+                                   abundance_He, dust_density);
+          const double tau = compute_optical_depth(
+              lmin, number_density, sigma_H[lane], neutral_fraction_H,
+              sigma_He[lane], neutral_fraction_He, abundance_He,
+              dust_opacity[lane], dust_density);
+          const double new_tau_done = tau_done[lane] + tau;
+          const bool reached = new_tau_done >= tau_target[lane];
+          const double correction = (new_tau_done - tau_target[lane]) / tau;
+          const double length = reached ? lmin * (1. - correction) : lmin;
+          const double new_distance_travelled =
+              distance_travelled[lane] + length;
+          const bool stop = (max_photon_distance > 0) &
+                            (new_distance_travelled >= max_photon_distance);
+
+          const bool is_active = (active[lane] != 0);
+          const bool move = is_active & !stop;
+          segment_length[lane] = length;
+          tau_done[lane] = is_active ? new_tau_done : tau_done[lane];
+          distance_travelled[lane] =
+              is_active ? new_distance_travelled : distance_travelled[lane];
+          for (uint_fast8_t idim = 0; idim < 3; ++idim) {
+            const double boundary =
+                (direction[idim][lane] > 0.) ? cell_high[idim] : cell_low[idim];
+            const double moved_position =
+                old_position[idim] + length * direction[idim][lane];
+            const double new_position =
+                (l[idim] == length) ? boundary : moved_position;
+            position[idim][lane] = move ? new_position : old_position[idim];
+            const double step = (direction[idim][lane] > 0.) ? 1. : -1.;
+            const double new_cell_index = old_cell_index[idim] + step;
+            const bool crosses = move & !reached & (l[idim] == lmin);
+            cell_index[idim][lane] =
+                crosses ? new_cell_index : old_cell_index[idim];
+          }
+        }
+
+        // serial part: record the path segments and retire finished packets
+        for (uint_fast32_t lane = 0; lane < number_of_lanes; ++lane) {
+          if (active[lane]) {
+            for (uint_fast8_t idim = 0; idim < 3; ++idim) {
+              three_index[idim][lane] =
+                  static_cast< int_fast32_t >(cell_index[idim][lane]);
+            }
+            cmac_assert(number_of_segments[lane] < segment_stride);
+            const uint_fast32_t index =
+                lane * segment_stride + number_of_segments[lane];
+            path_cells[index] = active_cell[lane];
+            path_lengths[index] = segment_length[lane];
+            ++number_of_segments[lane];
+            // a packet that reached the maximum distance does not move
+            stopped[lane] = max_photon_distance > 0 &&
+                            distance_travelled[lane] >= max_photon_distance;
+            if (stopped[lane] || tau_done[lane] >= tau_target[lane] ||
+                !is_inside(CoordinateVector< int_fast32_t >(
+                    three_index[0][lane], three_index[1][lane],
+                    three_index[2][lane]))) {
+              active[lane] = 0;
+              active_cell[lane] = 0;
+              --number_active;
+            } else {
+              active_cell[lane] = three_index[0][lane] * _number_of_cells[3] +
+                                  three_index[1][lane] * _number_of_cells[2] +
+                                  three_index[2][lane];
+            }
+          }
+        }
+      }
+
+      // update the intensity counters and the photon packets, one packet at a
+      // time
+      for (uint_fast32_t lane = 0; lane < number_of_lanes; ++lane) {
+        PhotonPacket &photon = batch[lane];
+        for (uint_fast32_t iseg = 0; iseg < number_of_segments[lane]; ++iseg) {
+          const uint_fast32_t index = lane * segment_stride + iseg;
+          update_intensity_counters(path_cells[index], path_lengths[index],
+                                    photon, accumulators);
+        }
+        if (stopped[lane]) {
+          output_directions[ifirst + lane] = TRAVELDIRECTION_INSIDE;
+          continue;
+        }
+        photon.set_target_optical_depth(tau_target[lane] - tau_done[lane]);
+        const CoordinateVector<> photon_position(
+            position[0][lane], position[1][lane], position[2][lane]);
+        photon.set_position(photon_position + _anchor);
+        if (tau_done[lane] >= tau_target[lane]) {
+          output_directions[ifirst + lane] = TRAVELDIRECTION_INSIDE;
+        } else {
+          output_directions[ifirst + lane] =
+              get_output_direction(CoordinateVector< int_fast32_t >(
+                  three_index[0][lane], three_index[1][lane],
+                  three_index[2][lane]));
+        }
+
+        cmac_assert_message(
+            TravelDirections::is_compatible_output_direction(
+                photon.get_direction(), output_directions[ifirst + lane]),
+            "wrong output direction!");
+      }
+    }
+  }
+
   /**
    * @brief Let the given Photon travel through the density grid without
    * interacting with the grid.
@@ -1637,7 +2111,12 @@ public:
    * @param computational_cost Amount to add.
    */
   inline void add_computational_cost(const uint_fast64_t computational_cost) {
+#ifdef USE_PRIVATE_INTENSITY_BUFFERS
+    // multiple traversal tasks can run on this subgrid at the same time
+    __sync_fetch_and_add(&_computational_cost, computational_cost);
+#else
     _computational_cost += computational_cost;
+#endif
   }
 
   /**
@@ -1661,6 +2140,33 @@ public:
    */
   inline ThreadLock *get_dependency() { return &_dependency; }
 
+  /**
+   * @brief Get the dependency that photon traversal tasks for this subgrid
+   * need to lock.
+   *
+   * If intensities are accumulated in thread private buffers
+   * (USE_PRIVATE_INTENSITY_BUFFERS), multiple threads can traverse the same
+   * subgrid at the same time. Subgrids that contain a Tracker are the
+   * exception: trackers are not thread safe and are only updated by traversal
+   * tasks that own the subgrid.
+   *
+   * @return Pointer to the traversal dependency lock (nullptr if traversal
+   * tasks do not have a dependency).
+   */
+  inline ThreadLock *get_traversal_dependency() {
+#ifdef USE_PRIVATE_INTENSITY_BUFFERS
+    if (!_has_trackers) {
+      return nullptr;
+    }
+#endif
+    return &_dependency;
+  }
+
+  /**
+   * @brief Flag this subgrid as containing cells with a Tracker.
+   */
+  inline void set_has_trackers() { _has_trackers = true; }
+
   /**
    * @brief Get the id of the thread that owns this subgrid.
    *
@@ -1760,6 +2266,20 @@ public:
   virtual void initialize_hydro(const uint_fast32_t index,
                                 const DensityValues &values) {}
 
+  /**
+   * @brief Get a DensityFunctionBlock that can be used to initialize all cells
+   * in this subgrid at once.
+   *
+   * @return DensityFunctionBlock that wraps the cell arrays of this subgrid.
+   */
+  virtual DensityFunctionBlock get_density_function_block() {
+    return DensityFunctionBlock(
+        _anchor, _cell_size,
+        CoordinateVector< int_fast32_t >(
+            _number_of_cells[0], _number_of_cells[1], _number_of_cells[2]),
+        _ionization_variables);
+  }
+
   /**
    * @brief Iterator to loop over the cells in the subgrid.
    */
@@ -1944,9 +2464,18 @@ public:
   /**
    * @brief Dump the subgrid to the given restart file.
    *
+   * If a CheckpointWriter is given, only the subgrid properties are written
+   * to the restart file, while the cell arrays are registered as raw blocks
+   * with the CheckpointWriter. They are then read back using
+   * read_checkpoint().
+   *
    * @param restart_writer RestartWriter to write to.
+   * @param checkpoint_writer CheckpointWriter to register the cell arrays
+   * with (optional).
    */
-  virtual void write_restart_file(RestartWriter &restart_writer) const {
+  virtual void
+  write_restart_file(RestartWriter &restart_writer,
+                     CheckpointWriter *checkpoint_writer = nullptr) const {
 
     for (int_fast8_t i = 0; i < TRAVELDIRECTION_NUMBER; ++i) {
       restart_writer.write(_ngbs[i]);
@@ -1959,8 +2488,35 @@ public:
     restart_writer.write(_owning_thread);
     const int_fast32_t number_of_cells =
         _number_of_cells[0] * _number_of_cells[1] * _number_of_cells[2];
+    if (checkpoint_writer != nullptr) {
+      checkpoint_writer->add_block(_ionization_variables, number_of_cells,
+                                   sizeof(IonizationVariables));
+    } else {
+      for (int_fast32_t i = 0; i < number_of_cells; ++i) {
+        _ionization_variables[i].write_restart_file(restart_writer);
+      }
+    }
+  }
+
+  /**
+   * @brief Read the cell arrays from the given checkpoint file.
+   *
+   * The subgrid needs to be constructed from a restart file without cell
+   * data. Different subgrids can be read in parallel.
+   *
+   * @param checkpoint_reader CheckpointReader to read from.
+   * @param first_block Index of the first block that belongs to this subgrid.
+   */
+  virtual void read_checkpoint(const CheckpointReader &checkpoint_reader,
+                               const size_t first_block) {
+
+    const int_fast32_t number_of_cells =
+        _number_of_cells[0] * _number_of_cells[1] * _number_of_cells[2];
+    checkpoint_reader.read_block(first_block, _ionization_variables,
+                                 number_of_cells);
+    // trackers are not part of the restart
     for (int_fast32_t i = 0; i < number_of_cells; ++i) {
-      _ionization_variables[i].write_restart_file(restart_writer);
+      _ionization_variables[i].add_tracker(nullptr);
     }
   }
 
@@ -1968,8 +2524,11 @@ public:
    * @brief Restart constructor.
    *
    * @param restart_reader Restart file to read from.
+   * @param read_cells Read the cell data from the restart file? If false, the
+   * cell data need to be read from a checkpoint file using read_checkpoint().
    */
-  inline DensitySubGrid(RestartReader &restart_reader) {
+  inline DensitySubGrid(RestartReader &restart_reader,
+                        const bool read_cells = true) {
 
     for (int_fast8_t i = 0; i < TRAVELDIRECTION_NUMBER; ++i) {
       _ngbs[i] = restart_reader.read< uint_least32_t >();
@@ -1987,11 +2546,14 @@ public:
     _owning_thread = restart_reader.read< int_least32_t >();
     _largest_buffer_index = TRAVELDIRECTION_NUMBER;
     _largest_buffer_size = 0;
+    _has_trackers = false;
     const int_fast32_t number_of_cells =
         _number_of_cells[0] * _number_of_cells[1] * _number_of_cells[2];
     _ionization_variables = new IonizationVariables[number_of_cells];
-    for (int_fast32_t i = 0; i < number_of_cells; ++i) {
-      _ionization_variables[i] = IonizationVariables(restart_reader);
+    if (read_cells) {
+      for (int_fast32_t i = 0; i < number_of_cells; ++i) {
+        _ionization_variables[i] = IonizationVariables(restart_reader);
+      }
     }
   }
 };
@@ -30,14 +30,27 @@
 #include "Box.hpp"
 #include "DensityFunction.hpp"
 #include "DensitySubGrid.hpp"
+#include "DomainDecomposition.hpp"
 #include "Error.hpp"
 #include "OpenMP.hpp"
 #include "ParameterFile.hpp"
 #include "HydroDensitySubGrid.hpp"
+#include "PrivateIntensityBuffers.hpp"
 
+#include <algorithm>
 #include <cinttypes>
-#include <vector>
 #include <cmath>
+#include <functional>
+#include <queue>
+#include <tuple>
+#include <vector>
+
+#ifdef HAVE_MPI
+#include <mpi.h>
+#endif
+
+/*! @brief MPI tag used to communicate subgrids. */
+#define DENSITYSUBGRIDCREATOR_SUBGRID_TAG 301
 
 /**
  * @brief Class responsible for creating DensitySubGrid instances that make up
@@ -54,6 +67,11 @@ private:
   /*! @brief Indices of the first copy of each subgrid. */
   std::vector< size_t > _copies;
 
+#ifdef USE_NUMA
+  /*! @brief Number of copies of each subgrid (excluding the original). */
+  std::vector< uint_fast32_t > _number_of_copies;
+#endif
+
   /*! @brief Dimensions of the simulation box (in m). */
   const Box<> _box;
 
@@ -70,6 +88,190 @@ private:
   /*! @brief Periodicity flags. */
   const CoordinateVector< bool > _periodicity;
 
+  /*! @brief Rank of the process that owns each original subgrid (empty if all
+   *  subgrids are owned by the local process). */
+  std::vector< int_fast32_t > _domains;
+
+  /*! @brief Rank of the local process. */
+  int_fast32_t _rank;
+
+#ifdef USE_PRIVATE_INTENSITY_BUFFERS
+  /*! @brief Thread private intensity buffers for the original subgrids. */
+  PrivateIntensityBuffers *_intensity_buffers;
+#endif
+
+  /**
+   * @brief Set the neighbours of all subgrid copies.
+   *
+   * This assumes that the copies of each original subgrid are stored
+   * contiguously and that _copies contains the index of the first copy of each
+   * original subgrid.
+   *
+   * @param copy_levels Copy level for each original subgrid.
+   */
+  inline void
+  set_copy_neighbours(const std::vector< uint_fast8_t > &copy_levels) {
+
+    const int_fast32_t number_of_unique_subgrids =
+        number_of_original_subgrids();
+    for (int_fast32_t i = 0; i < number_of_unique_subgrids; ++i) {
+      const uint_fast8_t level = copy_levels[i];
+      const uint_fast32_t number_of_copies = 1 << level;
+      if (number_of_copies == 1) {
+        // no copies, nothing to do (the original might not be local)
+        continue;
+      }
+      // first do the self-reference for each copy (if there are copies)
+      for (uint_fast32_t j = 1; j < number_of_copies; ++j) {
+        const uint_fast32_t copy = _copies[i] + j - 1;
+        _subgrids[copy]->set_neighbour(0, copy);
+      }
+      // now do the actual neighbours
+      for (int_fast32_t j = 1; j < TRAVELDIRECTION_NUMBER; ++j) {
+        const uint_fast32_t original_ngb = _subgrids[i]->get_neighbour(j);
+        if (original_ngb != NEIGHBOUR_OUTSIDE) {
+          const uint_fast8_t ngb_level = copy_levels[original_ngb];
+          // check how the neighbour level compares to the subgrid level
+          if (ngb_level == level) {
+            // same, easy: just make copies mutual neighbours
+            // and leave the original grid as is
+            for (uint_fast32_t k = 1; k < number_of_copies; ++k) {
+              const uint_fast32_t copy = _copies[i] + k - 1;
+              const uint_fast32_t ngb_copy = _copies[original_ngb] + k - 1;
+              _subgrids[copy]->set_neighbour(j, ngb_copy);
+            }
+          } else {
+            // not the same: there are 2 options
+            if (level > ngb_level) {
+              // we have less neighbour copies, so some of our copies need to
+              // share the same neighbour
+              // some of our copies might also need to share the original
+              // neighbour
+              const uint_fast32_t number_of_ngb_copies = 1
+                                                         << (level - ngb_level);
+              for (uint_fast32_t k = 1; k < number_of_copies; ++k) {
+                const uint_fast32_t copy = _copies[i] + k - 1;
+                // this term will round down, which is what we want
+                const uint_fast32_t ngb_index = k / number_of_ngb_copies;
+                const uint_fast32_t ngb_copy =
+                    (ngb_index > 0) ? _copies[original_ngb] + ngb_index - 1
+                                    : original_ngb;
+                _subgrids[copy]->set_neighbour(j, ngb_copy);
+              }
+            } else {
+              // we have more neighbour copies: pick a subset
+              const uint_fast32_t number_of_own_copies = 1
+                                                         << (ngb_level - level);
+              for (uint_fast32_t k = 1; k < number_of_copies; ++k) {
+                const uint_fast32_t copy = _copies[i] + k - 1;
+                // the second term will skip some neighbour copies, which is
+                // what we want
+                const uint_fast32_t ngb_copy =
+                    _copies[original_ngb] + (k - 1) * number_of_own_copies;
+                _subgrids[copy]->set_neighbour(j, ngb_copy);
+              }
+            }
+          }
+        } else {
+          // flag this neighbour as NEIGHBOUR_OUTSIDE for all copies
+          for (uint_fast32_t k = 1; k < number_of_copies; ++k) {
+            const uint_fast32_t copy = _copies[i] + k - 1;
+            _subgrids[copy]->set_neighbour(j, NEIGHBOUR_OUTSIDE);
+          }
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Allocate the subgrid copies with the given indices.
+   *
+   * The copies are made from their original. If NUMA aware placement is
+   * enabled, every copy is created by its home thread, so that its memory is
+   * allocated in the NUMA domain of that thread.
+   *
+   * @param new_copies Indices of the copies to allocate (the _originals and
+   * _copies tables should already contain these copies).
+   */
+  inline void allocate_copies(const std::vector< size_t > &new_copies) {
+
+    const size_t number_of_originals = number_of_original_subgrids();
+#ifdef USE_NUMA
+    update_number_of_copies();
+    // the copies sorted on home thread, and the offset of the first copy of
+    // each thread in that list
+    std::vector< size_t > sorted_copies(new_copies.size(), 0);
+    std::vector< size_t > thread_offsets;
+#ifdef HAVE_OPENMP
+#pragma omp parallel default(shared)
+#endif
+    {
+      const int_fast32_t thread_id = get_thread_index();
+      const int_fast32_t number_of_threads = get_number_of_active_threads();
+      // sort the copies on home thread (counting sort), so that every thread
+      // only visits its own copies
+#ifdef HAVE_OPENMP
+#pragma omp single
+#endif
+      {
+        std::vector< int_fast32_t > home_threads(new_copies.size(), 0);
+        thread_offsets.assign(number_of_threads + 1, 0);
+        for (size_t i = 0; i < new_copies.size(); ++i) {
+          home_threads[i] = get_home_thread(new_copies[i], number_of_threads);
+          ++thread_offsets[home_threads[i] + 1];
+        }
+        for (int_fast32_t ithread = 0; ithread < number_of_threads;
+             ++ithread) {
+          thread_offsets[ithread + 1] += thread_offsets[ithread];
+        }
+        std::vector< size_t > positions(thread_offsets.begin(),
+                                        thread_offsets.end() - 1);
+        for (size_t i = 0; i < new_copies.size(); ++i) {
+          sorted_copies[positions[home_threads[i]]] = new_copies[i];
+          ++positions[home_threads[i]];
+        }
+      }
+      for (size_t i = thread_offsets[thread_id];
+           i < thread_offsets[thread_id + 1]; ++i) {
+        const size_t index = sorted_copies[i];
+        _subgrids[index] = new _subgrid_type_(
+            *_subgrids[_originals[index - number_of_originals]]);
+        _subgrids[index]->set_owning_thread(thread_id);
+      }
+    }
+#else
+    for (size_t i = 0; i < new_copies.size(); ++i) {
+      const size_t index = new_copies[i];
+      _subgrids[index] = new _subgrid_type_(
+          *_subgrids[_originals[index - number_of_originals]]);
+    }
+#endif
+  }
+
+  /**
+   * @brief Create and initialize the original subgrid with the given index.
+   *
+   * @param index Subgrid index.
+   * @param density_function DensityFunction to use to initialize the cell
+   * variables.
+   * @param owning_thread Thread that owns the subgrid.
+   */
+  inline void initialize_subgrid(const size_t index,
+                                 DensityFunction &density_function,
+                                 const int_fast32_t owning_thread) {
+
+    _subgrids[index] = create_subgrid(index);
+    _subgrids[index]->set_owning_thread(owning_thread);
+    DensityFunctionBlock block = _subgrids[index]->get_density_function_block();
+    if (density_function.evaluate_block(block)) {
+      return;
+    }
+    for (auto it = _subgrids[index]->begin(); it != _subgrids[index]->end();
+         ++it) {
+      block.set_values(it.get_index(), density_function(it));
+    }
+  }
+
 public:
   /**
    * @brief Constructor.
@@ -91,7 +293,7 @@ public:
         _subgrid_number_of_cells(number_of_cells[0] / number_of_subgrids[0],
                                  number_of_cells[1] / number_of_subgrids[1],
                                  number_of_cells[2] / number_of_subgrids[2]),
-        _periodicity(periodicity) {
+        _periodicity(periodicity), _rank(0) {
 
     for (uint_fast8_t i = 0; i < 3; ++i) {
       if (number_of_cells[i] % number_of_subgrids[i] != 0) {
@@ -103,6 +305,16 @@ public:
                          _number_of_subgrids[2],
                      nullptr);
     _copies.resize(_subgrids.size(), 0xffffffff);
+#ifdef USE_NUMA
+    _number_of_copies.resize(_subgrids.size(), 0);
+#endif
+
+#ifdef USE_PRIVATE_INTENSITY_BUFFERS
+    _intensity_buffers = new PrivateIntensityBuffers(
+        get_max_number_of_threads(), _subgrids.size(),
+        _subgrid_number_of_cells[0] * _subgrid_number_of_cells[1] *
+            _subgrid_number_of_cells[2]);
+#endif
   }
 
   /**
@@ -137,6 +349,9 @@ public:
     for (uint_fast32_t igrid = 0; igrid < _subgrids.size(); ++igrid) {
       delete _subgrids[igrid];
     }
+#ifdef USE_PRIVATE_INTENSITY_BUFFERS
+    delete _intensity_buffers;
+#endif
   }
 
   /**
@@ -193,6 +408,15 @@ public:
    */
   inline Box<> get_box() const { return _box; }
 
+  /**
+   * @brief Get the periodicity flags of the grid.
+   *
+   * @return Periodicity flags for each coordinate direction.
+   */
+  inline CoordinateVector< bool > get_periodicity() const {
+    return _periodicity;
+  }
+
   /**
    * @brief Get the 3D integer coordinates of the given subgrid index within
    * the subgrid grid layout.
@@ -306,6 +530,97 @@ public:
     return number_of_neighbours;
   }
 
+  /**
+   * @brief Set the distributed memory domain decomposition.
+   *
+   * This should be called before initialize(): only the subgrids owned by the
+   * local process are created.
+   *
+   * @param domains Rank of the process that owns each original subgrid.
+   * @param rank Rank of the local process.
+   */
+  inline void set_domain_decomposition(const std::vector< int_fast32_t > &domains,
+                                       const int_fast32_t rank) {
+    cmac_assert(domains.size() == number_of_original_subgrids());
+    _domains = domains;
+    _rank = rank;
+  }
+
+  /**
+   * @brief Get the rank of the process that owns the subgrid with the given
+   * index.
+   *
+   * @param index Subgrid index.
+   * @return Rank of the owning process (copies are always owned by the local
+   * process).
+   */
+  inline int_fast32_t get_domain(const size_t index) const {
+    if (_domains.empty() || index >= _domains.size()) {
+      return _rank;
+    }
+    return _domains[index];
+  }
+
+  /**
+   * @brief Is the subgrid with the given index owned by the local process?
+   *
+   * @param index Subgrid index.
+   * @return True if the subgrid is stored on the local process.
+   */
+  inline bool is_local(const size_t index) const {
+    return get_domain(index) == _rank;
+  }
+
+  /**
+   * @brief Get the local contribution to the costs used for the domain
+   * decomposition.
+   *
+   * The computational costs of copies are added to their original. This
+   * function should be called after update_original_counters(), which already
+   * adds the communication costs of copies to their original. Entries for
+   * subgrids that are not local are set to zero, so that the global costs can
+   * be obtained by summing the contributions of all processes.
+   *
+   * @param costs Computational cost of each original subgrid.
+   * @param edge_costs Communication cost for each original subgrid and
+   * neighbour direction.
+   * @param neighbours Neighbour index for each original subgrid and neighbour
+   * direction.
+   */
+  inline void
+  get_decomposition_costs(std::vector< double > &costs,
+                          std::vector< double > &edge_costs,
+                          std::vector< uint_least32_t > &neighbours) const {
+
+    const size_t number_of_originals = number_of_original_subgrids();
+    costs.assign(number_of_originals, 0.);
+    edge_costs.assign(number_of_originals * TRAVELDIRECTION_NUMBER, 0.);
+    neighbours.assign(number_of_originals * TRAVELDIRECTION_NUMBER, 0);
+    for (size_t igrid = 0; igrid < _subgrids.size(); ++igrid) {
+      const size_t ioriginal =
+          (igrid < number_of_originals)
+              ? igrid
+              : _originals[igrid - number_of_originals];
+      if (!is_local(ioriginal)) {
+        continue;
+      }
+      const DensitySubGrid &subgrid = *_subgrids[igrid];
+      costs[ioriginal] += subgrid.get_computational_cost();
+      if (igrid < number_of_originals) {
+#ifdef DENSITYGRID_EDGECOST
+        for (int_fast32_t i = 1; i < TRAVELDIRECTION_NUMBER; ++i) {
+          edge_costs[ioriginal * TRAVELDIRECTION_NUMBER + i] =
+              subgrid.get_communication_cost(i);
+        }
+#endif
+        for (int_fast32_t i = 0; i < TRAVELDIRECTION_NUMBER; ++i) {
+          neighbours[ioriginal * TRAVELDIRECTION_NUMBER + i] =
+              subgrid.get_neighbour(i);
+        }
+      }
+    }
+  }
+
   /**
    * @brief Create the DensitySubGrid with the given index.
    *
@@ -404,37 +719,107 @@ public:
    * variables.
    */
   inline void initialize(DensityFunction &density_function) {
+#ifdef USE_NUMA
+    // every thread creates (and hence first touches) the subgrids it owns, so
+    // that they are allocated in its NUMA domain
+#ifdef HAVE_OPENMP
+#pragma omp parallel default(shared)
+#endif
+    {
+      const int_fast32_t thread_id = get_thread_index();
+      const int_fast32_t number_of_threads = get_number_of_active_threads();
+      size_t first_grid, end_grid;
+      get_home_range(thread_id, number_of_threads, first_grid, end_grid);
+      for (size_t igrid = first_grid; igrid < end_grid; ++igrid) {
+        if (is_local(igrid)) {
+          initialize_subgrid(igrid, density_function, thread_id);
+        }
+      }
+    }
+#else
     AtomicValue< size_t > igrid(0);
 #ifdef HAVE_OPENMP
 #pragma omp parallel default(shared)
 #endif
     while (igrid.value() < _subgrids.size()) {
       const size_t this_igrid = igrid.post_increment();
-      if (this_igrid < _subgrids.size()) {
-        _subgrids[this_igrid] = create_subgrid(this_igrid);
-        _subgrids[this_igrid]->set_owning_thread(get_thread_index());
-        for (auto it = _subgrids[this_igrid]->begin();
-             it != _subgrids[this_igrid]->end(); ++it) {
-          DensityValues values = density_function(it);
-          it.get_ionization_variables().set_number_density(
-              values.get_number_density());
-          it.get_ionization_variables().set_dust_density(
-              values.get_dust_gas_ratio()*values.get_number_density()*1.67e-27);
-          // it.get_ionization_variables().set_fraction_silicon(
-          //     values.get_fraction_silicates());
-
-          for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
-            it.get_ionization_variables().set_ionic_fraction(
-                ion, values.get_ionic_fraction(ion));
-          }
-          it.get_ionization_variables().set_temperature(
-              values.get_temperature());
-          _subgrids[this_igrid]->initialize_hydro(it.get_index(), values);
-        }
+      if (this_igrid < _subgrids.size() && is_local(this_igrid)) {
+        initialize_subgrid(this_igrid, density_function, get_thread_index());
       }
     }
+#endif
+  }
+
+#ifdef USE_NUMA
+  /**
+   * @brief Update the number of copies of each original subgrid to match the
+   * current _originals table.
+   */
+  inline void update_number_of_copies() {
+    _number_of_copies.assign(_copies.size(), 0);
+    for (size_t i = 0; i < _originals.size(); ++i) {
+      ++_number_of_copies[_originals[i]];
+    }
+  }
+
+  /**
+   * @brief Get the range of original subgrids that have the given thread as
+   * home thread.
+   *
+   * This is the inverse of get_home_thread() for original subgrids: the
+   * returned range contains all indices for which
+   * (index * number_of_threads) / number_of_originals equals thread_id.
+   *
+   * @param thread_id Thread index.
+   * @param number_of_threads Number of threads.
+   * @param first_grid Variable to store the index of the first original
+   * subgrid in the range in.
+   * @param end_grid Variable to store the index beyond the last original
+   * subgrid in the range in.
+   */
+  inline void get_home_range(const int_fast32_t thread_id,
+                             const int_fast32_t number_of_threads,
+                             size_t &first_grid, size_t &end_grid) const {
+
+    const size_t number_of_originals = number_of_original_subgrids();
+    first_grid = (thread_id * number_of_originals + number_of_threads - 1) /
+                 number_of_threads;
+    end_grid =
+        ((thread_id + 1) * number_of_originals + number_of_threads - 1) /
+        number_of_threads;
   }
 
+  /**
+   * @brief Get the home thread of the subgrid with the given index.
+   *
+   * The original subgrids are distributed over the threads in contiguous
+   * blocks. Since NUMATopology assigns contiguous blocks of threads to the
+   * same NUMA domain, contiguous blocks of subgrids end up in the same domain.
+   * The copies of a subgrid are spread out over the threads, starting from the
+   * home thread of the original, so that threads in all domains can work on
+   * them without accessing remote memory.
+   *
+   * @param index Subgrid index.
+   * @param number_of_threads Number of threads.
+   * @return Home thread of the subgrid.
+   */
+  inline int_fast32_t
+  get_home_thread(const size_t index,
+                  const int_fast32_t number_of_threads) const {
+
+    const size_t number_of_originals = number_of_original_subgrids();
+    if (index < number_of_originals) {
+      return (index * number_of_threads) / number_of_originals;
+    }
+    const size_t original = _originals[index - number_of_originals];
+    const size_t number_of_copies = _number_of_copies[original];
+    const size_t copy_index = index - _copies[original] + 1;
+    return (get_home_thread(original, number_of_threads) +
+            (copy_index * number_of_threads) / (number_of_copies + 1)) %
+           number_of_threads;
+  }
+#endif
+
   /**
    * @brief Create copies for the given subgrids according to the given copy
    * level specification.
@@ -454,96 +839,215 @@ public:
     //  - one loop to create the copies and store the offset of the first copy
     //    for each subgrid
     //  - a second loop that sets the neighbours (and has access to all
-    //  necessary
-    //    copies to set inter-copy neighbour relations)
+    //    necessary copies to set inter-copy neighbour relations)
 
     // array to store the offsets of new copies in
+    std::vector< size_t > new_copies;
     for (int_fast32_t i = 0; i < number_of_unique_subgrids; ++i) {
       const uint_fast8_t level = copy_levels[i];
       const uint_fast32_t number_of_copies = 1 << level;
-      // create the copies
+      cmac_assert_message(number_of_copies == 1 || is_local(i),
+                          "Cannot create copies of a remote subgrid!");
+      // reserve space for the copies
       if (number_of_copies > 1) {
         _copies[i] = _subgrids.size();
       }
       for (uint_fast32_t j = 1; j < number_of_copies; ++j) {
-        _subgrids.push_back(new _subgrid_type_(*_subgrids[i]));
+        new_copies.push_back(_subgrids.size());
+        _subgrids.push_back(nullptr);
         _originals.push_back(i);
       }
     }
+    allocate_copies(new_copies);
 
-    // neighbour setting
-    for (int_fast32_t i = 0; i < number_of_unique_subgrids; ++i) {
-      const uint_fast8_t level = copy_levels[i];
-      const uint_fast32_t number_of_copies = 1 << level;
-      // first do the self-reference for each copy (if there are copies)
-      for (uint_fast32_t j = 1; j < number_of_copies; ++j) {
-        const uint_fast32_t copy = _copies[i] + j - 1;
-        _subgrids[copy]->set_neighbour(0, copy);
+    set_copy_neighbours(copy_levels);
+  }
+
+  /**
+   * @brief Update the subgrid copies to match the given copy level
+   * specification.
+   *
+   * Copies that exist for both the old and the new specification are reused,
+   * so that only the additional copies need to be allocated and only the
+   * surplus copies are freed. The copies are renumbered to keep the copies of
+   * each original contiguous and the neighbour relations of all copies are
+   * reset. Note that this invalidates all existing copy indices.
+   *
+   * @param copy_levels Desired copy level for each subgrid.
+   * @return True if the copy hierarchy changed.
+   */
+  inline bool update_copies(std::vector< uint_fast8_t > &copy_levels) {
+
+    std::vector< uint_fast8_t > old_levels;
+    get_copy_levels(old_levels);
+    if (old_levels == copy_levels) {
+      return false;
+    }
+
+    const uint_fast32_t number_of_unique_subgrids =
+        number_of_original_subgrids();
+    std::vector< _subgrid_type_ * > new_subgrids(
+        _subgrids.begin(), _subgrids.begin() + number_of_unique_subgrids);
+    std::vector< size_t > new_originals;
+    std::vector< size_t > new_copies;
+    for (uint_fast32_t i = 0; i < number_of_unique_subgrids; ++i) {
+      const uint_fast32_t old_number_of_copies = (1 << old_levels[i]) - 1;
+      const uint_fast32_t new_number_of_copies = (1 << copy_levels[i]) - 1;
+      cmac_assert_message(new_number_of_copies == 0 || is_local(i),
+                          "Cannot create copies of a remote subgrid!");
+      const size_t old_first_copy = _copies[i];
+      _copies[i] =
+          (new_number_of_copies > 0) ? new_subgrids.size() : 0xffffffff;
+      for (uint_fast32_t j = 0; j < new_number_of_copies; ++j) {
+        if (j < old_number_of_copies) {
+          new_subgrids.push_back(_subgrids[old_first_copy + j]);
+        } else {
+          new_copies.push_back(new_subgrids.size());
+          new_subgrids.push_back(nullptr);
+        }
+        new_originals.push_back(i);
       }
-      // now do the actual neighbours
-      for (int_fast32_t j = 1; j < TRAVELDIRECTION_NUMBER; ++j) {
-        const uint_fast32_t original_ngb = _subgrids[i]->get_neighbour(j);
-        if (original_ngb != NEIGHBOUR_OUTSIDE) {
-          const uint_fast8_t ngb_level = copy_levels[original_ngb];
-          // check how the neighbour level compares to the subgrid level
-          if (ngb_level == level) {
-            // same, easy: just make copies mutual neighbours
-            // and leave the original grid as is
-            for (uint_fast32_t k = 1; k < number_of_copies; ++k) {
-              const uint_fast32_t copy = _copies[i] + k - 1;
-              const uint_fast32_t ngb_copy = _copies[original_ngb] + k - 1;
-              _subgrids[copy]->set_neighbour(j, ngb_copy);
-            }
-          } else {
-            // not the same: there are 2 options
-            if (level > ngb_level) {
-              // we have less neighbour copies, so some of our copies need to
-              // share the same neighbour
-              // some of our copies might also need to share the original
-              // neighbour
-              const uint_fast32_t number_of_ngb_copies = 1
-                                                         << (level - ngb_level);
-              for (uint_fast32_t k = 1; k < number_of_copies; ++k) {
-                const uint_fast32_t copy = _copies[i] + k - 1;
-                // this term will round down, which is what we want
-                const uint_fast32_t ngb_index = k / number_of_ngb_copies;
-                const uint_fast32_t ngb_copy =
-                    (ngb_index > 0) ? _copies[original_ngb] + ngb_index - 1
-                                    : original_ngb;
-                _subgrids[copy]->set_neighbour(j, ngb_copy);
-              }
-            } else {
-              // we have more neighbour copies: pick a subset
-              const uint_fast32_t number_of_own_copies = 1
-                                                         << (ngb_level - level);
-              for (uint_fast32_t k = 1; k < number_of_copies; ++k) {
-                const uint_fast32_t copy = _copies[i] + k - 1;
-                // the second term will skip some neighbour copies, which is
-                // what we want
-                const uint_fast32_t ngb_copy =
-                    _copies[original_ngb] + (k - 1) * number_of_own_copies;
-                _subgrids[copy]->set_neighbour(j, ngb_copy);
-              }
+      for (uint_fast32_t j = new_number_of_copies; j < old_number_of_copies;
+           ++j) {
+        delete _subgrids[old_first_copy + j];
+      }
+    }
+    _subgrids.swap(new_subgrids);
+    _originals.swap(new_originals);
+    allocate_copies(new_copies);
+
+    set_copy_neighbours(copy_levels);
+    return true;
+  }
+
+  /**
+   * @brief Get the current copy level of each original subgrid.
+   *
+   * @param copy_levels Vector to store the copy levels in (is resized to the
+   * number of original subgrids).
+   */
+  inline void get_copy_levels(std::vector< uint_fast8_t > &copy_levels) const {
+
+    const size_t number_of_originals = number_of_original_subgrids();
+    std::vector< uint_fast32_t > number_of_copies(number_of_originals, 1);
+    for (size_t i = 0; i < _originals.size(); ++i) {
+      ++number_of_copies[_originals[i]];
+    }
+    copy_levels.assign(number_of_originals, 0);
+    for (size_t i = 0; i < number_of_originals; ++i) {
+      while ((1u << copy_levels[i]) < number_of_copies[i]) {
+        ++copy_levels[i];
+      }
+    }
+  }
+
+  /**
+   * @brief Impose the copy level restrictions on the given copy levels.
+   *
+   * The copy levels of neighbouring subgrids can differ by at most 1, so that
+   * the neighbour relations between copies remain well-defined. Levels are only
+   * ever increased.
+   *
+   * @param copy_levels Copy level for each original subgrid.
+   */
+  inline void
+  restrict_copy_levels(std::vector< uint_fast8_t > &copy_levels) const {
+
+    uint_fast8_t max_level = 0;
+    const size_t levelsize = copy_levels.size();
+    for (size_t i = 0; i < levelsize; ++i) {
+      max_level = std::max(max_level, copy_levels[i]);
+    }
+
+    size_t ngbs[6];
+    while (max_level > 0) {
+      for (size_t i = 0; i < levelsize; ++i) {
+        if (copy_levels[i] == max_level) {
+          const uint_fast8_t numngbs = get_neighbours(i, ngbs);
+          for (uint_fast8_t ingb = 0; ingb < numngbs; ++ingb) {
+            const size_t ngbi = ngbs[ingb];
+            if (copy_levels[ngbi] < copy_levels[i] - 1) {
+              copy_levels[ngbi] = copy_levels[i] - 1;
             }
           }
-        } else {
-          // flag this neighbour as NEIGHBOUR_OUTSIDE for all copies
-          for (uint_fast32_t k = 1; k < number_of_copies; ++k) {
-            const uint_fast32_t copy = _copies[i] + k - 1;
-            _subgrids[copy]->set_neighbour(j, NEIGHBOUR_OUTSIDE);
-          }
         }
       }
+      --max_level;
     }
   }
 
   /**
-   * @brief Create copies for the given subgrids according to the given copy
-   * level specification.
+   * @brief Compute new copy levels based on the computational cost of the
+   * subgrids during the last iteration.
    *
-   * @param copy_levels Desired copy level for each subgrid.
+   * A subgrid (and its copies) that accounts for a fraction \f$s\f$ of the
+   * total local cost limits the parallel speedup to \f$n/s\f$, with \f$n\f$
+   * the number of copies, since only one thread can work on a copy at a time.
+   * We aim for \f$n \geq{} 2 T s\f$ for \f$T\f$ threads, with a factor 2
+   * margin to make sure other threads can pick up work while the hot subgrids
+   * are busy. Levels are increased immediately, but only decreased one at a
+   * time and only if the desired level is at least 2 levels lower than the
+   * current level, to avoid oscillations. Remote subgrids always get level 0.
+   *
+   * The computational costs should not have been reset since the last
+   * iteration. If the total cost is zero, the current levels are returned.
+   *
+   * @param number_of_threads Number of threads that traverse the subgrids.
+   * @param maximum_level Maximum allowed copy level.
+   * @param copy_levels Vector to store the new copy levels in.
    */
-  inline void update_copies(std::vector< uint_fast8_t > &copy_levels) {
+  inline void
+  compute_adaptive_copy_levels(const uint_fast32_t number_of_threads,
+                               const uint_fast8_t maximum_level,
+                               std::vector< uint_fast8_t > &copy_levels) const {
+
+    get_copy_levels(copy_levels);
+
+    const size_t number_of_originals = number_of_original_subgrids();
+    std::vector< double > costs(number_of_originals, 0.);
+    double total_cost = 0.;
+    for (size_t igrid = 0; igrid < _subgrids.size(); ++igrid) {
+      const size_t ioriginal =
+          (igrid < number_of_originals)
+              ? igrid
+              : _originals[igrid - number_of_originals];
+      if (!is_local(ioriginal)) {
+        continue;
+      }
+      const double cost = _subgrids[igrid]->get_computational_cost();
+      costs[ioriginal] += cost;
+      total_cost += cost;
+    }
+    if (total_cost == 0.) {
+      return;
+    }
+
+    for (size_t i = 0; i < number_of_originals; ++i) {
+      if (!is_local(i)) {
+        copy_levels[i] = 0;
+        continue;
+      }
+      const double desired_number_of_copies =
+          2. * number_of_threads * costs[i] / total_cost;
+      uint_fast8_t desired_level = 0;
+      while (desired_level < maximum_level &&
+             (1u << desired_level) < desired_number_of_copies) {
+        ++desired_level;
+      }
+      if (desired_level > copy_levels[i]) {
+        copy_levels[i] = desired_level;
+      } else if (desired_level + 1 < copy_levels[i]) {
+        --copy_levels[i];
+      }
+    }
+
+    restrict_copy_levels(copy_levels);
+  }
+
+  /**
+   * @brief Remove all subgrid copies.
+   */
+  inline void remove_copies() {
 
     const uint_fast32_t original_number = number_of_original_subgrids();
     for (uint_fast32_t igrid = original_number; igrid < _subgrids.size();
@@ -552,34 +1056,98 @@ public:
     }
     _subgrids.resize(original_number);
     _originals.clear();
-
-    create_copies(copy_levels);
+    for (uint_fast32_t igrid = 0; igrid < original_number; ++igrid) {
+      _copies[igrid] = 0xffffffff;
+    }
+#ifdef USE_NUMA
+    update_number_of_copies();
+#endif
   }
 
   /**
    * @brief Update the counters of all original subgrids with the contributions
    * from their copies.
+   *
+   * If thread private intensity buffers are used, their contributions are
+   * added as well, and the buffers are released.
    */
   inline void update_original_counters() {
+#ifdef USE_PRIVATE_INTENSITY_BUFFERS
+    _intensity_buffers->reset_block_counters();
+#endif
     AtomicValue< size_t > ioriginal(0);
 #ifdef HAVE_OPENMP
 #pragma omp parallel default(shared)
 #endif
     while (ioriginal.value() < _copies.size()) {
       const size_t this_ioriginal = ioriginal.post_increment();
-      if (this_ioriginal < _copies.size() &&
-          _copies[this_ioriginal] != 0xffffffff) {
-        size_t copy_index = _copies[this_ioriginal] - _copies.size();
-        while (copy_index < _originals.size() &&
-               _originals[copy_index] == this_ioriginal) {
-          _subgrids[this_ioriginal]->update_intensities(
-              *_subgrids[copy_index + _copies.size()]);
-          ++copy_index;
+      if (this_ioriginal < _copies.size() && is_local(this_ioriginal)) {
+        if (_copies[this_ioriginal] != 0xffffffff) {
+          size_t copy_index = _copies[this_ioriginal] - _copies.size();
+          while (copy_index < _originals.size() &&
+                 _originals[copy_index] == this_ioriginal) {
+            _subgrids[this_ioriginal]->update_intensities(
+                *_subgrids[copy_index + _copies.size()]);
+            ++copy_index;
+          }
         }
+#ifdef USE_PRIVATE_INTENSITY_BUFFERS
+        const int_fast32_t number_of_threads =
+            _intensity_buffers->get_number_of_threads();
+        for (int_fast32_t ithread = 0; ithread < number_of_threads;
+             ++ithread) {
+          double *block =
+              _intensity_buffers->get_existing_block(ithread, this_ioriginal);
+          if (block != nullptr) {
+            _subgrids[this_ioriginal]->add_intensities(block);
+            _intensity_buffers->release_block(ithread, this_ioriginal);
+          }
+        }
+#endif
       }
     }
   }
 
+#ifdef USE_PRIVATE_INTENSITY_BUFFERS
+  /**
+   * @brief Get the thread private intensity accumulators of the given thread
+   * for the given subgrid.
+   *
+   * Copies share the accumulators of their original.
+   *
+   * @param thread_id Thread index.
+   * @param index Subgrid index.
+   * @return Intensity accumulators, or nullptr if the thread ran out of
+   * accumulator blocks.
+   */
+  inline double *get_intensity_accumulators(const int_fast32_t thread_id,
+                                            const size_t index) {
+    const size_t original =
+        (index < _copies.size()) ? index : _originals[index - _copies.size()];
+    return _intensity_buffers->get_block(thread_id, original);
+  }
+
+  /**
+   * @brief Set the maximum number of thread private intensity accumulator
+   * blocks a single thread can use.
+   *
+   * @param maximum_number_of_blocks Maximum number of blocks per thread.
+   */
+  inline void set_maximum_number_of_intensity_blocks(
+      const size_t maximum_number_of_blocks) {
+    _intensity_buffers->set_maximum_number_of_blocks(maximum_number_of_blocks);
+  }
+
+  /**
+   * @brief Get the thread private intensity buffers.
+   *
+   * @return Reference to the thread private intensity buffers.
+   */
+  inline const PrivateIntensityBuffers &get_intensity_buffers() const {
+    return *_intensity_buffers;
+  }
+#endif
+
   /**
    * @brief Update the properties of subgrid copies with the changed properties
    * of their original.
@@ -784,131 +1352,225 @@ public:
 
 
 
-std::vector<std::pair<uint_fast32_t, uint_fast32_t>> cells_within_radius(CoordinateVector<double> midpoint, double radius) {
-    std::vector<std::pair<uint_fast32_t, uint_fast32_t>> result;
+  /**
+   * @brief Incremental search for the cells within a growing sphere around a
+   * fixed centre.
+   *
+   * The cells around the centre are visited in Chebyshev shells (cubic shells
+   * of cells around the cell that contains the centre), and are stored in a
+   * priority queue sorted on their distance to the centre. Growing the sphere
+   * only visits the shells that can contain new cells and returns the new
+   * cells in order of increasing distance, so that quantities like the mass
+   * within the sphere can be accumulated shell by shell without ever
+   * rebuilding the list of cells.
+   *
+   * The search only reads the subgrid layout and can be used by multiple
+   * threads simultaneously, as long as every thread uses its own SphereSearch.
+   */
+  class SphereSearch {
+  private:
+    /*! @brief Underlying subgrid creator. */
+    const DensitySubGridCreator &_grid_creator;
 
-    // Get the grid spacing
-    double grid_spacingx = (_box.get_sides()[0]) / (_subgrid_number_of_cells[0] * _number_of_subgrids[0]);
-    double grid_spacingy = (_box.get_sides()[1]) / (_subgrid_number_of_cells[1] * _number_of_subgrids[1]);
-    double grid_spacingz = (_box.get_sides()[2]) / (_subgrid_number_of_cells[2] * _number_of_subgrids[2]);
+    /*! @brief Centre of the sphere (in m). */
+    const CoordinateVector<> _centre;
 
-    CoordinateVector<double> anchor = _box.get_anchor();
+    /*! @brief Size of a single cell (in m). */
+    CoordinateVector<> _cell_size;
 
-    CoordinateVector<double> grid_spacing(grid_spacingx, grid_spacingy, grid_spacingz);
+    /*! @brief Total number of cells in each coordinate direction. */
+    CoordinateVector< int_fast32_t > _number_of_cells;
 
-    // Box dimensions for periodic boundaries
-    CoordinateVector<double> box_sides = _box.get_sides();
+    /*! @brief Indices of the cell that contains the centre. */
+    CoordinateVector< int_fast32_t > _central_cell;
 
-    // Calculate the minimum and maximum indices for each axis
-    CoordinateVector<int> min_idx;
-    CoordinateVector<int> max_idx;
+    /*! @brief Index of the next shell that needs to be visited. */
+    int_fast32_t _next_shell;
 
-    for (uint_fast32_t i = 0; i < 3; i++) {
-        min_idx[i] = floor((midpoint[i] - radius - anchor[i]) / grid_spacing[i]);
-        max_idx[i] = ceil((midpoint[i] + radius - anchor[i]) / grid_spacing[i]);
-        // // Clamp indices for non-periodic boundaries
-        // if (!_periodicity[i]) {
-        //     if (min_idx[i] < 0) {
-        //       std::cout << "SNe leaking from axis " << i << " in the negative direction" << std::endl;
-        //         min_idx[i] = 0;
-        //     }
-        //     if (max_idx[i] >= _subgrid_number_of_cells[i] * _number_of_subgrids[i]) {
-        //       std::cout << "SNe leaking from axis " << i << " in the positive direction" << std::endl;
-        //         max_idx[i] = _subgrid_number_of_cells[i] * _number_of_subgrids[i] - 1;
-        //     }
-        // }
-    }
+    /*! @brief Index of the last shell that contains cells (negative if the
+     *  grid is periodic in any direction, in which case there is no last
+     *  shell). */
+    int_fast32_t _last_shell;
 
+    /*! @brief Cells that have been visited but have not been returned yet:
+     *  distance to the centre (in m), subgrid index and cell index. */
+    std::priority_queue<
+        std::tuple< double, uint_fast32_t, uint_fast32_t >,
+        std::vector< std::tuple< double, uint_fast32_t, uint_fast32_t > >,
+        std::greater< std::tuple< double, uint_fast32_t, uint_fast32_t > > >
+        _candidates;
 
-    // Loop through the subgrids within the bounds, including periodic wrapping
-    for (int x_idx = min_idx.x(); x_idx <= max_idx.x(); ++x_idx) {
-        for (int y_idx = min_idx.y(); y_idx <= max_idx.y(); ++y_idx) {
-            for (int z_idx = min_idx.z(); z_idx <= max_idx.z(); ++z_idx) {
-                // Wrap indices for periodic dimensions
-                int wrapped_x_idx = x_idx;
-                int wrapped_y_idx = y_idx;
-                int wrapped_z_idx = z_idx;
-
-                double x_offset = 0.0, y_offset = 0.0, z_offset = 0.0;
-
-                if (_periodicity[0]) {
-                    if (x_idx < 0) {
-                        wrapped_x_idx = x_idx + _subgrid_number_of_cells[0] * _number_of_subgrids[0];
-                        x_offset = -box_sides[0];
-                    } else if (x_idx >= _subgrid_number_of_cells[0] * _number_of_subgrids[0]) {
-                        wrapped_x_idx = x_idx - _subgrid_number_of_cells[0] * _number_of_subgrids[0];
-                        x_offset = box_sides[0];
-                    }
-                } else {
-                  if (x_idx < 0) {
-                    continue;
-                  } else if (x_idx >= _subgrid_number_of_cells[0] * _number_of_subgrids[0]) {
-                    continue;
-                  }
-                }
-                if (_periodicity[1]) {
-                    if (y_idx < 0) {
-                        wrapped_y_idx = y_idx + _subgrid_number_of_cells[1] * _number_of_subgrids[1];
-                        y_offset = -box_sides[1];
-                    } else if (y_idx >= _subgrid_number_of_cells[1] * _number_of_subgrids[1]) {
-                        wrapped_y_idx = y_idx - _subgrid_number_of_cells[1] * _number_of_subgrids[1];
-                        y_offset = box_sides[1];
-                    }
-                } else {
-                  if (y_idx < 0) {
-                    continue;
-                  } else if (y_idx >= _subgrid_number_of_cells[1] * _number_of_subgrids[1]) {
-                    continue;
-                  }
-                }
-                if (_periodicity[2]) {
-                    if (z_idx < 0) {
-                        wrapped_z_idx = z_idx + _subgrid_number_of_cells[2] * _number_of_subgrids[2];
-                        z_offset = -box_sides[2];
-                    } else if (z_idx >= _subgrid_number_of_cells[2] * _number_of_subgrids[2]) {
-                        wrapped_z_idx = z_idx - _subgrid_number_of_cells[2] * _number_of_subgrids[2];
-                        z_offset = box_sides[2];
-                    }
-                } else {
-                  if (z_idx < 0) {
-                    continue;
-                  } else if (z_idx >= _subgrid_number_of_cells[2] * _number_of_subgrids[2]) {
-                    continue;
-                  }
-                }
-
-                // Wrapped position for subgrid lookup
-                CoordinateVector<double> wrapped_midpoint(wrapped_x_idx * grid_spacing[0],
-                                                          wrapped_y_idx * grid_spacing[1],
-                                                          wrapped_z_idx * grid_spacing[2]);
-                wrapped_midpoint += anchor;
-                wrapped_midpoint[0] += grid_spacing[0] / 2.;
-                wrapped_midpoint[1] += grid_spacing[1] / 2.;
-                wrapped_midpoint[2] += grid_spacing[2] / 2.;
-
-                // Unwrapped position for distance calculation
-                CoordinateVector<double> unwrapped_midpoint = wrapped_midpoint;
-                unwrapped_midpoint[0] += x_offset;
-                unwrapped_midpoint[1] += y_offset;
-                unwrapped_midpoint[2] += z_offset;
-
-                // Check if the cell is within the specified radius
-                double distance = (midpoint - unwrapped_midpoint).norm();
-                if (distance <= radius) {
-                    uint_fast32_t subgrid_idx = this->get_subgrid(wrapped_midpoint).get_index();
-                    HydroDensitySubGrid& subgrid = *this->get_subgrid(subgrid_idx);
-                    uint_fast32_t cell_idx = subgrid.get_cell(wrapped_midpoint).get_index();
-
-                    // Add the pair of indices to the result vector
-                    result.emplace_back(subgrid_idx, cell_idx);
-                }
+    /**
+     * @brief Add the cell with the given offset w.r.t. the central cell to the
+     * candidates.
+     *
+     * @param offset Offset w.r.t. the central cell.
+     */
+    inline void add_cell(const CoordinateVector< int_fast32_t > offset) {
+
+      CoordinateVector< int_fast32_t > index;
+      CoordinateVector<> position;
+      for (uint_fast8_t i = 0; i < 3; ++i) {
+        const int_fast32_t unwrapped_index = _central_cell[i] + offset[i];
+        // the distance is always computed using the unwrapped index, so that
+        // periodic copies are at the correct distance
+        position[i] = _grid_creator._box.get_anchor()[i] +
+                      (unwrapped_index + 0.5) * _cell_size[i];
+        index[i] = unwrapped_index;
+        if (index[i] < 0 || index[i] >= _number_of_cells[i]) {
+          if (!_grid_creator._periodicity[i]) {
+            return;
+          }
+          index[i] = ((index[i] % _number_of_cells[i]) + _number_of_cells[i]) %
+                     _number_of_cells[i];
+        }
+      }
+
+      const CoordinateVector< int_fast32_t > &subgrid_cells =
+          _grid_creator._subgrid_number_of_cells;
+      const CoordinateVector< int_fast32_t > &subgrids =
+          _grid_creator._number_of_subgrids;
+      const uint_fast32_t subgrid_index =
+          ((index.x() / subgrid_cells.x()) * subgrids.y() +
+           index.y() / subgrid_cells.y()) *
+              subgrids.z() +
+          index.z() / subgrid_cells.z();
+      const uint_fast32_t cell_index =
+          ((index.x() % subgrid_cells.x()) * subgrid_cells.y() +
+           index.y() % subgrid_cells.y()) *
+              subgrid_cells.z() +
+          index.z() % subgrid_cells.z();
+      _candidates.push(std::make_tuple((position - _centre).norm(),
+                                       subgrid_index, cell_index));
+    }
+
+    /**
+     * @brief Visit all cells in the next Chebyshev shell.
+     */
+    inline void visit_next_shell() {
+      const int_fast32_t s = _next_shell;
+      for (int_fast32_t ix = -s; ix <= s; ++ix) {
+        for (int_fast32_t iy = -s; iy <= s; ++iy) {
+          if (ix == -s || ix == s || iy == -s || iy == s) {
+            for (int_fast32_t iz = -s; iz <= s; ++iz) {
+              add_cell(CoordinateVector< int_fast32_t >(ix, iy, iz));
             }
+          } else {
+            add_cell(CoordinateVector< int_fast32_t >(ix, iy, -s));
+            add_cell(CoordinateVector< int_fast32_t >(ix, iy, s));
+          }
         }
+      }
+      ++_next_shell;
     }
 
-    return result;
-}
+  public:
+    /**
+     * @brief Constructor.
+     *
+     * @param grid_creator Underlying subgrid creator.
+     * @param centre Centre of the sphere (in m).
+     */
+    inline SphereSearch(const DensitySubGridCreator &grid_creator,
+                        const CoordinateVector<> centre)
+        : _grid_creator(grid_creator), _centre(centre), _next_shell(0),
+          _last_shell(0) {
+
+      bool periodic = false;
+      for (uint_fast8_t i = 0; i < 3; ++i) {
+        _number_of_cells[i] = grid_creator._subgrid_number_of_cells[i] *
+                              grid_creator._number_of_subgrids[i];
+        _cell_size[i] = grid_creator._box.get_sides()[i] / _number_of_cells[i];
+        _central_cell[i] = std::floor(
+            (centre[i] - grid_creator._box.get_anchor()[i]) / _cell_size[i]);
+        _central_cell[i] =
+            std::max(int_fast32_t(0),
+                     std::min(_central_cell[i], _number_of_cells[i] - 1));
+        _last_shell =
+            std::max(_last_shell,
+                     std::max(_central_cell[i],
+                              _number_of_cells[i] - 1 - _central_cell[i]));
+        periodic |= grid_creator._periodicity[i];
+      }
+      if (periodic) {
+        _last_shell = -1;
+      }
+    }
+
+    /**
+     * @brief Grow the sphere to the given radius.
+     *
+     * The given function is called for every cell with a midpoint within the
+     * given radius that was not returned by a previous call, in order of
+     * increasing distance. The function should have the signature
+     * ```
+     *  void function(uint_fast32_t subgrid_index, uint_fast32_t cell_index,
+     *                double distance);
+     * ```
+     * For periodic grids, cells can be returned more than once if the sphere
+     * contains multiple periodic copies of the same cell.
+     *
+     * @param radius New radius of the sphere, should not be smaller than the
+     * radius of previous calls (in m).
+     * @param function Function to call for every new cell.
+     */
+    template < typename _function_ >
+    inline void grow(const double radius, _function_ function) {
+
+      // the cells in the next shell are at least (_next_shell - 0.5) cell
+      // sizes away from the centre
+      const double minimum_cell_size =
+          std::min(_cell_size.x(), std::min(_cell_size.y(), _cell_size.z()));
+      while ((_last_shell < 0 || _next_shell <= _last_shell) &&
+             (_next_shell - 0.5) * minimum_cell_size <= radius) {
+        visit_next_shell();
+      }
+
+      while (!_candidates.empty() &&
+             std::get< 0 >(_candidates.top()) <= radius) {
+        const std::tuple< double, uint_fast32_t, uint_fast32_t > cell =
+            _candidates.top();
+        _candidates.pop();
+        function(std::get< 1 >(cell), std::get< 2 >(cell), std::get< 0 >(cell));
+      }
+    }
 
+    /**
+     * @brief Have all cells of the grid been returned?
+     *
+     * @return True if all cells have been returned (never true for periodic
+     * grids).
+     */
+    inline bool is_complete() const {
+      return _last_shell >= 0 && _next_shell > _last_shell &&
+             _candidates.empty();
+    }
+  };
+
+  /**
+   * @brief Get the cells with a midpoint within the given radius from the
+   * given position.
+   *
+   * For periodic grids, periodic copies of the cells are included as well.
+   *
+   * @param midpoint Centre of the sphere (in m).
+   * @param radius Radius of the sphere (in m).
+   * @return Subgrid index and cell index of all cells within the sphere, in
+   * order of increasing distance.
+   */
+  inline std::vector< std::pair< uint_fast32_t, uint_fast32_t > >
+  cells_within_radius(const CoordinateVector<> midpoint,
+                      const double radius) const {
+
+    std::vector< std::pair< uint_fast32_t, uint_fast32_t > > result;
+    SphereSearch search(*this, midpoint);
+    search.grow(radius, [&result](const uint_fast32_t subgrid_index,
+                                  const uint_fast32_t cell_index,
+                                  const double distance) {
+      result.emplace_back(subgrid_index, cell_index);
+    });
+    return result;
+  }
 
   // std::vector<std::pair<uint_fast32_t, uint_fast32_t>> cells_within_radius(CoordinateVector<double> midpoint, double radius) {
   //   std::vector<std::pair<uint_fast32_t, uint_fast32_t>> result;
@@ -972,12 +1634,150 @@ std::vector<std::pair<uint_fast32_t, uint_fast32_t>> cells_within_radius(Coordin
   // }
 
 
+#ifdef HAVE_MPI
+  /**
+   * @brief Move subgrids between processes according to the given new domain
+   * decomposition.
+   *
+   * This function needs to be called by all processes at the same time, and
+   * can only be called when there are no subgrid copies.
+   *
+   * @param new_domains New rank of the process that owns each original
+   * subgrid.
+   */
+  inline void redistribute(const std::vector< int_fast32_t > &new_domains) {
+
+    cmac_assert_message(_originals.empty(),
+                        "Cannot redistribute subgrids that have copies!");
+
+    // both the sending and receiving side process the subgrids in the same
+    // order and MPI messages with the same tag do not overtake each other,
+    // so we can use a single tag for all messages
+    const size_t number_of_originals = number_of_original_subgrids();
+    std::vector< char * > send_buffers;
+    std::vector< MPI_Request > send_requests;
+    std::vector< size_t > sent_subgrids;
+    for (size_t igrid = 0; igrid < number_of_originals; ++igrid) {
+      if (_domains[igrid] == _rank && new_domains[igrid] != _rank) {
+        const int_fast32_t buffer_size = _subgrids[igrid]->get_MPI_size();
+        send_buffers.push_back(new char[buffer_size]);
+        _subgrids[igrid]->pack(send_buffers.back(), buffer_size);
+        send_requests.push_back(MPI_REQUEST_NULL);
+        MPI_Isend(send_buffers.back(), buffer_size, MPI_PACKED,
+                  new_domains[igrid], DENSITYSUBGRIDCREATOR_SUBGRID_TAG,
+                  MPI_COMM_WORLD, &send_requests.back());
+        sent_subgrids.push_back(igrid);
+      }
+    }
+    for (size_t igrid = 0; igrid < number_of_originals; ++igrid) {
+      if (_domains[igrid] != _rank && new_domains[igrid] == _rank) {
+        receive_subgrid(igrid, _domains[igrid]);
+      }
+    }
+    MPI_Waitall(send_requests.size(), send_requests.data(),
+                MPI_STATUSES_IGNORE);
+    for (size_t i = 0; i < sent_subgrids.size(); ++i) {
+      delete[] send_buffers[i];
+      delete _subgrids[sent_subgrids[i]];
+      _subgrids[sent_subgrids[i]] = nullptr;
+    }
+
+    _domains = new_domains;
+  }
+
+  /**
+   * @brief Gather all original subgrids on the process with the given rank.
+   *
+   * This function needs to be called by all processes at the same time. The
+   * gathered subgrids are not owned by the root process and can be removed
+   * again using release_remote_subgrids().
+   *
+   * @param root Rank of the process that gathers the subgrids.
+   */
+  inline void gather_subgrids(const int_fast32_t root) {
+
+    if (_domains.empty()) {
+      return;
+    }
+
+    const size_t number_of_originals = number_of_original_subgrids();
+    if (_rank == root) {
+      for (size_t igrid = 0; igrid < number_of_originals; ++igrid) {
+        if (_domains[igrid] != _rank) {
+          receive_subgrid(igrid, _domains[igrid]);
+        }
+      }
+    } else {
+      std::vector< char * > send_buffers;
+      std::vector< MPI_Request > send_requests;
+      for (size_t igrid = 0; igrid < number_of_originals; ++igrid) {
+        if (_domains[igrid] == _rank) {
+          const int_fast32_t buffer_size = _subgrids[igrid]->get_MPI_size();
+          send_buffers.push_back(new char[buffer_size]);
+          _subgrids[igrid]->pack(send_buffers.back(), buffer_size);
+          send_requests.push_back(MPI_REQUEST_NULL);
+          MPI_Isend(send_buffers.back(), buffer_size, MPI_PACKED, root,
+                    DENSITYSUBGRIDCREATOR_SUBGRID_TAG, MPI_COMM_WORLD,
+                    &send_requests.back());
+        }
+      }
+      MPI_Waitall(send_requests.size(), send_requests.data(),
+                  MPI_STATUSES_IGNORE);
+      for (size_t i = 0; i < send_buffers.size(); ++i) {
+        delete[] send_buffers[i];
+      }
+    }
+  }
+
+  /**
+   * @brief Receive the subgrid with the given index from the given process.
+   *
+   * @param index Subgrid index.
+   * @param source Rank of the process that sends the subgrid.
+   */
+  inline void receive_subgrid(const size_t index, const int_fast32_t source) {
+    if (_subgrids[index] == nullptr) {
+      _subgrids[index] = create_subgrid(index);
+    }
+    const int_fast32_t buffer_size = _subgrids[index]->get_MPI_size();
+    char *buffer = new char[buffer_size];
+    MPI_Recv(buffer, buffer_size, MPI_PACKED, source,
+             DENSITYSUBGRIDCREATOR_SUBGRID_TAG, MPI_COMM_WORLD,
+             MPI_STATUS_IGNORE);
+    _subgrids[index]->unpack(buffer, buffer_size);
+    delete[] buffer;
+  }
+#endif
+
+  /**
+   * @brief Delete all original subgrids that are not owned by the local
+   * process, e.g. after they were gathered for output.
+   */
+  inline void release_remote_subgrids() {
+    const size_t number_of_originals = number_of_original_subgrids();
+    for (size_t igrid = 0; igrid < number_of_originals; ++igrid) {
+      if (!is_local(igrid)) {
+        delete _subgrids[igrid];
+        _subgrids[igrid] = nullptr;
+      }
+    }
+  }
+
   /**
    * @brief Dump the subgrids to the given restart file.
    *
+   * If a CheckpointWriter is given, the cell arrays of the subgrids are
+   * registered as blocks with the CheckpointWriter instead of being written to
+   * the restart file. The caller is responsible for calling
+   * CheckpointWriter::write() before the grid changes.
+   *
    * @param restart_writer RestartWriter to write to.
+   * @param checkpoint_writer CheckpointWriter to register the cell arrays
+   * with (optional).
    */
-  inline void write_restart_file(RestartWriter &restart_writer) const {
+  inline void
+  write_restart_file(RestartWriter &restart_writer,
+                     CheckpointWriter *checkpoint_writer = nullptr) const {
 
     // const members
     _box.write_restart_file(restart_writer);
@@ -989,7 +1789,10 @@ std::vector<std::pair<uint_fast32_t, uint_fast32_t>> cells_within_radius(Coordin
     const size_t number_of_subgrids = _subgrids.size();
     restart_writer.write(number_of_subgrids);
     for (size_t i = 0; i < number_of_subgrids; ++i) {
-      _subgrids[i]->write_restart_file(restart_writer);
+      if (checkpoint_writer != nullptr) {
+        restart_writer.write(checkpoint_writer->get_number_of_blocks());
+      }
+      _subgrids[i]->write_restart_file(restart_writer, checkpoint_writer);
     }
     const size_t number_of_copies = _originals.size();
     restart_writer.write(number_of_copies);
@@ -1006,17 +1809,39 @@ std::vector<std::pair<uint_fast32_t, uint_fast32_t>> cells_within_radius(Coordin
   /**
    * @brief Restart constructor.
    *
+   * If the restart file was written with a CheckpointWriter, the
+   * corresponding CheckpointReader needs to be given. The cell arrays are then
+   * read from the (memory mapped) checkpoint file in parallel.
+   *
    * @param restart_reader Restart file to read from.
+   * @param checkpoint_reader Checkpoint file to read the cell arrays from
+   * (optional).
    */
-  inline DensitySubGridCreator(RestartReader &restart_reader)
+  inline DensitySubGridCreator(
+      RestartReader &restart_reader,
+      const CheckpointReader *checkpoint_reader = nullptr)
       : _box(restart_reader), _subgrid_sides(restart_reader),
         _number_of_subgrids(restart_reader),
-        _subgrid_number_of_cells(restart_reader), _periodicity(restart_reader) {
+        _subgrid_number_of_cells(restart_reader), _periodicity(restart_reader),
+        _rank(0) {
 
     const size_t number_of_subgrids = restart_reader.read< size_t >();
     _subgrids.resize(number_of_subgrids, nullptr);
+    std::vector< size_t > first_blocks(number_of_subgrids, 0);
     for (size_t i = 0; i < number_of_subgrids; ++i) {
-      _subgrids[i] = new _subgrid_type_(restart_reader);
+      if (checkpoint_reader != nullptr) {
+        first_blocks[i] = restart_reader.read< size_t >();
+      }
+      _subgrids[i] =
+          new _subgrid_type_(restart_reader, checkpoint_reader == nullptr);
+    }
+    if (checkpoint_reader != nullptr) {
+#ifdef HAVE_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+      for (size_t i = 0; i < number_of_subgrids; ++i) {
+        _subgrids[i]->read_checkpoint(*checkpoint_reader, first_blocks[i]);
+      }
     }
     const size_t number_of_copies = restart_reader.read< size_t >();
     _originals.resize(number_of_copies, 0);
@@ -1028,6 +1853,16 @@ std::vector<std::pair<uint_fast32_t, uint_fast32_t>> cells_within_radius(Coordin
     for (size_t i = 0; i < number_of_originals; ++i) {
       _copies[i] = restart_reader.read< size_t >();
     }
+#ifdef USE_NUMA
+    update_number_of_copies();
+#endif
+
+#ifdef USE_PRIVATE_INTENSITY_BUFFERS
+    _intensity_buffers = new PrivateIntensityBuffers(
+        get_max_number_of_threads(), number_of_originals,
+        _subgrid_number_of_cells[0] * _subgrid_number_of_cells[1] *
+            _subgrid_number_of_cells[2]);
+#endif
   }
 };
 
@@ -28,10 +28,12 @@
 
 #include "CoordinateVector.hpp"
 #include "DensityFunction.hpp"
+#include "DensityFunctionBlock.hpp"
 #include "ParameterFile.hpp"
 #include "PhysicalConstants.hpp"
 
 #include <cmath>
+#include <vector>
 
 /**
  * @brief Disc patch density function.
@@ -235,15 +237,15 @@ public:
   virtual ~DiscPatchDensityFunction() {} /// Lewis's edited density function: mgb note 30.10.2025
 
   /**
-   * @brief Function that gives the density for a given cell.
+   * @brief Get the values at the given height.
    *
-   * @param cell Geometrical information about the cell.
-   * @return Initial physical field values for that cell.
+   * @param z Z coordinate (in m).
+   * @return Initial physical field values at that height.
    */
-  virtual DensityValues operator()(const Cell &cell) {
+  inline DensityValues get_values(const double z) const {
 
    // HEY FUTURE ME! If you're gonna swap this back remember this equation is in cm^-3 not m^-3.
-    const double abs_z = std::abs(cell.get_cell_midpoint().z() - _disc_z)/3.086e+19;
+    const double abs_z = std::abs(z - _disc_z)/3.086e+19;
     const double nH = 0.47*std::exp(-0.5*std::pow(abs_z/0.09,2)) + 0.13*std::exp(-0.5*std::pow(abs_z/0.225,2))
          + 0.077*std::exp(-1*(abs_z/0.403)) +
            0.025*std::exp(-abs_z);
@@ -259,6 +261,43 @@ public:
 
     return values;
   }
+
+  /**
+   * @brief Function that gives the density for a given cell.
+   *
+   * @param cell Geometrical information about the cell.
+   * @return Initial physical field values for that cell.
+   */
+  virtual DensityValues operator()(const Cell &cell) {
+    return get_values(cell.get_cell_midpoint().z());
+  }
+
+  /**
+   * @brief Initialize all cells in the given block at once.
+   *
+   * The profile only depends on the z coordinate, so we evaluate it once for
+   * every z index and reuse the result for all cells with that z index.
+   *
+   * @param block DensityFunctionBlock to initialize.
+   * @return True, since the block is always initialized.
+   */
+  virtual bool evaluate_block(DensityFunctionBlock &block) {
+    const int_fast32_t nz = block.get_number_of_cells(2);
+    std::vector< DensityValues > values(nz);
+    for (int_fast32_t iz = 0; iz < nz; ++iz) {
+      values[iz] = get_values(block.get_cell_midpoint(2, iz));
+    }
+    uint_fast32_t index = 0;
+    for (int_fast32_t ix = 0; ix < block.get_number_of_cells(0); ++ix) {
+      for (int_fast32_t iy = 0; iy < block.get_number_of_cells(1); ++iy) {
+        for (int_fast32_t iz = 0; iz < nz; ++iz) {
+          block.set_values(index, values[iz]);
+          ++index;
+        }
+      }
+    }
+    return true;
+  }
 };
 
 #endif // DISCPATCHDENSITYFUNCTION_HPP
@@ -0,0 +1,338 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file DomainDecomposition.hpp
+ *
+ * @brief Cost based decomposition of a regular subgrid layout over a number of
+ * distributed memory domains.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#ifndef DOMAINDECOMPOSITION_HPP
+#define DOMAINDECOMPOSITION_HPP
+
+#include "Error.hpp"
+#include "MortonKeyGenerator.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <utility>
+#include <vector>
+
+/*! @brief Maximum number of refinement passes over the domain boundaries. */
+#define DOMAINDECOMPOSITION_MAX_REFINEMENT_PASSES 16
+
+/*! @brief Weighted neighbour graph: for every subgrid, a list of neighbouring
+ *  subgrid indices and corresponding communication costs. */
+typedef std::vector< std::vector< std::pair< size_t, double > > >
+    domain_graph_t;
+
+/**
+ * @brief Cost based decomposition of a regular subgrid layout over a number of
+ * distributed memory domains.
+ *
+ * The decomposition is done in two steps. We first sort the subgrids along a
+ * Morton space-filling curve and cut the curve into pieces of equal
+ * computational cost. We then do a number of greedy refinement passes over the
+ * subgrids at the domain boundaries: a subgrid is moved to a neighbouring
+ * domain if that reduces the communication cost across domain boundaries (the
+ * edge cut) without making the load imbalance worse than the given tolerance,
+ * or if it improves the load balance without increasing the edge cut.
+ *
+ * The decomposition is fully deterministic, so that all processes that compute
+ * it for the same costs end up with the same result.
+ */
+class DomainDecomposition {
+private:
+  /*! @brief Number of subgrids in each coordinate direction. */
+  const CoordinateVector< int_fast32_t > _layout;
+
+  /*! @brief Number of domains. */
+  const int_fast32_t _number_of_domains;
+
+  /*! @brief Allowed relative load imbalance. */
+  const double _tolerance;
+
+  /*! @brief Domain for each subgrid. */
+  std::vector< int_fast32_t > _domains;
+
+  /*! @brief Computational load of each domain. */
+  std::vector< double > _loads;
+
+  /**
+   * @brief Get the subgrid indices sorted along the Morton curve.
+   *
+   * @return Sorted subgrid indices.
+   */
+  inline std::vector< size_t > get_morton_order() const {
+
+    const Box<> box(CoordinateVector<>(0.),
+                    CoordinateVector<>(_layout.x(), _layout.y(), _layout.z()));
+    const MortonKeyGenerator key_generator(box);
+    const size_t number_of_subgrids = _domains.size();
+    std::vector< std::pair< morton_key_t, size_t > > keys(number_of_subgrids);
+    for (size_t i = 0; i < number_of_subgrids; ++i) {
+      // subgrid indices are laid out in the same way as in
+      // DensitySubGridCreator
+      const int_fast32_t ix = i / (_layout.y() * _layout.z());
+      const int_fast32_t iy = (i - ix * _layout.y() * _layout.z()) / _layout.z();
+      const int_fast32_t iz =
+          i - ix * _layout.y() * _layout.z() - iy * _layout.z();
+      keys[i].first = key_generator.get_key(
+          CoordinateVector<>(ix + 0.5, iy + 0.5, iz + 0.5));
+      keys[i].second = i;
+    }
+    std::sort(keys.begin(), keys.end());
+    std::vector< size_t > order(number_of_subgrids);
+    for (size_t i = 0; i < number_of_subgrids; ++i) {
+      order[i] = keys[i].second;
+    }
+    return order;
+  }
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param layout Number of subgrids in each coordinate direction.
+   * @param number_of_domains Number of domains.
+   * @param tolerance Allowed relative load imbalance during the refinement
+   * step.
+   */
+  inline DomainDecomposition(const CoordinateVector< int_fast32_t > layout,
+                             const int_fast32_t number_of_domains,
+                             const double tolerance = 0.05)
+      : _layout(layout), _number_of_domains(number_of_domains),
+        _tolerance(tolerance),
+        _domains(layout.x() * layout.y() * layout.z(), 0),
+        _loads(number_of_domains, 0.) {
+
+    if (_domains.size() < static_cast< size_t >(number_of_domains)) {
+      cmac_error("Cannot decompose %zu subgrids over %" PRIiFAST32
+                 " domains!",
+                 _domains.size(), number_of_domains);
+    }
+  }
+
+  /**
+   * @brief Decompose the subgrids using the given costs.
+   *
+   * @param costs Computational cost of each subgrid.
+   * @param graph Communication costs between neighbouring subgrids.
+   */
+  inline void decompose(const std::vector< double > &costs,
+                        const domain_graph_t &graph) {
+
+    const size_t number_of_subgrids = _domains.size();
+    cmac_assert(costs.size() == number_of_subgrids);
+    cmac_assert(graph.size() == number_of_subgrids);
+
+    double total_cost = 0.;
+    for (size_t i = 0; i < number_of_subgrids; ++i) {
+      total_cost += costs[i];
+    }
+    const double average_cost = total_cost / _number_of_domains;
+
+    // step 1: cut the Morton curve into pieces of equal cost
+    // a subgrid is assigned to the next domain if more than half of its cost
+    // would exceed the target cost of the current domain
+    const std::vector< size_t > order = get_morton_order();
+    std::vector< size_t > sizes(_number_of_domains, 0);
+    std::fill(_loads.begin(), _loads.end(), 0.);
+    int_fast32_t current_domain = 0;
+    double cumulative_cost = 0.;
+    for (size_t i = 0; i < number_of_subgrids; ++i) {
+      const size_t index = order[i];
+      const size_t remaining_subgrids = number_of_subgrids - i;
+      const size_t remaining_domains = _number_of_domains - current_domain - 1;
+      if (current_domain < _number_of_domains - 1 &&
+          sizes[current_domain] > 0 &&
+          (cumulative_cost + 0.5 * costs[index] >
+               (current_domain + 1) * average_cost ||
+           remaining_subgrids == remaining_domains)) {
+        ++current_domain;
+      }
+      _domains[index] = current_domain;
+      _loads[current_domain] += costs[index];
+      ++sizes[current_domain];
+      cumulative_cost += costs[index];
+    }
+
+    // step 2: greedy refinement of the domain boundaries
+    double max_load = 0.;
+    for (int_fast32_t i = 0; i < _number_of_domains; ++i) {
+      max_load = std::max(max_load, _loads[i]);
+    }
+    max_load = std::max(max_load, (1. + _tolerance) * average_cost);
+    std::vector< double > connectivity(_number_of_domains, 0.);
+    for (uint_fast32_t ipass = 0;
+         ipass < DOMAINDECOMPOSITION_MAX_REFINEMENT_PASSES; ++ipass) {
+      size_t number_of_moves = 0;
+      for (size_t i = 0; i < number_of_subgrids; ++i) {
+        const size_t index = order[i];
+        const int_fast32_t domain = _domains[index];
+        if (sizes[domain] == 1) {
+          continue;
+        }
+        const std::vector< std::pair< size_t, double > > &edges =
+            graph[index];
+        for (size_t j = 0; j < edges.size(); ++j) {
+          connectivity[_domains[edges[j].first]] += edges[j].second;
+        }
+        int_fast32_t best_domain = domain;
+        double best_gain = 0.;
+        for (size_t j = 0; j < edges.size(); ++j) {
+          const int_fast32_t other = _domains[edges[j].first];
+          if (other == domain || other == best_domain ||
+              _loads[other] + costs[index] > max_load) {
+            continue;
+          }
+          const double gain = connectivity[other] - connectivity[domain];
+          const bool improves_balance =
+              _loads[other] + costs[index] < _loads[domain];
+          if (gain > best_gain ||
+              (gain == best_gain && best_domain == domain &&
+               improves_balance)) {
+            best_gain = gain;
+            best_domain = other;
+          }
+        }
+        for (size_t j = 0; j < edges.size(); ++j) {
+          connectivity[_domains[edges[j].first]] = 0.;
+        }
+        if (best_domain != domain) {
+          _domains[index] = best_domain;
+          _loads[domain] -= costs[index];
+          _loads[best_domain] += costs[index];
+          --sizes[domain];
+          ++sizes[best_domain];
+          ++number_of_moves;
+        }
+      }
+      if (number_of_moves == 0) {
+        break;
+      }
+    }
+  }
+
+  /**
+   * @brief Decompose the subgrids assuming equal costs for all subgrids and
+   * all face neighbour connections.
+   */
+  inline void decompose() {
+
+    const size_t number_of_subgrids = _domains.size();
+    const std::vector< double > costs(number_of_subgrids, 1.);
+    domain_graph_t graph(number_of_subgrids);
+    for (size_t i = 0; i < number_of_subgrids; ++i) {
+      const int_fast32_t ix = i / (_layout.y() * _layout.z());
+      const int_fast32_t iy = (i - ix * _layout.y() * _layout.z()) / _layout.z();
+      const int_fast32_t iz =
+          i - ix * _layout.y() * _layout.z() - iy * _layout.z();
+      if (ix > 0) {
+        graph[i].push_back(std::make_pair(i - _layout.y() * _layout.z(), 1.));
+      }
+      if (ix < _layout.x() - 1) {
+        graph[i].push_back(std::make_pair(i + _layout.y() * _layout.z(), 1.));
+      }
+      if (iy > 0) {
+        graph[i].push_back(std::make_pair(i - _layout.z(), 1.));
+      }
+      if (iy < _layout.y() - 1) {
+        graph[i].push_back(std::make_pair(i + _layout.z(), 1.));
+      }
+      if (iz > 0) {
+        graph[i].push_back(std::make_pair(i - 1, 1.));
+      }
+      if (iz < _layout.z() - 1) {
+        graph[i].push_back(std::make_pair(i + 1, 1.));
+      }
+    }
+    decompose(costs, graph);
+  }
+
+  /**
+   * @brief Get the domain of the subgrid with the given index.
+   *
+   * @param index Subgrid index.
+   * @return Domain that subgrid belongs to.
+   */
+  inline int_fast32_t get_domain(const size_t index) const {
+    return _domains[index];
+  }
+
+  /**
+   * @brief Get the domains of all subgrids.
+   *
+   * @return Domain for each subgrid.
+   */
+  inline const std::vector< int_fast32_t > &get_domains() const {
+    return _domains;
+  }
+
+  /**
+   * @brief Get the computational load of the given domain.
+   *
+   * @param domain Domain index.
+   * @return Total cost of all subgrids in that domain.
+   */
+  inline double get_load(const int_fast32_t domain) const {
+    return _loads[domain];
+  }
+
+  /**
+   * @brief Get the load imbalance of the decomposition.
+   *
+   * @return Ratio of the maximum and average domain load (1 means perfect
+   * load balance).
+   */
+  inline double get_load_imbalance() const {
+    double max_load = 0.;
+    double total_load = 0.;
+    for (int_fast32_t i = 0; i < _number_of_domains; ++i) {
+      max_load = std::max(max_load, _loads[i]);
+      total_load += _loads[i];
+    }
+    if (total_load == 0.) {
+      return 1.;
+    }
+    return max_load * _number_of_domains / total_load;
+  }
+
+  /**
+   * @brief Get the total communication cost across domain boundaries.
+   *
+   * @param graph Communication costs between neighbouring subgrids.
+   * @return Total cost of all connections between subgrids in different
+   * domains.
+   */
+  inline double get_edge_cut(const domain_graph_t &graph) const {
+    double edge_cut = 0.;
+    for (size_t i = 0; i < graph.size(); ++i) {
+      for (size_t j = 0; j < graph[i].size(); ++j) {
+        if (_domains[i] != _domains[graph[i][j].first]) {
+          edge_cut += graph[i][j].second;
+        }
+      }
+    }
+    return edge_cut;
+  }
+};
+
+#endif // DOMAINDECOMPOSITION_HPP
@@ -0,0 +1,217 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file FFT.hpp
+ *
+ * @brief Mixed radix one dimensional complex fast Fourier transform.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#ifndef FFT_HPP
+#define FFT_HPP
+
+#include "Error.hpp"
+
+#include <cmath>
+#include <complex>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Mixed radix one dimensional complex fast Fourier transform.
+ *
+ * The transform is computed using the self-sorting Stockham algorithm, which
+ * does not require a bit reversal permutation. The length of the transform is
+ * factorised into factors 4, 2, 3 and 5, with a general (slow) butterfly for
+ * any remaining prime factors. The transform hence works for any length, but
+ * is only fast for lengths that only contain small prime factors.
+ *
+ * The forward transform computes
+ * \f[
+ *   X_k = \sum_{j=0}^{n-1} x_j e^{-2\pi{} i jk/n},
+ * \f]
+ * the backward transform uses the opposite sign in the exponent. Neither
+ * transform is normalised.
+ *
+ * An FFT object only stores read only tables and can be used by multiple
+ * threads simultaneously, as long as every thread uses its own work space.
+ */
+class FFT {
+private:
+  /*! @brief Length of the transform. */
+  const size_t _size;
+
+  /*! @brief Factors of the transform length, in the order they are used. */
+  std::vector< size_t > _factors;
+
+  /*! @brief Roots of unity \f$e^{-2\pi{} ik/n}\f$ for all \f$k < n\f$. */
+  std::vector< std::complex< double > > _roots;
+
+  /**
+   * @brief Perform a single Stockham pass with the given radix.
+   *
+   * @param radix Radix of the pass.
+   * @param length Length of the sub-transforms that are still to be done.
+   * @param stride Stride of the sub-transforms.
+   * @param input Input array.
+   * @param output Output array.
+   */
+  inline void pass(const size_t radix, const size_t length, const size_t stride,
+                   const std::complex< double > *input,
+                   std::complex< double > *output) const {
+
+    const size_t m = length / radix;
+    // step through the root table that corresponds to the sub-transform length
+    const size_t root_step = _size / length;
+    const size_t radix_step = _size / radix;
+    if (radix == 2) {
+      for (size_t j = 0; j < m; ++j) {
+        const std::complex< double > w1 = _roots[j * root_step];
+        for (size_t q = 0; q < stride; ++q) {
+          const std::complex< double > a0 = input[q + stride * j];
+          const std::complex< double > a1 = input[q + stride * (j + m)];
+          output[q + stride * (2 * j)] = a0 + a1;
+          output[q + stride * (2 * j + 1)] = (a0 - a1) * w1;
+        }
+      }
+    } else if (radix == 4) {
+      for (size_t j = 0; j < m; ++j) {
+        const std::complex< double > w1 = _roots[j * root_step];
+        const std::complex< double > w2 = _roots[2 * j * root_step];
+        const std::complex< double > w3 = _roots[3 * j * root_step];
+        for (size_t q = 0; q < stride; ++q) {
+          const std::complex< double > a0 = input[q + stride * j];
+          const std::complex< double > a1 = input[q + stride * (j + m)];
+          const std::complex< double > a2 = input[q + stride * (j + 2 * m)];
+          const std::complex< double > a3 = input[q + stride * (j + 3 * m)];
+          const std::complex< double > b0 = a0 + a2;
+          const std::complex< double > b1 = a0 - a2;
+          const std::complex< double > b2 = a1 + a3;
+          // (a1 - a3) multiplied with -i
+          const std::complex< double > b3(a1.imag() - a3.imag(),
+                                          a3.real() - a1.real());
+          output[q + stride * (4 * j)] = b0 + b2;
+          output[q + stride * (4 * j + 1)] = (b1 + b3) * w1;
+          output[q + stride * (4 * j + 2)] = (b0 - b2) * w2;
+          output[q + stride * (4 * j + 3)] = (b1 - b3) * w3;
+        }
+      }
+    } else {
+      // general radix: direct DFT of length radix
+      std::vector< std::complex< double > > a(radix);
+      for (size_t j = 0; j < m; ++j) {
+        for (size_t q = 0; q < stride; ++q) {
+          for (size_t r = 0; r < radix; ++r) {
+            a[r] = input[q + stride * (j + r * m)];
+          }
+          for (size_t u = 0; u < radix; ++u) {
+            std::complex< double > sum = a[0];
+            for (size_t r = 1; r < radix; ++r) {
+              sum += a[r] * _roots[((r * u) % radix) * radix_step];
+            }
+            output[q + stride * (radix * j + u)] =
+                sum * _roots[j * u * root_step];
+          }
+        }
+      }
+    }
+  }
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param size Length of the transform.
+   */
+  inline FFT(const size_t size) : _size(size), _roots(size) {
+
+    cmac_assert(size > 0);
+
+    size_t remainder = size;
+    while (remainder % 4 == 0) {
+      _factors.push_back(4);
+      remainder /= 4;
+    }
+    size_t factor = 2;
+    while (remainder > 1) {
+      while (remainder % factor == 0) {
+        _factors.push_back(factor);
+        remainder /= factor;
+      }
+      ++factor;
+    }
+
+    for (size_t k = 0; k < size; ++k) {
+      const double phase = -2. * M_PI * k / size;
+      _roots[k] = std::complex< double >(std::cos(phase), std::sin(phase));
+    }
+  }
+
+  /**
+   * @brief Get the length of the transform.
+   *
+   * @return Length of the transform.
+   */
+  inline size_t get_size() const { return _size; }
+
+  /**
+   * @brief Compute the transform of the given array in place.
+   *
+   * @param data Array to transform (of length get_size()).
+   * @param work Work space (of length get_size()).
+   * @param backward Compute the backward transform?
+   */
+  inline void transform(std::complex< double > *data,
+                        std::complex< double > *work,
+                        const bool backward = false) const {
+
+    // the backward transform is the complex conjugate of the forward
+    // transform of the complex conjugate
+    if (backward) {
+      for (size_t i = 0; i < _size; ++i) {
+        data[i] = std::conj(data[i]);
+      }
+    }
+
+    std::complex< double > *input = data;
+    std::complex< double > *output = work;
+    size_t length = _size;
+    size_t stride = 1;
+    for (size_t ifactor = 0; ifactor < _factors.size(); ++ifactor) {
+      const size_t radix = _factors[ifactor];
+      pass(radix, length, stride, input, output);
+      length /= radix;
+      stride *= radix;
+      std::swap(input, output);
+    }
+    if (input != data) {
+      for (size_t i = 0; i < _size; ++i) {
+        data[i] = input[i];
+      }
+    }
+
+    if (backward) {
+      for (size_t i = 0; i < _size; ++i) {
+        data[i] = std::conj(data[i]);
+      }
+    }
+  }
+};
+
+#endif // FFT_HPP
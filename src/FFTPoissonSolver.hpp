@@ -0,0 +1,615 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file FFTPoissonSolver.hpp
+ *
+ * @brief Self-gravity solver that solves the Poisson equation on a regular
+ * mesh using fast Fourier transforms.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#ifndef FFTPOISSONSOLVER_HPP
+#define FFTPOISSONSOLVER_HPP
+
+#include "Box.hpp"
+#include "Configuration.hpp"
+#include "Error.hpp"
+#include "FFT.hpp"
+#include "OpenMP.hpp"
+#include "PhysicalConstants.hpp"
+
+#include <cmath>
+#include <complex>
+#include <vector>
+
+#ifdef HAVE_FFTW
+#include <fftw3.h>
+#endif
+
+/**
+ * @brief Self-gravity solver that solves the Poisson equation on a regular
+ * mesh using fast Fourier transforms.
+ *
+ * The masses of the cells are deposited on a mesh that covers the entire box,
+ * after which the potential is obtained as the convolution of the mass
+ * distribution with the Green's function of the Poisson equation:
+ *  - for periodic boundaries, the mesh has the same size as the grid and the
+ *    Green's function in Fourier space is \f$-4\pi{}G/(k^2V)\f$ (with \f$V\f$
+ *    the cell volume). The \f$k=0\f$ mode is removed, so that only the
+ *    deviations from the mean density contribute.
+ *  - for isolated (vacuum) boundaries, the mesh is padded with zeros to twice
+ *    the size of the grid in every dimension (the method of Hockney &
+ *    Eastwood), and the Green's function is \f$-G/r\f$ in real space. The
+ *    self-potential of a cell is that of a uniform cube with the same volume.
+ *    For isolated boundaries, the potential is exactly the same as the
+ *    potential obtained by direct summation over all cells.
+ *
+ * The accelerations are computed from the potential using central finite
+ * differences (one-sided differences at isolated boundaries).
+ *
+ * The 3D transforms are real-to-complex transforms. If FFTW is available,
+ * these are done by FFTW (multi-threaded if the OpenMP version of FFTW was
+ * found). Otherwise, we use our own FFT implementation: the 3D transform is
+ * split into 1D transforms along the three coordinate axes, which are done in
+ * parallel. The real-to-complex transforms along the last axis transform two
+ * real lines at once as a single complex line. For isolated boundaries, the
+ * 1D transforms of lines that only contain padding are skipped.
+ *
+ * The interface of this class is the same as that of LinearOctreeGravity:
+ * the positions are only used to link the cells to the mesh and are only
+ * passed on once (during build()), afterwards only the masses need to be
+ * updated.
+ */
+class FFTPoissonSolver {
+private:
+  /*! @brief Anchor of the mesh (in m). */
+  const CoordinateVector<> _anchor;
+
+  /*! @brief Size of a single mesh cell (in m). */
+  const CoordinateVector<> _cell_size;
+
+  /*! @brief Number of cells in the grid in every dimension. */
+  const CoordinateVector< int_fast32_t > _number_of_cells;
+
+  /*! @brief Are the boundaries periodic? */
+  const bool _periodic;
+
+  /*! @brief Size of the (padded) FFT mesh in every dimension. */
+  CoordinateVector< int_fast32_t > _mesh_size;
+
+  /*! @brief Number of complex elements in the last dimension of the Fourier
+   *  space mesh. */
+  int_fast32_t _half_size;
+
+  /*! @brief Green's function in Fourier space, including the normalisation of
+   *  the transforms (in m^2 s^-2 kg^-1). */
+  std::vector< double > _green_function;
+
+  /*! @brief Real space mesh. */
+  std::vector< double > _real_mesh;
+
+  /*! @brief Fourier space mesh. */
+  std::vector< std::complex< double > > _fourier_mesh;
+
+  /*! @brief Potential in every grid cell (in m^2 s^-2). */
+  std::vector< double > _potential;
+
+  /*! @brief Acceleration in every grid cell (in m s^-2). */
+  std::vector< CoordinateVector<> > _accelerations;
+
+  /*! @brief Index of the grid cell that contains each particle. */
+  std::vector< size_t > _cell_index;
+
+  /*! @brief Masses of the particles (in kg). */
+  std::vector< double > _masses;
+
+#ifdef HAVE_FFTW
+  /*! @brief FFTW plan for the forward real-to-complex transform. */
+  fftw_plan _forward_plan;
+
+  /*! @brief FFTW plan for the backward complex-to-real transform. */
+  fftw_plan _backward_plan;
+#else
+  /*! @brief 1D transforms in every dimension. */
+  std::vector< FFT > _transforms;
+
+  /**
+   * @brief Get the real space lines along the last dimension that are
+   * transformed.
+   *
+   * For isolated boundaries, we skip the lines that only contain padding.
+   *
+   * @param all_lines Transform all lines, including the padding?
+   * @return Indices of the lines that are transformed.
+   */
+  inline std::vector< size_t > get_active_lines(const bool all_lines) const {
+    const int_fast32_t nx =
+        all_lines ? _mesh_size.x() : _number_of_cells.x();
+    const int_fast32_t ny =
+        all_lines ? _mesh_size.y() : _number_of_cells.y();
+    std::vector< size_t > lines;
+    for (int_fast32_t ix = 0; ix < nx; ++ix) {
+      for (int_fast32_t iy = 0; iy < ny; ++iy) {
+        lines.push_back(ix * _mesh_size.y() + iy);
+      }
+    }
+    return lines;
+  }
+
+  /**
+   * @brief Do the 1D transforms along the first or second dimension of the
+   * Fourier space mesh.
+   *
+   * @param dimension Dimension (0 or 1).
+   * @param number_of_planes Number of planes perpendicular to the other
+   * dimension (out of 0 and 1) that need to be transformed.
+   * @param backward Do the backward transform?
+   */
+  inline void transform_complex(const uint_fast8_t dimension,
+                                const int_fast32_t number_of_planes,
+                                const bool backward) {
+
+    const FFT &transform = _transforms[dimension];
+    const size_t length = _mesh_size[dimension];
+    // strides of the lines and planes in the Fourier space mesh
+    const size_t stride =
+        (dimension == 0) ? _mesh_size.y() * _half_size : _half_size;
+    const size_t plane_stride =
+        (dimension == 0) ? _half_size : _mesh_size.y() * _half_size;
+    const int_fast64_t number_of_lines = number_of_planes * _half_size;
+
+#ifdef HAVE_OPENMP
+#pragma omp parallel default(shared)
+#endif
+    {
+      std::vector< std::complex< double > > line(length), work(length);
+#ifdef HAVE_OPENMP
+#pragma omp for schedule(static)
+#endif
+      for (int_fast64_t iline = 0; iline < number_of_lines; ++iline) {
+        const size_t offset =
+            (iline / _half_size) * plane_stride + (iline % _half_size);
+        for (size_t i = 0; i < length; ++i) {
+          line[i] = _fourier_mesh[offset + i * stride];
+        }
+        transform.transform(line.data(), work.data(), backward);
+        for (size_t i = 0; i < length; ++i) {
+          _fourier_mesh[offset + i * stride] = line[i];
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Do the real-to-complex or complex-to-real transforms along the
+   * last dimension of the mesh.
+   *
+   * Two real lines are transformed at once as a single complex line.
+   *
+   * @param lines Lines to transform.
+   * @param backward Do the backward (complex-to-real) transform?
+   */
+  inline void transform_real(const std::vector< size_t > &lines,
+                             const bool backward) {
+
+    const FFT &transform = _transforms[2];
+    const size_t length = _mesh_size.z();
+    const int_fast64_t number_of_pairs = (lines.size() + 1) / 2;
+
+#ifdef HAVE_OPENMP
+#pragma omp parallel default(shared)
+#endif
+    {
+      std::vector< std::complex< double > > line(length), work(length);
+#ifdef HAVE_OPENMP
+#pragma omp for schedule(static)
+#endif
+      for (int_fast64_t ipair = 0; ipair < number_of_pairs; ++ipair) {
+        const size_t line0 = lines[2 * ipair];
+        const bool has_line1 = (2 * ipair + 1 < int_fast64_t(lines.size()));
+        const size_t line1 = has_line1 ? lines[2 * ipair + 1] : line0;
+        double *real0 = &_real_mesh[line0 * length];
+        double *real1 = &_real_mesh[line1 * length];
+        std::complex< double > *fourier0 = &_fourier_mesh[line0 * _half_size];
+        std::complex< double > *fourier1 = &_fourier_mesh[line1 * _half_size];
+        if (backward) {
+          // both lines are Hermitian, so that we can reconstruct the missing
+          // half of the spectrum
+          for (int_fast32_t k = 0; k < _half_size; ++k) {
+            const std::complex< double > b =
+                has_line1 ? fourier1[k] : std::complex< double >(0.);
+            line[k] = fourier0[k] + std::complex< double >(-b.imag(), b.real());
+          }
+          for (size_t k = _half_size; k < length; ++k) {
+            const std::complex< double > a = std::conj(fourier0[length - k]);
+            const std::complex< double > b =
+                has_line1 ? std::conj(fourier1[length - k])
+                          : std::complex< double >(0.);
+            line[k] = a + std::complex< double >(-b.imag(), b.real());
+          }
+          transform.transform(line.data(), work.data(), true);
+          for (size_t i = 0; i < length; ++i) {
+            real0[i] = line[i].real();
+          }
+          if (has_line1) {
+            for (size_t i = 0; i < length; ++i) {
+              real1[i] = line[i].imag();
+            }
+          }
+        } else {
+          for (size_t i = 0; i < length; ++i) {
+            line[i] =
+                std::complex< double >(real0[i], has_line1 ? real1[i] : 0.);
+          }
+          transform.transform(line.data(), work.data());
+          for (int_fast32_t k = 0; k < _half_size; ++k) {
+            const std::complex< double > zk = line[k];
+            const std::complex< double > zc =
+                std::conj(line[(length - k) % length]);
+            fourier0[k] = 0.5 * (zk + zc);
+            if (has_line1) {
+              // (zk - zc) / (2i)
+              const std::complex< double > d = zk - zc;
+              fourier1[k] = std::complex< double >(0.5 * d.imag(),
+                                                   -0.5 * d.real());
+            }
+          }
+        }
+      }
+    }
+  }
+#endif
+
+  /**
+   * @brief Transform the real space mesh to Fourier space.
+   *
+   * @param all_lines Transform all lines, including those that only contain
+   * padding?
+   */
+  inline void forward_transform(const bool all_lines) {
+#ifdef HAVE_FFTW
+    fftw_execute(_forward_plan);
+#else
+    if (!all_lines) {
+      // the lines we skip still contain the result of the previous transform
+      const int_fast64_t fourier_size = _fourier_mesh.size();
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+      for (int_fast64_t i = 0; i < fourier_size; ++i) {
+        _fourier_mesh[i] = 0.;
+      }
+    }
+    transform_real(get_active_lines(all_lines), false);
+    transform_complex(1, all_lines ? _mesh_size.x() : _number_of_cells.x(),
+                      false);
+    // the lines along the first dimension always contain data
+    transform_complex(0, _mesh_size.y(), false);
+#endif
+  }
+
+  /**
+   * @brief Transform the Fourier space mesh back to real space.
+   *
+   * Only the part of the real space mesh that overlaps with the grid is
+   * guaranteed to be up to date afterwards.
+   */
+  inline void backward_transform() {
+#ifdef HAVE_FFTW
+    fftw_execute(_backward_plan);
+#else
+    transform_complex(0, _mesh_size.y(), true);
+    transform_complex(1, _number_of_cells.x(), true);
+    transform_real(get_active_lines(false), true);
+#endif
+  }
+
+  /**
+   * @brief Get the index of the given grid cell in the real space mesh.
+   *
+   * @param ix Index of the cell in the first dimension.
+   * @param iy Index of the cell in the second dimension.
+   * @param iz Index of the cell in the third dimension.
+   * @return Index in the real space mesh.
+   */
+  inline size_t get_mesh_index(const int_fast32_t ix, const int_fast32_t iy,
+                               const int_fast32_t iz) const {
+    return (ix * _mesh_size.y() + iy) * _mesh_size.z() + iz;
+  }
+
+  /**
+   * @brief Get the index in the real space mesh of the grid cell with the
+   * given index.
+   *
+   * @param index Index of the cell in the grid.
+   * @return Index in the real space mesh.
+   */
+  inline size_t get_mesh_index(const size_t index) const {
+    const size_t ix = index / (_number_of_cells.y() * _number_of_cells.z());
+    const size_t iy = (index / _number_of_cells.z()) % _number_of_cells.y();
+    const size_t iz = index % _number_of_cells.z();
+    return get_mesh_index(ix, iy, iz);
+  }
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param box Box that contains the grid (in m).
+   * @param number_of_cells Number of cells in the grid in every dimension.
+   * @param periodic Use periodic boundaries? If false, isolated boundaries
+   * are used.
+   * @param G Newton's gravitational constant (in m^3 kg^-1 s^-2).
+   */
+  inline FFTPoissonSolver(
+      const Box<> &box, const CoordinateVector< int_fast32_t > number_of_cells,
+      const bool periodic,
+      const double G = PhysicalConstants::get_physical_constant(
+          PHYSICALCONSTANT_NEWTON_CONSTANT))
+      : _anchor(box.get_anchor()),
+        _cell_size(box.get_sides().x() / number_of_cells.x(),
+                   box.get_sides().y() / number_of_cells.y(),
+                   box.get_sides().z() / number_of_cells.z()),
+        _number_of_cells(number_of_cells), _periodic(periodic) {
+
+    const int_fast32_t padding_factor = periodic ? 1 : 2;
+    _mesh_size = number_of_cells * padding_factor;
+    _half_size = _mesh_size.z() / 2 + 1;
+    const size_t real_size = _mesh_size.x() * _mesh_size.y() * _mesh_size.z();
+    const size_t fourier_size = _mesh_size.x() * _mesh_size.y() * _half_size;
+    _real_mesh.resize(real_size, 0.);
+    _fourier_mesh.resize(fourier_size, 0.);
+    _green_function.resize(fourier_size, 0.);
+    _potential.resize(number_of_cells.x() * number_of_cells.y() *
+                      number_of_cells.z());
+    _accelerations.resize(_potential.size());
+
+#ifdef HAVE_FFTW
+#if defined(HAVE_FFTW_THREADS) && defined(HAVE_OPENMP)
+    fftw_init_threads();
+    fftw_plan_with_nthreads(get_max_number_of_threads());
+#endif
+    fftw_complex *fourier_mesh =
+        reinterpret_cast< fftw_complex * >(_fourier_mesh.data());
+    _forward_plan =
+        fftw_plan_dft_r2c_3d(_mesh_size.x(), _mesh_size.y(), _mesh_size.z(),
+                             _real_mesh.data(), fourier_mesh, FFTW_ESTIMATE);
+    _backward_plan =
+        fftw_plan_dft_c2r_3d(_mesh_size.x(), _mesh_size.y(), _mesh_size.z(),
+                             fourier_mesh, _real_mesh.data(), FFTW_ESTIMATE);
+#else
+    for (uint_fast8_t i = 0; i < 3; ++i) {
+      _transforms.push_back(FFT(_mesh_size[i]));
+    }
+#endif
+
+    const double normalisation = 1. / real_size;
+    const double cell_volume =
+        _cell_size.x() * _cell_size.y() * _cell_size.z();
+    if (periodic) {
+      const CoordinateVector<> dk(2. * M_PI / box.get_sides().x(),
+                                  2. * M_PI / box.get_sides().y(),
+                                  2. * M_PI / box.get_sides().z());
+      for (int_fast32_t ix = 0; ix < _mesh_size.x(); ++ix) {
+        const int_fast32_t kix =
+            (2 * ix <= _mesh_size.x()) ? ix : ix - _mesh_size.x();
+        const double kx = kix * dk.x();
+        for (int_fast32_t iy = 0; iy < _mesh_size.y(); ++iy) {
+          const int_fast32_t kiy =
+              (2 * iy <= _mesh_size.y()) ? iy : iy - _mesh_size.y();
+          const double ky = kiy * dk.y();
+          for (int_fast32_t iz = 0; iz < _half_size; ++iz) {
+            const double kz = iz * dk.z();
+            const double k2 = kx * kx + ky * ky + kz * kz;
+            const size_t index = (ix * _mesh_size.y() + iy) * _half_size + iz;
+            if (k2 > 0.) {
+              _green_function[index] =
+                  -4. * M_PI * G * normalisation / (k2 * cell_volume);
+            }
+          }
+        }
+      }
+    } else {
+      // potential at the centre of a uniform cube with unit mass and unit
+      // side length
+      const double sqrt3 = std::sqrt(3.);
+      const double cube_potential =
+          3. * std::log((sqrt3 + 1.) / (sqrt3 - 1.)) - 0.5 * M_PI;
+      for (int_fast32_t ix = 0; ix < _mesh_size.x(); ++ix) {
+        const double dx =
+            std::min(ix, _mesh_size.x() - ix) * _cell_size.x();
+        for (int_fast32_t iy = 0; iy < _mesh_size.y(); ++iy) {
+          const double dy =
+              std::min(iy, _mesh_size.y() - iy) * _cell_size.y();
+          for (int_fast32_t iz = 0; iz < _mesh_size.z(); ++iz) {
+            const double dz =
+                std::min(iz, _mesh_size.z() - iz) * _cell_size.z();
+            const double r = std::sqrt(dx * dx + dy * dy + dz * dz);
+            _real_mesh[get_mesh_index(ix, iy, iz)] =
+                (r > 0.) ? -G / r
+                         : -G * cube_potential / std::cbrt(cell_volume);
+          }
+        }
+      }
+      forward_transform(true);
+      // the Green's function is real and even, so that its transform is real
+      for (size_t i = 0; i < fourier_size; ++i) {
+        _green_function[i] = _fourier_mesh[i].real() * normalisation;
+      }
+    }
+  }
+
+  /**
+   * @brief Destructor.
+   */
+  inline ~FFTPoissonSolver() {
+#ifdef HAVE_FFTW
+    fftw_destroy_plan(_forward_plan);
+    fftw_destroy_plan(_backward_plan);
+#endif
+  }
+
+  /**
+   * @brief Link the particles to the mesh and set their masses.
+   *
+   * @param positions Positions of the particles (cell midpoints, in m).
+   * @param masses Masses of the particles (in kg).
+   */
+  inline void build(const std::vector< CoordinateVector<> > &positions,
+                    const std::vector< double > &masses) {
+
+    cmac_assert(positions.size() == masses.size());
+
+    _cell_index.resize(positions.size());
+    for (size_t i = 0; i < positions.size(); ++i) {
+      int_fast32_t index[3];
+      for (uint_fast8_t j = 0; j < 3; ++j) {
+        index[j] = std::floor((positions[i][j] - _anchor[j]) / _cell_size[j]);
+        if (index[j] < 0 || index[j] >= _number_of_cells[j]) {
+          cmac_error("Position outside the self-gravity mesh!");
+        }
+      }
+      _cell_index[i] =
+          (index[0] * _number_of_cells.y() + index[1]) * _number_of_cells.z() +
+          index[2];
+    }
+    update_masses(masses);
+  }
+
+  /**
+   * @brief Update the masses of the particles.
+   *
+   * @param masses New masses of the particles (in kg).
+   */
+  inline void update_masses(const std::vector< double > &masses) {
+    cmac_assert(masses.size() == _cell_index.size());
+    _masses = masses;
+  }
+
+  /**
+   * @brief Compute the gravitational accelerations and potentials for all
+   * particles.
+   *
+   * @param accelerations Output accelerations (in m s^-2).
+   * @param potentials Output gravitational potentials per unit mass
+   * (in m^2 s^-2).
+   */
+  inline void
+  compute_accelerations(std::vector< CoordinateVector<> > &accelerations,
+                        std::vector< double > &potentials) {
+
+    // deposit the masses (the real space mesh also contains garbage in the
+    // padding after the previous backward transform)
+    const int_fast64_t real_size = _real_mesh.size();
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+    for (int_fast64_t i = 0; i < real_size; ++i) {
+      _real_mesh[i] = 0.;
+    }
+    for (size_t i = 0; i < _masses.size(); ++i) {
+      _real_mesh[get_mesh_index(_cell_index[i])] += _masses[i];
+    }
+
+    forward_transform(false);
+    const int_fast64_t fourier_size = _fourier_mesh.size();
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+    for (int_fast64_t i = 0; i < fourier_size; ++i) {
+      _fourier_mesh[i] *= _green_function[i];
+    }
+    backward_transform();
+
+    const int_fast64_t number_of_cells = _potential.size();
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+    for (int_fast64_t i = 0; i < number_of_cells; ++i) {
+      _potential[i] = _real_mesh[get_mesh_index(i)];
+    }
+
+    // finite difference accelerations
+    const int_fast64_t cell_stride[3] = {
+        _number_of_cells.y() * _number_of_cells.z(), _number_of_cells.z(), 1};
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+    for (int_fast64_t i = 0; i < number_of_cells; ++i) {
+      const int_fast32_t index[3] = {
+          int_fast32_t(i / cell_stride[0]),
+          int_fast32_t((i / cell_stride[1]) % _number_of_cells.y()),
+          int_fast32_t(i % _number_of_cells.z())};
+      CoordinateVector<> acceleration;
+      for (uint_fast8_t j = 0; j < 3; ++j) {
+        const int_fast32_t n = _number_of_cells[j];
+        if (n == 1) {
+          continue;
+        }
+        int_fast64_t left = i - cell_stride[j];
+        int_fast64_t right = i + cell_stride[j];
+        double distance = 2. * _cell_size[j];
+        if (index[j] == 0) {
+          if (_periodic) {
+            left += n * cell_stride[j];
+          } else {
+            left = i;
+            distance = _cell_size[j];
+          }
+        }
+        if (index[j] == n - 1) {
+          if (_periodic) {
+            right -= n * cell_stride[j];
+          } else {
+            right = i;
+            distance = _cell_size[j];
+          }
+        }
+        acceleration[j] = (_potential[left] - _potential[right]) / distance;
+      }
+      _accelerations[i] = acceleration;
+    }
+
+    const size_t number_of_particles = _cell_index.size();
+    accelerations.resize(number_of_particles);
+    potentials.resize(number_of_particles);
+    for (size_t i = 0; i < number_of_particles; ++i) {
+      accelerations[i] = _accelerations[_cell_index[i]];
+      potentials[i] = _potential[_cell_index[i]];
+    }
+  }
+
+  /**
+   * @brief Get the number of particles.
+   *
+   * @return Number of particles.
+   */
+  inline size_t get_number_of_particles() const { return _cell_index.size(); }
+
+  /**
+   * @brief Get the size of the (padded) FFT mesh.
+   *
+   * @return Number of mesh cells in every dimension.
+   */
+  inline CoordinateVector< int_fast32_t > get_mesh_size() const {
+    return _mesh_size;
+  }
+};
+
+#endif // FFTPOISSONSOLVER_HPP
@@ -24,6 +24,7 @@
  * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
  */
 #include "FLASHSnapshotDensityFunction.hpp"
+#include "DensityFunctionBlock.hpp"
 #include "HDF5Tools.hpp"
 #include "Log.hpp"
 #include "ParameterFile.hpp"
@@ -32,17 +33,29 @@
 /**
  * @brief Constructor.
  *
- * This reads in the data and stores it internally.
+ * This reads in the data and stores it internally. In streaming mode, only the
+ * block structure is read, and the block contents are read on demand.
  *
  * @param filename Name of the snapshot file to read.
  * @param temperature Initial temperature for the ISM (in K).
  * @param read_cosmic_ray_heating Read the variables for cosmic ray heating?
+ * @param streaming Read the block contents on demand instead of reading the
+ * entire snapshot into memory?
+ * @param buffer_size Number of FLASH blocks that can be kept in memory
+ * simultaneously in streaming mode.
  * @param log Log to write logging info to.
  */
 FLASHSnapshotDensityFunction::FLASHSnapshotDensityFunction(
     std::string filename, double temperature, bool read_cosmic_ray_heating,
-    Log *log)
-    : _read_cosmic_ray_heating(read_cosmic_ray_heating), _log(log) {
+    bool streaming, uint_fast32_t buffer_size, Log *log)
+    : _grid(nullptr), _read_cosmic_ray_heating(read_cosmic_ray_heating),
+      _streaming(streaming), _temperature(temperature), _block_grid(nullptr),
+      _buffer(buffer_size), _log(log) {
+
+  if (_streaming && _read_cosmic_ray_heating) {
+    cmac_error("Cosmic ray heating requires neighbour information and cannot "
+               "be used in combination with a streamed FLASH snapshot!");
+  }
 
   // turn off default HDF5 error handling: we catch errors ourselves
   HDF5Tools::initialize();
@@ -52,7 +65,7 @@ FLASHSnapshotDensityFunction::FLASHSnapshotDensityFunction(
 
   // units
   double unit_length_in_SI = UnitConverter::to_SI< QUANTITY_LENGTH >(1., "cm");
-  double unit_density_in_SI =
+  _unit_density_in_SI =
       UnitConverter::to_SI< QUANTITY_DENSITY >(1., "g cm^-3");
   // temperatures are already in K
   double unit_temperature_in_SI = 1.;
@@ -69,43 +82,81 @@ FLASHSnapshotDensityFunction::FLASHSnapshotDensityFunction(
   top_anchor[1] = real_runtime_pars["ymax"] * unit_length_in_SI;
   top_anchor[2] = real_runtime_pars["zmax"] * unit_length_in_SI;
   CoordinateVector<> sides = top_anchor - anchor;
-  Box<> box(anchor, sides);
+  _box = Box<>(anchor, sides);
 
   // find out the number of blocks in each dimension
   HDF5Tools::HDF5Dictionary< int32_t > integer_runtime_pars =
       HDF5Tools::read_dictionary< int32_t >(file, "integer runtime parameters");
-  CoordinateVector< uint_fast32_t > nblock;
-  nblock[0] = integer_runtime_pars["nblockx"];
-  nblock[1] = integer_runtime_pars["nblocky"];
-  nblock[2] = integer_runtime_pars["nblockz"];
-
-  // make the grid
-  _grid = new AMRGrid< DensityValues >(box, nblock);
-
-  // fill the grid with values
+  _number_of_top_level_blocks[0] = integer_runtime_pars["nblockx"];
+  _number_of_top_level_blocks[1] = integer_runtime_pars["nblocky"];
+  _number_of_top_level_blocks[2] = integer_runtime_pars["nblockz"];
 
   // read the block extents
   HDF5Tools::HDF5DataBlock< double, 3 > extents =
       HDF5Tools::read_dataset< double, 3 >(file, "bounding box");
-  // read the densities
-  HDF5Tools::HDF5DataBlock< double, 4 > densities =
-      HDF5Tools::read_dataset< double, 4 >(file, "dens");
-  // read the temperatures
-  HDF5Tools::HDF5DataBlock< double, 4 > temperatures =
-      HDF5Tools::read_dataset< double, 4 >(file, "temp");
   // read the refinement levels
   std::vector< int32_t > levels =
       HDF5Tools::read_dataset< int32_t >(file, "refine level");
   // read the node types
   std::vector< int32_t > nodetypes =
       HDF5Tools::read_dataset< int32_t >(file, "node type");
-  // determine the level of each block
-  uint_fast8_t level = 0;
-  uint_fast32_t dsize = densities.size()[1];
+  // determine the level of each cell within a block
+  _block_number_of_cells =
+      HDF5Tools::get_dataset_dimensions(file, "dens")[1];
+  _block_cell_level = 0;
+  uint_fast32_t dsize = _block_number_of_cells;
   while (dsize > 1) {
-    ++level;
+    ++_block_cell_level;
     dsize >>= 1;
   }
+
+  if (_streaming) {
+    // only store the block structure: every leaf block is a single cell in
+    // an AMRGrid that stores the index of the block in the file
+    _block_grid =
+        new AMRGrid< uint_fast32_t >(_box, _number_of_top_level_blocks);
+    _block_levels.resize(extents.size()[0], 0);
+    for (size_t i = 0; i < extents.size()[0]; ++i) {
+      if (nodetypes[i] == 1) {
+        CoordinateVector<> centre;
+        for (uint_fast8_t idim = 0; idim < 3; ++idim) {
+          std::array< size_t, 3 > i0 = {{i, idim, 0}};
+          std::array< size_t, 3 > i1 = {{i, idim, 1}};
+          centre[idim] =
+              0.5 * (extents[i0] + extents[i1]) * unit_length_in_SI;
+        }
+        // levels[i] is 1 larger than in our definition, Fortran counts from 1
+        _block_levels[i] = levels[i] - 1;
+        amrkey_t key = _block_grid->get_key(_block_levels[i], centre);
+        _block_grid->create_cell(key) = i;
+      }
+    }
+    _buffer.initialize(extents.size()[0], 2 * _block_number_of_cells *
+                                              _block_number_of_cells *
+                                              _block_number_of_cells);
+    // keep the file open
+    _file = file;
+
+    if (_log) {
+      _log->write_status("Streaming densities from file \"", filename,
+                         "\" (", extents.size()[0], " blocks, buffer size: ",
+                         buffer_size, " blocks).");
+    }
+    return;
+  }
+
+  // make the grid
+  _grid = new AMRGrid< DensityValues >(_box, _number_of_top_level_blocks);
+
+  // fill the grid with values
+
+  // read the densities
+  HDF5Tools::HDF5DataBlock< double, 4 > densities =
+      HDF5Tools::read_dataset< double, 4 >(file, "dens");
+  // read the temperatures
+  HDF5Tools::HDF5DataBlock< double, 4 > temperatures =
+      HDF5Tools::read_dataset< double, 4 >(file, "temp");
+  const uint_fast8_t level = _block_cell_level;
   // add them to the grid
   for (size_t i = 0; i < extents.size()[0]; ++i) {
     if (nodetypes[i] == 1) {
@@ -142,7 +193,7 @@ FLASHSnapshotDensityFunction::FLASHSnapshotDensityFunction(
             // from 1)
             amrkey_t key = _grid->get_key(levels[i] + level - 1, centre);
             DensityValues &vals = _grid->create_cell(key);
-            vals.set_number_density(rho * unit_density_in_SI);
+            vals.set_number_density(rho * _unit_density_in_SI);
             if (temperature <= 0.) {
               double temp = temperatures[irho];
               vals.set_temperature(temp * unit_temperature_in_SI);
@@ -238,6 +289,12 @@ FLASHSnapshotDensityFunction::FLASHSnapshotDensityFunction(
  *  - filename: Name of the snapshot file (required)
  *  - temperature: Temperature value used to initialize the cells (default: read
  *    temperature from snapshot file)
+ *  - read cosmic ray heating: Read the variables for cosmic ray heating
+ *    (default: false)
+ *  - streaming: Read the block contents on demand instead of reading the
+ *    entire snapshot into memory (default: false)
+ *  - buffer size: Number of FLASH blocks that can be kept in memory
+ *    simultaneously in streaming mode (default: 100)
  *
  * @param params ParameterFile to read.
  * @param log Log to write logging info to.
@@ -250,12 +307,147 @@ FLASHSnapshotDensityFunction::FLASHSnapshotDensityFunction(
               "DensityFunction:temperature", "-1. K"),
           params.get_value< bool >("DensityFunction:read cosmic ray heating",
                                    false),
+          params.get_value< bool >("DensityFunction:streaming", false),
+          params.get_value< uint_fast32_t >("DensityFunction:buffer size",
+                                            100),
           log) {}
 
 /**
  * @brief Delete the snapshot content from memory.
  */
-void FLASHSnapshotDensityFunction::free() { delete _grid; }
+void FLASHSnapshotDensityFunction::free() {
+  if (_streaming) {
+    delete _block_grid;
+    _buffer.free();
+    HDF5Tools::close_file(_file);
+  } else {
+    delete _grid;
+  }
+}
+
+/**
+ * @brief Read the contents of the FLASH block with the given index into the
+ * given buffer element.
+ *
+ * This function uses its own lock to ensure thread safe access to the HDF5
+ * file.
+ *
+ * @param block_index Index of the block in the snapshot file.
+ * @param values Buffer element to store the densities and temperatures in.
+ */
+void FLASHSnapshotDensityFunction::read_block(const uint_fast32_t block_index,
+                                              double *values) {
+
+  const hsize_t ncell = _block_number_of_cells;
+  const std::vector< hsize_t > offset = {block_index, 0, 0, 0};
+  const std::vector< hsize_t > size = {1, ncell, ncell, ncell};
+
+  _file_lock.lock();
+  HDF5Tools::read_dataset_hyperslab< double >(_file, "dens", offset, size,
+                                              values);
+  if (_temperature <= 0.) {
+    HDF5Tools::read_dataset_hyperslab< double >(_file, "temp", offset, size,
+                                                values + ncell * ncell * ncell);
+  }
+  _file_lock.unlock();
+}
+
+/**
+ * @brief Find the FLASH block and the cell within that block that contain the
+ * given position.
+ *
+ * We walk down the AMR hierarchy in exactly the same way as
+ * AMRGrid::get_cell(), so that we find the same cell as when the snapshot is
+ * read into memory.
+ *
+ * @param position Position (in m).
+ * @param block_index Variable to store the index of the block in.
+ * @param cell_index Variable to store the index of the cell within the block
+ * in (in the order used in the snapshot file).
+ */
+void FLASHSnapshotDensityFunction::get_block_cell_index(
+    const CoordinateVector<> position, uint_fast32_t &block_index,
+    uint_fast32_t &cell_index) const {
+
+  block_index = _block_grid->get_cell(position);
+
+  // find out in which top level block the position lives
+  uint_fast32_t ix, iy, iz;
+  ix = _number_of_top_level_blocks.x() *
+       (position.x() - _box.get_anchor().x()) / _box.get_sides().x();
+  iy = _number_of_top_level_blocks.y() *
+       (position.y() - _box.get_anchor().y()) / _box.get_sides().y();
+  iz = _number_of_top_level_blocks.z() *
+       (position.z() - _box.get_anchor().z()) / _box.get_sides().z();
+  CoordinateVector<> sides;
+  sides[0] = _box.get_sides().x() / _number_of_top_level_blocks.x();
+  sides[1] = _box.get_sides().y() / _number_of_top_level_blocks.y();
+  sides[2] = _box.get_sides().z() / _number_of_top_level_blocks.z();
+  CoordinateVector<> anchor;
+  anchor[0] = _box.get_anchor().x() + ix * sides.x();
+  anchor[1] = _box.get_anchor().y() + iy * sides.y();
+  anchor[2] = _box.get_anchor().z() + iz * sides.z();
+  Box<> box(anchor, sides);
+
+  // walk down the hierarchy: the first levels bring us to the block, the last
+  // levels determine the cell within the block
+  const uint_fast8_t block_level = _block_levels[block_index];
+  uint_fast32_t cx = 0;
+  uint_fast32_t cy = 0;
+  uint_fast32_t cz = 0;
+  for (uint_fast8_t level = 0; level < block_level + _block_cell_level;
+       ++level) {
+    uint_fast8_t jx, jy, jz;
+    jx = 2 * (position.x() - box.get_anchor().x()) / box.get_sides().x();
+    jy = 2 * (position.y() - box.get_anchor().y()) / box.get_sides().y();
+    jz = 2 * (position.z() - box.get_anchor().z()) / box.get_sides().z();
+    box.get_sides() *= 0.5;
+    box.get_anchor()[0] += jx * box.get_sides().x();
+    box.get_anchor()[1] += jy * box.get_sides().y();
+    box.get_anchor()[2] += jz * box.get_sides().z();
+    if (level >= block_level) {
+      cx = 2 * cx + jx;
+      cy = 2 * cy + jy;
+      cz = 2 * cz + jz;
+    }
+  }
+
+  // this is the ordering as it is in the file
+  cell_index = (cz * _block_number_of_cells + cy) * _block_number_of_cells + cx;
+}
+
+/**
+ * @brief Get the DensityValues for the cell with the given index in the given
+ * buffered FLASH block.
+ *
+ * @param block_values Buffered block contents.
+ * @param cell_index Index of the cell within the block.
+ * @return Initial physical field values for that cell.
+ */
+DensityValues
+FLASHSnapshotDensityFunction::get_values(const double *block_values,
+                                         const uint_fast32_t cell_index) const {
+
+  DensityValues values;
+
+  values.set_number_density(block_values[cell_index] * _unit_density_in_SI /
+                            1.6737236e-27);
+  if (_temperature <= 0.) {
+    const uint_fast32_t block_size = _block_number_of_cells *
+                                     _block_number_of_cells *
+                                     _block_number_of_cells;
+    values.set_temperature(block_values[block_size + cell_index]);
+  } else {
+    values.set_temperature(_temperature);
+  }
+  values.set_ionic_fraction(ION_H_n, 1.e-6);
+#ifdef HAS_HELIUM
+  values.set_ionic_fraction(ION_He_n, 1.e-6);
+#endif
+  values.set_cosmic_ray_factor(-1.);
+
+  return values;
+}
 
 /**
  * @brief Function that gives the density for a given cell.
@@ -265,6 +457,19 @@ void FLASHSnapshotDensityFunction::free() { delete _grid; }
  */
 DensityValues FLASHSnapshotDensityFunction::operator()(const Cell &cell) {
 
+  if (_streaming) {
+    uint_fast32_t block_index, cell_index;
+    get_block_cell_index(cell.get_cell_midpoint(), block_index, cell_index);
+    const uint_fast32_t buffer_index = _buffer.lock(
+        block_index, [this](const uint_fast32_t index, double *values) {
+          read_block(index, values);
+        });
+    const DensityValues values =
+        get_values(_buffer.get_values(buffer_index), cell_index);
+    _buffer.unlock(buffer_index);
+    return values;
+  }
+
   DensityValues values;
 
   const CoordinateVector<> position = cell.get_cell_midpoint();
@@ -329,3 +534,50 @@ DensityValues FLASHSnapshotDensityFunction::operator()(const Cell &cell) {
 
   return values;
 }
+
+/**
+ * @brief Evaluate the density function for all cells in the given block.
+ *
+ * Only used in streaming mode: the FLASH blocks that overlap with the block are
+ * read on demand, and every FLASH block is only locked once for consecutive
+ * cells that lie inside it.
+ *
+ * @param block DensityFunctionBlock to initialize.
+ * @return True if the block was initialized.
+ */
+bool FLASHSnapshotDensityFunction::evaluate_block(DensityFunctionBlock &block) {
+
+  if (!_streaming) {
+    return false;
+  }
+
+  uint_fast32_t current_block = 0xffffffff;
+  uint_fast32_t buffer_index = 0;
+  for (int_fast32_t ix = 0; ix < block.get_number_of_cells(0); ++ix) {
+    for (int_fast32_t iy = 0; iy < block.get_number_of_cells(1); ++iy) {
+      for (int_fast32_t iz = 0; iz < block.get_number_of_cells(2); ++iz) {
+        uint_fast32_t block_index, cell_index;
+        get_block_cell_index(block.get_cell_midpoint(ix, iy, iz), block_index,
+                             cell_index);
+        if (block_index != current_block) {
+          if (current_block != 0xffffffff) {
+            _buffer.unlock(buffer_index);
+          }
+          buffer_index = _buffer.lock(
+              block_index, [this](const uint_fast32_t index, double *values) {
+                read_block(index, values);
+              });
+          current_block = block_index;
+        }
+        block.set_values(
+            block.get_index(ix, iy, iz),
+            get_values(_buffer.get_values(buffer_index), cell_index));
+      }
+    }
+  }
+  if (current_block != 0xffffffff) {
+    _buffer.unlock(buffer_index);
+  }
+
+  return true;
+}
@@ -28,36 +28,102 @@
 
 #include "AMRGrid.hpp"
 #include "DensityFunction.hpp"
+#include "HDF5Tools.hpp"
+#include "SnapshotBlockBuffer.hpp"
+#include "ThreadLock.hpp"
 
 #include <string>
+#include <vector>
 
 class Log;
 class ParameterFile;
 
 /**
  * @brief DensityFunction that reads densities from a FLASH snapshot.
+ *
+ * By default, the entire snapshot is read into memory by the constructor. In
+ * streaming mode, only the block structure of the snapshot is read by the
+ * constructor, and the contents of the FLASH blocks are read on demand into a
+ * SnapshotBlockBuffer with a fixed size. Since evaluate_block() is called for
+ * every subgrid in parallel, this means that only the FLASH
+ * blocks that overlap with the subgrids that are being initialized need to be
+ * in memory at any given time.
  */
 class FLASHSnapshotDensityFunction : public DensityFunction {
 private:
-  /*! @brief AMRGrid containing the snapshot file contents. */
+  /*! @brief AMRGrid containing the snapshot file contents (only used if the
+   *  snapshot is not streamed). */
   AMRGrid< DensityValues > *_grid;
 
   /*! @brief Flag indicating if cosmic ray heating variables should be read or
    *  not. */
   const bool _read_cosmic_ray_heating;
 
+  /*! @brief Flag indicating if the snapshot is streamed. */
+  const bool _streaming;
+
+  /*! @brief Temperature value used to initialize the cells (in K; if negative,
+   *  the temperature is read from the snapshot). */
+  const double _temperature;
+
+  /*! @brief Conversion factor from FLASH density units to SI units. */
+  double _unit_density_in_SI;
+
+  /*! @brief Snapshot file (only kept open if the snapshot is streamed). */
+  HDF5Tools::HDF5File _file;
+
+  /*! @brief Box containing the snapshot. */
+  Box<> _box;
+
+  /*! @brief Number of top level blocks in each dimension. */
+  CoordinateVector< uint_fast32_t > _number_of_top_level_blocks;
+
+  /*! @brief Number of cells in each dimension of a single FLASH block. */
+  uint_fast32_t _block_number_of_cells;
+
+  /*! @brief Refinement level within a single FLASH block. */
+  uint_fast8_t _block_cell_level;
+
+  /*! @brief AMRGrid containing the index of every leaf block in the snapshot
+   *  (only used if the snapshot is streamed). */
+  AMRGrid< uint_fast32_t > *_block_grid;
+
+  /*! @brief Refinement level of every block in the snapshot (only used if the
+   *  snapshot is streamed). */
+  std::vector< uint_fast8_t > _block_levels;
+
+  /*! @brief Buffer for the block contents (only used if the snapshot is
+   *  streamed). */
+  SnapshotBlockBuffer< double > _buffer;
+
+  /*! @brief Lock protecting the HDF5 file. */
+  ThreadLock _file_lock;
+
   /*! @brief Log to write logging info to. */
   Log *_log;
 
+  void read_block(const uint_fast32_t block_index, double *values);
+
+  void get_block_cell_index(const CoordinateVector<> position,
+                            uint_fast32_t &block_index,
+                            uint_fast32_t &cell_index) const;
+
+  DensityValues get_values(const double *block_values,
+                           const uint_fast32_t cell_index) const;
+
 public:
   FLASHSnapshotDensityFunction(std::string filename, double temperature = -1.,
                                bool read_cosmic_ray_heating = false,
+                               bool streaming = false,
+                               uint_fast32_t buffer_size = 100,
                                Log *log = nullptr);
   FLASHSnapshotDensityFunction(ParameterFile &params, Log *log = nullptr);
 
   virtual void free();
 
   virtual DensityValues operator()(const Cell &cell);
+
+  virtual bool evaluate_block(DensityFunctionBlock &block);
 };
 
 #endif // FLASHSNAPSHOTDENSITYFUNCTION_HPP
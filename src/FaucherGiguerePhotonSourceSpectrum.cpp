@@ -151,6 +151,8 @@ FaucherGiguerePhotonSourceSpectrum::FaucherGiguerePhotonSourceSpectrum(
           _cumulative_distribution[FAUCHERGIGUEREPHOTONSOURCESPECTRUM_NUMFREQ -
                                    1];
     }
+    _alias_table.initialize(_cumulative_distribution.data(),
+                            FAUCHERGIGUEREPHOTONSOURCESPECTRUM_NUMFREQ);
   } else {
     // no UVB. We set the cumulative distribution and the total luminosity to 0
     for (uint_fast32_t i = 0; i < FAUCHERGIGUEREPHOTONSOURCESPECTRUM_NUMFREQ;
@@ -234,14 +236,24 @@ double FaucherGiguerePhotonSourceSpectrum::get_total_flux() const {
 double FaucherGiguerePhotonSourceSpectrum::get_random_frequency(
     RandomGenerator &random_generator, double temperature) const {
 
-  const double x = random_generator.get_uniform_random_double();
-  const uint_fast32_t inu =
-      Utilities::locate(x, _cumulative_distribution.data(),
-                        FAUCHERGIGUEREPHOTONSOURCESPECTRUM_NUMFREQ);
-  const double frequency =
-      _frequencies[inu] +
-      (_frequencies[inu + 1] - _frequencies[inu]) *
-          (x - _cumulative_distribution[inu]) /
-          (_cumulative_distribution[inu + 1] - _cumulative_distribution[inu]);
-  return frequency;
+  return _alias_table.sample_linear(
+      random_generator.get_uniform_random_double(), _frequencies.data());
+}
+
+/**
+ * @brief Get a batch of random frequencies from the spectrum.
+ *
+ * @param random_generator RandomGenerator to use.
+ * @param frequencies Array to store the random frequencies in (in Hz).
+ * @param number_of_frequencies Number of frequencies to draw.
+ * @param temperature Not used for this spectrum.
+ */
+void FaucherGiguerePhotonSourceSpectrum::get_random_frequencies(
+    RandomGenerator &random_generator, double *frequencies,
+    const uint_fast32_t number_of_frequencies, double temperature) const {
+
+  for (uint_fast32_t i = 0; i < number_of_frequencies; ++i) {
+    frequencies[i] = _alias_table.sample_linear(
+        random_generator.get_uniform_random_double(), _frequencies.data());
+  }
 }
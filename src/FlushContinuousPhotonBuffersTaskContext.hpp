@@ -32,6 +32,7 @@
 #include "Task.hpp"
 #include "TaskContext.hpp"
 #include "TaskQueue.hpp"
+#include "WorkStealingTaskQueue.hpp"
 
 /**
  * @brief Task context responsible for flushing the continuous source photon
@@ -52,7 +53,7 @@ private:
   std::vector< std::vector< PhotonBuffer > > &_continuous_buffers;
 
   /*! @brief Queues per thread. */
-  std::vector< TaskQueue * > &_queues;
+  std::vector< ThreadTaskQueue * > &_queues;
 
 public:
   /**
@@ -69,7 +70,7 @@ public:
       DensitySubGridCreator< DensitySubGrid > &grid_creator,
       ThreadSafeVector< Task > &tasks,
       std::vector< std::vector< PhotonBuffer > > &continuous_buffers,
-      std::vector< TaskQueue * > &queues)
+      std::vector< ThreadTaskQueue * > &queues)
       : _buffers(buffers), _grid_creator(grid_creator), _tasks(tasks),
         _continuous_buffers(continuous_buffers), _queues(queues) {}
 
@@ -98,15 +99,11 @@ public:
         PhotonBuffer &input_buffer = _buffers[buffer_index];
 
         // set general buffer information
-        input_buffer.grow(_continuous_buffers[source_copy][i].size());
         input_buffer.set_subgrid_index(i);
         input_buffer.set_direction(TRAVELDIRECTION_INSIDE);
 
         // copy over the photons
-        for (uint_fast32_t iphoton = 0;
-             iphoton < _continuous_buffers[source_copy][i].size(); ++iphoton) {
-          input_buffer[iphoton] = _continuous_buffers[source_copy][i][iphoton];
-        }
+        input_buffer.add_photons(_continuous_buffers[source_copy][i]);
 
         // reset the active buffer
         _continuous_buffers[source_copy][i].reset();
@@ -123,7 +120,7 @@ public:
         //  - subgrid
         // (the output buffers belong to the subgrid and do not count
         // as a dependency)
-        new_task.set_dependency(subgrid.get_dependency());
+        new_task.set_dependency(subgrid.get_traversal_dependency());
 
         _queues[subgrid.get_owning_thread()]->add_task(task_index);
       }
@@ -35,10 +35,337 @@
 #include "HydroDensitySubGrid.hpp"
 #include "Log.hpp"
 #include "ParameterFile.hpp"
+#include "Timer.hpp"
 #include "Utilities.hpp"
 
 #include <vector>
 
+/**
+ * @brief Single field of a GadgetSnapshotBuffer.
+ */
+class GadgetSnapshotField {
+public:
+  /*! @brief DensityGridField stored in this field. */
+  int_fast32_t _property;
+
+  /*! @brief Ion or heating term for ion and heating properties. */
+  int_fast32_t _subproperty;
+
+  /*! @brief Name of the dataset. */
+  std::string _name;
+
+  /*! @brief Number of components per cell (3 for vectors, 1 for scalars). */
+  uint_fast8_t _number_of_components;
+
+  /*! @brief Packed values for all cells. */
+  std::vector< double > _values;
+};
+
+/**
+ * @brief Copy of all the data that goes into a subgrid snapshot.
+ *
+ * The buffer is filled by the main program and written by a background
+ * thread, so that the simulation can continue while the snapshot is written.
+ */
+class GadgetSnapshotBuffer {
+public:
+  /*! @brief Name of the snapshot file. */
+  std::string _filename;
+
+  /*! @brief Side lengths of the simulation box (in m). */
+  CoordinateVector<> _box_sides;
+
+  /*! @brief Total number of cells. */
+  uint64_t _number_of_cells;
+
+  /*! @brief Simulation time (in s). */
+  double _time;
+
+  /*! @brief Snapshot counter. */
+  uint32_t _counter;
+
+  /*! @brief Key-value pairs of the run parameters at the time of the
+   *  snapshot. */
+  std::vector< std::pair< std::string, std::string > > _parameters;
+
+  /*! @brief Fields in the snapshot. */
+  std::vector< GadgetSnapshotField > _fields;
+
+  /*! @brief Time spent packing the fields (in s). */
+  double _pack_time;
+
+  /*! @brief Time spent writing the file (in s). */
+  double _write_time;
+
+  /*! @brief Size of the uncompressed field data (in bytes). */
+  size_t _raw_bytes;
+
+  /*! @brief Size of the field data in the file (in bytes). */
+  size_t _written_bytes;
+
+  /**
+   * @brief Constructor.
+   */
+  inline GadgetSnapshotBuffer()
+      : _number_of_cells(0), _time(0.), _counter(0), _pack_time(0.),
+        _write_time(0.), _raw_bytes(0), _written_bytes(0) {}
+
+  /**
+   * @brief Set up the fields that are present in the given
+   * DensityGridWriterFields.
+   *
+   * Memory is only reallocated if the number of cells changes, so that the
+   * same buffer can be reused for all snapshots.
+   *
+   * @param fields DensityGridWriterFields.
+   * @param number_of_cells Number of cells in the snapshot.
+   */
+  inline void set_fields(const DensityGridWriterFields &fields,
+                         const uint64_t number_of_cells) {
+
+    _number_of_cells = number_of_cells;
+    size_t ifield = 0;
+    for (int_fast32_t property = 0; property < DENSITYGRIDFIELD_NUMBER;
+         ++property) {
+      if (!fields.field_present(property)) {
+        continue;
+      }
+      const std::string name = DensityGridWriterFields::get_name(property);
+      std::vector< std::pair< int_fast32_t, std::string > > subproperties;
+      if (DensityGridWriterFields::get_type(property) ==
+          DENSITYGRIDFIELDTYPE_VECTOR_DOUBLE) {
+        subproperties.push_back(std::make_pair(-1, name));
+      } else if (DensityGridWriterFields::is_ion_property(property)) {
+        for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+          if (fields.ion_present(property, ion)) {
+            subproperties.push_back(
+                std::make_pair(ion, name + get_ion_name(ion)));
+          }
+        }
+      } else if (DensityGridWriterFields::is_heating_property(property)) {
+        for (int_fast32_t heating = 0; heating < NUMBER_OF_HEATINGTERMS;
+             ++heating) {
+          if (fields.heatingterm_present(property, heating)) {
+            subproperties.push_back(
+                std::make_pair(heating, name + get_ion_name(heating)));
+          }
+        }
+      } else {
+        subproperties.push_back(std::make_pair(-1, name));
+      }
+      for (size_t i = 0; i < subproperties.size(); ++i) {
+        if (ifield == _fields.size()) {
+          _fields.push_back(GadgetSnapshotField());
+        }
+        GadgetSnapshotField &field = _fields[ifield];
+        field._property = property;
+        field._subproperty = subproperties[i].first;
+        field._name = subproperties[i].second;
+        field._number_of_components =
+            (DensityGridWriterFields::get_type(property) ==
+             DENSITYGRIDFIELDTYPE_VECTOR_DOUBLE)
+                ? 3
+                : 1;
+        field._values.resize(field._number_of_components * number_of_cells);
+        ++ifield;
+      }
+    }
+    _fields.resize(ifield);
+  }
+
+  /**
+   * @brief Copy the values of the given range of cells into the buffer.
+   *
+   * @param begin Iterator to the first cell.
+   * @param end Iterator beyond the last cell.
+   * @param offset Offset of the first cell within the buffer.
+   * @param box_anchor Anchor of the simulation box (in m).
+   */
+  template < typename _cell_iterator_ >
+  inline void pack(const _cell_iterator_ &begin, const _cell_iterator_ &end,
+                   const size_t offset, const CoordinateVector<> box_anchor) {
+
+    for (size_t ifield = 0; ifield < _fields.size(); ++ifield) {
+      GadgetSnapshotField &field = _fields[ifield];
+      const int_fast32_t property = field._property;
+      double *values = &field._values[field._number_of_components * offset];
+      if (field._number_of_components == 3) {
+        for (_cell_iterator_ cellit = begin; cellit != end; ++cellit) {
+          const CoordinateVector<> value =
+              DensityGridWriterFields::get_vector_double_value(
+                  property, cellit, box_anchor);
+          values[0] = value.x();
+          values[1] = value.y();
+          values[2] = value.z();
+          values += 3;
+        }
+      } else if (DensityGridWriterFields::is_ion_property(property)) {
+        for (_cell_iterator_ cellit = begin; cellit != end; ++cellit) {
+          *values = DensityGridWriterFields::get_scalar_double_ion_value(
+              property, field._subproperty, cellit);
+          ++values;
+        }
+      } else if (DensityGridWriterFields::is_heating_property(property)) {
+        for (_cell_iterator_ cellit = begin; cellit != end; ++cellit) {
+          *values = DensityGridWriterFields::get_scalar_double_heating_value(
+              property, field._subproperty, cellit);
+          ++values;
+        }
+      } else {
+        for (_cell_iterator_ cellit = begin; cellit != end; ++cellit) {
+          *values = DensityGridWriterFields::get_scalar_double_value(
+              property, cellit);
+          ++values;
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Copy the values of all cells in the given subgrid into the buffer.
+   *
+   * @param subgrid DensitySubGrid.
+   * @param offset Offset of the first cell of the subgrid within the buffer.
+   * @param box_anchor Anchor of the simulation box (in m).
+   */
+  inline void pack_subgrid(DensitySubGrid &subgrid, const size_t offset,
+                           const CoordinateVector<> box_anchor) {
+    pack(subgrid.begin(), subgrid.end(), offset, box_anchor);
+  }
+
+  /**
+   * @brief Copy the values of all cells in the given subgrid into the buffer.
+   *
+   * @param subgrid HydroDensitySubGrid.
+   * @param offset Offset of the first cell of the subgrid within the buffer.
+   * @param box_anchor Anchor of the simulation box (in m).
+   */
+  inline void pack_subgrid(HydroDensitySubGrid &subgrid, const size_t offset,
+                           const CoordinateVector<> box_anchor) {
+    pack(subgrid.hydro_begin(), subgrid.hydro_end(), offset, box_anchor);
+  }
+
+  /**
+   * @brief Write the buffer to its snapshot file.
+   *
+   * This function only uses data stored in the buffer and can therefore be
+   * called from a background thread.
+   *
+   * @param chunk_size Number of cells in a single dataset chunk.
+   * @param filter HDF5Tools::HDF5CompressionFilter to apply.
+   * @param compression_level Deflate compression level.
+   */
+  inline void write(const uint_fast32_t chunk_size, const int_fast32_t filter,
+                    const int_fast32_t compression_level) {
+
+    Timer write_timer;
+    write_timer.start();
+
+    HDF5Tools::HDF5File file =
+        HDF5Tools::open_file(_filename, HDF5Tools::HDF5FILEMODE_WRITE);
+
+    // write header
+    HDF5Tools::HDF5Group group = HDF5Tools::create_group(file, "Header");
+    HDF5Tools::write_attribute< CoordinateVector<> >(group, "BoxSize",
+                                                     _box_sides);
+    int32_t dimension = 3;
+    HDF5Tools::write_attribute< int32_t >(group, "Dimension", dimension);
+    std::vector< uint32_t > flag_entropy(6, 0);
+    HDF5Tools::write_attribute< std::vector< uint32_t > >(
+        group, "Flag_Entropy_ICs", flag_entropy);
+    std::vector< double > masstable(6, 0.);
+    HDF5Tools::write_attribute< std::vector< double > >(group, "MassTable",
+                                                        masstable);
+    int32_t numfiles = 1;
+    HDF5Tools::write_attribute< int32_t >(group, "NumFilesPerSnapshot",
+                                          numfiles);
+    std::vector< uint32_t > numpart(6, 0);
+    numpart[0] = static_cast< uint32_t >(_number_of_cells);
+    std::vector< uint32_t > numpart_high(6, 0);
+    numpart_high[0] = static_cast< uint32_t >(_number_of_cells >> 32);
+    HDF5Tools::write_attribute< std::vector< uint32_t > >(
+        group, "NumPart_ThisFile", numpart);
+    HDF5Tools::write_attribute< std::vector< uint32_t > >(
+        group, "NumPart_Total", numpart);
+    HDF5Tools::write_attribute< std::vector< uint32_t > >(
+        group, "NumPart_Total_HighWord", numpart_high);
+    HDF5Tools::write_attribute< double >(group, "Time", _time);
+    HDF5Tools::close_group(group);
+
+    // write code info
+    group = HDF5Tools::create_group(file, "Code");
+    for (auto it = CompilerInfo::begin(); it != CompilerInfo::end(); ++it) {
+      std::string key = it.get_key();
+      std::string value = it.get_value();
+      HDF5Tools::write_attribute< std::string >(group, key, value);
+    }
+    HDF5Tools::close_group(group);
+
+    // write configuration info
+    group = HDF5Tools::create_group(file, "Configuration");
+    for (auto it = ConfigurationInfo::begin(); it != ConfigurationInfo::end();
+         ++it) {
+      std::string key = it.get_key();
+      std::string value = it.get_value();
+      HDF5Tools::write_attribute< std::string >(group, key, value);
+    }
+    HDF5Tools::close_group(group);
+
+    // write parameters
+    group = HDF5Tools::create_group(file, "Parameters");
+    for (size_t i = 0; i < _parameters.size(); ++i) {
+      HDF5Tools::write_attribute< std::string >(group, _parameters[i].first,
+                                                _parameters[i].second);
+    }
+    HDF5Tools::close_group(group);
+
+    // write runtime parameters
+    group = HDF5Tools::create_group(file, "RuntimePars");
+    std::string timestamp = Utilities::get_timestamp();
+    HDF5Tools::write_attribute< std::string >(group, "Creation time",
+                                              timestamp);
+    HDF5Tools::write_attribute< uint32_t >(group, "Iteration", _counter);
+    HDF5Tools::close_group(group);
+
+    // write units, we use SI units everywhere
+    group = HDF5Tools::create_group(file, "Units");
+    double unit_current_in_cgs = 1.;
+    double unit_length_in_cgs = 100.;
+    double unit_mass_in_cgs = 1000.;
+    double unit_temperature_in_cgs = 1.;
+    double unit_time_in_cgs = 1.;
+    HDF5Tools::write_attribute< double >(group, "Unit current in cgs (U_I)",
+                                         unit_current_in_cgs);
+    HDF5Tools::write_attribute< double >(group, "Unit length in cgs (U_L)",
+                                         unit_length_in_cgs);
+    HDF5Tools::write_attribute< double >(group, "Unit mass in cgs (U_M)",
+                                         unit_mass_in_cgs);
+    HDF5Tools::write_attribute< double >(
+        group, "Unit temperature in cgs (U_T)", unit_temperature_in_cgs);
+    HDF5Tools::write_attribute< double >(group, "Unit time in cgs (U_t)",
+                                         unit_time_in_cgs);
+    HDF5Tools::close_group(group);
+
+    // write particles: every field is written in a single call
+    _raw_bytes = 0;
+    _written_bytes = 0;
+    group = HDF5Tools::create_group(file, "PartType0");
+    for (size_t ifield = 0; ifield < _fields.size(); ++ifield) {
+      const GadgetSnapshotField &field = _fields[ifield];
+      _raw_bytes += field._values.size() * sizeof(double);
+      _written_bytes += HDF5Tools::write_dataset_buffer< double >(
+          group, field._name, field._values.data(), _number_of_cells,
+          field._number_of_components, chunk_size, filter, compression_level);
+    }
+    HDF5Tools::close_group(group);
+
+    // close file
+    HDF5Tools::close_file(file);
+
+    _write_time = write_timer.stop();
+  }
+};
+
 /**
  * @brief Constructor.
  *
@@ -50,20 +377,52 @@
  * @param log Log to write logging information to.
  * @param padding Number of digits used for the counter in the filenames.
  * @param compression Compress the HDF5 output?
+ * @param asynchronous Pack subgrid snapshots in parallel and write them in a
+ * background thread?
+ * @param chunk_size Number of cells in a single dataset chunk (only used in
+ * asynchronous mode).
+ * @param compression_filter HDF5Tools::HDF5CompressionFilter applied to the
+ * datasets (only used in asynchronous mode).
+ * @param compression_level Deflate compression level (only used in
+ * asynchronous mode).
  */
 GadgetDensityGridWriter::GadgetDensityGridWriter(
     std::string prefix, std::string output_folder, const bool hydro,
     const DensityGridWriterFields fields, Log *log, uint_fast8_t padding,
-    const bool compression)
+    const bool compression, const bool asynchronous,
+    const uint_fast32_t chunk_size, const int_fast32_t compression_filter,
+    const int_fast32_t compression_level)
     : DensityGridWriter(output_folder, hydro, fields, log), _prefix(prefix),
-      _padding(padding), _compression(compression) {
+      _padding(padding), _compression(compression),
+      _asynchronous(asynchronous), _chunk_size(chunk_size),
+      _compression_filter(compression_filter),
+      _compression_level(compression_level), _active_buffer(0) {
+
+  _buffers[0] = nullptr;
+  _buffers[1] = nullptr;
+  if (_asynchronous) {
+    _buffers[0] = new GadgetSnapshotBuffer();
+    _buffers[1] = new GadgetSnapshotBuffer();
+  }
+
+  if (_compression_level < 1 || _compression_level > 9) {
+    cmac_error("Invalid compression level: %" PRIiFAST32
+               " (should be in the range [1, 9])!",
+               _compression_level);
+  }
 
   // turn off default HDF5 error handling: we catch errors ourselves
   HDF5Tools::initialize();
   if (_log) {
     _log->write_status("Set up GadgetDensityGridWriter with prefix \"", _prefix,
                        "\".");
-    if (_compression) {
+    if (_asynchronous) {
+      _log->write_status(
+          "Asynchronous output enabled (chunk size: ", _chunk_size,
+          ", compression filter: ",
+          HDF5Tools::get_compression_filter_name(_compression_filter),
+          ", compression level: ", _compression_level, ").");
+    } else if (_compression) {
       _log->write_status("Compression enabled.");
     } else {
       _log->write_status("Compression disabled.");
@@ -78,6 +437,15 @@ GadgetDensityGridWriter::GadgetDensityGridWriter(
  *  - prefix: Prefix to prepend to all snapshot file names (default: snapshot)
  *  - padding: Number of digits to use in the output file names (default: 3)
  *  - compression: Compress HDF5 datasets? (default: false)
+ *  - asynchronous output: Pack subgrid snapshots in parallel and write them
+ *    in a background thread while the simulation continues (default: false)
+ *  - chunk size: Number of cells in a single dataset chunk, only used for
+ *    asynchronous output (default: 1024)
+ *  - compression filter: Filter applied to the datasets, only used for
+ *    asynchronous output: none, deflate or shuffle+deflate (default:
+ *    shuffle+deflate if compression is enabled, none otherwise)
+ *  - compression level: Deflate compression level, only used for
+ *    asynchronous output (default: 4)
  *
  * @param output_folder Name of the folder where output files should be placed.
  * @param params ParameterFile to read.
@@ -92,7 +460,127 @@ GadgetDensityGridWriter::GadgetDensityGridWriter(std::string output_folder,
                                           "snapshot"),
           output_folder, hydro, DensityGridWriterFields(params, hydro), log,
           params.get_value< uint_fast8_t >("DensityGridWriter:padding", 3),
-          params.get_value< bool >("DensityGridWriter:compression", false)) {}
+          params.get_value< bool >("DensityGridWriter:compression", false),
+          params.get_value< bool >("DensityGridWriter:asynchronous output",
+                                   false),
+          params.get_value< uint_fast32_t >("DensityGridWriter:chunk size",
+                                            1024),
+          HDF5Tools::get_compression_filter(params.get_value< std::string >(
+              "DensityGridWriter:compression filter",
+              params.get_value< bool >("DensityGridWriter:compression", false)
+                  ? "shuffle+deflate"
+                  : "none")),
+          params.get_value< int_fast32_t >(
+              "DensityGridWriter:compression level", 4)) {}
+
+/**
+ * @brief Destructor.
+ *
+ * Waits for the last snapshot to be written.
+ */
+GadgetDensityGridWriter::~GadgetDensityGridWriter() {
+  finish_write();
+  delete _buffers[0];
+  delete _buffers[1];
+}
+
+/**
+ * @brief Wait for the background thread to finish writing the last snapshot
+ * and log its statistics.
+ */
+void GadgetDensityGridWriter::finish_write() {
+
+  if (!_io_thread.joinable()) {
+    return;
+  }
+
+  _io_thread.join();
+
+  // the buffer that was written is the one that is not active
+  const GadgetSnapshotBuffer &buffer = *_buffers[1 - _active_buffer];
+  if (_log) {
+    _log->write_status(
+        "Wrote \"", buffer._filename, "\": packing took ", buffer._pack_time,
+        " s, writing took ", buffer._write_time, " s, ", buffer._raw_bytes,
+        " bytes of field data stored in ", buffer._written_bytes, " bytes.");
+  }
+}
+
+/**
+ * @brief Write a snapshot for a split grid in asynchronous mode.
+ *
+ * The fields are packed into contiguous buffers in parallel, one subgrid per
+ * thread. The buffer is then handed over to a background thread that writes
+ * the file while the simulation continues. The next snapshot is packed into a
+ * second buffer, so that the program only waits if the previous snapshot is
+ * still being written when the next one is ready.
+ *
+ * While a snapshot is being written, the main program should not make any
+ * other calls to the HDF5 library, unless the library was built thread safe.
+ *
+ * @param grid_creator Grid.
+ * @param counter Counter value to add to the snapshot file name.
+ * @param params ParameterFile containing the run parameters that should be
+ * written to the file.
+ * @param time Simulation time (in s).
+ */
+template < typename _subgrid_type_ >
+void GadgetDensityGridWriter::write_asynchronous(
+    DensitySubGridCreator< _subgrid_type_ > &grid_creator,
+    const uint_fast32_t counter, ParameterFile &params, const double time) {
+
+  Timer pack_timer;
+  pack_timer.start();
+
+  GadgetSnapshotBuffer &buffer = *_buffers[_active_buffer];
+  buffer._filename = Utilities::compose_filename(_output_folder, _prefix,
+                                                 "hdf5", counter, _padding);
+  if (_log) {
+    _log->write_status("Writing file \"", buffer._filename,
+                       "\" (asynchronous).");
+  }
+
+  const Box<> box = grid_creator.get_box();
+  buffer._box_sides = box.get_sides();
+  buffer._time = time;
+  buffer._counter = counter;
+  buffer._parameters.clear();
+  for (auto it = params.begin(); it != params.end(); ++it) {
+    buffer._parameters.push_back(std::make_pair(it.get_key(), it.get_value()));
+  }
+
+  // compute the offset of every subgrid in the buffers
+  const size_t number_of_subgrids = grid_creator.number_of_original_subgrids();
+  std::vector< size_t > offsets(number_of_subgrids + 1, 0);
+  for (size_t isubgrid = 0; isubgrid < number_of_subgrids; ++isubgrid) {
+    offsets[isubgrid + 1] =
+        offsets[isubgrid] +
+        (*(grid_creator.begin() + isubgrid)).get_number_of_cells();
+  }
+  buffer.set_fields(_fields, offsets[number_of_subgrids]);
+
+#ifdef HAVE_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (size_t isubgrid = 0; isubgrid < number_of_subgrids; ++isubgrid) {
+    _subgrid_type_ &subgrid = *(grid_creator.begin() + isubgrid);
+    buffer.pack_subgrid(subgrid, offsets[isubgrid], box.get_anchor());
+  }
+
+  buffer._pack_time = pack_timer.stop();
+
+  // wait for the previous snapshot to finish before we start a new write: the
+  // HDF5 library is not necessarily thread safe
+  finish_write();
+
+  const uint_fast32_t chunk_size = _chunk_size;
+  const int_fast32_t filter = _compression_filter;
+  const int_fast32_t compression_level = _compression_level;
+  _io_thread = std::thread([&buffer, chunk_size, filter, compression_level]() {
+    buffer.write(chunk_size, filter, compression_level);
+  });
+  _active_buffer = 1 - _active_buffer;
+}
 
 /**
  * @brief Write the file.
@@ -368,6 +856,11 @@ void GadgetDensityGridWriter::write(
     DensitySubGridCreator< DensitySubGrid > &grid_creator,
     const uint_fast32_t counter, ParameterFile &params, double time) {
 
+  if (_asynchronous) {
+    write_asynchronous(grid_creator, counter, params, time);
+    return;
+  }
+
   std::string filename = Utilities::compose_filename(_output_folder, _prefix,
                                                      "hdf5", counter, _padding);
 
@@ -648,6 +1141,11 @@ void GadgetDensityGridWriter::write(
     DensitySubGridCreator< HydroDensitySubGrid > &grid_creator,
     const uint_fast32_t counter, ParameterFile &params, double time) {
 
+  if (_asynchronous) {
+    write_asynchronous(grid_creator, counter, params, time);
+    return;
+  }
+
   std::string filename = Utilities::compose_filename(_output_folder, _prefix,
                                                      "hdf5", counter, _padding);
 
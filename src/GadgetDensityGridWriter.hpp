@@ -29,7 +29,9 @@
 #include "DensityGridWriter.hpp"
 
 #include <string>
+#include <thread>
 
+class GadgetSnapshotBuffer;
 class ParameterFile;
 
 /**
@@ -46,16 +48,50 @@ private:
   /*! @brief Compress the HDF5 output? */
   const bool _compression;
 
+  /*! @brief Write subgrid snapshots in a background thread? */
+  const bool _asynchronous;
+
+  /*! @brief Number of cells in a single dataset chunk (asynchronous mode). */
+  const uint_fast32_t _chunk_size;
+
+  /*! @brief HDF5Tools::HDF5CompressionFilter applied to the datasets
+   *  (asynchronous mode). */
+  const int_fast32_t _compression_filter;
+
+  /*! @brief Deflate compression level (asynchronous mode). */
+  const int_fast32_t _compression_level;
+
+  /*! @brief Snapshot buffers: one is filled while the other one is written. */
+  GadgetSnapshotBuffer *_buffers[2];
+
+  /*! @brief Index of the buffer that is used for the next snapshot. */
+  uint_fast8_t _active_buffer;
+
+  /*! @brief Background thread that writes the last snapshot buffer. */
+  std::thread _io_thread;
+
+  template < typename _subgrid_type_ >
+  void write_asynchronous(DensitySubGridCreator< _subgrid_type_ > &grid_creator,
+                          const uint_fast32_t counter, ParameterFile &params,
+                          const double time);
+
+  void finish_write();
+
 public:
   GadgetDensityGridWriter(
       std::string prefix, std::string output_folder = std::string("."),
       const bool hydro = false,
       const DensityGridWriterFields fields = DensityGridWriterFields(false),
       Log *log = nullptr, uint_fast8_t padding = 3,
-      const bool compression = false);
+      const bool compression = false, const bool asynchronous = false,
+      const uint_fast32_t chunk_size = 1024,
+      const int_fast32_t compression_filter = 0,
+      const int_fast32_t compression_level = 4);
   GadgetDensityGridWriter(std::string output_folder, ParameterFile &params,
                           const bool hydro, Log *log = nullptr);
 
+  virtual ~GadgetDensityGridWriter();
+
   virtual void write(DensityGrid &grid, uint_fast32_t iteration,
                      ParameterFile &params, double time = 0.,
                      const InternalHydroUnits *hydro_units = nullptr);
@@ -29,6 +29,7 @@
 #include "HDF5Tools.hpp"
 #include "Log.hpp"
 #include "ParameterFile.hpp"
+#include "SPHScatterMapping.hpp"
 #include "UnitConverter.hpp"
 #include <cfloat>
 #include <fstream>
@@ -55,14 +56,18 @@
  * @param hubble_parameter Hubble parameter used to convert from comoving to
  * physical coordinates. This is a dimensionless parameter, defined as the
  * actual assumed Hubble constant divided by 100 km/s/Mpc.
+ * @param use_scatter_mapping Deposit the particles onto the grid using an
+ * SPHScatterMapping instead of evaluating the density in every cell using an
+ * Octree neighbour search?
  * @param log Log to write logging information to.
  */
 GadgetSnapshotDensityFunction::GadgetSnapshotDensityFunction(
     std::string name, bool fallback_periodic, double fallback_unit_length_in_SI,
     double fallback_unit_mass_in_SI, double fallback_unit_temperature_in_SI,
     bool use_neutral_fraction, double fallback_temperature,
-    bool comoving_integration, double hubble_parameter, Log *log)
-    : _log(log) {
+    bool comoving_integration, double hubble_parameter,
+    bool use_scatter_mapping, Log *log)
+    : _octree(nullptr), _scatter_mapping(nullptr), _log(log) {
 
   // turn off default HDF5 error handling: we catch errors ourselves
   HDF5Tools::initialize();
@@ -223,6 +228,16 @@ GadgetSnapshotDensityFunction::GadgetSnapshotDensityFunction(
     _log->write_status("Successfully read densities from file \"", name, "\".");
   }
 
+  if (use_scatter_mapping) {
+    if (_log) {
+      _log->write_status("Using scatter mapping, no octree is created.");
+    }
+    _scatter_mapping = new SPHScatterMapping(
+        _positions, _masses, _smoothing_lengths, 0.5, &_temperatures,
+        (_neutral_fractions.size() > 0) ? &_neutral_fractions : nullptr);
+    return;
+  }
+
   Box<> box(_box);
   if (!periodic) {
     // set box to particle extents + small margin
@@ -272,6 +287,9 @@ GadgetSnapshotDensityFunction::GadgetSnapshotDensityFunction(
  *    simulation (default: false)?
  *  - hubble parameter: Reduced Hubble parameter used for the original
  *    simulation (default: 0.7)
+ *  - use scatter mapping: Deposit the particles onto the grid instead of
+ *    gathering them for every cell (only works for subgrid based grids;
+ *    default: false)?
  *
  * @param params ParameterFile to read.
  * @param log Log to write logging information to.
@@ -295,20 +313,26 @@ GadgetSnapshotDensityFunction::GadgetSnapshotDensityFunction(
           params.get_value< bool >("DensityFunction:comoving integration flag",
                                    false),
           params.get_value< double >("DensityFunction:hubble parameter", 0.7),
+          params.get_value< bool >("DensityFunction:use scatter mapping",
+                                   false),
           log) {}
 
 /**
  * @brief Destructor.
  *
- * Deletes the internal Octree.
+ * Deletes the internal Octree and SPHScatterMapping.
  */
 GadgetSnapshotDensityFunction::~GadgetSnapshotDensityFunction() {
   delete _octree;
+  delete _scatter_mapping;
 }
 
 /**
  * @brief Function that gives the density for a given cell.
  *
+ * If the scatter mapping is used, this function only returns background
+ * values; the actual values are set by SPHScatterMapping::deposit().
+ *
  * @param cell Geometrical information about the cell.
  * @return Initial physical field values for that cell.
  */
@@ -316,6 +340,16 @@ DensityValues GadgetSnapshotDensityFunction::operator()(const Cell &cell) {
 
   DensityValues values;
 
+  if (_scatter_mapping != nullptr) {
+    values.set_number_density(0.);
+    values.set_temperature(0.);
+    values.set_ionic_fraction(ION_H_n, 1.e-6);
+#ifdef HAS_HELIUM
+    values.set_ionic_fraction(ION_He_n, 1.e-6);
+#endif
+    return values;
+  }
+
   const CoordinateVector<> position = cell.get_cell_midpoint();
 
   double density = 0.;
@@ -324,10 +358,7 @@ DensityValues GadgetSnapshotDensityFunction::operator()(const Cell &cell) {
   if (_neutral_fractions.size() > 0) {
     neutral_fraction = 0.;
   }
-  const std::vector< uint_fast32_t > ngbs = _octree->get_ngbs(position);
-  const size_t numngbs = ngbs.size();
-  for (size_t i = 0; i < numngbs; ++i) {
-    const uint_fast32_t index = ngbs[i];
+  _octree->for_each_ngb(position, [&](const uint_fast32_t index) {
     double r;
     if (!_box.get_sides().x()) {
       r = (position - _positions[index]).norm();
@@ -343,7 +374,7 @@ DensityValues GadgetSnapshotDensityFunction::operator()(const Cell &cell) {
     if (neutral_fraction >= 0.) {
       neutral_fraction += splineval * _neutral_fractions[index];
     }
-  }
+  });
 
   values.set_number_density(density / 1.6737236e-27);
   values.set_temperature(temperature);
@@ -358,6 +389,17 @@ DensityValues GadgetSnapshotDensityFunction::operator()(const Cell &cell) {
   return values;
 }
 
+/**
+ * @brief Get the scatter mapping that should be used to set the densities.
+ *
+ * @return Pointer to the SPHScatterMapping, or a null pointer if the gather
+ * mapping is used.
+ */
+const SPHScatterMapping *
+GadgetSnapshotDensityFunction::get_scatter_mapping() const {
+  return _scatter_mapping;
+}
+
 /**
  * @brief Get the total number of hydrogen atoms in the snapshot.
  *
@@ -35,6 +35,7 @@
 
 class Log;
 class ParameterFile;
+class SPHScatterMapping;
 
 /**
  * @brief DensityFunction that reads a density field from a Gadget snapshot.
@@ -69,6 +70,10 @@ private:
   /*! @brief Octree used to speed up neighbour searching. */
   Octree *_octree;
 
+  /*! @brief Scatter mapping used instead of the Octree based gather mapping
+   *  (if enabled). */
+  SPHScatterMapping *_scatter_mapping;
+
   /*! @brief Log to write logging info to. */
   Log *_log;
 
@@ -82,6 +87,7 @@ public:
                                 double fallback_temperature = 0.,
                                 bool comoving_integration = false,
                                 double hubble_parameter = 0.7,
+                                bool use_scatter_mapping = false,
                                 Log *log = nullptr);
 
   GadgetSnapshotDensityFunction(ParameterFile &params, Log *log = nullptr);
@@ -90,6 +96,8 @@ public:
 
   virtual DensityValues operator()(const Cell &cell);
 
+  virtual const SPHScatterMapping *get_scatter_mapping() const;
+
   double get_total_hydrogen_number() const;
 };
 
@@ -25,6 +25,7 @@
  * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
  */
 #include "HDF5DensityFunction.hpp"
+#include "DensityFunctionBlock.hpp"
 #include "HDF5Tools.hpp"
 #include "Log.hpp"
 #include "ParameterFile.hpp"
@@ -58,14 +59,17 @@
  * @param hubble_parameter Hubble parameter used to convert from comoving to
  * physical coordinates. This is a dimensionless parameter, defined as the
  * actual assumed Hubble constant divided by 100 km/s/Mpc.
+ * @param streaming Read the snapshot on demand for every block of cells that
+ * is initialized, rather than reading it into memory?
  * @param log Log to write logging information to.
  */
 HDF5DensityFunction::HDF5DensityFunction(
     std::string name, CoordinateVector< uint_fast32_t > ncell, bool read_temps,
                 const double dust_gas_ratio, const double fraction_silicates,
-                const Box<> &simulation_box, Log *log)
+                const Box<> &simulation_box, bool streaming, Log *log)
     : _ncell(ncell), _read_temps(read_temps), _dust_gas_ratio(dust_gas_ratio),
-         _fraction_silicates(fraction_silicates),_log(log)  {
+         _fraction_silicates(fraction_silicates), _streaming(streaming),
+         _log(log)  {
 
 
    _box = simulation_box;
@@ -86,6 +90,17 @@ HDF5DensityFunction::HDF5DensityFunction(
 
   // open the group containing the cell data
   HDF5Tools::HDF5Group maingroup = HDF5Tools::open_group(file, "/PartType0");
+
+  if (_streaming) {
+    // keep the file open, the data are read in evaluate_block()
+    _file = file;
+    _group = maingroup;
+    if (_log) {
+      _log->write_status("Streaming densities from file \"", name, "\".");
+    }
+    return;
+  }
+
   // read the positions, masses
   _densities = HDF5Tools::read_dataset< double >(maingroup, "NumberDensity");
 
@@ -140,6 +155,8 @@ HDF5DensityFunction::HDF5DensityFunction(
  *    simulation (default: false)?
  *  - hubble parameter: Reduced Hubble parameter used for the original
  *    simulation (default: 0.7)
+ *  - streaming: Read the snapshot on demand for every block of cells that is
+ *    initialized, rather than reading it into memory (default: false)
  *
  * @param params ParameterFile to read.
  * @param log Log to write logging information to.
@@ -158,6 +175,7 @@ HDF5DensityFunction::HDF5DensityFunction(
                       "SimulationBox:anchor", "[-5. pc, -5. pc, -5. pc]"),
                   params.get_physical_vector< QUANTITY_LENGTH >(
                       "SimulationBox:sides", "[10. pc, 10. pc, 10. pc]")),
+            params.get_value< bool >("DensityFunction:streaming", false),
             log) {}
 
 /**
@@ -170,46 +188,142 @@ HDF5DensityFunction::~HDF5DensityFunction() {
 }
 
 /**
- * @brief Function that gives the density for a given cell.
+ * @brief Close the snapshot file in streaming mode.
+ */
+void HDF5DensityFunction::free() {
+  if (_streaming) {
+    HDF5Tools::close_group(_group);
+    HDF5Tools::close_file(_file);
+  }
+}
+
+/**
+ * @brief Get the DensityValues for a snapshot cell with the given values.
  *
- * @param cell Geometrical information about the cell.
+ * @param number_density Number density of the snapshot cell (in m^-3).
+ * @param temperature Temperature of the snapshot cell (in K; only used if
+ * temperatures are read).
  * @return Initial physical field values for that cell.
  */
-DensityValues HDF5DensityFunction::operator()(const Cell &cell) {
+DensityValues HDF5DensityFunction::get_values(const double number_density,
+                                              const double temperature) const {
 
   DensityValues values;
 
-  const CoordinateVector<> position = cell.get_cell_midpoint();
-  uint_fast32_t ix, iy, iz;
-   ix = (position.x() - _box.get_anchor().x()) / _box.get_sides().x() *
-        _ncell.x();
-   iy = (position.y() - _box.get_anchor().y()) / _box.get_sides().y() *
-        _ncell.y();
-   iz = (position.z() - _box.get_anchor().z()) / _box.get_sides().z() *
-        _ncell.z();
-
-
+  values.set_number_density(number_density);
+  values.set_dust_gas_ratio(_dust_gas_ratio);
+  values.set_fraction_silicates(_fraction_silicates);
+  if (_read_temps) {
+    values.set_temperature(temperature);
+  } else {
+    values.set_temperature(10000);
+  }
+  values.set_ionic_fraction(ION_H_n, 0.999);
 
+  return values;
+}
 
-   int ind1d = (ix*_ncell.z()*_ncell.y()) + (iy*_ncell.z()) + iz;
+/**
+ * @brief Function that gives the density for a given cell.
+ *
+ * @param cell Geometrical information about the cell.
+ * @return Initial physical field values for that cell.
+ */
+DensityValues HDF5DensityFunction::operator()(const Cell &cell) {
 
+  const CoordinateVector<> position = cell.get_cell_midpoint();
+  const uint_fast32_t ix = get_cell_index(0, position.x());
+  const uint_fast32_t iy = get_cell_index(1, position.y());
+  const uint_fast32_t iz = get_cell_index(2, position.z());
+
+  const uint_fast32_t ind1d =
+      (ix * _ncell.z() * _ncell.y()) + (iy * _ncell.z()) + iz;
+
+  if (_streaming) {
+    // very inefficient, but correct: read the single value we need
+    _file_lock.lock();
+    const double number_density = HDF5Tools::read_dataset_part< double >(
+        _group, "NumberDensity", ind1d, 1)[0];
+    double temperature = 0.;
+    if (_read_temps) {
+      temperature = HDF5Tools::read_dataset_part< double >(
+          _group, "Temperature", ind1d, 1)[0];
+    }
+    _file_lock.unlock();
+    return get_values(number_density, temperature);
+  }
 
-   values.set_number_density(_densities[ind1d]);
+  if (_read_temps) {
+    return get_values(_densities[ind1d], _temperatures[ind1d]);
+  } else {
+    return get_values(_densities[ind1d], 0.);
+  }
+}
 
-   values.set_dust_gas_ratio(_dust_gas_ratio);
+/**
+ * @brief Evaluate the density function for all cells in the given block.
+ *
+ * Only used in streaming mode: we read the box of snapshot cells that overlaps
+ * with the block, map it onto the block and discard it again.
+ *
+ * @param block DensityFunctionBlock to initialize.
+ * @return True if the block was initialized.
+ */
+bool HDF5DensityFunction::evaluate_block(DensityFunctionBlock &block) {
 
-   values.set_fraction_silicates(_fraction_silicates);
-  if (_read_temps){
-    values.set_temperature(_temperatures[ind1d]);
-  } else {
-    values.set_temperature(10000);
+  if (!_streaming) {
+    return false;
   }
-   
-   values.set_ionic_fraction(ION_H_n,0.999);
 
+  // the snapshot cell index in every direction only depends on the
+  // corresponding coordinate of the cell midpoint
+  std::vector< uint_fast32_t > indices[3];
+  hsize_t box_offset[3];
+  hsize_t box_size[3];
+  for (uint_fast8_t idim = 0; idim < 3; ++idim) {
+    const int_fast32_t ncell = block.get_number_of_cells(idim);
+    indices[idim].resize(ncell);
+    for (int_fast32_t i = 0; i < ncell; ++i) {
+      indices[idim][i] =
+          get_cell_index(idim, block.get_cell_midpoint(idim, i));
+    }
+    box_offset[idim] = indices[idim][0];
+    box_size[idim] = indices[idim][ncell - 1] - indices[idim][0] + 1;
+  }
 
+  // read the part of the snapshot that overlaps with the block
+  const hsize_t grid_size[3] = {_ncell.x(), _ncell.y(), _ncell.z()};
+  std::vector< double > number_densities(box_size[0] * box_size[1] *
+                                         box_size[2]);
+  std::vector< double > temperatures;
+  _file_lock.lock();
+  HDF5Tools::read_dataset_box< double >(_group, "NumberDensity", grid_size,
+                                        box_offset, box_size,
+                                        number_densities.data());
+  if (_read_temps) {
+    temperatures.resize(number_densities.size());
+    HDF5Tools::read_dataset_box< double >(_group, "Temperature", grid_size,
+                                          box_offset, box_size,
+                                          temperatures.data());
+  }
+  _file_lock.unlock();
+
+  for (int_fast32_t ix = 0; ix < block.get_number_of_cells(0); ++ix) {
+    const uint_fast32_t jx = indices[0][ix] - box_offset[0];
+    for (int_fast32_t iy = 0; iy < block.get_number_of_cells(1); ++iy) {
+      const uint_fast32_t jy = indices[1][iy] - box_offset[1];
+      for (int_fast32_t iz = 0; iz < block.get_number_of_cells(2); ++iz) {
+        const uint_fast32_t jz = indices[2][iz] - box_offset[2];
+        const uint_fast32_t index = (jx * box_size[1] + jy) * box_size[2] + jz;
+        block.set_values(
+            block.get_index(ix, iy, iz),
+            get_values(number_densities[index],
+                       _read_temps ? temperatures[index] : 0.));
+      }
+    }
+  }
 
-  return values;
+  return true;
 }
 
 /**
@@ -219,6 +333,21 @@ DensityValues HDF5DensityFunction::operator()(const Cell &cell) {
  */
 double HDF5DensityFunction::get_total_hydrogen_number() const {
   double mtot = 0.;
+  if (_streaming) {
+    // read the snapshot one slice at a time
+    const hsize_t slice_size = _ncell.y() * _ncell.z();
+    for (uint_fast32_t ix = 0; ix < _ncell.x(); ++ix) {
+      _file_lock.lock();
+      const std::vector< double > densities =
+          HDF5Tools::read_dataset_part< double >(_group, "NumberDensity",
+                                                 ix * slice_size, slice_size);
+      _file_lock.unlock();
+      for (size_t i = 0; i < densities.size(); ++i) {
+        mtot += densities[i]*_cell_vol;
+      }
+    }
+    return mtot;
+  }
   for (size_t i = 0; i < _densities.size(); ++i) {
     mtot += _densities[i]*_cell_vol;
   }
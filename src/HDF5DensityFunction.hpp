@@ -29,7 +29,9 @@
 
 #include "Box.hpp"
 #include "DensityFunction.hpp"
+#include "HDF5Tools.hpp"
 #include "Octree.hpp"
+#include "ThreadLock.hpp"
 #include <string>
 #include <vector>
 
@@ -38,6 +40,11 @@ class ParameterFile;
 
 /**
  * @brief DensityFunction that reads a density field from an Arepo snapshot.
+ *
+ * In streaming mode, the snapshot is not read into memory by the constructor.
+ * Instead, every call to evaluate_block() only reads the part of the snapshot
+ * that overlaps with the block, and discards it again after the block has been
+ * initialized.
  */
 class HDF5DensityFunction : public DensityFunction {
 private:
@@ -62,6 +69,18 @@ private:
 
   Box<> _box;
 
+  /*! @brief Read the snapshot on demand rather than in the constructor? */
+  const bool _streaming;
+
+  /*! @brief Snapshot file (only kept open in streaming mode). */
+  HDF5Tools::HDF5File _file;
+
+  /*! @brief Group containing the cell data (only kept open in streaming
+   *  mode). */
+  HDF5Tools::HDF5Group _group;
+
+  /*! @brief Lock protecting the HDF5 file in streaming mode. */
+  mutable ThreadLock _file_lock;
 
   /*! @brief Log to write logging info to. */
   Log *_log;
@@ -83,14 +102,36 @@ public:
                              const double dust_gas_ratio,
                              const double fraction_silicates,
                                 const Box<> &simulation_box,
+                                bool streaming = false,
                                 Log *log = nullptr);
 
   HDF5DensityFunction(ParameterFile &params, Log *log = nullptr);
 
   virtual ~HDF5DensityFunction();
 
+  virtual void free();
+
+  /**
+   * @brief Get the index of the snapshot cell that contains the given
+   * coordinate in the given direction.
+   *
+   * @param direction Coordinate direction (0, 1 or 2).
+   * @param x Coordinate (in m).
+   * @return Index of the snapshot cell in that direction.
+   */
+  inline uint_fast32_t get_cell_index(const uint_fast8_t direction,
+                                      const double x) const {
+    return (x - _box.get_anchor()[direction]) / _box.get_sides()[direction] *
+           _ncell[direction];
+  }
+
+  DensityValues get_values(const double number_density,
+                           const double temperature) const;
+
   virtual DensityValues operator()(const Cell &cell);
 
+  virtual bool evaluate_block(DensityFunctionBlock &block);
+
   double get_total_hydrogen_number() const;
 };
 
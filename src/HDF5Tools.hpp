@@ -30,6 +30,7 @@
 #include "CoordinateVector.hpp"
 #include "Error.hpp"
 
+#include <algorithm>
 #include <array>
 #include <cinttypes>
 #include <hdf5.h>
@@ -59,6 +60,55 @@ enum HDF5FileMode {
   HDF5FILEMODE_APPEND
 };
 
+/*! @brief Filters that can be applied to the chunks of a dataset. */
+enum HDF5CompressionFilter {
+  /*! @brief No filter: chunks are stored uncompressed. */
+  HDF5COMPRESSIONFILTER_NONE = 0,
+  /*! @brief Deflate (gzip) compression. */
+  HDF5COMPRESSIONFILTER_DEFLATE,
+  /*! @brief Byte shuffle followed by deflate compression. */
+  HDF5COMPRESSIONFILTER_SHUFFLE_DEFLATE
+};
+
+/**
+ * @brief Get the HDF5CompressionFilter that corresponds to the given name.
+ *
+ * @param name Name of the filter: "none", "deflate" or "shuffle+deflate".
+ * @return Corresponding HDF5CompressionFilter.
+ */
+inline int_fast32_t get_compression_filter(const std::string name) {
+  if (name == "none") {
+    return HDF5COMPRESSIONFILTER_NONE;
+  } else if (name == "deflate") {
+    return HDF5COMPRESSIONFILTER_DEFLATE;
+  } else if (name == "shuffle+deflate") {
+    return HDF5COMPRESSIONFILTER_SHUFFLE_DEFLATE;
+  } else {
+    cmac_error("Unknown compression filter: \"%s\"!", name.c_str());
+    return HDF5COMPRESSIONFILTER_NONE;
+  }
+}
+
+/**
+ * @brief Get the name of the given HDF5CompressionFilter.
+ *
+ * @param filter HDF5CompressionFilter.
+ * @return Name of the filter.
+ */
+inline std::string get_compression_filter_name(const int_fast32_t filter) {
+  switch (filter) {
+  case HDF5COMPRESSIONFILTER_NONE:
+    return "none";
+  case HDF5COMPRESSIONFILTER_DEFLATE:
+    return "deflate";
+  case HDF5COMPRESSIONFILTER_SHUFFLE_DEFLATE:
+    return "shuffle+deflate";
+  default:
+    cmac_error("Unknown compression filter: %" PRIiFAST32 "!", filter);
+    return "";
+  }
+}
+
 /**
  * @brief Turn off default HDF5 error handling.
  */
@@ -927,6 +977,246 @@ read_dataset_part(const hid_t group, const std::string name,
   return datavector;
 }
 
+/**
+ * @brief Get the dimensions of the dataset with the given name in the given
+ * group, without reading the dataset.
+ *
+ * @param group HDF5Group handle to an open group.
+ * @param name Name of the dataset.
+ * @return Size of the dataset in every dimension.
+ */
+inline std::vector< hsize_t > get_dataset_dimensions(const hid_t group,
+                                                     const std::string name) {
+
+// open dataset
+#ifdef HDF5_OLD_API
+  const hid_t dataset = H5Dopen(group, name.c_str());
+#else
+  const hid_t dataset = H5Dopen(group, name.c_str(), H5P_DEFAULT);
+#endif
+  if (dataset < 0) {
+    cmac_error("Failed to open dataset \"%s\"", name.c_str());
+  }
+
+  // open dataspace
+  const hid_t filespace = H5Dget_space(dataset);
+  if (filespace < 0) {
+    cmac_error("Failed to open dataspace of dataset \"%s\"", name.c_str());
+  }
+
+  // query dataspace extents
+  const int_fast32_t ndim = H5Sget_simple_extent_ndims(filespace);
+  if (ndim < 0) {
+    cmac_error("Unable to query extent of dataset \"%s\"", name.c_str());
+  }
+  std::vector< hsize_t > dimensions(ndim);
+  if (H5Sget_simple_extent_dims(filespace, dimensions.data(), nullptr) < 0) {
+    cmac_error("Unable to query extent of dataset \"%s\"", name.c_str());
+  }
+
+  // close dataspace
+  herr_t hdf5status = H5Sclose(filespace);
+  if (hdf5status < 0) {
+    cmac_error("Failed to close dataspace of dataset \"%s\"", name.c_str());
+  }
+
+  // close dataset
+  hdf5status = H5Dclose(dataset);
+  if (hdf5status < 0) {
+    cmac_error("Failed to close dataset \"%s\"", name.c_str());
+  }
+
+  return dimensions;
+}
+
+/**
+ * @brief Read a rectangular hyperslab of the multidimensional dataset with the
+ * given name from the given group into the given array.
+ *
+ * Only the requested part of the dataset is read from the file, so that large
+ * snapshots can be read in pieces.
+ *
+ * @param group HDF5Group handle to an open group.
+ * @param name Name of the dataset to read.
+ * @param offset Offset of the hyperslab in every dimension of the dataset.
+ * @param size Size of the hyperslab in every dimension of the dataset.
+ * @param data Array to store the hyperslab in (needs to be large enough to
+ * store the product of all sizes; values are stored in row-major order).
+ */
+template < typename _datatype_ >
+inline void read_dataset_hyperslab(const hid_t group, const std::string name,
+                                   const std::vector< hsize_t > &offset,
+                                   const std::vector< hsize_t > &size,
+                                   _datatype_ *data) {
+
+  const hid_t datatype = get_datatype_name< _datatype_ >();
+
+// open dataset
+#ifdef HDF5_OLD_API
+  const hid_t dataset = H5Dopen(group, name.c_str());
+#else
+  const hid_t dataset = H5Dopen(group, name.c_str(), H5P_DEFAULT);
+#endif
+  if (dataset < 0) {
+    cmac_error("Failed to open dataset \"%s\"", name.c_str());
+  }
+
+  // open dataspace
+  const hid_t filespace = H5Dget_space(dataset);
+  if (filespace < 0) {
+    cmac_error("Failed to open dataspace of dataset \"%s\"", name.c_str());
+  }
+
+  const int_fast32_t ndim = H5Sget_simple_extent_ndims(filespace);
+  if (ndim != static_cast< int_fast32_t >(offset.size()) ||
+      ndim != static_cast< int_fast32_t >(size.size())) {
+    cmac_error("Wrong number of dimensions for hyperslab of dataset \"%s\" "
+               "(dataset has %" PRIiFAST32 " dimensions)!",
+               name.c_str(), ndim);
+  }
+
+  // select the hyperslab in filespace we want to read from
+  herr_t hdf5status = H5Sselect_hyperslab(filespace, H5S_SELECT_SET,
+                                          offset.data(), nullptr, size.data(),
+                                          nullptr);
+  if (hdf5status < 0) {
+    cmac_error("Failed to select hyperslab in file space of dataset \"%s\"!",
+               name.c_str());
+  }
+
+  // create memory space
+  const hid_t memspace = H5Screate_simple(ndim, size.data(), nullptr);
+  if (memspace < 0) {
+    cmac_error("Failed to create memory space to read dataset \"%s\"!",
+               name.c_str());
+  }
+
+  // read dataset
+  hdf5status =
+      H5Dread(dataset, datatype, memspace, filespace, H5P_DEFAULT, data);
+  if (hdf5status < 0) {
+    cmac_error("Failed to read dataset \"%s\"", name.c_str());
+  }
+
+  // close memory space
+  hdf5status = H5Sclose(memspace);
+  if (hdf5status < 0) {
+    cmac_error("Failed to close memory space of dataset \"%s\"",
+               name.c_str());
+  }
+
+  // close dataspace
+  hdf5status = H5Sclose(filespace);
+  if (hdf5status < 0) {
+    cmac_error("Failed to close dataspace of dataset \"%s\"", name.c_str());
+  }
+
+  // close dataset
+  hdf5status = H5Dclose(dataset);
+  if (hdf5status < 0) {
+    cmac_error("Failed to close dataset \"%s\"", name.c_str());
+  }
+}
+
+/**
+ * @brief Read a rectangular box of cells from the one dimensional dataset with
+ * the given name from the given group into the given array.
+ *
+ * The dataset is assumed to contain the values of a regular 3D grid of cells
+ * stored in row-major order, i.e. the value of cell (ix, iy, iz) is stored at
+ * index (ix * NY + iy) * NZ + iz. The box is selected as a union of strided
+ * hyperslabs, so that a single read operation suffices.
+ *
+ * @param group HDF5Group handle to an open group.
+ * @param name Name of the dataset to read.
+ * @param grid_size Number of cells in every dimension of the grid.
+ * @param box_offset Index of the first cell of the box in every dimension.
+ * @param box_size Number of cells of the box in every dimension.
+ * @param data Array to store the box in (needs to be large enough to store
+ * all cells in the box; values are stored in row-major order).
+ */
+template < typename _datatype_ >
+inline void read_dataset_box(const hid_t group, const std::string name,
+                             const hsize_t grid_size[3],
+                             const hsize_t box_offset[3],
+                             const hsize_t box_size[3], _datatype_ *data) {
+
+  const hid_t datatype = get_datatype_name< _datatype_ >();
+
+// open dataset
+#ifdef HDF5_OLD_API
+  const hid_t dataset = H5Dopen(group, name.c_str());
+#else
+  const hid_t dataset = H5Dopen(group, name.c_str(), H5P_DEFAULT);
+#endif
+  if (dataset < 0) {
+    cmac_error("Failed to open dataset \"%s\"", name.c_str());
+  }
+
+  // open dataspace
+  const hid_t filespace = H5Dget_space(dataset);
+  if (filespace < 0) {
+    cmac_error("Failed to open dataspace of dataset \"%s\"", name.c_str());
+  }
+
+  // select the box: every x row of the box consists of box_size[1] blocks of
+  // box_size[2] consecutive values, separated by a stride grid_size[2]
+  herr_t hdf5status = H5Sselect_none(filespace);
+  if (hdf5status < 0) {
+    cmac_error("Failed to reset selection in file space of dataset \"%s\"!",
+               name.c_str());
+  }
+  const hsize_t stride[1] = {grid_size[2]};
+  const hsize_t count[1] = {box_size[1]};
+  const hsize_t block[1] = {box_size[2]};
+  for (hsize_t ix = 0; ix < box_size[0]; ++ix) {
+    const hsize_t start[1] = {
+        ((box_offset[0] + ix) * grid_size[1] + box_offset[1]) * grid_size[2] +
+        box_offset[2]};
+    hdf5status =
+        H5Sselect_hyperslab(filespace, H5S_SELECT_OR, start, stride, count,
+                            block);
+    if (hdf5status < 0) {
+      cmac_error("Failed to select hyperslab in file space of dataset \"%s\"!",
+                 name.c_str());
+    }
+  }
+
+  // create memory space
+  const hsize_t dims[1] = {box_size[0] * box_size[1] * box_size[2]};
+  const hid_t memspace = H5Screate_simple(1, dims, nullptr);
+  if (memspace < 0) {
+    cmac_error("Failed to create memory space to read dataset \"%s\"!",
+               name.c_str());
+  }
+
+  // read dataset
+  hdf5status =
+      H5Dread(dataset, datatype, memspace, filespace, H5P_DEFAULT, data);
+  if (hdf5status < 0) {
+    cmac_error("Failed to read dataset \"%s\"", name.c_str());
+  }
+
+  // close memory space
+  hdf5status = H5Sclose(memspace);
+  if (hdf5status < 0) {
+    cmac_error("Failed to close memory space of dataset \"%s\"",
+               name.c_str());
+  }
+
+  // close dataspace
+  hdf5status = H5Sclose(filespace);
+  if (hdf5status < 0) {
+    cmac_error("Failed to close dataspace of dataset \"%s\"", name.c_str());
+  }
+
+  // close dataset
+  hdf5status = H5Dclose(dataset);
+  if (hdf5status < 0) {
+    cmac_error("Failed to close dataset \"%s\"", name.c_str());
+  }
+}
+
 /**
  * @brief read_dataset specialization for a CoordinateVector dataset.
  *
@@ -1965,6 +2255,114 @@ inline void append_dataset(hid_t group, std::string name, hsize_t offset,
   delete[] data;
 }
 
+/**
+ * @brief Write a contiguous buffer to a new chunked dataset in a single call.
+ *
+ * Contrary to create_dataset() and append_dataset(), the chunk size and
+ * compression filter can be chosen, and the data is not copied before it is
+ * handed over to the HDF5 library. Multi-component data (e.g. coordinates) is
+ * stored as a 2D dataset with one row per element.
+ *
+ * @param group HDF5Group handle to an open group.
+ * @param name Name of the dataset to create.
+ * @param data Buffer containing the data (of size size x number_of_components).
+ * @param size Number of elements in the dataset.
+ * @param number_of_components Number of components for each element.
+ * @param chunk_size Number of elements in a single chunk.
+ * @param filter HDF5CompressionFilter to apply to the chunks.
+ * @param compression_level Deflate compression level (1-9).
+ * @return Size of the dataset in the file (in bytes).
+ */
+template < typename _datatype_ >
+inline size_t write_dataset_buffer(hid_t group, std::string name,
+                                   const _datatype_ *data, const hsize_t size,
+                                   const hsize_t number_of_components,
+                                   const hsize_t chunk_size,
+                                   const int_fast32_t filter,
+                                   const int_fast32_t compression_level) {
+
+  const hid_t datatype = get_datatype_name< _datatype_ >();
+
+  // create dataspace
+  const int rank = (number_of_components > 1) ? 2 : 1;
+  const hsize_t dims[2] = {size, number_of_components};
+  const hid_t filespace = H5Screate_simple(rank, dims, nullptr);
+  if (filespace < 0) {
+    cmac_error("Failed to create dataspace for dataset \"%s\"!", name.c_str());
+  }
+
+  // set up chunking and filters (an empty dataset cannot be chunked)
+  const hid_t prop = H5Pcreate(H5P_DATASET_CREATE);
+  herr_t hdf5status;
+  if (size > 0) {
+    const hsize_t chunk[2] = {std::max(std::min(size, chunk_size), hsize_t(1)),
+                              number_of_components};
+    hdf5status = H5Pset_chunk(prop, rank, chunk);
+    if (hdf5status < 0) {
+      cmac_error("Failed to set chunk size for dataset \"%s\"", name.c_str());
+    }
+
+    if (filter == HDF5COMPRESSIONFILTER_SHUFFLE_DEFLATE) {
+      hdf5status = H5Pset_shuffle(prop);
+      if (hdf5status < 0) {
+        cmac_error("Failed to set shuffle filter for dataset \"%s\"",
+                   name.c_str());
+      }
+    }
+    if (filter != HDF5COMPRESSIONFILTER_NONE) {
+      hdf5status = H5Pset_deflate(prop, compression_level);
+      if (hdf5status < 0) {
+        cmac_error("Failed to set compression for dataset \"%s\"",
+                   name.c_str());
+      }
+    }
+  }
+
+// create dataset
+#ifdef HDF5_OLD_API
+  const hid_t dataset =
+      H5Dcreate(group, name.c_str(), datatype, filespace, prop);
+#else
+  const hid_t dataset = H5Dcreate(group, name.c_str(), datatype, filespace,
+                                  H5P_DEFAULT, prop, H5P_DEFAULT);
+#endif
+  if (dataset < 0) {
+    cmac_error("Failed to create dataset \"%s\"", name.c_str());
+  }
+
+  // write dataset
+  if (size > 0) {
+    hdf5status =
+        H5Dwrite(dataset, datatype, H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
+    if (hdf5status < 0) {
+      cmac_error("Failed to write dataset \"%s\"", name.c_str());
+    }
+  }
+
+  const size_t storage_size = H5Dget_storage_size(dataset);
+
+  // close creation properties
+  hdf5status = H5Pclose(prop);
+  if (hdf5status < 0) {
+    cmac_error("Failed to close creation properties for dataset \"%s\"",
+               name.c_str());
+  }
+
+  // close dataspace
+  hdf5status = H5Sclose(filespace);
+  if (hdf5status < 0) {
+    cmac_error("Failed to close dataspace of dataset \"%s\"", name.c_str());
+  }
+
+  // close dataset
+  hdf5status = H5Dclose(dataset);
+  if (hdf5status < 0) {
+    cmac_error("Failed to close dataset \"%s\"", name.c_str());
+  }
+
+  return storage_size;
+}
+
 /**
  * @brief Create a new data table with the given name, number of rows and number
  * of columns in the given group.
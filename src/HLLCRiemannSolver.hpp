@@ -38,6 +38,10 @@
 #include <cinttypes>
 #include <cmath>
 
+/*! @brief Number of interfaces that are solved simultaneously by
+ *  HLLCRiemannSolver::solve_for_flux_batch(). */
+#define HLLCRIEMANNSOLVER_BATCH_SIZE 8
+
 /**
  * @brief HLLC Riemann solver.
  */
@@ -512,6 +516,224 @@ public:
         Utilities::as_bytes(uR[0]), Utilities::as_bytes(uR[1]),
         Utilities::as_bytes(uR[2]), PR, Utilities::as_bytes(PR));
   }
+
+  /**
+   * @brief Solve the Riemann problem for a batch of interfaces with the same
+   * coordinate axis as surface normal and a zero interface velocity.
+   *
+   * The states are stored as a structure of arrays, so that every step of the
+   * solver is a simple loop over HLLCRIEMANNSOLVER_BATCH_SIZE interfaces that
+   * can be vectorized by the compiler. Branches are replaced by selections
+   * between values that are computed for all interfaces. Interfaces that
+   * involve vacuum (or generate vacuum) are not handled; they are flagged and
+   * need to be solved with solve_for_flux() instead.
+   *
+   * For interfaces that are not flagged, the result is the same as that of
+   * solve_for_flux(): all expressions are evaluated in the same order, so
+   * that both are bitwise identical unless the compiler contracts floating
+   * point operations (e.g. into fused multiply-adds) differently in the
+   * vectorized code.
+   *
+   * @param i Coordinate axis of the surface normal: x (0), y (1) or z (2).
+   * @param WL Left states: density, velocity components and pressure.
+   * @param WR Right states: density, velocity components and pressure.
+   * @param mflux Mass flux solutions.
+   * @param pflux Momentum flux solutions.
+   * @param Eflux Energy flux solutions.
+   * @param fallback Flags indicating interfaces for which no solution was
+   * computed.
+   */
+  inline void
+  solve_for_flux_batch(const uint_fast8_t i,
+                       const double WL[5][HLLCRIEMANNSOLVER_BATCH_SIZE],
+                       const double WR[5][HLLCRIEMANNSOLVER_BATCH_SIZE],
+                       double mflux[HLLCRIEMANNSOLVER_BATCH_SIZE],
+                       double pflux[3][HLLCRIEMANNSOLVER_BATCH_SIZE],
+                       double Eflux[HLLCRIEMANNSOLVER_BATCH_SIZE],
+                       bool fallback[HLLCRIEMANNSOLVER_BATCH_SIZE]) const {
+
+    // components of the surface normal
+    const double normal[3] = {(i == 0) ? 1. : 0., (i == 1) ? 1. : 0.,
+                              (i == 2) ? 1. : 0.};
+
+    // the solver is split in a number of loops, so that the square roots
+    // (which cannot be vectorized if they are allowed to set errno) do not
+    // prevent the vectorization of the other loops
+    // we use local copies of the class constants and local result arrays, so
+    // that the compiler does not need to worry about aliasing
+    const double gamma = _gamma;
+    const double tdgm1 = _tdgm1;
+    const double gp1d2g = _gp1d2g;
+    const double odgm1 = _odgm1;
+    double rhoLinv[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    double rhoRinv[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    double PLinv[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    double PRinv[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    double vL[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    double vR[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    double aL[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    double aR[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    for (uint_fast32_t k = 0; k < HLLCRIEMANNSOLVER_BATCH_SIZE; ++k) {
+
+      rhoLinv[k] = 1. / (WL[0][k] + DBL_MIN);
+      rhoRinv[k] = 1. / (WR[0][k] + DBL_MIN);
+      PLinv[k] = 1. / (WL[4][k] + DBL_MIN);
+      PRinv[k] = 1. / (WR[4][k] + DBL_MIN);
+
+      // get the velocities along the surface normal of the interface
+      vL[k] = WL[1][k] * normal[0] + WL[2][k] * normal[1] +
+              WL[3][k] * normal[2];
+      vR[k] = WR[1][k] * normal[0] + WR[2][k] * normal[1] +
+              WR[3][k] * normal[2];
+
+      // squared sound speeds
+      aL[k] = gamma * WL[4][k] * rhoLinv[k];
+      aR[k] = gamma * WR[4][k] * rhoRinv[k];
+    }
+
+    for (uint_fast32_t k = 0; k < HLLCRIEMANNSOLVER_BATCH_SIZE; ++k) {
+      aL[k] = std::sqrt(aL[k]);
+      aR[k] = std::sqrt(aR[k]);
+    }
+
+    // flag interfaces that involve vacuum; this is done in a separate loop
+    // since mixing boolean and double precision results in the same loop
+    // prevents vectorization
+    for (uint_fast32_t k = 0; k < HLLCRIEMANNSOLVER_BATCH_SIZE; ++k) {
+      const bool vacuumL = (WL[0][k] == 0.) | std::isinf(rhoLinv[k]) |
+                           (WL[4][k] == 0.) | std::isinf(PLinv[k]);
+      const bool vacuumR = (WR[0][k] == 0.) | std::isinf(rhoRinv[k]) |
+                           (WR[4][k] == 0.) | std::isinf(PRinv[k]);
+      fallback[k] =
+          vacuumL | vacuumR | (tdgm1 * (aL[k] + aR[k]) <= vR[k] - vL[k]);
+    }
+
+    double pstar[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    double qL[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    double qR[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    for (uint_fast32_t k = 0; k < HLLCRIEMANNSOLVER_BATCH_SIZE; ++k) {
+
+      const double rhoL = WL[0][k];
+      const double PL = WL[4][k];
+      const double rhoR = WR[0][k];
+      const double PR = WR[4][k];
+
+      const double vdiff = vR[k] - vL[k];
+      const double abar = aL[k] + aR[k];
+
+      // STEP 1: pressure estimate
+      const double rhobar = rhoL + rhoR;
+      const double Pbar = PL + PR;
+      const double pPVRS = 0.5 * (Pbar - 0.25 * vdiff * rhobar * abar);
+      pstar[k] = std::max(0., pPVRS);
+
+      // STEP 2: wave speed estimates (squared), sqrt(1.) = 1. is exact
+      const double qL2 = 1. + gp1d2g * (pstar[k] * PLinv[k] - 1.);
+      const double qR2 = 1. + gp1d2g * (pstar[k] * PRinv[k] - 1.);
+      qL[k] = (pstar[k] > PL) ? qL2 : 1.;
+      qR[k] = (pstar[k] > PR) ? qR2 : 1.;
+    }
+
+    for (uint_fast32_t k = 0; k < HLLCRIEMANNSOLVER_BATCH_SIZE; ++k) {
+      qL[k] = std::sqrt(qL[k]);
+      qR[k] = std::sqrt(qR[k]);
+    }
+
+    double mfluxk[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    double pfluxk[3][HLLCRIEMANNSOLVER_BATCH_SIZE];
+    double Efluxk[HLLCRIEMANNSOLVER_BATCH_SIZE];
+
+    for (uint_fast32_t k = 0; k < HLLCRIEMANNSOLVER_BATCH_SIZE; ++k) {
+
+      const double rhoL = WL[0][k];
+      const double PL = WL[4][k];
+      const double rhoR = WR[0][k];
+      const double PR = WR[4][k];
+
+      // see solve_for_flux() for the importance of the exact form of these
+      // expressions
+      const double SLmvL = -aL[k] * qL[k];
+      const double SRmvR = aR[k] * qR[k];
+      const double Pdiff = PR - PL;
+      const double rhovSdiff = rhoL * vL[k] * SLmvL - rhoR * vR[k] * SRmvR;
+      const double rhoSdiff = rhoL * SLmvL - rhoR * SRmvR;
+      const double Sstar = (Pdiff + rhovSdiff) / (rhoSdiff + DBL_MIN);
+
+      // left state flux
+      const double rhoLvL = rhoL * vL[k];
+      const double vL2 =
+          WL[1][k] * WL[1][k] + WL[2][k] * WL[2][k] + WL[3][k] * WL[3][k];
+      const double eL = PL * odgm1 * rhoLinv[k] + 0.5 * vL2;
+      const double SL = SLmvL + vL[k];
+      const double starfacL = SLmvL / (SL - Sstar);
+      const double SLrhoL = SL * rhoL;
+      const double SstarmvL = Sstar - vL[k];
+      const double SLrhoLstarfac = SLrhoL * (starfacL - 1.);
+      const double SLrhoLSstarmvL = SLrhoL * SstarmvL * starfacL;
+      const double SLmvLinv = 1. / (SLmvL + DBL_MIN);
+      const bool starL = (SL < 0.);
+
+      // right state flux
+      const double rhoRvR = rhoR * vR[k];
+      const double vR2 =
+          WR[1][k] * WR[1][k] + WR[2][k] * WR[2][k] + WR[3][k] * WR[3][k];
+      const double eR = PR * odgm1 * rhoRinv[k] + 0.5 * vR2;
+      const double SR = SRmvR + vR[k];
+      const double starfacR = SRmvR / (SR - Sstar);
+      const double SRrhoR = SR * rhoR;
+      const double SstarmvR = Sstar - vR[k];
+      const double SRrhoRstarfac = SRrhoR * (starfacR - 1.);
+      const double SRrhoRSstarmvR = SRrhoR * SstarmvR * starfacR;
+      const double SRmvRinv = 1. / (SRmvR + DBL_MIN);
+      const bool starR = (SR > 0.);
+
+      const bool left = (Sstar >= 0.);
+
+      const double mfluxL0 = rhoLvL;
+      const double mfluxL =
+          starL ? mfluxL0 + SLrhoLstarfac : mfluxL0;
+      const double mfluxR0 = rhoRvR;
+      const double mfluxR =
+          starR ? mfluxR0 + SRrhoRstarfac : mfluxR0;
+      mfluxk[k] = left ? mfluxL : mfluxR;
+
+      for (uint_fast8_t j = 0; j < 3; ++j) {
+        const double pfluxL0 = rhoLvL * WL[1 + j][k] + PL * normal[j];
+        const double pfluxL =
+            starL ? pfluxL0 + (SLrhoLstarfac * WL[1 + j][k] +
+                               SLrhoLSstarmvL * normal[j])
+                  : pfluxL0;
+        const double pfluxR0 = rhoRvR * WR[1 + j][k] + PR * normal[j];
+        const double pfluxR =
+            starR ? pfluxR0 + (SRrhoRstarfac * WR[1 + j][k] +
+                               SRrhoRSstarmvR * normal[j])
+                  : pfluxR0;
+        pfluxk[j][k] = left ? pfluxL : pfluxR;
+      }
+
+      const double EfluxL0 = rhoLvL * eL + PL * vL[k];
+      const double EfluxL =
+          starL ? EfluxL0 + (SLrhoLstarfac * eL +
+                             SLrhoLSstarmvL *
+                                 (Sstar + PL * rhoLinv[k] * SLmvLinv))
+                : EfluxL0;
+      const double EfluxR0 = rhoRvR * eR + PR * vR[k];
+      const double EfluxR =
+          starR ? EfluxR0 + (SRrhoRstarfac * eR +
+                             SRrhoRSstarmvR *
+                                 (Sstar + PR * rhoRinv[k] * SRmvRinv))
+                : EfluxR0;
+      Efluxk[k] = left ? EfluxL : EfluxR;
+    }
+
+    for (uint_fast32_t k = 0; k < HLLCRIEMANNSOLVER_BATCH_SIZE; ++k) {
+      mflux[k] = mfluxk[k];
+      pflux[0][k] = pfluxk[0][k];
+      pflux[1][k] = pfluxk[1][k];
+      pflux[2][k] = pfluxk[2][k];
+      Eflux[k] = Efluxk[k];
+    }
+  }
 };
 
 #endif // HLLCRIEMANNSOLVER_HPP
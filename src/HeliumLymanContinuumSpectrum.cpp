@@ -32,7 +32,7 @@
 #include "CrossSections.hpp"
 #include "ElementNames.hpp"
 #include "PhysicalConstants.hpp"
-#include "Utilities.hpp"
+#include <algorithm>
 #include <cmath>
 
 /**
@@ -48,6 +48,7 @@ HeliumLymanContinuumSpectrum::HeliumLymanContinuumSpectrum(
   // allocate memory for the data tables
   _frequency.resize(HELIUMLYMANCONTINUUMSPECTRUM_NUMFREQ, 0.);
   _temperature.resize(HELIUMLYMANCONTINUUMSPECTRUM_NUMTEMP, 0.);
+  _alias_tables.resize(HELIUMLYMANCONTINUUMSPECTRUM_NUMTEMP);
   _cumulative_distribution.resize(
       HELIUMLYMANCONTINUUMSPECTRUM_NUMTEMP,
       std::vector< double >(HELIUMLYMANCONTINUUMSPECTRUM_NUMFREQ, 0.));
@@ -72,6 +73,8 @@ HeliumLymanContinuumSpectrum::HeliumLymanContinuumSpectrum(
   }
 
   // set up the temperature bins and precompute the spectrum
+  // the temperature bins are equally spaced
+  _inverse_temperature_step = HELIUMLYMANCONTINUUMSPECTRUM_NUMTEMP / 13500.;
   for (uint_fast32_t iT = 0; iT < HELIUMLYMANCONTINUUMSPECTRUM_NUMTEMP; ++iT) {
     _cumulative_distribution[iT][0] = 0.;
     _temperature[iT] =
@@ -129,16 +132,25 @@ HeliumLymanContinuumSpectrum::HeliumLymanContinuumSpectrum(
           _cumulative_distribution[iT]
                                   [HELIUMLYMANCONTINUUMSPECTRUM_NUMFREQ - 1];
     }
+#ifdef HAS_HELIUM
+    _alias_tables[iT].initialize(_cumulative_distribution[iT].data(),
+                                 HELIUMLYMANCONTINUUMSPECTRUM_NUMFREQ);
+#endif
   }
 }
 
 /**
  * @brief Sample a random frequency from the spectrum.
  *
- * We first locate the given temperature value in the temperature table. Then we
- * generate a random uniform number and locate it in the two cumulative
- * distributions that border the temperature value. The sampled frequency is
- * then given by linear interpolation on the temperature and frequency tables.
+ * The spectrum at the given temperature is obtained by linear interpolation
+ * in between the spectra for the two bracketing temperature bins. We sample
+ * this interpolated spectrum by randomly selecting one of the two bins, with a
+ * probability given by the linear interpolation weight, and by sampling the
+ * alias table for that bin. The sampled frequency is then linearly
+ * interpolated within the sampled frequency bin.
+ *
+ * The temperature bins are equally spaced, so that no search is required to
+ * locate the temperature.
  *
  * @param random_generator RandomGenerator to use.
  * @param temperature Temperature of the cell that reemits the photon (in K).
@@ -147,20 +159,17 @@ HeliumLymanContinuumSpectrum::HeliumLymanContinuumSpectrum(
 double HeliumLymanContinuumSpectrum::get_random_frequency(
     RandomGenerator &random_generator, double temperature) const {
 
-  const uint_fast32_t iT = Utilities::locate(
-      temperature, _temperature.data(), HELIUMLYMANCONTINUUMSPECTRUM_NUMTEMP);
-  const double x = random_generator.get_uniform_random_double();
-  const uint_fast32_t inu1 =
-      Utilities::locate(x, _cumulative_distribution[iT].data(),
-                        HELIUMLYMANCONTINUUMSPECTRUM_NUMFREQ);
-  const uint_fast32_t inu2 =
-      Utilities::locate(x, _cumulative_distribution[iT + 1].data(),
-                        HELIUMLYMANCONTINUUMSPECTRUM_NUMFREQ);
-  const double frequency =
-      _frequency[inu1] + (temperature - _temperature[iT]) *
-                             (_frequency[inu2] - _frequency[inu1]) /
-                             (_temperature[iT + 1] - _temperature[iT]);
-  return frequency;
+  double uT = (temperature - _temperature[0]) * _inverse_temperature_step;
+  uT = std::max(0., std::min(uT, HELIUMLYMANCONTINUUMSPECTRUM_NUMTEMP - 1.));
+  uint_fast32_t iT = uT;
+  if (iT == HELIUMLYMANCONTINUUMSPECTRUM_NUMTEMP - 1) {
+    --iT;
+  }
+  if (random_generator.get_uniform_random_double() < uT - iT) {
+    ++iT;
+  }
+  return _alias_tables[iT].sample_linear(
+      random_generator.get_uniform_random_double(), _frequency.data());
 }
 
 /**
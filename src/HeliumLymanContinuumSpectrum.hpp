@@ -26,6 +26,7 @@
 #ifndef HELIUMLYMANCONTINUUMSPECTRUM_HPP
 #define HELIUMLYMANCONTINUUMSPECTRUM_HPP
 
+#include "AliasTable.hpp"
 #include "PhotonSourceSpectrum.hpp"
 #include "RandomGenerator.hpp"
 
@@ -47,7 +48,8 @@ class CrossSections;
  * equation (8), which uses the same ionization cross sections that are used in
  * other parts of the program. We pretabulate values in a 2D temperature
  * frequency space in the range [1,500 K; 15,000 K] (for temperature values
- * outside this range, extrapolation is safe).
+ * outside this range, we use the spectrum for the closest tabulated
+ * temperature).
  */
 class HeliumLymanContinuumSpectrum : public PhotonSourceSpectrum {
 private:
@@ -57,9 +59,16 @@ private:
   /*! @brief Temperature bins (in K). */
   std::vector< double > _temperature;
 
+  /*! @brief Inverse of the spacing of the temperature bins (in K^-1). */
+  double _inverse_temperature_step;
+
   /*! @brief Cumulative distribution function. */
   std::vector< std::vector< double > > _cumulative_distribution;
 
+  /*! @brief Alias tables used to sample the cumulative distribution function
+   *  for each temperature. */
+  std::vector< AliasTable > _alias_tables;
+
 public:
   HeliumLymanContinuumSpectrum(const CrossSections &cross_sections);
 
@@ -98,6 +98,8 @@ HeliumTwoPhotonContinuumSpectrum::HeliumTwoPhotonContinuumSpectrum() {
     _cumulative_distribution[i] /=
         _cumulative_distribution[HELIUMTWOPHOTONCONTINUUMSPECTRUM_NUMFREQ - 1];
   }
+  _alias_table.initialize(_cumulative_distribution.data(),
+                          HELIUMTWOPHOTONCONTINUUMSPECTRUM_NUMFREQ);
 }
 
 /**
@@ -156,9 +158,9 @@ double HeliumTwoPhotonContinuumSpectrum::get_integral(
 /**
  * @brief Get a random frequency distributed according to the spectrum.
  *
- * We first sample a random uniform number, and locate the position of that
- * number in the normalized cumulative distribution table. We then linearly
- * interpolate within the bin that contains the random number.
+ * We use an alias table to select a bin of the normalized cumulative
+ * distribution table in constant time. We then linearly interpolate within that
+ * bin.
  *
  * @param random_generator RandomGenerator to use.
  * @param temperature Temperature of the cell that reemits the photon (in K).
@@ -167,16 +169,8 @@ double HeliumTwoPhotonContinuumSpectrum::get_integral(
 double HeliumTwoPhotonContinuumSpectrum::get_random_frequency(
     RandomGenerator &random_generator, double temperature) const {
 
-  const double x = random_generator.get_uniform_random_double();
-  const uint_fast32_t inu =
-      Utilities::locate(x, _cumulative_distribution.data(),
-                        HELIUMTWOPHOTONCONTINUUMSPECTRUM_NUMFREQ);
-  const double frequency =
-      _frequency[inu] +
-      (_frequency[inu + 1] - _frequency[inu]) *
-          (x - _cumulative_distribution[inu]) /
-          (_cumulative_distribution[inu + 1] - _cumulative_distribution[inu]);
-  return frequency;
+  return _alias_table.sample_linear(
+      random_generator.get_uniform_random_double(), _frequency.data());
 }
 
 /**
@@ -26,6 +26,7 @@
 #ifndef HELIUMTWOPHOTONCONTINUUMSPECTRUM_HPP
 #define HELIUMTWOPHOTONCONTINUUMSPECTRUM_HPP
 
+#include "AliasTable.hpp"
 #include "PhotonSourceSpectrum.hpp"
 #include "RandomGenerator.hpp"
 
@@ -51,6 +52,10 @@ private:
   /*! @brief Cumulative distribution function. */
   std::vector< double > _cumulative_distribution;
 
+  /*! @brief Alias table used to sample the cumulative distribution function.
+   */
+  AliasTable _alias_table;
+
 public:
   HeliumTwoPhotonContinuumSpectrum();
 
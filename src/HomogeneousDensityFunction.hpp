@@ -27,6 +27,7 @@
 #define HOMOGENEOUSDENSITYFUNCTION_HPP
 
 #include "DensityFunction.hpp"
+#include "DensityFunctionBlock.hpp"
 #include "Log.hpp"
 #include "ParameterFile.hpp"
 
@@ -100,12 +101,11 @@ public:
             log) {}
 
   /**
-   * @brief Function that gives the density for a given cell.
+   * @brief Get the values for a single cell.
    *
-   * @param cell Geometrical information about the cell.
-   * @return Initial physical field values for that cell.
+   * @return Initial physical field values for every cell.
    */
-  virtual DensityValues operator()(const Cell &cell) {
+  inline DensityValues get_values() const {
     DensityValues values;
     values.set_number_density(_density);
     values.set_temperature(_temperature);
@@ -145,6 +145,29 @@ public:
 #endif
     return values;
   }
+
+  /**
+   * @brief Function that gives the density for a given cell.
+   *
+   * @param cell Geometrical information about the cell.
+   * @return Initial physical field values for that cell.
+   */
+  virtual DensityValues operator()(const Cell &cell) { return get_values(); }
+
+  /**
+   * @brief Initialize all cells in the given block at once.
+   *
+   * @param block DensityFunctionBlock to initialize.
+   * @return True, since the block is always initialized.
+   */
+  virtual bool evaluate_block(DensityFunctionBlock &block) {
+    const DensityValues values = get_values();
+    const int_fast32_t number_of_cells = block.get_total_number_of_cells();
+    for (int_fast32_t i = 0; i < number_of_cells; ++i) {
+      block.set_values(i, values);
+    }
+    return true;
+  }
 };
 
 #endif // HOMOGENEOUSDENSITYFUNCTION_HPP
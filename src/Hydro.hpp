@@ -552,6 +552,186 @@ public:
     right_state.delta_conserved(4) += Eflux;
   }
 
+  /**
+   * @brief Do the flux calculation for a batch of interfaces with the same
+   * orientation.
+   *
+   * This function is equivalent to calling do_flux_calculation() for every
+   * interface in the batch, in order. The variables of the left and right
+   * states are first gathered into a structure of arrays, so that the Riemann
+   * solver and flux limiter can be vectorized across the batch. Interfaces that the batched Riemann solver cannot handle
+   * (vacuum) are passed on to do_flux_calculation().
+   *
+   * @param i Interface direction: x (0), y (1) or z (2).
+   * @param left_states Left state hydro variables of all interfaces.
+   * @param right_states Right state hydro variables of all interfaces.
+   * @param dx Distance between left and right state midpoint (in m).
+   * @param A Surface area of the interfaces (in m^2).
+   * @param dt Current system time step, used for flux limiter (in s).
+   */
+  inline void do_flux_calculation_batch(
+      const uint_fast8_t i,
+      HydroVariables *const left_states[HLLCRIEMANNSOLVER_BATCH_SIZE],
+      HydroVariables *const right_states[HLLCRIEMANNSOLVER_BATCH_SIZE],
+      const double dx, const double A, const double dt) const {
+
+    const uint_fast32_t batch_size = HLLCRIEMANNSOLVER_BATCH_SIZE;
+
+    // gather the primitive variables and their gradients in direction i
+    double WL[5][HLLCRIEMANNSOLVER_BATCH_SIZE];
+    double WR[5][HLLCRIEMANNSOLVER_BATCH_SIZE];
+    double gradWL[5][HLLCRIEMANNSOLVER_BATCH_SIZE];
+    double gradWR[5][HLLCRIEMANNSOLVER_BATCH_SIZE];
+    for (uint_fast32_t k = 0; k < batch_size; ++k) {
+      for (uint_fast8_t j = 0; j < 5; ++j) {
+        WL[j][k] = left_states[k]->primitives(j);
+        WR[j][k] = right_states[k]->primitives(j);
+        gradWL[j][k] = left_states[k]->primitive_gradients(j)[i];
+        gradWR[j][k] = right_states[k]->primitive_gradients(j)[i];
+      }
+    }
+
+    // reconstruct and limit the primitive variables at the interface
+    const double halfdx = 0.5 * dx;
+    double WLface[5][HLLCRIEMANNSOLVER_BATCH_SIZE];
+    double WRface[5][HLLCRIEMANNSOLVER_BATCH_SIZE];
+    for (uint_fast8_t j = 0; j < 5; ++j) {
+      for (uint_fast32_t k = 0; k < batch_size; ++k) {
+        WLface[j][k] =
+            limit(WL[j][k] + halfdx * gradWL[j][k], WL[j][k], WR[j][k], 0.5);
+        WRface[j][k] =
+            limit(WR[j][k] - halfdx * gradWR[j][k], WR[j][k], WL[j][k], 0.5);
+      }
+    }
+
+    // make sure all densities and pressures are physical
+    for (uint_fast32_t k = 0; k < batch_size; ++k) {
+#ifdef SAFE_HYDRO_VARIABLES
+      WLface[0][k] = std::max(WLface[0][k], 0.);
+      WLface[4][k] = std::max(WLface[4][k], 0.);
+      WRface[0][k] = std::max(WRface[0][k], 0.);
+      WRface[4][k] = std::max(WRface[4][k], 0.);
+#else
+      cmac_assert(WLface[0][k] >= 0.);
+      cmac_assert(WLface[4][k] >= 0.);
+      cmac_assert(WRface[0][k] >= 0.);
+      cmac_assert(WRface[4][k] >= 0.);
+#endif
+    }
+
+    double mflux[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    double pflux[3][HLLCRIEMANNSOLVER_BATCH_SIZE];
+    double Eflux[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    bool fallback[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    _riemann_solver.solve_for_flux_batch(i, WLface, WRface, mflux, pflux,
+                                         Eflux, fallback);
+
+    for (uint_fast32_t k = 0; k < batch_size; ++k) {
+      mflux[k] *= A;
+      pflux[0][k] *= A;
+      pflux[1][k] *= A;
+      pflux[2][k] *= A;
+      Eflux[k] *= A;
+    }
+
+#ifdef FLUX_LIMITER
+    // gather the conserved variables used by the flux limiter
+    double mL[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    double mR[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    double EL[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    double ER[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    double p2L[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    double p2R[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    for (uint_fast32_t k = 0; k < batch_size; ++k) {
+      mL[k] = left_states[k]->get_conserved_mass();
+      mR[k] = right_states[k]->get_conserved_mass();
+      EL[k] = left_states[k]->get_conserved_total_energy();
+      ER[k] = right_states[k]->get_conserved_total_energy();
+      p2L[k] = left_states[k]->get_conserved_momentum().norm2();
+      p2R[k] = right_states[k]->get_conserved_momentum().norm2();
+    }
+
+    // limit the flux, using exactly the same expressions as
+    // do_flux_calculation()
+    // the square roots for the momentum flux limiter are taken in a separate
+    // loop; interfaces that do not need momentum limiting use a dummy value
+    // that does not affect the result
+    const double FL = FLUX_LIMITER;
+    double fluxfac[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    double pfluxfacL[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    double pfluxfacR[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    for (uint_fast32_t k = 0; k < batch_size; ++k) {
+      const double absmflux = mflux[k] * dt;
+      double fac = (absmflux > FL * mL[k]) ? FL * mL[k] / absmflux : 1.;
+      fac = (-absmflux > FL * mR[k]) ? std::min(fac, -FL * mR[k] / absmflux)
+                                     : fac;
+      const double absEflux = Eflux[k] * dt;
+      fac = (_gamma > 1. && absEflux > FL * EL[k])
+                ? std::min(fac, FL * EL[k] / absEflux)
+                : fac;
+      fac = (_gamma > 1. && -absEflux > FL * ER[k])
+                ? std::min(fac, -FL * ER[k] / absEflux)
+                : fac;
+      fluxfac[k] = fac;
+
+      const double pflux2 = (pflux[0][k] * pflux[0][k] +
+                             pflux[1][k] * pflux[1][k] +
+                             pflux[2][k] * pflux[2][k]) *
+                            dt * dt;
+      // note that the condition for the right state uses the left momentum,
+      // like in do_flux_calculation()
+      const double m2L = mL[k] * mL[k];
+      pfluxfacL[k] = (p2L[k] * WL[0][k] > _gamma * m2L * WL[4][k] &&
+                      pflux2 > (FL * FL) * p2L[k])
+                         ? (FL * FL) * p2L[k] / pflux2
+                         : DBL_MAX;
+      const double m2R = mR[k] * mR[k];
+      pfluxfacR[k] = (p2L[k] * WR[0][k] > _gamma * m2R * WR[4][k] &&
+                      pflux2 > (FL * FL) * p2R[k])
+                         ? (FL * FL) * p2R[k] / pflux2
+                         : DBL_MAX;
+    }
+
+    for (uint_fast32_t k = 0; k < batch_size; ++k) {
+      pfluxfacL[k] = std::sqrt(pfluxfacL[k]);
+      pfluxfacR[k] = std::sqrt(pfluxfacR[k]);
+    }
+
+    for (uint_fast32_t k = 0; k < batch_size; ++k) {
+      const double fac =
+          std::min(std::min(fluxfac[k], pfluxfacL[k]), pfluxfacR[k]);
+      mflux[k] *= fac;
+      pflux[0][k] *= fac;
+      pflux[1][k] *= fac;
+      pflux[2][k] *= fac;
+      Eflux[k] *= fac;
+    }
+#endif
+
+    // accumulate the fluxes, in the same order as do_flux_calculation()
+    for (uint_fast32_t k = 0; k < batch_size; ++k) {
+      if (fallback[k]) {
+        do_flux_calculation(i, *left_states[k], *right_states[k], dx, A, dt);
+        continue;
+      }
+
+      HydroVariables &left_state = *left_states[k];
+      HydroVariables &right_state = *right_states[k];
+
+      left_state.delta_conserved(0) -= mflux[k];
+      left_state.delta_conserved(1) -= pflux[0][k];
+      left_state.delta_conserved(2) -= pflux[1][k];
+      left_state.delta_conserved(3) -= pflux[2][k];
+      left_state.delta_conserved(4) -= Eflux[k];
+
+      right_state.delta_conserved(0) += mflux[k];
+      right_state.delta_conserved(1) += pflux[0][k];
+      right_state.delta_conserved(2) += pflux[1][k];
+      right_state.delta_conserved(3) += pflux[2][k];
+      right_state.delta_conserved(4) += Eflux[k];
+    }
+  }
+
   /**
    * @brief Do the flux calculation across a box boundary.
    *
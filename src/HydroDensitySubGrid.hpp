@@ -26,6 +26,7 @@
 #ifndef HYDRODENSITYSUBGRID_HPP
 #define HYDRODENSITYSUBGRID_HPP
 
+#include "Configuration.hpp"
 #include "DensitySubGrid.hpp"
 #include "DensityValues.hpp"
 #include "Hydro.hpp"
@@ -292,10 +293,84 @@ public:
    * @brief Compute the hydrodynamical fluxes for all interfaces inside the
    * subgrid.
    *
+   * Uses inner_flux_sweep_batch() if the code was configured with batched
+   * hydro (CMake option BATCHED_HYDRO), and inner_flux_sweep_scalar()
+   * otherwise.
+   *
    * @param hydro Hydro instance to use.
    * @param dt Current system time step (in s).
    */
   inline void inner_flux_sweep(const Hydro &hydro, const double dt) {
+#ifdef USE_BATCHED_HYDRO
+    inner_flux_sweep_batch(hydro, dt);
+#else
+    inner_flux_sweep_scalar(hydro, dt);
+#endif
+  }
+
+  /**
+   * @brief Compute the hydrodynamical fluxes for all interfaces inside the
+   * subgrid, in batches of interfaces.
+   *
+   * Interfaces are processed in batches of HLLCRIEMANNSOLVER_BATCH_SIZE using
+   * Hydro::do_flux_calculation_batch(), so that the compiler can vectorize the
+   * flux calculation across interfaces. Interfaces that do not fill a complete
+   * batch are handled by Hydro::do_flux_calculation(). Interfaces are visited
+   * in the same order as in inner_flux_sweep_scalar(), so that both functions
+   * give the same result.
+   *
+   * This is only faster than inner_flux_sweep_scalar() if the compiler is
+   * allowed to use wide vector instructions (ACTIVATE_ARCH_NATIVE) and to
+   * vectorize square roots (-fno-math-errno, added by BATCHED_HYDRO).
+   *
+   * @param hydro Hydro instance to use.
+   * @param dt Current system time step (in s).
+   */
+  inline void inner_flux_sweep_batch(const Hydro &hydro, const double dt) {
+
+    // we do three separate sweeps: one for every coordinate direction
+    const int_fast32_t strides[3] = {_number_of_cells[3], _number_of_cells[2],
+                                     1};
+    HydroVariables *left_states[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    HydroVariables *right_states[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    for (uint_fast8_t i = 0; i < 3; ++i) {
+      const int_fast32_t nx = _number_of_cells[0] - (i == 0);
+      const int_fast32_t ny = _number_of_cells[1] - (i == 1);
+      const int_fast32_t nz = _number_of_cells[2] - (i == 2);
+      uint_fast32_t batch_size = 0;
+      for (int_fast32_t ix = 0; ix < nx; ++ix) {
+        for (int_fast32_t iy = 0; iy < ny; ++iy) {
+          for (int_fast32_t iz = 0; iz < nz; ++iz) {
+            const int_fast32_t index000 =
+                ix * _number_of_cells[3] + iy * _number_of_cells[2] + iz;
+            left_states[batch_size] = &_hydro_variables[index000];
+            right_states[batch_size] = &_hydro_variables[index000 + strides[i]];
+            ++batch_size;
+            if (batch_size == HLLCRIEMANNSOLVER_BATCH_SIZE) {
+              hydro.do_flux_calculation_batch(i, left_states, right_states,
+                                              _cell_size[i], _cell_areas[i],
+                                              dt);
+              batch_size = 0;
+            }
+          }
+        }
+      }
+      // process the remaining interfaces one by one
+      for (uint_fast32_t k = 0; k < batch_size; ++k) {
+        hydro.do_flux_calculation(i, *left_states[k], *right_states[k],
+                                  _cell_size[i], _cell_areas[i], dt);
+      }
+    }
+  }
+
+  /**
+   * @brief Compute the hydrodynamical fluxes for all interfaces inside the
+   * subgrid, one interface at a time.
+   *
+   * @param hydro Hydro instance to use.
+   * @param dt Current system time step (in s).
+   */
+  inline void inner_flux_sweep_scalar(const Hydro &hydro, const double dt) {
 
     // we do three separate sweeps: one for every coordinate direction
     for (int_fast32_t ix = 0; ix < _number_of_cells[0] - 1; ++ix) {
@@ -865,6 +940,21 @@ public:
     _hydro_variables[index].set_primitives_velocity(values.get_velocity());
   }
 
+  /**
+   * @brief Get a DensityFunctionBlock that can be used to initialize all cells
+   * in this subgrid at once.
+   *
+   * @return DensityFunctionBlock that wraps the cell arrays of this subgrid,
+   * including the hydrodynamical variables.
+   */
+  virtual DensityFunctionBlock get_density_function_block() {
+    return DensityFunctionBlock(
+        _anchor, _cell_size,
+        CoordinateVector< int_fast32_t >(
+            _number_of_cells[0], _number_of_cells[1], _number_of_cells[2]),
+        _ionization_variables, _hydro_variables);
+  }
+
   /**
    * @brief Iterator to loop over the cells in the subgrid.
    */
@@ -1056,10 +1146,14 @@ public:
    * @brief Dump the subgrid to the given restart file.
    *
    * @param restart_writer RestartWriter to write to.
+   * @param checkpoint_writer CheckpointWriter to register the cell arrays
+   * with (optional).
    */
-  virtual void write_restart_file(RestartWriter &restart_writer) const {
+  virtual void
+  write_restart_file(RestartWriter &restart_writer,
+                     CheckpointWriter *checkpoint_writer = nullptr) const {
 
-    DensitySubGrid::write_restart_file(restart_writer);
+    DensitySubGrid::write_restart_file(restart_writer, checkpoint_writer);
 
     restart_writer.write(_cell_volume);
     restart_writer.write(_cell_areas[0]);
@@ -1067,19 +1161,44 @@ public:
     restart_writer.write(_cell_areas[2]);
     const int_fast32_t number_of_cells =
         _number_of_cells[0] * _number_of_cells[1] * _number_of_cells[2];
-    for (int_fast32_t i = 0; i < number_of_cells; ++i) {
-      _hydro_variables[i].write_restart_file(restart_writer);
-      _ionization_variables[i].write_restart_file(restart_writer);
+    if (checkpoint_writer != nullptr) {
+      checkpoint_writer->add_block(_hydro_variables, number_of_cells,
+                                   sizeof(HydroVariables));
+    } else {
+      for (int_fast32_t i = 0; i < number_of_cells; ++i) {
+        _hydro_variables[i].write_restart_file(restart_writer);
+        _ionization_variables[i].write_restart_file(restart_writer);
+      }
     }
   }
 
+  /**
+   * @brief Read the cell arrays from the given checkpoint file.
+   *
+   * @param checkpoint_reader CheckpointReader to read from.
+   * @param first_block Index of the first block that belongs to this subgrid.
+   */
+  virtual void read_checkpoint(const CheckpointReader &checkpoint_reader,
+                               const size_t first_block) {
+
+    DensitySubGrid::read_checkpoint(checkpoint_reader, first_block);
+
+    const int_fast32_t number_of_cells =
+        _number_of_cells[0] * _number_of_cells[1] * _number_of_cells[2];
+    checkpoint_reader.read_block(first_block + 1, _hydro_variables,
+                                 number_of_cells);
+  }
+
   /**
    * @brief Restart constructor.
    *
    * @param restart_reader Restart file to read from.
+   * @param read_cells Read the cell data from the restart file? If false, the
+   * cell data need to be read from a checkpoint file using read_checkpoint().
    */
-  inline HydroDensitySubGrid(RestartReader &restart_reader)
-      : DensitySubGrid(restart_reader) {
+  inline HydroDensitySubGrid(RestartReader &restart_reader,
+                             const bool read_cells = true)
+      : DensitySubGrid(restart_reader, read_cells) {
 
     _cell_volume = restart_reader.read< double >();
     _inverse_cell_volume = 1. / _cell_volume;
@@ -1089,9 +1208,11 @@ public:
     const int_fast32_t number_of_cells =
         _number_of_cells[0] * _number_of_cells[1] * _number_of_cells[2];
     _hydro_variables = new HydroVariables[number_of_cells];
-    for (int_fast32_t i = 0; i < number_of_cells; ++i) {
-      _hydro_variables[i] = HydroVariables(restart_reader);
-      _ionization_variables[i] = IonizationVariables(restart_reader);
+    if (read_cells) {
+      for (int_fast32_t i = 0; i < number_of_cells; ++i) {
+        _hydro_variables[i] = HydroVariables(restart_reader);
+        _ionization_variables[i] = IonizationVariables(restart_reader);
+      }
     }
     _primitive_variable_limiters = new double[10 * number_of_cells];
     for (int_fast32_t i = 0; i < 5 * number_of_cells; ++i) {
@@ -27,7 +27,7 @@
 #include "CrossSections.hpp"
 #include "ElementNames.hpp"
 #include "PhysicalConstants.hpp"
-#include "Utilities.hpp"
+#include <algorithm>
 #include <cmath>
 
 /**
@@ -43,6 +43,7 @@ HydrogenLymanContinuumSpectrum::HydrogenLymanContinuumSpectrum(
   // allocate memory for the data tables
   _frequency.resize(HYDROGENLYMANCONTINUUMSPECTRUM_NUMFREQ, 0.);
   _temperature.resize(HYDROGENLYMANCONTINUUMSPECTRUM_NUMTEMP, 0.);
+  _alias_tables.resize(HYDROGENLYMANCONTINUUMSPECTRUM_NUMTEMP);
   _cumulative_distribution.resize(
       HYDROGENLYMANCONTINUUMSPECTRUM_NUMTEMP,
       std::vector< double >(HYDROGENLYMANCONTINUUMSPECTRUM_NUMFREQ, 0.));
@@ -67,6 +68,8 @@ HydrogenLymanContinuumSpectrum::HydrogenLymanContinuumSpectrum(
   }
 
   // set up the temperature bins and precompute the spectrum
+  // the temperature bins are equally spaced
+  _inverse_temperature_step = HYDROGENLYMANCONTINUUMSPECTRUM_NUMTEMP / 13500.;
   for (uint_fast32_t iT = 0; iT < HYDROGENLYMANCONTINUUMSPECTRUM_NUMTEMP;
        ++iT) {
     _cumulative_distribution[iT][0] = 0.;
@@ -118,16 +121,23 @@ HydrogenLymanContinuumSpectrum::HydrogenLymanContinuumSpectrum(
           _cumulative_distribution[iT]
                                   [HYDROGENLYMANCONTINUUMSPECTRUM_NUMFREQ - 1];
     }
+    _alias_tables[iT].initialize(_cumulative_distribution[iT].data(),
+                                 HYDROGENLYMANCONTINUUMSPECTRUM_NUMFREQ);
   }
 }
 
 /**
  * @brief Get a random frequency from the spectrum.
  *
- * We first locate the given temperature value in the temperature table. Then we
- * generate a random uniform number and locate it in the two cumulative
- * distributions that border the temperature value. The sampled frequency is
- * then given by linear interpolation on the temperature and frequency tables.
+ * The spectrum at the given temperature is obtained by linear interpolation
+ * in between the spectra for the two bracketing temperature bins. We sample
+ * this interpolated spectrum by randomly selecting one of the two bins, with a
+ * probability given by the linear interpolation weight, and by sampling the
+ * alias table for that bin. The sampled frequency is then linearly
+ * interpolated within the sampled frequency bin.
+ *
+ * The temperature bins are equally spaced, so that no search is required to
+ * locate the temperature.
  *
  * @param random_generator RandomGenerator to use.
  * @param temperature Temperature of the cell that reemits the photon (in K).
@@ -136,20 +146,17 @@ HydrogenLymanContinuumSpectrum::HydrogenLymanContinuumSpectrum(
 double HydrogenLymanContinuumSpectrum::get_random_frequency(
     RandomGenerator &random_generator, double temperature) const {
 
-  const uint_fast32_t iT = Utilities::locate(
-      temperature, _temperature.data(), HYDROGENLYMANCONTINUUMSPECTRUM_NUMTEMP);
-  const double x = random_generator.get_uniform_random_double();
-  const uint_fast32_t inu1 =
-      Utilities::locate(x, _cumulative_distribution[iT].data(),
-                        HYDROGENLYMANCONTINUUMSPECTRUM_NUMFREQ);
-  const uint_fast32_t inu2 =
-      Utilities::locate(x, _cumulative_distribution[iT + 1].data(),
-                        HYDROGENLYMANCONTINUUMSPECTRUM_NUMFREQ);
-  const double frequency =
-      _frequency[inu1] + (temperature - _temperature[iT]) *
-                             (_frequency[inu2] - _frequency[inu1]) /
-                             (_temperature[iT + 1] - _temperature[iT]);
-  return frequency;
+  double uT = (temperature - _temperature[0]) * _inverse_temperature_step;
+  uT = std::max(0., std::min(uT, HYDROGENLYMANCONTINUUMSPECTRUM_NUMTEMP - 1.));
+  uint_fast32_t iT = uT;
+  if (iT == HYDROGENLYMANCONTINUUMSPECTRUM_NUMTEMP - 1) {
+    --iT;
+  }
+  if (random_generator.get_uniform_random_double() < uT - iT) {
+    ++iT;
+  }
+  return _alias_tables[iT].sample_linear(
+      random_generator.get_uniform_random_double(), _frequency.data());
 }
 
 /**
@@ -27,6 +27,7 @@
 #ifndef HYDROGENLYMANCONTINUUMSPECTRUM_HPP
 #define HYDROGENLYMANCONTINUUMSPECTRUM_HPP
 
+#include "AliasTable.hpp"
 #include "PhotonSourceSpectrum.hpp"
 #include "RandomGenerator.hpp"
 
@@ -48,7 +49,8 @@ class CrossSections;
  * equation (8), which uses the same ionization cross sections that are used in
  * other parts of the program. We pretabulate values in a 2D temperature
  * frequency space in the range [1,500 K; 15,000 K] (for temperature values
- * outside this range, extrapolation is safe).
+ * outside this range, we use the spectrum for the closest tabulated
+ * temperature).
  */
 class HydrogenLymanContinuumSpectrum : public PhotonSourceSpectrum {
 private:
@@ -58,9 +60,16 @@ private:
   /*! @brief Temperature bins (in K). */
   std::vector< double > _temperature;
 
+  /*! @brief Inverse of the spacing of the temperature bins (in K^-1). */
+  double _inverse_temperature_step;
+
   /*! @brief Cumulative distribution function. */
   std::vector< std::vector< double > > _cumulative_distribution;
 
+  /*! @brief Alias tables used to sample the cumulative distribution function
+   *  for each temperature. */
+  std::vector< AliasTable > _alias_tables;
+
 public:
   HydrogenLymanContinuumSpectrum(const CrossSections &cross_sections);
 
@@ -0,0 +1,239 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file IdleHandler.hpp
+ *
+ * @brief Backoff, parking and termination detection for idle threads in a
+ * task-based parallel region.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#ifndef IDLEHANDLER_HPP
+#define IDLEHANDLER_HPP
+
+#include "AtomicValue.hpp"
+
+#include <chrono>
+#include <cinttypes>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief Backoff, parking and termination detection for idle threads in a
+ * task-based parallel region.
+ *
+ * A thread that cannot find a task calls wait() repeatedly until it finds
+ * work again. Consecutive calls first spin for an exponentially growing
+ * number of pause instructions, then yield the core, and finally park the
+ * thread on a condition variable. Parked threads are woken up by notify()
+ * when new tasks are added to a queue, by finish() at the end of the parallel
+ * region, and after a maximum park time, so that a missed notification (e.g.
+ * for tasks that are created outside the main loop, or for MPI messages that
+ * need to be received) only costs latency.
+ *
+ * To avoid lost wake ups, an idle thread first reads the notification epoch
+ * using prepare_wait(), then looks for tasks, and then passes the epoch on to
+ * wait(). A thread only parks if no notifications happened in between.
+ *
+ * Termination is detected by idle threads only, and by at most one idle
+ * thread at a time (try_lock_termination_check()), so that busy threads never
+ * need to poll the global termination condition.
+ */
+class IdleHandler {
+private:
+  /*! @brief Number of backoff steps during which the thread spins. */
+  const uint_fast32_t _number_of_spin_steps;
+
+  /*! @brief Number of backoff steps during which the thread yields. */
+  const uint_fast32_t _number_of_yield_steps;
+
+  /*! @brief Maximum time a thread stays parked before it checks for work
+   *  again. */
+  const std::chrono::microseconds _maximum_park_time;
+
+  /*! @brief Notification epoch, incremented every time new work becomes
+   *  available. */
+  AtomicValue< uint_fast64_t > _epoch;
+
+  /*! @brief Number of threads that are currently parked. */
+  AtomicValue< int_fast32_t > _number_of_parked_threads;
+
+  /*! @brief Flag signalling the end of the parallel region. */
+  AtomicValue< bool > _finished;
+
+  /*! @brief Lock that makes sure only one thread checks the termination
+   *  condition at a time. */
+  AtomicValue< bool > _termination_check_lock;
+
+  /*! @brief Mutex protecting the condition variable. */
+  std::mutex _mutex;
+
+  /*! @brief Condition variable parked threads wait on. */
+  std::condition_variable _condition;
+
+  /*! @brief Total number of times a thread was parked. */
+  AtomicValue< uint_fast64_t > _number_of_parks;
+
+public:
+  /**
+   * @brief Backoff state of a single thread.
+   */
+  class Backoff {
+  private:
+    /*! @brief Number of consecutive unsuccessful attempts to find work. */
+    uint_fast32_t _step;
+
+    friend class IdleHandler;
+
+  public:
+    /**
+     * @brief Constructor.
+     */
+    inline Backoff() : _step(0) {}
+
+    /**
+     * @brief Reset the backoff after work was found.
+     */
+    inline void reset() { _step = 0; }
+  };
+
+  /**
+   * @brief Constructor.
+   *
+   * @param number_of_spin_steps Number of backoff steps during which the
+   * thread spins (step i spins for 2^i pause instructions).
+   * @param number_of_yield_steps Number of backoff steps during which the
+   * thread yields its core.
+   * @param maximum_park_time Maximum time a thread stays parked before it
+   * checks for work again (in microseconds).
+   */
+  inline IdleHandler(const uint_fast32_t number_of_spin_steps = 10,
+                     const uint_fast32_t number_of_yield_steps = 10,
+                     const uint_fast32_t maximum_park_time = 1000)
+      : _number_of_spin_steps(number_of_spin_steps),
+        _number_of_yield_steps(number_of_yield_steps),
+        _maximum_park_time(maximum_park_time), _epoch(0),
+        _number_of_parked_threads(0), _finished(false),
+        _termination_check_lock(false), _number_of_parks(0) {}
+
+  /**
+   * @brief Get the current notification epoch.
+   *
+   * Needs to be called before an idle thread looks for work for the last time
+   * before it calls wait().
+   *
+   * @return Current notification epoch.
+   */
+  inline uint_fast64_t prepare_wait() const { return _epoch.value(); }
+
+  /**
+   * @brief Signal that new work is available.
+   *
+   * This is cheap if no threads are parked.
+   */
+  inline void notify() {
+    _epoch.pre_increment();
+    if (_number_of_parked_threads.value() > 0) {
+      std::lock_guard< std::mutex > lock(_mutex);
+      _condition.notify_one();
+    }
+  }
+
+  /**
+   * @brief Wait for new work.
+   *
+   * @param backoff Backoff state of the calling thread.
+   * @param epoch Notification epoch returned by prepare_wait() before the
+   * thread last looked for work.
+   */
+  inline void wait(Backoff &backoff, const uint_fast64_t epoch) {
+
+    if (backoff._step < _number_of_spin_steps) {
+      const uint_fast32_t number_of_pauses = 1u << backoff._step;
+      for (uint_fast32_t i = 0; i < number_of_pauses; ++i) {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#endif
+      }
+      ++backoff._step;
+    } else if (backoff._step < _number_of_spin_steps + _number_of_yield_steps) {
+      std::this_thread::yield();
+      ++backoff._step;
+    } else {
+      _number_of_parked_threads.pre_increment();
+      {
+        std::unique_lock< std::mutex > lock(_mutex);
+        if (_epoch.value() == epoch && !_finished.value()) {
+          _number_of_parks.pre_increment();
+          _condition.wait_for(lock, _maximum_park_time);
+        }
+      }
+      _number_of_parked_threads.pre_decrement();
+    }
+  }
+
+  /**
+   * @brief Try to become the thread that checks the termination condition.
+   *
+   * @return True if the calling thread should check the termination condition
+   * and then call unlock_termination_check() or finish().
+   */
+  inline bool try_lock_termination_check() {
+    return _termination_check_lock.lock();
+  }
+
+  /**
+   * @brief Release the termination check lock without terminating.
+   */
+  inline void unlock_termination_check() { _termination_check_lock.unlock(); }
+
+  /**
+   * @brief Signal the end of the parallel region and wake up all parked
+   * threads.
+   */
+  inline void finish() {
+    _finished.set(true);
+    _epoch.pre_increment();
+    std::lock_guard< std::mutex > lock(_mutex);
+    _condition.notify_all();
+  }
+
+  /**
+   * @brief Check if the parallel region has finished.
+   *
+   * @return True if finish() was called.
+   */
+  inline bool is_finished() const { return _finished.value(); }
+
+  /**
+   * @brief Get the total number of times a thread was parked.
+   *
+   * @return Number of times a thread was parked.
+   */
+  inline uint_fast64_t get_number_of_parks() const {
+    return _number_of_parks.value();
+  }
+};
+
+#endif // IDLEHANDLER_HPP
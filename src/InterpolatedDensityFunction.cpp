@@ -24,6 +24,7 @@
  * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
  */
 #include "InterpolatedDensityFunction.hpp"
+#include "DensityFunctionBlock.hpp"
 #include "Log.hpp"
 #include "ParameterFile.hpp"
 #include "Utilities.hpp"
@@ -366,3 +367,100 @@ DensityValues InterpolatedDensityFunction::operator()(const Cell &cell) {
 #endif
   return values;
 }
+
+/**
+ * @brief Get the interpolation indices and weights for all cells of the given
+ * block along the given coordinate direction.
+ *
+ * @param block DensityFunctionBlock.
+ * @param direction Coordinate direction (0, 1 or 2).
+ * @param coords Coordinates to interpolate on (in m).
+ * @param bounds Minimal and maximal coordinate allowed (in m).
+ * @param indices Indices of the interpolation coordinate just below every cell
+ * midpoint.
+ * @param weights Interpolation weights of the coordinate above every cell
+ * midpoint.
+ */
+static void get_interpolation_weights(const DensityFunctionBlock &block,
+                                      const uint_fast8_t direction,
+                                      const std::vector< double > &coords,
+                                      const std::pair< double, double > &bounds,
+                                      std::vector< size_t > &indices,
+                                      std::vector< double > &weights) {
+
+  const int_fast32_t number_of_cells = block.get_number_of_cells(direction);
+  indices.resize(number_of_cells);
+  weights.resize(number_of_cells);
+  for (int_fast32_t i = 0; i < number_of_cells; ++i) {
+    const double x = block.get_cell_midpoint(direction, i);
+    cmac_assert(x >= bounds.first && x <= bounds.second);
+    const size_t index = Utilities::locate(x, &coords[0], coords.size());
+    indices[i] = index;
+    weights[i] = (x - coords[index]) / (coords[index + 1] - coords[index]);
+  }
+}
+
+/**
+ * @brief Initialize all cells in the given block at once.
+ *
+ * The interpolation indices and weights are computed once per coordinate
+ * direction, so that only the trilinear interpolation itself is done for every
+ * cell.
+ *
+ * @param block DensityFunctionBlock to initialize.
+ * @return True, since the block is always initialized.
+ */
+bool InterpolatedDensityFunction::evaluate_block(DensityFunctionBlock &block) {
+
+  std::vector< size_t > x_indices, y_indices, z_indices;
+  std::vector< double > x_weights, y_weights, z_weights;
+  get_interpolation_weights(block, 0, _x_coords, _x_bounds, x_indices,
+                            x_weights);
+  get_interpolation_weights(block, 1, _y_coords, _y_bounds, y_indices,
+                            y_weights);
+  get_interpolation_weights(block, 2, _z_coords, _z_bounds, z_indices,
+                            z_weights);
+
+  DensityValues values;
+  values.set_temperature(_temperature);
+  values.set_ionic_fraction(ION_H_n, 1.e-6);
+#ifdef HAS_HELIUM
+  values.set_ionic_fraction(ION_He_n, 1.e-6);
+#endif
+
+  uint_fast32_t index = 0;
+  for (size_t i = 0; i < x_indices.size(); ++i) {
+    const size_t ix = x_indices[i];
+    const double xd = x_weights[i];
+    const double omxd = 1. - xd;
+    for (size_t j = 0; j < y_indices.size(); ++j) {
+      const size_t iy = y_indices[j];
+      const double yd = y_weights[j];
+      const double omyd = 1. - yd;
+      const std::vector< double > &n00 = _number_densities[ix][iy];
+      const std::vector< double > &n10 = _number_densities[ix + 1][iy];
+      const std::vector< double > &n01 = _number_densities[ix][iy + 1];
+      const std::vector< double > &n11 = _number_densities[ix + 1][iy + 1];
+      for (size_t k = 0; k < z_indices.size(); ++k) {
+        const size_t iz = z_indices[k];
+        const double zd = z_weights[k];
+        const double omzd = 1. - zd;
+
+        // same operations as in operator(), so that both give identical
+        // results
+        const double c00 = n00[iz] * omxd + n10[iz] * xd;
+        const double c01 = n00[iz + 1] * omxd + n10[iz + 1] * xd;
+        const double c10 = n01[iz] * omxd + n11[iz] * xd;
+        const double c11 = n01[iz + 1] * omxd + n11[iz + 1] * xd;
+
+        const double c0 = c00 * omyd + c10 * yd;
+        const double c1 = c01 * omyd + c11 * yd;
+
+        values.set_number_density(c0 * omzd + c1 * zd);
+        block.set_values(index, values);
+        ++index;
+      }
+    }
+  }
+  return true;
+}
@@ -132,6 +132,8 @@ public:
   virtual ~InterpolatedDensityFunction() {}
 
   virtual DensityValues operator()(const Cell &cell);
+
+  virtual bool evaluate_block(DensityFunctionBlock &block);
 };
 
 #endif // INTERPOLATEDDENSITYFUNCTION_HPP
@@ -47,6 +47,7 @@
 #include "TrackerManager.hpp"
 #include "WorkEnvironment.hpp"
 
+#include <algorithm>
 #include <fstream>
 
 /*! @brief Start the serial and total program time timers at the start of a
@@ -118,8 +119,13 @@ IonizationSimulation::IonizationSimulation(const bool write_output,
       _number_of_photons_init(_parameter_file.get_value< uint_fast64_t >(
           "IonizationSimulation:number of photons first loop",
           _number_of_photons)),
+      _number_of_warm_start_iterations(
+          _parameter_file.get_value< uint_fast32_t >(
+              "IonizationSimulation:number of warm start iterations",
+              std::min(_number_of_iterations, uint_fast32_t(2)))),
       _abundance_model(AbundanceModelFactory::generate(_parameter_file, log)),
-      _abundances(_abundance_model->get_abundances()) {
+      _abundances(_abundance_model->get_abundances()), _is_initialized(false),
+      _warm_start(false) {
 
   function_start_timers();
 
@@ -190,7 +196,6 @@ IonizationSimulation::IonizationSimulation(const bool write_output,
     _density_grid_writer = DensityGridWriterFactory::generate(
         output_folder, _parameter_file, false, _log);
   }
-  CollisionalRates _collisional_rates;
   // used to calculate both the ionization state and the temperature
   _temperature_calculator = new TemperatureCalculator(
       total_luminosity, _abundances, _line_cooling_data, *_recombination_rates,
@@ -321,11 +326,94 @@ void IonizationSimulation::initialize(DensityFunction *density_function) {
     }
   }
 
+  _is_initialized = true;
+  _warm_start = false;
+
   _time_log.end("IonizationSimulation::initialize()");
 
   function_stop_timers();
 }
 
+/**
+ * @brief Update the densities in the grid, while keeping the temperatures and
+ * ionic fractions from the previous run.
+ *
+ * The next call to run() then starts from the converged state of the previous
+ * run, which is a good initial guess if the density field only changed
+ * slightly. This means we can do fewer iterations (the number is set by the
+ * parameter "IonizationSimulation:number of warm start iterations") and do not
+ * need the lower number of photons for the first iteration. If the grid was
+ * not initialized yet, this function simply calls initialize().
+ *
+ * @param density_function DensityFunction to use. If no DensityFunction is
+ * given, the internal DensityFunction is used.
+ */
+void IonizationSimulation::update(DensityFunction *density_function) {
+
+  if (!_is_initialized) {
+    initialize(density_function);
+    return;
+  }
+
+  function_start_timers();
+
+  _time_log.start("IonizationSimulation::update()");
+
+  if (density_function == nullptr) {
+    density_function = _density_function;
+  }
+
+  _time_log.start("Initializing densityfunction");
+  if (_log) {
+    _log->write_status("Updating DensityFunction...");
+  }
+  density_function->initialize();
+  if (_log) {
+    _log->write_status("Done.");
+  }
+  _time_log.end("Initializing densityfunction");
+
+  std::pair< cellsize_t, cellsize_t > block;
+  if (_mpi_communicator) {
+    block = _mpi_communicator->distribute_block(
+        0, _density_grid->get_number_of_cells());
+  } else {
+    block = std::make_pair(0, _density_grid->get_number_of_cells());
+  }
+
+  start_parallel_timing_block();
+  _density_grid->update_densities(block, *density_function);
+  stop_parallel_timing_block();
+
+  // only the densities changed, the other variables are still the same on all
+  // processes
+  if (_mpi_communicator) {
+    start_parallel_timing_block();
+    std::pair< DensityGrid::iterator, DensityGrid::iterator > local_chunk =
+        _density_grid->get_chunk(block.first, block.second);
+    _mpi_communicator->gather< double, NumberDensityPropertyAccessor >(
+        _density_grid->begin(), _density_grid->end(), local_chunk.first,
+        local_chunk.second, 0);
+    stop_parallel_timing_block();
+  }
+
+  if (_density_mask != nullptr) {
+    if (_log) {
+      _log->write_status("Applying DensityMask...");
+    }
+    _density_mask->apply(*_density_grid);
+    if (_log) {
+      _log->write_status("Done applying mask.");
+    }
+  }
+
+  _warm_start = true;
+
+  _time_log.end("IonizationSimulation::update()");
+
+  function_stop_timers();
+}
+
 /**
  * @brief Run the actual simulation.
  *
@@ -353,11 +441,16 @@ void IonizationSimulation::run(DensityGridWriter *density_grid_writer) {
   std::pair< DensityGrid::iterator, DensityGrid::iterator > local_chunk =
       _density_grid->get_chunk(block.first, block.second);
 
+  // a warm started run starts from a converged state and needs fewer
+  // iterations
+  const uint_fast32_t number_of_iterations =
+      _warm_start ? _number_of_warm_start_iterations : _number_of_iterations;
+
   _time_log.start("photoionization");
   // finally: the actual program loop whereby the density grid is ray traced
   // using photon packets generated by the stellar sources
   uint_fast32_t loop = 0;
-  while (loop < _number_of_iterations) {
+  while (loop < number_of_iterations) {
 
     if (_log) {
       _log->write_status("Starting loop ", loop, ".");
@@ -365,12 +458,12 @@ void IonizationSimulation::run(DensityGridWriter *density_grid_writer) {
 
     uint_fast64_t lnumphoton = _number_of_photons;
 
-    if (_trackers != nullptr && loop == _number_of_iterations - 1) {
+    if (_trackers != nullptr && loop == number_of_iterations - 1) {
       _trackers->add_trackers(*_density_grid);
       lnumphoton = std::max(lnumphoton, _trackers->get_number_of_photons());
     }
 
-    if (loop == 0) {
+    if (loop == 0 && !_warm_start) {
       // overwrite the number of photons for the first loop (might be useful
       // if more than 1 boundary is periodic, since the initial neutral
       // fractions are very low)
@@ -638,14 +731,14 @@ void IonizationSimulation::run(DensityGridWriter *density_grid_writer) {
     ++loop;
 
     if (_density_grid_writer && _every_iteration_output &&
-        loop < _number_of_iterations) {
+        loop < number_of_iterations) {
       _density_grid_writer->write(*_density_grid, loop, _parameter_file);
     }
   }
   _time_log.end("photoionization");
 
-  if (_log && loop == _number_of_iterations) {
-    _log->write_status("Maximum number of iterations (", _number_of_iterations,
+  if (_log && loop == number_of_iterations) {
+    _log->write_status("Maximum number of iterations (", number_of_iterations,
                        ") reached, stopping.");
   }
 
@@ -655,12 +748,12 @@ void IonizationSimulation::run(DensityGridWriter *density_grid_writer) {
 
   // write final snapshot
   if (_density_grid_writer) {
-    _density_grid_writer->write(*_density_grid, _number_of_iterations,
+    _density_grid_writer->write(*_density_grid, number_of_iterations,
                                 _parameter_file);
   }
   if (density_grid_writer) {
     _time_log.start("Reverse mapping");
-    density_grid_writer->write(*_density_grid, _number_of_iterations,
+    density_grid_writer->write(*_density_grid, number_of_iterations,
                                _parameter_file);
     _time_log.end("Reverse mapping");
   }
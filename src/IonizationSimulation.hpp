@@ -29,6 +29,7 @@
 #include "AbundanceModel.hpp"
 #include "Abundances.hpp"
 #include "ChargeTransferRates.hpp"
+#include "CollisionalRates.hpp"
 #include "IonizationPhotonShootJobMarket.hpp"
 #include "LineCoolingData.hpp"
 #include "ParameterFile.hpp"
@@ -91,6 +92,9 @@ private:
   /*! @brief Charge transfer rates. */
   const ChargeTransferRates _charge_transfer_rates;
 
+  /*! @brief Collisional ionization rates. */
+  const CollisionalRates _collisional_rates;
+
   /// parameter file
 
   /*! @brief Parameter file. */
@@ -112,6 +116,10 @@ private:
    *  transparent). */
   const uint_fast64_t _number_of_photons_init;
 
+  /*! @brief Number of iterations of the ray tracing loop if the simulation is
+   *  warm started from the result of a previous run (see update()). */
+  const uint_fast32_t _number_of_warm_start_iterations;
+
   /// objects owned by the simulation that require parameters
   /// these have to be declared and initialized after the parameter file has
   /// been read
@@ -172,6 +180,15 @@ private:
   /*! @brief Abundances. */
   const Abundances _abundances;
 
+  /// simulation state
+
+  /*! @brief Has the grid been initialized? */
+  bool _is_initialized;
+
+  /*! @brief Is the next run warm started from the result of the previous
+   *  run? */
+  bool _warm_start;
+
   /// internal timers
 
   /*! @brief Timer for the time spent in photon propagations. */
@@ -202,6 +219,7 @@ public:
                        Log *log = nullptr);
 
   void initialize(DensityFunction *density_function = nullptr);
+  void update(DensityFunction *density_function = nullptr);
   void run(DensityGridWriter *density_grid_writer = nullptr);
 
   ~IonizationSimulation();
@@ -1735,6 +1735,53 @@ double LineCoolingData::compute_level_population(
          (A + collision_strength * (inv_omega_2 + Texp * inv_omega_1));
 }
 
+/**
+ * @brief Compute the cooling rate of the given five level element for the given
+ * level populations.
+ *
+ * This corresponds to equation (3.29) in Osterbrock & Ferland (2006).
+ *
+ * @param element LineCoolingDataFiveLevelElement.
+ * @param level_populations Level populations, as computed by
+ * compute_level_populations().
+ * @return Cooling rate per ion, without the Boltzmann constant prefactor
+ * (in K s^-1).
+ */
+double LineCoolingData::compute_five_level_cooling(
+    const int_fast32_t element, const double level_populations[5]) const {
+
+  const double cl2 =
+      level_populations[1] *
+      _five_level_transition_probability[element][TRANSITION_0_to_1] *
+      _five_level_energy_difference[element][TRANSITION_0_to_1];
+  const double cl3 =
+      level_populations[2] *
+      (_five_level_transition_probability[element][TRANSITION_0_to_2] *
+           _five_level_energy_difference[element][TRANSITION_0_to_2] +
+       _five_level_transition_probability[element][TRANSITION_1_to_2] *
+           _five_level_energy_difference[element][TRANSITION_1_to_2]);
+  const double cl4 =
+      level_populations[3] *
+      (_five_level_transition_probability[element][TRANSITION_0_to_3] *
+           _five_level_energy_difference[element][TRANSITION_0_to_3] +
+       _five_level_transition_probability[element][TRANSITION_1_to_3] *
+           _five_level_energy_difference[element][TRANSITION_1_to_3] +
+       _five_level_transition_probability[element][TRANSITION_2_to_3] *
+           _five_level_energy_difference[element][TRANSITION_2_to_3]);
+  const double cl5 =
+      level_populations[4] *
+      (_five_level_transition_probability[element][TRANSITION_0_to_4] *
+           _five_level_energy_difference[element][TRANSITION_0_to_4] +
+       _five_level_transition_probability[element][TRANSITION_1_to_4] *
+           _five_level_energy_difference[element][TRANSITION_1_to_4] +
+       _five_level_transition_probability[element][TRANSITION_2_to_4] *
+           _five_level_energy_difference[element][TRANSITION_2_to_4] +
+       _five_level_transition_probability[element][TRANSITION_3_to_4] *
+           _five_level_energy_difference[element][TRANSITION_3_to_4]);
+
+  return cl2 + cl3 + cl4 + cl5;
+}
+
 /**
  * @brief Get the radiative energy losses due to line cooling at the given
  * temperature, electron density and coolant abundances.
@@ -1797,38 +1844,8 @@ double LineCoolingData::get_cooling(
     compute_level_populations(element, collision_strength_prefactor,
                               temperature, Tinv, logT, level_populations);
 
-    // compute the cooling for each transition
-    // this corresponds to equation (3.29) in Osterbrock & Ferland (2006)
-    const double cl2 =
-        level_populations[1] *
-        _five_level_transition_probability[element][TRANSITION_0_to_1] *
-        _five_level_energy_difference[element][TRANSITION_0_to_1];
-    const double cl3 =
-        level_populations[2] *
-        (_five_level_transition_probability[element][TRANSITION_0_to_2] *
-             _five_level_energy_difference[element][TRANSITION_0_to_2] +
-         _five_level_transition_probability[element][TRANSITION_1_to_2] *
-             _five_level_energy_difference[element][TRANSITION_1_to_2]);
-    const double cl4 =
-        level_populations[3] *
-        (_five_level_transition_probability[element][TRANSITION_0_to_3] *
-             _five_level_energy_difference[element][TRANSITION_0_to_3] +
-         _five_level_transition_probability[element][TRANSITION_1_to_3] *
-             _five_level_energy_difference[element][TRANSITION_1_to_3] +
-         _five_level_transition_probability[element][TRANSITION_2_to_3] *
-             _five_level_energy_difference[element][TRANSITION_2_to_3]);
-    const double cl5 =
-        level_populations[4] *
-        (_five_level_transition_probability[element][TRANSITION_0_to_4] *
-             _five_level_energy_difference[element][TRANSITION_0_to_4] +
-         _five_level_transition_probability[element][TRANSITION_1_to_4] *
-             _five_level_energy_difference[element][TRANSITION_1_to_4] +
-         _five_level_transition_probability[element][TRANSITION_2_to_4] *
-             _five_level_energy_difference[element][TRANSITION_2_to_4] +
-         _five_level_transition_probability[element][TRANSITION_3_to_4] *
-             _five_level_energy_difference[element][TRANSITION_3_to_4]);
-
-    cooling += abundances[element] * kb * (cl2 + cl3 + cl4 + cl5);
+    cooling += abundances[element] * kb *
+               compute_five_level_cooling(element, level_populations);
   }
 
   /// 2 level atoms
@@ -1847,6 +1864,63 @@ double LineCoolingData::get_cooling(
   return cooling;
 }
 
+/**
+ * @brief Get the line cooling rate per ion for every coolant at the given
+ * temperature and electron density.
+ *
+ * The total line cooling computed by get_cooling() is the sum of these rates,
+ * weighted with the coolant abundances. Since the rates do not depend on the
+ * abundances, they can be tabulated as a function of temperature and electron
+ * density (see LineCoolingTable).
+ *
+ * @param temperature Temperature (in K).
+ * @param electron_density Electron density (in m^-3).
+ * @param element_cooling Array to store the cooling rate per ion for every
+ * coolant (in kg m^2s^-3).
+ */
+void LineCoolingData::get_element_cooling(
+    const double temperature, const double electron_density,
+    double element_cooling[LINECOOLINGDATA_NUMELEMENTS]) const {
+
+  if (electron_density == 0.) {
+    for (int_fast32_t element = 0; element < LINECOOLINGDATA_NUMELEMENTS;
+         ++element) {
+      element_cooling[element] = 0.;
+    }
+    return;
+  }
+
+  // Boltzmann constant (in J s^-1)
+  const double kb =
+      PhysicalConstants::get_physical_constant(PHYSICALCONSTANT_BOLTZMANN);
+
+  const double collision_strength_prefactor =
+      _collision_strength_prefactor * electron_density / std::sqrt(temperature);
+  const double Tinv = 1. / temperature;
+  const double logT = std::log(temperature);
+
+  for (int_fast32_t element = 0; element < LINECOOLINGDATA_NUMFIVELEVELELEMENTS;
+       ++element) {
+
+    double level_populations[5];
+    compute_level_populations(element, collision_strength_prefactor,
+                              temperature, Tinv, logT, level_populations);
+    element_cooling[element] =
+        kb * compute_five_level_cooling(element, level_populations);
+  }
+
+  const int_fast32_t offset = LINECOOLINGDATA_NUMFIVELEVELELEMENTS;
+  for (int_fast32_t i = 0; i < LINECOOLINGDATA_NUMTWOLEVELELEMENTS; ++i) {
+
+    const int_fast32_t element = i + offset;
+    const double level_population = compute_level_population(
+        element, collision_strength_prefactor, temperature, Tinv, logT);
+    element_cooling[element] = kb * _two_level_energy_difference[i] *
+                               _two_level_transition_probability[i] *
+                               level_population;
+  }
+}
+
 /**
  * @brief Calculate the strength of all emission lines for which we have data.
  *
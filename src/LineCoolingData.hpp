@@ -241,6 +241,9 @@ private:
                                   const double T, const double Tinv,
                                   const double logT) const;
 
+  double compute_five_level_cooling(const int_fast32_t element,
+                                    const double level_populations[5]) const;
+
 public:
   LineCoolingData();
 
@@ -257,6 +260,10 @@ public:
   get_cooling(const double temperature, const double electron_density,
               const double abundances[LINECOOLINGDATA_NUMELEMENTS]) const;
 
+  void get_element_cooling(
+      const double temperature, const double electron_density,
+      double element_cooling[LINECOOLINGDATA_NUMELEMENTS]) const;
+
   std::vector< std::vector< double > > get_line_strengths(
       const double temperature, const double electron_density,
       const double abundances[LINECOOLINGDATA_NUMELEMENTS]) const;
@@ -0,0 +1,389 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file LineCoolingTable.hpp
+ *
+ * @brief Table of line cooling rates as a function of temperature and electron
+ * density.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#ifndef LINECOOLINGTABLE_HPP
+#define LINECOOLINGTABLE_HPP
+
+#include "Error.hpp"
+#include "LineCoolingData.hpp"
+#include "Log.hpp"
+#include "ParameterFile.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+/*! @brief Coolants with a rate that is this many times smaller than the largest
+ *  rate at the same temperature and electron density are ignored when checking
+ *  the interpolation error. */
+#define LINECOOLINGTABLE_NEGLIGIBLE_FRACTION 1.e-10
+
+/**
+ * @brief Table of line cooling rates as a function of temperature and electron
+ * density.
+ *
+ * LineCoolingData::get_cooling() solves a system of level population equations
+ * for every coolant, which makes it by far the most expensive part of the
+ * temperature calculation. The cooling rate per ion of every coolant only
+ * depends on the temperature and electron density, so we tabulate the
+ * logarithm of these rates (LineCoolingData::get_element_cooling()) on a
+ * regular grid in \f$\log(T)\f$ and \f$\log(n_e)\f$, and use bilinear
+ * interpolation to compute the total cooling rate for arbitrary coolant
+ * abundances.
+ *
+ * When the table is constructed, we compare the interpolated rates at the
+ * centre of every bin (where the interpolation error is largest) with the
+ * exact rates. Bins in which the relative difference for any coolant exceeds
+ * the requested tolerance are flagged, and temperatures and electron densities
+ * in these bins (and outside the tabulated range) are passed on to
+ * LineCoolingData::get_cooling(). Since all coolant rates are positive, the
+ * relative error on the total cooling rate is then bounded by the same
+ * tolerance, independent of the abundances (coolants with negligible rates are
+ * ignored in this check).
+ */
+class LineCoolingTable {
+private:
+  /*! @brief Underlying LineCoolingData. */
+  const LineCoolingData &_line_cooling_data;
+
+  /*! @brief Natural logarithm of the lowest tabulated temperature. */
+  const double _minimum_log_temperature;
+
+  /*! @brief Inverse of the step in natural logarithm of the temperature
+   *  between two nodes. */
+  const double _inverse_log_temperature_step;
+
+  /*! @brief Number of temperature bins in the table. */
+  const uint_fast32_t _number_of_temperature_bins;
+
+  /*! @brief Natural logarithm of the lowest tabulated electron density. */
+  const double _minimum_log_electron_density;
+
+  /*! @brief Inverse of the step in natural logarithm of the electron density
+   *  between two nodes. */
+  const double _inverse_log_electron_density_step;
+
+  /*! @brief Number of electron density bins in the table. */
+  const uint_fast32_t _number_of_electron_density_bins;
+
+  /*! @brief Natural logarithm of the tabulated cooling rates, one row of
+   *  LINECOOLINGDATA_NUMELEMENTS values per node; electron density nodes for
+   *  the same temperature node are stored contiguously. */
+  std::vector< double > _table;
+
+  /*! @brief Flags for bins that need to be evaluated exactly. */
+  std::vector< bool > _exact_bins;
+
+  /*! @brief Number of bins that need to be evaluated exactly. */
+  uint_fast32_t _number_of_exact_bins;
+
+  /**
+   * @brief Get the row of tabulated values for the given node.
+   *
+   * @param itemperature Temperature index of the node.
+   * @param idensity Electron density index of the node.
+   * @return Pointer to the first value in the row.
+   */
+  inline const double *get_row(const uint_fast32_t itemperature,
+                               const uint_fast32_t idensity) const {
+    return &_table[(itemperature * (_number_of_electron_density_bins + 1) +
+                    idensity) *
+                   LINECOOLINGDATA_NUMELEMENTS];
+  }
+
+  /**
+   * @brief Interpolate the natural logarithm of the cooling rates within the
+   * given bin.
+   *
+   * @param itemperature Temperature index of the bin.
+   * @param idensity Electron density index of the bin.
+   * @param ftemperature Relative position within the bin in the temperature
+   * direction.
+   * @param fdensity Relative position within the bin in the electron density
+   * direction.
+   * @param log_cooling Array to store the interpolated values in.
+   */
+  inline void
+  interpolate(const uint_fast32_t itemperature, const uint_fast32_t idensity,
+              const double ftemperature, const double fdensity,
+              double log_cooling[LINECOOLINGDATA_NUMELEMENTS]) const {
+
+    const double *row00 = get_row(itemperature, idensity);
+    const double *row01 = row00 + LINECOOLINGDATA_NUMELEMENTS;
+    const double *row10 = get_row(itemperature + 1, idensity);
+    const double *row11 = row10 + LINECOOLINGDATA_NUMELEMENTS;
+    const double w00 = (1. - ftemperature) * (1. - fdensity);
+    const double w01 = (1. - ftemperature) * fdensity;
+    const double w10 = ftemperature * (1. - fdensity);
+    const double w11 = ftemperature * fdensity;
+    for (int_fast32_t element = 0; element < LINECOOLINGDATA_NUMELEMENTS;
+         ++element) {
+      log_cooling[element] = w00 * row00[element] + w01 * row01[element] +
+                             w10 * row10[element] + w11 * row11[element];
+    }
+  }
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param line_cooling_data LineCoolingData to tabulate.
+   * @param minimum_temperature Lowest tabulated temperature (in K).
+   * @param maximum_temperature Highest tabulated temperature (in K).
+   * @param number_of_temperature_bins Number of temperature bins.
+   * @param minimum_electron_density Lowest tabulated electron density
+   * (in m^-3).
+   * @param maximum_electron_density Highest tabulated electron density
+   * (in m^-3).
+   * @param number_of_electron_density_bins Number of electron density bins.
+   * @param tolerance Maximum allowed relative difference between the
+   * interpolated and the exact cooling rates.
+   * @param log Log to write logging info to.
+   */
+  inline LineCoolingTable(const LineCoolingData &line_cooling_data,
+                          const double minimum_temperature,
+                          const double maximum_temperature,
+                          const uint_fast32_t number_of_temperature_bins,
+                          const double minimum_electron_density,
+                          const double maximum_electron_density,
+                          const uint_fast32_t number_of_electron_density_bins,
+                          const double tolerance, Log *log = nullptr)
+      : _line_cooling_data(line_cooling_data),
+        _minimum_log_temperature(std::log(minimum_temperature)),
+        _inverse_log_temperature_step(
+            number_of_temperature_bins /
+            std::log(maximum_temperature / minimum_temperature)),
+        _number_of_temperature_bins(number_of_temperature_bins),
+        _minimum_log_electron_density(std::log(minimum_electron_density)),
+        _inverse_log_electron_density_step(
+            number_of_electron_density_bins /
+            std::log(maximum_electron_density / minimum_electron_density)),
+        _number_of_electron_density_bins(number_of_electron_density_bins),
+        _table((number_of_temperature_bins + 1) *
+               (number_of_electron_density_bins + 1) *
+               LINECOOLINGDATA_NUMELEMENTS),
+        _exact_bins(number_of_temperature_bins *
+                        number_of_electron_density_bins,
+                    false),
+        _number_of_exact_bins(0) {
+
+    if (minimum_temperature <= 0. ||
+        maximum_temperature <= minimum_temperature) {
+      cmac_error("Invalid temperature range for line cooling table: [%g, %g]!",
+                 minimum_temperature, maximum_temperature);
+    }
+    if (minimum_electron_density <= 0. ||
+        maximum_electron_density <= minimum_electron_density) {
+      cmac_error(
+          "Invalid electron density range for line cooling table: [%g, %g]!",
+          minimum_electron_density, maximum_electron_density);
+    }
+    if (number_of_temperature_bins == 0 ||
+        number_of_electron_density_bins == 0) {
+      cmac_error("Line cooling table needs at least 1 bin in every "
+                 "direction!");
+    }
+
+    const double log_temperature_step = 1. / _inverse_log_temperature_step;
+    const double log_electron_density_step =
+        1. / _inverse_log_electron_density_step;
+    double cooling[LINECOOLINGDATA_NUMELEMENTS];
+    for (uint_fast32_t itemperature = 0;
+         itemperature < number_of_temperature_bins + 1; ++itemperature) {
+      const double temperature = std::exp(
+          _minimum_log_temperature + itemperature * log_temperature_step);
+      for (uint_fast32_t idensity = 0;
+           idensity < number_of_electron_density_bins + 1; ++idensity) {
+        const double electron_density =
+            std::exp(_minimum_log_electron_density +
+                     idensity * log_electron_density_step);
+        line_cooling_data.get_element_cooling(temperature, electron_density,
+                                              cooling);
+        double *row = &_table[(itemperature *
+                                   (number_of_electron_density_bins + 1) +
+                               idensity) *
+                              LINECOOLINGDATA_NUMELEMENTS];
+        for (int_fast32_t element = 0; element < LINECOOLINGDATA_NUMELEMENTS;
+             ++element) {
+          row[element] = std::log(std::max(cooling[element], DBL_MIN));
+        }
+      }
+    }
+
+    // check the interpolation error in the centre of each bin
+    double log_cooling[LINECOOLINGDATA_NUMELEMENTS];
+    for (uint_fast32_t itemperature = 0;
+         itemperature < number_of_temperature_bins; ++itemperature) {
+      const double temperature =
+          std::exp(_minimum_log_temperature +
+                   (itemperature + 0.5) * log_temperature_step);
+      for (uint_fast32_t idensity = 0;
+           idensity < number_of_electron_density_bins; ++idensity) {
+        const double electron_density =
+            std::exp(_minimum_log_electron_density +
+                     (idensity + 0.5) * log_electron_density_step);
+        line_cooling_data.get_element_cooling(temperature, electron_density,
+                                              cooling);
+        interpolate(itemperature, idensity, 0.5, 0.5, log_cooling);
+        const double negligible_cooling =
+            LINECOOLINGTABLE_NEGLIGIBLE_FRACTION *
+            *std::max_element(cooling, cooling + LINECOOLINGDATA_NUMELEMENTS);
+        for (int_fast32_t element = 0; element < LINECOOLINGDATA_NUMELEMENTS;
+             ++element) {
+          if (cooling[element] > negligible_cooling &&
+              std::abs(std::exp(log_cooling[element]) - cooling[element]) >
+                  tolerance * cooling[element]) {
+            _exact_bins[itemperature * number_of_electron_density_bins +
+                        idensity] = true;
+            ++_number_of_exact_bins;
+            break;
+          }
+        }
+      }
+    }
+
+    if (log) {
+      log->write_status(
+          "Tabulated line cooling using ", number_of_temperature_bins,
+          " temperature bins between ", minimum_temperature, " K and ",
+          maximum_temperature, " K and ", number_of_electron_density_bins,
+          " electron density bins between ", minimum_electron_density,
+          " m^-3 and ", maximum_electron_density, " m^-3; ",
+          _number_of_exact_bins, " bins require an exact evaluation.");
+    }
+  }
+
+  /**
+   * @brief ParameterFile constructor.
+   *
+   * Parameters are:
+   *  - line cooling table minimum temperature: Lowest tabulated temperature
+   *    (default: 1000. K)
+   *  - line cooling table maximum temperature: Highest tabulated temperature
+   *    (default: 1.e5 K)
+   *  - line cooling table number of temperature bins: Number of temperature
+   *    bins (default: 400)
+   *  - line cooling table minimum electron density: Lowest tabulated electron
+   *    density (default: 1.e-6 cm^-3)
+   *  - line cooling table maximum electron density: Highest tabulated electron
+   *    density (default: 1.e8 cm^-3)
+   *  - line cooling table number of electron density bins: Number of electron
+   *    density bins (default: 280)
+   *  - line cooling table tolerance: Maximum allowed relative difference
+   *    between the interpolated and the exact cooling rates (default: 1.e-3)
+   *
+   * @param line_cooling_data LineCoolingData to tabulate.
+   * @param params ParameterFile to read from.
+   * @param log Log to write logging info to.
+   */
+  inline LineCoolingTable(const LineCoolingData &line_cooling_data,
+                          ParameterFile &params, Log *log = nullptr)
+      : LineCoolingTable(
+            line_cooling_data,
+            params.get_physical_value< QUANTITY_TEMPERATURE >(
+                "TemperatureCalculator:line cooling table minimum temperature",
+                "1000. K"),
+            params.get_physical_value< QUANTITY_TEMPERATURE >(
+                "TemperatureCalculator:line cooling table maximum temperature",
+                "1.e5 K"),
+            params.get_value< uint_fast32_t >(
+                "TemperatureCalculator:line cooling table number of "
+                "temperature bins",
+                400),
+            params.get_physical_value< QUANTITY_NUMBER_DENSITY >(
+                "TemperatureCalculator:line cooling table minimum electron "
+                "density",
+                "1.e-6 cm^-3"),
+            params.get_physical_value< QUANTITY_NUMBER_DENSITY >(
+                "TemperatureCalculator:line cooling table maximum electron "
+                "density",
+                "1.e8 cm^-3"),
+            params.get_value< uint_fast32_t >(
+                "TemperatureCalculator:line cooling table number of electron "
+                "density bins",
+                280),
+            params.get_value< double >(
+                "TemperatureCalculator:line cooling table tolerance", 1.e-3),
+            log) {}
+
+  /**
+   * @brief Get the number of bins that need to be evaluated exactly.
+   *
+   * @return Number of bins in which bilinear interpolation is not accurate
+   * enough.
+   */
+  inline uint_fast32_t get_number_of_exact_bins() const {
+    return _number_of_exact_bins;
+  }
+
+  /**
+   * @brief Get the radiative energy losses due to line cooling at the given
+   * temperature, electron density and coolant abundances.
+   *
+   * @param temperature Temperature (in K).
+   * @param electron_density Electron density (in m^-3).
+   * @param abundances Abundances of coolants.
+   * @return Radiative cooling per hydrogen atom (in kg m^2s^-3), with the same
+   * behaviour as LineCoolingData::get_cooling().
+   */
+  inline double
+  get_cooling(const double temperature, const double electron_density,
+              const double abundances[LINECOOLINGDATA_NUMELEMENTS]) const {
+
+    // note that the conditions below are also false for a zero electron
+    // density, since its logarithm is -inf
+    const double u = (std::log(temperature) - _minimum_log_temperature) *
+                     _inverse_log_temperature_step;
+    const double v =
+        (std::log(electron_density) - _minimum_log_electron_density) *
+        _inverse_log_electron_density_step;
+    if (!(u >= 0. && u < _number_of_temperature_bins && v >= 0. &&
+          v < _number_of_electron_density_bins)) {
+      return _line_cooling_data.get_cooling(temperature, electron_density,
+                                            abundances);
+    }
+    const uint_fast32_t itemperature = u;
+    const uint_fast32_t idensity = v;
+    if (_exact_bins[itemperature * _number_of_electron_density_bins +
+                    idensity]) {
+      return _line_cooling_data.get_cooling(temperature, electron_density,
+                                            abundances);
+    }
+
+    double log_cooling[LINECOOLINGDATA_NUMELEMENTS];
+    interpolate(itemperature, idensity, u - itemperature, v - idensity,
+                log_cooling);
+    double cooling = 0.;
+    for (int_fast32_t element = 0; element < LINECOOLINGDATA_NUMELEMENTS;
+         ++element) {
+      cooling += abundances[element] * std::exp(log_cooling[element]);
+    }
+    return cooling;
+  }
+};
+
+#endif // LINECOOLINGTABLE_HPP
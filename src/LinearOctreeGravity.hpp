@@ -0,0 +1,552 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file LinearOctreeGravity.hpp
+ *
+ * @brief Self-gravity solver based on a Morton sorted linear octree with
+ * quadrupole moments.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#ifndef LINEAROCTREEGRAVITY_HPP
+#define LINEAROCTREEGRAVITY_HPP
+
+#include "Box.hpp"
+#include "Error.hpp"
+#include "MortonKeyGenerator.hpp"
+#include "OpenMP.hpp"
+#include "PhysicalConstants.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Self-gravity solver based on a Morton sorted linear octree with
+ * quadrupole moments.
+ *
+ * The tree is built in parallel: the particles are sorted on their Morton
+ * key, after which every node corresponds to a contiguous range of sorted
+ * particles. The nodes are created level by level, with all children of a
+ * node stored contiguously, so that the nodes of a level can be created and
+ * updated in parallel.
+ *
+ * Every node stores its mass, centre of mass and the traceless quadrupole
+ * moment about its centre of mass. When only the masses of the particles
+ * change (as is the case for the cells of a fixed grid), the moments can be
+ * updated in place using update_masses(), without rebuilding the tree.
+ *
+ * Accelerations are computed using a cell-group walk: the particles in a leaf
+ * share a single tree walk. A node is used as a whole if it satisfies the
+ * opening criterion
+ * \f[
+ *   w < \theta{} \left(d - r_g\right),
+ * \f]
+ * with \f$w\f$ the width of the node, \f$d\f$ the distance between the centre
+ * of mass of the node and the centre of the leaf, \f$r_g\f$ the radius of the
+ * leaf and \f$\theta{}\f$ the opening angle. Particles in leaves that do not
+ * satisfy the criterion interact directly.
+ */
+class LinearOctreeGravity {
+private:
+  /**
+   * @brief Node of the tree.
+   */
+  class Node {
+  public:
+    /*! @brief Index of the first particle in the node (in sorted order). */
+    size_t _first_particle;
+
+    /*! @brief Index of the first particle after the node (in sorted
+     *  order). */
+    size_t _last_particle;
+
+    /*! @brief Index of the first child of the node. */
+    size_t _first_child;
+
+    /*! @brief Number of children (0 for a leaf). */
+    uint_fast8_t _number_of_children;
+
+    /*! @brief Geometrical centre of the node (in m). */
+    CoordinateVector<> _centre;
+
+    /*! @brief Width of the node (in m). */
+    double _width;
+
+    /*! @brief Maximum distance between a particle in the node and the
+     *  geometrical centre of the node (in m). */
+    double _radius;
+
+    /*! @brief Total mass of the node (in kg). */
+    double _mass;
+
+    /*! @brief Centre of mass of the node (in m). */
+    CoordinateVector<> _centre_of_mass;
+
+    /*! @brief Traceless quadrupole moment about the centre of mass (xx, xy, xz,
+     *  yy, yz, zz; in kg m^2). */
+    double _quadrupole[6];
+  };
+
+  /*! @brief Opening angle. */
+  const double _opening_angle;
+
+  /*! @brief Maximum number of particles in a leaf. */
+  const size_t _leaf_size;
+
+  /*! @brief Newton's gravitational constant (in m^3 kg^-1 s^-2). */
+  const double _G;
+
+  /*! @brief Cube that contains all particles (in m). */
+  Box<> _box;
+
+  /*! @brief Original index of each sorted particle. */
+  std::vector< size_t > _order;
+
+  /*! @brief Sorted Morton keys. */
+  std::vector< morton_key_t > _keys;
+
+  /*! @brief Sorted particle positions (in m). */
+  std::vector< CoordinateVector<> > _positions;
+
+  /*! @brief Sorted particle masses (in kg). */
+  std::vector< double > _masses;
+
+  /*! @brief Nodes, level by level. */
+  std::vector< Node > _nodes;
+
+  /*! @brief Offsets of the levels in the node array. */
+  std::vector< size_t > _level_offsets;
+
+  /*! @brief Indices of the leaves. */
+  std::vector< size_t > _leaves;
+
+  /**
+   * @brief Compute the moments of the given node.
+   *
+   * The moments of the children of the node need to be up to date.
+   *
+   * @param node Node.
+   */
+  inline void compute_moments(Node &node) const {
+
+    double mass = 0.;
+    CoordinateVector<> mass_position;
+    if (node._number_of_children == 0) {
+      for (size_t i = node._first_particle; i < node._last_particle; ++i) {
+        mass += _masses[i];
+        mass_position += _masses[i] * _positions[i];
+      }
+    } else {
+      for (size_t i = 0; i < node._number_of_children; ++i) {
+        const Node &child = _nodes[node._first_child + i];
+        mass += child._mass;
+        mass_position += child._mass * child._centre_of_mass;
+      }
+    }
+    node._mass = mass;
+    node._centre_of_mass = (mass > 0.) ? mass_position / mass : node._centre;
+
+    for (uint_fast8_t i = 0; i < 6; ++i) {
+      node._quadrupole[i] = 0.;
+    }
+    if (node._number_of_children == 0) {
+      for (size_t i = node._first_particle; i < node._last_particle; ++i) {
+        add_quadrupole(_masses[i], _positions[i] - node._centre_of_mass,
+                       node._quadrupole);
+      }
+    } else {
+      // parallel axis theorem
+      for (size_t i = 0; i < node._number_of_children; ++i) {
+        const Node &child = _nodes[node._first_child + i];
+        for (uint_fast8_t j = 0; j < 6; ++j) {
+          node._quadrupole[j] += child._quadrupole[j];
+        }
+        add_quadrupole(child._mass,
+                       child._centre_of_mass - node._centre_of_mass,
+                       node._quadrupole);
+      }
+    }
+  }
+
+  /**
+   * @brief Add the quadrupole moment of a point mass at the given offset.
+   *
+   * @param mass Mass (in kg).
+   * @param d Offset w.r.t. the centre of mass (in m).
+   * @param quadrupole Quadrupole moment to update (in kg m^2).
+   */
+  inline static void add_quadrupole(const double mass,
+                                    const CoordinateVector<> d,
+                                    double *quadrupole) {
+    const double d2 = d.norm2();
+    quadrupole[0] += mass * (3. * d.x() * d.x() - d2);
+    quadrupole[1] += mass * 3. * d.x() * d.y();
+    quadrupole[2] += mass * 3. * d.x() * d.z();
+    quadrupole[3] += mass * (3. * d.y() * d.y() - d2);
+    quadrupole[4] += mass * 3. * d.y() * d.z();
+    quadrupole[5] += mass * (3. * d.z() * d.z() - d2);
+  }
+
+  /**
+   * @brief Add the contribution of the multipole expansion of the given node
+   * to the acceleration and potential at the given position.
+   *
+   * @param node Node.
+   * @param position Position (in m).
+   * @param acceleration Acceleration to update (in m s^-2, without G).
+   * @param potential Potential to update (in m^2 s^-2, without G).
+   */
+  inline static void add_multipole(const Node &node,
+                                   const CoordinateVector<> position,
+                                   CoordinateVector<> &acceleration,
+                                   double &potential) {
+
+    const CoordinateVector<> r = position - node._centre_of_mass;
+    const double r2 = r.norm2();
+    const double inverse_r = 1. / std::sqrt(r2);
+    const double inverse_r2 = inverse_r * inverse_r;
+    const double inverse_r3 = inverse_r * inverse_r2;
+    const double inverse_r5 = inverse_r3 * inverse_r2;
+    const double *Q = node._quadrupole;
+    const CoordinateVector<> Qr(Q[0] * r.x() + Q[1] * r.y() + Q[2] * r.z(),
+                                Q[1] * r.x() + Q[3] * r.y() + Q[4] * r.z(),
+                                Q[2] * r.x() + Q[4] * r.y() + Q[5] * r.z());
+    const double rQr = CoordinateVector<>::dot_product(r, Qr);
+    acceleration += -node._mass * inverse_r3 * r + inverse_r5 * Qr -
+                    2.5 * rQr * inverse_r5 * inverse_r2 * r;
+    potential += -node._mass * inverse_r - 0.5 * rQr * inverse_r5;
+  }
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param box Box that contains all particles (in m).
+   * @param opening_angle Opening angle.
+   * @param leaf_size Maximum number of particles in a leaf.
+   * @param G Newton's gravitational constant (in m^3 kg^-1 s^-2).
+   */
+  inline LinearOctreeGravity(
+      const Box<> &box, const double opening_angle, const size_t leaf_size = 8,
+      const double G = PhysicalConstants::get_physical_constant(
+          PHYSICALCONSTANT_NEWTON_CONSTANT))
+      : _opening_angle(opening_angle), _leaf_size(leaf_size), _G(G),
+        _box(box.get_anchor(), CoordinateVector<>(box.get_sides().max())) {
+
+    if (_leaf_size == 0) {
+      cmac_error("Leaf size should be at least 1!");
+    }
+  }
+
+  /**
+   * @brief Build the tree for the given particles.
+   *
+   * @param positions Particle positions (in m).
+   * @param masses Particle masses (in kg).
+   */
+  inline void build(const std::vector< CoordinateVector<> > &positions,
+                    const std::vector< double > &masses) {
+
+    const size_t number_of_particles = positions.size();
+    const MortonKeyGenerator key_generator(_box);
+
+    std::vector< std::pair< morton_key_t, size_t > > keys(number_of_particles);
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+    for (size_t i = 0; i < number_of_particles; ++i) {
+      keys[i] = std::make_pair(key_generator.get_key(positions[i]), i);
+    }
+    MortonKeyGenerator::parallel_sort(keys);
+
+    _order.resize(number_of_particles);
+    _keys.resize(number_of_particles);
+    _positions.resize(number_of_particles);
+    _masses.resize(number_of_particles);
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+    for (size_t i = 0; i < number_of_particles; ++i) {
+      _keys[i] = keys[i].first;
+      _order[i] = keys[i].second;
+      _positions[i] = positions[_order[i]];
+    }
+
+    _nodes.clear();
+    _level_offsets.clear();
+    _leaves.clear();
+    if (number_of_particles == 0) {
+      return;
+    }
+
+    _nodes.resize(1);
+    _nodes[0]._first_particle = 0;
+    _nodes[0]._last_particle = number_of_particles;
+    _nodes[0]._width = _box.get_sides().x();
+    _nodes[0]._centre = _box.get_anchor() + 0.5 * _box.get_sides();
+    _level_offsets.push_back(0);
+    _level_offsets.push_back(1);
+
+    // Morton keys have 21 levels below the root
+    for (uint_fast8_t level = 0; level < 22; ++level) {
+      const size_t level_begin = _level_offsets[level];
+      const size_t level_size = _level_offsets[level + 1] - level_begin;
+      if (level_size == 0) {
+        break;
+      }
+
+      // find the particle ranges of the children of all nodes on this level
+      std::vector< size_t > splits(9 * level_size);
+      std::vector< size_t > child_offsets(level_size + 1, 0);
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+      for (size_t inode = 0; inode < level_size; ++inode) {
+        const Node &node = _nodes[level_begin + inode];
+        if (level < 21 &&
+            node._last_particle - node._first_particle > _leaf_size) {
+          const uint_fast8_t shift = 3 * (20 - level);
+          const morton_key_t prefix =
+              _keys[node._first_particle] & ~((morton_key_t(8) << shift) - 1);
+          for (uint_fast8_t ichild = 0; ichild < 8; ++ichild) {
+            splits[9 * inode + ichild] =
+                std::lower_bound(_keys.begin() + node._first_particle,
+                                 _keys.begin() + node._last_particle,
+                                 prefix | (morton_key_t(ichild) << shift)) -
+                _keys.begin();
+          }
+          splits[9 * inode + 8] = node._last_particle;
+          for (uint_fast8_t ichild = 0; ichild < 8; ++ichild) {
+            if (splits[9 * inode + ichild + 1] > splits[9 * inode + ichild]) {
+              ++child_offsets[inode + 1];
+            }
+          }
+        }
+      }
+      for (size_t inode = 0; inode < level_size; ++inode) {
+        child_offsets[inode + 1] += child_offsets[inode];
+      }
+
+      // create the children
+      const size_t level_end = level_begin + level_size;
+      _nodes.resize(level_end + child_offsets[level_size]);
+      _level_offsets.push_back(level_end + child_offsets[level_size]);
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+      for (size_t inode = 0; inode < level_size; ++inode) {
+        Node &node = _nodes[level_begin + inode];
+        node._first_child = level_end + child_offsets[inode];
+        node._number_of_children =
+            child_offsets[inode + 1] - child_offsets[inode];
+        size_t ichild_node = node._first_child;
+        for (uint_fast8_t ichild = 0; ichild < 8 && node._number_of_children;
+             ++ichild) {
+          if (splits[9 * inode + ichild + 1] > splits[9 * inode + ichild]) {
+            Node &child = _nodes[ichild_node];
+            child._first_particle = splits[9 * inode + ichild];
+            child._last_particle = splits[9 * inode + ichild + 1];
+            child._width = 0.5 * node._width;
+            const double offset = 0.25 * node._width;
+            child._centre = node._centre +
+                            CoordinateVector<>((ichild & 4) ? offset : -offset,
+                                               (ichild & 2) ? offset : -offset,
+                                               (ichild & 1) ? offset : -offset);
+            ++ichild_node;
+          }
+        }
+        if (node._number_of_children == 0) {
+          node._radius = 0.;
+          for (size_t i = node._first_particle; i < node._last_particle; ++i) {
+            node._radius = std::max(node._radius,
+                                    (_positions[i] - node._centre).norm());
+          }
+        }
+      }
+    }
+    // remove the empty last level
+    while (_level_offsets.size() > 1 &&
+           _level_offsets[_level_offsets.size() - 1] ==
+               _level_offsets[_level_offsets.size() - 2]) {
+      _level_offsets.pop_back();
+    }
+
+    for (size_t i = 0; i < _nodes.size(); ++i) {
+      if (_nodes[i]._number_of_children == 0) {
+        _leaves.push_back(i);
+      }
+    }
+
+    update_masses(masses);
+  }
+
+  /**
+   * @brief Update the particle masses and the node moments without changing
+   * the tree structure.
+   *
+   * @param masses New particle masses, in the order used to build the tree
+   * (in kg).
+   */
+  inline void update_masses(const std::vector< double > &masses) {
+
+    cmac_assert(masses.size() == _order.size());
+
+    const size_t number_of_particles = _order.size();
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+    for (size_t i = 0; i < number_of_particles; ++i) {
+      _masses[i] = masses[_order[i]];
+    }
+
+    // bottom-up: all children of a level live on the next level
+    for (size_t level = _level_offsets.size() - 1; level > 0; --level) {
+      const size_t level_begin = _level_offsets[level - 1];
+      const size_t level_end = _level_offsets[level];
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+      for (size_t inode = level_begin; inode < level_end; ++inode) {
+        compute_moments(_nodes[inode]);
+      }
+    }
+  }
+
+  /**
+   * @brief Compute the gravitational acceleration and potential for all
+   * particles.
+   *
+   * @param accelerations Accelerations, in the order used to build the tree
+   * (in m s^-2).
+   * @param potentials Gravitational potentials (per unit mass), in the order
+   * used to build the tree (in m^2 s^-2).
+   */
+  inline void compute_accelerations(
+      std::vector< CoordinateVector<> > &accelerations,
+      std::vector< double > &potentials) const {
+
+    accelerations.resize(_order.size());
+    potentials.resize(_order.size());
+
+    const size_t number_of_leaves = _leaves.size();
+#ifdef HAVE_OPENMP
+#pragma omp parallel default(shared)
+#endif
+    {
+      std::vector< size_t > stack;
+      std::vector< CoordinateVector<> > group_accelerations;
+      std::vector< double > group_potentials;
+#ifdef HAVE_OPENMP
+#pragma omp for schedule(dynamic, 16)
+#endif
+      for (size_t ileaf = 0; ileaf < number_of_leaves; ++ileaf) {
+        const Node &group = _nodes[_leaves[ileaf]];
+        const size_t group_first = group._first_particle;
+        const size_t group_size = group._last_particle - group_first;
+        group_accelerations.assign(group_size, CoordinateVector<>(0.));
+        group_potentials.assign(group_size, 0.);
+
+        stack.clear();
+        stack.push_back(0);
+        while (!stack.empty()) {
+          const Node &node = _nodes[stack.back()];
+          stack.pop_back();
+
+          const bool contains_group =
+              node._first_particle <= group_first &&
+              group._last_particle <= node._last_particle;
+          if (!contains_group) {
+            const double distance =
+                (node._centre_of_mass - group._centre).norm() - group._radius;
+            if (distance > 0. && node._width < _opening_angle * distance) {
+              for (size_t i = 0; i < group_size; ++i) {
+                add_multipole(node, _positions[group_first + i],
+                              group_accelerations[i], group_potentials[i]);
+              }
+              continue;
+            }
+          }
+
+          if (node._number_of_children > 0) {
+            for (uint_fast8_t ichild = 0; ichild < node._number_of_children;
+                 ++ichild) {
+              stack.push_back(node._first_child + ichild);
+            }
+          } else {
+            // direct summation (this includes the group itself)
+            for (size_t i = 0; i < group_size; ++i) {
+              const CoordinateVector<> &position = _positions[group_first + i];
+              for (size_t j = node._first_particle; j < node._last_particle;
+                   ++j) {
+                const CoordinateVector<> r = position - _positions[j];
+                const double r2 = r.norm2();
+                if (r2 > 0.) {
+                  const double inverse_r = 1. / std::sqrt(r2);
+                  group_accelerations[i] -=
+                      _masses[j] * inverse_r * inverse_r * inverse_r * r;
+                  group_potentials[i] -= _masses[j] * inverse_r;
+                }
+              }
+            }
+          }
+        }
+
+        for (size_t i = 0; i < group_size; ++i) {
+          const size_t index = _order[group_first + i];
+          accelerations[index] = _G * group_accelerations[i];
+          potentials[index] = _G * group_potentials[i];
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Get the number of particles in the tree.
+   *
+   * @return Number of particles.
+   */
+  inline size_t get_number_of_particles() const { return _order.size(); }
+
+  /**
+   * @brief Get the number of nodes in the tree.
+   *
+   * @return Number of nodes (including the leaves).
+   */
+  inline size_t get_number_of_nodes() const { return _nodes.size(); }
+
+  /**
+   * @brief Get the number of leaves in the tree.
+   *
+   * @return Number of leaves.
+   */
+  inline size_t get_number_of_leaves() const { return _leaves.size(); }
+
+  /**
+   * @brief Get the number of levels in the tree.
+   *
+   * @return Number of levels (including the root level).
+   */
+  inline size_t get_number_of_levels() const {
+    return _level_offsets.empty() ? 0 : _level_offsets.size() - 1;
+  }
+};
+
+#endif // LINEAROCTREEGRAVITY_HPP
@@ -87,12 +87,21 @@ private:
   /*! @brief Total number of MPI processes. */
   int_fast32_t _size;
 
+  /*! @brief Can MPI functions be called from multiple threads (provided only
+   *  one thread calls them at any given time)? */
+  bool _thread_support;
+
 public:
   /**
    * @brief Constructor.
    *
-   * Calls MPI_Init(), sets up custom error handling, and initializes rank and
-   * size variables.
+   * Calls MPI_Init_thread(), sets up custom error handling, and initializes
+   * rank and size variables.
+   *
+   * We ask for MPI_THREAD_SERIALIZED support, which allows any thread to make
+   * MPI calls, as long as those calls are not made simultaneously. If the MPI
+   * library does not provide this level of support, has_thread_support() will
+   * return false.
    *
    * @param argc Number of command line arguments passed on to the main program.
    * @param argv Command line arguments passed on to the main program.
@@ -103,11 +112,14 @@ public:
     // MPI_Init is known to cause memory leak detections, so we disable the
     // address sanitizer for all allocations made by it
     NO_LEAK_CHECK_BEGIN
-    int_fast32_t status = MPI_Init(&argc, &argv);
+    int provided;
+    int_fast32_t status =
+        MPI_Init_thread(&argc, &argv, MPI_THREAD_SERIALIZED, &provided);
     NO_LEAK_CHECK_END
     if (status != MPI_SUCCESS) {
       cmac_error("Failed to initialize MPI!");
     }
+    _thread_support = (provided >= MPI_THREAD_SERIALIZED);
 
     // make sure errors are handled by us, not by the MPI library
     MPI_Comm_set_errhandler(MPI_COMM_WORLD, MPI_ERRORS_RETURN);
@@ -166,6 +178,7 @@ public:
     // no MPI: we assume a single process with rank 0
     _rank = 0;
     _size = 1;
+    _thread_support = true;
 #endif
   }
 
@@ -197,6 +210,14 @@ public:
    */
   inline int_fast32_t get_size() const { return _size; }
 
+  /**
+   * @brief Can MPI functions safely be called from within a parallel region?
+   *
+   * @return True if the MPI library supports calls from multiple threads, as
+   * long as only one thread makes a call at any given time.
+   */
+  inline bool has_thread_support() const { return _thread_support; }
+
   /**
    * @brief Distribute the given number across all processes, so that the sum of
    * the returned values across all processes is the given number.
@@ -27,7 +27,6 @@
 #include "PhotonSourceSpectrumFactory.hpp"
 #include "PhotonSourceSpectrumMaskFactory.hpp"
 #include "RandomGenerator.hpp"
-#include "Utilities.hpp"
 
 /**
  * @brief Constructor.
@@ -82,6 +81,7 @@ MaskedPhotonSourceSpectrum::MaskedPhotonSourceSpectrum(
   for (uint_fast16_t i = 0; i < number_of_bins; ++i) {
     _cumulative_distribution[i] *= norm_inv;
   }
+  _alias_table.initialize(_cumulative_distribution.data(), number_of_bins);
 
   // apply the mask to the total ionizing flux
   _ionizing_flux =
@@ -123,15 +123,26 @@ MaskedPhotonSourceSpectrum::MaskedPhotonSourceSpectrum(std::string role,
 double MaskedPhotonSourceSpectrum::get_random_frequency(
     RandomGenerator &random_generator, double temperature) const {
 
-  const double x = random_generator.get_uniform_random_double();
-  const uint_fast32_t inu = Utilities::locate(
-      x, _cumulative_distribution.data(), _frequency_bins.size());
-  const double frequency =
-      _frequency_bins[inu] +
-      (_frequency_bins[inu + 1] - _frequency_bins[inu]) *
-          (x - _cumulative_distribution[inu]) /
-          (_cumulative_distribution[inu + 1] - _cumulative_distribution[inu]);
-  return frequency;
+  return _alias_table.sample_linear(
+      random_generator.get_uniform_random_double(), _frequency_bins.data());
+}
+
+/**
+ * @brief Get a batch of random frequencies from the spectrum.
+ *
+ * @param random_generator RandomGenerator to use.
+ * @param frequencies Array to store the random frequencies in (in Hz).
+ * @param number_of_frequencies Number of frequencies to draw.
+ * @param temperature Not used for this spectrum.
+ */
+void MaskedPhotonSourceSpectrum::get_random_frequencies(
+    RandomGenerator &random_generator, double *frequencies,
+    const uint_fast32_t number_of_frequencies, double temperature) const {
+
+  for (uint_fast32_t i = 0; i < number_of_frequencies; ++i) {
+    frequencies[i] = _alias_table.sample_linear(
+        random_generator.get_uniform_random_double(), _frequency_bins.data());
+  }
 }
 
 /**
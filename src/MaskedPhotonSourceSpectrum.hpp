@@ -26,6 +26,7 @@
 #ifndef MASKEDPHOTONSOURCESPECTRUM_HPP
 #define MASKEDPHOTONSOURCESPECTRUM_HPP
 
+#include "AliasTable.hpp"
 #include "PhotonSourceSpectrum.hpp"
 
 #include <cstdint>
@@ -47,6 +48,9 @@ private:
   /*! @brief Cumulative distribution in each bin. */
   std::vector< double > _cumulative_distribution;
 
+  /*! @brief Alias table used to sample the cumulative distribution. */
+  AliasTable _alias_table;
+
   /*! @brief Total ionizing flux of the spectrum (in m^-2 s^-1). */
   double _ionizing_flux;
 
@@ -67,6 +71,11 @@ public:
   virtual double get_random_frequency(RandomGenerator &random_generator,
                                       double temperature) const;
 
+  virtual void get_random_frequencies(RandomGenerator &random_generator,
+                                      double *frequencies,
+                                      const uint_fast32_t number_of_frequencies,
+                                      double temperature) const;
+
   virtual double get_total_flux() const;
 
   // unit testing routines
@@ -96,13 +96,7 @@ public:
   inline size_t add_photons(const size_t index, const PhotonBuffer &buffer) {
 
     PhotonBuffer &buffer_target = _memory_space[index];
-    const uint_fast32_t size_in = buffer.size();
-    uint_fast32_t counter_in = 0;
-    while (buffer_target.size() < PHOTONBUFFER_SIZE && counter_in < size_in) {
-      const uint_fast32_t target_index = buffer_target.get_next_free_photon();
-      buffer_target[target_index] = buffer[counter_in];
-      ++counter_in;
-    }
+    const uint_fast32_t counter_in = buffer_target.add_photons(buffer);
     size_t index_out = index;
     if (buffer_target.size() == PHOTONBUFFER_SIZE) {
       index_out = get_free_buffer();
@@ -114,12 +108,7 @@ public:
       buffer_target_new.set_subgrid_index(buffer_target.get_subgrid_index());
       buffer_target_new.set_direction(buffer_target.get_direction());
       // maybe assert that this value is indeed 0?
-      while (counter_in < size_in) {
-        const uint_fast32_t target_index =
-            buffer_target_new.get_next_free_photon();
-        buffer_target_new[target_index] = buffer[counter_in];
-        ++counter_in;
-      }
+      buffer_target_new.add_photons(buffer, counter_in);
     }
     return index_out;
   }
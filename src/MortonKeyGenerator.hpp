@@ -27,7 +27,10 @@
 #define MORTONKEYGENERATOR_HPP
 
 #include "Box.hpp"
+#include "OpenMP.hpp"
 
+#include <algorithm>
+#include <utility>
 #include <vector>
 
 /*! @brief Morton key type. */
@@ -112,6 +115,49 @@ public:
     }
     return keys;
   }
+
+  /**
+   * @brief Sort the given key-index pairs in parallel.
+   *
+   * Every thread sorts a chunk, after which the chunks are merged pairwise.
+   *
+   * @param keys Key-index pairs to sort.
+   */
+  inline static void
+  parallel_sort(std::vector< std::pair< morton_key_t, size_t > > &keys) {
+
+    const size_t number_of_chunks =
+        std::max(std::min(static_cast< size_t >(get_max_number_of_threads()),
+                          keys.size() / 1024),
+                 static_cast< size_t >(1));
+    std::vector< size_t > chunk_offsets(number_of_chunks + 1);
+    for (size_t i = 0; i < number_of_chunks + 1; ++i) {
+      chunk_offsets[i] = (i * keys.size()) / number_of_chunks;
+    }
+
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+    for (size_t i = 0; i < number_of_chunks; ++i) {
+      std::sort(keys.begin() + chunk_offsets[i],
+                keys.begin() + chunk_offsets[i + 1]);
+    }
+
+    for (size_t width = 1; width < number_of_chunks; width *= 2) {
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+      for (size_t i = 0; i < number_of_chunks; i += 2 * width) {
+        if (i + width < number_of_chunks) {
+          std::inplace_merge(
+              keys.begin() + chunk_offsets[i],
+              keys.begin() + chunk_offsets[i + width],
+              keys.begin() +
+                  chunk_offsets[std::min(i + 2 * width, number_of_chunks)]);
+        }
+      }
+    }
+  }
 };
 
 #endif // MORTONKEYGENERATOR_HPP
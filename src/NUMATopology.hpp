@@ -0,0 +1,304 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file NUMATopology.hpp
+ *
+ * @brief Mapping of threads onto the NUMA domains and cores of the system.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#ifndef NUMATOPOLOGY_HPP
+#define NUMATOPOLOGY_HPP
+
+#include "Error.hpp"
+#include "Log.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+/**
+ * @brief Mapping of threads onto the NUMA domains and cores of the system.
+ *
+ * On Linux, the NUMA domains and the cores that belong to them are read from
+ * /sys/devices/system/node, and cores that are not in the affinity mask of the
+ * process are ignored. On other systems, or if the information is not
+ * available, all cores are assumed to belong to a single domain.
+ *
+ * Threads are distributed over the domains in contiguous blocks, so that
+ * thread 0 to T/D-1 run on the first domain, T/D to 2T/D-1 on the second,
+ * and so on (with T the number of threads and D the number of domains).
+ * Within a domain, every thread is assigned its own core (as long as there are
+ * enough cores).
+ */
+class NUMATopology {
+private:
+  /*! @brief Cores that belong to each NUMA domain. */
+  std::vector< std::vector< int_fast32_t > > _domain_cores;
+
+  /*! @brief NUMA domain of each thread. */
+  std::vector< int_fast32_t > _thread_domains;
+
+  /*! @brief Core assigned to each thread. */
+  std::vector< int_fast32_t > _thread_cores;
+
+  /*! @brief Order in which each thread visits the other threads when it
+   *  tries to steal a task: threads in the same domain come first. */
+  std::vector< std::vector< int_fast32_t > > _steal_orders;
+
+  /**
+   * @brief Parse a Linux CPU list, e.g. "0-3,8,10-11".
+   *
+   * @param list CPU list.
+   * @return Indices in the list.
+   */
+  inline static std::vector< int_fast32_t >
+  parse_cpu_list(const std::string list) {
+
+    std::vector< int_fast32_t > indices;
+    std::istringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+      if (range.empty() || range[0] == '\n') {
+        continue;
+      }
+      const size_t dash = range.find('-');
+      const int_fast32_t first = std::stoi(range.substr(0, dash));
+      const int_fast32_t last = (dash == std::string::npos)
+                                    ? first
+                                    : std::stoi(range.substr(dash + 1));
+      for (int_fast32_t i = first; i <= last; ++i) {
+        indices.push_back(i);
+      }
+    }
+    return indices;
+  }
+
+public:
+  /**
+   * @brief Detect the NUMA domains of the system.
+   *
+   * @return Cores that belong to each NUMA domain that has cores available to
+   * this process.
+   */
+  inline static std::vector< std::vector< int_fast32_t > > detect_domains() {
+
+    std::vector< std::vector< int_fast32_t > > domain_cores;
+#ifdef __linux__
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    const bool has_mask = sched_getaffinity(0, sizeof(mask), &mask) == 0;
+
+    std::ifstream online_file("/sys/devices/system/node/online");
+    if (online_file) {
+      std::string online;
+      std::getline(online_file, online);
+      const std::vector< int_fast32_t > nodes = parse_cpu_list(online);
+      for (size_t i = 0; i < nodes.size(); ++i) {
+        std::ifstream cpu_file("/sys/devices/system/node/node" +
+                               std::to_string(nodes[i]) + "/cpulist");
+        std::string cpus;
+        std::getline(cpu_file, cpus);
+        const std::vector< int_fast32_t > node_cores = parse_cpu_list(cpus);
+        std::vector< int_fast32_t > available_cores;
+        for (size_t j = 0; j < node_cores.size(); ++j) {
+          if (!has_mask || (node_cores[j] < CPU_SETSIZE &&
+                            CPU_ISSET(node_cores[j], &mask))) {
+            available_cores.push_back(node_cores[j]);
+          }
+        }
+        // memory only nodes and nodes we cannot run on are ignored
+        if (!available_cores.empty()) {
+          domain_cores.push_back(available_cores);
+        }
+      }
+    }
+#endif
+
+    if (domain_cores.empty()) {
+      const int_fast32_t number_of_cores =
+          std::max(std::thread::hardware_concurrency(), 1u);
+      domain_cores.resize(1);
+      for (int_fast32_t i = 0; i < number_of_cores; ++i) {
+        domain_cores[0].push_back(i);
+      }
+    }
+    return domain_cores;
+  }
+
+  /**
+   * @brief Constructor.
+   *
+   * @param domain_cores Cores that belong to each NUMA domain.
+   * @param number_of_threads Number of threads.
+   */
+  inline NUMATopology(
+      const std::vector< std::vector< int_fast32_t > > &domain_cores,
+      const int_fast32_t number_of_threads)
+      : _domain_cores(domain_cores), _thread_domains(number_of_threads, 0),
+        _thread_cores(number_of_threads, 0),
+        _steal_orders(number_of_threads) {
+
+    const int_fast32_t number_of_domains = _domain_cores.size();
+    if (number_of_domains == 0) {
+      cmac_error("No NUMA domains given!");
+    }
+
+    // contiguous blocks of threads per domain
+    std::vector< int_fast32_t > domain_first_thread(number_of_domains + 1,
+                                                    number_of_threads);
+    for (int_fast32_t ithread = number_of_threads - 1; ithread >= 0;
+         --ithread) {
+      const int_fast32_t domain =
+          (ithread * number_of_domains) / number_of_threads;
+      _thread_domains[ithread] = domain;
+      domain_first_thread[domain] = ithread;
+    }
+    for (int_fast32_t idomain = number_of_domains - 1; idomain >= 0;
+         --idomain) {
+      domain_first_thread[idomain] = std::min(domain_first_thread[idomain],
+                                              domain_first_thread[idomain + 1]);
+    }
+    for (int_fast32_t ithread = 0; ithread < number_of_threads; ++ithread) {
+      const int_fast32_t domain = _thread_domains[ithread];
+      const std::vector< int_fast32_t > &cores = _domain_cores[domain];
+      if (cores.empty()) {
+        cmac_error("NUMA domain %" PRIiFAST32 " has no cores!", domain);
+      }
+      _thread_cores[ithread] =
+          cores[(ithread - domain_first_thread[domain]) % cores.size()];
+    }
+
+    // steal from the other threads in the same domain first (round robin,
+    // starting from the next thread), then from the threads in the next
+    // domains
+    for (int_fast32_t ithread = 0; ithread < number_of_threads; ++ithread) {
+      const int_fast32_t domain = _thread_domains[ithread];
+      std::vector< int_fast32_t > &order = _steal_orders[ithread];
+      for (int_fast32_t idomain = 0; idomain < number_of_domains; ++idomain) {
+        const int_fast32_t this_domain = (domain + idomain) % number_of_domains;
+        const int_fast32_t first = domain_first_thread[this_domain];
+        const int_fast32_t size = domain_first_thread[this_domain + 1] - first;
+        const int_fast32_t offset = (idomain == 0) ? ithread - first + 1 : 0;
+        for (int_fast32_t i = 0; i < size; ++i) {
+          const int_fast32_t victim = first + (offset + i) % size;
+          if (victim != ithread) {
+            order.push_back(victim);
+          }
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Constructor that detects the NUMA domains of the system.
+   *
+   * @param number_of_threads Number of threads.
+   * @param log Log to write logging info to.
+   */
+  inline NUMATopology(const int_fast32_t number_of_threads, Log *log = nullptr)
+      : NUMATopology(detect_domains(), number_of_threads) {
+
+    if (log) {
+      log->write_status("Distributing ", number_of_threads, " threads over ",
+                        _domain_cores.size(), " NUMA domain(s).");
+    }
+  }
+
+  /**
+   * @brief Get the number of NUMA domains.
+   *
+   * @return Number of NUMA domains.
+   */
+  inline int_fast32_t get_number_of_domains() const {
+    return _domain_cores.size();
+  }
+
+  /**
+   * @brief Get the number of threads.
+   *
+   * @return Number of threads.
+   */
+  inline int_fast32_t get_number_of_threads() const {
+    return _thread_domains.size();
+  }
+
+  /**
+   * @brief Get the NUMA domain of the given thread.
+   *
+   * @param thread_id Thread index.
+   * @return NUMA domain the thread runs on.
+   */
+  inline int_fast32_t get_domain(const int_fast32_t thread_id) const {
+    return _thread_domains[thread_id];
+  }
+
+  /**
+   * @brief Get the core assigned to the given thread.
+   *
+   * @param thread_id Thread index.
+   * @return Core index.
+   */
+  inline int_fast32_t get_core(const int_fast32_t thread_id) const {
+    return _thread_cores[thread_id];
+  }
+
+  /**
+   * @brief Get the order in which the given thread should try to steal tasks
+   * from other threads.
+   *
+   * @param thread_id Thread index.
+   * @return Indices of all other threads, threads in the same NUMA domain
+   * first.
+   */
+  inline const std::vector< int_fast32_t > &
+  get_steal_order(const int_fast32_t thread_id) const {
+    return _steal_orders[thread_id];
+  }
+
+  /**
+   * @brief Pin the calling thread to the core assigned to the given thread.
+   *
+   * Memory that is first touched by the thread after this call will be
+   * allocated in its NUMA domain.
+   *
+   * @param thread_id Thread index of the calling thread.
+   * @return True if the thread was successfully pinned.
+   */
+  inline bool pin_thread(const int_fast32_t thread_id) const {
+#ifdef __linux__
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    CPU_SET(_thread_cores[thread_id], &mask);
+    return sched_setaffinity(0, sizeof(mask), &mask) == 0;
+#else
+    return false;
+#endif
+  }
+};
+
+#endif // NUMATOPOLOGY_HPP
@@ -31,17 +31,69 @@
 #include "Box.hpp"
 #include "CoordinateVector.hpp"
 #include "Error.hpp"
-#include "OctreeNode.hpp"
+#include "MortonKeyGenerator.hpp"
+#include "OpenMP.hpp"
 
+#include <algorithm>
 #include <cfloat>
+#include <cinttypes>
 #include <ostream>
 #include <vector>
 
+/*! @brief Default maximum number of positions in a leaf of the Octree. */
+#define OCTREE_DEFAULT_LEAF_SIZE 8
+
 /**
  * @brief Octree used to speed up neighbour searches.
+ *
+ * The tree is built in parallel: the positions are sorted on their Morton key,
+ * so that every node corresponds to a contiguous range of sorted positions.
+ * The nodes are stored in a single array in depth-first order. The first child
+ * of a node is the next node in the array, while every node stores a skip
+ * index that points to the first node after its subtree. Walking the tree then
+ * amounts to a single loop over the node array, where nodes that are not
+ * opened are skipped. Leaves contain up to a fixed number of positions, for
+ * which a sorted copy of the positions and auxiliary variables is stored.
+ *
+ * All neighbour searches are available in three flavours: a version that
+ * returns a new std::vector, a version that fills a std::vector provided by the
+ * caller (so that its memory can be reused between calls), and a version that
+ * calls a function for every neighbour, which does not allocate any memory.
+ * For a group of positions that are close together (e.g. the cells of a
+ * subgrid), for_each_ngb_block() walks the tree once for the entire group.
+ *
+ * Since the tree stores a sorted copy of the positions, it needs to be updated
+ * if the underlying positions change. If the positions only change slightly,
+ * refit() can be used to update the tree without changing its structure: the
+ * node boxes are then replaced by the bounding boxes of the positions they
+ * contain. If the positions change a lot, these bounding boxes start to
+ * overlap and the tree should be rebuilt.
  */
 class Octree {
 private:
+  /**
+   * @brief Node of the tree.
+   */
+  class Node {
+  public:
+    /*! @brief Geometrical box corresponding to the node. */
+    Box<> _box;
+
+    /*! @brief Auxiliary variable. */
+    double _variable;
+
+    /*! @brief Index of the first position in the node (in sorted order). */
+    uint_fast32_t _first_position;
+
+    /*! @brief Index of the first position after the node (in sorted
+     *  order). */
+    uint_fast32_t _last_position;
+
+    /*! @brief Index of the first node after the subtree of this node. For a
+     *  leaf, this is the index of the next node. */
+    uint_fast32_t _skip;
+  };
+
   /*! @brief Reference to the underlying positions. */
   std::vector< CoordinateVector<> > &_positions;
 
@@ -51,8 +103,93 @@ private:
   /*! @brief Periodicity flag. */
   const bool _is_periodic;
 
-  /*! @brief Root node. */
-  OctreeNode *_root;
+  /*! @brief Maximum number of positions in a leaf. */
+  const uint_fast32_t _leaf_size;
+
+  /*! @brief Original index of each sorted position. */
+  std::vector< uint_fast32_t > _order;
+
+  /*! @brief Sorted copy of the positions. */
+  std::vector< CoordinateVector<> > _sorted_positions;
+
+  /*! @brief Sorted copy of the auxiliary variables. */
+  std::vector< double > _variables;
+
+  /*! @brief Nodes, in depth-first order. */
+  std::vector< Node > _nodes;
+
+  /*! @brief Total volume of all leaves when the tree was built. */
+  double _leaf_volume;
+
+  /**
+   * @brief Check if the node with the given index is a leaf.
+   *
+   * @param inode Index of a node.
+   * @return True if the node has no children.
+   */
+  inline bool is_leaf(const uint_fast32_t inode) const {
+    return _nodes[inode]._skip == inode + 1;
+  }
+
+  /**
+   * @brief Get the distance between the given box and position, taking into
+   * account periodicity if necessary.
+   *
+   * @param box Box.
+   * @param position Position.
+   * @return Shortest distance between the box and the position.
+   */
+  inline double get_distance(const Box<> &box,
+                             const CoordinateVector<> position) const {
+    if (_is_periodic) {
+      return _box.periodic_distance(box, position);
+    } else {
+      return box.get_distance(position);
+    }
+  }
+
+  /**
+   * @brief Get the squared distance between the given two positions, taking
+   * into account periodicity if necessary.
+   *
+   * @param a First position.
+   * @param b Second position.
+   * @return Squared shortest distance between the two positions.
+   */
+  inline double get_distance2(const CoordinateVector<> a,
+                              const CoordinateVector<> b) const {
+    if (_is_periodic) {
+      return _box.periodic_distance(a, b).norm2();
+    } else {
+      return (a - b).norm2();
+    }
+  }
+
+  /**
+   * @brief Get the shortest distance between the given two boxes, taking into
+   * account periodicity if necessary.
+   *
+   * @param a First box.
+   * @param b Second box.
+   * @return Shortest distance between the two boxes.
+   */
+  inline double get_distance(const Box<> &a, const Box<> &b) const {
+
+    CoordinateVector<> dx;
+    for (uint_fast8_t i = 0; i < 3; ++i) {
+      const double alow = a.get_anchor()[i];
+      const double ahigh = alow + a.get_sides()[i];
+      const double blow = b.get_anchor()[i];
+      const double bhigh = blow + b.get_sides()[i];
+      dx[i] = std::max(0., std::max(alow - bhigh, blow - ahigh));
+      if (_is_periodic) {
+        const double side = _box.get_sides()[i];
+        dx[i] = std::min(dx[i], std::max(0., alow + side - bhigh));
+        dx[i] = std::min(dx[i], std::max(0., blow + side - ahigh));
+      }
+    }
+    return dx.norm();
+  }
 
 public:
   /**
@@ -61,29 +198,254 @@ public:
    * @param positions Reference to the underlying positions.
    * @param box Box containing the tree structure.
    * @param periodic Periodicity flag.
+   * @param leaf_size Maximum number of positions in a leaf.
    */
   inline Octree(std::vector< CoordinateVector<> > &positions, Box<> box,
-                bool periodic = false)
-      : _positions(positions), _box(box), _is_periodic(periodic) {
+                bool periodic = false,
+                uint_fast32_t leaf_size = OCTREE_DEFAULT_LEAF_SIZE)
+      : _positions(positions), _box(box), _is_periodic(periodic),
+        _leaf_size(leaf_size), _leaf_volume(0.) {
+
+    if (_leaf_size == 0) {
+      cmac_error("Leaf size should be at least 1!");
+    }
+
+    const size_t number_of_positions = _positions.size();
+    if (number_of_positions == 0) {
+      return;
+    }
+
+    // sort the positions on their Morton key
+    const MortonKeyGenerator key_generator(_box);
+    std::vector< std::pair< morton_key_t, size_t > > keys(number_of_positions);
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+    for (size_t i = 0; i < number_of_positions; ++i) {
+      keys[i] = std::make_pair(key_generator.get_key(_positions[i]), i);
+    }
+    MortonKeyGenerator::parallel_sort(keys);
+
+    std::vector< morton_key_t > sorted_keys(number_of_positions);
+    _order.resize(number_of_positions);
+    _sorted_positions.resize(number_of_positions);
+    _variables.resize(number_of_positions, 0.);
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+    for (size_t i = 0; i < number_of_positions; ++i) {
+      sorted_keys[i] = keys[i].first;
+      _order[i] = keys[i].second;
+      _sorted_positions[i] = _positions[_order[i]];
+    }
+
+    // build the tree level by level (breadth-first), splitting every level in
+    // parallel
+    std::vector< Node > bfs_nodes(1);
+    std::vector< uint_fast32_t > first_child(1, 0);
+    std::vector< uint_fast8_t > number_of_children(1, 0);
+    std::vector< size_t > level_offsets(1, 0);
+    level_offsets.push_back(1);
+    bfs_nodes[0]._box = _box;
+    bfs_nodes[0]._first_position = 0;
+    bfs_nodes[0]._last_position = number_of_positions;
+    // Morton keys have 21 levels below the root
+    for (uint_fast8_t level = 0; level < 22; ++level) {
+      const size_t level_begin = level_offsets[level];
+      const size_t level_size = level_offsets[level + 1] - level_begin;
+      if (level_size == 0) {
+        break;
+      }
 
-    // create the root of the tree
-    _root = new OctreeNode(0);
+      // find the position ranges of the children of all nodes on this level
+      std::vector< uint_fast32_t > splits(9 * level_size);
+      std::vector< size_t > child_offsets(level_size + 1, 0);
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+      for (size_t inode = 0; inode < level_size; ++inode) {
+        const Node &node = bfs_nodes[level_begin + inode];
+        if (level < 21 &&
+            node._last_position - node._first_position > _leaf_size) {
+          const uint_fast8_t shift = 3 * (20 - level);
+          const morton_key_t prefix = sorted_keys[node._first_position] &
+                                      ~((morton_key_t(8) << shift) - 1);
+          for (uint_fast8_t ichild = 0; ichild < 8; ++ichild) {
+            splits[9 * inode + ichild] =
+                std::lower_bound(sorted_keys.begin() + node._first_position,
+                                 sorted_keys.begin() + node._last_position,
+                                 prefix | (morton_key_t(ichild) << shift)) -
+                sorted_keys.begin();
+          }
+          splits[9 * inode + 8] = node._last_position;
+          for (uint_fast8_t ichild = 0; ichild < 8; ++ichild) {
+            if (splits[9 * inode + ichild + 1] > splits[9 * inode + ichild]) {
+              ++child_offsets[inode + 1];
+            }
+          }
+        }
+      }
+      for (size_t inode = 0; inode < level_size; ++inode) {
+        child_offsets[inode + 1] += child_offsets[inode];
+      }
 
-    const size_t possize = _positions.size();
-    for (size_t i = 1; i < possize; ++i) {
-      Box<> box(_box);
-      _root->add_position(_positions, i, box);
+      // create the children
+      const size_t level_end = level_begin + level_size;
+      const size_t new_size = level_end + child_offsets[level_size];
+      bfs_nodes.resize(new_size);
+      first_child.resize(new_size, 0);
+      number_of_children.resize(new_size, 0);
+      level_offsets.push_back(new_size);
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+      for (size_t inode = 0; inode < level_size; ++inode) {
+        const Node &node = bfs_nodes[level_begin + inode];
+        first_child[level_begin + inode] = level_end + child_offsets[inode];
+        number_of_children[level_begin + inode] =
+            child_offsets[inode + 1] - child_offsets[inode];
+        size_t ichild_node = level_end + child_offsets[inode];
+        for (uint_fast8_t ichild = 0;
+             ichild < 8 && number_of_children[level_begin + inode] > 0;
+             ++ichild) {
+          if (splits[9 * inode + ichild + 1] > splits[9 * inode + ichild]) {
+            Node &child = bfs_nodes[ichild_node];
+            child._first_position = splits[9 * inode + ichild];
+            child._last_position = splits[9 * inode + ichild + 1];
+            CoordinateVector<> anchor = node._box.get_anchor();
+            const CoordinateVector<> sides = 0.5 * node._box.get_sides();
+            anchor[0] += (ichild & 4) ? sides.x() : 0.;
+            anchor[1] += (ichild & 2) ? sides.y() : 0.;
+            anchor[2] += (ichild & 1) ? sides.z() : 0.;
+            child._box = Box<>(anchor, sides);
+            ++ichild_node;
+          }
+        }
+      }
+    }
+    const size_t number_of_levels = level_offsets.size() - 1;
+
+    // compute the size of every subtree, bottom-up
+    std::vector< uint_fast32_t > subtree_size(bfs_nodes.size(), 1);
+    for (size_t level = number_of_levels; level > 0; --level) {
+      const size_t level_begin = level_offsets[level - 1];
+      const size_t level_end = level_offsets[level];
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+      for (size_t inode = level_begin; inode < level_end; ++inode) {
+        for (uint_fast8_t ichild = 0; ichild < number_of_children[inode];
+             ++ichild) {
+          subtree_size[inode] += subtree_size[first_child[inode] + ichild];
+        }
+      }
+    }
+
+    // now compute the depth-first index of every node, top-down, and store
+    // the nodes in depth-first order
+    std::vector< uint_fast32_t > dfs_index(bfs_nodes.size(), 0);
+    _nodes.resize(bfs_nodes.size());
+    for (size_t level = 0; level < number_of_levels; ++level) {
+      const size_t level_begin = level_offsets[level];
+      const size_t level_end = level_offsets[level + 1];
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+      for (size_t inode = level_begin; inode < level_end; ++inode) {
+        uint_fast32_t next_index = dfs_index[inode] + 1;
+        for (uint_fast8_t ichild = 0; ichild < number_of_children[inode];
+             ++ichild) {
+          dfs_index[first_child[inode] + ichild] = next_index;
+          next_index += subtree_size[first_child[inode] + ichild];
+        }
+        Node &node = _nodes[dfs_index[inode]];
+        node = bfs_nodes[inode];
+        node._variable = 0.;
+        node._skip = dfs_index[inode] + subtree_size[inode];
+      }
+    }
+
+    for (size_t inode = 0; inode < _nodes.size(); ++inode) {
+      if (is_leaf(inode)) {
+        _leaf_volume += _nodes[inode]._box.get_volume();
+      }
     }
-    _root->collapse();
   }
 
   /**
-   * @brief Destructor.
+   * @brief Update the tree after the underlying positions have changed,
+   * without changing the tree structure.
+   *
+   * The sorted copy of the positions is updated, and the box of every node is
+   * replaced by the bounding box of the positions it contains (for a leaf) or
+   * of its children (for other nodes). Neighbour searches remain correct,
+   * but become less efficient if positions moved far from their original
+   * node. The auxiliary variables are not updated; set_auxiliaries() needs to
+   * be called if they changed as well.
+   *
+   * The number of positions cannot change.
    *
-   * Deletes the root node of the tree. The root node is responsible for the
-   * recursive destruction of its child nodes.
+   * @return Total volume of the leaves after the refit, divided by the total
+   * volume of the leaves when the tree was built. If this value becomes
+   * larger than 1, the tree should be rebuilt.
    */
-  inline ~Octree() { delete _root; }
+  inline double refit() {
+
+    const size_t number_of_positions = _order.size();
+    if (_positions.size() != number_of_positions) {
+      cmac_error("Cannot refit a tree if the number of positions changed!");
+    }
+    if (number_of_positions == 0) {
+      return 0.;
+    }
+
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+    for (size_t i = 0; i < number_of_positions; ++i) {
+      _sorted_positions[i] = _positions[_order[i]];
+    }
+
+    // same order as in set_auxiliaries(): leaves first, then the other nodes
+    // in reverse depth-first order
+    const size_t number_of_nodes = _nodes.size();
+    double leaf_volume = 0.;
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared) reduction(+ : leaf_volume)
+#endif
+    for (size_t inode = 0; inode < number_of_nodes; ++inode) {
+      if (is_leaf(inode)) {
+        Node &node = _nodes[inode];
+        CoordinateVector<> minpos = _sorted_positions[node._first_position];
+        CoordinateVector<> maxpos = minpos;
+        for (uint_fast32_t i = node._first_position + 1;
+             i < node._last_position; ++i) {
+          minpos = CoordinateVector<>::min(minpos, _sorted_positions[i]);
+          maxpos = CoordinateVector<>::max(maxpos, _sorted_positions[i]);
+        }
+        node._box = Box<>(minpos, maxpos - minpos);
+        leaf_volume += node._box.get_volume();
+      }
+    }
+    for (size_t inode = number_of_nodes; inode > 0; --inode) {
+      if (!is_leaf(inode - 1)) {
+        Node &node = _nodes[inode - 1];
+        uint_fast32_t ichild = inode;
+        CoordinateVector<> minpos = _nodes[ichild]._box.get_anchor();
+        CoordinateVector<> maxpos = _nodes[ichild]._box.get_top_anchor();
+        ichild = _nodes[ichild]._skip;
+        while (ichild < node._skip) {
+          const Box<> &child_box = _nodes[ichild]._box;
+          minpos = CoordinateVector<>::min(minpos, child_box.get_anchor());
+          maxpos = CoordinateVector<>::max(maxpos, child_box.get_top_anchor());
+          ichild = _nodes[ichild]._skip;
+        }
+        node._box = Box<>(minpos, maxpos - minpos);
+      }
+    }
+
+    return leaf_volume / _leaf_volume;
+  }
 
   /**
    * @brief Custom version of std::max that can be used as a template operation.
@@ -106,12 +468,172 @@ public:
    * nodes using the given operation.
    *
    * @param v std::vector containing the values of the auxiliary variables (for
-   * each leaf, there is exactly one corresponding variable).
+   * each position, there is exactly one corresponding variable).
    * @param op Operation used to accumulate variables within nodes.
    */
   template < typename _operation_ >
   inline void set_auxiliaries(std::vector< double > &v, _operation_ op) {
-    _root->set_variable(v, op);
+
+    cmac_assert(v.size() == _order.size());
+
+    const size_t number_of_positions = _order.size();
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+    for (size_t i = 0; i < number_of_positions; ++i) {
+      _variables[i] = v[_order[i]];
+    }
+
+    // leaves first (in parallel), then the other nodes in reverse depth-first
+    // order, so that all children are done before their parent
+    const size_t number_of_nodes = _nodes.size();
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+    for (size_t inode = 0; inode < number_of_nodes; ++inode) {
+      if (is_leaf(inode)) {
+        Node &node = _nodes[inode];
+        node._variable = _variables[node._first_position];
+        for (uint_fast32_t i = node._first_position + 1;
+             i < node._last_position; ++i) {
+          node._variable = op(node._variable, _variables[i]);
+        }
+      }
+    }
+    for (size_t inode = number_of_nodes; inode > 0; --inode) {
+      if (!is_leaf(inode - 1)) {
+        Node &node = _nodes[inode - 1];
+        uint_fast32_t ichild = inode;
+        node._variable = _nodes[ichild]._variable;
+        ichild = _nodes[ichild]._skip;
+        while (ichild < node._skip) {
+          node._variable = op(node._variable, _nodes[ichild]._variable);
+          ichild = _nodes[ichild]._skip;
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Call the given function for all neighbours of the sphere with the
+   * given centre and radius.
+   *
+   * A neighbour is a position in the internal list for which the input sphere
+   * overlaps with the sphere with the list position as centre and the
+   * corresponding auxiliary variable as radius.
+   *
+   * This version does not allocate any memory and should be preferred in
+   * performance critical loops.
+   *
+   * @param centre The centre of the sphere for which we search neighbours.
+   * @param radius The radius of the sphere for which we search neighbours.
+   * @param function Function that is called with the index of every
+   * neighbour.
+   */
+  template < typename _function_ >
+  inline void for_each_ngb_sphere(const CoordinateVector<> centre,
+                                  const double radius,
+                                  _function_ function) const {
+
+    const uint_fast32_t number_of_nodes = _nodes.size();
+    uint_fast32_t inode = 0;
+    while (inode < number_of_nodes) {
+      const Node &node = _nodes[inode];
+      if (get_distance(node._box, centre) > node._variable + radius) {
+        inode = node._skip;
+      } else if (is_leaf(inode)) {
+        for (uint_fast32_t i = node._first_position; i < node._last_position;
+             ++i) {
+          const double r2 = get_distance2(_sorted_positions[i], centre);
+          const double rmax = _variables[i] + radius;
+          if (r2 <= rmax * rmax) {
+            function(_order[i]);
+          }
+        }
+        inode = node._skip;
+      } else {
+        ++inode;
+      }
+    }
+  }
+
+  /**
+   * @brief Call the given function for all neighbours of the given position.
+   *
+   * A neighbour is a position in the internal list for which the given position
+   * lies inside the sphere with the list position as centre and the
+   * corresponding auxiliary variable as radius.
+   *
+   * This version does not allocate any memory and should be preferred in
+   * performance critical loops.
+   *
+   * @param centre Position for which we search neighbours.
+   * @param function Function that is called with the index of every
+   * neighbour.
+   */
+  template < typename _function_ >
+  inline void for_each_ngb(const CoordinateVector<> centre,
+                           _function_ function) const {
+    for_each_ngb_sphere(centre, 0., function);
+  }
+
+  /**
+   * @brief Call the given function for all neighbours of all positions in the
+   * given block of positions.
+   *
+   * The tree is walked only once, using the bounding box of all positions in
+   * the block. The individual positions are only tested at the level of the
+   * leaves. This is efficient for blocks of positions that are close together,
+   * like the cells of a subgrid.
+   *
+   * @param centres Positions for which we search neighbours.
+   * @param function Function that is called with the index of the position in
+   * the block and the index of the neighbour, for every neighbour of every
+   * position.
+   */
+  template < typename _function_ >
+  inline void
+  for_each_ngb_block(const std::vector< CoordinateVector<> > &centres,
+                     _function_ function) const {
+
+    if (centres.size() == 0) {
+      return;
+    }
+
+    CoordinateVector<> minpos = centres[0];
+    CoordinateVector<> maxpos = centres[0];
+    for (size_t j = 1; j < centres.size(); ++j) {
+      for (uint_fast8_t i = 0; i < 3; ++i) {
+        minpos[i] = std::min(minpos[i], centres[j][i]);
+        maxpos[i] = std::max(maxpos[i], centres[j][i]);
+      }
+    }
+    const Box<> block(minpos, maxpos - minpos);
+
+    const uint_fast32_t number_of_nodes = _nodes.size();
+    uint_fast32_t inode = 0;
+    while (inode < number_of_nodes) {
+      const Node &node = _nodes[inode];
+      if (get_distance(node._box, block) > node._variable) {
+        inode = node._skip;
+      } else if (is_leaf(inode)) {
+        for (uint_fast32_t i = node._first_position; i < node._last_position;
+             ++i) {
+          const CoordinateVector<> &position = _sorted_positions[i];
+          const double h = _variables[i];
+          if (get_distance(block, position) <= h) {
+            for (size_t j = 0; j < centres.size(); ++j) {
+              if (get_distance2(position, centres[j]) <= h * h) {
+                function(j, _order[i]);
+              }
+            }
+          }
+        }
+        inode = node._skip;
+      } else {
+        ++inode;
+      }
+    }
   }
 
   /**
@@ -122,42 +644,28 @@ public:
    * corresponding smoothing length in the given list as radius.
    *
    * @param centre Position for which we search neighbours.
+   * @param ngbs std::vector to store the indices of the positions in the
+   * internal list that are neighbours of the given centre in (is cleared
+   * first).
+   */
+  inline void get_ngbs(const CoordinateVector<> centre,
+                       std::vector< uint_fast32_t > &ngbs) const {
+    ngbs.clear();
+    for_each_ngb(centre,
+                 [&ngbs](const uint_fast32_t index) { ngbs.push_back(index); });
+  }
+
+  /**
+   * @brief Get the indices of the neighbours of the given position.
+   *
+   * @param centre Position for which we search neighbours.
    * @return Indicies of the positions in the internal list that are neighbours
    * of the given centre.
    */
   inline std::vector< uint_fast32_t >
   get_ngbs(CoordinateVector<> centre) const {
-
     std::vector< uint_fast32_t > ngbs;
-    OctreeNode *next = _root->get_child();
-    while (next != nullptr) {
-      if (next->is_leaf()) {
-        double r;
-        if (_is_periodic) {
-          r = _box.periodic_distance(_positions[next->get_index()], centre)
-                  .norm();
-        } else {
-          r = (_positions[next->get_index()] - centre).norm();
-        }
-        if (r <= next->get_variable()) {
-          ngbs.push_back(next->get_index());
-        }
-        next = next->get_sibling();
-      } else {
-        // check opening criterion
-        double r;
-        if (_is_periodic) {
-          r = _box.periodic_distance(next->get_box(), centre);
-        } else {
-          r = next->get_box().get_distance(centre);
-        }
-        if (r > next->get_variable()) {
-          next = next->get_sibling();
-        } else {
-          next = next->get_child();
-        }
-      }
-    }
+    get_ngbs(centre, ngbs);
     return ngbs;
   }
 
@@ -171,45 +679,58 @@ public:
    *
    * @param centre The center of the sphere for which we search neighbours.
    * @param radius The radius of the sphere for which we search neighbours.
+   * @param ngbs std::vector to store the indices of the positions in the
+   * internal list that are neighbours of the given sphere in (is cleared
+   * first).
+   */
+  inline void get_ngbs_sphere(const CoordinateVector<> centre,
+                              const double radius,
+                              std::vector< uint_fast32_t > &ngbs) const {
+    ngbs.clear();
+    for_each_ngb_sphere(centre, radius, [&ngbs](const uint_fast32_t index) {
+      ngbs.push_back(index);
+    });
+  }
+
+  /**
+   * @brief Get the indices of the neighbours of the sphere of given position
+   * and radius.
+   *
+   * @param centre The center of the sphere for which we search neighbours.
+   * @param radius The radius of the sphere for which we search neighbours.
    * @return Indicies of the positions in the internal list that are neighbours
    * of the given center.
    */
   inline std::vector< uint_fast32_t > get_ngbs_sphere(CoordinateVector<> centre,
                                                       double radius) const {
-
     std::vector< uint_fast32_t > ngbs;
-    OctreeNode *next = _root->get_child();
-    while (next != nullptr) {
-      if (next->is_leaf()) {
-        double r;
-        if (_is_periodic) {
-          r = _box.periodic_distance(_positions[next->get_index()], centre)
-                  .norm();
-        } else {
-          r = (_positions[next->get_index()] - centre).norm();
-        }
-        if (r <= next->get_variable() + radius) {
-          ngbs.push_back(next->get_index());
-        }
-        next = next->get_sibling();
-      } else {
-        // check opening criterion
-        double r;
-        if (_is_periodic) {
-          r = _box.periodic_distance(next->get_box(), centre);
-        } else {
-          r = next->get_box().get_distance(centre);
-        }
-        if (r > next->get_variable() + radius) {
-          next = next->get_sibling();
-        } else {
-          next = next->get_child();
-        }
-      }
-    }
+    get_ngbs_sphere(centre, radius, ngbs);
     return ngbs;
   }
 
+  /**
+   * @brief Get the indices of the neighbours of all positions in the given
+   * block of positions.
+   *
+   * @param centres Positions for which we search neighbours.
+   * @param ngbs std::vector to store the neighbour indices for every position
+   * in the block in (is resized to the size of the block, every element is
+   * cleared first).
+   */
+  inline void
+  get_ngbs_block(const std::vector< CoordinateVector<> > &centres,
+                 std::vector< std::vector< uint_fast32_t > > &ngbs) const {
+
+    ngbs.resize(centres.size());
+    for (size_t j = 0; j < centres.size(); ++j) {
+      ngbs[j].clear();
+    }
+    for_each_ngb_block(centres,
+                       [&ngbs](const size_t j, const uint_fast32_t index) {
+                         ngbs[j].push_back(index);
+                       });
+  }
+
   /**
    * @brief Get the indices of the neighbours of the given list of positions.
    *
@@ -226,45 +747,31 @@ public:
 
     std::vector< uint_fast32_t > ngbs;
     const size_t clist_size = centre_list.size();
-    OctreeNode *next = _root->get_child();
-    while (next != nullptr) {
-      if (next->is_leaf()) {
-        for (size_t i = 0; i < clist_size; ++i) {
-          const CoordinateVector<> centre = centre_list[i];
-          double r;
-          if (_is_periodic) {
-            r = _box.periodic_distance(_positions[next->get_index()], centre)
-                    .norm();
-          } else {
-            r = (_positions[next->get_index()] - centre).norm();
-          }
-          if (r <= next->get_variable()) {
-            ngbs.push_back(next->get_index());
-            break;
+    const uint_fast32_t number_of_nodes = _nodes.size();
+    uint_fast32_t inode = 0;
+    while (inode < number_of_nodes) {
+      const Node &node = _nodes[inode];
+      // check opening criterion
+      bool open = false;
+      for (size_t j = 0; j < clist_size && !open; ++j) {
+        open = (get_distance(node._box, centre_list[j]) <= node._variable);
+      }
+      if (!open) {
+        inode = node._skip;
+      } else if (is_leaf(inode)) {
+        for (uint_fast32_t i = node._first_position; i < node._last_position;
+             ++i) {
+          const double h2 = _variables[i] * _variables[i];
+          for (size_t j = 0; j < clist_size; ++j) {
+            if (get_distance2(_sorted_positions[i], centre_list[j]) <= h2) {
+              ngbs.push_back(_order[i]);
+              break;
+            }
           }
         }
-        next = next->get_sibling();
+        inode = node._skip;
       } else {
-        // check opening criterion
-        uint_fast32_t centre_num = 0;
-        for (size_t i = 0; i < clist_size; ++i) {
-          const CoordinateVector<> centre = centre_list[i];
-          double r;
-          if (_is_periodic) {
-            r = _box.periodic_distance(next->get_box(), centre);
-          } else {
-            r = next->get_box().get_distance(centre);
-          }
-          if (r > next->get_variable()) {
-            centre_num++;
-          } else {
-            next = next->get_child();
-            break;
-          }
-        }
-        if (centre_num == clist_size) {
-          next = next->get_sibling();
-        }
+        ++inode;
       }
     }
     return ngbs;
@@ -276,51 +783,82 @@ public:
    * @param centre Position that is at the centre of the search radius.
    * @return Index of the closest neighbour to that position.
    */
-  inline uint_fast32_t get_closest_ngb(const CoordinateVector<> centre) {
+  inline uint_fast32_t get_closest_ngb(const CoordinateVector<> centre) const {
 
-    double rmin = DBL_MAX;
+    double r2min = DBL_MAX;
     uint_fast32_t imin = 0;
-    OctreeNode *next = _root->get_child();
-    while (next != nullptr) {
-      if (next->is_leaf()) {
-        double r;
-        if (_is_periodic) {
-          r = _box.periodic_distance(_positions[next->get_index()], centre)
-                  .norm();
-        } else {
-          r = (_positions[next->get_index()] - centre).norm();
-        }
-        if (r <= rmin) {
-          rmin = r;
-          imin = next->get_index();
+    const uint_fast32_t number_of_nodes = _nodes.size();
+    uint_fast32_t inode = 0;
+    while (inode < number_of_nodes) {
+      const Node &node = _nodes[inode];
+      const double r = get_distance(node._box, centre);
+      if (r * r > r2min) {
+        inode = node._skip;
+      } else if (is_leaf(inode)) {
+        for (uint_fast32_t i = node._first_position; i < node._last_position;
+             ++i) {
+          const double r2 = get_distance2(_sorted_positions[i], centre);
+          if (r2 <= r2min) {
+            r2min = r2;
+            imin = _order[i];
+          }
         }
-        next = next->get_sibling();
+        inode = node._skip;
       } else {
-        // check opening criterion
-        double r;
-        if (_is_periodic) {
-          r = _box.periodic_distance(next->get_box(), centre);
-        } else {
-          r = next->get_box().get_distance(centre);
-        }
-        if (r > rmin) {
-          next = next->get_sibling();
-        } else {
-          next = next->get_child();
-        }
+        ++inode;
       }
     }
 
     return imin;
   }
 
+  /**
+   * @brief Get the number of nodes in the tree.
+   *
+   * @return Number of nodes.
+   */
+  inline size_t get_number_of_nodes() const { return _nodes.size(); }
+
   /**
    * @brief Print the Octree for visual inspection.
    *
+   * For every leaf, we print the positions it contains, and for every node
+   * the edges of its box, in a format that can be plotted using gnuplot.
+   *
    * @param stream std::ostream to write to.
    */
   inline void print(std::ostream &stream) const {
-    _root->print(stream, _positions);
+
+    for (size_t inode = 0; inode < _nodes.size(); ++inode) {
+      const Node &node = _nodes[inode];
+      if (is_leaf(inode)) {
+        for (uint_fast32_t i = node._first_position; i < node._last_position;
+             ++i) {
+          stream << _sorted_positions[i].x() << "\t"
+                 << _sorted_positions[i].y() << "\t"
+                 << _sorted_positions[i].z() << "\n\n";
+        }
+      }
+      const CoordinateVector<> &a = node._box.get_anchor();
+      const CoordinateVector<> &s = node._box.get_sides();
+      // the 12 edges of the box: every edge connects a corner with its
+      // neighbouring corner along one of the axes
+      for (uint_fast8_t icorner = 0; icorner < 8; ++icorner) {
+        const CoordinateVector<> corner(a.x() + ((icorner & 4) ? s.x() : 0.),
+                                        a.y() + ((icorner & 2) ? s.y() : 0.),
+                                        a.z() + ((icorner & 1) ? s.z() : 0.));
+        for (uint_fast8_t i = 0; i < 3; ++i) {
+          if ((icorner & (4 >> i)) == 0) {
+            CoordinateVector<> other(corner);
+            other[i] += s[i];
+            stream << corner.x() << "\t" << corner.y() << "\t" << corner.z()
+                   << "\n";
+            stream << other.x() << "\t" << other.y() << "\t" << other.z()
+                   << "\n\n";
+          }
+        }
+      }
+    }
   }
 };
 
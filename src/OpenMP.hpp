@@ -46,6 +46,21 @@
  * @return Index of the calling thread.
  */
 #define get_thread_index() omp_get_thread_num()
+
+/**
+ * @brief Get the maximum number of threads that can execute a parallel region.
+ *
+ * @return Maximum number of threads.
+ */
+#define get_max_number_of_threads() omp_get_max_threads()
+
+/**
+ * @brief Get the number of threads in the parallel region that is executing
+ * this piece of code.
+ *
+ * @return Number of threads in the current team.
+ */
+#define get_number_of_active_threads() omp_get_num_threads()
 #else
 
 /**
@@ -61,6 +76,21 @@
  * @return Index of the calling thread.
  */
 #define get_thread_index() 0
+
+/**
+ * @brief Get the maximum number of threads that can execute a parallel region.
+ *
+ * @return Maximum number of threads.
+ */
+#define get_max_number_of_threads() 1
+
+/**
+ * @brief Get the number of threads in the parallel region that is executing
+ * this piece of code.
+ *
+ * @return Number of threads in the current team.
+ */
+#define get_number_of_active_threads() 1
 #endif
 
 #endif // OPENMP_HPP
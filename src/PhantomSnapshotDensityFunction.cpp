@@ -28,6 +28,7 @@
 #include "Log.hpp"
 #include "Octree.hpp"
 #include "ParameterFile.hpp"
+#include "SPHScatterMapping.hpp"
 #include "UnitConverter.hpp"
 
 #include <cfloat>
@@ -434,15 +435,21 @@ double PhantomSnapshotDensityFunction::mass_contribution(
  * file?
  * @param binary_dump_name Name of the file in which the particle positions and
  * densities are dumped.
+ * @param use_scatter_mapping Deposit the particles onto the grid using an
+ * SPHScatterMapping instead of evaluating the density in every cell using an
+ * Octree neighbour search?
  * @param log Log to write logging info to.
  */
 PhantomSnapshotDensityFunction::PhantomSnapshotDensityFunction(
     std::string filename, double initial_temperature,
     const bool use_new_algorithm, const bool use_periodic_box,
-    const bool binary_dump, const std::string binary_dump_name, Log *log)
-    : _octree(nullptr), _initial_temperature(initial_temperature),
+    const bool binary_dump, const std::string binary_dump_name,
+    const bool use_scatter_mapping, Log *log)
+    : _octree(nullptr), _scatter_mapping(nullptr),
+      _initial_temperature(initial_temperature),
       _use_new_algorithm(use_new_algorithm),
-      _use_periodic_box(use_periodic_box), _log(log) {
+      _use_periodic_box(use_periodic_box),
+      _use_scatter_mapping(use_scatter_mapping), _log(log) {
 
   if (binary_dump && binary_dump_name == "") {
     cmac_error("No valid name provided for binary dump file!");
@@ -657,6 +664,9 @@ PhantomSnapshotDensityFunction::PhantomSnapshotDensityFunction(
  *    densities (default: false)?
  *  - binary dump name: Name of the file in which to dump the particle positions
  *    and densities.
+ *  - use scatter mapping: Deposit the particles onto the grid instead of
+ *    gathering them for every cell (only works for subgrid based grids;
+ *    default: false)?
  *
  * @param params ParameterFile to read from.
  * @param log Log to write logging info to.
@@ -672,23 +682,35 @@ PhantomSnapshotDensityFunction::PhantomSnapshotDensityFunction(
           params.get_value< bool >("DensityFunction:binary dump", false),
           params.get_value< std::string >("DensityFunction:binary dump name",
                                           ""),
+          params.get_value< bool >("DensityFunction:use scatter mapping",
+                                   false),
           log) {}
 
 /**
  * @brief Destructor.
  *
- * Clean up the octree.
+ * Clean up the octree and scatter mapping.
  */
 PhantomSnapshotDensityFunction::~PhantomSnapshotDensityFunction() {
   delete _octree;
+  delete _scatter_mapping;
 }
 
 /**
  * @brief This routine constructs the internal Octree that is used for neighbour
  * finding.
+ *
+ * If the scatter mapping is used, no Octree is needed and we create the
+ * SPHScatterMapping instead.
  */
 void PhantomSnapshotDensityFunction::initialize() {
 
+  if (_use_scatter_mapping) {
+    _scatter_mapping = new SPHScatterMapping(_positions, _masses,
+                                             _smoothing_lengths, 1.);
+    return;
+  }
+
   _octree = new Octree(_positions, _partbox, _use_periodic_box);
   std::vector< double > h2s = _smoothing_lengths;
   for (uint_fast32_t i = 0; i < _smoothing_lengths.size(); ++i) {
@@ -742,13 +764,25 @@ double PhantomSnapshotDensityFunction::get_smoothing_length(
 /**
  * @brief Function that gives the density for a given cell.
  *
+ * If the scatter mapping is used, this function only returns background
+ * values; the actual densities are set by SPHScatterMapping::deposit().
+ *
  * @param cell Geometrical information about the cell.
  * @return Initial physical field values for that cell.
  */
 DensityValues PhantomSnapshotDensityFunction::operator()(const Cell &cell) {
 
   DensityValues values;
-  if (_use_new_algorithm) {
+  if (_use_scatter_mapping) {
+
+    values.set_number_density(0.);
+    values.set_temperature(_initial_temperature);
+    values.set_ionic_fraction(ION_H_n, 1.e-6);
+#ifdef HAS_HELIUM
+    values.set_ionic_fraction(ION_He_n, 1.e-6);
+#endif
+
+  } else if (_use_new_algorithm) {
 
     CoordinateVector<> position = cell.get_cell_midpoint();
 
@@ -767,20 +801,16 @@ DensityValues PhantomSnapshotDensityFunction::operator()(const Cell &cell) {
     // Find the neighbours that are contained inside of a sphere of centre the
     // cell midpoint
     // and radius given by the distance to the furthest vertex.
-    std::vector< uint_fast32_t > ngbs =
-        _octree->get_ngbs_sphere(position, radius);
-    const size_t numngbs = ngbs.size();
-
     double density = 0.;
 
     // Loop over all the neighbouring particles and calculate their mass
     // contributions.
-    for (size_t i = 0; i < numngbs; i++) {
-      const uint_fast32_t index = ngbs[i];
-      const double h = _smoothing_lengths[index];
-      const CoordinateVector<> particle = _positions[index];
-      density += mass_contribution(cell, particle, h) * _masses[index];
-    }
+    _octree->for_each_ngb_sphere(
+        position, radius, [&](const uint_fast32_t index) {
+          const double h = _smoothing_lengths[index];
+          const CoordinateVector<> particle = _positions[index];
+          density += mass_contribution(cell, particle, h) * _masses[index];
+        });
 
     // Divide the cell mass by the cell volume to get density.
     density = density / cell.get_volume();
@@ -800,10 +830,7 @@ DensityValues PhantomSnapshotDensityFunction::operator()(const Cell &cell) {
     const CoordinateVector<> position = cell.get_cell_midpoint();
 
     double density = 0.;
-    std::vector< uint_fast32_t > ngbs = _octree->get_ngbs(position);
-    const size_t numngbs = ngbs.size();
-    for (size_t i = 0; i < numngbs; ++i) {
-      const uint_fast32_t index = ngbs[i];
+    _octree->for_each_ngb(position, [&](const uint_fast32_t index) {
       double r;
       if (_use_periodic_box) {
         r = _partbox.periodic_distance(position, _positions[index]).norm();
@@ -815,7 +842,7 @@ DensityValues PhantomSnapshotDensityFunction::operator()(const Cell &cell) {
       const double m = _masses[index];
       const double splineval = m * kernel(q, h);
       density += splineval;
-    }
+    });
 
     // convert density to particle density (assuming hydrogen only)
     values.set_number_density(density / 1.6737236e-27);
@@ -830,3 +857,14 @@ DensityValues PhantomSnapshotDensityFunction::operator()(const Cell &cell) {
 
   return values;
 }
+
+/**
+ * @brief Get the scatter mapping that should be used to set the densities.
+ *
+ * @return Pointer to the SPHScatterMapping, or a null pointer if the gather
+ * mapping is used.
+ */
+const SPHScatterMapping *
+PhantomSnapshotDensityFunction::get_scatter_mapping() const {
+  return _scatter_mapping;
+}
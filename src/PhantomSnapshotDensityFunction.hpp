@@ -39,6 +39,7 @@
 class Log;
 class Octree;
 class ParameterFile;
+class SPHScatterMapping;
 
 /**
  * @brief DensityFunction implementation that reads a density field from an
@@ -61,6 +62,10 @@ private:
   /*! @brief Octree used to speed up neighbour finding. */
   Octree *_octree;
 
+  /*! @brief Scatter mapping used instead of the Octree based mapping (if
+   *  enabled). */
+  SPHScatterMapping *_scatter_mapping;
+
   /*! @brief Initial temperature of the gas (in K). */
   double _initial_temperature;
 
@@ -70,6 +75,9 @@ private:
   /*! @brief Use a periodic box for the density mapping? */
   const bool _use_periodic_box;
 
+  /*! @brief Deposit the particles onto the grid using an SPHScatterMapping? */
+  const bool _use_scatter_mapping;
+
   /*! @brief Log to write logging info to. */
   Log *_log;
 
@@ -238,6 +246,7 @@ public:
                                  const bool use_periodic_box,
                                  const bool binary_dump = false,
                                  const std::string binary_dump_name = "",
+                                 const bool use_scatter_mapping = false,
                                  Log *log = nullptr);
 
   PhantomSnapshotDensityFunction(ParameterFile &params, Log *log = nullptr);
@@ -252,6 +261,8 @@ public:
   double get_smoothing_length(const uint_fast32_t index) const;
 
   virtual DensityValues operator()(const Cell &cell);
+
+  virtual const SPHScatterMapping *get_scatter_mapping() const;
 };
 
 /**
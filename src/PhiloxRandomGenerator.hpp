@@ -0,0 +1,264 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file PhiloxRandomGenerator.hpp
+ *
+ * @brief Philox4x32-10 counter-based random number generator.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#ifndef PHILOXRANDOMGENERATOR_HPP
+#define PHILOXRANDOMGENERATOR_HPP
+
+#include "RestartReader.hpp"
+#include "RestartWriter.hpp"
+
+#include <cstdint>
+
+/*! @brief Number of blocks that are generated simultaneously by
+ *  PhiloxRandomGenerator::fill_uniform(). */
+#define PHILOXRANDOMGENERATOR_CHUNK_SIZE 32
+
+/**
+ * @brief Philox4x32-10 counter-based random number generator (Salmon et al.,
+ * 2011, Proceedings of SC11).
+ *
+ * Every block of random numbers is a bijective function (10 rounds of
+ * multiplications and xors) of a 128-bit counter, parametrised by a 64-bit
+ * key. The key is set from the seed, so that every seed corresponds to an
+ * independent stream, while the counter simply counts the number of blocks
+ * that have been generated. Every block contains 128 random bits that are
+ * converted into two double precision values.
+ *
+ * Since blocks do not depend on each other, fill_uniform() generates many
+ * blocks at the same time in a loop that can be vectorized. fill_uniform() and
+ * get_uniform_random_double() produce exactly the same sequence.
+ */
+class PhiloxRandomGenerator {
+private:
+  /*! @brief Key (stream index). */
+  uint64_t _key;
+
+  /*! @brief Counter value for the next block. */
+  uint64_t _counter;
+
+  /*! @brief Random values in the current block. */
+  double _block[2];
+
+  /*! @brief Index of the next unused value in the current block. */
+  uint_fast32_t _index;
+
+  /**
+   * @brief Convert the given 32-bit integers to a double precision floating
+   * point value in the range [0., 1.[.
+   *
+   * @param high Integer providing the highest 32 bits.
+   * @param low Integer providing the lowest 32 bits.
+   * @return Double precision floating point value using the 53 highest bits
+   * of the combined 64-bit integer.
+   */
+  static inline double to_double(const uint32_t high, const uint32_t low) {
+    return (((static_cast< uint64_t >(high) << 32) | low) >> 11) *
+           (1. / 9007199254740992.);
+  }
+
+public:
+  /**
+   * @brief Philox4x32-10 bijection.
+   *
+   * @param counter Input counter; is replaced with the output block.
+   * @param key Key.
+   */
+  static inline void philox4x32_10(uint32_t counter[4], const uint64_t key) {
+
+    uint32_t c0 = counter[0];
+    uint32_t c1 = counter[1];
+    uint32_t c2 = counter[2];
+    uint32_t c3 = counter[3];
+    uint32_t k0 = static_cast< uint32_t >(key);
+    uint32_t k1 = static_cast< uint32_t >(key >> 32);
+    for (uint_fast32_t round = 0; round < 10; ++round) {
+      const uint64_t product0 = static_cast< uint64_t >(0xD2511F53u) * c0;
+      const uint64_t product1 = static_cast< uint64_t >(0xCD9E8D57u) * c2;
+      const uint32_t hi0 = static_cast< uint32_t >(product0 >> 32);
+      const uint32_t lo0 = static_cast< uint32_t >(product0);
+      const uint32_t hi1 = static_cast< uint32_t >(product1 >> 32);
+      const uint32_t lo1 = static_cast< uint32_t >(product1);
+      c0 = hi1 ^ c1 ^ k0;
+      c1 = lo1;
+      c2 = hi0 ^ c3 ^ k1;
+      c3 = lo0;
+      k0 += 0x9E3779B9u;
+      k1 += 0xBB67AE85u;
+    }
+    counter[0] = c0;
+    counter[1] = c1;
+    counter[2] = c2;
+    counter[3] = c3;
+  }
+
+  /**
+   * @brief Set a new seed for the random generator.
+   *
+   * @param seed New seed.
+   */
+  inline void set_seed(const int_fast32_t seed) {
+    _key = static_cast< uint64_t >(seed);
+    _counter = 0;
+    // force the generation of a new block on the next draw
+    _index = 2;
+  }
+
+  /**
+   * @brief Constructor.
+   *
+   * @param seed Initial seed for the random number generator.
+   */
+  inline PhiloxRandomGenerator(const int_fast32_t seed = 42) {
+    set_seed(seed);
+  }
+
+  /**
+   * @brief Get a uniform random double precision floating point value in the
+   * range [0., 1.[.
+   *
+   * Note that this function changes the internal state of the generator.
+   *
+   * @return Random double precision floating point value.
+   */
+  inline double get_uniform_random_double() {
+    if (_index == 2) {
+      uint32_t block[4] = {static_cast< uint32_t >(_counter),
+                           static_cast< uint32_t >(_counter >> 32), 0, 0};
+      philox4x32_10(block, _key);
+      _block[0] = to_double(block[0], block[1]);
+      _block[1] = to_double(block[2], block[3]);
+      ++_counter;
+      _index = 0;
+    }
+    const double value = _block[_index];
+    ++_index;
+    return value;
+  }
+
+  /**
+   * @brief Fill the given array with uniform random double precision floating
+   * point values in the range [0., 1.[.
+   *
+   * The result is the same as for successive calls to
+   * get_uniform_random_double().
+   *
+   * @param values Array to fill.
+   * @param number_of_values Number of values to generate.
+   */
+  inline void fill_uniform(double *values,
+                           const uint_fast32_t number_of_values) {
+
+    uint_fast32_t i = 0;
+    // use the remaining values in the current block
+    while (_index < 2 && i < number_of_values) {
+      values[i] = _block[_index];
+      ++_index;
+      ++i;
+    }
+
+    // generate full blocks directly into the output array, in chunks of
+    // PHILOXRANDOMGENERATOR_CHUNK_SIZE blocks that are processed together, so
+    // that the compiler can vectorize the rounds over the blocks in a chunk
+    while (i + 2 * PHILOXRANDOMGENERATOR_CHUNK_SIZE <= number_of_values) {
+      uint32_t c0[PHILOXRANDOMGENERATOR_CHUNK_SIZE];
+      uint32_t c1[PHILOXRANDOMGENERATOR_CHUNK_SIZE];
+      uint32_t c2[PHILOXRANDOMGENERATOR_CHUNK_SIZE];
+      uint32_t c3[PHILOXRANDOMGENERATOR_CHUNK_SIZE];
+      for (uint_fast32_t j = 0; j < PHILOXRANDOMGENERATOR_CHUNK_SIZE; ++j) {
+        const uint64_t counter = _counter + j;
+        c0[j] = static_cast< uint32_t >(counter);
+        c1[j] = static_cast< uint32_t >(counter >> 32);
+        c2[j] = 0;
+        c3[j] = 0;
+      }
+      uint32_t k0 = static_cast< uint32_t >(_key);
+      uint32_t k1 = static_cast< uint32_t >(_key >> 32);
+      for (uint_fast32_t round = 0; round < 10; ++round) {
+        for (uint_fast32_t j = 0; j < PHILOXRANDOMGENERATOR_CHUNK_SIZE; ++j) {
+          const uint64_t product0 =
+              static_cast< uint64_t >(0xD2511F53u) * c0[j];
+          const uint64_t product1 =
+              static_cast< uint64_t >(0xCD9E8D57u) * c2[j];
+          c0[j] = static_cast< uint32_t >(product1 >> 32) ^ c1[j] ^ k0;
+          c1[j] = static_cast< uint32_t >(product1);
+          c2[j] = static_cast< uint32_t >(product0 >> 32) ^ c3[j] ^ k1;
+          c3[j] = static_cast< uint32_t >(product0);
+        }
+        k0 += 0x9E3779B9u;
+        k1 += 0xBB67AE85u;
+      }
+      for (uint_fast32_t j = 0; j < PHILOXRANDOMGENERATOR_CHUNK_SIZE; ++j) {
+        values[i + 2 * j] = to_double(c0[j], c1[j]);
+        values[i + 2 * j + 1] = to_double(c2[j], c3[j]);
+      }
+      _counter += PHILOXRANDOMGENERATOR_CHUNK_SIZE;
+      i += 2 * PHILOXRANDOMGENERATOR_CHUNK_SIZE;
+    }
+
+    // remaining full blocks
+    while (i + 1 < number_of_values) {
+      uint32_t block[4] = {static_cast< uint32_t >(_counter),
+                           static_cast< uint32_t >(_counter >> 32), 0, 0};
+      philox4x32_10(block, _key);
+      values[i] = to_double(block[0], block[1]);
+      values[i + 1] = to_double(block[2], block[3]);
+      ++_counter;
+      i += 2;
+    }
+
+    // remaining value (this starts a new block)
+    if (i < number_of_values) {
+      values[i] = get_uniform_random_double();
+    }
+  }
+
+  /**
+   * @brief Write the random number generator to the given restart file.
+   *
+   * @param restart_writer RestartWriter to use.
+   */
+  inline void write_restart_file(RestartWriter &restart_writer) const {
+
+    restart_writer.write(_key);
+    restart_writer.write(_counter);
+    restart_writer.write(_block[0]);
+    restart_writer.write(_block[1]);
+    restart_writer.write(_index);
+  }
+
+  /**
+   * @brief Restart constructor.
+   *
+   * @param restart_reader Restart file to read from.
+   */
+  inline PhiloxRandomGenerator(RestartReader &restart_reader)
+      : _key(restart_reader.read< uint64_t >()),
+        _counter(restart_reader.read< uint64_t >()),
+        _block{restart_reader.read< double >(),
+               restart_reader.read< double >()},
+        _index(restart_reader.read< uint_fast32_t >()) {}
+};
+
+#endif // PHILOXRANDOMGENERATOR_HPP
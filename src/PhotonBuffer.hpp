@@ -35,6 +35,8 @@
 #include "ThreadLock.hpp"
 
 // standard library includes
+#include <algorithm>
+
 #ifdef HAVE_MPI
 #include <mpi.h>
 #endif
@@ -49,6 +51,17 @@
 
 /**
  * @brief Photon buffer.
+ *
+ * By default, the buffer stores an array of PhotonPacket objects. If
+ * USE_COMPACT_PHOTON_BUFFER is defined, the buffer instead stores compact
+ * photon packets, using single precision for the direction, the
+ * photoionization cross sections and the dust opacity and compact integer types
+ * for the other packet properties. This significantly reduces the memory
+ * footprint of a buffer, and of the MemorySpace that holds all buffers.
+ *
+ * Photon packets are always accessed by copying them from and to a
+ * PhotonPacket object using get_photon() and set_photon(). Blocks of photon
+ * packets are copied between buffers using add_photons().
  */
 class PhotonBuffer {
 private:
@@ -61,8 +74,51 @@ private:
   /*! @brief Number of photons in the buffer. */
   uint_least32_t _actual_size;
 
+#ifdef USE_COMPACT_PHOTON_BUFFER
+  /**
+   * @brief Compact, mixed precision representation of a photon packet.
+   */
+  struct CompactPhotonPacket {
+    /*! @brief Position (in m). */
+    double _position[3];
+
+    /*! @brief Target optical depth. */
+    double _target_optical_depth;
+
+    /*! @brief Energy (in Hz). */
+    double _energy;
+
+    /*! @brief Weight. */
+    double _weight;
+
+    /*! @brief Distance travelled (in m). */
+    double _distance_travelled;
+
+    /*! @brief Propagation direction. */
+    float _direction[3];
+
+    /*! @brief Photoionization cross sections (in m^2). */
+    float _photoionization_cross_section[NUMBER_OF_IONNAMES];
+
+    /*! @brief Dust opacity. */
+    float _dust_opacity;
+
+    /*! @brief Index of the source that emitted the photon packet. */
+    uint_least32_t _source_index;
+
+    /*! @brief Number of scatterings experienced by the photon packet. */
+    uint_least32_t _scatter_counter;
+
+    /*! @brief Type of the photon packet. */
+    uint_least8_t _type;
+  };
+
+  /*! @brief Actual photon buffer. */
+  CompactPhotonPacket _photons[PHOTONBUFFER_SIZE];
+#else
   /*! @brief Actual photon buffer. */
   PhotonPacket _photons[PHOTONBUFFER_SIZE];
+#endif
 
 public:
   /**
@@ -75,21 +131,30 @@ public:
    * @brief Store the contents of the PhotonBuffer in the given MPI
    * communication buffer.
    *
+   * Only the photons that are actually present in the buffer are packed.
+   *
    * @param buffer Buffer to use (should be preallocated and have at least size
    * PHOTONBUFFER_MPI_SIZE).
+   * @return Number of bytes that were actually used in the communication
+   * buffer.
    */
-  inline void pack(char buffer[PHOTONBUFFER_MPI_SIZE]) {
+  inline int_fast32_t pack(char buffer[PHOTONBUFFER_MPI_SIZE]) {
     int buffer_position = 0;
-    MPI_Pack(&_subgrid_index, 1, MPI_UNSIGNED, buffer, PHOTONBUFFER_MPI_SIZE,
+    // the subgrid index is stored as a size_t, but always fits in 32 bits
+    const uint_least32_t subgrid_index = _subgrid_index;
+    MPI_Pack(&subgrid_index, 1, MPI_UNSIGNED, buffer, PHOTONBUFFER_MPI_SIZE,
              &buffer_position, MPI_COMM_WORLD);
     MPI_Pack(&_direction, 1, MPI_INT, buffer, PHOTONBUFFER_MPI_SIZE,
              &buffer_position, MPI_COMM_WORLD);
     MPI_Pack(&_actual_size, 1, MPI_UNSIGNED, buffer, PHOTONBUFFER_MPI_SIZE,
              &buffer_position, MPI_COMM_WORLD);
-    for (uint_fast32_t i = 0; i < PHOTONBUFFER_SIZE; ++i) {
-      _photons[i].pack(&buffer[buffer_position]);
+    PhotonPacket photon;
+    for (uint_fast32_t i = 0; i < _actual_size; ++i) {
+      get_photon(i, photon);
+      photon.pack(&buffer[buffer_position]);
       buffer_position += PHOTON_MPI_SIZE;
     }
+    return buffer_position;
   }
 
   /**
@@ -101,14 +166,18 @@ public:
    */
   inline void unpack(char buffer[PHOTONBUFFER_MPI_SIZE]) {
     int buffer_position = 0;
-    MPI_Unpack(buffer, PHOTONBUFFER_MPI_SIZE, &buffer_position, &_subgrid_index,
+    uint_least32_t subgrid_index;
+    MPI_Unpack(buffer, PHOTONBUFFER_MPI_SIZE, &buffer_position, &subgrid_index,
                1, MPI_UNSIGNED, MPI_COMM_WORLD);
+    _subgrid_index = subgrid_index;
     MPI_Unpack(buffer, PHOTONBUFFER_MPI_SIZE, &buffer_position, &_direction, 1,
                MPI_INT, MPI_COMM_WORLD);
     MPI_Unpack(buffer, PHOTONBUFFER_MPI_SIZE, &buffer_position, &_actual_size,
                1, MPI_UNSIGNED, MPI_COMM_WORLD);
-    for (uint_fast32_t i = 0; i < PHOTONBUFFER_SIZE; ++i) {
-      _photons[i].unpack(&buffer[buffer_position]);
+    PhotonPacket photon;
+    for (uint_fast32_t i = 0; i < _actual_size; ++i) {
+      photon.unpack(&buffer[buffer_position]);
+      set_photon(i, photon);
       buffer_position += PHOTON_MPI_SIZE;
     }
   }
@@ -126,8 +195,11 @@ public:
                         "Directions do not match!");
     cmac_assert_message(_actual_size == other._actual_size,
                         "Sizes do not match!");
-    for (uint_fast32_t i = 0; i < PHOTONBUFFER_SIZE; ++i) {
-      _photons[i].check_equal(other._photons[i]);
+    PhotonPacket photon, other_photon;
+    for (uint_fast32_t i = 0; i < _actual_size; ++i) {
+      get_photon(i, photon);
+      other.get_photon(i, other_photon);
+      photon.check_equal(other_photon);
     }
   }
 
@@ -144,23 +216,98 @@ public:
   inline void reset() { _actual_size = 0; }
 
   /**
-   * @brief Get read-only access to the Photon with the given index.
+   * @brief Copy the photon packet with the given index into the given
+   * PhotonPacket.
+   *
+   * @param index Index of a photon packet in the buffer.
+   * @param photon PhotonPacket to copy into.
+   */
+  inline void get_photon(const uint_fast32_t index,
+                         PhotonPacket &photon) const {
+#ifdef USE_COMPACT_PHOTON_BUFFER
+    const CompactPhotonPacket &compact_photon = _photons[index];
+    photon.set_position(CoordinateVector<>(compact_photon._position[0],
+                                           compact_photon._position[1],
+                                           compact_photon._position[2]));
+    // note that this renormalises the direction in double precision
+    photon.set_direction(CoordinateVector<>(compact_photon._direction[0],
+                                            compact_photon._direction[1],
+                                            compact_photon._direction[2]));
+    photon.set_target_optical_depth(compact_photon._target_optical_depth);
+    for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+      photon.set_photoionization_cross_section(
+          ion, compact_photon._photoionization_cross_section[ion]);
+    }
+    photon.set_dust_opacity(compact_photon._dust_opacity);
+    photon.set_energy(compact_photon._energy);
+    photon.set_weight(compact_photon._weight);
+    photon.set_distance_travelled(compact_photon._distance_travelled);
+    photon.set_source_index(compact_photon._source_index);
+    photon.set_scatter_counter(compact_photon._scatter_counter);
+    photon.set_type(static_cast< PhotonType >(compact_photon._type));
+#else
+    photon = _photons[index];
+#endif
+  }
+
+  /**
+   * @brief Copy the given PhotonPacket into the photon packet with the given
+   * index.
    *
-   * @param index Index of a photon in the buffer.
-   * @return Read-only reference to the Photon that corresponds to that index.
+   * @param index Index of a photon packet in the buffer.
+   * @param photon PhotonPacket to copy.
    */
-  inline const PhotonPacket &operator[](const uint_fast32_t index) const {
-    return _photons[index];
+  inline void set_photon(const uint_fast32_t index,
+                         const PhotonPacket &photon) {
+#ifdef USE_COMPACT_PHOTON_BUFFER
+    CompactPhotonPacket &compact_photon = _photons[index];
+    const CoordinateVector<> &position = photon.get_position();
+    const CoordinateVector<> &direction = photon.get_direction();
+    for (uint_fast8_t idim = 0; idim < 3; ++idim) {
+      compact_photon._position[idim] = position[idim];
+      compact_photon._direction[idim] = direction[idim];
+    }
+    compact_photon._target_optical_depth = photon.get_target_optical_depth();
+    for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+      compact_photon._photoionization_cross_section[ion] =
+          photon.get_photoionization_cross_section(ion);
+    }
+    compact_photon._dust_opacity = photon.get_dust_opacity();
+    compact_photon._energy = photon.get_energy();
+    compact_photon._weight = photon.get_weight();
+    compact_photon._distance_travelled = photon.get_distance_travelled();
+    compact_photon._source_index = photon.get_source_index();
+    compact_photon._scatter_counter = photon.get_scatter_counter();
+    compact_photon._type = photon.get_type();
+#else
+    _photons[index] = photon;
+#endif
   }
 
   /**
-   * @brief Get read/write access to the Photon with the given index.
+   * @brief Add photon packets from the given buffer to the end of this buffer.
+   *
+   * Photon packets are copied starting from the given offset in the other
+   * buffer, until either all photon packets have been copied or this buffer is
+   * full. The photon packets are copied as a single contiguous block.
    *
-   * @param index Index of a photon in the buffer.
-   * @return Reference to the Photon that corresponds to that index.
+   * @param buffer Buffer to copy from.
+   * @param offset Index of the first photon packet in the other buffer that
+   * needs to be copied.
+   * @return Number of photon packets that was copied.
    */
-  inline PhotonPacket &operator[](const uint_fast32_t index) {
-    return _photons[index];
+  inline uint_fast32_t add_photons(const PhotonBuffer &buffer,
+                                   const uint_fast32_t offset = 0) {
+
+    cmac_assert_message(offset <= buffer._actual_size,
+                        "Offset larger than buffer size!");
+
+    const uint_fast32_t number = std::min< uint_fast32_t >(
+        buffer._actual_size - offset, PHOTONBUFFER_SIZE - _actual_size);
+    std::copy(&buffer._photons[offset], &buffer._photons[offset + number],
+              &_photons[_actual_size]);
+    _actual_size += number;
+    return number;
   }
 
   /**
@@ -0,0 +1,280 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file PhotonBufferCommunicator.hpp
+ *
+ * @brief Asynchronous exchange of photon buffers between MPI processes.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#ifndef PHOTONBUFFERCOMMUNICATOR_HPP
+#define PHOTONBUFFERCOMMUNICATOR_HPP
+
+#include "AtomicValue.hpp"
+#include "MemorySpace.hpp"
+#include "ThreadLock.hpp"
+
+#include <mpi.h>
+#include <vector>
+
+/*! @brief MPI tag used to communicate photon buffers. */
+#define PHOTONBUFFERCOMMUNICATOR_PHOTONBUFFER_TAG 302
+
+/*! @brief Default number of receives that is posted at any given time. */
+#define PHOTONBUFFERCOMMUNICATOR_DEFAULT_NUMBER_OF_RECEIVES 16
+
+/**
+ * @brief Asynchronous exchange of photon buffers between MPI processes.
+ *
+ * Photon buffers are sent using non-blocking sends and are received by a
+ * fixed number of posted non-blocking receives that are polled by the threads
+ * whenever they run out of work. All MPI calls are protected by a single lock,
+ * so that the MPI library only needs to support MPI_THREAD_SERIALIZED.
+ *
+ * The communicator also takes care of the termination of the photon
+ * propagation step: the local number of completed photon packets is summed
+ * over all processes using repeated non-blocking reductions. Completed photon
+ * packets stay completed, so the propagation step is finished as soon as a
+ * reduction yields the total number of photon packets. All processes see the
+ * same reduction results, so they all decide to stop after the same reduction.
+ */
+class PhotonBufferCommunicator {
+private:
+  /*! @brief Lock that protects all MPI calls. */
+  ThreadLock _lock;
+
+  /*! @brief Communication buffers used for sends. */
+  std::vector< char * > _send_buffers;
+
+  /*! @brief Requests for the sends. */
+  std::vector< MPI_Request > _send_requests;
+
+  /*! @brief Communication buffers used for receives. */
+  std::vector< char * > _receive_buffers;
+
+  /*! @brief Requests for the receives. */
+  std::vector< MPI_Request > _receive_requests;
+
+  /*! @brief Request for the ongoing termination reduction. */
+  MPI_Request _termination_request;
+
+  /*! @brief Local contribution to the ongoing termination reduction. */
+  uint64_t _local_number_done;
+
+  /*! @brief Result of the ongoing termination reduction. */
+  uint64_t _global_number_done;
+
+  /*! @brief Total number of photon packets that needs to be completed. */
+  uint64_t _total_number;
+
+  /*! @brief Flag signalling that the propagation step is finished. */
+  AtomicValue< bool > _finished;
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param number_of_receives Number of receives that is posted at any given
+   * time.
+   */
+  inline PhotonBufferCommunicator(
+      const uint_fast32_t number_of_receives =
+          PHOTONBUFFERCOMMUNICATOR_DEFAULT_NUMBER_OF_RECEIVES)
+      : _receive_buffers(number_of_receives, nullptr),
+        _receive_requests(number_of_receives, MPI_REQUEST_NULL),
+        _termination_request(MPI_REQUEST_NULL), _local_number_done(0),
+        _global_number_done(0), _total_number(0), _finished(false) {
+
+    for (uint_fast32_t i = 0; i < number_of_receives; ++i) {
+      _receive_buffers[i] = new char[PHOTONBUFFER_MPI_SIZE];
+    }
+  }
+
+  /**
+   * @brief Destructor.
+   */
+  inline ~PhotonBufferCommunicator() {
+    for (size_t i = 0; i < _send_buffers.size(); ++i) {
+      delete[] _send_buffers[i];
+    }
+    for (size_t i = 0; i < _receive_buffers.size(); ++i) {
+      delete[] _receive_buffers[i];
+    }
+  }
+
+  /**
+   * @brief Start a new photon propagation step.
+   *
+   * This function needs to be called by all processes before the parallel
+   * region and posts the receives.
+   *
+   * @param total_number Total number of photon packets (summed over all
+   * processes) that needs to be completed.
+   */
+  inline void start(const uint_fast64_t total_number) {
+    _total_number = total_number;
+    _finished.set(false);
+    _termination_request = MPI_REQUEST_NULL;
+    for (size_t i = 0; i < _receive_buffers.size(); ++i) {
+      MPI_Irecv(_receive_buffers[i], PHOTONBUFFER_MPI_SIZE, MPI_PACKED,
+                MPI_ANY_SOURCE, PHOTONBUFFERCOMMUNICATOR_PHOTONBUFFER_TAG,
+                MPI_COMM_WORLD, &_receive_requests[i]);
+    }
+  }
+
+  /**
+   * @brief End the photon propagation step.
+   *
+   * This function needs to be called by all processes after the parallel
+   * region. It waits for all sends to complete and cancels the receives that
+   * were not matched.
+   */
+  inline void finish() {
+    MPI_Waitall(_send_requests.size(), _send_requests.data(),
+                MPI_STATUSES_IGNORE);
+    for (size_t i = 0; i < _receive_requests.size(); ++i) {
+      MPI_Cancel(&_receive_requests[i]);
+      MPI_Wait(&_receive_requests[i], MPI_STATUS_IGNORE);
+    }
+  }
+
+  /**
+   * @brief Send the given photon buffer to the given process.
+   *
+   * The contents of the buffer are copied into an internal communication
+   * buffer, so the photon buffer can be reused as soon as this function
+   * returns.
+   *
+   * @param buffer PhotonBuffer to send.
+   * @param rank Rank of the receiving process.
+   */
+  inline void send(PhotonBuffer &buffer, const int_fast32_t rank) {
+
+    _lock.lock();
+
+    // find a communication buffer that is no longer in use
+    size_t index = _send_requests.size();
+    for (size_t i = 0; i < _send_requests.size(); ++i) {
+      int flag = 1;
+      if (_send_requests[i] != MPI_REQUEST_NULL) {
+        MPI_Test(&_send_requests[i], &flag, MPI_STATUS_IGNORE);
+      }
+      if (flag) {
+        index = i;
+        break;
+      }
+    }
+    if (index == _send_requests.size()) {
+      _send_buffers.push_back(new char[PHOTONBUFFER_MPI_SIZE]);
+      _send_requests.push_back(MPI_REQUEST_NULL);
+    }
+
+    const int_fast32_t size = buffer.pack(_send_buffers[index]);
+    MPI_Isend(_send_buffers[index], size, MPI_PACKED, rank,
+              PHOTONBUFFERCOMMUNICATOR_PHOTONBUFFER_TAG, MPI_COMM_WORLD,
+              &_send_requests[index]);
+
+    _lock.unlock();
+  }
+
+  /**
+   * @brief Check for incoming photon buffers.
+   *
+   * If another thread is already communicating, we return immediately.
+   *
+   * @param buffers Photon buffer array in which received buffers are stored.
+   * @param buffer_indices Array to store the indices of the received buffers
+   * in (should have at least the size of the number of posted receives).
+   * @return Number of received buffers.
+   */
+  inline uint_fast32_t receive(MemorySpace &buffers, size_t *buffer_indices) {
+
+    if (!_lock.try_lock()) {
+      return 0;
+    }
+
+    uint_fast32_t number_received = 0;
+    for (size_t i = 0; i < _receive_requests.size(); ++i) {
+      int flag;
+      MPI_Test(&_receive_requests[i], &flag, MPI_STATUS_IGNORE);
+      if (flag) {
+        const size_t index = buffers.get_free_buffer();
+        buffers[index].unpack(_receive_buffers[i]);
+        buffer_indices[number_received] = index;
+        ++number_received;
+        MPI_Irecv(_receive_buffers[i], PHOTONBUFFER_MPI_SIZE, MPI_PACKED,
+                  MPI_ANY_SOURCE, PHOTONBUFFERCOMMUNICATOR_PHOTONBUFFER_TAG,
+                  MPI_COMM_WORLD, &_receive_requests[i]);
+      }
+    }
+
+    _lock.unlock();
+    return number_received;
+  }
+
+  /**
+   * @brief Check if the photon propagation step is finished on all processes.
+   *
+   * If no termination reduction is ongoing, a new one is started with the
+   * given local number of completed photon packets.
+   *
+   * @param local_number_done Number of photon packets completed on this
+   * process.
+   * @return True if all photon packets on all processes have been completed.
+   */
+  inline bool is_finished(const uint_fast64_t local_number_done) {
+
+    if (_finished.value()) {
+      return true;
+    }
+
+    if (!_lock.try_lock()) {
+      return false;
+    }
+
+    if (!_finished.value()) {
+      if (_termination_request == MPI_REQUEST_NULL) {
+        _local_number_done = local_number_done;
+        MPI_Iallreduce(&_local_number_done, &_global_number_done, 1,
+                       MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD,
+                       &_termination_request);
+      } else {
+        int flag;
+        MPI_Test(&_termination_request, &flag, MPI_STATUS_IGNORE);
+        if (flag && _global_number_done == _total_number) {
+          _finished.set(true);
+        }
+      }
+    }
+
+    _lock.unlock();
+    return _finished.value();
+  }
+
+  /**
+   * @brief Get the number of receives that is posted at any given time.
+   *
+   * @return Number of posted receives.
+   */
+  inline uint_fast32_t get_number_of_receives() const {
+    return _receive_requests.size();
+  }
+};
+
+#endif // PHOTONBUFFERCOMMUNICATOR_HPP
@@ -27,7 +27,8 @@
 #define PHOTONPACKET_HPP
 
 /*! @brief Size of the MPI buffer necessary to store a single Photon. */
-#define PHOTON_MPI_SIZE ((9 + NUMBER_OF_IONNAMES) * sizeof(double))
+#define PHOTON_MPI_SIZE                                                        \
+  ((11 + NUMBER_OF_IONNAMES) * sizeof(double) + 3 * sizeof(int_least32_t))
 
 #include "Configuration.hpp"
 #include "CoordinateVector.hpp"
@@ -100,6 +101,16 @@ public:
              MPI_COMM_WORLD);
     MPI_Pack(&_weight, 1, MPI_DOUBLE, buffer, PHOTON_MPI_SIZE, &buffer_position,
              MPI_COMM_WORLD);
+    MPI_Pack(&_dust_opacity, 1, MPI_DOUBLE, buffer, PHOTON_MPI_SIZE,
+             &buffer_position, MPI_COMM_WORLD);
+    MPI_Pack(&_distance_travelled, 1, MPI_DOUBLE, buffer, PHOTON_MPI_SIZE,
+             &buffer_position, MPI_COMM_WORLD);
+    const int_least32_t integers[3] = {
+        static_cast< int_least32_t >(_type),
+        static_cast< int_least32_t >(_scatter_counter),
+        static_cast< int_least32_t >(_source_index)};
+    MPI_Pack(integers, 3, MPI_INT, buffer, PHOTON_MPI_SIZE, &buffer_position,
+             MPI_COMM_WORLD);
   }
 
   /**
@@ -131,6 +142,16 @@ public:
                MPI_DOUBLE, MPI_COMM_WORLD);
     MPI_Unpack(buffer, PHOTON_MPI_SIZE, &buffer_position, &_weight, 1,
                MPI_DOUBLE, MPI_COMM_WORLD);
+    MPI_Unpack(buffer, PHOTON_MPI_SIZE, &buffer_position, &_dust_opacity, 1,
+               MPI_DOUBLE, MPI_COMM_WORLD);
+    MPI_Unpack(buffer, PHOTON_MPI_SIZE, &buffer_position, &_distance_travelled,
+               1, MPI_DOUBLE, MPI_COMM_WORLD);
+    int_least32_t integers[3];
+    MPI_Unpack(buffer, PHOTON_MPI_SIZE, &buffer_position, integers, 3, MPI_INT,
+               MPI_COMM_WORLD);
+    _type = static_cast< PhotonType >(integers[0]);
+    _scatter_counter = integers[1];
+    _source_index = integers[2];
   }
 #endif
 
@@ -123,8 +123,9 @@ public:
 
     // reemission
     uint_fast32_t index = 0;
+    PhotonPacket old_photon, new_photon;
     for (uint_fast32_t iphoton = 0; iphoton < buffer.size(); ++iphoton) {
-      PhotonPacket &old_photon = buffer[iphoton];
+      buffer.get_photon(iphoton, old_photon);
       IonizationVariables &ionization_variables =
           subgrid.get_cell(old_photon.get_position())
               .get_ionization_variables();
@@ -145,7 +146,6 @@ public:
                                      _random_generators[thread_id], new_type,
                                      _statistics);
       if (new_frequency > 0.) {
-        PhotonPacket &new_photon = buffer[index];
         new_photon.set_type(new_type);
         new_photon.set_scatter_counter(old_photon.get_scatter_counter() + 1);
         new_photon.set_position(old_photon.get_position());
@@ -154,17 +154,20 @@ public:
         new_photon.set_source_index(old_photon.get_source_index());
 
         new_photon.set_energy(new_frequency);
+        double cross_sections[NUMBER_OF_IONNAMES];
+        double dust_opacity;
+        _cross_sections.get_cross_sections(new_frequency, cross_sections,
+                                           dust_opacity);
         for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
-          double sigma = _cross_sections.get_cross_section(ion, new_frequency);
+          double sigma = cross_sections[ion];
 #ifndef VARIABLE_ABUNDANCES
           if (ion != ION_H_n) {
             sigma *= _abundances.get_abundance(get_element(ion));
           }
 #endif
           new_photon.set_photoionization_cross_section(ion, sigma);
-          new_photon.set_dust_opacity(_cross_sections.get_dust_opacity(new_frequency));
-
         }
+        new_photon.set_dust_opacity(dust_opacity);
 
         // draw two pseudo random numbers
         const double cost =
@@ -187,6 +190,7 @@ public:
         new_photon.set_target_optical_depth(-std::log(
             _random_generators[thread_id].get_uniform_random_double()));
 
+        buffer.set_photon(index, new_photon);
         ++index;
       }
     }
@@ -206,7 +210,7 @@ public:
       new_task.set_type(TASKTYPE_PHOTON_TRAVERSAL);
       new_task.set_subgrid(task.get_subgrid());
       new_task.set_buffer(current_buffer_index);
-      new_task.set_dependency(subgrid.get_dependency());
+      new_task.set_dependency(subgrid.get_traversal_dependency());
 
       queues_to_add[num_tasks_to_add] = subgrid.get_owning_thread();
       tasks_to_add[num_tasks_to_add] = task_index;
@@ -188,9 +188,11 @@ PhotonSource::~PhotonSource() { delete _reemission_handler; }
  */
 void PhotonSource::set_cross_sections(Photon &photon, double energy) const {
 
+  double cross_sections[NUMBER_OF_IONNAMES];
+  double dust_opacity;
+  _cross_sections.get_cross_sections(energy, cross_sections, dust_opacity);
   for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
-    photon.set_cross_section(ion,
-                             _cross_sections.get_cross_section(ion, energy));
+    photon.set_cross_section(ion, cross_sections[ion]);
   }
 #ifdef HAS_HELIUM
   photon.set_cross_section_He_corr(_abundances.get_abundance(ELEMENT_He) *
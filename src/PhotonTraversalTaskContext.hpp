@@ -116,21 +116,77 @@ public:
     const uint_fast32_t igrid = photon_buffer.get_subgrid_index();
     DensitySubGrid &this_grid = *_grid_creator.get_subgrid(igrid);
 
+#ifdef USE_PRIVATE_INTENSITY_BUFFERS
+    // other threads can traverse the same subgrid at the same time: the
+    // intensity integrals are accumulated in buffers private to this thread
+    double *accumulators =
+        _grid_creator.get_intensity_accumulators(thread_id, igrid);
+    // if the task does not own the subgrid and this thread used up all its
+    // private buffers, we need exclusive access to accumulate directly into
+    // the subgrid
+    bool owns_subgrid = (this_grid.get_traversal_dependency() != nullptr);
+    bool locked_subgrid = false;
+    if (accumulators == nullptr && !owns_subgrid) {
+      if (!this_grid.get_dependency()->try_lock()) {
+        // another thread is working on the subgrid: rather than waiting for
+        // it, we put the buffer back in the general queue, so that it can be
+        // picked up later, possibly by a thread that still has private
+        // buffers available
+        const size_t task_index = _tasks.get_free_element();
+        Task &new_task = _tasks[task_index];
+        new_task.set_subgrid(igrid);
+        new_task.set_buffer(current_buffer_index);
+        new_task.set_type(TASKTYPE_PHOTON_TRAVERSAL);
+        new_task.set_dependency(this_grid.get_traversal_dependency());
+        queues_to_add[0] = -1;
+        tasks_to_add[0] = task_index;
+        return 1;
+      }
+      locked_subgrid = true;
+      owns_subgrid = true;
+    }
+#else
+#ifndef USE_NUMA
     // set the ownership of this grid to the current thread (in case this task
     // was stolen)
+    // if NUMA awareness is enabled, subgrids keep their home thread, so that
+    // new tasks for them are queued in the NUMA domain of their memory
     this_grid.set_owning_thread(thread_id);
+#endif
+    double *accumulators = nullptr;
+#endif
 
     traversal_thread_context.initialize(this_grid, _do_reemission);
 
     // keep track of the original number of photons
     uint_fast32_t num_photon_done_now = photon_buffer.size();
 
+#ifdef USE_BATCHED_TRAVERSAL
+    // traverse all photons in the input buffer at once
+    int_fast32_t *results = traversal_thread_context.get_output_directions();
+    PhotonPacket *photons = traversal_thread_context.get_photons();
+    for (uint_fast32_t i = 0; i < photon_buffer.size(); ++i) {
+      photon_buffer.get_photon(i, photons[i]);
+    }
+    this_grid.interact_batch(photons, photon_buffer.size(),
+                             photon_buffer.get_direction(),
+                             _max_photon_distance, results,
+                             traversal_thread_context.get_path_buffer(),
+                             accumulators);
+#endif
+
     // now loop over the input buffer photons and traverse them one by
     // one
     for (uint_fast32_t i = 0; i < photon_buffer.size(); ++i) {
 
+#ifdef USE_BATCHED_TRAVERSAL
       // active photon
-      PhotonPacket &photon = photon_buffer[i];
+      const PhotonPacket &photon = photons[i];
+      const int_fast32_t result = results[i];
+#else
+      // active photon
+      PhotonPacket photon;
+      photon_buffer.get_photon(i, photon);
 
       // make sure the photon is moving in *a* direction
       cmac_assert_message(photon.get_direction()[0] != 0. ||
@@ -140,7 +196,9 @@ public:
 
       // traverse the photon through the active subgrid
       const int_fast32_t result =
-          this_grid.interact(photon, photon_buffer.get_direction(), _max_photon_distance);
+          this_grid.interact(photon, photon_buffer.get_direction(),
+                             _max_photon_distance, accumulators);
+#endif
 
       // check that the photon ended up in a valid output buffer
       cmac_assert_message(result >= 0 && result < TRAVELDIRECTION_NUMBER,
@@ -157,6 +215,26 @@ public:
       }
     }
 
+#ifdef USE_PRIVATE_INTENSITY_BUFFERS
+    // the photon buffers of this subgrid are shared with the other tasks that
+    // traverse it. We only add photon packets to them if this task owns the
+    // subgrid: because it depends on the subgrid, because it had to lock the
+    // subgrid for the traversal, or because we manage to lock the subgrid
+    // without waiting for it. If not, the photon packets are put in new
+    // buffers that are launched immediately.
+    if (!owns_subgrid) {
+      locked_subgrid = this_grid.get_dependency()->try_lock();
+      owns_subgrid = locked_subgrid;
+    }
+#ifndef USE_NUMA
+    if (owns_subgrid) {
+      this_grid.set_owning_thread(thread_id);
+    }
+#endif
+#else
+    const bool owns_subgrid = true;
+#endif
+
     // add none empty buffers to the appropriate queues
     uint_fast8_t largest_index = TRAVELDIRECTION_NUMBER;
     uint_fast32_t largest_size = 0;
@@ -173,49 +251,100 @@ public:
         // are not done yet
         num_photon_done_now -= local_buffer.size();
 
-        // move photon packets from the local temporary buffer (that is
-        // guaranteed to be large enough) to the actual output buffer
-        // for that direction (which might cause on overflow)
+#ifdef DENSITYGRID_EDGECOST
+        // keep track of the number of photon packets that cross each subgrid
+        // boundary, this is used to decide where to cut the domain
+        if (i > 0) {
+          this_grid.add_communication_cost(i, local_buffer.size());
+        }
+#endif
+
         const uint_fast32_t ngb = this_grid.get_neighbour(i);
-        uint_fast32_t new_index = this_grid.get_active_buffer(i);
+        uint_fast32_t new_index;
+        bool launch_buffer;
+        if (owns_subgrid) {
+
+          // move photon packets from the local temporary buffer (that is
+          // guaranteed to be large enough) to the actual output buffer
+          // for that direction (which might cause on overflow)
+          new_index = this_grid.get_active_buffer(i);
+
+          if (new_index == NEIGHBOUR_OUTSIDE) {
+            // buffer was not created yet: create it now
+            new_index = _buffers.get_free_buffer();
+            PhotonBuffer &buffer = _buffers[new_index];
+            buffer.set_subgrid_index(ngb);
+            buffer.set_direction(
+                TravelDirections::output_to_input_direction(i));
+            this_grid.set_active_buffer(i, new_index);
+          }
 
-        if (new_index == NEIGHBOUR_OUTSIDE) {
-          // buffer was not created yet: create it now
+          const uint_fast32_t add_index =
+              _buffers.add_photons(new_index, local_buffer);
+
+          // check if the original buffer is full
+          launch_buffer = (add_index != new_index);
+          if (launch_buffer) {
+
+            // new_buffers.add_photons already created a new empty
+            // buffer, set it as the active buffer for this output
+            // direction
+            if (_buffers[add_index].size() == 0) {
+              _buffers.free_buffer(add_index);
+              this_grid.set_active_buffer(i, NEIGHBOUR_OUTSIDE);
+            } else {
+              this_grid.set_active_buffer(i, add_index);
+
+              cmac_assert_message(
+                  _buffers[add_index].get_subgrid_index() == ngb,
+                  "Wrong subgrid");
+              cmac_assert_message(
+                  _buffers[add_index].get_direction() ==
+                      TravelDirections::output_to_input_direction(i),
+                  "Wrong direction");
+            }
+          }
+        } else {
+
+          // copy the photon packets into a new buffer that is launched
+          // straight away
           new_index = _buffers.get_free_buffer();
           PhotonBuffer &buffer = _buffers[new_index];
           buffer.set_subgrid_index(ngb);
           buffer.set_direction(TravelDirections::output_to_input_direction(i));
-          this_grid.set_active_buffer(i, new_index);
-        }
-
-        uint_fast32_t add_index = _buffers.add_photons(new_index, local_buffer);
-
-        // check if the original buffer is full
-        if (add_index != new_index) {
-
-          // new_buffers.add_photons already created a new empty
-          // buffer, set it as the active buffer for this output
-          // direction
-          if (_buffers[add_index].size() == 0) {
+          const uint_fast32_t add_index =
+              _buffers.add_photons(new_index, local_buffer);
+          // the local buffer never holds more photon packets than a single
+          // buffer, so the extra buffer created when it is completely filled
+          // is always empty
+          if (add_index != new_index) {
+            cmac_assert(_buffers[add_index].size() == 0);
             _buffers.free_buffer(add_index);
-            this_grid.set_active_buffer(i, NEIGHBOUR_OUTSIDE);
-          } else {
-            this_grid.set_active_buffer(i, add_index);
-
-            cmac_assert_message(_buffers[add_index].get_subgrid_index() == ngb,
-                                "Wrong subgrid");
-            cmac_assert_message(
-                _buffers[add_index].get_direction() ==
-                    TravelDirections::output_to_input_direction(i),
-                "Wrong direction");
           }
+          launch_buffer = true;
+        }
+
+        if (launch_buffer) {
 
           // YES: create a task for the buffer and add it to the queue
           // the task type depends on the buffer: photon packets in the
           // internal buffer were absorbed and could be reemitted,
           // photon packets in the other buffers left the subgrid and
           // need to be traversed in the neighbouring subgrid
-          if (i > 0) {
+          if (i > 0 && !_grid_creator.is_local(ngb)) {
+            // the neighbouring subgrid lives on another process: send the
+            // buffer there
+            const size_t task_index = _tasks.get_free_element();
+            Task &new_task = _tasks[task_index];
+            new_task.set_subgrid(ngb);
+            new_task.set_buffer(new_index);
+            new_task.set_type(TASKTYPE_SEND);
+            // a send task has no dependencies
+            // add the task to the general queue
+            queues_to_add[num_tasks_to_add] = -1;
+            tasks_to_add[num_tasks_to_add] = task_index;
+            ++num_tasks_to_add;
+          } else if (i > 0) {
             DensitySubGrid &subgrid = *_grid_creator.get_subgrid(
                 _buffers[new_index].get_subgrid_index());
             const size_t task_index = _tasks.get_free_element();
@@ -226,11 +355,10 @@ public:
 
             // add dependencies for task:
             //  - subgrid
-            new_task.set_dependency(subgrid.get_dependency());
+            new_task.set_dependency(subgrid.get_traversal_dependency());
 
             // add the task to the queue of the corresponding thread
-            const int_fast32_t queue_index =
-                (*_grid_creator.get_subgrid(ngb)).get_owning_thread();
+            const int_fast32_t queue_index = subgrid.get_owning_thread();
             queues_to_add[num_tasks_to_add] = queue_index;
             tasks_to_add[num_tasks_to_add] = task_index;
             ++num_tasks_to_add;
@@ -247,13 +375,13 @@ public:
             ++num_tasks_to_add;
           }
 
-        } // if (add_index != new_index)
+        } // if (launch_buffer)
 
       } // if (thread_context.has_outgoing_photons(i))
 
       // we have to do this outside the other condition, as buffers to
       // which nothing was added can still be non-empty...
-      if (this_grid.get_neighbour(i) != NEIGHBOUR_OUTSIDE) {
+      if (owns_subgrid && this_grid.get_neighbour(i) != NEIGHBOUR_OUTSIDE) {
         uint_fast32_t new_index = this_grid.get_active_buffer(i);
         if (new_index != NEIGHBOUR_OUTSIDE &&
             _buffers[new_index].size() > largest_size) {
@@ -264,7 +392,9 @@ public:
 
     } // for (int i = TRAVELDIRECTION_NUMBER - 1; i >= 0; --i)
 
-    this_grid.set_largest_buffer(largest_index, largest_size);
+    if (owns_subgrid) {
+      this_grid.set_largest_buffer(largest_index, largest_size);
+    }
 
     // add photons that were absorbed (if reemission was disabled) or
     // that left the system to the global count
@@ -277,6 +407,12 @@ public:
     cpucycle_tick(task_stop);
     this_grid.add_computational_cost(task_stop - task_start);
 
+#ifdef USE_PRIVATE_INTENSITY_BUFFERS
+    if (locked_subgrid) {
+      this_grid.get_dependency()->unlock();
+    }
+#endif
+
     return num_tasks_to_add;
   }
 
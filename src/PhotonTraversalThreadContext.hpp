@@ -27,6 +27,7 @@
 #ifndef PHOTONTRAVERSALTHREADCONTEXT_HPP
 #define PHOTONTRAVERSALTHREADCONTEXT_HPP
 
+#include "Configuration.hpp"
 #include "DensitySubGrid.hpp"
 #include "PhotonBuffer.hpp"
 #include "ThreadContext.hpp"
@@ -45,6 +46,17 @@ private:
   /*! @brief Flags used to distinguish active and inactive directions. */
   bool _local_buffer_flags[TRAVELDIRECTION_NUMBER];
 
+#ifdef USE_BATCHED_TRAVERSAL
+  /*! @brief Scratch space for batched photon traversal. */
+  DensitySubGrid::PathBuffer _path_buffer;
+
+  /*! @brief Output directions for the photon packets in a batch. */
+  int_fast32_t _output_directions[PHOTONBUFFER_SIZE];
+
+  /*! @brief Photon packets in a batch. */
+  PhotonPacket _photons[PHOTONBUFFER_SIZE];
+#endif
+
 public:
   /**
    * @brief Constructor.
@@ -112,7 +124,7 @@ public:
 
       // add the photon
       const uint_fast32_t index = output_buffer.get_next_free_photon();
-      output_buffer[index] = photon;
+      output_buffer.set_photon(index, photon);
       return true;
     } else {
       return false;
@@ -141,6 +153,30 @@ public:
   get_outgoing_buffer(const int_fast32_t output_direction) const {
     return _local_buffers[output_direction];
   }
+
+#ifdef USE_BATCHED_TRAVERSAL
+  /**
+   * @brief Get the scratch space for batched photon traversal.
+   *
+   * @return Thread private path buffer.
+   */
+  inline DensitySubGrid::PathBuffer &get_path_buffer() { return _path_buffer; }
+
+  /**
+   * @brief Get the array used to store the output directions of the photon
+   * packets in a batch.
+   *
+   * @return Thread private output direction array (of size PHOTONBUFFER_SIZE).
+   */
+  inline int_fast32_t *get_output_directions() { return _output_directions; }
+
+  /**
+   * @brief Get the array used to store the photon packets in a batch.
+   *
+   * @return Thread private photon packet array (of size PHOTONBUFFER_SIZE).
+   */
+  inline PhotonPacket *get_photons() { return _photons; }
+#endif
 };
 
 #endif // PHOTONTRAVERSALTHREADCONTEXT_HPP
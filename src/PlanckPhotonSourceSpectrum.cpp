@@ -35,7 +35,6 @@
 #include "ParameterFile.hpp"
 #include "PhysicalConstants.hpp"
 #include "RandomGenerator.hpp"
-#include "Utilities.hpp"
 #include <cmath>
 
 /**
@@ -101,6 +100,8 @@ PlanckPhotonSourceSpectrum::PlanckPhotonSourceSpectrum(double temperature,
     _log_cumulative_distribution[i] = std::log10(_cumulative_distribution[i]);
     _log_frequency[i] = std::log10(frequency[i]);
   }
+  _alias_table.initialize(_cumulative_distribution.data(),
+                          PLANCKPHOTONSOURCESPECTRUM_NUMFREQ);
 
   if (log) {
     log->write_status("Set up a Planck black body spectrum with temperature ",
@@ -138,9 +139,9 @@ PlanckPhotonSourceSpectrum::PlanckPhotonSourceSpectrum(std::string role,
 /**
  * @brief Get a random frequency from a Planck blackbody spectrum.
  *
- * We sample a random uniform number and find its location in the cumulative
- * distribution array. We then use the logarithmic arrays to convert this into a
- * frequency.
+ * We use an alias table to sample a bin of the cumulative distribution array
+ * and a uniform random value of the cumulative distribution within that bin.
+ * We then use the logarithmic arrays to convert this into a frequency.
  *
  * @param random_generator RandomGenerator to use.
  * @param temperature Not used for this spectrum.
@@ -148,10 +149,12 @@ PlanckPhotonSourceSpectrum::PlanckPhotonSourceSpectrum(std::string role,
  */
 double PlanckPhotonSourceSpectrum::get_random_frequency(
     RandomGenerator &random_generator, double temperature) const {
-  double x = random_generator.get_uniform_random_double();
-
-  uint_fast32_t ix = Utilities::locate(x, _cumulative_distribution.data(),
-                                       PLANCKPHOTONSOURCESPECTRUM_NUMFREQ);
+  double fraction;
+  const uint_fast32_t ix = _alias_table.sample(
+      random_generator.get_uniform_random_double(), fraction);
+  const double x =
+      _cumulative_distribution[ix] +
+      fraction * (_cumulative_distribution[ix + 1] - _cumulative_distribution[ix]);
   double log_random_frequency =
       (std::log10(x) - _log_cumulative_distribution[ix]) /
           (_log_cumulative_distribution[ix + 1] -
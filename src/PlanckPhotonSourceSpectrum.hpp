@@ -27,6 +27,7 @@
 #ifndef PLANCKPHOTONSOURCESPECTRUM_HPP
 #define PLANCKPHOTONSOURCESPECTRUM_HPP
 
+#include "AliasTable.hpp"
 #include "PhotonSourceSpectrum.hpp"
 
 #include <string>
@@ -59,6 +60,9 @@ private:
   /*! @brief Base 10 logarithm of the cumulative distribution in each bin. */
   std::vector< double > _log_cumulative_distribution;
 
+  /*! @brief Alias table used to sample the cumulative distribution. */
+  AliasTable _alias_table;
+
   /*! @brief Ionizing flux of the spectrum (in m^-2 s^-1). */
   const double _ionizing_flux;
 
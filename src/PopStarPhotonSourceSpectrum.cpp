@@ -167,6 +167,7 @@ PopStarPhotonSourceSpectrum::PopStarPhotonSourceSpectrum(
     _cumulative_distribution[i] /=
         _cumulative_distribution[POPSTARPHOTONSOURCESPECTRUM_NUMFREQ - 1];
   }
+  _alias_table.initialize(_cumulative_distribution.data(), POPSTARPHOTONSOURCESPECTRUM_NUMFREQ);
 
   if (log) {
     log->write_status(
@@ -197,9 +198,9 @@ PopStarPhotonSourceSpectrum::PopStarPhotonSourceSpectrum(std::string role,
 /**
  * @brief Get a random frequency from a stellar model spectrum.
  *
- * We draw a random uniform number in the range [0, 1] and find the bin in the
- * tabulated cumulative distribution that contains that number. The sampled
- * frequency is then the linearly interpolated value corresponding to that bin.
+ * We use an alias table to select a bin of the tabulated cumulative
+ * distribution in constant time. The sampled frequency is then the linearly
+ * interpolated value at a uniform random position within that bin.
  *
  * @param random_generator RandomGenerator to use.
  * @param temperature Not used for this spectrum.
@@ -208,15 +209,26 @@ PopStarPhotonSourceSpectrum::PopStarPhotonSourceSpectrum(std::string role,
 double PopStarPhotonSourceSpectrum::get_random_frequency(
     RandomGenerator &random_generator, double temperature) const {
 
-  const double x = random_generator.get_uniform_random_double();
-  const uint_fast32_t inu = Utilities::locate(
-      x, _cumulative_distribution.data(), POPSTARPHOTONSOURCESPECTRUM_NUMFREQ);
-  const double frequency =
-      _frequencies[inu] +
-      (_frequencies[inu + 1] - _frequencies[inu]) *
-          (x - _cumulative_distribution[inu]) /
-          (_cumulative_distribution[inu + 1] - _cumulative_distribution[inu]);
-  return frequency;
+  return _alias_table.sample_linear(
+      random_generator.get_uniform_random_double(), _frequencies.data());
+}
+
+/**
+ * @brief Get a batch of random frequencies from the spectrum.
+ *
+ * @param random_generator RandomGenerator to use.
+ * @param frequencies Array to store the random frequencies in (in Hz).
+ * @param number_of_frequencies Number of frequencies to draw.
+ * @param temperature Not used for this spectrum.
+ */
+void PopStarPhotonSourceSpectrum::get_random_frequencies(
+    RandomGenerator &random_generator, double *frequencies,
+    const uint_fast32_t number_of_frequencies, double temperature) const {
+
+  for (uint_fast32_t i = 0; i < number_of_frequencies; ++i) {
+    frequencies[i] = _alias_table.sample_linear(
+        random_generator.get_uniform_random_double(), _frequencies.data());
+  }
 }
 
 /**
@@ -30,6 +30,7 @@
 #include "MemorySpace.hpp"
 #include "Task.hpp"
 #include "TaskQueue.hpp"
+#include "WorkStealingTaskQueue.hpp"
 
 /**
  * @brief Task context responsible for prematurely launching photon buffers.
@@ -46,7 +47,7 @@ private:
   ThreadSafeVector< Task > &_tasks;
 
   /*! @brief Queues per thread. */
-  std::vector< TaskQueue * > &_queues;
+  std::vector< ThreadTaskQueue * > &_queues;
 
   /*! @brief General shared queue. */
   TaskQueue &_shared_queue;
@@ -64,21 +65,27 @@ public:
   inline PrematureLaunchTaskContext(
       MemorySpace &buffers,
       DensitySubGridCreator< _subgrid_type_ > &grid_creator,
-      ThreadSafeVector< Task > &tasks, std::vector< TaskQueue * > &queues,
-      TaskQueue &shared_queue)
+      ThreadSafeVector< Task > &tasks,
+      std::vector< ThreadTaskQueue * > &queues, TaskQueue &shared_queue)
       : _buffers(buffers), _grid_creator(grid_creator), _tasks(tasks),
         _queues(queues), _shared_queue(shared_queue) {}
 
   /**
    * @brief Execute a premature launch task.
+   *
+   * @return True if a new task was added to one of the queues.
    */
-  inline void execute() {
+  inline bool execute() {
 
+    bool task_added = false;
     uint_fast32_t threshold_size = PHOTONBUFFER_SIZE;
     while (threshold_size > 0) {
       threshold_size >>= 1;
       for (auto gridit = _grid_creator.begin();
            gridit != _grid_creator.all_end(); ++gridit) {
+        if (!_grid_creator.is_local(gridit.get_index())) {
+          continue;
+        }
         DensitySubGrid &this_subgrid = *gridit;
         if (this_subgrid.get_largest_buffer_size() > threshold_size &&
             this_subgrid.get_dependency()->try_lock()) {
@@ -95,13 +102,20 @@ public:
             Task &new_task = _tasks[task_index];
             new_task.set_subgrid(_buffers[non_full_index].get_subgrid_index());
             new_task.set_buffer(non_full_index);
-            if (largest_index > 0) {
+            const uint_fast32_t ngb =
+                _buffers[non_full_index].get_subgrid_index();
+            if (largest_index > 0 && !_grid_creator.is_local(ngb)) {
+              // the target subgrid lives on another process
+              new_task.set_type(TASKTYPE_SEND);
+              // a send task has no dependencies
+              _shared_queue.add_task(task_index);
+            } else if (largest_index > 0) {
               DensitySubGrid &subgrid = *_grid_creator.get_subgrid(
                   _buffers[non_full_index].get_subgrid_index());
               new_task.set_type(TASKTYPE_PHOTON_TRAVERSAL);
 
               // add dependency
-              new_task.set_dependency(subgrid.get_dependency());
+              new_task.set_dependency(subgrid.get_traversal_dependency());
 
               const uint_fast32_t queue_index = subgrid.get_owning_thread();
               _queues[queue_index]->add_task(task_index);
@@ -132,6 +146,7 @@ public:
             this_subgrid.get_dependency()->unlock();
 
             // we managed to activate a buffer, we are done
+            task_added = true;
             threshold_size = 0;
             break;
           } else {
@@ -142,6 +157,7 @@ public:
         }
       }
     }
+    return task_added;
   }
 };
 
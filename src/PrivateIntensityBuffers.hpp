@@ -0,0 +1,281 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file PrivateIntensityBuffers.hpp
+ *
+ * @brief Thread private buffers used to accumulate intensity integrals during
+ * photon traversal.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#ifndef PRIVATEINTENSITYBUFFERS_HPP
+#define PRIVATEINTENSITYBUFFERS_HPP
+
+#include "Error.hpp"
+#include "IonizationVariables.hpp"
+
+#include <cinttypes>
+#include <vector>
+
+/*! @brief Default maximum number of blocks a single thread can use. */
+#define PRIVATEINTENSITYBUFFERS_DEFAULT_MAXIMUM_NUMBER_OF_BLOCKS 64
+
+/*! @brief Number of accumulator values stored per cell: the mean intensity
+ *  integrals for all ions, followed by the heating integrals. */
+#define PRIVATEINTENSITYBUFFERS_ACCUMULATOR_SIZE                               \
+  (NUMBER_OF_IONNAMES + NUMBER_OF_HEATINGTERMS)
+
+/**
+ * @brief Thread private buffers used to accumulate intensity integrals during
+ * photon traversal.
+ *
+ * Every thread owns a block of accumulators for every subgrid it traverses.
+ * Blocks are only allocated when a thread first traverses a subgrid during a
+ * traversal step, and are released again when they are reduced into the
+ * subgrid, so that the memory overhead is set by the number of distinct
+ * subgrids that every thread visits during a single traversal step. Apart
+ * from the blocks themselves, we only store a table with one pointer per
+ * thread and subgrid. A block stores PRIVATEINTENSITYBUFFERS_ACCUMULATOR_SIZE
+ * consecutive values per cell.
+ *
+ * The number of blocks a single thread can use during a traversal step is
+ * capped. Once a thread reaches that cap, it no longer gets new blocks and
+ * needs to accumulate directly into the subgrid instead.
+ *
+ * A thread only ever accesses its own blocks during traversal, so that no
+ * locking is required. The blocks of all threads are reduced per subgrid once
+ * traversal has finished.
+ */
+class PrivateIntensityBuffers {
+private:
+  /*! @brief Number of threads. */
+  const int_fast32_t _number_of_threads;
+
+  /*! @brief Number of subgrids. */
+  const size_t _number_of_subgrids;
+
+  /*! @brief Number of accumulator values in a single block. */
+  const size_t _block_size;
+
+  /*! @brief Maximum number of blocks a single thread can use. */
+  size_t _maximum_number_of_blocks;
+
+  /*! @brief Accumulator blocks, per thread and per subgrid (nullptr if the
+   *  thread has not traversed that subgrid yet). */
+  std::vector< double * > _blocks;
+
+  /*! @brief Number of blocks allocated by each thread since the last call to
+   *  reset_block_counters(). */
+  std::vector< size_t > _number_of_blocks;
+
+  /*! @brief Number of blocks that were allocated at the last call to
+   *  reset_block_counters(). */
+  size_t _number_of_used_blocks;
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param number_of_threads Number of threads.
+   * @param number_of_subgrids Number of subgrids.
+   * @param number_of_cells Number of cells in a single subgrid.
+   * @param maximum_number_of_blocks Maximum number of blocks a single thread
+   * can use.
+   */
+  inline PrivateIntensityBuffers(
+      const int_fast32_t number_of_threads, const size_t number_of_subgrids,
+      const size_t number_of_cells,
+      const size_t maximum_number_of_blocks =
+          PRIVATEINTENSITYBUFFERS_DEFAULT_MAXIMUM_NUMBER_OF_BLOCKS)
+      : _number_of_threads(number_of_threads),
+        _number_of_subgrids(number_of_subgrids),
+        _block_size(number_of_cells * PRIVATEINTENSITYBUFFERS_ACCUMULATOR_SIZE),
+        _maximum_number_of_blocks(maximum_number_of_blocks),
+        _blocks(number_of_threads * number_of_subgrids, nullptr),
+        _number_of_blocks(number_of_threads, 0), _number_of_used_blocks(0) {}
+
+  /**
+   * @brief Destructor.
+   */
+  inline ~PrivateIntensityBuffers() {
+    for (size_t i = 0; i < _blocks.size(); ++i) {
+      delete[] _blocks[i];
+    }
+  }
+
+  /**
+   * @brief Get the number of threads.
+   *
+   * @return Number of threads.
+   */
+  inline int_fast32_t get_number_of_threads() const {
+    return _number_of_threads;
+  }
+
+  /**
+   * @brief Set the maximum number of blocks a single thread can use.
+   *
+   * @param maximum_number_of_blocks Maximum number of blocks per thread.
+   */
+  inline void
+  set_maximum_number_of_blocks(const size_t maximum_number_of_blocks) {
+    _maximum_number_of_blocks = maximum_number_of_blocks;
+  }
+
+  /**
+   * @brief Get the accumulator block of the given thread for the given
+   * subgrid.
+   *
+   * The block is allocated and zeroed if it does not exist yet. This function
+   * should only be called by the thread that owns the block.
+   *
+   * @param thread_id Thread index.
+   * @param subgrid_index Subgrid index.
+   * @return Accumulator block, or nullptr if the block does not exist yet and
+   * the thread already uses the maximum number of blocks.
+   */
+  inline double *get_block(const int_fast32_t thread_id,
+                           const size_t subgrid_index) {
+
+    cmac_assert_message(thread_id >= 0 && thread_id < _number_of_threads,
+                        "Thread index out of range: %" PRIiFAST32
+                        " (number of threads: %" PRIiFAST32 ")",
+                        thread_id, _number_of_threads);
+    cmac_assert_message(subgrid_index < _number_of_subgrids,
+                        "Subgrid index out of range!");
+
+    double *&block = _blocks[thread_id * _number_of_subgrids + subgrid_index];
+    if (block == nullptr) {
+      if (_number_of_blocks[thread_id] >= _maximum_number_of_blocks) {
+        return nullptr;
+      }
+      block = new double[_block_size];
+      for (size_t i = 0; i < _block_size; ++i) {
+        block[i] = 0.;
+      }
+      ++_number_of_blocks[thread_id];
+    }
+    return block;
+  }
+
+  /**
+   * @brief Get the accumulator block of the given thread for the given
+   * subgrid, if it exists.
+   *
+   * @param thread_id Thread index.
+   * @param subgrid_index Subgrid index.
+   * @return Accumulator block, or nullptr if the thread never traversed the
+   * subgrid.
+   */
+  inline double *get_existing_block(const int_fast32_t thread_id,
+                                    const size_t subgrid_index) const {
+    return _blocks[thread_id * _number_of_subgrids + subgrid_index];
+  }
+
+  /**
+   * @brief Release the accumulator block of the given thread for the given
+   * subgrid.
+   *
+   * This function can be called by any thread, as long as no other thread
+   * accesses the same block at the same time.
+   *
+   * @param thread_id Thread index.
+   * @param subgrid_index Subgrid index.
+   */
+  inline void release_block(const int_fast32_t thread_id,
+                            const size_t subgrid_index) {
+    double *&block = _blocks[thread_id * _number_of_subgrids + subgrid_index];
+    delete[] block;
+    block = nullptr;
+  }
+
+  /**
+   * @brief Reset the given accumulator block.
+   *
+   * @param block Accumulator block.
+   */
+  inline void reset_block(double *block) const {
+    for (size_t i = 0; i < _block_size; ++i) {
+      block[i] = 0.;
+    }
+  }
+
+  /**
+   * @brief Get the total number of blocks allocated since the last call to
+   * reset_block_counters().
+   *
+   * @return Number of allocated blocks.
+   */
+  inline size_t get_number_of_blocks() const {
+    size_t number_of_blocks = 0;
+    for (int_fast32_t i = 0; i < _number_of_threads; ++i) {
+      number_of_blocks += _number_of_blocks[i];
+    }
+    return number_of_blocks;
+  }
+
+  /**
+   * @brief Store the number of allocated blocks and reset the counters.
+   *
+   * This should be called from serial code once traversal has finished and
+   * before the blocks are released, so that get_number_of_used_blocks() and
+   * get_used_memory_size() return the values for the last traversal step.
+   */
+  inline void reset_block_counters() {
+    _number_of_used_blocks = get_number_of_blocks();
+    for (int_fast32_t i = 0; i < _number_of_threads; ++i) {
+      _number_of_blocks[i] = 0;
+    }
+  }
+
+  /**
+   * @brief Get the number of blocks that were allocated at the last call to
+   * reset_block_counters().
+   *
+   * @return Number of blocks used during the last traversal step.
+   */
+  inline size_t get_number_of_used_blocks() const {
+    return _number_of_used_blocks;
+  }
+
+  /**
+   * @brief Get the size in memory of the buffers.
+   *
+   * @return Size in memory (in bytes).
+   */
+  inline size_t get_memory_size() const {
+    return sizeof(PrivateIntensityBuffers) +
+           _blocks.size() * sizeof(double *) +
+           get_number_of_blocks() * _block_size * sizeof(double);
+  }
+
+  /**
+   * @brief Get the size in memory of the buffers at the last call to
+   * reset_block_counters().
+   *
+   * @return Size in memory during the last traversal step (in bytes).
+   */
+  inline size_t get_used_memory_size() const {
+    return sizeof(PrivateIntensityBuffers) +
+           _blocks.size() * sizeof(double *) +
+           _number_of_used_blocks * _block_size * sizeof(double);
+  }
+};
+
+#endif // PRIVATEINTENSITYBUFFERS_HPP
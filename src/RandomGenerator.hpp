@@ -26,203 +26,98 @@
 #ifndef RANDOMGENERATOR_HPP
 #define RANDOMGENERATOR_HPP
 
+#include "Configuration.hpp"
+#include "Error.hpp"
 #include "RestartReader.hpp"
 #include "RestartWriter.hpp"
 
 #include <cstdint>
+#include <string>
+
+#if defined(USE_PHILOX_RANDOM_GENERATOR)
+#include "PhiloxRandomGenerator.hpp"
+/*! @brief Random number generator algorithm used by RandomGenerator. */
+typedef PhiloxRandomGenerator RandomGeneratorAlgorithm;
+/*! @brief Name of the random number generator algorithm. */
+#define RANDOMGENERATOR_ALGORITHM_NAME "Philox4x32-10"
+/*! @brief Does the restart file start with the algorithm name? */
+#define RANDOMGENERATOR_TAGGED_RESTART
+#elif defined(USE_XOSHIRO_RANDOM_GENERATOR)
+#include "Xoshiro256PlusPlusRandomGenerator.hpp"
+/*! @brief Random number generator algorithm used by RandomGenerator. */
+typedef Xoshiro256PlusPlusRandomGenerator RandomGeneratorAlgorithm;
+/*! @brief Name of the random number generator algorithm. */
+#define RANDOMGENERATOR_ALGORITHM_NAME "xoshiro256++"
+/*! @brief Does the restart file start with the algorithm name? */
+#define RANDOMGENERATOR_TAGGED_RESTART
+#else
+#include "RanluxRandomGenerator.hpp"
+/*! @brief Random number generator algorithm used by RandomGenerator. */
+typedef RanluxRandomGenerator RandomGeneratorAlgorithm;
+/*! @brief Name of the random number generator algorithm. */
+#define RANDOMGENERATOR_ALGORITHM_NAME "ranlxs2"
+#endif
+
+/*! @brief Marker that precedes the algorithm name in the restart file of a
+ *  RandomGenerator that does not use the default ranlxs2 algorithm. Restart
+ *  files for the default algorithm are untagged and start with the first
+ *  ranlxs2 state variable, a double in the range [0, 1[, which never has this
+ *  bit pattern. */
+#define RANDOMGENERATOR_RESTART_TAG 0x434d41435241544eull
 
 /**
- * @brief Own implementation of the GSL ranlxd2 random generator.
+ * @brief Random number generator used throughout the code.
  *
- * Based on http://git.savannah.gnu.org/cgit/gsl.git/tree/rng/ranlxd.c.
+ * The underlying algorithm is selected at compile time (CMake option
+ * RANDOM_GENERATOR):
+ *  - RANLUX (default): our own implementation of the GSL ranlxs2 generator
+ *    (RanluxRandomGenerator)
+ *  - XOSHIRO: the xoshiro256++ generator (Xoshiro256PlusPlusRandomGenerator)
+ *  - PHILOX: the counter-based Philox4x32-10 generator (PhiloxRandomGenerator)
+ *
+ * All algorithms provide the same interface: single random numbers using
+ * get_uniform_random_double(), batches of random numbers using
+ * fill_uniform(), seeding and restarting. Generators with different seeds
+ * (e.g. the per thread generators, which use the seed plus the thread index)
+ * produce independent streams.
  */
-class RandomGenerator {
+class RandomGenerator : public RandomGeneratorAlgorithm {
 private:
-  /*! @brief ranlxd2 state variables. */
-  double _xdbl[12];
-
-  /*! @brief ranlxd2 state variables. */
-  double _carry;
-
-  /*! @brief ranlxd2 state variables. */
-  uint_fast32_t _ir;
-
-  /*! @brief ranlxd2 state variables. */
-  uint_fast32_t _jr;
-
-  /*! @brief ranlxd2 state variables. */
-  uint_fast32_t _ir_old;
-
-  /*! @brief ranlxd2 state variables. */
-  uint_fast32_t _pr;
-
   /**
-   * @brief GSL RANLUX_STEP macro.
+   * @brief Check that the given restart file was written by a RandomGenerator
+   * that uses the same algorithm.
    *
-   * @param xdbl Pointer to the xdbl array.
-   * @param x1 Reference to either y1, y2 or y3 in increment_state.
-   * @param x2 Reference to either y1, y2 or y3 in increment_state.
-   * @param i1 Index in the xdbl array.
-   * @param i2 Index in the xdbl array.
-   * @param i3 Index in the xdbl array.
-   */
-  static inline void ranlux_step(double *xdbl, double &x1, double &x2,
-                                 uint_fast32_t i1, uint_fast32_t i2,
-                                 uint_fast32_t i3) {
-    x1 = xdbl[i1] - xdbl[i2];
-    if (x2 < 0) {
-      x1 -= (1.0 / 281474976710656.0);
-      x2 += 1;
-    }
-    xdbl[i3] = x2;
-  }
-
-  /**
-   * @brief Increment the internal state of the generator.
-   */
-  inline void increment_state() {
-    int_fast32_t k, kmax;
-    double y1, y2, y3;
-
-    double *xdbl = _xdbl;
-    double carry = _carry;
-    uint_fast32_t ir = _ir;
-    uint_fast32_t jr = _jr;
-
-    for (k = 0; ir > 0; ++k) {
-      y1 = xdbl[jr] - xdbl[ir];
-      y2 = y1 - carry;
-      if (y2 < 0) {
-        carry = (1.0 / 281474976710656.0);
-        y2 += 1;
-      } else {
-        carry = 0;
-      }
-      xdbl[ir] = y2;
-      ir = (ir + 1) % 12;
-      jr = (jr + 1) % 12;
-    }
-
-    kmax = _pr - 12;
-
-    for (; k <= kmax; k += 12) {
-      y1 = xdbl[7] - xdbl[0];
-      y1 -= carry;
-
-      ranlux_step(xdbl, y2, y1, 8, 1, 0);
-      ranlux_step(xdbl, y3, y2, 9, 2, 1);
-      ranlux_step(xdbl, y1, y3, 10, 3, 2);
-      ranlux_step(xdbl, y2, y1, 11, 4, 3);
-      ranlux_step(xdbl, y3, y2, 0, 5, 4);
-      ranlux_step(xdbl, y1, y3, 1, 6, 5);
-      ranlux_step(xdbl, y2, y1, 2, 7, 6);
-      ranlux_step(xdbl, y3, y2, 3, 8, 7);
-      ranlux_step(xdbl, y1, y3, 4, 9, 8);
-      ranlux_step(xdbl, y2, y1, 5, 10, 9);
-      ranlux_step(xdbl, y3, y2, 6, 11, 10);
-
-      if (y3 < 0) {
-        carry = (1.0 / 281474976710656.0);
-        y3 += 1;
-      } else {
-        carry = 0;
-      }
-      xdbl[11] = y3;
-    }
-
-    kmax = _pr;
-
-    for (; k < kmax; ++k) {
-      y1 = xdbl[jr] - xdbl[ir];
-      y2 = y1 - carry;
-      if (y2 < 0) {
-        carry = (1.0 / 281474976710656.0);
-        y2 += 1;
-      } else {
-        carry = 0;
-      }
-      xdbl[ir] = y2;
-      ir = (ir + 1) % 12;
-      jr = (jr + 1) % 12;
-    }
-
-    _ir = ir;
-    _ir_old = ir;
-    _jr = jr;
-    _carry = carry;
-  }
-
-public:
-  /**
-   * @brief Set a new seed for the random generator.
+   * Restart files without algorithm tag were written by the default ranlxs2
+   * algorithm (this includes all restart files written before alternative
+   * algorithms were added).
    *
-   * @param seed New seed.
+   * @param restart_reader Restart file to read from.
+   * @return Same restart file, positioned at the start of the algorithm
+   * specific data.
    */
-  inline void set_seed(int_fast32_t seed) {
-    int_fast32_t ibit, jbit, i, k, m, xbit[31];
-    double x, y;
-
-    if (seed == 0) {
-      // the default seed is 1, not 0
-      seed = 1;
+  static inline RestartReader &
+  check_restart_file(RestartReader &restart_reader) {
+    std::string name = "ranlxs2";
+    if (restart_reader.peek< uint64_t >() == RANDOMGENERATOR_RESTART_TAG) {
+      restart_reader.read< uint64_t >();
+      name = restart_reader.read< std::string >();
     }
-
-    // Allowed seeds for ranlxs are 0 .. 2^31-1
-    i = seed & 0x7FFFFFFFUL;
-
-    for (k = 0; k < 31; ++k) {
-      xbit[k] = i % 2;
-      i /= 2;
-    }
-
-    ibit = 0;
-    jbit = 18;
-
-    for (k = 0; k < 12; ++k) {
-      x = 0;
-
-      for (m = 1; m <= 48; ++m) {
-        y = (double)((xbit[ibit] + 1) % 2);
-        x += x + y;
-        xbit[ibit] = (xbit[ibit] + xbit[jbit]) % 2;
-        ibit = (ibit + 1) % 31;
-        jbit = (jbit + 1) % 31;
-      }
-      _xdbl[k] = (1.0 / 281474976710656.0) * x;
+    if (name != RANDOMGENERATOR_ALGORITHM_NAME) {
+      cmac_error("Restart file was written using the %s random generator, "
+                 "but this version of the code uses the %s random generator!",
+                 name.c_str(), RANDOMGENERATOR_ALGORITHM_NAME);
     }
-
-    _carry = 0;
-    _ir = 11;
-    _jr = 7;
-    _ir_old = 0;
-    // we implement the ranlxs2 generator
-    _pr = 397;
+    return restart_reader;
   }
 
+public:
   /**
    * @brief Constructor.
    *
    * @param seed Initial seed for the random number generator.
    */
-  inline RandomGenerator(int_fast32_t seed = 42) { set_seed(seed); }
-
-  /**
-   * @brief Get a uniform random double precision floating point value in the
-   * range [0., 1.].
-   *
-   * Note that this function changes the internal state of the RandomGenerator.
-   *
-   * @return Random double precision floating point value.
-   */
-  inline double get_uniform_random_double() {
-    _ir = (_ir + 1) % 12;
-
-    if (_ir == _ir_old) {
-      increment_state();
-    }
-
-    return _xdbl[_ir];
-  }
+  inline RandomGenerator(int_fast32_t seed = 42)
+      : RandomGeneratorAlgorithm(seed) {}
 
   /**
    * @brief Get a random integer value.
@@ -236,18 +131,21 @@ public:
   /**
    * @brief Write the random number generator to the given restart file.
    *
+   * For the default ranlxs2 algorithm, the restart file layout is the same as
+   * that of the original ranlxs2 generator, so that older restart files can
+   * still be read. Other algorithms write a tag and their name first.
+   *
    * @param restart_writer RestartWriter to use.
    */
   inline void write_restart_file(RestartWriter &restart_writer) const {
 
-    for (uint_fast8_t i = 0; i < 12; ++i) {
-      restart_writer.write(_xdbl[i]);
-    }
-    restart_writer.write(_carry);
-    restart_writer.write(_ir);
-    restart_writer.write(_jr);
-    restart_writer.write(_ir_old);
-    restart_writer.write(_pr);
+#ifdef RANDOMGENERATOR_TAGGED_RESTART
+    const uint64_t tag = RANDOMGENERATOR_RESTART_TAG;
+    restart_writer.write(tag);
+    const std::string name = RANDOMGENERATOR_ALGORITHM_NAME;
+    restart_writer.write(name);
+#endif
+    RandomGeneratorAlgorithm::write_restart_file(restart_writer);
   }
 
   /**
@@ -256,17 +154,7 @@ public:
    * @param restart_reader Restart file to read from.
    */
   inline RandomGenerator(RestartReader &restart_reader)
-      : _xdbl{restart_reader.read< double >(), restart_reader.read< double >(),
-              restart_reader.read< double >(), restart_reader.read< double >(),
-              restart_reader.read< double >(), restart_reader.read< double >(),
-              restart_reader.read< double >(), restart_reader.read< double >(),
-              restart_reader.read< double >(), restart_reader.read< double >(),
-              restart_reader.read< double >(), restart_reader.read< double >()},
-        _carry(restart_reader.read< double >()),
-        _ir(restart_reader.read< uint_fast32_t >()),
-        _jr(restart_reader.read< uint_fast32_t >()),
-        _ir_old(restart_reader.read< uint_fast32_t >()),
-        _pr(restart_reader.read< uint_fast32_t >()) {}
+      : RandomGeneratorAlgorithm(check_restart_file(restart_reader)) {}
 };
 
 #endif // RANDOMGENERATOR_HPP
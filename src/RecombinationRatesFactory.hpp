@@ -34,6 +34,7 @@
 #include "VernerRecombinationRates.hpp"
 #include "BenjaminRecombinationRates.hpp"
 #include "ChiantiRecombinationRates.hpp"
+#include "TabulatedRecombinationRates.hpp"
 
 
 /**
@@ -50,6 +51,11 @@ public:
    *  - Verner: Implementation that uses the Verner & Ferland (1996)
    *    recombination rates.
    *
+   * If "RecombinationRates:tabulate" is set to true (default: false), the
+   * chosen implementation is wrapped in a TabulatedRecombinationRates object
+   * that replaces the evaluation of the rates by a linear interpolation on a
+   * precomputed temperature table.
+   *
    * @param params ParameterFile to read from.
    * @param log Log to write logging info to.
    * @return Pointer to a newly created RecombinationRates implementation.
@@ -65,17 +71,24 @@ public:
       log->write_info("Requested RecombinationRates type: ", type);
     }
 
+    RecombinationRates *recombination_rates;
     if (type == "FixedValue") {
-      return new FixedValueRecombinationRates(params);
+      recombination_rates = new FixedValueRecombinationRates(params);
     } else if (type == "Verner") {
-      return new VernerRecombinationRates();
+      recombination_rates = new VernerRecombinationRates();
     } else if (type == "Benjamin") {
-      return new BenjaminRecombinationRates();
+      recombination_rates = new BenjaminRecombinationRates();
     } else if (type == "Chianti") {
-      return new ChiantiRecombinationRates();
+      recombination_rates = new ChiantiRecombinationRates();
     } else {
       cmac_error("Unknown RecombinationRates type: \"%s\"!", type.c_str());
       return nullptr;
     }
+
+    if (params.get_value< bool >("RecombinationRates:tabulate", false)) {
+      recombination_rates =
+          new TabulatedRecombinationRates(recombination_rates, params, log);
+    }
+    return recombination_rates;
   }
 };
@@ -26,6 +26,8 @@
 #ifndef RESTARTMANAGER_HPP
 #define RESTARTMANAGER_HPP
 
+#include "CheckpointReader.hpp"
+#include "CheckpointWriter.hpp"
 #include "Log.hpp"
 #include "ParameterFile.hpp"
 #include "RestartReader.hpp"
@@ -38,6 +40,13 @@
 #include <fstream>
 #include <string>
 
+/*! @brief Marker that is written to the restart file in front of the grid if
+ *  the cell arrays are stored in a separate binary checkpoint file. Restart
+ *  files without this marker contain the full grid. The marker has the bit
+ *  pattern of a NaN, so that it can never be mistaken for the first value of
+ *  the grid restart data (the x coordinate of the box anchor). */
+#define RESTARTMANAGER_CHECKPOINT_TAG 0x7ff8434d41434350ull
+
 /**
  * @brief General manager for restart files.
  */
@@ -61,6 +70,9 @@ private:
   /*! @brief Command to execute when the simulation is stopped. */
   const std::string _resubmit_command;
 
+  /*! @brief Write large arrays to a separate binary checkpoint file? */
+  const bool _binary_checkpoint;
+
   /*! @brief Current number of backup files in the history. */
   uint_fast32_t _number_of_backups;
 
@@ -76,6 +88,29 @@ private:
   /*! @brief Timer use to measure the total elapsed hardware time. */
   Timer _total_timer;
 
+  /**
+   * @brief Back up the binary checkpoint file with the given name.
+   *
+   * Restart files in the history that were written before binary checkpoints
+   * were enabled do not have a corresponding checkpoint file, so a missing
+   * checkpoint file is not an error.
+   *
+   * @param old_name Name of the checkpoint file.
+   * @param new_name New name for the checkpoint file.
+   */
+  inline static void back_up_checkpoint_file(const std::string old_name,
+                                             const std::string new_name) {
+
+    std::ifstream old_file(old_name);
+    if (!old_file.good()) {
+      return;
+    }
+    old_file.close();
+    if (std::rename(old_name.c_str(), new_name.c_str()) != 0) {
+      cmac_error("Couldn't back up checkpoint file \"%s\"!", old_name.c_str());
+    }
+  }
+
 public:
   /**
    * @brief Constructor.
@@ -89,15 +124,19 @@ public:
    * @param maximum_time Maximum time the simulation can run (in s).
    * @param resubmit_command Command that is executed when the simulation
    * prematurely stops.
+   * @param binary_checkpoint Write large arrays to a separate binary
+   * checkpoint file?
    */
   inline RestartManager(const std::string path, const double output_interval,
                         const uint_fast32_t maximum_number_of_backups,
                         const double maximum_time,
-                        const std::string resubmit_command)
+                        const std::string resubmit_command,
+                        const bool binary_checkpoint = false)
       : _path(path), _output_interval(output_interval),
         _maximum_number_of_backups(maximum_number_of_backups),
         _maximum_time(maximum_time), _resubmit_command(resubmit_command),
-        _number_of_backups(0), _number_of_restarts(0), _stop_file(false) {}
+        _binary_checkpoint(binary_checkpoint), _number_of_backups(0),
+        _number_of_restarts(0), _stop_file(false) {}
 
   /**
    * @brief ParameterFile constructor.
@@ -112,6 +151,8 @@ public:
    *  - maximum time: Maximum time the simulation can run (default: 118 h).
    *  - resubmit command: Command that is executed when the simulation is
    *    prematurely stopped (default: "").
+   *  - binary checkpoint: Write the large arrays to a separate binary
+   *    checkpoint file that is written and read in parallel (default: false).
    *
    * @param params ParameterFile to read from.
    */
@@ -125,7 +166,17 @@ public:
             params.get_physical_value< QUANTITY_TIME >(
                 "RestartManager:maximum time", "118. h"),
             params.get_value< std::string >("RestartManager:resubmit command",
-                                            "")) {}
+                                            ""),
+            params.get_value< bool >("RestartManager:binary checkpoint",
+                                     false)) {}
+
+  /**
+   * @brief Write large arrays to a separate binary checkpoint file?
+   *
+   * @return True if a CheckpointWriter should be used alongside the
+   * RestartWriter.
+   */
+  inline bool use_binary_checkpoint() const { return _binary_checkpoint; }
 
   /**
    * @brief Get a restart file for reading.
@@ -155,6 +206,41 @@ public:
     return get_restart_reader(_path, log);
   }
 
+  /**
+   * @brief Get a binary checkpoint file for reading.
+   *
+   * @param path Path to the folder containing the file.
+   * @param log Log to write logging info to.
+   * @return Pointer to a newly created CheckpointReader. Memory management of
+   * the pointer transfers to the caller.
+   */
+  inline static CheckpointReader *get_checkpoint_reader(const std::string path,
+                                                        Log *log = nullptr) {
+    std::string filename = path + "/restart.grid";
+    if (log != nullptr) {
+      log->write_status("Reading binary checkpoint file ", filename, ".");
+    }
+    return new CheckpointReader(filename);
+  }
+
+  /**
+   * @brief Get a binary checkpoint file for writing.
+   *
+   * This function should be called after get_restart_writer(), which takes
+   * care of backing up the old checkpoint file.
+   *
+   * @param log Log to write logging info to.
+   * @return Pointer to a newly created CheckpointWriter. Memory management of
+   * the pointer transfers to the caller.
+   */
+  inline CheckpointWriter *get_checkpoint_writer(Log *log = nullptr) const {
+    const std::string filename = _path + "/restart.grid";
+    if (log != nullptr) {
+      log->write_status("Writing binary checkpoint file ", filename, ".");
+    }
+    return new CheckpointWriter(filename);
+  }
+
   /**
    * @brief Get a restart file for writing.
    *
@@ -179,12 +265,23 @@ public:
           cmac_error("Couldn't back up restart file \"%s\"!",
                      old_name.str().c_str());
         }
+        if (_binary_checkpoint) {
+          std::stringstream old_grid_name;
+          old_grid_name << _path << "/restart.grid." << (i - 1) << ".back";
+          std::stringstream new_grid_name;
+          new_grid_name << _path << "/restart.grid." << i << ".back";
+          back_up_checkpoint_file(old_grid_name.str(), new_grid_name.str());
+        }
       }
       if (_number_of_restarts > 0) {
         std::string new_name = _path + "/restart.0.back";
         if (std::rename(filename.c_str(), new_name.c_str()) != 0) {
           cmac_error("Couldn't back up restart file \"%s\"!", filename.c_str());
         }
+        if (_binary_checkpoint) {
+          back_up_checkpoint_file(_path + "/restart.grid",
+                                  _path + "/restart.grid.0.back");
+        }
         if (_number_of_backups < _maximum_number_of_backups) {
           ++_number_of_backups;
         }
@@ -74,6 +74,20 @@ public:
 #endif
     return value;
   }
+
+  /**
+   * @brief Read a value of a basic template data type without advancing the
+   * position in the restart file.
+   *
+   * @return Value that will be returned by the next call to read().
+   */
+  template < typename _datatype_ > _datatype_ peek() {
+    _datatype_ value;
+    const std::streampos position = _file.tellg();
+    _file.read(reinterpret_cast< char * >(&value), sizeof(_datatype_));
+    _file.seekg(position);
+    return value;
+  }
 };
 
 /**
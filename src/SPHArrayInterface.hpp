@@ -32,8 +32,16 @@
 #include "DensityFunction.hpp"
 #include "DensityGridWriter.hpp"
 #include "Octree.hpp"
+#include "SPHKernelIntegrals.hpp"
 #include "TimeLogger.hpp"
 
+class SPHScatterMapping;
+
+/*! @brief Maximum ratio of the total leaf volume of a refitted Octree and the
+ *  total leaf volume of the original Octree before the Octree is rebuilt (see
+ *  Octree::refit()). */
+#define SPHARRAYINTERFACE_MAXIMUM_REFIT_VOLUME_RATIO 1.
+
 /**
  * @brief Types of mapping that can be used to map SPH particles to grid cells.
  */
@@ -84,16 +92,23 @@ private:
   /*! @brief Neutral fractions on the positions of the SPH particles. */
   std::vector< double > _neutral_fractions;
 
-  /*! @brief Grid of pre-computed cell densities. */
-  std::vector< std::vector< std::vector< double > > > _density_values;
+  /*! @brief Pre-computed kernel integrals (only used for the Petkova
+   *  mapping). */
+  SPHKernelIntegrals *_kernel_integrals;
 
   /*! @brief Octree used to speed up neighbour searching. */
   Octree *_octree;
 
+  /*! @brief Scatter mapping used instead of the cell based mapping (if
+   *  enabled). */
+  SPHScatterMapping *_scatter_mapping;
+
   /*! @brief Time log used to register time consumption in various parts of the
    *  algorithm. */
   TimeLogger _time_log;
 
+  void set_box();
+
   /**
    * @brief Get the SPHArrayMappingType corresponding to the given type name
    * string.
@@ -252,13 +267,16 @@ private:
 public:
   SPHArrayInterface(const double unit_length_in_SI,
                     const double unit_mass_in_SI,
-                    const std::string mapping_type);
+                    const std::string mapping_type,
+                    const bool use_scatter_mapping = false);
   SPHArrayInterface(const double unit_length_in_SI,
                     const double unit_mass_in_SI, const double *box_anchor,
-                    const double *box_sides, const std::string mapping_type);
+                    const double *box_sides, const std::string mapping_type,
+                    const bool use_scatter_mapping = false);
   SPHArrayInterface(const double unit_length_in_SI,
                     const double unit_mass_in_SI, const float *box_anchor,
-                    const float *box_sides, const std::string mapping_type);
+                    const float *box_sides, const std::string mapping_type,
+                    const bool use_scatter_mapping = false);
   ~SPHArrayInterface();
 
   // DensityFunction functionality
@@ -270,12 +288,20 @@ public:
   void reset(const float *x, const float *y, const float *z, const float *h,
              const float *m, const size_t npart);
 
+  void update(const double *x, const double *y, const double *z,
+              const double *h, const double *m, const size_t npart);
+  void update(const double *x, const double *y, const double *z,
+              const float *h, const float *m, const size_t npart);
+  void update(const float *x, const float *y, const float *z, const float *h,
+              const float *m, const size_t npart);
+
   Octree *get_octree();
 
   // DensityMapping get_dens_map(){return _dens_map;}
 
   virtual void initialize();
   virtual DensityValues operator()(const Cell &cell);
+  virtual const SPHScatterMapping *get_scatter_mapping() const;
 
   void gridding();
 
@@ -310,7 +336,7 @@ public:
   inline double get_gridded_density_value(const uint_fast32_t i,
                                           const uint_fast32_t j,
                                           const uint_fast32_t k) const {
-    return _density_values[i][j][k];
+    return _kernel_integrals->get_gridded_density_value(i, j, k);
   }
 
   virtual void write(DensitySubGridCreator< DensitySubGrid > &grid_creator,
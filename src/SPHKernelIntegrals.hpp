@@ -0,0 +1,79 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017, 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file SPHKernelIntegrals.hpp
+ *
+ * @brief Tabulated integrals of the cubic spline kernel over the faces of a
+ * cell, used for the mass conserving Petkova et al. (2018) mapping.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef SPHKERNELINTEGRALS_HPP
+#define SPHKERNELINTEGRALS_HPP
+
+#include "Cell.hpp"
+#include "CoordinateVector.hpp"
+
+#include <cinttypes>
+#include <vector>
+
+/**
+ * @brief Tabulated integrals of the cubic spline kernel over the faces of a
+ * cell, used for the mass conserving Petkova et al. (2018) mapping.
+ *
+ * The kernel has a compact support of 2h, with h the smoothing length that is
+ * passed on to the various functions.
+ */
+class SPHKernelIntegrals {
+private:
+  /*! @brief Grid of pre-computed vertex integrals. */
+  std::vector< std::vector< std::vector< double > > > _density_values;
+
+public:
+  SPHKernelIntegrals();
+
+  void gridding();
+
+  double gridded_integral(const double phi, const double cosphi,
+                          const double r0_old, const double R_0_old,
+                          const double h_old) const;
+
+  static double full_integral(const double phi, const double cosphi,
+                              const double r0, const double R_0,
+                              const double h);
+
+  double mass_contribution(const Cell &cell, const CoordinateVector<> particle,
+                           const double h) const;
+
+  /**
+   * @brief Get the gridded density value for the given indices.
+   *
+   * @param i First index.
+   * @param j Second index.
+   * @param k Third index.
+   * @return Corresponding gridded density value.
+   */
+  inline double get_gridded_density_value(const uint_fast32_t i,
+                                          const uint_fast32_t j,
+                                          const uint_fast32_t k) const {
+    return _density_values[i][j][k];
+  }
+};
+
+#endif // SPHKERNELINTEGRALS_HPP
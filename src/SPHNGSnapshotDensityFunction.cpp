@@ -32,6 +32,7 @@
 #include "Octree.hpp"
 #include "ParameterFile.hpp"
 #include "SPHNGSnapshotUtilities.hpp"
+#include "SPHScatterMapping.hpp"
 #include "UnitConverter.hpp"
 
 #include <cfloat>
@@ -92,6 +93,9 @@ double SPHNGSnapshotDensityFunction::kernel(const double q, const double h) {
  * file?
  * @param binary_dump_name Name of the file in which the particle positions and
  * densities are dumped.
+ * @param use_scatter_mapping Deposit the particles onto the grid using an
+ * SPHScatterMapping instead of evaluating the density in every cell using an
+ * Octree neighbour search?
  * @param log Log to write logging info to.
  */
 SPHNGSnapshotDensityFunction::SPHNGSnapshotDensityFunction(
@@ -99,8 +103,10 @@ SPHNGSnapshotDensityFunction::SPHNGSnapshotDensityFunction(
     const bool write_stats, const uint_fast32_t stats_numbin,
     const double stats_mindist, const double stats_maxdist,
     const std::string stats_filename, const bool use_new_algorithm,
-    const bool binary_dump, const std::string binary_dump_name, Log *log)
+    const bool binary_dump, const std::string binary_dump_name,
+    const bool use_scatter_mapping, Log *log)
     : _use_new_algorithm(use_new_algorithm), _octree(nullptr),
+      _use_scatter_mapping(use_scatter_mapping), _scatter_mapping(nullptr),
       _initial_temperature(initial_temperature),
       _stats_numbin(write_stats ? stats_numbin : 0),
       _stats_mindist(stats_mindist), _stats_maxdist(stats_maxdist),
@@ -500,6 +506,9 @@ SPHNGSnapshotDensityFunction::SPHNGSnapshotDensityFunction(
  *    densities (default: false)?
  *  - binary dump name: Name of the file in which to dump the particle positions
  *    and densities.
+ *  - use scatter mapping: Deposit the particles onto the grid instead of
+ *    gathering them for every cell (only works for subgrid based grids;
+ *    default: false)?
  *
  * @param params ParameterFile to read from.
  * @param log Log to write logging info to.
@@ -523,23 +532,37 @@ SPHNGSnapshotDensityFunction::SPHNGSnapshotDensityFunction(
           params.get_value< bool >("DensityFunction:binary dump", false),
           params.get_value< std::string >("DensityFunction:binary dump name",
                                           ""),
+          params.get_value< bool >("DensityFunction:use scatter mapping",
+                                   false),
           log) {}
 
 /**
  * @brief Destructor.
  *
- * Clean up the octree.
+ * Clean up the octree and scatter mapping.
  */
 SPHNGSnapshotDensityFunction::~SPHNGSnapshotDensityFunction() {
   delete _octree;
+  delete _scatter_mapping;
 }
 
 /**
  * @brief This routine constructs the internal Octree that is used for neighbour
  * finding.
+ *
+ * If the scatter mapping is used, we create the SPHScatterMapping instead. The
+ * Octree is then only created if neighbour statistics are requested.
  */
 void SPHNGSnapshotDensityFunction::initialize() {
 
+  if (_use_scatter_mapping) {
+    _scatter_mapping = new SPHScatterMapping(_positions, _masses,
+                                             _smoothing_lengths, 1.);
+    if (_stats_numbin == 0) {
+      return;
+    }
+  }
+
   _octree = new Octree(_positions, _partbox, false);
   std::vector< double > h2s = _smoothing_lengths;
   for (uint_fast32_t i = 0; i < _smoothing_lengths.size(); ++i) {
@@ -998,6 +1021,9 @@ double SPHNGSnapshotDensityFunction::mass_contribution(
 /**
  * @brief Function that gives the density for a given cell -> Maya.
  *
+ * If the scatter mapping is used, this function only returns background
+ * values; the actual densities are set by SPHScatterMapping::deposit().
+ *
  * @param cell Geometrical information about the cell.
  * @return Initial physical field values for that cell.
  */
@@ -1005,7 +1031,16 @@ DensityValues SPHNGSnapshotDensityFunction::operator()(const Cell &cell) {
 
   DensityValues values;
 
-  if (_use_new_algorithm) {
+  if (_use_scatter_mapping) {
+
+    values.set_number_density(0.);
+    values.set_temperature(_initial_temperature);
+    values.set_ionic_fraction(ION_H_n, 1.e-6);
+#ifdef HAS_HELIUM
+    values.set_ionic_fraction(ION_He_n, 1.e-6);
+#endif
+
+  } else if (_use_new_algorithm) {
 
     CoordinateVector<> position = cell.get_cell_midpoint();
 
@@ -1024,20 +1059,16 @@ DensityValues SPHNGSnapshotDensityFunction::operator()(const Cell &cell) {
     // Find the neighbours that are contained inside of a sphere of centre the
     // cell midpoint
     // and radius given by the distance to the furthest vertex.
-    std::vector< uint_fast32_t > ngbs =
-        _octree->get_ngbs_sphere(position, radius);
-    const size_t numngbs = ngbs.size();
-
     double density = 0.;
 
     // Loop over all the neighbouring particles and calculate their mass
     // contributions.
-    for (size_t i = 0; i < numngbs; i++) {
-      const uint_fast32_t index = ngbs[i];
-      const double h = _smoothing_lengths[index];
-      const CoordinateVector<> particle = _positions[index];
-      density += mass_contribution(cell, particle, h) * _masses[index];
-    }
+    _octree->for_each_ngb_sphere(
+        position, radius, [&](const uint_fast32_t index) {
+          const double h = _smoothing_lengths[index];
+          const CoordinateVector<> particle = _positions[index];
+          density += mass_contribution(cell, particle, h) * _masses[index];
+        });
 
     // Divide the cell mass by the cell volume to get density.
     density = density / cell.get_volume();
@@ -1057,17 +1088,14 @@ DensityValues SPHNGSnapshotDensityFunction::operator()(const Cell &cell) {
     const CoordinateVector<> position = cell.get_cell_midpoint();
 
     double density = 0.;
-    std::vector< uint_fast32_t > ngbs = _octree->get_ngbs(position);
-    const size_t numngbs = ngbs.size();
-    for (size_t i = 0; i < numngbs; ++i) {
-      const uint_fast32_t index = ngbs[i];
+    _octree->for_each_ngb(position, [&](const uint_fast32_t index) {
       const double r = (position - _positions[index]).norm();
       const double h = _smoothing_lengths[index];
       const double q = r / h;
       const double m = _masses[index];
       const double splineval = m * kernel(q, h);
       density += splineval;
-    }
+    });
 
     // convert density to particle density (assuming hydrogen only)
     values.set_number_density(density / 1.6737236e-27);
@@ -1082,3 +1110,14 @@ DensityValues SPHNGSnapshotDensityFunction::operator()(const Cell &cell) {
 
   return values;
 }
+
+/**
+ * @brief Get the scatter mapping that should be used to set the densities.
+ *
+ * @return Pointer to the SPHScatterMapping, or a null pointer if the gather
+ * mapping is used.
+ */
+const SPHScatterMapping *
+SPHNGSnapshotDensityFunction::get_scatter_mapping() const {
+  return _scatter_mapping;
+}
@@ -38,6 +38,7 @@
 class Log;
 class Octree;
 class ParameterFile;
+class SPHScatterMapping;
 
 /**
  * @brief DensityFunction implementation that reads a density field from an
@@ -63,6 +64,13 @@ private:
   /*! @brief Octree used to speed up neighbour finding. */
   Octree *_octree;
 
+  /*! @brief Deposit the particles onto the grid using an SPHScatterMapping? */
+  const bool _use_scatter_mapping;
+
+  /*! @brief Scatter mapping used instead of the Octree based mapping (if
+   *  enabled). */
+  SPHScatterMapping *_scatter_mapping;
+
   /*! @brief Initial temperature of the gas (in K). */
   const double _initial_temperature;
 
@@ -96,7 +104,7 @@ public:
       const double stats_mindist, const double stats_maxdist,
       const std::string stats_filename, const bool use_new_algorithm = false,
       const bool binary_dump = false, const std::string binary_dump_name = "",
-      Log *log = nullptr);
+      const bool use_scatter_mapping = false, Log *log = nullptr);
 
   SPHNGSnapshotDensityFunction(ParameterFile &params, Log *log = nullptr);
 
@@ -109,6 +117,8 @@ public:
   double get_smoothing_length(uint_fast32_t index);
 
   virtual DensityValues operator()(const Cell &cell);
+
+  virtual const SPHScatterMapping *get_scatter_mapping() const;
 };
 
 #endif // SPHNGSNAPSHOTDENSITYFUNCTION_HPP
@@ -0,0 +1,636 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file SPHScatterMapping.hpp
+ *
+ * @brief Particle based (scatter) mapping of SPH particles onto a subgrid
+ * based grid.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#ifndef SPHSCATTERMAPPING_HPP
+#define SPHSCATTERMAPPING_HPP
+
+#include "CubicSplineKernel.hpp"
+#include "CuboidCell.hpp"
+#include "DensitySubGridCreator.hpp"
+#include "SPHKernelIntegrals.hpp"
+
+#include <cmath>
+#include <tuple>
+#include <vector>
+
+/**
+ * @brief Particle based (scatter) mapping of SPH particles onto a subgrid
+ * based grid.
+ *
+ * The default way of mapping SPH particles onto a grid is by gathering: for
+ * every cell, we look for the neighbouring particles in an Octree and
+ * integrate or evaluate their kernels. For large snapshots, the neighbour
+ * searches dominate the cost. This class does the opposite: every particle
+ * deposits its mass into the cells overlapped by its kernel. The cell indices
+ * follow directly from the particle position and smoothing length, so no
+ * neighbour search is required.
+ *
+ * For kernels that only overlap with a few cells, the fraction of the kernel
+ * that overlaps with a cell is computed using the tabulated Petkova et al.
+ * (2018) integrals. These integrals are expensive, so for larger kernels we
+ * instead evaluate the kernel on a regular grid of sample points within each
+ * cell. For kernels that are larger than a cell, this reduces to sampling the
+ * kernel at the cell midpoints. Particles whose kernel is contained
+ * in a single cell deposit all their mass in that cell. The fractions of every
+ * particle are normalized, so that every particle whose kernel lies completely
+ * inside the grid (or for a periodic grid: every particle) deposits exactly
+ * its mass.
+ *
+ * To avoid race conditions, particles are binned per subgrid, and subgrids
+ * are coloured in a 3x3x3 pattern: particles with a kernel smaller than a
+ * subgrid only deposit mass in their own subgrid and its direct neighbours,
+ * so that all subgrids with the same colour can be processed in parallel.
+ * Particles with larger kernels are processed serially afterwards.
+ *
+ * Temperatures and neutral fractions (if provided) are mapped as mass weighted
+ * averages.
+ */
+class SPHScatterMapping {
+private:
+  /*! @brief Positions of the particles (in m). */
+  const std::vector< CoordinateVector<> > &_positions;
+
+  /*! @brief Masses of the particles (in kg). */
+  const std::vector< double > &_masses;
+
+  /*! @brief Smoothing lengths of the particles (in m). */
+  const std::vector< double > &_smoothing_lengths;
+
+  /*! @brief Factor to convert a smoothing length into the h used by the
+   *  SPHKernelIntegrals (which has a kernel support of 2h). */
+  const double _kernel_factor;
+
+  /*! @brief Temperatures of the particles (in K; optional). */
+  const std::vector< double > *_temperatures;
+
+  /*! @brief Neutral fractions of the particles (optional). */
+  const std::vector< double > *_neutral_fractions;
+
+  /*! @brief Tabulated kernel integrals. */
+  const SPHKernelIntegrals _kernel_integrals;
+
+  /**
+   * @brief Get the colour of the subgrid with the given index along a single
+   * coordinate direction.
+   *
+   * @param index Index of the subgrid along the coordinate direction.
+   * @param number_of_subgrids Number of subgrids in that direction.
+   * @param periodic Is the grid periodic in that direction?
+   * @return Colour of the subgrid.
+   */
+  inline static int_fast32_t get_colour(const int_fast32_t index,
+                                        const int_fast32_t number_of_subgrids,
+                                        const bool periodic) {
+    const int_fast32_t base = 3 * (number_of_subgrids / 3);
+    if (!periodic || index < base) {
+      return index % 3;
+    } else {
+      // the remaining subgrids are neighbours of the first subgrids through
+      // the periodic boundary and get their own colours
+      return (base > 0 ? 3 : 0) + index - base;
+    }
+  }
+
+  /**
+   * @brief Get the number of colours along a single coordinate direction.
+   *
+   * @param number_of_subgrids Number of subgrids in that direction.
+   * @param periodic Is the grid periodic in that direction?
+   * @return Number of colours.
+   */
+  inline static int_fast32_t
+  get_number_of_colours(const int_fast32_t number_of_subgrids,
+                        const bool periodic) {
+    if (!periodic) {
+      return std::min(number_of_subgrids, int_fast32_t(3));
+    } else {
+      return (number_of_subgrids >= 3 ? 3 : 0) + number_of_subgrids % 3;
+    }
+  }
+
+  /**
+   * @brief Cell overlapped by the kernel of a particle.
+   */
+  struct Overlap {
+    /*! @brief Index of the subgrid that contains the cell. */
+    uint_fast32_t _subgrid_index;
+
+    /*! @brief Index of the cell within the subgrid. */
+    uint_fast32_t _cell_index;
+
+    /*! @brief Fraction of the kernel within the cell. */
+    double _fraction;
+  };
+
+  /**
+   * @brief Geometrical information about the grid.
+   */
+  struct GridGeometry {
+    /*! @brief Box containing the grid (in m). */
+    Box<> _box;
+
+    /*! @brief Periodicity flags. */
+    CoordinateVector< bool > _periodic;
+
+    /*! @brief Number of subgrids in each direction. */
+    CoordinateVector< int_fast32_t > _number_of_subgrids;
+
+    /*! @brief Number of cells in each direction for a single subgrid. */
+    CoordinateVector< int_fast32_t > _subgrid_number_of_cells;
+
+    /*! @brief Total number of cells in each direction. */
+    CoordinateVector< int_fast32_t > _number_of_cells;
+
+    /*! @brief Size of a single cell (in m). */
+    CoordinateVector<> _cell_size;
+  };
+
+  /**
+   * @brief Get the geometrical information for the given grid.
+   *
+   * @param grid_creator Grid.
+   * @return Corresponding GridGeometry.
+   */
+  template < typename _subgrid_type_ >
+  inline static GridGeometry
+  get_geometry(const DensitySubGridCreator< _subgrid_type_ > &grid_creator) {
+    GridGeometry geometry;
+    geometry._box = grid_creator.get_box();
+    geometry._periodic = grid_creator.get_periodicity();
+    geometry._number_of_subgrids = grid_creator.get_subgrid_layout();
+    geometry._subgrid_number_of_cells = grid_creator.get_subgrid_cell_layout();
+    for (uint_fast8_t i = 0; i < 3; ++i) {
+      geometry._number_of_cells[i] = geometry._number_of_subgrids[i] *
+                                     geometry._subgrid_number_of_cells[i];
+      geometry._cell_size[i] =
+          geometry._box.get_sides()[i] / geometry._number_of_cells[i];
+    }
+    return geometry;
+  }
+
+  /**
+   * @brief Get the subgrid and cell index of the cell with the given unwrapped
+   * 3D cell index.
+   *
+   * @param unwrapped Unwrapped 3D cell index, can be outside the grid.
+   * @param geometry Grid geometry.
+   * @param overlap Overlap to store the subgrid and cell index in.
+   * @return True if the cell is part of the grid, false if the index is
+   * outside a non-periodic grid.
+   */
+  inline static bool get_cell(const int_fast32_t unwrapped[3],
+                              const GridGeometry &geometry, Overlap &overlap) {
+
+    CoordinateVector< int_fast32_t > wrapped;
+    for (uint_fast8_t i = 0; i < 3; ++i) {
+      if (geometry._periodic[i]) {
+        wrapped[i] = ((unwrapped[i] % geometry._number_of_cells[i]) +
+                      geometry._number_of_cells[i]) %
+                     geometry._number_of_cells[i];
+      } else {
+        if (unwrapped[i] < 0 || unwrapped[i] >= geometry._number_of_cells[i]) {
+          return false;
+        }
+        wrapped[i] = unwrapped[i];
+      }
+    }
+    overlap._subgrid_index =
+        ((wrapped.x() / geometry._subgrid_number_of_cells.x()) *
+             geometry._number_of_subgrids.y() +
+         wrapped.y() / geometry._subgrid_number_of_cells.y()) *
+            geometry._number_of_subgrids.z() +
+        wrapped.z() / geometry._subgrid_number_of_cells.z();
+    overlap._cell_index =
+        ((wrapped.x() % geometry._subgrid_number_of_cells.x()) *
+             geometry._subgrid_number_of_cells.y() +
+         wrapped.y() % geometry._subgrid_number_of_cells.y()) *
+            geometry._subgrid_number_of_cells.z() +
+        wrapped.z() % geometry._subgrid_number_of_cells.z();
+    return true;
+  }
+
+  /**
+   * @brief Compute the fractions of the kernel of the given particle that
+   * overlap with the cells of the grid.
+   *
+   * Kernels that overlap with at most 2 cells in every direction are
+   * integrated over the cells using the tabulated kernel integrals, while
+   * larger kernels are sampled on a regular grid of points within each cell,
+   * with a spacing of at most a smoothing length. The fractions are normalized
+   * by the total over all cells overlapped by the kernel, including cells
+   * outside a non-periodic grid, so that only the part of the kernel outside
+   * the grid is lost.
+   *
+   * @param index Index of the particle.
+   * @param geometry Grid geometry.
+   * @param overlaps Vector to store the overlapping cells in (is cleared
+   * first).
+   */
+  inline void get_overlaps(const size_t index, const GridGeometry &geometry,
+                           std::vector< Overlap > &overlaps) const {
+
+    overlaps.clear();
+
+    const CoordinateVector<> &position = _positions[index];
+    const double h = _kernel_factor * _smoothing_lengths[index];
+    const double support = 2. * h;
+
+    // range of (unwrapped) cell indices overlapped by the kernel support
+    int_fast32_t lower[3], upper[3];
+    for (uint_fast8_t i = 0; i < 3; ++i) {
+      const double anchor = geometry._box.get_anchor()[i];
+      lower[i] = std::floor((position[i] - support - anchor) /
+                            geometry._cell_size[i]);
+      upper[i] = std::floor((position[i] + support - anchor) /
+                            geometry._cell_size[i]);
+      if (!geometry._periodic[i] &&
+          (upper[i] < 0 || lower[i] >= geometry._number_of_cells[i])) {
+        // the particle is completely outside the grid
+        return;
+      }
+    }
+
+    if (lower[0] == upper[0] && lower[1] == upper[1] && lower[2] == upper[2]) {
+      // the kernel is completely contained within a single cell
+      const int_fast32_t single[3] = {lower[0], lower[1], lower[2]};
+      Overlap overlap;
+      if (get_cell(single, geometry, overlap)) {
+        overlap._fraction = 1.;
+        overlaps.push_back(overlap);
+      }
+      return;
+    }
+
+    // kernels that overlap with at most 2 cells in every direction are
+    // integrated exactly, larger kernels are sampled with at least 1 sample
+    // point per smoothing length in every direction
+    const bool integrate_kernel =
+        (upper[0] - lower[0] < 2 && upper[1] - lower[1] < 2 &&
+         upper[2] - lower[2] < 2);
+    int_fast32_t number_of_samples[3];
+    CoordinateVector<> sample_size;
+    for (uint_fast8_t i = 0; i < 3; ++i) {
+      number_of_samples[i] = std::ceil(geometry._cell_size[i] / h);
+      sample_size[i] = geometry._cell_size[i] / number_of_samples[i];
+    }
+
+    double total_fraction = 0.;
+    for (int_fast32_t ix = lower[0]; ix <= upper[0]; ++ix) {
+      for (int_fast32_t iy = lower[1]; iy <= upper[1]; ++iy) {
+        for (int_fast32_t iz = lower[2]; iz <= upper[2]; ++iz) {
+
+          const int_fast32_t unwrapped[3] = {ix, iy, iz};
+          // we use the unwrapped cell position, so that the relative position
+          // of the particle w.r.t. the cell is correct
+          CoordinateVector<> cell_anchor;
+          double distance2 = 0.;
+          for (uint_fast8_t i = 0; i < 3; ++i) {
+            cell_anchor[i] = geometry._box.get_anchor()[i] +
+                             unwrapped[i] * geometry._cell_size[i];
+            // distance between the particle and the cell along this direction
+            const double dlow = cell_anchor[i] - position[i];
+            const double dhigh =
+                position[i] - cell_anchor[i] - geometry._cell_size[i];
+            const double d = std::max(0., std::max(dlow, dhigh));
+            distance2 += d * d;
+          }
+          if (distance2 >= support * support) {
+            continue;
+          }
+
+          double fraction = 0.;
+          if (integrate_kernel) {
+            const CuboidCell cell(cell_anchor, geometry._cell_size);
+            fraction = _kernel_integrals.mass_contribution(cell, position, h);
+          } else {
+            // the sample volume is the same for all samples and drops out
+            // after normalization
+            const CoordinateVector<> offset =
+                cell_anchor + 0.5 * sample_size - position;
+            for (int_fast32_t sx = 0; sx < number_of_samples[0]; ++sx) {
+              const double dx = offset.x() + sx * sample_size.x();
+              for (int_fast32_t sy = 0; sy < number_of_samples[1]; ++sy) {
+                const double dy = offset.y() + sy * sample_size.y();
+                for (int_fast32_t sz = 0; sz < number_of_samples[2]; ++sz) {
+                  const double dz = offset.z() + sz * sample_size.z();
+                  const double r = std::sqrt(dx * dx + dy * dy + dz * dz);
+                  fraction +=
+                      CubicSplineKernel::kernel_evaluate(r / support, support);
+                }
+              }
+            }
+          }
+          if (fraction <= 0.) {
+            continue;
+          }
+          total_fraction += fraction;
+
+          Overlap overlap;
+          if (get_cell(unwrapped, geometry, overlap)) {
+            overlap._fraction = fraction;
+            overlaps.push_back(overlap);
+          }
+        }
+      }
+    }
+
+    if (total_fraction > 0.) {
+      const double inverse_total = 1. / total_fraction;
+      for (size_t i = 0; i < overlaps.size(); ++i) {
+        overlaps[i]._fraction *= inverse_total;
+      }
+    }
+  }
+
+  /**
+   * @brief Deposit the given particle onto the accumulator arrays.
+   *
+   * @param index Index of the particle.
+   * @param geometry Grid geometry.
+   * @param overlaps Temporary storage for the overlapping cells.
+   * @param mass Mass accumulators for every subgrid (in kg).
+   * @param temperature Mass weighted temperature accumulators for every
+   * subgrid (in kg K).
+   * @param neutral_fraction Mass weighted neutral fraction accumulators for
+   * every subgrid (in kg).
+   */
+  inline void deposit_particle(
+      const size_t index, const GridGeometry &geometry,
+      std::vector< Overlap > &overlaps,
+      std::vector< std::vector< double > > &mass,
+      std::vector< std::vector< double > > &temperature,
+      std::vector< std::vector< double > > &neutral_fraction) const {
+
+    get_overlaps(index, geometry, overlaps);
+    for (size_t i = 0; i < overlaps.size(); ++i) {
+      const Overlap &overlap = overlaps[i];
+      std::vector< double > &subgrid_mass = mass[overlap._subgrid_index];
+      // subgrids that are not local have no accumulators
+      if (subgrid_mass.size() == 0) {
+        continue;
+      }
+      const double dm = _masses[index] * overlap._fraction;
+      subgrid_mass[overlap._cell_index] += dm;
+      if (_temperatures != nullptr) {
+        temperature[overlap._subgrid_index][overlap._cell_index] +=
+            dm * (*_temperatures)[index];
+      }
+      if (_neutral_fractions != nullptr) {
+        neutral_fraction[overlap._subgrid_index][overlap._cell_index] +=
+            dm * (*_neutral_fractions)[index];
+      }
+    }
+  }
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param positions Positions of the particles (in m).
+   * @param masses Masses of the particles (in kg).
+   * @param smoothing_lengths Smoothing lengths of the particles (in m).
+   * @param kernel_factor Ratio of the kernel support and the smoothing
+   * length, divided by 2. Use 0.5 for smoothing lengths that are equal to the
+   * kernel support (Gadget convention) and 1 for smoothing lengths that are
+   * half the kernel support (Phantom convention).
+   * @param temperatures Temperatures of the particles (in K; optional).
+   * @param neutral_fractions Neutral fractions of the particles (optional).
+   */
+  inline SPHScatterMapping(
+      const std::vector< CoordinateVector<> > &positions,
+      const std::vector< double > &masses,
+      const std::vector< double > &smoothing_lengths,
+      const double kernel_factor,
+      const std::vector< double > *temperatures = nullptr,
+      const std::vector< double > *neutral_fractions = nullptr)
+      : _positions(positions), _masses(masses),
+        _smoothing_lengths(smoothing_lengths), _kernel_factor(kernel_factor),
+        _temperatures(temperatures), _neutral_fractions(neutral_fractions) {}
+
+  /**
+   * @brief Get the fractions of the kernel of the given particle that overlap
+   * with the cells of the given grid.
+   *
+   * @param index Index of the particle.
+   * @param grid_creator Grid.
+   * @return Subgrid index, cell index and kernel fraction for every cell
+   * overlapped by the kernel of the particle.
+   */
+  template < typename _subgrid_type_ >
+  inline std::vector< std::tuple< uint_fast32_t, uint_fast32_t, double > >
+  get_kernel_fractions(
+      const size_t index,
+      const DensitySubGridCreator< _subgrid_type_ > &grid_creator) const {
+
+    const GridGeometry geometry = get_geometry(grid_creator);
+    std::vector< Overlap > overlaps;
+    get_overlaps(index, geometry, overlaps);
+    std::vector< std::tuple< uint_fast32_t, uint_fast32_t, double > > result(
+        overlaps.size());
+    for (size_t i = 0; i < overlaps.size(); ++i) {
+      result[i] = std::make_tuple(overlaps[i]._subgrid_index,
+                                  overlaps[i]._cell_index,
+                                  overlaps[i]._fraction);
+    }
+    return result;
+  }
+
+  /**
+   * @brief Deposit the particles onto the local original subgrids of the given
+   * grid.
+   *
+   * Only cells that receive mass are updated: their number density is set to
+   * the deposited mass divided by the cell volume and the hydrogen mass, and
+   * their temperature and neutral fraction are set to the mass weighted
+   * average particle values (if available). All other cells keep the values
+   * that were set by DensitySubGridCreator::initialize().
+   *
+   * @param grid_creator Grid.
+   */
+  template < typename _subgrid_type_ >
+  inline void
+  deposit(DensitySubGridCreator< _subgrid_type_ > &grid_creator) const {
+
+    const GridGeometry geometry = get_geometry(grid_creator);
+    const size_t number_of_subgrids =
+        grid_creator.number_of_original_subgrids();
+    const size_t number_of_cells_per_subgrid =
+        geometry._subgrid_number_of_cells.x() *
+        geometry._subgrid_number_of_cells.y() *
+        geometry._subgrid_number_of_cells.z();
+
+    std::vector< std::vector< double > > mass(number_of_subgrids);
+    std::vector< std::vector< double > > temperature(number_of_subgrids);
+    std::vector< std::vector< double > > neutral_fraction(number_of_subgrids);
+    for (size_t igrid = 0; igrid < number_of_subgrids; ++igrid) {
+      if (grid_creator.is_local(igrid)) {
+        mass[igrid].resize(number_of_cells_per_subgrid, 0.);
+        if (_temperatures != nullptr) {
+          temperature[igrid].resize(number_of_cells_per_subgrid, 0.);
+        }
+        if (_neutral_fractions != nullptr) {
+          neutral_fraction[igrid].resize(number_of_cells_per_subgrid, 0.);
+        }
+      }
+    }
+
+    // bin the particles per subgrid and per colour
+    CoordinateVector< int_fast32_t > number_of_colours;
+    double maximum_support = geometry._box.get_sides().x();
+    for (uint_fast8_t i = 0; i < 3; ++i) {
+      number_of_colours[i] = get_number_of_colours(
+          geometry._number_of_subgrids[i], geometry._periodic[i]);
+      maximum_support =
+          std::min(maximum_support, geometry._box.get_sides()[i] /
+                                        geometry._number_of_subgrids[i]);
+    }
+    std::vector< std::vector< uint_fast32_t > > subgrid_particles(
+        number_of_subgrids);
+    std::vector< std::vector< uint_fast32_t > > colour_subgrids(
+        number_of_colours.x() * number_of_colours.y() * number_of_colours.z());
+    std::vector< size_t > large_particles;
+    for (size_t ipart = 0; ipart < _positions.size(); ++ipart) {
+      if (2. * _kernel_factor * _smoothing_lengths[ipart] > maximum_support) {
+        large_particles.push_back(ipart);
+        continue;
+      }
+      CoordinateVector< int_fast32_t > subgrid;
+      for (uint_fast8_t i = 0; i < 3; ++i) {
+        subgrid[i] = std::floor(
+            (_positions[ipart][i] - geometry._box.get_anchor()[i]) /
+            geometry._box.get_sides()[i] * geometry._number_of_subgrids[i]);
+        if (geometry._periodic[i]) {
+          subgrid[i] = ((subgrid[i] % geometry._number_of_subgrids[i]) +
+                        geometry._number_of_subgrids[i]) %
+                       geometry._number_of_subgrids[i];
+        } else {
+          subgrid[i] = std::max(
+              int_fast32_t(0),
+              std::min(subgrid[i], geometry._number_of_subgrids[i] - 1));
+        }
+      }
+      const size_t subgrid_index =
+          (subgrid.x() * geometry._number_of_subgrids.y() + subgrid.y()) *
+              geometry._number_of_subgrids.z() +
+          subgrid.z();
+      subgrid_particles[subgrid_index].push_back(ipart);
+    }
+    for (int_fast32_t ix = 0; ix < geometry._number_of_subgrids.x(); ++ix) {
+      const int_fast32_t cx = get_colour(ix, geometry._number_of_subgrids.x(),
+                                         geometry._periodic.x());
+      for (int_fast32_t iy = 0; iy < geometry._number_of_subgrids.y(); ++iy) {
+        const int_fast32_t cy = get_colour(
+            iy, geometry._number_of_subgrids.y(), geometry._periodic.y());
+        for (int_fast32_t iz = 0; iz < geometry._number_of_subgrids.z();
+             ++iz) {
+          const int_fast32_t cz = get_colour(
+              iz, geometry._number_of_subgrids.z(), geometry._periodic.z());
+          const size_t subgrid_index =
+              (ix * geometry._number_of_subgrids.y() + iy) *
+                  geometry._number_of_subgrids.z() +
+              iz;
+          if (subgrid_particles[subgrid_index].size() > 0) {
+            colour_subgrids[(cx * number_of_colours.y() + cy) *
+                                number_of_colours.z() +
+                            cz]
+                .push_back(subgrid_index);
+          }
+        }
+      }
+    }
+
+    // deposit the particles one colour at a time
+    for (size_t icolour = 0; icolour < colour_subgrids.size(); ++icolour) {
+      const std::vector< uint_fast32_t > &subgrids = colour_subgrids[icolour];
+      const int_fast64_t number_of_colour_subgrids = subgrids.size();
+#ifdef HAVE_OPENMP
+#pragma omp parallel default(shared)
+#endif
+      {
+        std::vector< Overlap > overlaps;
+#ifdef HAVE_OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+        for (int_fast64_t isubgrid = 0; isubgrid < number_of_colour_subgrids;
+             ++isubgrid) {
+          const std::vector< uint_fast32_t > &particles =
+              subgrid_particles[subgrids[isubgrid]];
+          for (size_t ipart = 0; ipart < particles.size(); ++ipart) {
+            deposit_particle(particles[ipart], geometry, overlaps, mass,
+                             temperature, neutral_fraction);
+          }
+        }
+      }
+    }
+
+    // particles with a kernel that is larger than a subgrid can overlap with
+    // any subgrid and are done serially
+    {
+      std::vector< Overlap > overlaps;
+      for (size_t ipart = 0; ipart < large_particles.size(); ++ipart) {
+        deposit_particle(large_particles[ipart], geometry, overlaps, mass,
+                         temperature, neutral_fraction);
+      }
+    }
+
+    // convert the accumulated values into cell values
+    const double cell_volume = geometry._cell_size.x() *
+                               geometry._cell_size.y() *
+                               geometry._cell_size.z();
+    const int_fast64_t number_of_subgrids_signed = number_of_subgrids;
+#ifdef HAVE_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int_fast64_t igrid = 0; igrid < number_of_subgrids_signed; ++igrid) {
+      if (mass[igrid].size() == 0) {
+        continue;
+      }
+      auto gridit = grid_creator.get_subgrid(igrid);
+      for (auto cellit = (*gridit).begin(); cellit != (*gridit).end();
+           ++cellit) {
+        const uint_fast32_t icell = cellit.get_index();
+        const double cell_mass = mass[igrid][icell];
+        if (cell_mass <= 0.) {
+          continue;
+        }
+        IonizationVariables &ionization_variables =
+            cellit.get_ionization_variables();
+        ionization_variables.set_number_density(cell_mass / cell_volume /
+                                                1.6737236e-27);
+        if (_temperatures != nullptr) {
+          ionization_variables.set_temperature(temperature[igrid][icell] /
+                                               cell_mass);
+        }
+        if (_neutral_fractions != nullptr) {
+          ionization_variables.set_ionic_fraction(
+              ION_H_n, neutral_fraction[igrid][icell] / cell_mass);
+        }
+      }
+    }
+  }
+};
+
+#endif // SPHSCATTERMAPPING_HPP
@@ -26,12 +26,19 @@
 #ifndef SCHEDULER_HPP
 #define SCHEDULER_HPP
 
+#include "NUMATopology.hpp"
 #include "TaskQueue.hpp"
 #include "ThreadSafeVector.hpp"
 #include "Utilities.hpp"
+#include "WorkStealingTaskQueue.hpp"
 
 #include <vector>
 
+/*! @brief Number of elements between the steal counters of two consecutive
+ *  threads. Two cache lines worth of counters guarantee that no two threads
+ *  share a cache line, even if the counter vector itself is not aligned. */
+#define SCHEDULER_STEAL_COUNT_STRIDE (2 * 64 / sizeof(uint_fast64_t))
+
 /**
  * @brief Task scheduler responsible for scheduling and retrieving tasks.
  */
@@ -41,11 +48,21 @@ private:
   ThreadSafeVector< Task > &_tasks;
 
   /*! @brief Queues per thread. */
-  std::vector< TaskQueue * > &_queues;
+  std::vector< ThreadTaskQueue * > &_queues;
 
   /*! @brief General shared queue. */
   TaskQueue &_shared_queue;
 
+  /*! @brief NUMA topology used for locality aware stealing (nullptr if
+   *  stealing should ignore the NUMA domains). */
+  const NUMATopology *_topology;
+
+  /*! @brief Number of tasks every thread stole from a thread in the same NUMA
+   *  domain (first element) and in another NUMA domain (second element).
+   *  The counters of different threads are SCHEDULER_STEAL_COUNT_STRIDE
+   *  elements apart to avoid false sharing. */
+  std::vector< uint_fast64_t > _steal_counts;
+
 public:
   /**
    * @brief Constructor.
@@ -53,10 +70,122 @@ public:
    * @param tasks Task space.
    * @param queues Thread queues.
    * @param shared_queue Shared queue.
+   * @param topology NUMA topology used for locality aware stealing (nullptr
+   * if stealing should ignore the NUMA domains).
    */
   inline Scheduler(ThreadSafeVector< Task > &tasks,
-                   std::vector< TaskQueue * > &queues, TaskQueue &shared_queue)
-      : _tasks(tasks), _queues(queues), _shared_queue(shared_queue) {}
+                   std::vector< ThreadTaskQueue * > &queues,
+                   TaskQueue &shared_queue,
+                   const NUMATopology *topology = nullptr)
+      : _tasks(tasks), _queues(queues), _shared_queue(shared_queue),
+        _topology(topology) {
+    if (_topology != nullptr) {
+      _steal_counts.resize(SCHEDULER_STEAL_COUNT_STRIDE * _queues.size(), 0);
+    }
+  }
+
+  /**
+   * @brief Steal a task from one of the locked thread queues.
+   *
+   * The queues are sorted by size and we try to steal from the largest queue
+   * first.
+   *
+   * @param thread_id Calling thread.
+   * @param queues Thread queues.
+   * @param tasks Task space.
+   * @return Index of a locked task that is ready for execution, or NO_TASK if
+   * no eligible task could be found.
+   */
+  inline static uint_fast32_t steal_task(const int_fast32_t thread_id,
+                                         std::vector< TaskQueue * > &queues,
+                                         ThreadSafeVector< Task > &tasks) {
+
+    // sort the queues by size
+    std::vector< size_t > queue_sizes(queues.size(), 0);
+    for (size_t i = 0; i < queues.size(); ++i) {
+      queue_sizes[i] = queues[i]->size();
+    }
+    std::vector< uint_fast32_t > sorti = Utilities::argsort(queue_sizes);
+
+    // now try to steal from the largest queue first
+    uint_fast32_t task_index = NO_TASK;
+    uint_fast32_t i = 0;
+    while (task_index == NO_TASK && i < queue_sizes.size() &&
+           queue_sizes[sorti[queue_sizes.size() - i - 1]] > 0) {
+      task_index =
+          queues[sorti[queue_sizes.size() - i - 1]]->try_get_task(tasks);
+      ++i;
+    }
+    return task_index;
+  }
+
+  /**
+   * @brief Steal a task from one of the lock-free thread queues.
+   *
+   * Stealing is cheap for these queues, so we do not bother sorting them, but
+   * simply visit all other queues once, starting from the next thread.
+   *
+   * @param thread_id Calling thread.
+   * @param queues Thread queues.
+   * @param tasks Task space.
+   * @return Index of a locked task that is ready for execution, or NO_TASK if
+   * no eligible task could be found.
+   */
+  inline static uint_fast32_t
+  steal_task(const int_fast32_t thread_id,
+             std::vector< WorkStealingTaskQueue * > &queues,
+             ThreadSafeVector< Task > &tasks) {
+
+    const size_t number_of_queues = queues.size();
+    uint_fast32_t task_index = NO_TASK;
+    for (size_t i = 1; i < number_of_queues && task_index == NO_TASK; ++i) {
+      WorkStealingTaskQueue &victim =
+          *queues[(thread_id + i) % number_of_queues];
+      if (victim.size() > 0) {
+        task_index = victim.try_get_task(tasks);
+      }
+    }
+    return task_index;
+  }
+
+  /**
+   * @brief Steal a task from one of the thread queues, in the locality aware
+   * order given by the NUMA topology.
+   *
+   * Threads in the same NUMA domain are visited first, so that subgrids are
+   * only processed by a thread in another NUMA domain (and hence accessed
+   * through the interconnect) if all threads in their own domain are out of
+   * work.
+   *
+   * @param thread_id Calling thread.
+   * @param queues Thread queues.
+   * @param tasks Task space.
+   * @param topology NUMA topology.
+   * @param remote Set to true if the task was stolen from a thread in another
+   * NUMA domain.
+   * @return Index of a locked task that is ready for execution, or NO_TASK if
+   * no eligible task could be found.
+   */
+  template < typename _queue_type_ >
+  inline static uint_fast32_t
+  steal_task(const int_fast32_t thread_id,
+             std::vector< _queue_type_ * > &queues,
+             ThreadSafeVector< Task > &tasks, const NUMATopology &topology,
+             bool &remote) {
+
+    const std::vector< int_fast32_t > &victims =
+        topology.get_steal_order(thread_id);
+    uint_fast32_t task_index = NO_TASK;
+    for (size_t i = 0; i < victims.size() && task_index == NO_TASK; ++i) {
+      _queue_type_ &victim = *queues[victims[i]];
+      if (victim.size() > 0) {
+        task_index = victim.try_get_task(tasks);
+        remote =
+            topology.get_domain(victims[i]) != topology.get_domain(thread_id);
+      }
+    }
+    return task_index;
+  }
 
   /**
    * @brief Get a task from one of the queues.
@@ -71,21 +200,14 @@ public:
     if (task_index == NO_TASK) {
 
       // try to steal a task from another thread's queue
-
-      // sort the queues by size
-      std::vector< size_t > queue_sizes(_queues.size(), 0);
-      for (size_t i = 0; i < _queues.size(); ++i) {
-        queue_sizes[i] = _queues[i]->size();
-      }
-      std::vector< uint_fast32_t > sorti = Utilities::argsort(queue_sizes);
-
-      // now try to steal from the largest queue first
-      uint_fast32_t i = 0;
-      while (task_index == NO_TASK && i < queue_sizes.size() &&
-             queue_sizes[sorti[queue_sizes.size() - i - 1]] > 0) {
-        task_index =
-            _queues[sorti[queue_sizes.size() - i - 1]]->try_get_task(_tasks);
-        ++i;
+      if (_topology != nullptr) {
+        bool remote = false;
+        task_index = steal_task(thread_id, _queues, _tasks, *_topology, remote);
+        if (task_index != NO_TASK) {
+          ++_steal_counts[SCHEDULER_STEAL_COUNT_STRIDE * thread_id + remote];
+        }
+      } else {
+        task_index = steal_task(thread_id, _queues, _tasks);
       }
       if (task_index == NO_TASK) {
         // get a task from the shared queue
@@ -95,6 +217,36 @@ public:
 
     return task_index;
   }
+
+  /**
+   * @brief Get the total number of tasks that were stolen from a thread in the
+   * same NUMA domain.
+   *
+   * @return Number of local steals (0 if no NUMA topology is used).
+   */
+  inline uint_fast64_t get_number_of_local_steals() const {
+    uint_fast64_t number = 0;
+    for (size_t i = 0; i < _steal_counts.size();
+         i += SCHEDULER_STEAL_COUNT_STRIDE) {
+      number += _steal_counts[i];
+    }
+    return number;
+  }
+
+  /**
+   * @brief Get the total number of tasks that were stolen from a thread in
+   * another NUMA domain.
+   *
+   * @return Number of remote steals (0 if no NUMA topology is used).
+   */
+  inline uint_fast64_t get_number_of_remote_steals() const {
+    uint_fast64_t number = 0;
+    for (size_t i = 1; i < _steal_counts.size();
+         i += SCHEDULER_STEAL_COUNT_STRIDE) {
+      number += _steal_counts[i];
+    }
+    return number;
+  }
 };
 
 #endif // SCHEDULER_HPP
@@ -0,0 +1,92 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file SendPhotonBufferTaskContext.hpp
+ *
+ * @brief Task context responsible for sending photon buffers to the process
+ * that owns their target subgrid.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#ifndef SENDPHOTONBUFFERTASKCONTEXT_HPP
+#define SENDPHOTONBUFFERTASKCONTEXT_HPP
+
+#include "DensitySubGridCreator.hpp"
+#include "MemorySpace.hpp"
+#include "PhotonBufferCommunicator.hpp"
+#include "Task.hpp"
+#include "TaskContext.hpp"
+
+/**
+ * @brief Task context responsible for sending photon buffers to the process
+ * that owns their target subgrid.
+ */
+template < typename _subgrid_type_ >
+class SendPhotonBufferTaskContext : public TaskContext {
+private:
+  /*! @brief Photon buffer array. */
+  MemorySpace &_buffers;
+
+  /*! @brief Grid creator. */
+  DensitySubGridCreator< _subgrid_type_ > &_grid_creator;
+
+  /*! @brief Photon buffer communicator. */
+  PhotonBufferCommunicator &_communicator;
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param buffers Photon buffer array.
+   * @param grid_creator Grid creator.
+   * @param communicator Photon buffer communicator.
+   */
+  inline SendPhotonBufferTaskContext(
+      MemorySpace &buffers,
+      DensitySubGridCreator< _subgrid_type_ > &grid_creator,
+      PhotonBufferCommunicator &communicator)
+      : _buffers(buffers), _grid_creator(grid_creator),
+        _communicator(communicator) {}
+
+  /**
+   * @brief Execute a send task.
+   *
+   * @param thread_id ID of the thread that executes the task.
+   * @param thread_context Task specific thread dependent execution context.
+   * @param tasks_to_add Array with indices of newly created tasks.
+   * @param queues_to_add Array with target queue indices for the newly created
+   * tasks.
+   * @param task Task to execute.
+   * @return Number of new tasks created by the task (always 0).
+   */
+  virtual uint_fast32_t execute(const int_fast32_t thread_id,
+                                ThreadContext *thread_context,
+                                uint_fast32_t *tasks_to_add,
+                                int_fast32_t *queues_to_add, Task &task) {
+
+    const size_t buffer_index = task.get_buffer();
+    PhotonBuffer &buffer = _buffers[buffer_index];
+    _communicator.send(buffer,
+                       _grid_creator.get_domain(buffer.get_subgrid_index()));
+    _buffers.free_buffer(buffer_index);
+    return 0;
+  }
+};
+
+#endif // SENDPHOTONBUFFERTASKCONTEXT_HPP
@@ -0,0 +1,224 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file SnapshotBlockBuffer.hpp
+ *
+ * @brief Thread safe buffer that keeps a limited number of blocks of a
+ * snapshot file in memory.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#ifndef SNAPSHOTBLOCKBUFFER_HPP
+#define SNAPSHOTBLOCKBUFFER_HPP
+
+#include "CPUCycle.hpp"
+#include "Error.hpp"
+#include "ThreadLock.hpp"
+#include "Utilities.hpp"
+
+#include <vector>
+
+/**
+ * @brief Thread safe buffer that keeps a limited number of blocks of a
+ * snapshot file in memory.
+ *
+ * A snapshot is divided into a number of blocks with the same size (e.g. the
+ * subgrids of a task-based CMacIonize snapshot, or the blocks of a FLASH
+ * snapshot). Blocks are read on demand into one of a fixed number of buffer
+ * elements, using a read function provided by the caller. If no free buffer
+ * element is available, the least recently used element is overwritten. This
+ * bounds the memory needed to read a snapshot, independent of its size.
+ *
+ * Buffer elements are locked while they are being used, so that other threads
+ * cannot swap them out. The read function is called without holding any global
+ * lock; the caller is responsible for protecting the access to the underlying
+ * file (HDF5 is in general not thread safe).
+ *
+ * @tparam _value_type_ Type of the values stored in the buffer.
+ */
+template < typename _value_type_ > class SnapshotBlockBuffer {
+private:
+  /*! @brief Number of blocks that can be buffered. */
+  uint_fast32_t _buffer_size;
+
+  /*! @brief Number of values in a single block. */
+  size_t _block_size;
+
+  /*! @brief Buffer. */
+  std::vector< _value_type_ > _buffer;
+
+  /*! @brief Last usage timestamp for each buffer element. */
+  std::vector< uint_fast64_t > _buffer_timestamps;
+
+  /*! @brief Index of each block in the buffer (if buffered). */
+  std::vector< uint_fast32_t > _buffer_indices;
+
+  /*! @brief Index of the block that has been buffered in each buffer element
+   *  (to make sure another thread did not swap it out). */
+  std::vector< uint_fast32_t > _buffer_block_indices;
+
+  /*! @brief Locks per buffer element. */
+  std::vector< ThreadLock > _buffer_element_locks;
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * The buffer itself is only allocated by initialize().
+   *
+   * @param buffer_size Number of blocks that can be buffered.
+   */
+  inline SnapshotBlockBuffer(const uint_fast32_t buffer_size)
+      : _buffer_size(buffer_size), _block_size(0),
+        _buffer_timestamps(buffer_size, 0),
+        _buffer_block_indices(buffer_size, 0xffffffff),
+        _buffer_element_locks(buffer_size) {}
+
+  /**
+   * @brief Allocate the buffer.
+   *
+   * @param number_of_blocks Total number of blocks in the snapshot.
+   * @param block_size Number of values in a single block.
+   */
+  inline void initialize(const uint_fast32_t number_of_blocks,
+                         const size_t block_size) {
+    _block_size = block_size;
+    _buffer.resize(_buffer_size * _block_size);
+    _buffer_indices.resize(number_of_blocks, 0xffffffff);
+  }
+
+  /**
+   * @brief Free the memory used by the buffer.
+   */
+  inline void free() {
+    _buffer.clear();
+    _buffer_timestamps.clear();
+    _buffer_element_locks.clear();
+    _buffer_block_indices.clear();
+    _buffer_indices.clear();
+  }
+
+  /**
+   * @brief Obtain a buffer element that contains the block with the given
+   * index, reading the block if it is not present in the buffer.
+   *
+   * @param block_index Index of the block.
+   * @param read_function Function that reads a block into a buffer element.
+   * Should have the signature void read_function(uint_fast32_t block_index,
+   * _value_type_ *values).
+   * @return Index of the buffer element that contains the block. The element
+   * is locked and cannot be altered by any other thread until unlock() is
+   * called.
+   */
+  template < typename _read_function_ >
+  inline uint_fast32_t lock(const uint_fast32_t block_index,
+                            _read_function_ read_function) {
+
+    // first retrieve the index of the block in the buffer
+    uint_fast32_t buffer_index = _buffer_indices[block_index];
+    // check if the block was buffered
+    if (buffer_index == 0xffffffff) {
+      // block was not buffered, buffer it
+      buffer_index = buffer_block(block_index, read_function);
+    } else {
+      // block might be buffered
+      // we need to lock it and check that is wasn't swapped out for another
+      // block before we obtained the lock
+      _buffer_element_locks[buffer_index].lock();
+      if (_buffer_block_indices[buffer_index] != block_index) {
+        // too bad, another thread swapped it out! We need to release the lock
+        // and buffer it again
+        _buffer_element_locks[buffer_index].unlock();
+        buffer_index = buffer_block(block_index, read_function);
+      }
+    }
+    // update the access time for the buffer element
+    cpucycle_tick(_buffer_timestamps[buffer_index]);
+    return buffer_index;
+  }
+
+  /**
+   * @brief Unlock the given buffer element.
+   *
+   * @param buffer_index Index of a buffer element.
+   */
+  inline void unlock(const uint_fast32_t buffer_index) {
+    // update the access time for the buffer element
+    cpucycle_tick(_buffer_timestamps[buffer_index]);
+    _buffer_element_locks[buffer_index].unlock();
+  }
+
+  /**
+   * @brief Access the values stored in the given (locked) buffer element.
+   *
+   * @param buffer_index Index of a buffer element.
+   * @return Pointer to the first value in that element.
+   */
+  inline const _value_type_ *
+  get_values(const uint_fast32_t buffer_index) const {
+    return &_buffer[buffer_index * _block_size];
+  }
+
+private:
+  /**
+   * @brief Read the block with the given index into the least recently used
+   * free buffer element.
+   *
+   * @param block_index Index of the block to buffer.
+   * @param read_function Function that reads a block into a buffer element.
+   * @return Index of the buffer element that contains the block (locked).
+   */
+  template < typename _read_function_ >
+  inline uint_fast32_t buffer_block(const uint_fast32_t block_index,
+                                    _read_function_ &read_function) {
+
+    // sort the buffers according to their last access time
+    const std::vector< uint_fast64_t > buffer_timestamps_copy(
+        _buffer_timestamps);
+    const std::vector< uint_fast32_t > timesort =
+        Utilities::argsort(buffer_timestamps_copy);
+    // try to lock an old buffer
+    uint_fast32_t ibuffer = 0;
+    while (ibuffer < timesort.size() &&
+           !_buffer_element_locks[timesort[ibuffer]].try_lock()) {
+      ++ibuffer;
+    }
+    if (ibuffer == timesort.size()) {
+      cmac_error("Unable to obtain a free snapshot buffer!");
+    }
+
+    // buffer_index is now locked and can be overwritten
+    const uint_fast32_t buffer_index = timesort[ibuffer];
+    read_function(block_index, &_buffer[buffer_index * _block_size]);
+
+    // invalidate the old block pointer, this buffer will no longer contain
+    // that block
+    if (_buffer_block_indices[buffer_index] != 0xffffffff) {
+      _buffer_indices[_buffer_block_indices[buffer_index]] = 0xffffffff;
+    }
+    // point the new block to this buffer
+    _buffer_indices[block_index] = buffer_index;
+    // make sure the cross check works
+    _buffer_block_indices[buffer_index] = block_index;
+
+    return buffer_index;
+  }
+};
+
+#endif // SNAPSHOTBLOCKBUFFER_HPP
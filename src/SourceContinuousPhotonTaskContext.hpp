@@ -37,6 +37,9 @@
 #include "Task.hpp"
 #include "TaskContext.hpp"
 #include "TaskQueue.hpp"
+#include "WorkStealingTaskQueue.hpp"
+
+#include <algorithm>
 
 /**
  * @brief Task context responsible for generating new photon packets that
@@ -75,7 +78,7 @@ private:
   std::vector< std::vector< PhotonBuffer > > &_continuous_buffers;
 
   /*! @brief Queues per thread. */
-  std::vector< TaskQueue * > &_queues;
+  std::vector< ThreadTaskQueue * > &_queues;
 
   /*! @brief General shared queue. */
   TaskQueue &_shared_queue;
@@ -121,7 +124,7 @@ public:
       DensitySubGridCreator< DensitySubGrid > &grid_creator,
       ThreadSafeVector< Task > &tasks,
       std::vector< std::vector< PhotonBuffer > > &continuous_buffers,
-      std::vector< TaskQueue * > &queues, TaskQueue &shared_queue,
+      std::vector< ThreadTaskQueue * > &queues, TaskQueue &shared_queue,
       const uint_fast32_t number_of_continuous_photons,
       std::vector< ThreadLock > &continuous_source_lock)
       : _continuous_photon_source(continuous_photon_source), _buffers(buffers),
@@ -156,8 +159,18 @@ public:
     const size_t num_photon_this_loop = task.get_buffer();
 
     // draw random photons and store them in the continuous buffers
+    // frequencies are drawn in batches of PHOTONBUFFER_SIZE
+    double frequencies[PHOTONBUFFER_SIZE];
     for (uint_fast32_t i = 0; i < num_photon_this_loop; ++i) {
 
+      const uint_fast32_t ifreq = i % PHOTONBUFFER_SIZE;
+      if (ifreq == 0) {
+        _photon_source_spectrum.get_random_frequencies(
+            _random_generators[thread_id], frequencies,
+            std::min< uint_fast32_t >(PHOTONBUFFER_SIZE,
+                                      num_photon_this_loop - i));
+      }
+
       auto posdir = _continuous_photon_source.get_random_incoming_direction(
           _random_generators[thread_id]);
 
@@ -168,7 +181,7 @@ public:
           _continuous_buffers[source_copy][subgrid_index];
       const uint_fast32_t active_index = active_buffer.get_next_free_photon();
 
-      PhotonPacket &photon = active_buffer[active_index];
+      PhotonPacket photon;
 
       photon.set_type(PHOTONTYPE_PRIMARY);
       photon.set_scatter_counter(0);
@@ -186,19 +199,24 @@ public:
       photon.set_target_optical_depth(
           -std::log(_random_generators[thread_id].get_uniform_random_double()));
 
-      const double frequency = _photon_source_spectrum.get_random_frequency(
-          _random_generators[thread_id]);
+      const double frequency = frequencies[ifreq];
       photon.set_energy(frequency);
+      double cross_sections[NUMBER_OF_IONNAMES];
+      double dust_opacity;
+      _cross_sections.get_cross_sections(frequency, cross_sections,
+                                         dust_opacity);
       for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
-        double sigma = _cross_sections.get_cross_section(ion, frequency);
+        double sigma = cross_sections[ion];
 #ifndef VARIABLE_ABUNDANCES
         if (ion != ION_H_n) {
           sigma *= _abundances.get_abundance(get_element(ion));
         }
 #endif
         photon.set_photoionization_cross_section(ion, sigma);
-        photon.set_dust_opacity(_cross_sections.get_dust_opacity(frequency));
       }
+      photon.set_dust_opacity(dust_opacity);
+
+      active_buffer.set_photon(active_index, photon);
 
       // did the photon make the buffer overflow?
       if (active_buffer.size() == PHOTONBUFFER_SIZE) {
@@ -207,15 +225,11 @@ public:
         PhotonBuffer &input_buffer = _buffers[buffer_index];
 
         // set general buffer information
-        input_buffer.grow(PHOTONBUFFER_SIZE);
         input_buffer.set_subgrid_index(subgrid_index);
         input_buffer.set_direction(TRAVELDIRECTION_INSIDE);
 
         // copy over the photons
-        for (uint_fast32_t iphoton = 0; iphoton < PHOTONBUFFER_SIZE;
-             ++iphoton) {
-          input_buffer[iphoton] = active_buffer[iphoton];
-        }
+        input_buffer.add_photons(active_buffer);
 
         // reset the active buffer
         active_buffer.reset();
@@ -232,7 +246,7 @@ public:
         //  - subgrid
         // (the output buffers belong to the subgrid and do not count
         // as a dependency)
-        new_task.set_dependency(subgrid.get_dependency());
+        new_task.set_dependency(subgrid.get_traversal_dependency());
 
         _queues[subgrid.get_owning_thread()]->add_task(task_index);
       }
@@ -143,10 +143,24 @@ public:
     const CoordinateVector<> source_position =
         _photon_source.get_position(source_index);
 
+    // some distributions provide their own per source frequencies; all other
+    // sources share the same spectrum, so that we can draw all frequencies for
+    // this batch at once
+    const bool use_source_frequency =
+        typeid(TextFilePhotonSourceDistribution).name() == typeid(_photon_source_distribution).name() ||
+        typeid(ArepoSnapshotPhotonSourceDistribution).name() == typeid(_photon_source_distribution).name() ||
+        typeid(HDF5PhotonSourceDistribution).name() == typeid(_photon_source_distribution).name() ||
+        typeid(MixedDrivingPhotonSourceDistribution).name() == typeid(_photon_source_distribution).name();
+    double frequencies[PHOTONBUFFER_SIZE];
+    if (!use_source_frequency) {
+      _photon_source_spectrum.get_random_frequencies(
+          _random_generators[thread_id], frequencies, num_photon_this_loop);
+    }
+
     // draw random photons and store them in the buffer
     for (uint_fast32_t i = 0; i < num_photon_this_loop; ++i) {
 
-      PhotonPacket &photon = input_buffer[i];
+      PhotonPacket photon;
 
       photon.set_type(PHOTONTYPE_PRIMARY);
       photon.set_scatter_counter(0);
@@ -181,17 +195,13 @@ public:
       double frequency;
 
 
-      if (typeid(TextFilePhotonSourceDistribution).name() == typeid(_photon_source_distribution).name() ||
-          typeid(ArepoSnapshotPhotonSourceDistribution).name() == typeid(_photon_source_distribution).name() ||
-          typeid(HDF5PhotonSourceDistribution).name() == typeid(_photon_source_distribution).name() || 
-          typeid(MixedDrivingPhotonSourceDistribution).name() == typeid(_photon_source_distribution).name() ) {
+      if (use_source_frequency) {
         frequency = _photon_source_distribution.get_photon_frequency(
           _random_generators[thread_id], _photon_source.get_index(source_index));
         //photon.set_weight(_photon_source_distribution.get_photon_weighting(_photon_source.get_index(source_index)));
         photon.set_weight(_discrete_photon_weight);
       } else {
-        frequency = _photon_source_spectrum.get_random_frequency(
-            _random_generators[thread_id]);
+        frequency = frequencies[i];
         // we currently assume equal weight for all photons
         photon.set_weight(_discrete_photon_weight);
       }
@@ -206,19 +216,22 @@ public:
       if (_statistics != nullptr) {
           _statistics->injected_photon(photon);
         }
+      double cross_sections[NUMBER_OF_IONNAMES];
+      double dust_opacity;
+      _cross_sections.get_cross_sections(frequency, cross_sections,
+                                         dust_opacity);
       for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
-        double sigma = _cross_sections.get_cross_section(ion, frequency);
+        double sigma = cross_sections[ion];
 #ifndef VARIABLE_ABUNDANCES
         if (ion != ION_H_n) {
           sigma *= _abundances.get_abundance(get_element(ion));
         }
 #endif
         photon.set_photoionization_cross_section(ion, sigma);
-        photon.set_dust_opacity(_cross_sections.get_dust_opacity(frequency));
-
-
-
       }
+      photon.set_dust_opacity(dust_opacity);
+
+      input_buffer.set_photon(i, photon);
     }
 
     // add to the queue of the corresponding thread
@@ -233,7 +246,7 @@ public:
     //  - subgrid
     // (the output buffers belong to the subgrid and do not count as a
     // dependency)
-    new_task.set_dependency(subgrid.get_dependency());
+    new_task.set_dependency(subgrid.get_traversal_dependency());
 
     queues_to_add[0] = subgrid.get_owning_thread();
     tasks_to_add[0] = task_index;
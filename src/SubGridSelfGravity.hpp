@@ -0,0 +1,141 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file SubGridSelfGravity.hpp
+ *
+ * @brief Self-gravity of the gas in a task-based radiation hydrodynamics
+ * simulation.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#ifndef SUBGRIDSELFGRAVITY_HPP
+#define SUBGRIDSELFGRAVITY_HPP
+
+#include "AtomicValue.hpp"
+#include "Configuration.hpp"
+#include "DensitySubGridCreator.hpp"
+#include "HydroDensitySubGrid.hpp"
+
+#include <vector>
+
+/*! @brief Value of Newton's gravitational constant used for the self-gravity
+ *  of the gas (in m^3 kg^-1 s^-2). This is the value that was hard-coded in
+ *  the original Barnes-Hut tree, which differs slightly from
+ *  PHYSICALCONSTANT_NEWTON_CONSTANT. */
+#define SUBGRIDSELFGRAVITY_NEWTON_CONSTANT 6.6743e-11
+
+/**
+ * @brief Compute the self-gravity of the gas in all subgrids.
+ *
+ * The solver is only built during the first call: the cell positions never
+ * change, so that subsequent calls only need to update the masses.
+ *
+ * The gravitational potential stored in every cell is a potential energy:
+ * half the cell mass times the gravitational potential at the position of the
+ * cell, so that the sum over all cells is the total potential energy of the
+ * gas. This is the same convention as used by the original Barnes-Hut tree,
+ * and is what the virial check for sink formation in
+ * SinkStarPhotonSourceDistribution expects.
+ *
+ * @param grid_creator Subgrids.
+ * @param solver Self-gravity solver (LinearOctreeGravity or FFTPoissonSolver).
+ * @param add_acceleration Add the self-gravity acceleration to the existing
+ * acceleration (due to an external potential) rather than replacing it?
+ * @param reset_potential Reset the gravitational potential before adding the
+ * self-gravity contribution?
+ */
+template < typename _solver_ >
+inline void
+compute_self_gravity(DensitySubGridCreator< HydroDensitySubGrid > &grid_creator,
+                     _solver_ &solver, const bool add_acceleration,
+                     const bool reset_potential) {
+
+  const size_t number_of_subgrids = grid_creator.number_of_original_subgrids();
+  std::vector< size_t > offsets(number_of_subgrids + 1, 0);
+  for (size_t igrid = 0; igrid < number_of_subgrids; ++igrid) {
+    offsets[igrid + 1] = offsets[igrid] +
+                         (*grid_creator.get_subgrid(igrid)).get_number_of_cells();
+  }
+  const size_t number_of_cells = offsets.back();
+  const bool build = (solver.get_number_of_particles() != number_of_cells);
+
+  std::vector< CoordinateVector<> > positions(build ? number_of_cells : 0);
+  std::vector< double > masses(number_of_cells);
+  AtomicValue< size_t > igrid(0);
+#ifdef HAVE_OPENMP
+#pragma omp parallel default(shared)
+#endif
+  while (igrid.value() < number_of_subgrids) {
+    const size_t this_igrid = igrid.post_increment();
+    if (this_igrid < number_of_subgrids) {
+      HydroDensitySubGrid &subgrid = *grid_creator.get_subgrid(this_igrid);
+      size_t index = offsets[this_igrid];
+      for (auto it = subgrid.hydro_begin(); it != subgrid.hydro_end(); ++it) {
+        if (build) {
+          positions[index] = it.get_cell_midpoint();
+        }
+        masses[index] = it.get_hydro_variables().get_conserved_mass();
+        ++index;
+      }
+    }
+  }
+
+  if (build) {
+    solver.build(positions, masses);
+  } else {
+    solver.update_masses(masses);
+  }
+
+  std::vector< CoordinateVector<> > accelerations;
+  std::vector< double > potentials;
+  solver.compute_accelerations(accelerations, potentials);
+
+  igrid.set(0);
+#ifdef HAVE_OPENMP
+#pragma omp parallel default(shared)
+#endif
+  while (igrid.value() < number_of_subgrids) {
+    const size_t this_igrid = igrid.post_increment();
+    if (this_igrid < number_of_subgrids) {
+      HydroDensitySubGrid &subgrid = *grid_creator.get_subgrid(this_igrid);
+      size_t index = offsets[this_igrid];
+      for (auto it = subgrid.hydro_begin(); it != subgrid.hydro_end(); ++it) {
+        HydroVariables &hydro_variables = it.get_hydro_variables();
+        if (add_acceleration) {
+          hydro_variables.set_gravitational_acceleration(
+              hydro_variables.get_gravitational_acceleration() +
+              accelerations[index]);
+        } else {
+          hydro_variables.set_gravitational_acceleration(accelerations[index]);
+        }
+        if (reset_potential) {
+          hydro_variables.set_gravitational_potential(0.);
+        }
+        // the potential energy of every pair of cells is shared evenly, as in
+        // the original Barnes-Hut tree
+        hydro_variables.set_gravitational_potential(
+            hydro_variables.get_gravitational_potential() +
+            0.5 * hydro_variables.get_conserved_mass() * potentials[index]);
+        ++index;
+      }
+    }
+  }
+}
+
+#endif // SUBGRIDSELFGRAVITY_HPP
@@ -26,6 +26,13 @@
 #ifndef SUPERNOVAHANDLER_HPP
 #define SUPERNOVAHANDLER_HPP
 
+#include "DensitySubGridCreator.hpp"
+#include "Hydro.hpp"
+#include "HydroDensitySubGrid.hpp"
+
+#include <cmath>
+#include <tuple>
+#include <vector>
 
 /**
  * @brief Handler with useful functions.
@@ -54,124 +61,185 @@ public:
 
   }
 
-  inline std::tuple<double,double,double,double> get_r_inj(DensitySubGridCreator< HydroDensitySubGrid > *grid_creator,
-                                         CoordinateVector<> sne_loc) {
-
-
-
-      HydroDensitySubGrid &subgrid = *grid_creator->get_subgrid(sne_loc);
-
-      double cell_vol =  subgrid.get_cell(sne_loc).get_volume();
-
-
-      double dx = std::pow(cell_vol,1./3.);
-
-      double r_run = 4*dx;
-      double num_cells;
-      std::vector<std::pair<uint_fast32_t,uint_fast32_t>> vec;
-
-
-      vec = grid_creator->cells_within_radius(sne_loc,r_run);
-
-
-      double mtot = 0.0;
-      for (auto & pair : vec) {
-        HydroDensitySubGrid &subgrid = *grid_creator->get_subgrid(std::get<0>(pair));
-        mtot = mtot + (subgrid.hydro_begin() + std::get<1>(pair)).get_hydro_variables().get_conserved_mass();
+  /**
+   * @brief Get the injection radius for a supernova at the given position.
+   *
+   * The injection radius is the smallest radius (starting from 4 cells and
+   * growing in steps of a quarter cell) that contains at least 1 solar mass.
+   * The sphere is grown incrementally, so that every cell is only visited
+   * once.
+   *
+   * @param grid_creator Subgrids.
+   * @param sne_loc Position of the supernova (in m).
+   * @return Injection radius (in m), Sedov-Taylor radius (in m), average
+   * number density within the injection radius (in cm^-3) and number of cells
+   * within the injection radius.
+   */
+  inline std::tuple< double, double, double, double >
+  get_r_inj(DensitySubGridCreator< HydroDensitySubGrid > *grid_creator,
+            CoordinateVector<> sne_loc) {
+
+    HydroDensitySubGrid &subgrid = *grid_creator->get_subgrid(sne_loc);
+    const double cell_vol = subgrid.get_cell(sne_loc).get_volume();
+    const double dx = std::pow(cell_vol, 1. / 3.);
+
+    double r_run = 4 * dx;
+    double mtot = 0.0;
+    uint_fast32_t num_cells = 0;
+    DensitySubGridCreator< HydroDensitySubGrid >::SphereSearch search(
+        *grid_creator, sne_loc);
+    const auto add_cell = [grid_creator, &mtot, &num_cells](
+                              const uint_fast32_t subgrid_index,
+                              const uint_fast32_t cell_index,
+                              const double distance) {
+      HydroDensitySubGrid &subgrid = *grid_creator->get_subgrid(subgrid_index);
+      mtot += (subgrid.hydro_begin() + cell_index)
+                  .get_hydro_variables()
+                  .get_conserved_mass();
+      ++num_cells;
+    };
+
+    search.grow(r_run, add_cell);
+    if (mtot > 1.988e+33) {
+      double inj_vol = 1.3333 * 3.14159265 * std::pow(r_run, 3.0);
+      double rho = mtot / inj_vol;
+      double nbar = 1.e-6 * rho / 1.67262192e-27;
+      double r_st = 3.086e+16 * 19.1 *
+                    std::pow(_sne_energy * 1.e-44, 5. / 17.) *
+                    std::pow(nbar, -7. / 17);
+      return std::make_tuple(r_run, r_st, nbar, 268.);
+    }
+
+    // stop growing if the sphere contains the entire (non-periodic) box
+    while (mtot < 1.988e+33 && !search.is_complete()) {
+      r_run = r_run + (0.25 * dx);
+      search.grow(r_run, add_cell);
+    }
+
+    double inj_vol = 1.3333 * 3.14159265 * std::pow(r_run, 3.0);
+    double rho = mtot / inj_vol;
+    double nbar = 1.e-6 * rho / 1.67262192e-27;
+    double r_st = 3.086e+16 * 19.1 * std::pow(_sne_energy * 1.e-44, 5. / 17.) *
+                  std::pow(nbar, -7. / 17);
+    return std::make_tuple(r_run, r_st, nbar, double(num_cells));
+  }
 
-      }
-      if (mtot > 1.988e+33) {
-        double inj_vol = 1.3333*3.14159265*std::pow(r_run,3.0);
-        double rho = mtot/inj_vol;
-        double nbar = 1.e-6*rho/1.67262192e-27;
-        double r_st = 3.086e+16 * 19.1 * std::pow(_sne_energy*1.e-44,5./17.) * std::pow(nbar,-7./17);
-        return std::make_tuple(r_run,r_st,nbar,268.);
-      }
+  /**
+   * @brief Get the injection radii for all supernovae in the given list.
+   *
+   * The supernovae are handled in parallel. The results are appended to the
+   * given vectors.
+   *
+   * @param grid_creator Subgrids.
+   * @param sne_locs Positions of the supernovae (in m).
+   * @param r_inj Injection radii (in m).
+   * @param r_st Sedov-Taylor radii (in m).
+   * @param nbar Average number densities within the injection radii
+   * (in cm^-3).
+   * @param num_cells Number of cells within the injection radii.
+   */
+  inline void
+  get_r_inj(DensitySubGridCreator< HydroDensitySubGrid > *grid_creator,
+            const std::vector< CoordinateVector<> > &sne_locs,
+            std::vector< double > &r_inj, std::vector< double > &r_st,
+            std::vector< double > &nbar, std::vector< double > &num_cells) {
+
+    const size_t offset = r_inj.size();
+    const int_fast64_t number_of_sne = sne_locs.size();
+    r_inj.resize(offset + number_of_sne);
+    r_st.resize(offset + number_of_sne);
+    nbar.resize(offset + number_of_sne);
+    num_cells.resize(offset + number_of_sne);
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared) schedule(dynamic)
+#endif
+    for (int_fast64_t i = 0; i < number_of_sne; ++i) {
+      std::tie(r_inj[offset + i], r_st[offset + i], nbar[offset + i],
+               num_cells[offset + i]) = get_r_inj(grid_creator, sne_locs[i]);
+    }
+  }
 
-      while (mtot < 1.988e+33) {
-        r_run = r_run+(0.25*dx);
-        vec = grid_creator->cells_within_radius(sne_loc,r_run);
-        mtot = 0.0;
-        for (auto & pair : vec) {
-          HydroDensitySubGrid &subgrid = *grid_creator->get_subgrid(std::get<0>(pair));
-          double cell_mass = (subgrid.hydro_begin() + std::get<1>(pair)).get_hydro_variables().get_conserved_mass();
-          mtot = mtot + cell_mass;
+  /**
+   * @brief Inject the energy or momentum of a supernova into the cells of the
+   * given subgrid that are within the injection radius.
+   *
+   * Subgrids that do not overlap with the injection sphere are skipped
+   * without looping over their cells. If the injection spheres of multiple
+   * supernovae overlap, the thermal energy of all of them is added up.
+   *
+   * @param subgrid Subgrid.
+   * @param hydro Hydro instance to use.
+   * @param position Position of the supernova (in m).
+   * @param r_inj Injection radius (in m).
+   * @param r_st Sedov-Taylor radius (in m).
+   * @param nbar Average number density within the injection radius
+   * (in cm^-3).
+   * @param numcells Number of cells within the injection radius.
+   */
+  inline void inject_sne(HydroDensitySubGrid &subgrid, Hydro &hydro,
+                         CoordinateVector< double > position, double r_inj,
+                         double r_st, double nbar, int numcells) {
+
+    // distance between the supernova and the subgrid box
+    const Box<> box = subgrid.get_box();
+    double box_distance2 = 0.;
+    for (uint_fast8_t i = 0; i < 3; ++i) {
+      const double d = std::max(
+          0., std::max(box.get_anchor()[i] - position[i],
+                       position[i] - box.get_anchor()[i] - box.get_sides()[i]));
+      box_distance2 += d * d;
+    }
+    if (box_distance2 >= r_inj * r_inj) {
+      return;
+    }
+
+    for (auto cellit = subgrid.hydro_begin(); cellit != subgrid.hydro_end();
+         ++cellit) {
+
+      CoordinateVector<> cellpos = cellit.get_cell_midpoint();
+
+      // is cell within injeciton radius of SNe?
+      if ((cellpos - position).norm() < r_inj) {
+        if (cellit.get_hydro_variables().get_primitives_density() == 0) {
+          // dont add energy to cell without mass...
+          continue;
         }
-      }
-    
-    num_cells = vec.size();
-    double inj_vol = 1.3333*3.14159265*std::pow(r_run,3.0);
-    double rho = mtot/inj_vol;
-    double nbar = 1.e-6*rho/1.67262192e-27;
-    double r_st = 3.086e+16 * 19.1 * std::pow(_sne_energy*1.e-44,5./17.) * std::pow(nbar,-7./17);
-    return std::make_tuple(r_run, r_st, nbar, num_cells);
-
-   }
-
-
-
-   inline void inject_sne(HydroDensitySubGrid &subgrid, Hydro &hydro, CoordinateVector<double> position,
-         double r_inj, double r_st, double nbar, int numcells) {
-
-      for (auto cellit = subgrid.hydro_begin();
-           cellit != subgrid.hydro_end(); ++cellit) {
-
-           CoordinateVector<> cellpos = cellit.get_cell_midpoint();
-
-          // is cell within injeciton radius of SNe?
-           if ((cellpos - position).norm() < r_inj) {
-                if (cellit.get_hydro_variables().get_primitives_density() == 0) {
-                    //dont add energy to cell without mass...
-                    return;
-                }
-             double dx = std::pow(cellit.get_volume(),1./3.);
-             if (r_st < 4.*dx) {
-
-//Not resolving ST radius, do momentum injection
-              CoordinateVector<> vel_prior =
-                       cellit.get_hydro_variables().get_primitives_velocity();
-
-                // Blondin et al
-               double mom_to_inj = 2.6e5*std::pow(nbar,-2./17) * std::pow(_sne_energy*1.e-44,16./17.);
-               // Msol km/s to kg m/s
-               mom_to_inj = mom_to_inj * 2.e30 * 1.e3;
+        double dx = std::pow(cellit.get_volume(), 1. / 3.);
+        if (r_st < 4. * dx) {
 
-               double m_tot = (nbar*1e6*1.67e-27)*(4.*3.14159265*std::pow(r_inj,3)/3.);
+          // Not resolving ST radius, do momentum injection
+          CoordinateVector<> vel_prior =
+              cellit.get_hydro_variables().get_primitives_velocity();
 
-               double vel_to_inj = mom_to_inj/m_tot;
+          // Blondin et al
+          double mom_to_inj = 2.6e5 * std::pow(nbar, -2. / 17) *
+                              std::pow(_sne_energy * 1.e-44, 16. / 17.);
+          // Msol km/s to kg m/s
+          mom_to_inj = mom_to_inj * 2.e30 * 1.e3;
 
-               CoordinateVector<> direction = (cellpos-position)/((cellpos-position).norm());
+          double m_tot = (nbar * 1e6 * 1.67e-27) *
+                         (4. * 3.14159265 * std::pow(r_inj, 3) / 3.);
 
-               CoordinateVector<> vel_new = vel_prior + vel_to_inj*direction;
+          double vel_to_inj = mom_to_inj / m_tot;
 
-               cellit.get_hydro_variables().set_primitives_velocity(vel_new);
+          CoordinateVector<> direction =
+              (cellpos - position) / ((cellpos - position).norm());
 
+          CoordinateVector<> vel_new = vel_prior + vel_to_inj * direction;
 
-           //    double density = cellit.get_hydro_variables().get_primitives_density();
+          cellit.get_hydro_variables().set_primitives_velocity(vel_new);
 
-             //  double xH = cellit.get_ionization_variables().get_ionic_fraction(ION_H_n);
-
-
-              // double pressure = 8254.397014*1.e4*density*2./(1.+xH);
-
-              //cellit.get_ionization_variables().set_temperature(1.e4);
-
-             // cellit.get_hydro_variables().set_primitives_pressure(pressure);
-
-              hydro.set_conserved_variables(cellit.get_hydro_variables(), cellit.get_volume());
-
-             }
-             else {
-               cellit.get_hydro_variables().set_energy_term(_sne_energy/numcells);
-             }
-           }
+          hydro.set_conserved_variables(cellit.get_hydro_variables(),
+                                        cellit.get_volume());
 
+        } else {
+          cellit.get_hydro_variables().set_energy_term(
+              cellit.get_hydro_variables().get_energy_term() +
+              _sne_energy / numcells);
         }
-
-
-
-
-   }
+      }
+    }
+  }
 
   /**
    * @brief Destructor.
@@ -0,0 +1,302 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file TabulatedCrossSections.hpp
+ *
+ * @brief CrossSections implementation that tabulates another CrossSections
+ * implementation on a regular frequency grid.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#ifndef TABULATEDCROSSSECTIONS_HPP
+#define TABULATEDCROSSSECTIONS_HPP
+
+#include "CrossSections.hpp"
+#include "Error.hpp"
+#include "Log.hpp"
+#include "ParameterFile.hpp"
+
+#include <cmath>
+#include <vector>
+
+/*! @brief Number of values stored per frequency node: one cross section per
+ *  ion and the dust opacity. */
+#define TABULATEDCROSSSECTIONS_NUMBER_OF_COLUMNS (NUMBER_OF_IONNAMES + 1)
+
+/**
+ * @brief CrossSections implementation that tabulates another CrossSections
+ * implementation on a regular frequency grid.
+ *
+ * The table uses linearly spaced frequency nodes, so that the bin containing a
+ * frequency can be found with a single multiplication. All cross sections and
+ * the dust opacity for a node are stored contiguously, so that a single call
+ * to get_cross_sections() only touches two table rows and does a linear
+ * interpolation between them.
+ *
+ * Linear interpolation is inaccurate in bins that contain an ionization
+ * threshold or a discontinuity in the slope of the underlying functions. When
+ * the table is constructed, we therefore compare the interpolated values at
+ * 1/4, 1/2 and 3/4 of every bin with the exact values. Bins in which the
+ * relative difference exceeds the requested tolerance are flagged, and
+ * frequencies in these bins (and frequencies outside the tabulated range) are
+ * passed on to the underlying implementation.
+ */
+class TabulatedCrossSections : public CrossSections {
+private:
+  /*! @brief Underlying CrossSections implementation (owned by this object). */
+  const CrossSections *_cross_sections;
+
+  /*! @brief Lowest tabulated frequency (in Hz). */
+  const double _minimum_frequency;
+
+  /*! @brief Inverse of the frequency step between two nodes (in Hz^-1). */
+  const double _inverse_frequency_step;
+
+  /*! @brief Number of bins in the table. */
+  const uint_fast32_t _number_of_bins;
+
+  /*! @brief Tabulated values, one row of
+   *  TABULATEDCROSSSECTIONS_NUMBER_OF_COLUMNS values per node. */
+  std::vector< double > _table;
+
+  /*! @brief Flags for bins that need to be evaluated exactly. */
+  std::vector< bool > _exact_bins;
+
+  /*! @brief Number of bins that need to be evaluated exactly. */
+  uint_fast32_t _number_of_exact_bins;
+
+  /**
+   * @brief Fill a row of values with the exact values for the given frequency.
+   *
+   * @param energy Photon frequency (in Hz).
+   * @param row Row to fill (should have size
+   * TABULATEDCROSSSECTIONS_NUMBER_OF_COLUMNS).
+   */
+  inline void get_exact_row(const double energy, double *row) const {
+    _cross_sections->get_cross_sections(energy, row, row[NUMBER_OF_IONNAMES]);
+  }
+
+  /**
+   * @brief Get the bin containing the given frequency.
+   *
+   * @param energy Photon frequency (in Hz).
+   * @param fraction Variable to store the relative position of the frequency
+   * within the bin in.
+   * @return Index of the bin, or _number_of_bins if the frequency is outside
+   * the table range or in a bin that needs to be evaluated exactly.
+   */
+  inline uint_fast32_t get_bin(const double energy, double &fraction) const {
+    const double u = (energy - _minimum_frequency) * _inverse_frequency_step;
+    if (u < 0. || u >= _number_of_bins) {
+      return _number_of_bins;
+    }
+    const uint_fast32_t ibin = u;
+    if (_exact_bins[ibin]) {
+      return _number_of_bins;
+    }
+    fraction = u - ibin;
+    return ibin;
+  }
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param cross_sections Underlying CrossSections implementation. The
+   * TabulatedCrossSections object takes ownership of the pointer.
+   * @param minimum_frequency Lowest tabulated frequency (in Hz).
+   * @param maximum_frequency Highest tabulated frequency (in Hz).
+   * @param number_of_bins Number of bins in the table.
+   * @param tolerance Maximum allowed relative difference between the
+   * interpolated and the exact values.
+   * @param log Log to write logging info to.
+   */
+  inline TabulatedCrossSections(const CrossSections *cross_sections,
+                                const double minimum_frequency,
+                                const double maximum_frequency,
+                                const uint_fast32_t number_of_bins,
+                                const double tolerance, Log *log = nullptr)
+      : _cross_sections(cross_sections), _minimum_frequency(minimum_frequency),
+        _inverse_frequency_step(number_of_bins /
+                                (maximum_frequency - minimum_frequency)),
+        _number_of_bins(number_of_bins),
+        _table((number_of_bins + 1) * TABULATEDCROSSSECTIONS_NUMBER_OF_COLUMNS),
+        _exact_bins(number_of_bins, false), _number_of_exact_bins(0) {
+
+    if (maximum_frequency <= minimum_frequency) {
+      cmac_error("Invalid frequency range for cross section table: [%g, %g]!",
+                 minimum_frequency, maximum_frequency);
+    }
+    if (number_of_bins == 0) {
+      cmac_error("Cross section table needs at least 1 bin!");
+    }
+
+    const double frequency_step = 1. / _inverse_frequency_step;
+    for (uint_fast32_t inode = 0; inode < number_of_bins + 1; ++inode) {
+      get_exact_row(minimum_frequency + inode * frequency_step,
+                    &_table[inode * TABULATEDCROSSSECTIONS_NUMBER_OF_COLUMNS]);
+    }
+
+    // check the interpolation error within each bin
+    double exact[TABULATEDCROSSSECTIONS_NUMBER_OF_COLUMNS];
+    for (uint_fast32_t ibin = 0; ibin < number_of_bins; ++ibin) {
+      const double *low = &_table[ibin * TABULATEDCROSSSECTIONS_NUMBER_OF_COLUMNS];
+      const double *high = low + TABULATEDCROSSSECTIONS_NUMBER_OF_COLUMNS;
+      for (uint_fast32_t i = 1; i < 4 && !_exact_bins[ibin]; ++i) {
+        const double fraction = 0.25 * i;
+        get_exact_row(minimum_frequency + (ibin + fraction) * frequency_step,
+                      exact);
+        for (uint_fast32_t j = 0; j < TABULATEDCROSSSECTIONS_NUMBER_OF_COLUMNS;
+             ++j) {
+          const double interpolated =
+              (1. - fraction) * low[j] + fraction * high[j];
+          if (std::abs(interpolated - exact[j]) > tolerance * std::abs(exact[j])) {
+            _exact_bins[ibin] = true;
+            ++_number_of_exact_bins;
+            break;
+          }
+        }
+      }
+    }
+
+    if (log) {
+      log->write_status("Tabulated cross sections using ", number_of_bins,
+                        " bins between ", minimum_frequency, " Hz and ",
+                        maximum_frequency, " Hz; ", _number_of_exact_bins,
+                        " bins require an exact evaluation.");
+    }
+  }
+
+  /**
+   * @brief ParameterFile constructor.
+   *
+   * Parameters are:
+   *  - table minimum frequency: Lowest tabulated frequency (default: 13.6 eV)
+   *  - table maximum frequency: Highest tabulated frequency (default: 100. eV)
+   *  - table number of bins: Number of bins in the table (default: 4096)
+   *  - table tolerance: Maximum allowed relative difference between the
+   *    interpolated and the exact values (default: 1.e-4)
+   *
+   * @param cross_sections Underlying CrossSections implementation. The
+   * TabulatedCrossSections object takes ownership of the pointer.
+   * @param params ParameterFile to read from.
+   * @param log Log to write logging info to.
+   */
+  inline TabulatedCrossSections(const CrossSections *cross_sections,
+                                ParameterFile &params, Log *log = nullptr)
+      : TabulatedCrossSections(
+            cross_sections,
+            params.get_physical_value< QUANTITY_FREQUENCY >(
+                "CrossSections:table minimum frequency", "13.6 eV"),
+            params.get_physical_value< QUANTITY_FREQUENCY >(
+                "CrossSections:table maximum frequency", "100. eV"),
+            params.get_value< uint_fast32_t >(
+                "CrossSections:table number of bins", 4096),
+            params.get_value< double >("CrossSections:table tolerance", 1.e-4),
+            log) {}
+
+  /**
+   * @brief Destructor.
+   *
+   * Deletes the underlying CrossSections implementation.
+   */
+  virtual ~TabulatedCrossSections() { delete _cross_sections; }
+
+  /**
+   * @brief Get the number of bins that need to be evaluated exactly.
+   *
+   * @return Number of bins in which linear interpolation is not accurate
+   * enough.
+   */
+  inline uint_fast32_t get_number_of_exact_bins() const {
+    return _number_of_exact_bins;
+  }
+
+  /**
+   * @brief Get the photoionization cross section for the given ion at the
+   * given photon energy.
+   *
+   * @param ion IonName for a valid ion.
+   * @param energy Photon frequency (in Hz).
+   * @return Photoionization cross section (in m^2).
+   */
+  virtual double get_cross_section(const int_fast32_t ion,
+                                   const double energy) const {
+    double fraction;
+    const uint_fast32_t ibin = get_bin(energy, fraction);
+    if (ibin == _number_of_bins) {
+      return _cross_sections->get_cross_section(ion, energy);
+    }
+    const double *low =
+        &_table[ibin * TABULATEDCROSSSECTIONS_NUMBER_OF_COLUMNS];
+    return (1. - fraction) * low[ion] +
+           fraction * low[ion + TABULATEDCROSSSECTIONS_NUMBER_OF_COLUMNS];
+  }
+
+  /**
+   * @brief Get the dust opacity at the given photon energy.
+   *
+   * @param energy Photon frequency (in Hz).
+   * @return Dust opacity.
+   */
+  virtual double get_dust_opacity(const double energy) const {
+    double fraction;
+    const uint_fast32_t ibin = get_bin(energy, fraction);
+    if (ibin == _number_of_bins) {
+      return _cross_sections->get_dust_opacity(energy);
+    }
+    const double *low =
+        &_table[ibin * TABULATEDCROSSSECTIONS_NUMBER_OF_COLUMNS];
+    return (1. - fraction) * low[NUMBER_OF_IONNAMES] +
+           fraction * low[NUMBER_OF_IONNAMES +
+                          TABULATEDCROSSSECTIONS_NUMBER_OF_COLUMNS];
+  }
+
+  /**
+   * @brief Get the photoionization cross sections for all ions and the dust
+   * opacity at the given photon energy.
+   *
+   * @param energy Photon frequency (in Hz).
+   * @param cross_sections Array to store the photoionization cross sections
+   * for all ions in (in m^2).
+   * @param dust_opacity Variable to store the dust opacity in.
+   */
+  virtual void get_cross_sections(const double energy,
+                                  double cross_sections[NUMBER_OF_IONNAMES],
+                                  double &dust_opacity) const {
+    double fraction;
+    const uint_fast32_t ibin = get_bin(energy, fraction);
+    if (ibin == _number_of_bins) {
+      _cross_sections->get_cross_sections(energy, cross_sections,
+                                          dust_opacity);
+      return;
+    }
+    const double *low =
+        &_table[ibin * TABULATEDCROSSSECTIONS_NUMBER_OF_COLUMNS];
+    const double *high = low + TABULATEDCROSSSECTIONS_NUMBER_OF_COLUMNS;
+    for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+      cross_sections[ion] =
+          (1. - fraction) * low[ion] + fraction * high[ion];
+    }
+    dust_opacity = (1. - fraction) * low[NUMBER_OF_IONNAMES] +
+                   fraction * high[NUMBER_OF_IONNAMES];
+  }
+};
+
+#endif // TABULATEDCROSSSECTIONS_HPP
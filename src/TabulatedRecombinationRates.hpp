@@ -0,0 +1,243 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file TabulatedRecombinationRates.hpp
+ *
+ * @brief RecombinationRates implementation that tabulates another
+ * RecombinationRates implementation on a regular logarithmic temperature grid.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#ifndef TABULATEDRECOMBINATIONRATES_HPP
+#define TABULATEDRECOMBINATIONRATES_HPP
+
+#include "Error.hpp"
+#include "Log.hpp"
+#include "ParameterFile.hpp"
+#include "RecombinationRates.hpp"
+
+#include <cmath>
+#include <vector>
+
+/**
+ * @brief RecombinationRates implementation that tabulates another
+ * RecombinationRates implementation on a regular logarithmic temperature grid.
+ *
+ * The table uses nodes that are linearly spaced in \f$\log(T)\f$, and stores
+ * the rates for all ions for a node contiguously. Rates are linearly
+ * interpolated in \f$\log(T)\f$.
+ *
+ * Some fits to recombination rates are piecewise functions of the temperature,
+ * which makes linear interpolation inaccurate in the bins that contain a
+ * transition between two pieces. When the table is constructed, we therefore
+ * compare the interpolated values at 1/4, 1/2 and 3/4 of every bin with the
+ * exact values. Bins in which the relative difference exceeds the requested
+ * tolerance are flagged, and temperatures in these bins (and temperatures
+ * outside the tabulated range) are passed on to the underlying implementation.
+ */
+class TabulatedRecombinationRates : public RecombinationRates {
+private:
+  /*! @brief Underlying RecombinationRates implementation (owned by this
+   *  object). */
+  const RecombinationRates *_recombination_rates;
+
+  /*! @brief Natural logarithm of the lowest tabulated temperature. */
+  const double _minimum_log_temperature;
+
+  /*! @brief Inverse of the step in natural logarithm of the temperature
+   *  between two nodes. */
+  const double _inverse_log_temperature_step;
+
+  /*! @brief Number of bins in the table. */
+  const uint_fast32_t _number_of_bins;
+
+  /*! @brief Tabulated values, one row of NUMBER_OF_IONNAMES values per node. */
+  std::vector< double > _table;
+
+  /*! @brief Flags for bins that need to be evaluated exactly. */
+  std::vector< bool > _exact_bins;
+
+  /*! @brief Number of bins that need to be evaluated exactly. */
+  uint_fast32_t _number_of_exact_bins;
+
+  /**
+   * @brief Fill a row of values with the exact values for the given
+   * temperature.
+   *
+   * @param temperature Temperature (in K).
+   * @param row Row to fill (should have size NUMBER_OF_IONNAMES).
+   */
+  inline void get_exact_row(const double temperature, double *row) const {
+    for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+      row[ion] = _recombination_rates->get_recombination_rate(ion, temperature);
+    }
+  }
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param recombination_rates Underlying RecombinationRates implementation.
+   * The TabulatedRecombinationRates object takes ownership of the pointer.
+   * @param minimum_temperature Lowest tabulated temperature (in K).
+   * @param maximum_temperature Highest tabulated temperature (in K).
+   * @param number_of_bins Number of bins in the table.
+   * @param tolerance Maximum allowed relative difference between the
+   * interpolated and the exact values.
+   * @param log Log to write logging info to.
+   */
+  inline TabulatedRecombinationRates(
+      const RecombinationRates *recombination_rates,
+      const double minimum_temperature, const double maximum_temperature,
+      const uint_fast32_t number_of_bins, const double tolerance,
+      Log *log = nullptr)
+      : _recombination_rates(recombination_rates),
+        _minimum_log_temperature(std::log(minimum_temperature)),
+        _inverse_log_temperature_step(
+            number_of_bins /
+            std::log(maximum_temperature / minimum_temperature)),
+        _number_of_bins(number_of_bins),
+        _table((number_of_bins + 1) * NUMBER_OF_IONNAMES),
+        _exact_bins(number_of_bins, false), _number_of_exact_bins(0) {
+
+    if (minimum_temperature <= 0. ||
+        maximum_temperature <= minimum_temperature) {
+      cmac_error(
+          "Invalid temperature range for recombination rate table: [%g, %g]!",
+          minimum_temperature, maximum_temperature);
+    }
+    if (number_of_bins == 0) {
+      cmac_error("Recombination rate table needs at least 1 bin!");
+    }
+
+    const double log_temperature_step = 1. / _inverse_log_temperature_step;
+    for (uint_fast32_t inode = 0; inode < number_of_bins + 1; ++inode) {
+      get_exact_row(
+          std::exp(_minimum_log_temperature + inode * log_temperature_step),
+          &_table[inode * NUMBER_OF_IONNAMES]);
+    }
+
+    // check the interpolation error within each bin
+    double exact[NUMBER_OF_IONNAMES];
+    for (uint_fast32_t ibin = 0; ibin < number_of_bins; ++ibin) {
+      const double *low = &_table[ibin * NUMBER_OF_IONNAMES];
+      const double *high = low + NUMBER_OF_IONNAMES;
+      for (uint_fast32_t i = 1; i < 4 && !_exact_bins[ibin]; ++i) {
+        const double fraction = 0.25 * i;
+        get_exact_row(std::exp(_minimum_log_temperature +
+                               (ibin + fraction) * log_temperature_step),
+                      exact);
+        for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+          const double interpolated =
+              (1. - fraction) * low[ion] + fraction * high[ion];
+          if (std::abs(interpolated - exact[ion]) >
+              tolerance * std::abs(exact[ion])) {
+            _exact_bins[ibin] = true;
+            ++_number_of_exact_bins;
+            break;
+          }
+        }
+      }
+    }
+
+    if (log) {
+      log->write_status("Tabulated recombination rates using ", number_of_bins,
+                        " bins between ", minimum_temperature, " K and ",
+                        maximum_temperature, " K; ", _number_of_exact_bins,
+                        " bins require an exact evaluation.");
+    }
+  }
+
+  /**
+   * @brief ParameterFile constructor.
+   *
+   * Parameters are:
+   *  - table minimum temperature: Lowest tabulated temperature
+   *    (default: 1000. K)
+   *  - table maximum temperature: Highest tabulated temperature
+   *    (default: 1.e5 K)
+   *  - table number of bins: Number of bins in the table (default: 400)
+   *  - table tolerance: Maximum allowed relative difference between the
+   *    interpolated and the exact values (default: 1.e-4)
+   *
+   * @param recombination_rates Underlying RecombinationRates implementation.
+   * The TabulatedRecombinationRates object takes ownership of the pointer.
+   * @param params ParameterFile to read from.
+   * @param log Log to write logging info to.
+   */
+  inline TabulatedRecombinationRates(
+      const RecombinationRates *recombination_rates, ParameterFile &params,
+      Log *log = nullptr)
+      : TabulatedRecombinationRates(
+            recombination_rates,
+            params.get_physical_value< QUANTITY_TEMPERATURE >(
+                "RecombinationRates:table minimum temperature", "1000. K"),
+            params.get_physical_value< QUANTITY_TEMPERATURE >(
+                "RecombinationRates:table maximum temperature", "1.e5 K"),
+            params.get_value< uint_fast32_t >(
+                "RecombinationRates:table number of bins", 400),
+            params.get_value< double >("RecombinationRates:table tolerance",
+                                       1.e-4),
+            log) {}
+
+  /**
+   * @brief Destructor.
+   *
+   * Deletes the underlying RecombinationRates implementation.
+   */
+  virtual ~TabulatedRecombinationRates() { delete _recombination_rates; }
+
+  /**
+   * @brief Get the number of bins that need to be evaluated exactly.
+   *
+   * @return Number of bins in which linear interpolation is not accurate
+   * enough.
+   */
+  inline uint_fast32_t get_number_of_exact_bins() const {
+    return _number_of_exact_bins;
+  }
+
+  /**
+   * @brief Get the recombination rate for the given ion at the given
+   * temperature.
+   *
+   * @param ion IonName for a valid ion.
+   * @param temperature Temperature (in K).
+   * @return Recombination rate (in m^3s^-1).
+   */
+  virtual double get_recombination_rate(const int_fast32_t ion,
+                                        const double temperature) const {
+
+    const double u = (std::log(temperature) - _minimum_log_temperature) *
+                     _inverse_log_temperature_step;
+    if (!(u >= 0. && u < _number_of_bins)) {
+      return _recombination_rates->get_recombination_rate(ion, temperature);
+    }
+    const uint_fast32_t ibin = u;
+    if (_exact_bins[ibin]) {
+      return _recombination_rates->get_recombination_rate(ion, temperature);
+    }
+    const double fraction = u - ibin;
+    const double *low = &_table[ibin * NUMBER_OF_IONNAMES];
+    return (1. - fraction) * low[ion] +
+           fraction * low[ion + NUMBER_OF_IONNAMES];
+  }
+};
+
+#endif // TABULATEDRECOMBINATIONRATES_HPP
@@ -36,7 +36,10 @@
 #include "DeRijckeRadiativeCooling.hpp"
 #include "DiffuseReemissionHandlerFactory.hpp"
 #include "DistributedPhotonSource.hpp"
+#include "DomainDecomposition.hpp"
 #include "FlushContinuousPhotonBuffersTaskContext.hpp"
+#include "IdleHandler.hpp"
+#include "MPICommunicator.hpp"
 #include "MemorySpace.hpp"
 #include "OpenMP.hpp"
 #include "ParameterFile.hpp"
@@ -48,6 +51,7 @@
 #include "PhotonTraversalThreadContext.hpp"
 #include "PrematureLaunchTaskContext.hpp"
 #include "RecombinationRatesFactory.hpp"
+#include "SPHScatterMapping.hpp"
 #include "Scheduler.hpp"
 #include "Signals.hpp"
 #include "SimulationBox.hpp"
@@ -57,6 +61,12 @@
 #include "TemperatureCalculator.hpp"
 #include "ThreadStats.hpp"
 #include "TrackerManager.hpp"
+#include "WorkStealingTaskQueue.hpp"
+
+#ifdef HAVE_MPI
+#include "PhotonBufferCommunicator.hpp"
+#include "SendPhotonBufferTaskContext.hpp"
+#endif
 
 #include <fstream>
 #include <sstream>
@@ -74,6 +84,41 @@
 /*! @brief Uncomment to enable stop condition output. */
 //#define OUTPUT_STOP_CONDITION
 
+/**
+ * @brief Compose the name of an output file written by every process.
+ *
+ * If the simulation runs on more than one process, the rank of the local
+ * process is added to the file name.
+ *
+ * @param prefix File name prefix.
+ * @param iloop Iteration number (added to file name; a negative value means
+ * no iteration number is added).
+ * @param rank Rank of the local process.
+ * @param size Total number of processes.
+ * @return File name.
+ */
+inline std::string get_output_filename(const std::string prefix,
+                                       const int_fast32_t iloop,
+                                       const int_fast32_t rank,
+                                       const int_fast32_t size) {
+  std::stringstream filename;
+  filename << prefix;
+  if (iloop >= 0) {
+    filename << "_";
+    filename.fill('0');
+    filename.width(2);
+    filename << iloop;
+  }
+  if (size > 1) {
+    filename << "_rank";
+    filename.fill('0');
+    filename.width(3);
+    filename << rank;
+  }
+  filename << ".txt";
+  return filename.str();
+}
+
 /**
  * @brief Write a file with the start and end times of all tasks.
  *
@@ -82,30 +127,29 @@
  * @param iteration_start Start CPU cycle count of the iteration on this
  * process.
  * @param iteration_end End CPU cycle count of the iteration on this process.
+ * @param rank Rank of the local process.
+ * @param size Total number of processes.
  */
 inline void output_tasks(const uint_fast32_t iloop,
                          ThreadSafeVector< Task > &tasks,
                          const uint_fast64_t iteration_start,
-                         const uint_fast64_t iteration_end) {
+                         const uint_fast64_t iteration_end,
+                         const int_fast32_t rank, const int_fast32_t size) {
 
   {
     // compose the file name
-    std::stringstream filename;
-    filename << "tasks_";
-    filename.fill('0');
-    filename.width(2);
-    filename << iloop;
-    filename << ".txt";
+    const std::string filename = get_output_filename("tasks", iloop, rank, size);
 
     // now open the file
-    std::ofstream ofile(filename.str(), std::ofstream::trunc);
+    std::ofstream ofile(filename, std::ofstream::trunc);
 
     ofile << "# rank\tthread\tstart\tstop\ttype\n";
 
     // write the start and end CPU cycle count
     // this is a dummy task executed by thread 0 (so that the min or max
     // thread count is not affected), but with non-existing type -1
-    ofile << "0\t0\t" << iteration_start << "\t" << iteration_end << "\t-1\n";
+    ofile << rank << "\t0\t" << iteration_start << "\t" << iteration_end
+          << "\t-1\n";
 
     // write the task info
     const size_t tsize = tasks.size();
@@ -116,8 +160,8 @@ inline void output_tasks(const uint_fast32_t iloop,
       int_fast32_t thread_id;
       uint_fast64_t start, end;
       task.get_timing_information(type, thread_id, start, end);
-      ofile << "0\t" << thread_id << "\t" << start << "\t" << end << "\t"
-            << static_cast< int_fast32_t >(type) << "\n";
+      ofile << rank << "\t" << thread_id << "\t" << start << "\t" << end
+            << "\t" << static_cast< int_fast32_t >(type) << "\n";
     }
   }
 }
@@ -128,37 +172,80 @@ inline void output_tasks(const uint_fast32_t iloop,
  * @param iloop Iteration number (added to file names).
  * @param queues Per thread queues.
  * @param general_queue General queue.
+ * @param rank Rank of the local process.
+ * @param size Total number of processes.
  */
 inline void output_queues(const unsigned int iloop,
-                          std::vector< TaskQueue * > &queues,
-                          TaskQueue &general_queue) {
+                          std::vector< ThreadTaskQueue * > &queues,
+                          TaskQueue &general_queue, const int_fast32_t rank,
+                          const int_fast32_t size) {
 
   // first compose the file name
-  std::stringstream filename;
-  filename << "queues_";
-  filename.fill('0');
-  filename.width(2);
-  filename << iloop;
-  filename << ".txt";
+  const std::string filename = get_output_filename("queues", iloop, rank, size);
 
   // now output
   // open the file
-  std::ofstream ofile(filename.str(), std::ofstream::trunc);
+  std::ofstream ofile(filename, std::ofstream::trunc);
 
   ofile << "# rank\tqueue\tsize\n";
 
   // start with the general queue (-1)
-  ofile << "0\t-1\t" << general_queue.get_max_queue_size() << "\n";
+  ofile << rank << "\t-1\t" << general_queue.get_max_queue_size() << "\n";
   general_queue.reset_max_queue_size();
 
   // now do the other queues
   for (size_t i = 0; i < queues.size(); ++i) {
-    TaskQueue &queue = *queues[i];
-    ofile << "0\t" << i << "\t" << queue.get_max_queue_size() << "\n";
+    ThreadTaskQueue &queue = *queues[i];
+    ofile << rank << "\t" << i << "\t" << queue.get_max_queue_size() << "\n";
     queue.reset_max_queue_size();
   }
 }
 
+#ifdef HAVE_MPI
+/**
+ * @brief Check for photon buffers sent by other processes and create traversal
+ * tasks for them.
+ *
+ * @param communicator Photon buffer communicator.
+ * @param buffers Photon buffer array.
+ * @param grid_creator Grid creator.
+ * @param tasks Task space.
+ * @param queues Queues per thread.
+ * @param buffer_indices Scratch array used to store the indices of the
+ * received buffers (should be large enough to store the number of receives
+ * posted by the communicator).
+ * @return Number of received buffers, i.e. the number of new tasks that were
+ * added to the queues.
+ */
+inline uint_fast32_t
+receive_photon_buffers(PhotonBufferCommunicator &communicator,
+                       MemorySpace &buffers,
+                       DensitySubGridCreator< DensitySubGrid > &grid_creator,
+                       ThreadSafeVector< Task > &tasks,
+                       std::vector< ThreadTaskQueue * > &queues,
+                       size_t *buffer_indices) {
+
+  const uint_fast32_t number_received =
+      communicator.receive(buffers, buffer_indices);
+  for (uint_fast32_t i = 0; i < number_received; ++i) {
+    const size_t buffer_index = buffer_indices[i];
+    const uint_fast32_t igrid = buffers[buffer_index].get_subgrid_index();
+    cmac_assert_message(grid_creator.is_local(igrid),
+                        "Received photon buffer for a remote subgrid!");
+    DensitySubGrid &subgrid = *grid_creator.get_subgrid(igrid);
+
+    const size_t task_index = tasks.get_free_element();
+    Task &new_task = tasks[task_index];
+    new_task.set_subgrid(igrid);
+    new_task.set_buffer(buffer_index);
+    new_task.set_type(TASKTYPE_PHOTON_TRAVERSAL);
+    new_task.set_dependency(subgrid.get_traversal_dependency());
+    queues[subgrid.get_owning_thread()]->add_task(task_index);
+  }
+  return number_received;
+}
+#endif
+
 /**
  * @brief Constructor.
  *
@@ -179,19 +266,41 @@ inline void output_queues(const unsigned int iloop,
  *  - diffuse field: Should the diffuse field be tracked? (default: false)
  *  - source copy level: Copy level for subgrids that contain a source (default:
  *    4)
+ *  - adaptive copy levels: Adapt the copy levels of all subgrids to their
+ *    share of the computational cost after every iteration? (default: false)
+ *  - maximum copy level: Maximum copy level for adaptive copy levels
+ *    (default: 6)
+ *  - adaptive copy idle tolerance: Fraction of the iteration time threads can
+ *    be idle before the copy levels are adapted (default: 0.05)
+ *  - idle backoff: Let threads that run out of work during photon propagation
+ *    back off and park instead of busy spinning? (default: false)
+ *  - maximum idle park time: Maximum time a parked thread waits before it
+ *    looks for work again, in microseconds (default: 1000)
  *  - enable trackers: Track photon packets travelling through specific
  *    positions? (default: no)
+ *  - MPI repartition interval: Number of iterations between two updates of
+ *    the distributed memory domain decomposition, 0 means the initial
+ *    decomposition is never changed (default: 1)
+ *  - MPI load imbalance tolerance: Allowed relative load imbalance between
+ *    the processes when optimising the domain decomposition (default: 0.05)
+ *  - maximum number of private intensity blocks: Maximum number of subgrids
+ *    for which a single thread can accumulate intensities in a thread private
+ *    buffer during an iteration, only used if USE_PRIVATE_INTENSITY_BUFFERS is
+ *    set (default: 64)
  *
  * @param num_thread Number of shared memory parallel threads to use.
  * @param parameterfile_name Name of the parameter file to use.
  * @param task_plot Output task plot information?
  * @param output_initial_snapshot Output a snapshot before the initial
  * iteration?
+ * @param mpi_communicator MPICommunicator to use for distributed memory
+ * communications (nullptr if the simulation runs on a single process).
  * @param log Log to write logging info to.
  */
 TaskBasedIonizationSimulation::TaskBasedIonizationSimulation(
     const int_fast32_t num_thread, const std::string parameterfile_name,
-    const bool task_plot, const bool output_initial_snapshot, Log *log)
+    const bool task_plot, const bool output_initial_snapshot,
+    MPICommunicator *mpi_communicator, Log *log)
     : _parameter_file(parameterfile_name),
       _number_of_iterations(_parameter_file.get_value< uint_fast32_t >(
           "TaskBasedIonizationSimulation:number of iterations", 10)),
@@ -199,9 +308,25 @@ TaskBasedIonizationSimulation::TaskBasedIonizationSimulation(
           "TaskBasedIonizationSimulation:number of photons", 1e6)),
       _source_copy_level(_parameter_file.get_value< uint_fast32_t >(
           "TaskBasedIonizationSimulation:source copy level", 4)),
+      _adaptive_copy_levels(_parameter_file.get_value< bool >(
+          "TaskBasedIonizationSimulation:adaptive copy levels", false)),
+      _maximum_copy_level(_parameter_file.get_value< uint_fast32_t >(
+          "TaskBasedIonizationSimulation:maximum copy level", 6)),
+      _adaptive_copy_idle_tolerance(_parameter_file.get_value< double >(
+          "TaskBasedIonizationSimulation:adaptive copy idle tolerance", 0.05)),
+      _idle_backoff(_parameter_file.get_value< bool >(
+          "TaskBasedIonizationSimulation:idle backoff", false)),
+      _maximum_idle_park_time(_parameter_file.get_value< uint_fast32_t >(
+          "TaskBasedIonizationSimulation:maximum idle park time", 1000)),
       _simulation_box(_parameter_file),
       _abundance_model(AbundanceModelFactory::generate(_parameter_file, log)),
-      _abundances(_abundance_model->get_abundances()), _log(log),
+      _abundances(_abundance_model->get_abundances()),
+      _mpi_communicator(mpi_communicator),
+      _repartition_interval(_parameter_file.get_value< uint_fast32_t >(
+          "TaskBasedIonizationSimulation:MPI repartition interval", 1)),
+      _load_imbalance_tolerance(_parameter_file.get_value< double >(
+          "TaskBasedIonizationSimulation:MPI load imbalance tolerance", 0.05)),
+      _log(log),
       _task_plot(task_plot), _output_initial_snapshot(output_initial_snapshot),
       _time_dependent_ionization(_parameter_file.get_value< bool >(
           "TaskBasedIonizationSimulation:time dependent ionization", false)), 
@@ -212,6 +337,27 @@ TaskBasedIonizationSimulation::TaskBasedIonizationSimulation(
 
   set_number_of_threads(num_thread);
 
+#ifdef USE_NUMA
+  // pin the threads to the cores of the NUMA domains, so that memory that is
+  // first touched by a thread is allocated in its NUMA domain
+  _numa_topology = new NUMATopology(num_thread, log);
+  {
+    AtomicValue< int_fast32_t > number_of_pinned_threads(0);
+#ifdef HAVE_OPENMP
+#pragma omp parallel default(shared)
+#endif
+    if (_numa_topology->pin_thread(get_thread_index())) {
+      number_of_pinned_threads.pre_increment();
+    }
+    if (log && number_of_pinned_threads.value() < num_thread) {
+      log->write_warning("Only ", number_of_pinned_threads.value(), " of ",
+                         num_thread, " threads could be pinned to a core!");
+    }
+  }
+#else
+  _numa_topology = nullptr;
+#endif
+
   // install signal handlers
   OperatingSystem::install_signal_handlers(true);
 
@@ -238,7 +384,12 @@ TaskBasedIonizationSimulation::TaskBasedIonizationSimulation(
   for (int_fast8_t ithread = 0; ithread < num_thread; ++ithread) {
     std::stringstream queue_name;
     queue_name << "Queue for Thread " << static_cast< int_fast32_t >(ithread);
+#ifdef USE_WORK_STEALING
+    _queues[ithread] = new WorkStealingTaskQueue(queue_size_per_thread,
+                                                 queue_name.str(), ithread);
+#else
     _queues[ithread] = new TaskQueue(queue_size_per_thread, queue_name.str());
+#endif
   }
   _memory_log.finalize_entry();
   _time_log.end("thread queues");
@@ -260,8 +411,12 @@ TaskBasedIonizationSimulation::TaskBasedIonizationSimulation(
   _time_log.end("tasks");
 
   _random_generators.resize(num_thread);
-  const int_fast32_t random_seed = _parameter_file.get_value< int_fast32_t >(
+  int_fast32_t random_seed = _parameter_file.get_value< int_fast32_t >(
       "TaskBasedIonizationSimulation:random seed", 42);
+  // make sure every process uses different random numbers
+  if (_mpi_communicator != nullptr) {
+    random_seed += _mpi_communicator->get_rank() * num_thread;
+  }
   for (uint_fast8_t ithread = 0; ithread < num_thread; ++ithread) {
     _random_generators[ithread].set_seed(random_seed + ithread);
   }
@@ -269,6 +424,13 @@ TaskBasedIonizationSimulation::TaskBasedIonizationSimulation(
   _time_log.start("grid creator");
   _grid_creator = new DensitySubGridCreator< DensitySubGrid >(
       _simulation_box.get_box(), _parameter_file);
+#ifdef USE_PRIVATE_INTENSITY_BUFFERS
+  _grid_creator->set_maximum_number_of_intensity_blocks(
+      _parameter_file.get_value< size_t >(
+          "TaskBasedIonizationSimulation:maximum number of private intensity "
+          "blocks",
+          PRIVATEINTENSITYBUFFERS_DEFAULT_MAXIMUM_NUMBER_OF_BLOCKS));
+#endif
   _time_log.end("grid creator");
 
   _time_log.start("density function");
@@ -369,14 +531,30 @@ TaskBasedIonizationSimulation::TaskBasedIonizationSimulation(
     _trackers = nullptr;
   }
 
+  if (_mpi_communicator != nullptr && _mpi_communicator->get_size() > 1) {
+    if (!_mpi_communicator->has_thread_support()) {
+      cmac_error("The MPI library does not support MPI calls from within a "
+                 "parallel region!");
+    }
+    if (_continuous_photon_source != nullptr) {
+      cmac_error("Continuous photon sources are not supported for MPI task "
+                 "based simulations!");
+    }
+    if (_trackers != nullptr) {
+      cmac_error("Trackers are not supported for MPI task based simulations!");
+    }
+  }
+
   // we are done reading the parameter file
   // now output all parameters (also those for which default values were used)
-  const std::string usedvaluename = parameterfile_name + ".used-values";
-  std::ofstream pfile(usedvaluename);
-  _parameter_file.print_contents(pfile);
-  pfile.close();
-  if (_log) {
-    _log->write_status("Wrote used parameters to ", usedvaluename, ".");
+  if (_mpi_communicator == nullptr || _mpi_communicator->get_rank() == 0) {
+    const std::string usedvaluename = parameterfile_name + ".used-values";
+    std::ofstream pfile(usedvaluename);
+    _parameter_file.print_contents(pfile);
+    pfile.close();
+    if (_log) {
+      _log->write_status("Wrote used parameters to ", usedvaluename, ".");
+    }
   }
 
   _memory_log.add_entry("parameters done");
@@ -413,25 +591,33 @@ TaskBasedIonizationSimulation::~TaskBasedIonizationSimulation() {
         Utilities::human_readable_time(_cell_update_timer.value()), ".");
   }
 
+  int_fast32_t rank = 0;
+  int_fast32_t size = 1;
+  if (_mpi_communicator != nullptr) {
+    rank = _mpi_communicator->get_rank();
+    size = _mpi_communicator->get_size();
+  }
+
   if (_task_plot) {
-    std::ofstream pfile("program_time.txt");
+    std::ofstream pfile(get_output_filename("program_time", -1, rank, size));
     pfile << "# rank\tstart\tstop\ttime\n";
-    pfile << "0\t" << _program_start << "\t" << program_end << "\t"
+    pfile << rank << "\t" << _program_start << "\t" << program_end << "\t"
           << _total_timer.value() << "\n";
   }
 
   {
-    std::ofstream mfile("memory_timeline.txt");
+    std::ofstream mfile(get_output_filename("memory_timeline", -1, rank, size));
     _memory_log.print(mfile, true);
   }
 
-  _time_log.output("time_log.txt", false);
+  _time_log.output(get_output_filename("time_log", -1, rank, size), false);
 
   delete _buffers;
   for (uint_fast8_t ithread = 0; ithread < _queues.size(); ++ithread) {
     delete _queues[ithread];
   }
   delete _shared_queue;
+  delete _numa_topology;
   delete _tasks;
   delete _grid_creator;
   delete _density_function;
@@ -468,17 +654,50 @@ void TaskBasedIonizationSimulation::initialize(
   _memory_log.add_entry("density function");
   _time_log.end("density function");
 
+  if (_mpi_communicator != nullptr && _mpi_communicator->get_size() > 1) {
+    _time_log.start("domain decomposition");
+    // we have no cost information yet: assume all subgrids are equally
+    // expensive
+    _grid_creator->set_domain_decomposition(decompose_domain(false),
+                                            _mpi_communicator->get_rank());
+    _time_log.end("domain decomposition");
+  }
+
   _time_log.start("grid");
   _memory_log.add_entry("grid");
+  Timer grid_timer;
+  grid_timer.start();
   start_parallel_timing_block();
   _grid_creator->initialize(*density_function);
   stop_parallel_timing_block();
 
+  // particle based density functions can deposit their particles directly
+  // onto the grid, instead of being evaluated for every cell
+  const SPHScatterMapping *scatter_mapping =
+      density_function->get_scatter_mapping();
+  if (scatter_mapping != nullptr) {
+    start_parallel_timing_block();
+    scatter_mapping->deposit(*_grid_creator);
+    stop_parallel_timing_block();
+  }
+
+  grid_timer.stop();
+
   if (_log) {
+    _log->write_status("Grid initialization took ",
+                       Utilities::human_readable_time(grid_timer.value()),
+                       ", peak memory usage: ",
+                       Utilities::human_readable_bytes(
+                           OperatingSystem::get_peak_memory_usage()),
+                       ".");
+    auto first_local_subgrid = _grid_creator->begin();
+    while (!_grid_creator->is_local(first_local_subgrid.get_index())) {
+      ++first_local_subgrid;
+    }
     _log->write_status("Task-based structure sizes:");
     _log->write_status("DensitySubGrid: ",
                        Utilities::human_readable_bytes(
-                           (*_grid_creator->begin()).get_memory_size()));
+                           (*first_local_subgrid).get_memory_size()));
     _log->write_status("Single cell: ", Utilities::human_readable_bytes(
                                             sizeof(IonizationVariables)));
     _log->write_status("PhotonBuffer: ",
@@ -488,6 +707,9 @@ void TaskBasedIonizationSimulation::initialize(
 #ifdef VARIABLE_ABUNDANCES
   for (auto gridit = _grid_creator->begin();
        gridit != _grid_creator->original_end(); ++gridit) {
+    if (!_grid_creator->is_local(gridit.get_index())) {
+      continue;
+    }
     for (auto cellit = (*gridit).begin(); cellit != (*gridit).end(); ++cellit) {
       cellit.get_ionization_variables().get_abundances().set_abundances(
           _abundances);
@@ -516,11 +738,18 @@ void TaskBasedIonizationSimulation::run(
 
   _time_log.start("main run");
 
+  int_fast32_t rank = 0;
+  int_fast32_t size = 1;
+  if (_mpi_communicator != nullptr) {
+    rank = _mpi_communicator->get_rank();
+    size = _mpi_communicator->get_size();
+  }
+
   // write the initial state of the grid to an output file (only do this if
   // we are not in library mode)
   if (_density_grid_writer && _output_initial_snapshot) {
     _time_log.start("snapshot");
-    _density_grid_writer->write(*_grid_creator, 0, _parameter_file);
+    write_snapshot(0);
     _time_log.end("snapshot");
   }
 
@@ -548,31 +777,18 @@ void TaskBasedIonizationSimulation::run(
   }
 
   // impose copy restrictions
+  _grid_creator->restrict_copy_levels(levels);
+  _memory_log.add_entry("subgrid copies");
   {
-    uint_fast8_t max_level = 0;
-    const size_t levelsize = levels.size();
-    for (size_t i = 0; i < levelsize; ++i) {
-      max_level = std::max(max_level, levels[i]);
-    }
-
-    size_t ngbs[6];
-    while (max_level > 0) {
-      for (size_t i = 0; i < levelsize; ++i) {
-        if (levels[i] == max_level) {
-          const uint_fast8_t numngbs = _grid_creator->get_neighbours(i, ngbs);
-          for (uint_fast8_t ingb = 0; ingb < numngbs; ++ingb) {
-            const size_t ngbi = ngbs[ingb];
-            if (levels[ngbi] < levels[i] - 1) {
-              levels[ngbi] = levels[i] - 1;
-            }
-          }
-        }
+    // we can only make copies of local subgrids
+    std::vector< uint_fast8_t > local_levels(levels);
+    for (size_t i = 0; i < local_levels.size(); ++i) {
+      if (!_grid_creator->is_local(i)) {
+        local_levels[i] = 0;
       }
-      --max_level;
     }
+    _grid_creator->create_copies(local_levels);
   }
-  _memory_log.add_entry("subgrid copies");
-  _grid_creator->create_copies(levels);
   _memory_log.finalize_entry();
   _time_log.end("subgrid copies");
   if (_log) {
@@ -586,7 +802,7 @@ void TaskBasedIonizationSimulation::run(
     if (_log) {
       _log->write_status("Outputting memory allocation stats to memory.txt.");
     }
-    std::ofstream mfile("memory.txt");
+    std::ofstream mfile(get_output_filename("memory", -1, rank, size));
     _memory_log.print(mfile, false);
   }
 
@@ -644,11 +860,17 @@ void TaskBasedIonizationSimulation::run(
 #endif
     while (igrid.value() < _grid_creator->number_of_actual_subgrids()) {
       const size_t this_igrid = igrid.post_increment();
-      if (this_igrid < _grid_creator->number_of_actual_subgrids()) {
+      if (this_igrid < _grid_creator->number_of_actual_subgrids() &&
+          _grid_creator->is_local(this_igrid)) {
         DensitySubGrid &subgrid = *_grid_creator->get_subgrid(this_igrid);
         for (int ingb = 0; ingb < TRAVELDIRECTION_NUMBER; ++ingb) {
           subgrid.set_active_buffer(ingb, NEIGHBOUR_OUTSIDE);
+#ifdef USE_NUMA
+          subgrid.set_owning_thread(
+              _grid_creator->get_home_thread(this_igrid, _queues.size()));
+#else
           subgrid.set_owning_thread(get_thread_index());
+#endif
         }
         for (auto cellit = subgrid.begin(); cellit != subgrid.end();
               ++cellit) {
@@ -682,6 +904,8 @@ void TaskBasedIonizationSimulation::run(
 
     uint_fast64_t iteration_start, iteration_end;
     cpucycle_tick(iteration_start);
+    Timer iteration_timer;
+    iteration_timer.start();
     _photon_propagation_timer.start();
 
     // reset the photon source information
@@ -719,7 +943,8 @@ void TaskBasedIonizationSimulation::run(
 #endif
       while (igrid.value() < _grid_creator->number_of_actual_subgrids()) {
         const size_t this_igrid = igrid.post_increment();
-        if (this_igrid < _grid_creator->number_of_actual_subgrids()) {
+        if (this_igrid < _grid_creator->number_of_actual_subgrids() &&
+            _grid_creator->is_local(this_igrid)) {
           auto gridit = _grid_creator->get_subgrid(this_igrid);
           (*gridit).reset_intensities();
         }
@@ -737,7 +962,8 @@ void TaskBasedIonizationSimulation::run(
 #endif
       while (igrid.value() < _grid_creator->number_of_actual_subgrids()) {
         const size_t this_igrid = igrid.post_increment();
-        if (this_igrid < _grid_creator->number_of_actual_subgrids()) {
+        if (this_igrid < _grid_creator->number_of_actual_subgrids() &&
+            _grid_creator->is_local(this_igrid)) {
           auto gridit = _grid_creator->get_subgrid(this_igrid);
           for (auto cellit = (*gridit).begin(); cellit != (*gridit).end();
                ++cellit) {
@@ -759,14 +985,17 @@ void TaskBasedIonizationSimulation::run(
 
           const size_t number_of_photons_this_batch =
               photon_source->get_photon_batch(isrc, PHOTONBUFFER_SIZE);
-          if (number_of_photons_this_batch > 0) {
+          // sources in remote subgrids are handled by the process that owns
+          // the subgrid, but we still count their photon packets
+          if (number_of_photons_this_batch > 0 &&
+              _grid_creator->is_local(photon_source->get_subgrid(isrc))) {
             const size_t new_task = _tasks->get_free_element();
             (*_tasks)[new_task].set_type(TASKTYPE_SOURCE_DISCRETE_PHOTON);
             (*_tasks)[new_task].set_subgrid(isrc);
             (*_tasks)[new_task].set_buffer(number_of_photons_this_batch);
             _shared_queue->add_task(new_task);
-            number_of_photons_done += number_of_photons_this_batch;
           }
+          number_of_photons_done += number_of_photons_this_batch;
         }
       }
     }
@@ -810,7 +1039,9 @@ void TaskBasedIonizationSimulation::run(
     _time_log.end("photon source tasks");
 
     _time_log.start("photon propagation");
-    bool global_run_flag = true;
+    // signals the end of the photon propagation; also handles idle threads
+    // if idle backoff is enabled
+    IdleHandler idle_handler(10, 10, _maximum_idle_park_time);
     AtomicValue< uint_fast32_t > num_photon_done(0);
 
 
@@ -860,7 +1091,21 @@ void TaskBasedIonizationSimulation::run(
     PrematureLaunchTaskContext< DensitySubGrid > premature_launch(
         *_buffers, *_grid_creator, *_tasks, _queues, *_shared_queue);
 
-    Scheduler scheduler(*_tasks, _queues, *_shared_queue);
+#ifdef HAVE_MPI
+    PhotonBufferCommunicator *photon_communicator = nullptr;
+    if (size > 1) {
+      photon_communicator = new PhotonBufferCommunicator();
+      task_contexts[TASKTYPE_SEND] =
+          new SendPhotonBufferTaskContext< DensitySubGrid >(
+              *_buffers, *_grid_creator, *photon_communicator);
+      // photon packets can end their life on a different process, so the
+      // termination condition is based on the global number of completed
+      // photon packets
+      photon_communicator->start(_number_of_photons);
+    }
+#endif
+
+    Scheduler scheduler(*_tasks, _queues, *_shared_queue, _numa_topology);
 
     start_parallel_timing_block();
 #ifdef HAVE_OPENMP
@@ -876,18 +1121,43 @@ void TaskBasedIonizationSimulation::run(
         }
       }
 
+#ifdef HAVE_MPI
+      std::vector< size_t > received_buffers;
+      if (photon_communicator != nullptr) {
+        received_buffers.resize(photon_communicator->get_number_of_receives());
+      }
+#endif
+
       // actual run flag
+      IdleHandler::Backoff backoff;
+      uint_fast64_t idle_epoch = 0;
       uint_fast32_t current_index = _shared_queue->get_task(*_tasks);
-      while (global_run_flag) {
-
+      while (!idle_handler.is_finished()) {
 
         if (current_index == NO_TASK) {
-          premature_launch.execute();
+          idle_epoch = idle_handler.prepare_wait();
+          // tasks added here can be picked up by other (parked) threads too
+          bool tasks_added = false;
+#ifdef HAVE_MPI
+          if (photon_communicator != nullptr) {
+            tasks_added = receive_photon_buffers(
+                              *photon_communicator, *_buffers, *_grid_creator,
+                              *_tasks, _queues, received_buffers.data()) > 0;
+          }
+#endif
+          if (premature_launch.execute()) {
+            tasks_added = true;
+          }
+          if (_idle_backoff && tasks_added) {
+            idle_handler.notify();
+          }
           current_index = scheduler.get_task(thread_id);
         }
 
         while (current_index != NO_TASK) {
 
+          backoff.reset();
+
           // execute task
           uint_fast32_t num_tasks_to_add = 0;
           uint_fast32_t tasks_to_add[TRAVELDIRECTION_NUMBER];
@@ -921,23 +1191,53 @@ void TaskBasedIonizationSimulation::run(
               _queues[queues_to_add[itask]]->add_task(tasks_to_add[itask]);
             }
           }
+          if (_idle_backoff && num_tasks_to_add > 0) {
+            idle_handler.notify();
+          }
 
           current_index = scheduler.get_task(thread_id);
         }
 
-        if (_buffers->is_empty() &&
-            num_photon_done.value() == _number_of_photons) {
-          global_run_flag = false;
-        } else {
+        // only idle threads check the termination condition; with idle
+        // backoff, only one idle thread at a time does so
+        if (!_idle_backoff || idle_handler.try_lock_termination_check()) {
+#ifdef HAVE_MPI
+          // photon packets can leave this process, so we have to check if all
+          // processes are done
+          const bool is_done =
+              (photon_communicator != nullptr)
+                  ? photon_communicator->is_finished(num_photon_done.value())
+                  : (_buffers->is_empty() &&
+                     num_photon_done.value() == _number_of_photons);
+#else
+          const bool is_done = _buffers->is_empty() &&
+                               num_photon_done.value() == _number_of_photons;
+#endif
+          if (is_done) {
+            idle_handler.finish();
+          } else if (_idle_backoff) {
+            idle_handler.unlock_termination_check();
+          }
+        }
+        if (!idle_handler.is_finished()) {
+          if (_idle_backoff) {
+            idle_handler.wait(backoff, idle_epoch);
+          }
           current_index = scheduler.get_task(thread_id);
         }
-      } // while(global_run_flag)
+      } // while(!idle_handler.is_finished())
 
       for (int_fast32_t itask = 0; itask < TASKTYPE_NUMBER; ++itask) {
         delete thread_contexts[itask];
       }
     } // parallel region
     stop_parallel_timing_block();
+#ifdef HAVE_MPI
+    if (photon_communicator != nullptr) {
+      photon_communicator->finish();
+      delete photon_communicator;
+    }
+#endif
     _time_log.end("photon propagation");
 
     _time_log.start("update copies");
@@ -945,6 +1245,17 @@ void TaskBasedIonizationSimulation::run(
     _grid_creator->update_original_counters();
     stop_parallel_timing_block();
     _time_log.end("update copies");
+#ifdef USE_PRIVATE_INTENSITY_BUFFERS
+    if (_log) {
+      _log->write_status(
+          "Thread private intensity buffers: ",
+          _grid_creator->get_intensity_buffers().get_number_of_used_blocks(),
+          " blocks, ",
+          Utilities::human_readable_bytes(
+              _grid_creator->get_intensity_buffers().get_used_memory_size()),
+          " during photon propagation.");
+    }
+#endif
     if (iloop == _number_of_iterations - 1) {
       statistics.print_stats();
     }
@@ -964,7 +1275,8 @@ void TaskBasedIonizationSimulation::run(
 #endif
       while (igrid.value() < _grid_creator->number_of_original_subgrids()) {
         const size_t this_igrid = igrid.post_increment();
-        if (this_igrid < _grid_creator->number_of_original_subgrids()) {
+        if (this_igrid < _grid_creator->number_of_original_subgrids() &&
+            _grid_creator->is_local(this_igrid)) {
           auto gridit = _grid_creator->get_subgrid(this_igrid);
 
           const size_t itask = _tasks->get_free_element();
@@ -1022,20 +1334,53 @@ void TaskBasedIonizationSimulation::run(
 
     _cell_update_timer.stop();
 
+    // compute the new domain decomposition (this needs to happen before the
+    // subgrid costs are reset below)
+    std::vector< int_fast32_t > new_domains;
+    if (size > 1 && _repartition_interval > 0 &&
+        (iloop + 1) % _repartition_interval == 0 &&
+        iloop < _number_of_iterations - 1) {
+      _time_log.start("domain decomposition");
+      new_domains = decompose_domain(true);
+      _time_log.end("domain decomposition");
+    }
+
+    // compute the new subgrid copy levels (this also needs to happen before
+    // the subgrid costs and thread statistics are reset below)
+    uint_fast64_t idle_fraction_end;
+    cpucycle_tick(idle_fraction_end);
+    uint_fast64_t busy_time = 0;
+    for (uint_fast32_t i = 0; i < thread_stats.size(); ++i) {
+      busy_time += thread_stats[i].get_total_time();
+    }
+    const double idle_fraction =
+        1. - static_cast< double >(busy_time) /
+                 (thread_stats.size() * (idle_fraction_end - iteration_start));
+    if (_log) {
+      _log->write_info(
+          "Iteration wall time: ",
+          Utilities::human_readable_time(iteration_timer.interval()),
+          ", idle fraction: ", idle_fraction, ".");
+    }
+    std::vector< uint_fast8_t > new_levels;
+    if (_adaptive_copy_levels && new_domains.empty() &&
+        iloop < _number_of_iterations - 1) {
+      if (idle_fraction > _adaptive_copy_idle_tolerance) {
+        _grid_creator->compute_adaptive_copy_levels(
+            thread_stats.size(), _maximum_copy_level, new_levels);
+      }
+    }
+
     // output diagnostic information
     {
       uint_fast64_t early_iteration_end;
       cpucycle_tick(early_iteration_end);
       // compose the file name
-      std::stringstream filename;
-      filename << "diagnostics_";
-      filename.fill('0');
-      filename.width(2);
-      filename << iloop;
-      filename << ".txt";
+      const std::string filename =
+          get_output_filename("diagnostics", iloop, rank, size);
 
       // now open the file
-      std::ofstream ofile(filename.str(), std::ofstream::trunc);
+      std::ofstream ofile(filename, std::ofstream::trunc);
       ofile << "iteration:\n";
       ofile << "  start: " << iteration_start << "\n";
       ofile << "  end: " << early_iteration_end << "\n";
@@ -1081,12 +1426,30 @@ void TaskBasedIonizationSimulation::run(
         }
         thread_stats[i].reset();
       }
+      ofile << "idle:\n";
+      ofile << "  fraction: " << idle_fraction << "\n";
+      ofile << "  parks: " << idle_handler.get_number_of_parks() << "\n";
+      if (_numa_topology != nullptr) {
+        ofile << "numa:\n";
+        ofile << "  domains: " << _numa_topology->get_number_of_domains()
+              << "\n";
+        ofile << "  local steals: " << scheduler.get_number_of_local_steals()
+              << "\n";
+        ofile << "  remote steals: " << scheduler.get_number_of_remote_steals()
+              << "\n";
+      }
       ofile << "subgrids:\n";
       for (auto it = _grid_creator->begin(); it != _grid_creator->all_end();
            ++it) {
+        if (!_grid_creator->is_local(it.get_index())) {
+          continue;
+        }
         ofile << "  subgrid " << it.get_index() << ": "
               << (*it).get_computational_cost() << "\n";
         (*it).reset_computational_cost();
+#ifdef DENSITYGRID_EDGECOST
+        (*it).reset_communication_costs();
+#endif
       }
     }
 
@@ -1108,11 +1471,108 @@ void TaskBasedIonizationSimulation::run(
     stop_parallel_timing_block();
     _time_log.end("copy update");
 
+    // adapt the copy hierarchy to the load of the last iteration
+    if (!new_levels.empty()) {
+      _time_log.start("copy level update");
+      if (_grid_creator->update_copies(new_levels)) {
+        levels = new_levels;
+
+        // new copies have no photon buffers yet and all copy indices changed
+        AtomicValue< size_t > igrid(0);
+        start_parallel_timing_block();
+#ifdef HAVE_OPENMP
+#pragma omp parallel default(shared)
+#endif
+        while (igrid.value() < _grid_creator->number_of_actual_subgrids()) {
+          const size_t this_igrid = igrid.post_increment();
+          if (this_igrid < _grid_creator->number_of_actual_subgrids() &&
+              _grid_creator->is_local(this_igrid)) {
+            DensitySubGrid &subgrid = *_grid_creator->get_subgrid(this_igrid);
+            for (int ingb = 0; ingb < TRAVELDIRECTION_NUMBER; ++ingb) {
+              subgrid.set_active_buffer(ingb, NEIGHBOUR_OUTSIDE);
+            }
+#ifdef USE_NUMA
+            subgrid.set_owning_thread(
+                _grid_creator->get_home_thread(this_igrid, _queues.size()));
+#else
+            subgrid.set_owning_thread(get_thread_index());
+#endif
+          }
+        }
+        stop_parallel_timing_block();
+
+        // the source copies have changed
+        if (photon_source) {
+          delete photon_source;
+          photon_source = new DistributedPhotonSource< DensitySubGrid >(
+              number_of_discrete_photons, *_photon_source_distribution,
+              *_grid_creator);
+        }
+
+        if (_log) {
+          _log->write_status("Updated subgrid copy levels, now using ",
+                             _grid_creator->number_of_actual_subgrids() -
+                                 _grid_creator->number_of_original_subgrids(),
+                             " subgrid copies.");
+        }
+      }
+      _time_log.end("copy level update");
+    }
+
+#ifdef HAVE_MPI
+    // move the subgrids to their new owning process
+    if (!new_domains.empty()) {
+      _time_log.start("subgrid redistribution");
+      _grid_creator->remove_copies();
+      _grid_creator->redistribute(new_domains);
+      std::vector< uint_fast8_t > local_levels(levels);
+      for (size_t i = 0; i < local_levels.size(); ++i) {
+        if (!_grid_creator->is_local(i)) {
+          local_levels[i] = 0;
+        }
+      }
+      _grid_creator->create_copies(local_levels);
+
+      // subgrids we received and new copies have no photon buffers yet
+      AtomicValue< size_t > igrid(0);
+      start_parallel_timing_block();
+#ifdef HAVE_OPENMP
+#pragma omp parallel default(shared)
+#endif
+      while (igrid.value() < _grid_creator->number_of_actual_subgrids()) {
+        const size_t this_igrid = igrid.post_increment();
+        if (this_igrid < _grid_creator->number_of_actual_subgrids() &&
+            _grid_creator->is_local(this_igrid)) {
+          DensitySubGrid &subgrid = *_grid_creator->get_subgrid(this_igrid);
+          for (int ingb = 0; ingb < TRAVELDIRECTION_NUMBER; ++ingb) {
+            subgrid.set_active_buffer(ingb, NEIGHBOUR_OUTSIDE);
+          }
+#ifdef USE_NUMA
+          subgrid.set_owning_thread(
+              _grid_creator->get_home_thread(this_igrid, _queues.size()));
+#else
+          subgrid.set_owning_thread(get_thread_index());
+#endif
+        }
+      }
+      stop_parallel_timing_block();
+
+      // the source copies have changed
+      if (photon_source) {
+        delete photon_source;
+        photon_source = new DistributedPhotonSource< DensitySubGrid >(
+            number_of_discrete_photons, *_photon_source_distribution,
+            *_grid_creator);
+      }
+      _time_log.end("subgrid redistribution");
+    }
+#endif
+
     if (_task_plot) {
       _time_log.start("task output");
       cpucycle_tick(iteration_end);
-      output_tasks(iloop, *_tasks, iteration_start, iteration_end);
-      output_queues(iloop, _queues, *_shared_queue);
+      output_tasks(iloop, *_tasks, iteration_start, iteration_end, rank, size);
+      output_queues(iloop, _queues, *_shared_queue, rank, size);
       _time_log.end("task output");
     }
 
@@ -1154,9 +1614,91 @@ void TaskBasedIonizationSimulation::run(
   }
 
   _time_log.start("snapshot");
-  _density_grid_writer->write(*_grid_creator, _number_of_iterations,
-                              _parameter_file);
+  write_snapshot(_number_of_iterations);
   _time_log.end("snapshot");
 
   _time_log.end("main run");
 }
+
+/**
+ * @brief Compute a new distributed memory domain decomposition.
+ *
+ * This function needs to be called by all processes at the same time.
+ *
+ * @param use_costs Use the computational and communication costs of the
+ * subgrids measured during the last iteration? If false, all subgrids and all
+ * subgrid faces are assumed to have the same cost.
+ * @return Rank of the process that should own each original subgrid.
+ */
+std::vector< int_fast32_t >
+TaskBasedIonizationSimulation::decompose_domain(const bool use_costs) {
+
+#ifdef HAVE_MPI
+  DomainDecomposition decomposition(_grid_creator->get_subgrid_layout(),
+                                    _mpi_communicator->get_size(),
+                                    _load_imbalance_tolerance);
+  if (!use_costs) {
+    decomposition.decompose();
+  } else {
+    std::vector< double > costs, edge_costs;
+    std::vector< uint_least32_t > neighbours;
+    _grid_creator->get_decomposition_costs(costs, edge_costs, neighbours);
+    // every process only filled in the values for its own subgrids
+    MPI_Allreduce(MPI_IN_PLACE, costs.data(), costs.size(), MPI_DOUBLE,
+                  MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, edge_costs.data(), edge_costs.size(),
+                  MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, neighbours.data(), neighbours.size(),
+                  MPI_UINT_LEAST32_T, MPI_SUM, MPI_COMM_WORLD);
+
+    const size_t number_of_subgrids = costs.size();
+    domain_graph_t graph(number_of_subgrids);
+    for (size_t igrid = 0; igrid < number_of_subgrids; ++igrid) {
+      for (int_fast32_t i = 1; i < TRAVELDIRECTION_NUMBER; ++i) {
+        const uint_least32_t ngb =
+            neighbours[igrid * TRAVELDIRECTION_NUMBER + i];
+        if (ngb != NEIGHBOUR_OUTSIDE) {
+          graph[igrid].push_back(std::make_pair(
+              ngb, edge_costs[igrid * TRAVELDIRECTION_NUMBER + i]));
+        }
+      }
+    }
+    decomposition.decompose(costs, graph);
+  }
+
+  if (_log) {
+    _log->write_status("Domain decomposition load imbalance: ",
+                       decomposition.get_load_imbalance(), ".");
+  }
+
+  return decomposition.get_domains();
+#else
+  cmac_error("Domain decomposition requires MPI!");
+  return std::vector< int_fast32_t >();
+#endif
+}
+
+/**
+ * @brief Write a snapshot of the current state of the grid.
+ *
+ * If the simulation runs on more than one process, all subgrids are first
+ * gathered on the process with rank 0, which writes the snapshot. This
+ * function then needs to be called by all processes at the same time.
+ *
+ * @param iteration Iteration number.
+ */
+void TaskBasedIonizationSimulation::write_snapshot(
+    const uint_fast32_t iteration) {
+
+  if (_mpi_communicator != nullptr && _mpi_communicator->get_size() > 1) {
+#ifdef HAVE_MPI
+    _grid_creator->gather_subgrids(0);
+    if (_mpi_communicator->get_rank() == 0) {
+      _density_grid_writer->write(*_grid_creator, iteration, _parameter_file);
+    }
+    _grid_creator->release_remote_subgrids();
+#endif
+  } else {
+    _density_grid_writer->write(*_grid_creator, iteration, _parameter_file);
+  }
+}
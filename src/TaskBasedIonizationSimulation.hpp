@@ -33,12 +33,14 @@
 #include "CollisionalRates.hpp"
 #include "LineCoolingData.hpp"
 #include "MemoryLogger.hpp"
+#include "NUMATopology.hpp"
 #include "ParameterFile.hpp"
 #include "RandomGenerator.hpp"
 #include "SimulationBox.hpp"
 #include "Task.hpp"
 #include "ThreadSafeVector.hpp"
 #include "TimeLogger.hpp"
+#include "WorkStealingTaskQueue.hpp"
 
 #include <vector>
 
@@ -50,10 +52,10 @@ class DensitySubGrid;
 template < class _subgrid_type_ > class DensitySubGridCreator;
 class DiffuseReemissionHandler;
 class MemorySpace;
+class MPICommunicator;
 class PhotonSourceDistribution;
 class PhotonSourceSpectrum;
 class RecombinationRates;
-class TaskQueue;
 class TemperatureCalculator;
 class TrackerManager;
 
@@ -67,11 +69,15 @@ private:
   MemorySpace *_buffers;
 
   /*! @brief Queues per thread. */
-  std::vector< TaskQueue * > _queues;
+  std::vector< ThreadTaskQueue * > _queues;
 
   /*! @brief General shared queue. */
   TaskQueue *_shared_queue;
 
+  /*! @brief NUMA topology used to pin threads and to steal tasks in a
+   *  locality aware way (nullptr if NUMA awareness is disabled). */
+  NUMATopology *_numa_topology;
+
   /*! @brief Task space. */
   ThreadSafeVector< Task > *_tasks;
 
@@ -91,6 +97,25 @@ private:
   /*! @brief Copy level for subgrids that contain a source. */
   const uint_fast8_t _source_copy_level;
 
+  /*! @brief Adapt the copy levels of the subgrids to the computational cost
+   *  of the previous iteration? */
+  const bool _adaptive_copy_levels;
+
+  /*! @brief Maximum copy level for adaptive copy levels. */
+  const uint_fast8_t _maximum_copy_level;
+
+  /*! @brief Fraction of the iteration time threads are allowed to be idle
+   *  before the copy levels are adapted. */
+  const double _adaptive_copy_idle_tolerance;
+
+  /*! @brief Let idle threads back off and park instead of busy spinning
+   *  during photon propagation? */
+  const bool _idle_backoff;
+
+  /*! @brief Maximum time an idle thread stays parked before it looks for work
+   *  again (in microseconds). */
+  const uint_fast32_t _maximum_idle_park_time;
+
   /*! @brief Simulation box (in m). */
   SimulationBox _simulation_box;
 
@@ -144,6 +169,18 @@ private:
   /*! @brief Reemission handler. */
   DiffuseReemissionHandler *_reemission_handler;
 
+  /*! @brief MPI communicator (nullptr if the simulation runs on a single
+   *  process). */
+  MPICommunicator *_mpi_communicator;
+
+  /*! @brief Number of iterations between two repartitionings of the
+   *  distributed memory domain decomposition. */
+  const uint_fast32_t _repartition_interval;
+
+  /*! @brief Allowed load imbalance for the distributed memory domain
+   *  decomposition. */
+  const double _load_imbalance_tolerance;
+
   /*! @brief Log to write logging info to. */
   Log *_log;
 
@@ -186,11 +223,15 @@ private:
 
   const double _initial_neutral_fraction;
 
+  std::vector< int_fast32_t > decompose_domain(const bool use_costs);
+  void write_snapshot(const uint_fast32_t iteration);
+
 public:
   TaskBasedIonizationSimulation(const int_fast32_t num_thread,
                                 const std::string parameterfile_name,
                                 const bool task_plot = false,
                                 const bool output_initial_snapshot = false,
+                                MPICommunicator *mpi_communicator = nullptr,
                                 Log *log = nullptr);
   ~TaskBasedIonizationSimulation();
 
@@ -26,7 +26,6 @@
 
 #include "TaskBasedRadiationHydrodynamicsSimulation.hpp"
 #include "AlveliusTurbulenceForcing.hpp"
-#include "BarnesHutTree.hpp"
 #include "ChargeTransferRates.hpp"
 #include "CollisionalRates.hpp"
 #include "CommandLineParser.hpp"
@@ -38,13 +37,17 @@
 #include "DiffuseReemissionHandlerFactory.hpp"
 #include "DistributedPhotonSource.hpp"
 #include "ExternalPotentialFactory.hpp"
+#include "FFTPoissonSolver.hpp"
 #include "HydroBoundaryManager.hpp"
 #include "HydroDensitySubGrid.hpp"
 #include "HydroMaskFactory.hpp"
+#include "IdleHandler.hpp"
 #include "LineCoolingData.hpp"
+#include "LinearOctreeGravity.hpp"
 #include "LiveOutputManager.hpp"
 #include "MemoryLogger.hpp"
 #include "MemorySpace.hpp"
+#include "NUMATopology.hpp"
 #include "OpenMP.hpp"
 #include "ParameterFile.hpp"
 #include "PhotonReemitTaskContext.hpp"
@@ -55,13 +58,16 @@
 #include "PrematureLaunchTaskContext.hpp"
 #include "RecombinationRatesFactory.hpp"
 #include "RestartManager.hpp"
+#include "SPHScatterMapping.hpp"
 #include "Scheduler.hpp"
 #include "SimulationBox.hpp"
+#include "SubGridSelfGravity.hpp"
 #include "SourceDiscretePhotonTaskContext.hpp"
 #include "TaskQueue.hpp"
 #include "TemperatureCalculator.hpp"
 #include "TimeLine.hpp"
 #include "TimeLogger.hpp"
+#include "WorkStealingTaskQueue.hpp"
 
 // #include"IonizationVariables.hpp" // mgb 11.10.2025
 
@@ -608,29 +614,27 @@ inline void reset_hydro_tasks(ThreadSafeVector< Task > &tasks,
  * @param queues Thread queues.
  * @param tasks Task space.
  * @param grid_creator Subgrids.
+ * @param numa_topology NUMA topology used for locality aware stealing (nullptr
+ * if NUMA awareness is disabled).
  * @return Index of an available task, or NO_TASK if no tasks are available.
  */
 inline uint_fast32_t
 steal_task(const int_fast32_t thread_id, const int_fast32_t num_threads,
-           std::vector< TaskQueue * > &queues, ThreadSafeVector< Task > &tasks,
-           DensitySubGridCreator< HydroDensitySubGrid > &grid_creator) {
+           std::vector< ThreadTaskQueue * > &queues,
+           ThreadSafeVector< Task > &tasks,
+           DensitySubGridCreator< HydroDensitySubGrid > &grid_creator,
+           const NUMATopology *numa_topology) {
 
-  // sort the queues by size
-  std::vector< uint_fast32_t > queue_sizes(queues.size(), 0);
-  for (uint_fast32_t i = 0; i < queues.size(); ++i) {
-    queue_sizes[i] = queues[i]->size();
+  if (numa_topology != nullptr) {
+    // subgrids keep their home thread, so that new tasks for them are queued
+    // in the NUMA domain of their memory
+    bool remote = false;
+    return Scheduler::steal_task(thread_id, queues, tasks, *numa_topology,
+                                 remote);
   }
-  std::vector< uint_fast32_t > sorti = Utilities::argsort(queue_sizes);
 
-  // now try to steal from the largest queue first
-  uint_fast32_t current_index = NO_TASK;
-  uint_fast32_t i = 0;
-  while (current_index == NO_TASK && i < queue_sizes.size() &&
-         queue_sizes[sorti[queue_sizes.size() - i - 1]] > 0) {
-    current_index =
-        queues[sorti[queue_sizes.size() - i - 1]]->try_get_task(tasks);
-    ++i;
-  }
+  const uint_fast32_t current_index =
+      Scheduler::steal_task(thread_id, queues, tasks);
   if (current_index != NO_TASK) {
     // stealing means transferring ownership...
     (*grid_creator.get_subgrid(tasks[current_index].get_subgrid()))
@@ -1340,6 +1344,17 @@ inline static void do_cooling(IonizationVariables &ionization_variables,
  *  - do radiation: Enable radiation? (default: yes)
  *  - do radiative cooling: Enable radiative cooling? (default: no)
  *  - do stellar feedback: Enable stellar feedback? (default: no)
+ *  - idle backoff: Let threads that run out of work during photon propagation
+ *    back off and park instead of busy spinning? (default: no)
+ *  - maximum idle park time: Maximum time a parked thread waits before it
+ *    looks for work again, in microseconds (default: 1000)
+ *  - source copy level: Copy level for subgrids that contain a source
+ *    (default: 4)
+ *  - adaptive copy levels: Adapt the copy levels of all subgrids to their
+ *    share of the photon traversal cost after every radiation step? (default:
+ *    no)
+ *  - maximum copy level: Maximum copy level for adaptive copy levels
+ *    (default: 6)
  *
  * @param parser CommandLineParser that contains the parsed command line
  * arguments.
@@ -1388,6 +1403,26 @@ int TaskBasedRadiationHydrodynamicsSimulation::do_simulation(
   const int_fast32_t num_thread = parser.get_value< int_fast32_t >("threads");
   set_number_of_threads(num_thread);
 
+  NUMATopology *numa_topology = nullptr;
+#ifdef USE_NUMA
+  // pin the threads to the cores of the NUMA domains, so that memory that is
+  // first touched by a thread is allocated in its NUMA domain
+  numa_topology = new NUMATopology(num_thread, log);
+  {
+    AtomicValue< int_fast32_t > number_of_pinned_threads(0);
+#ifdef HAVE_OPENMP
+#pragma omp parallel default(shared)
+#endif
+    if (numa_topology->pin_thread(get_thread_index())) {
+      number_of_pinned_threads.pre_increment();
+    }
+    if (log && number_of_pinned_threads.value() < num_thread) {
+      log->write_warning("Only ", number_of_pinned_threads.value(), " of ",
+                         num_thread, " threads could be pinned to a core!");
+    }
+  }
+#endif
+
   // set the unit for time stats terminal output
   std::string output_time_unit =
       parser.get_value< std::string >("output-time-unit");
@@ -1483,10 +1518,21 @@ int TaskBasedRadiationHydrodynamicsSimulation::do_simulation(
       "TaskBasedRadiationHydrodynamicsSimulation:do radiation", true);
 
 
-  const bool do_self_gravity = params->get_value< bool>(
-         "TaskBasedRadiationHydrodynamicsSimulation:do self gravity",false);
-  const double self_grav_theta = params->get_value<double>(
-       "TaskBasedRadiationHydrodynamicsSimulation:self gravity theta", 0.5);
+  const bool do_self_gravity = params->get_value< bool >(
+      "TaskBasedRadiationHydrodynamicsSimulation:do self gravity", false);
+  const double self_grav_theta = params->get_value< double >(
+      "TaskBasedRadiationHydrodynamicsSimulation:self gravity theta", 0.5);
+  // maximum number of cells in a leaf of the self-gravity tree
+  const uint_fast32_t self_grav_leaf_size = params->get_value< uint_fast32_t >(
+      "TaskBasedRadiationHydrodynamicsSimulation:self gravity leaf size", 8);
+  // method used to compute the self-gravity: a tree walk ("tree") or an FFT
+  // based Poisson solve on the grid ("fft")
+  const std::string self_grav_solver = params->get_value< std::string >(
+      "TaskBasedRadiationHydrodynamicsSimulation:self gravity solver", "tree");
+  if (self_grav_solver != "tree" && self_grav_solver != "fft") {
+    cmac_error("Unknown self gravity solver: \"%s\"!",
+               self_grav_solver.c_str());
+  }
 
 
   if (restart_reader != nullptr) {
@@ -1555,8 +1601,19 @@ int TaskBasedRadiationHydrodynamicsSimulation::do_simulation(
     grid_creator = new DensitySubGridCreator< HydroDensitySubGrid >(
         simulation_box.get_box(), *params);
   } else {
-    grid_creator =
-        new DensitySubGridCreator< HydroDensitySubGrid >(*restart_reader);
+    // restart files without checkpoint tag contain the full grid
+    if (restart_reader->peek< uint64_t >() == RESTARTMANAGER_CHECKPOINT_TAG) {
+      restart_reader->read< uint64_t >();
+      CheckpointReader *checkpoint_reader =
+          RestartManager::get_checkpoint_reader(
+              parser.get_value< std::string >("restart"), log);
+      grid_creator = new DensitySubGridCreator< HydroDensitySubGrid >(
+          *restart_reader, checkpoint_reader);
+      delete checkpoint_reader;
+    } else {
+      grid_creator =
+          new DensitySubGridCreator< HydroDensitySubGrid >(*restart_reader);
+    }
   }
   time_logger.end("density grid creation");
 
@@ -1572,7 +1629,10 @@ int TaskBasedRadiationHydrodynamicsSimulation::do_simulation(
                                         simulation_box.get_box(), *params, log);
       time_logger.end("turbulence initialization");
     } else {
-      turbulence_forcing = new AlveliusTurbulenceForcing(*restart_reader);
+      turbulence_forcing = new AlveliusTurbulenceForcing(
+          *restart_reader,
+          params->get_value< bool >("TurbulenceForcing:separable evaluation",
+                                    false));
     }
   }
 
@@ -1609,6 +1669,13 @@ int TaskBasedRadiationHydrodynamicsSimulation::do_simulation(
   const bool do_stellar_feedback = params->get_value< bool >(
       "TaskBasedRadiationHydrodynamicsSimulation:do stellar feedback", false);
 
+  const bool idle_backoff = params->get_value< bool >(
+      "TaskBasedRadiationHydrodynamicsSimulation:idle backoff", false);
+  const uint_fast32_t maximum_idle_park_time =
+      params->get_value< uint_fast32_t >(
+          "TaskBasedRadiationHydrodynamicsSimulation:maximum idle park time",
+          1000);
+
   // fifth: construct the stellar sources. These should be stored in a
   // separate StellarSources object with geometrical and physical properties.
   PhotonSourceDistribution *sourcedistribution = nullptr;
@@ -1670,6 +1737,10 @@ int TaskBasedRadiationHydrodynamicsSimulation::do_simulation(
 
   const double source_copy_level = params->get_value< double >(
       "TaskBasedRadiationHydrodynamicsSimulation:source copy level", 4);
+  const bool adaptive_copy_levels = params->get_value< bool >(
+      "TaskBasedRadiationHydrodynamicsSimulation:adaptive copy levels", false);
+  const uint_fast8_t maximum_copy_level = params->get_value< uint_fast32_t >(
+      "TaskBasedRadiationHydrodynamicsSimulation:maximum copy level", 6);
 
 
 
@@ -1746,10 +1817,22 @@ int TaskBasedRadiationHydrodynamicsSimulation::do_simulation(
       log->write_status("Initializing grid...");
     }
     memory_logger.add_entry("grid");
+    Timer grid_timer;
+    grid_timer.start();
     start_parallel_timing_block();
     grid_creator->initialize(*density_function);
     stop_parallel_timing_block();
 
+    // particle based density functions can deposit their particles directly
+    // onto the grid, instead of being evaluated for every cell
+    const SPHScatterMapping *scatter_mapping =
+        density_function->get_scatter_mapping();
+    if (scatter_mapping != nullptr) {
+      start_parallel_timing_block();
+      scatter_mapping->deposit(*grid_creator);
+      stop_parallel_timing_block();
+    }
+
 #ifdef VARIABLE_ABUNDANCES
     for (auto gridit = grid_creator->begin();
          gridit != grid_creator->original_end(); ++gridit) {
@@ -1762,8 +1845,14 @@ int TaskBasedRadiationHydrodynamicsSimulation::do_simulation(
 #endif
 
     memory_logger.finalize_entry();
+    grid_timer.stop();
     if (log) {
-      log->write_status("Done.");
+      log->write_status("Done (", Utilities::human_readable_time(
+                                      grid_timer.value()),
+                        ", peak memory usage: ",
+                        Utilities::human_readable_bytes(
+                            OperatingSystem::get_peak_memory_usage()),
+                        ").");
     }
 
     memory_logger.add_entry("postinit");
@@ -1802,11 +1891,16 @@ int TaskBasedRadiationHydrodynamicsSimulation::do_simulation(
     log->write_status("Allocating per thread queues...");
   }
   memory_logger.add_entry("per thread queues");
-  std::vector< TaskQueue * > queues(num_thread);
+  std::vector< ThreadTaskQueue * > queues(num_thread);
   for (int_fast8_t ithread = 0; ithread < num_thread; ++ithread) {
     std::stringstream queue_name;
     queue_name << "Queue for Thread " << static_cast< int_fast32_t >(ithread);
+#ifdef USE_WORK_STEALING
+    queues[ithread] = new WorkStealingTaskQueue(queue_size_per_thread,
+                                                queue_name.str(), ithread);
+#else
     queues[ithread] = new TaskQueue(queue_size_per_thread, queue_name.str());
+#endif
   }
   memory_logger.finalize_entry();
   if (log) {
@@ -1897,48 +1991,36 @@ int TaskBasedRadiationHydrodynamicsSimulation::do_simulation(
 
 
 
+  LinearOctreeGravity *self_gravity_tree = nullptr;
+  FFTPoissonSolver *self_gravity_fft = nullptr;
   if (do_self_gravity) {
-
-
-    BarnesHutTree tree(simulation_box.get_box().get_sides(),simulation_box.get_box().get_anchor(),self_grav_theta);
-
-
-    AtomicValue< size_t > igrid(0);
-    while (igrid.value() < grid_creator->number_of_original_subgrids()) {
-      const size_t this_igrid = igrid.post_increment();
-      if (this_igrid < grid_creator->number_of_original_subgrids()) {
-        HydroDensitySubGrid &subgrid = *grid_creator->get_subgrid(this_igrid);
-        for (auto it = subgrid.hydro_begin(); it != subgrid.hydro_end();
-             ++it) {
-               tree.insert(it);
-        }
-
-      }
-    }
-
-    igrid.set(0);
-#ifdef HAVE_OPENMP
-#pragma omp parallel default(shared)
-#endif
-    while (igrid.value() < grid_creator->number_of_original_subgrids()) {
-      const size_t this_igrid = igrid.post_increment();
-      if (this_igrid < grid_creator->number_of_original_subgrids()) {
-        HydroDensitySubGrid &subgrid = *grid_creator->get_subgrid(this_igrid);
-        for (auto it = subgrid.hydro_begin(); it != subgrid.hydro_end();
-             ++it) {
-            CoordinateVector<double> accel = tree.compute_gravity(it);
-            if (external_potential!= nullptr){
-              it.get_hydro_variables().set_gravitational_acceleration(accel + it.get_hydro_variables().get_gravitational_acceleration());
-            } else {
-              it.get_hydro_variables().set_gravitational_acceleration(accel);
-            }
-
-        }
-
+    if (self_grav_solver == "fft") {
+      const CoordinateVector< bool > periodic =
+          simulation_box.get_periodicity();
+      if (periodic.x() != periodic.y() || periodic.x() != periodic.z()) {
+        cmac_error("The FFT self gravity solver does not support mixed "
+                   "periodic and non-periodic boundaries!");
       }
+      const CoordinateVector< int_fast32_t > subgrid_layout =
+          grid_creator->get_subgrid_layout();
+      const CoordinateVector< int_fast32_t > cell_layout =
+          grid_creator->get_subgrid_cell_layout();
+      const CoordinateVector< int_fast32_t > number_of_cells(
+          subgrid_layout.x() * cell_layout.x(),
+          subgrid_layout.y() * cell_layout.y(),
+          subgrid_layout.z() * cell_layout.z());
+      self_gravity_fft = new FFTPoissonSolver(
+          simulation_box.get_box(), number_of_cells, periodic.x(),
+          SUBGRIDSELFGRAVITY_NEWTON_CONSTANT);
+      compute_self_gravity(*grid_creator, *self_gravity_fft,
+                           external_potential != nullptr, false);
+    } else {
+      self_gravity_tree = new LinearOctreeGravity(
+          simulation_box.get_box(), self_grav_theta, self_grav_leaf_size,
+          SUBGRIDSELFGRAVITY_NEWTON_CONSTANT);
+      compute_self_gravity(*grid_creator, *self_gravity_tree,
+                           external_potential != nullptr, false);
     }
-
-
   }
 
   if (sourcedistribution != nullptr) {
@@ -2074,29 +2156,7 @@ int TaskBasedRadiationHydrodynamicsSimulation::do_simulation(
     }
 
     // impose copy restrictions
-    {
-      uint_fast8_t max_level = 0;
-      const size_t levelsize = levels.size();
-      for (size_t i = 0; i < levelsize; ++i) {
-        max_level = std::max(max_level, levels[i]);
-      }
-
-      size_t ngbs[6];
-      while (max_level > 0) {
-        for (size_t i = 0; i < levelsize; ++i) {
-          if (levels[i] == max_level) {
-            const uint_fast8_t numngbs = grid_creator->get_neighbours(i, ngbs);
-            for (uint_fast8_t ingb = 0; ingb < numngbs; ++ingb) {
-              const size_t ngbi = ngbs[ingb];
-              if (levels[ngbi] < levels[i] - 1) {
-                levels[ngbi] = levels[i] - 1;
-              }
-            }
-          }
-        }
-        --max_level;
-      }
-    }
+    grid_creator->restrict_copy_levels(levels);
     memory_logger.add_entry("subgrid copies");
     grid_creator->create_copies(levels);
     memory_logger.finalize_entry();
@@ -2312,7 +2372,9 @@ int TaskBasedRadiationHydrodynamicsSimulation::do_simulation(
           }
           cmac_assert(number_of_photons_done == numphoton);
 
-          bool global_run_flag = true;
+          // signals the end of the photon propagation; also handles idle
+          // threads if idle backoff is enabled
+          IdleHandler idle_handler(10, 10, maximum_idle_park_time);
           AtomicValue< uint_fast32_t > num_photon_done(0);
 
 
@@ -2341,7 +2403,7 @@ int TaskBasedRadiationHydrodynamicsSimulation::do_simulation(
           PrematureLaunchTaskContext< HydroDensitySubGrid > premature_launch(
               *buffers, *grid_creator, *tasks, queues, *shared_queue);
 
-          Scheduler scheduler(*tasks, queues, *shared_queue);
+          Scheduler scheduler(*tasks, queues, *shared_queue, numa_topology);
 
           start_parallel_timing_block();
 #ifdef HAVE_OPENMP
@@ -2359,16 +2421,25 @@ int TaskBasedRadiationHydrodynamicsSimulation::do_simulation(
             }
 
             // actual run flag
+            IdleHandler::Backoff backoff;
+            uint_fast64_t idle_epoch = 0;
             uint_fast32_t current_index = shared_queue->get_task(*tasks);
-            while (global_run_flag) {
+            while (!idle_handler.is_finished()) {
 
               if (current_index == NO_TASK) {
-                premature_launch.execute();
+                idle_epoch = idle_handler.prepare_wait();
+                // a launched task can be picked up by other (parked) threads
+                // too
+                if (premature_launch.execute() && idle_backoff) {
+                  idle_handler.notify();
+                }
                 current_index = scheduler.get_task(thread_id);
               }
 
               while (current_index != NO_TASK) {
 
+                backoff.reset();
+
                 // execute task
                 uint_fast32_t num_tasks_to_add = 0;
                 uint_fast32_t tasks_to_add[TRAVELDIRECTION_NUMBER];
@@ -2405,16 +2476,30 @@ int TaskBasedRadiationHydrodynamicsSimulation::do_simulation(
                     queues[queues_to_add[itask]]->add_task(tasks_to_add[itask]);
                   }
                 }
+                if (idle_backoff && num_tasks_to_add > 0) {
+                  idle_handler.notify();
+                }
 
                 current_index = scheduler.get_task(thread_id);
               }
 
-              if (buffers->is_empty() && num_photon_done.value() == numphoton) {
-                global_run_flag = false;
-              } else {
+              // only idle threads check the termination condition; with idle
+              // backoff, only one idle thread at a time does so
+              if (!idle_backoff || idle_handler.try_lock_termination_check()) {
+                if (buffers->is_empty() &&
+                    num_photon_done.value() == numphoton) {
+                  idle_handler.finish();
+                } else if (idle_backoff) {
+                  idle_handler.unlock_termination_check();
+                }
+              }
+              if (!idle_handler.is_finished()) {
+                if (idle_backoff) {
+                  idle_handler.wait(backoff, idle_epoch);
+                }
                 current_index = scheduler.get_task(thread_id);
               }
-            } // while(global_run_flag)
+            } // while(!idle_handler.is_finished())
 
             for (int_fast32_t itask = 0; itask < TASKTYPE_NUMBER; ++itask) {
               delete thread_contexts[itask];
@@ -2506,6 +2591,28 @@ int TaskBasedRadiationHydrodynamicsSimulation::do_simulation(
 
         time_logger.end("radiation transfer");
 
+        // adapt the copy hierarchy to the photon traversal cost of this
+        // radiation step (the new copies get their buffers reset and their
+        // properties updated at the start of the next radiation step)
+        if (adaptive_copy_levels) {
+          time_logger.start("copy level update");
+          std::vector< uint_fast8_t > new_levels;
+          grid_creator->compute_adaptive_copy_levels(
+              num_thread, maximum_copy_level, new_levels);
+          for (auto gridit = grid_creator->begin();
+               gridit != grid_creator->all_end(); ++gridit) {
+            (*gridit).reset_computational_cost();
+          }
+          if (grid_creator->update_copies(new_levels) && log) {
+            log->write_status(
+                "Updated subgrid copy levels, now using ",
+                grid_creator->number_of_actual_subgrids() -
+                    grid_creator->number_of_original_subgrids(),
+                " subgrid copies.");
+          }
+          time_logger.end("copy level update");
+        }
+
       } else {
 
         if (log) {
@@ -2693,64 +2800,17 @@ int TaskBasedRadiationHydrodynamicsSimulation::do_simulation(
 
 
     if (do_self_gravity) {
-
-      BarnesHutTree tree(simulation_box.get_box().get_sides(),simulation_box.get_box().get_anchor(),self_grav_theta);
-
-
-      AtomicValue< size_t > igrid(0);
-      while (igrid.value() < grid_creator->number_of_original_subgrids()) {
-        const size_t this_igrid = igrid.post_increment();
-        if (this_igrid < grid_creator->number_of_original_subgrids()) {
-          HydroDensitySubGrid &subgrid = *grid_creator->get_subgrid(this_igrid);
-          for (auto it = subgrid.hydro_begin(); it != subgrid.hydro_end();
-               ++it) {
-
-
-              tree.insert(it);
-
-
-          }
-
-        }
-      }
-  //    if (sourcedistribution != nullptr) {
-//
-  //      tree.remove_all_particles();
-//
-  //      std::vector<CoordinateVector<double>> sink_pos = sourcedistribution->get_sink_positions();
-  //      std::vector<double> sink_masses = sourcedistribution->get_sink_masses();
-  //      for (size_t i=0;i<sink_masses.size();i++) {
-  //        tree.insert_particle(sink_pos[i],sink_masses[i]);
-  //      }
-//
-  //    }
-
-
-      igrid.set(0);
-#ifdef HAVE_OPENMP
-#pragma omp parallel default(shared)
-#endif
-      while (igrid.value() < grid_creator->number_of_original_subgrids()) {
-        const size_t this_igrid = igrid.post_increment();
-        if (this_igrid < grid_creator->number_of_original_subgrids()) {
-          HydroDensitySubGrid &subgrid = *grid_creator->get_subgrid(this_igrid);
-          for (auto it = subgrid.hydro_begin(); it != subgrid.hydro_end();
-               ++it) {
-              if (external_potential== nullptr) {
-                it.get_hydro_variables().set_gravitational_potential(0.0);
-              }
-              CoordinateVector<double> accel = tree.compute_gravity(it);
-              if (external_potential!= nullptr){
-                it.get_hydro_variables().set_gravitational_acceleration(accel + it.get_hydro_variables().get_gravitational_acceleration());
-              } else {
-                it.get_hydro_variables().set_gravitational_acceleration(accel);
-              }
-
-          }
-
-        }
+      time_logger.start("self-gravity");
+      if (self_gravity_fft != nullptr) {
+        compute_self_gravity(*grid_creator, *self_gravity_fft,
+                             external_potential != nullptr,
+                             external_potential == nullptr);
+      } else {
+        compute_self_gravity(*grid_creator, *self_gravity_tree,
+                             external_potential != nullptr,
+                             external_potential == nullptr);
       }
-
+      time_logger.end("self-gravity");
     }
 
     // apply the turbulent forcing if applicable
@@ -2812,7 +2872,8 @@ int TaskBasedRadiationHydrodynamicsSimulation::do_simulation(
         size_t current_task = queues[thread_id]->get_task(*tasks);
         if (current_task == NO_TASK) {
           current_task =
-              steal_task(thread_id, num_thread, queues, *tasks, *grid_creator);
+              steal_task(thread_id, num_thread, queues, *tasks, *grid_creator,
+                         numa_topology);
         }
         if (current_task != NO_TASK) {
           (*tasks)[current_task].start(thread_id);
@@ -3047,56 +3108,37 @@ int TaskBasedRadiationHydrodynamicsSimulation::do_simulation(
         temperature_calculator->update_luminosity(
             sourcedistribution->get_total_luminosity());
 
-        if (log) {
-          log->write_status("Updating subgrid copy hierarchy after source "
-                            "distribution change...");
-        }
-
-        // update subgrid copies
-        std::vector< uint_fast8_t > levels(
-            grid_creator->number_of_original_subgrids(), 0);
-
-        // set the copy level off all subgrids containing a source to the given
-        // parameter value (for now)
-        {
-          const photonsourcenumber_t number_of_sources =
-              sourcedistribution->get_number_of_sources();
-          for (photonsourcenumber_t isource = 0; isource < number_of_sources;
-               ++isource) {
-            const CoordinateVector<> position =
-                sourcedistribution->get_position(isource);
-            DensitySubGridCreator< HydroDensitySubGrid >::iterator gridit =
-                grid_creator->get_subgrid(position);
-            levels[gridit.get_index()] = source_copy_level;
+        // with adaptive copy levels, the copy hierarchy follows the sources
+        // through the measured photon traversal cost instead
+        if (!adaptive_copy_levels) {
+          if (log) {
+            log->write_status("Updating subgrid copy hierarchy after source "
+                              "distribution change...");
           }
-        }
 
-        // impose copy restrictions
-        {
-          uint_fast8_t max_level = 0;
-          const size_t levelsize = levels.size();
-          for (size_t i = 0; i < levelsize; ++i) {
-            max_level = std::max(max_level, levels[i]);
-          }
+          // update subgrid copies
+          std::vector< uint_fast8_t > levels(
+              grid_creator->number_of_original_subgrids(), 0);
 
-          size_t ngbs[6];
-          while (max_level > 0) {
-            for (size_t i = 0; i < levelsize; ++i) {
-              if (levels[i] == max_level) {
-                const uint_fast8_t numngbs =
-                    grid_creator->get_neighbours(i, ngbs);
-                for (uint_fast8_t ingb = 0; ingb < numngbs; ++ingb) {
-                  const size_t ngbi = ngbs[ingb];
-                  if (levels[ngbi] < levels[i] - 1) {
-                    levels[ngbi] = levels[i] - 1;
-                  }
-                }
-              }
+          // set the copy level off all subgrids containing a source to the
+          // given parameter value (for now)
+          {
+            const photonsourcenumber_t number_of_sources =
+                sourcedistribution->get_number_of_sources();
+            for (photonsourcenumber_t isource = 0; isource < number_of_sources;
+                 ++isource) {
+              const CoordinateVector<> position =
+                  sourcedistribution->get_position(isource);
+              DensitySubGridCreator< HydroDensitySubGrid >::iterator gridit =
+                  grid_creator->get_subgrid(position);
+              levels[gridit.get_index()] = source_copy_level;
             }
-            --max_level;
           }
+
+          // impose copy restrictions
+          grid_creator->restrict_copy_levels(levels);
+          grid_creator->update_copies(levels);
         }
-        grid_creator->update_copies(levels);
 
         time_logger.end("source update");
       }
@@ -3228,7 +3270,23 @@ int TaskBasedRadiationHydrodynamicsSimulation::do_simulation(
       restart_writer->write(hydro_lastrad);
       restart_writer->write(random_seed);
 
-      grid_creator->write_restart_file(*restart_writer);
+      // the binary checkpoint only contains the cell arrays; they are written
+      // in parallel once all metadata have been written to the restart file
+      CheckpointWriter *checkpoint_writer = nullptr;
+      if (restart_manager.use_binary_checkpoint()) {
+        const uint64_t checkpoint_tag = RESTARTMANAGER_CHECKPOINT_TAG;
+        restart_writer->write(checkpoint_tag);
+        checkpoint_writer = restart_manager.get_checkpoint_writer(log);
+      }
+      grid_creator->write_restart_file(*restart_writer, checkpoint_writer);
+      if (checkpoint_writer != nullptr) {
+        const size_t checkpoint_size = checkpoint_writer->write();
+        if (log) {
+          log->write_info("Wrote ", checkpoint_size,
+                          " bytes to binary checkpoint file.");
+        }
+        delete checkpoint_writer;
+      }
 
       if (turbulence_forcing != nullptr) {
         turbulence_forcing->write_restart_file(*restart_writer);
@@ -3358,6 +3416,9 @@ int TaskBasedRadiationHydrodynamicsSimulation::do_simulation(
     delete queues[ithread];
   }
   delete shared_queue;
+  delete numa_topology;
+  delete self_gravity_tree;
+  delete self_gravity_fft;
   delete tasks;
   delete grid_creator;
 
@@ -35,6 +35,7 @@
 #include "DeRijckeRadiativeCooling.hpp"
 #include "IonizationStateCalculator.hpp"
 #include "LineCoolingData.hpp"
+#include "LineCoolingTable.hpp"
 #include "PhysicalConstants.hpp"
 #include "RecombinationRates.hpp"
 #include "WorkDistributor.hpp"
@@ -62,25 +63,35 @@
  * heating term; in m).
  * @param minimum_ionized_temperature Temperature below which gas is assumed to
  * be neutral (in K).
+ * @param leave_hot_gas Skip the temperature calculation for cells with a
+ * temperature above 10^5 K?
  * @param line_cooling_data LineCoolingData use to calculate cooling due to line
  * emission.
  * @param recombination_rates RecombinationRates used to calculate ionic
  * fractions.
  * @param charge_transfer_rates ChargeTransferRates used to calculate ionic
  * fractions.
+ * @param collisional_rates CollisionalRates used to calculate ionic fractions.
+ * @param radiative_cooling Optional DeRijckeRadiativeCooling table.
+ * @param line_cooling_table Optional LineCoolingTable used to speed up the
+ * line cooling calculation. The TemperatureCalculator takes ownership of the
+ * pointer.
  * @param log Log to write logging info to.
+ * @param warm_start Check if the temperature of the previous iteration is
+ * already converged before starting the temperature iteration for a cell?
  */
 TemperatureCalculator::TemperatureCalculator(
     bool do_temperature_computation, uint_fast32_t minimum_iteration_number,
     double luminosity, const Abundances &abundances, double epsilon_convergence,
     uint_fast32_t maximum_number_of_iterations, double pahfac, double crfac,
     double crlim, double crscale, const double minimum_ionized_temperature,
-    const bool leave_hot_gas,
-    const LineCoolingData &line_cooling_data,
+    const bool leave_hot_gas, const LineCoolingData &line_cooling_data,
     const RecombinationRates &recombination_rates,
     const ChargeTransferRates &charge_transfer_rates,
     const CollisionalRates &collisional_rates,
-    const DeRijckeRadiativeCooling* radiative_cooling, Log *log)
+    const DeRijckeRadiativeCooling* radiative_cooling,
+    const LineCoolingTable *line_cooling_table, Log *log,
+    const bool warm_start)
     : _luminosity(luminosity), _abundances(abundances), _pahfac(pahfac),
       _crfac(crfac), _crlim(crlim), _crscale(crscale),
       _line_cooling_data(line_cooling_data),
@@ -95,7 +106,8 @@ TemperatureCalculator::TemperatureCalculator(
       _maximum_number_of_iterations(maximum_number_of_iterations),
       _minimum_iteration_number(minimum_iteration_number),
       _minimum_ionized_temperature(minimum_ionized_temperature),
-      _leave_hot_gas_alone(leave_hot_gas), _log(log) {
+      _leave_hot_gas_alone(leave_hot_gas), _warm_start(warm_start),
+      _line_cooling_table(line_cooling_table), _log(log) {
 
 
 
@@ -128,6 +140,15 @@ TemperatureCalculator::TemperatureCalculator(
  *    (default: 1.33333 kpc)
  *  - minimum ionized temperature: Temperature below which gas is assumed to be
  *    neutral (default: 4000. K).
+ *  - leave hot gas: Skip the temperature calculation for cells with a
+ *    temperature above 10^5 K (default: false)
+ *  - warm start: Check if the temperature of the previous iteration is already
+ *    converged before starting the temperature iteration for a cell. This
+ *    saves two cooling and heating balance evaluations for every cell that
+ *    did not change much since the previous iteration (default: false)
+ *  - tabulate line cooling: Use a LineCoolingTable to speed up the line
+ *    cooling calculation (default: false; see LineCoolingTable for the
+ *    parameters of the table)
  *
  * @param luminosity Total ionizing luminosity of all photon sources (in s^-1).
  * @param abundances Abundances.
@@ -172,7 +193,23 @@ TemperatureCalculator::TemperatureCalculator(
               "TemperatureCalculator:minimum ionized temperature", "4000. K"),
           params.get_value< bool >("TemperatureCalculator:leave hot gas", false),
           line_cooling_data, recombination_rates, charge_transfer_rates,
-          collisional_rates, radiative_cooling,log) {}
+          collisional_rates, radiative_cooling,
+          params.get_value< bool >(
+              "TemperatureCalculator:tabulate line cooling", false)
+              ? new LineCoolingTable(line_cooling_data, params, log)
+              : nullptr,
+          log,
+          params.get_value< bool >("TemperatureCalculator:warm start",
+                                   false)) {}
+
+/**
+ * @brief Destructor.
+ *
+ * Deletes the line cooling table (if present).
+ */
+TemperatureCalculator::~TemperatureCalculator() {
+  delete _line_cooling_table;
+}
 
 /**
  * @brief Function that calculates the cooling and heating rate for a given
@@ -218,6 +255,10 @@ TemperatureCalculator::TemperatureCalculator(
  * fractions.
  * @param charge_transfer_rates ChargeTransferRates used to calculate ionic
  * fractions.
+ * @param collisional_rates CollisionalRates used to calculate ionic fractions.
+ * @param radiative_cooling Optional DeRijckeRadiativeCooling table.
+ * @param line_cooling_table Optional LineCoolingTable used instead of
+ * line_cooling_data to calculate line cooling (can be a nullptr).
  */
 void TemperatureCalculator::compute_cooling_and_heating_balance(
     double &h0, double &he0, double &gain, double &loss, double T,
@@ -229,7 +270,8 @@ void TemperatureCalculator::compute_cooling_and_heating_balance(
     const RecombinationRates &recombination_rates,
     const ChargeTransferRates &charge_transfer_rates,
     const CollisionalRates &collisional_rates,
-    const DeRijckeRadiativeCooling* radiative_cooling) {
+    const DeRijckeRadiativeCooling* radiative_cooling,
+    const LineCoolingTable *line_cooling_table) {
 
   /// step 0: initialize some variables
 
@@ -483,7 +525,11 @@ void TemperatureCalculator::compute_cooling_and_heating_balance(
 #endif
 
 #else
-  loss = line_cooling_data.get_cooling(T, ne, abund) * n;
+  if (line_cooling_table != nullptr) {
+    loss = line_cooling_table->get_cooling(T, ne, abund) * n;
+  } else {
+    loss = line_cooling_data.get_cooling(T, ne, abund) * n;
+  }
 #endif
 
   // free-free cooling (bremsstrahlung)
@@ -822,30 +868,65 @@ void TemperatureCalculator::calculate_temperature(
   double loss0 = 0.;
   h0 = 0.;
   he0 = 0.;
+  // if the temperature of the previous iteration is used as initial guess, it
+  // might already be converged; in that case, a single balance evaluation at
+  // that temperature suffices, while a secant step requires three
+  bool balance0_known = false;
+  if (_warm_start && T0 == ionization_variables.get_temperature()) {
+    compute_cooling_and_heating_balance(
+        h0, he0, gain0, loss0, T0, ionization_variables, cell_midpoint, jH,
+        jHe, j, _abundances, h, _pahfac, crfac, _crscale, _line_cooling_data,
+        _recombination_rates, _charge_transfer_rates, _collisional_rates,
+        _radiative_cooling, _line_cooling_table);
+    balance0_known = true;
+  }
   while (std::abs(gain0 - loss0) > _epsilon_convergence * gain0 &&
          niter < _maximum_number_of_iterations) {
     ++niter;
     const double T1 = 1.1 * T0;
-    // ioneng
-    double h01, he01, gain1, loss1;
-    compute_cooling_and_heating_balance(
-        h01, he01, gain1, loss1, T1, ionization_variables, cell_midpoint, jH, jHe, j,
-        _abundances, h, _pahfac, crfac, _crscale, _line_cooling_data,
-        _recombination_rates, _charge_transfer_rates, _collisional_rates, _radiative_cooling);
-
     const double T2 = 0.9 * T0;
-    // ioneng
+    double h01, he01, gain1, loss1;
     double h02, he02, gain2, loss2;
-    compute_cooling_and_heating_balance(
-        h02, he02, gain2, loss2, T2, ionization_variables, cell_midpoint, jH, jHe, j,
-        _abundances, h, _pahfac, crfac, _crscale, _line_cooling_data,
-        _recombination_rates, _charge_transfer_rates, _collisional_rates, _radiative_cooling);
-
-    // ioneng - this one sets h0, he0, gain0 and loss0
-    compute_cooling_and_heating_balance(
-        h0, he0, gain0, loss0, T0, ionization_variables, cell_midpoint, jH, jHe, j,
-        _abundances, h, _pahfac, crfac, _crscale, _line_cooling_data,
-        _recombination_rates, _charge_transfer_rates, _collisional_rates, _radiative_cooling);
+    if (balance0_known) {
+      // the balance at T0 was already computed before the loop, and the ionic
+      // fractions and cooling it stored should remain those for T0: evaluate
+      // the bracketing temperatures on a copy of the ionization variables
+      IonizationVariables bracket_variables(ionization_variables);
+      // ioneng
+      compute_cooling_and_heating_balance(
+          h01, he01, gain1, loss1, T1, bracket_variables, cell_midpoint, jH,
+          jHe, j, _abundances, h, _pahfac, crfac, _crscale, _line_cooling_data,
+          _recombination_rates, _charge_transfer_rates, _collisional_rates,
+          _radiative_cooling, _line_cooling_table);
+      // ioneng
+      compute_cooling_and_heating_balance(
+          h02, he02, gain2, loss2, T2, bracket_variables, cell_midpoint, jH,
+          jHe, j, _abundances, h, _pahfac, crfac, _crscale, _line_cooling_data,
+          _recombination_rates, _charge_transfer_rates, _collisional_rates,
+          _radiative_cooling, _line_cooling_table);
+      balance0_known = false;
+    } else {
+      // ioneng
+      compute_cooling_and_heating_balance(
+          h01, he01, gain1, loss1, T1, ionization_variables, cell_midpoint, jH, jHe, j,
+          _abundances, h, _pahfac, crfac, _crscale, _line_cooling_data,
+          _recombination_rates, _charge_transfer_rates, _collisional_rates, _radiative_cooling,
+          _line_cooling_table);
+
+      // ioneng
+      compute_cooling_and_heating_balance(
+          h02, he02, gain2, loss2, T2, ionization_variables, cell_midpoint, jH, jHe, j,
+          _abundances, h, _pahfac, crfac, _crscale, _line_cooling_data,
+          _recombination_rates, _charge_transfer_rates, _collisional_rates, _radiative_cooling,
+          _line_cooling_table);
+
+      // ioneng - this one sets h0, he0, gain0 and loss0
+      compute_cooling_and_heating_balance(
+          h0, he0, gain0, loss0, T0, ionization_variables, cell_midpoint, jH, jHe, j,
+          _abundances, h, _pahfac, crfac, _crscale, _line_cooling_data,
+          _recombination_rates, _charge_transfer_rates, _collisional_rates, _radiative_cooling,
+          _line_cooling_table);
+    }
 
     // funny detail: this value is actually constant :p
     static const double logtt = std::log(1.1 / 0.9);
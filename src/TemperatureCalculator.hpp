@@ -35,6 +35,7 @@ class Abundances;
 class ChargeTransferRates;
 class CollisionalRates;
 class LineCoolingData;
+class LineCoolingTable;
 class Log;
 class RecombinationRates;
 class DeRijckeRadiativeCooling;
@@ -116,7 +117,14 @@ private:
 
   const bool _leave_hot_gas_alone;
 
-  
+  /*! @brief Start the temperature iteration for a cell with a convergence
+   *  check at the temperature of the previous iteration? */
+  const bool _warm_start;
+
+  /*! @brief Optional table used to speed up the line cooling calculation
+   *  (owned by this object; can be a nullptr). */
+  const LineCoolingTable *_line_cooling_table;
+
 
   /*! @brief Log to write logging info to. */
   Log *_log;
@@ -133,7 +141,8 @@ public:
       const ChargeTransferRates &charge_transfer_rates,
       const CollisionalRates &collisional_rates,
       const DeRijckeRadiativeCooling* radiative_cooling,
-      Log *log = nullptr);
+      const LineCoolingTable *line_cooling_table = nullptr,
+      Log *log = nullptr, bool warm_start = false);
 
   TemperatureCalculator(double luminosity, const Abundances &abundances,
                         const LineCoolingData &line_cooling_data,
@@ -143,6 +152,13 @@ public:
                         const DeRijckeRadiativeCooling* radiative_cooling,
                         ParameterFile &params, Log *log = nullptr);
 
+  ~TemperatureCalculator();
+
+  // the TemperatureCalculator owns its LineCoolingTable, so it cannot be
+  // copied
+  TemperatureCalculator(const TemperatureCalculator &) = delete;
+  TemperatureCalculator &operator=(const TemperatureCalculator &) = delete;
+
   static void compute_cooling_and_heating_balance(
       double &h0, double &he0, double &gain, double &loss, double T,
       IonizationVariables &ionization_variables,
@@ -153,7 +169,8 @@ public:
       const RecombinationRates &recombination_rates,
       const ChargeTransferRates &charge_transfer_rates,
       const CollisionalRates &collisional_rates,
-      const DeRijckeRadiativeCooling* radiative_cooling);
+      const DeRijckeRadiativeCooling* radiative_cooling,
+      const LineCoolingTable *line_cooling_table = nullptr);
 
   void calculate_temperature(IonizationVariables &ionization_variables,
                              const double jfac, const double hfac,
@@ -266,6 +266,7 @@ public:
           ionization_variables.add_tracker(_trackers[i]);
         }
       }
+      (*gridit).set_has_trackers();
       auto copies = gridit.get_copies();
       bool first = true;
       for (auto copyit = copies.first; copyit != copies.second; ++copyit) {
@@ -276,6 +277,7 @@ public:
           _copies[i] = _trackers.size() - 1;
           first = false;
         }
+        (*copyit).set_has_trackers();
         IonizationVariables &ionization_variables =
             (*copyit)
                 .get_cell(_tracker_positions[i])
@@ -155,6 +155,7 @@ WMBasicPhotonSourceSpectrum::WMBasicPhotonSourceSpectrum(double temperature,
     _cumulative_distribution[i] /=
         _cumulative_distribution[WMBASICPHOTONSOURCESPECTRUM_NUMFREQ - 1];
   }
+  _alias_table.initialize(_cumulative_distribution.data(), WMBASICPHOTONSOURCESPECTRUM_NUMFREQ);
 
   if (log) {
     log->write_status(
@@ -225,9 +226,9 @@ std::string WMBasicPhotonSourceSpectrum::get_filename(double temperature,
 /**
  * @brief Get a random frequency from a stellar model spectrum.
  *
- * We draw a random uniform number in the range [0, 1] and find the bin in the
- * tabulated cumulative distribution that contains that number. The sampled
- * frequency is then the linearly interpolated value corresponding to that bin.
+ * We use an alias table to select a bin of the tabulated cumulative
+ * distribution in constant time. The sampled frequency is then the linearly
+ * interpolated value at a uniform random position within that bin.
  *
  * @param random_generator RandomGenerator to use.
  * @param temperature Not used for this spectrum.
@@ -236,15 +237,26 @@ std::string WMBasicPhotonSourceSpectrum::get_filename(double temperature,
 double WMBasicPhotonSourceSpectrum::get_random_frequency(
     RandomGenerator &random_generator, double temperature) const {
 
-  const double x = random_generator.get_uniform_random_double();
-  const uint_fast32_t inu = Utilities::locate(
-      x, _cumulative_distribution.data(), WMBASICPHOTONSOURCESPECTRUM_NUMFREQ);
-  const double frequency =
-      _frequencies[inu] +
-      (_frequencies[inu + 1] - _frequencies[inu]) *
-          (x - _cumulative_distribution[inu]) /
-          (_cumulative_distribution[inu + 1] - _cumulative_distribution[inu]);
-  return frequency;
+  return _alias_table.sample_linear(
+      random_generator.get_uniform_random_double(), _frequencies.data());
+}
+
+/**
+ * @brief Get a batch of random frequencies from the spectrum.
+ *
+ * @param random_generator RandomGenerator to use.
+ * @param frequencies Array to store the random frequencies in (in Hz).
+ * @param number_of_frequencies Number of frequencies to draw.
+ * @param temperature Not used for this spectrum.
+ */
+void WMBasicPhotonSourceSpectrum::get_random_frequencies(
+    RandomGenerator &random_generator, double *frequencies,
+    const uint_fast32_t number_of_frequencies, double temperature) const {
+
+  for (uint_fast32_t i = 0; i < number_of_frequencies; ++i) {
+    frequencies[i] = _alias_table.sample_linear(
+        random_generator.get_uniform_random_double(), _frequencies.data());
+  }
 }
 
 /**
@@ -0,0 +1,633 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file WorkStealingTaskQueue.hpp
+ *
+ * @brief Lock-free per thread task queue that supports work stealing.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#ifndef WORKSTEALINGTASKQUEUE_HPP
+#define WORKSTEALINGTASKQUEUE_HPP
+
+#include "Configuration.hpp"
+#include "Error.hpp"
+#include "OpenMP.hpp"
+#include "Task.hpp"
+#include "TaskQueue.hpp"
+#include "ThreadSafeVector.hpp"
+
+#include <atomic>
+#include <cinttypes>
+#include <string>
+
+/*! @brief Maximum number of deferred tasks that are retried during a single
+ *  task request. */
+#define WORKSTEALINGTASKQUEUE_MAX_DEFERRED_RETRIES 64
+
+/*! @brief Size of the padding used to put frequently accessed atomic indices
+ *  on different cache lines. */
+#define WORKSTEALINGTASKQUEUE_PADDING_SIZE 64
+
+/**
+ * @brief Bounded lock-free multi-producer multi-consumer ring buffer of task
+ * indices.
+ *
+ * Every slot carries a sequence number that tells producers and consumers if
+ * the slot is ready to be written or read (Vyukov, 2010). Producers and
+ * consumers only contend on the atomic position counters, and never block.
+ */
+class TaskIndexRing {
+private:
+  /**
+   * @brief Single slot in the ring.
+   */
+  struct Slot {
+    /*! @brief Sequence number of the slot. */
+    std::atomic< size_t > _sequence;
+
+    /*! @brief Task index stored in the slot. */
+    size_t _task;
+  };
+
+  /*! @brief Slots. */
+  Slot *_slots;
+
+  /*! @brief Mask used to convert positions into slot indices (size of the ring
+   *  minus 1; the size is a power of 2). */
+  const size_t _mask;
+
+  /*! @brief Padding to put the push position on its own cache line. */
+  char _padding0[WORKSTEALINGTASKQUEUE_PADDING_SIZE];
+
+  /*! @brief Position where the next task will be pushed. */
+  std::atomic< size_t > _push_position;
+
+  /*! @brief Padding to put the pop position on its own cache line. */
+  char _padding1[WORKSTEALINGTASKQUEUE_PADDING_SIZE];
+
+  /*! @brief Position where the next task will be popped. */
+  std::atomic< size_t > _pop_position;
+
+  /*! @brief Padding to separate the pop position from whatever comes next. */
+  char _padding2[WORKSTEALINGTASKQUEUE_PADDING_SIZE];
+
+public:
+  /**
+   * @brief Get the smallest power of 2 that is larger than or equal to the
+   * given size.
+   *
+   * @param size Size.
+   * @return Power of 2 that can hold at least size elements.
+   */
+  inline static size_t get_power_of_two(const size_t size) {
+    size_t power = 1;
+    while (power < size) {
+      power <<= 1;
+    }
+    return power;
+  }
+
+  /**
+   * @brief Constructor.
+   *
+   * @param size Minimum number of elements the ring should be able to hold.
+   */
+  inline TaskIndexRing(const size_t size)
+      : _mask(get_power_of_two(size) - 1), _push_position(0),
+        _pop_position(0) {
+    _slots = new Slot[_mask + 1];
+    for (size_t i = 0; i < _mask + 1; ++i) {
+      _slots[i]._sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * @brief Destructor.
+   */
+  inline ~TaskIndexRing() { delete[] _slots; }
+
+  /**
+   * @brief Add a task to the ring.
+   *
+   * @param task Task to add.
+   * @return True if the task was added, false if the ring was full.
+   */
+  inline bool push(const size_t task) {
+    size_t position = _push_position.load(std::memory_order_relaxed);
+    while (true) {
+      Slot &slot = _slots[position & _mask];
+      const size_t sequence = slot._sequence.load(std::memory_order_acquire);
+      const intptr_t difference =
+          static_cast< intptr_t >(sequence) - static_cast< intptr_t >(position);
+      if (difference == 0) {
+        if (_push_position.compare_exchange_weak(position, position + 1,
+                                                 std::memory_order_relaxed)) {
+          slot._task = task;
+          slot._sequence.store(position + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (difference < 0) {
+        // the slot has not been released by the consumer of the previous
+        // cycle yet. This either means the ring is full, or that a consumer
+        // is still reading it (which is possible for a ring that is almost
+        // empty if the consumer thread was suspended), or that our position
+        // is outdated; only bail out in the first case
+        const intptr_t number_of_elements =
+            static_cast< intptr_t >(position) -
+            static_cast< intptr_t >(
+                _pop_position.load(std::memory_order_relaxed));
+        if (number_of_elements > static_cast< intptr_t >(_mask)) {
+          return false;
+        }
+        position = _push_position.load(std::memory_order_relaxed);
+      } else {
+        position = _push_position.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * @brief Remove the oldest task from the ring.
+   *
+   * @return Task, or NO_TASK if the ring is empty.
+   */
+  inline size_t pop() {
+    size_t position = _pop_position.load(std::memory_order_relaxed);
+    while (true) {
+      Slot &slot = _slots[position & _mask];
+      const size_t sequence = slot._sequence.load(std::memory_order_acquire);
+      const intptr_t difference = static_cast< intptr_t >(sequence) -
+                                  static_cast< intptr_t >(position + 1);
+      if (difference == 0) {
+        if (_pop_position.compare_exchange_weak(position, position + 1,
+                                                std::memory_order_relaxed)) {
+          const size_t task = slot._task;
+          slot._sequence.store(position + _mask + 1, std::memory_order_release);
+          return task;
+        }
+      } else if (difference < 0) {
+        return NO_TASK;
+      } else {
+        position = _pop_position.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * @brief Get the (approximate) number of tasks in the ring.
+   *
+   * @return Number of tasks in the ring at some point during the call.
+   */
+  inline size_t size() const {
+    const size_t pop_position = _pop_position.load(std::memory_order_relaxed);
+    const size_t push_position = _push_position.load(std::memory_order_relaxed);
+    return (push_position > pop_position) ? push_position - pop_position : 0;
+  }
+
+  /**
+   * @brief Get the capacity of the ring.
+   *
+   * @return Maximum number of tasks that can be stored in the ring.
+   */
+  inline size_t capacity() const { return _mask + 1; }
+};
+
+/**
+ * @brief Lock-free per thread task queue that supports work stealing.
+ *
+ * The queue consists of three parts:
+ *  - a Chase-Lev deque (Chase & Lev, 2005; Lê et al., 2013) that is only
+ *    pushed to and popped from by the owning thread (newest task first), and
+ *    from which other threads can steal the oldest task without locking,
+ *  - an inbox that collects tasks that are added by other threads,
+ *  - a deferred list that collects tasks whose dependency could not be locked
+ *    when they were taken from the queue.
+ *
+ * Tasks whose dependency is busy are moved to the deferred list instead of
+ * being shuffled around in place, so that every access to the queue only
+ * involves a small, bounded number of atomic operations. Deferred tasks are
+ * retried (in the order in which they were deferred) after the deque and the
+ * inbox have been exhausted.
+ *
+ * The public interface mirrors that of TaskQueue, so that both can be used
+ * interchangeably as per thread queue.
+ */
+class WorkStealingTaskQueue {
+private:
+  /*! @brief Circular deque buffer. */
+  std::atomic< size_t > *_deque;
+
+  /*! @brief Mask used to convert deque positions into buffer indices. */
+  const int_fast64_t _deque_mask;
+
+  /*! @brief Padding to put the top index on its own cache line. */
+  char _padding0[WORKSTEALINGTASKQUEUE_PADDING_SIZE];
+
+  /*! @brief Top of the deque (position of the oldest task; thieves steal from
+   *  here). */
+  std::atomic< int_fast64_t > _top;
+
+  /*! @brief Padding to put the bottom index on its own cache line. */
+  char _padding1[WORKSTEALINGTASKQUEUE_PADDING_SIZE];
+
+  /*! @brief Bottom of the deque (position after the newest task; only changed
+   *  by the owning thread). */
+  std::atomic< int_fast64_t > _bottom;
+
+  /*! @brief Padding to separate the bottom index from the other variables. */
+  char _padding2[WORKSTEALINGTASKQUEUE_PADDING_SIZE];
+
+  /*! @brief Tasks added by threads other than the owning thread. */
+  TaskIndexRing _inbox;
+
+  /*! @brief Tasks whose dependency could not be locked. Can hold all tasks in
+   *  a full deque and a full inbox at the same time. */
+  TaskIndexRing _deferred;
+
+  /*! @brief Size of the queue. */
+  const size_t _size;
+
+  /*! @brief Thread that owns the queue. */
+  const int_fast32_t _owner;
+
+#ifdef QUEUE_STATS
+  /*! @brief Maximum size of the queue at any given time. */
+  std::atomic< size_t > _max_queue_size;
+
+  /*! @brief Total number of tasks stored in the queue. */
+  std::atomic< size_t > _total_queue_size;
+
+  /*! @brief Average queue size accumulator (only updated by the owner). */
+  double _avg_queue_size;
+
+  /*! @brief Average queue size evaluation counter (only updated by the
+   *  owner). */
+  double _avg_queue_size_count;
+#endif
+
+  /*! @brief Label to identify this queue in error messages. */
+  const std::string _label;
+
+  /**
+   * @brief Push a task onto the bottom of the deque.
+   *
+   * Should only be called by the owning thread.
+   *
+   * @param task Task to push.
+   */
+  inline void push_bottom(const size_t task) {
+    const int_fast64_t bottom = _bottom.load(std::memory_order_relaxed);
+    const int_fast64_t top = _top.load(std::memory_order_acquire);
+    if (bottom - top > _deque_mask) {
+      cmac_error("Too many tasks in queue (%zu)! (%s)", _size, _label.c_str());
+    }
+    _deque[bottom & _deque_mask].store(task, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    _bottom.store(bottom + 1, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Pop the newest task from the bottom of the deque.
+   *
+   * Should only be called by the owning thread.
+   *
+   * @return Task, or NO_TASK if the deque is empty.
+   */
+  inline size_t pop_bottom() {
+    const int_fast64_t bottom = _bottom.load(std::memory_order_relaxed) - 1;
+    _bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int_fast64_t top = _top.load(std::memory_order_relaxed);
+    size_t task = NO_TASK;
+    if (top <= bottom) {
+      task = _deque[bottom & _deque_mask].load(std::memory_order_relaxed);
+      if (top == bottom) {
+        // last task in the deque: race against thieves
+        if (!_top.compare_exchange_strong(top, top + 1,
+                                          std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+          task = NO_TASK;
+        }
+        _bottom.store(bottom + 1, std::memory_order_relaxed);
+      }
+    } else {
+      _bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return task;
+  }
+
+  /**
+   * @brief Steal the oldest task from the top of the deque.
+   *
+   * Can be called by any thread.
+   *
+   * @return Task, or NO_TASK if the deque is empty or another thread got there
+   * first.
+   */
+  inline size_t steal_top() {
+    int_fast64_t top = _top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int_fast64_t bottom = _bottom.load(std::memory_order_acquire);
+    if (top < bottom) {
+      const size_t task =
+          _deque[top & _deque_mask].load(std::memory_order_relaxed);
+      if (_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                       std::memory_order_relaxed)) {
+        return task;
+      }
+    }
+    return NO_TASK;
+  }
+
+  /**
+   * @brief Put a task whose dependency could not be locked in the deferred
+   * list.
+   *
+   * @param task Task.
+   */
+  inline void defer_task(const size_t task) {
+    if (!_deferred.push(task)) {
+      cmac_error("Too many deferred tasks in queue (%zu)! (%s)", _size,
+                 _label.c_str());
+    }
+  }
+
+  /**
+   * @brief Retry a limited number of deferred tasks.
+   *
+   * @param tasks Task space.
+   * @return Task whose dependency was locked, or NO_TASK if none of the tried
+   * tasks could be locked.
+   */
+  inline size_t retry_deferred_tasks(ThreadSafeVector< Task > &tasks) {
+    size_t number_of_retries = std::min(
+        _deferred.size(),
+        static_cast< size_t >(WORKSTEALINGTASKQUEUE_MAX_DEFERRED_RETRIES));
+    while (number_of_retries > 0) {
+      const size_t task = _deferred.pop();
+      if (task == NO_TASK) {
+        return NO_TASK;
+      }
+      if (tasks[task].lock_dependency()) {
+        return task;
+      }
+      defer_task(task);
+      --number_of_retries;
+    }
+    return NO_TASK;
+  }
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param size Size of the queue.
+   * @param label Label to identify this queue in error messages.
+   * @param owner Thread that owns the queue. Only this thread will push to and
+   * pop from the deque; all other threads use the lock-free inbox and steal
+   * operations.
+   */
+  inline WorkStealingTaskQueue(const size_t size, const std::string label = "",
+                               const int_fast32_t owner = 0)
+      : _deque_mask(TaskIndexRing::get_power_of_two(size) - 1), _top(0),
+        _bottom(0), _inbox(size), _deferred(2 * size), _size(size),
+        _owner(owner),
+        _label(label) {
+    _deque = new std::atomic< size_t >[_deque_mask + 1];
+#ifdef QUEUE_STATS
+    _max_queue_size.store(0);
+    _total_queue_size.store(0);
+    _avg_queue_size = 0;
+    _avg_queue_size_count = 0;
+#endif
+  }
+
+  /**
+   * @brief Destructor.
+   */
+  inline ~WorkStealingTaskQueue() { delete[] _deque; }
+
+  /**
+   * @brief Add a task to the queue.
+   *
+   * If the calling thread owns the queue, the task is pushed onto the deque.
+   * Otherwise, it is added to the inbox.
+   *
+   * @param task Task to add.
+   */
+  inline void add_task(const size_t task) {
+    if (get_thread_index() == _owner) {
+      push_bottom(task);
+    } else {
+      if (!_inbox.push(task)) {
+        cmac_error("Too many tasks in queue inbox (%zu)! (%s)", _size,
+                   _label.c_str());
+      }
+    }
+#ifdef QUEUE_STATS
+    _total_queue_size.fetch_add(1, std::memory_order_relaxed);
+    const size_t current_size = size();
+    size_t max_size = _max_queue_size.load(std::memory_order_relaxed);
+    while (max_size < current_size &&
+           !_max_queue_size.compare_exchange_weak(max_size, current_size,
+                                                  std::memory_order_relaxed)) {
+    }
+#endif
+  }
+
+  /**
+   * @brief Add all tasks in the given range to the queue.
+   *
+   * @param task_start First task to add.
+   * @param task_end Last task to add.
+   */
+  inline void add_tasks(const size_t task_start, const size_t task_end) {
+    for (size_t itask = task_start; itask < task_end; ++itask) {
+      add_task(itask);
+    }
+  }
+
+  /**
+   * @brief Get a task from the queue.
+   *
+   * When called by the owning thread, the deque is popped newest task first,
+   * followed by the inbox and the deferred list. Tasks whose dependency
+   * cannot be locked are moved to the deferred list. When called by another
+   * thread, this is equivalent to try_get_task().
+   *
+   * @param tasks Task space.
+   * @return Task, or NO_TASK if no task is available.
+   */
+  inline size_t get_task(ThreadSafeVector< Task > &tasks) {
+
+    if (get_thread_index() != _owner) {
+      return try_get_task(tasks);
+    }
+
+#ifdef QUEUE_STATS
+    _avg_queue_size += size();
+    ++_avg_queue_size_count;
+#endif
+
+    size_t task = pop_bottom();
+    while (task != NO_TASK) {
+      if (tasks[task].lock_dependency()) {
+        return task;
+      }
+      defer_task(task);
+      task = pop_bottom();
+    }
+
+    task = _inbox.pop();
+    while (task != NO_TASK) {
+      if (tasks[task].lock_dependency()) {
+        return task;
+      }
+      defer_task(task);
+      task = _inbox.pop();
+    }
+
+    return retry_deferred_tasks(tasks);
+  }
+
+  /**
+   * @brief Try to steal a task from the queue.
+   *
+   * This version can be called by any thread and never blocks: the oldest
+   * task on the deque is stolen, or, if that fails, the oldest task in the
+   * inbox is taken. A limited number of deferred tasks is retried last.
+   *
+   * @param tasks Task space.
+   * @return Task, or NO_TASK if no task is available.
+   */
+  inline size_t try_get_task(ThreadSafeVector< Task > &tasks) {
+
+    size_t task = steal_top();
+    if (task != NO_TASK) {
+      if (tasks[task].lock_dependency()) {
+        return task;
+      }
+      defer_task(task);
+    }
+
+    task = _inbox.pop();
+    if (task != NO_TASK) {
+      if (tasks[task].lock_dependency()) {
+        return task;
+      }
+      defer_task(task);
+    }
+
+    return retry_deferred_tasks(tasks);
+  }
+
+  /**
+   * @brief Get the current size of the queue.
+   *
+   * The result is only approximate if other threads are accessing the queue
+   * at the same time.
+   *
+   * @return Current size of the queue.
+   */
+  inline size_t size() const {
+    const int_fast64_t top = _top.load(std::memory_order_relaxed);
+    const int_fast64_t bottom = _bottom.load(std::memory_order_relaxed);
+    const size_t deque_size = (bottom > top) ? bottom - top : 0;
+    return deque_size + _inbox.size() + _deferred.size();
+  }
+
+  /**
+   * @brief Get the size in memory of the queue.
+   *
+   * @return Size in memory of the queue (in bytes).
+   */
+  inline size_t get_memory_size() const {
+    return sizeof(WorkStealingTaskQueue) +
+           (_deque_mask + 1) * sizeof(std::atomic< size_t >) +
+           (_inbox.capacity() + _deferred.capacity()) *
+               (sizeof(std::atomic< size_t >) + sizeof(size_t));
+  }
+
+/**
+ * @brief Get the maximum size of the queue.
+ *
+ * @return Maximum size of the queue.
+ */
+#ifdef QUEUE_STATS
+  inline size_t get_max_queue_size() const { return _max_queue_size.load(); }
+#endif
+
+/**
+ * @brief Get the total number of tasks that was stored in the queue.
+ *
+ * @return Total number of tasks stored in the queue.
+ */
+#ifdef QUEUE_STATS
+  inline size_t get_total_queue_size() const {
+    return _total_queue_size.load();
+  }
+#endif
+
+  /**
+   * @brief Get the average size of the queue over all task requests by the
+   * owning thread.
+   *
+   * @return Average size of the queue
+   */
+#ifdef QUEUE_STATS
+  inline double get_average_queue_size() const {
+    return _avg_queue_size / _avg_queue_size_count;
+  }
+#endif
+
+/**
+ * @brief Reset the maximum size of the queue counter.
+ */
+#ifdef QUEUE_STATS
+  inline void reset_max_queue_size() { _max_queue_size.store(0); }
+#endif
+
+/**
+ * @brief Reset the counter for the total number of tasks in the queue.
+ */
+#ifdef QUEUE_STATS
+  inline void reset_total_queue_size() { _total_queue_size.store(0); }
+#endif
+
+/**
+ * @brief Reset the counters for the average queue size.
+ */
+#ifdef QUEUE_STATS
+  inline void reset_average_queue_size() {
+    _avg_queue_size = 0;
+    _avg_queue_size_count = 0;
+  }
+#endif
+};
+
+/*! @brief Queue type used for the per thread queues of the task-based
+ *  algorithms. */
+#ifdef USE_WORK_STEALING
+typedef WorkStealingTaskQueue ThreadTaskQueue;
+#else
+typedef TaskQueue ThreadTaskQueue;
+#endif
+
+#endif // WORKSTEALINGTASKQUEUE_HPP
@@ -0,0 +1,251 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file Xoshiro256PlusPlusRandomGenerator.hpp
+ *
+ * @brief xoshiro256++ random number generator.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#ifndef XOSHIRO256PLUSPLUSRANDOMGENERATOR_HPP
+#define XOSHIRO256PLUSPLUSRANDOMGENERATOR_HPP
+
+#include "RestartReader.hpp"
+#include "RestartWriter.hpp"
+
+#include <cstdint>
+
+/*! @brief Number of independent xoshiro256++ streams that are interleaved. */
+#define XOSHIRO256PLUSPLUSRANDOMGENERATOR_NUMBER_OF_LANES 4
+
+/**
+ * @brief xoshiro256++ random number generator (Blackman & Vigna, 2021, ACM
+ * Trans. Math. Softw., 47, 36).
+ *
+ * Based on https://prng.di.unimi.it/xoshiro256plusplus.c.
+ *
+ * A single xoshiro256++ stream cannot be vectorized, since every state update
+ * depends on the previous one. We therefore interleave
+ * XOSHIRO256PLUSPLUSRANDOMGENERATOR_NUMBER_OF_LANES independent streams
+ * (lanes): random number i is generated by lane
+ * i % XOSHIRO256PLUSPLUSRANDOMGENERATOR_NUMBER_OF_LANES. The lane states are
+ * stored word by word, so that fill_uniform() can update all lanes at the same
+ * time using SIMD instructions. fill_uniform() and
+ * get_uniform_random_double() produce exactly the same sequence.
+ *
+ * All lane states are initialised from the seed using the splitmix64
+ * generator, as recommended by the xoshiro authors.
+ */
+class Xoshiro256PlusPlusRandomGenerator {
+private:
+  /*! @brief State words for all lanes. */
+  uint64_t _state[4][XOSHIRO256PLUSPLUSRANDOMGENERATOR_NUMBER_OF_LANES];
+
+  /*! @brief Lane that will generate the next random number. */
+  uint_fast32_t _lane;
+
+  /**
+   * @brief Rotate the given 64-bit integer to the left.
+   *
+   * @param x Integer.
+   * @param k Number of bits to rotate.
+   * @return Rotated integer.
+   */
+  static inline uint64_t rotl(const uint64_t x, const int k) {
+    return (x << k) | (x >> (64 - k));
+  }
+
+  /**
+   * @brief Convert the given 64-bit integer to a double precision floating
+   * point value in the range [0., 1.[.
+   *
+   * @param x Integer.
+   * @return Double precision floating point value using the 53 highest bits
+   * of the integer.
+   */
+  static inline double to_double(const uint64_t x) {
+    return (x >> 11) * (1. / 9007199254740992.);
+  }
+
+  /**
+   * @brief Get the next random integer from the given lane.
+   *
+   * @param lane Lane index.
+   * @return Random 64-bit integer.
+   */
+  inline uint64_t next(const uint_fast32_t lane) {
+    uint64_t s0 = _state[0][lane];
+    uint64_t s1 = _state[1][lane];
+    uint64_t s2 = _state[2][lane];
+    uint64_t s3 = _state[3][lane];
+    const uint64_t result = rotl(s0 + s3, 23) + s0;
+    const uint64_t t = s1 << 17;
+    s2 ^= s0;
+    s3 ^= s1;
+    s1 ^= s2;
+    s0 ^= s3;
+    s2 ^= t;
+    s3 = rotl(s3, 45);
+    _state[0][lane] = s0;
+    _state[1][lane] = s1;
+    _state[2][lane] = s2;
+    _state[3][lane] = s3;
+    return result;
+  }
+
+public:
+  /**
+   * @brief Set a new seed for the random generator.
+   *
+   * @param seed New seed.
+   */
+  inline void set_seed(const int_fast32_t seed) {
+    // splitmix64
+    uint64_t x = static_cast< uint64_t >(seed);
+    for (uint_fast32_t lane = 0;
+         lane < XOSHIRO256PLUSPLUSRANDOMGENERATOR_NUMBER_OF_LANES; ++lane) {
+      for (uint_fast32_t i = 0; i < 4; ++i) {
+        x += 0x9e3779b97f4a7c15ull;
+        uint64_t z = x;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        _state[i][lane] = z ^ (z >> 31);
+      }
+    }
+    _lane = 0;
+  }
+
+  /**
+   * @brief Constructor.
+   *
+   * @param seed Initial seed for the random number generator.
+   */
+  inline Xoshiro256PlusPlusRandomGenerator(const int_fast32_t seed = 42) {
+    set_seed(seed);
+  }
+
+  /**
+   * @brief Get a uniform random double precision floating point value in the
+   * range [0., 1.[.
+   *
+   * Note that this function changes the internal state of the generator.
+   *
+   * @return Random double precision floating point value.
+   */
+  inline double get_uniform_random_double() {
+    const uint_fast32_t lane = _lane;
+    _lane = (lane + 1) % XOSHIRO256PLUSPLUSRANDOMGENERATOR_NUMBER_OF_LANES;
+    return to_double(next(lane));
+  }
+
+  /**
+   * @brief Fill the given array with uniform random double precision floating
+   * point values in the range [0., 1.[.
+   *
+   * The result is the same as for successive calls to
+   * get_uniform_random_double().
+   *
+   * @param values Array to fill.
+   * @param number_of_values Number of values to generate.
+   */
+  inline void fill_uniform(double *values,
+                           const uint_fast32_t number_of_values) {
+
+    uint_fast32_t i = 0;
+    // finish the current round over the lanes
+    while (_lane != 0 && i < number_of_values) {
+      values[i] = get_uniform_random_double();
+      ++i;
+    }
+
+    // update all lanes simultaneously
+    uint64_t s0[XOSHIRO256PLUSPLUSRANDOMGENERATOR_NUMBER_OF_LANES];
+    uint64_t s1[XOSHIRO256PLUSPLUSRANDOMGENERATOR_NUMBER_OF_LANES];
+    uint64_t s2[XOSHIRO256PLUSPLUSRANDOMGENERATOR_NUMBER_OF_LANES];
+    uint64_t s3[XOSHIRO256PLUSPLUSRANDOMGENERATOR_NUMBER_OF_LANES];
+    for (uint_fast32_t lane = 0;
+         lane < XOSHIRO256PLUSPLUSRANDOMGENERATOR_NUMBER_OF_LANES; ++lane) {
+      s0[lane] = _state[0][lane];
+      s1[lane] = _state[1][lane];
+      s2[lane] = _state[2][lane];
+      s3[lane] = _state[3][lane];
+    }
+    for (; i + XOSHIRO256PLUSPLUSRANDOMGENERATOR_NUMBER_OF_LANES <=
+           number_of_values;
+         i += XOSHIRO256PLUSPLUSRANDOMGENERATOR_NUMBER_OF_LANES) {
+      for (uint_fast32_t lane = 0;
+           lane < XOSHIRO256PLUSPLUSRANDOMGENERATOR_NUMBER_OF_LANES; ++lane) {
+        values[i + lane] = to_double(rotl(s0[lane] + s3[lane], 23) + s0[lane]);
+        const uint64_t t = s1[lane] << 17;
+        s2[lane] ^= s0[lane];
+        s3[lane] ^= s1[lane];
+        s1[lane] ^= s2[lane];
+        s0[lane] ^= s3[lane];
+        s2[lane] ^= t;
+        s3[lane] = rotl(s3[lane], 45);
+      }
+    }
+    for (uint_fast32_t lane = 0;
+         lane < XOSHIRO256PLUSPLUSRANDOMGENERATOR_NUMBER_OF_LANES; ++lane) {
+      _state[0][lane] = s0[lane];
+      _state[1][lane] = s1[lane];
+      _state[2][lane] = s2[lane];
+      _state[3][lane] = s3[lane];
+    }
+
+    // remaining values
+    for (; i < number_of_values; ++i) {
+      values[i] = get_uniform_random_double();
+    }
+  }
+
+  /**
+   * @brief Write the random number generator to the given restart file.
+   *
+   * @param restart_writer RestartWriter to use.
+   */
+  inline void write_restart_file(RestartWriter &restart_writer) const {
+
+    for (uint_fast32_t i = 0; i < 4; ++i) {
+      for (uint_fast32_t lane = 0;
+           lane < XOSHIRO256PLUSPLUSRANDOMGENERATOR_NUMBER_OF_LANES; ++lane) {
+        restart_writer.write(_state[i][lane]);
+      }
+    }
+    restart_writer.write(_lane);
+  }
+
+  /**
+   * @brief Restart constructor.
+   *
+   * @param restart_reader Restart file to read from.
+   */
+  inline Xoshiro256PlusPlusRandomGenerator(RestartReader &restart_reader) {
+
+    for (uint_fast32_t i = 0; i < 4; ++i) {
+      for (uint_fast32_t lane = 0;
+           lane < XOSHIRO256PLUSPLUSRANDOMGENERATOR_NUMBER_OF_LANES; ++lane) {
+        _state[i][lane] = restart_reader.read< uint64_t >();
+      }
+    }
+    _lane = restart_reader.read< uint_fast32_t >();
+  }
+};
+
+#endif // XOSHIRO256PLUSPLUSRANDOMGENERATOR_HPP
@@ -0,0 +1,167 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file testAliasTable.cpp
+ *
+ * @brief Unit test for the AliasTable class.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "AliasTable.hpp"
+#include "Assert.hpp"
+#include "RandomGenerator.hpp"
+#include "Utilities.hpp"
+
+#include <cmath>
+#include <vector>
+
+/*! @brief Number of nodes in the test distribution. */
+#define TESTALIASTABLE_NUMBER_OF_NODES 101
+
+/**
+ * @brief Sample the given distribution using a binary search of a uniform
+ * random number in the cumulative distribution function.
+ *
+ * This is the method that was used by all tabulated spectra before they
+ * switched to alias tables.
+ *
+ * @param uniform Uniform random number.
+ * @param cumulative_distribution Cumulative distribution function.
+ * @param nodes Values of the sampled quantity at the nodes.
+ * @return Sampled value.
+ */
+double sample_binary_search(const double uniform,
+                            const std::vector< double > &cumulative_distribution,
+                            const std::vector< double > &nodes) {
+  const uint_fast32_t i = Utilities::locate(
+      uniform, cumulative_distribution.data(), cumulative_distribution.size());
+  return nodes[i] + (nodes[i + 1] - nodes[i]) *
+                        (uniform - cumulative_distribution[i]) /
+                        (cumulative_distribution[i + 1] -
+                         cumulative_distribution[i]);
+}
+
+/**
+ * @brief Unit test for the AliasTable class.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  // set up a strongly peaked test distribution with some empty bins
+  std::vector< double > nodes(TESTALIASTABLE_NUMBER_OF_NODES);
+  std::vector< double > cumulative_distribution(TESTALIASTABLE_NUMBER_OF_NODES);
+  std::vector< double > probability(TESTALIASTABLE_NUMBER_OF_NODES - 1);
+  cumulative_distribution[0] = 0.;
+  for (uint_fast32_t i = 0; i < TESTALIASTABLE_NUMBER_OF_NODES; ++i) {
+    nodes[i] = 1. + 3. * i / (TESTALIASTABLE_NUMBER_OF_NODES - 1.);
+    if (i > 0) {
+      double p = nodes[i] * nodes[i] * std::exp(-2. * nodes[i]);
+      if (i % 17 == 0) {
+        p = 0.;
+      }
+      cumulative_distribution[i] = cumulative_distribution[i - 1] + p;
+    }
+  }
+  for (uint_fast32_t i = 0; i < TESTALIASTABLE_NUMBER_OF_NODES; ++i) {
+    cumulative_distribution[i] /= cumulative_distribution.back();
+  }
+  for (uint_fast32_t i = 0; i < TESTALIASTABLE_NUMBER_OF_NODES - 1; ++i) {
+    probability[i] = cumulative_distribution[i + 1] - cumulative_distribution[i];
+  }
+
+  const AliasTable table(cumulative_distribution.data(),
+                         TESTALIASTABLE_NUMBER_OF_NODES);
+  assert_condition(table.get_number_of_bins() ==
+                   TESTALIASTABLE_NUMBER_OF_NODES - 1);
+
+  /// deterministic test: a regular grid of uniform numbers should reproduce
+  /// the bin probabilities and a uniform position within each bin
+  {
+    const uint_fast32_t number_of_samples = 1000000;
+    std::vector< double > counts(TESTALIASTABLE_NUMBER_OF_NODES - 1, 0.);
+    std::vector< double > mean_fraction(TESTALIASTABLE_NUMBER_OF_NODES - 1, 0.);
+    for (uint_fast32_t i = 0; i < number_of_samples; ++i) {
+      double fraction;
+      const uint_fast32_t index =
+          table.sample((i + 0.5) / number_of_samples, fraction);
+      assert_condition(index < TESTALIASTABLE_NUMBER_OF_NODES - 1);
+      assert_condition(fraction >= 0. && fraction < 1.);
+      counts[index] += 1.;
+      mean_fraction[index] += fraction;
+    }
+    for (uint_fast32_t i = 0; i < TESTALIASTABLE_NUMBER_OF_NODES - 1; ++i) {
+      assert_values_equal_tol(counts[i] / number_of_samples, probability[i],
+                              1.e-5);
+      if (probability[i] == 0.) {
+        assert_condition(counts[i] == 0.);
+      } else {
+        assert_values_equal_tol(mean_fraction[i] / counts[i], 0.5, 1.e-2);
+      }
+    }
+  }
+
+  /// statistical test: the alias table and the binary search sample the same
+  /// distribution (two sample chi-squared test on a histogram)
+  {
+    const uint_fast32_t number_of_samples = 1000000;
+    const uint_fast32_t number_of_bins = 300;
+    std::vector< double > counts_alias(number_of_bins, 0.);
+    std::vector< double > counts_search(number_of_bins, 0.);
+    RandomGenerator random_generator_alias(42);
+    RandomGenerator random_generator_search(84);
+    for (uint_fast32_t i = 0; i < number_of_samples; ++i) {
+      const double value_alias = table.sample_linear(
+          random_generator_alias.get_uniform_random_double(), nodes.data());
+      const double value_search = sample_binary_search(
+          random_generator_search.get_uniform_random_double(),
+          cumulative_distribution, nodes);
+      assert_condition(value_alias >= 1. && value_alias <= 4.);
+      const uint_fast32_t ialias = std::min(
+          static_cast< uint_fast32_t >((value_alias - 1.) * number_of_bins / 3.),
+          number_of_bins - 1);
+      const uint_fast32_t isearch = std::min(
+          static_cast< uint_fast32_t >((value_search - 1.) * number_of_bins /
+                                       3.),
+          number_of_bins - 1);
+      counts_alias[ialias] += 1.;
+      counts_search[isearch] += 1.;
+    }
+    double chi2 = 0.;
+    uint_fast32_t degrees_of_freedom = 0;
+    for (uint_fast32_t i = 0; i < number_of_bins; ++i) {
+      const double sum = counts_alias[i] + counts_search[i];
+      if (sum > 0.) {
+        const double diff = counts_alias[i] - counts_search[i];
+        chi2 += diff * diff / sum;
+        ++degrees_of_freedom;
+      }
+    }
+    --degrees_of_freedom;
+    cmac_status("chi2: %g (%" PRIuFAST32 " degrees of freedom)", chi2,
+                degrees_of_freedom);
+    // the chi2 value has a standard deviation of sqrt(2 * degrees_of_freedom)
+    assert_condition(chi2 <
+                     degrees_of_freedom + 5. * std::sqrt(2. * degrees_of_freedom));
+  }
+
+  return 0;
+}
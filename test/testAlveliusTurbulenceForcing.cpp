@@ -107,5 +107,123 @@ int main(int argc, char **argv) {
     }
   }
 
+  /// separable evaluation
+  {
+    // reference: direct evaluation on a single subgrid
+    AlveliusTurbulenceForcing forcing_direct(1, 32, Box<>(0., 1.), 1., 4.,
+                                             2.5, 0.2, 1., 42, 1.e-6, 0.);
+    // separable evaluation on a single subgrid and on 2x2x2 subgrids
+    AlveliusTurbulenceForcing forcing_single(1, 32, Box<>(0., 1.), 1., 4., 2.5,
+                                             0.2, 1., 42, 1.e-6, 0., true);
+    AlveliusTurbulenceForcing forcing_split(2, 16, Box<>(0., 1.), 1., 4., 2.5,
+                                            0.2, 1., 42, 1.e-6, 0., true);
+    forcing_direct.update_turbulence(1.e-5);
+    forcing_single.update_turbulence(1.e-5);
+    forcing_split.update_turbulence(1.e-5);
+
+    HydroDensitySubGrid subgrid_direct(box, ncell);
+    HydroDensitySubGrid subgrid_single(box, ncell);
+    for (auto cellit = subgrid_direct.hydro_begin();
+         cellit != subgrid_direct.hydro_end(); ++cellit) {
+      cellit.get_hydro_variables().conserved(0) = 1.;
+    }
+    for (auto cellit = subgrid_single.hydro_begin();
+         cellit != subgrid_single.hydro_end(); ++cellit) {
+      cellit.get_hydro_variables().conserved(0) = 1.;
+    }
+    forcing_direct.add_turbulent_forcing(0, subgrid_direct);
+    forcing_single.add_turbulent_forcing(0, subgrid_single);
+
+    double vmax = 0.;
+    for (auto cellit = subgrid_direct.hydro_begin();
+         cellit != subgrid_direct.hydro_end(); ++cellit) {
+      vmax = std::max(
+          vmax, cellit.get_hydro_variables().get_primitives_velocity().norm());
+    }
+    auto cellit_direct = subgrid_direct.hydro_begin();
+    auto cellit_single = subgrid_single.hydro_begin();
+    while (cellit_direct != subgrid_direct.hydro_end()) {
+      const CoordinateVector<> v1 =
+          cellit_direct.get_hydro_variables().get_primitives_velocity();
+      const CoordinateVector<> v2 =
+          cellit_single.get_hydro_variables().get_primitives_velocity();
+      assert_condition((v1 - v2).norm() < 1.e-12 * vmax);
+      ++cellit_direct;
+      ++cellit_single;
+    }
+
+    // the result should not depend on the subgrid layout
+    CoordinateVector< int_fast32_t > ncell_split(16, 16, 16);
+    for (uint_fast32_t igrid = 0; igrid < 8; ++igrid) {
+      const uint_fast32_t ix = igrid / 4;
+      const uint_fast32_t iy = (igrid / 2) % 2;
+      const uint_fast32_t iz = igrid % 2;
+      double box_split[6] = {0.5 * ix, 0.5 * iy, 0.5 * iz, 0.5, 0.5, 0.5};
+      HydroDensitySubGrid subgrid_split(box_split, ncell_split);
+      for (auto cellit = subgrid_split.hydro_begin();
+           cellit != subgrid_split.hydro_end(); ++cellit) {
+        cellit.get_hydro_variables().conserved(0) = 1.;
+      }
+      forcing_split.add_turbulent_forcing(igrid, subgrid_split);
+
+      for (auto cellit = subgrid_split.hydro_begin();
+           cellit != subgrid_split.hydro_end(); ++cellit) {
+        const CoordinateVector<> p = cellit.get_cell_midpoint();
+        const uint_fast32_t jx = p.x() * 32;
+        const uint_fast32_t jy = p.y() * 32;
+        const uint_fast32_t jz = p.z() * 32;
+        auto cellit_ref = subgrid_single.hydro_begin();
+        cellit_ref += (jx * 32 + jy) * 32 + jz;
+        const CoordinateVector<> pref = cellit_ref.get_cell_midpoint();
+        assert_condition(p.x() == pref.x());
+        assert_condition(p.y() == pref.y());
+        assert_condition(p.z() == pref.z());
+        const CoordinateVector<> v =
+            cellit.get_hydro_variables().get_primitives_velocity();
+        const CoordinateVector<> vref =
+            cellit_ref.get_hydro_variables().get_primitives_velocity();
+        assert_condition(v.x() == vref.x());
+        assert_condition(v.y() == vref.y());
+        assert_condition(v.z() == vref.z());
+      }
+    }
+
+    // the evaluation mode is not stored in the restart file, but is passed on
+    // to the restart constructor
+    {
+      RestartWriter writer("test_alvelius_separable.restart");
+      forcing_single.write_restart_file(writer);
+    }
+    RestartReader reader("test_alvelius_separable.restart");
+    AlveliusTurbulenceForcing forcing_restart(reader, true);
+    forcing_single.update_turbulence(2.e-5);
+    forcing_restart.update_turbulence(2.e-5);
+    HydroDensitySubGrid subgrid1(box, ncell);
+    HydroDensitySubGrid subgrid2(box, ncell);
+    for (auto cellit = subgrid1.hydro_begin(); cellit != subgrid1.hydro_end();
+         ++cellit) {
+      cellit.get_hydro_variables().conserved(0) = 1.;
+    }
+    for (auto cellit = subgrid2.hydro_begin(); cellit != subgrid2.hydro_end();
+         ++cellit) {
+      cellit.get_hydro_variables().conserved(0) = 1.;
+    }
+    forcing_single.add_turbulent_forcing(0, subgrid1);
+    forcing_restart.add_turbulent_forcing(0, subgrid2);
+    auto cellit1 = subgrid1.hydro_begin();
+    auto cellit2 = subgrid2.hydro_begin();
+    while (cellit1 != subgrid1.hydro_end()) {
+      const CoordinateVector<> v1 =
+          cellit1.get_hydro_variables().get_primitives_velocity();
+      const CoordinateVector<> v2 =
+          cellit2.get_hydro_variables().get_primitives_velocity();
+      assert_condition(v1.x() == v2.x());
+      assert_condition(v1.y() == v2.y());
+      assert_condition(v1.z() == v2.z());
+      ++cellit1;
+      ++cellit2;
+    }
+  }
+
   return 0;
 }
@@ -104,6 +104,14 @@ int main(int argc, char **argv) {
   }
   fclose(file);
 
+  /* persistent coupling mode: register the arrays with the library, move the
+   * particles slightly and update the neutral fractions */
+  cmi_register_particles_dp(x, y, z, h, m, nH, TEST_CMICLIBRARY_NPART3D);
+  for (i = 0; i < TEST_CMICLIBRARY_NPART3D; ++i) {
+    x[i] += 0.001 * box_sides[0];
+  }
+  cmi_update_neutral_fraction();
+
   /* clean up the library */
   cmi_destroy();
 
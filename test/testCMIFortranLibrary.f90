@@ -34,7 +34,7 @@ program testCMIFortranLibrary
   use cmi_fortran_library
   implicit none
 
-  real*8 x(1000), y(1000), z(1000), h(1000), m(1000), nH(1000)
+  real*8, target :: x(1000), y(1000), z(1000), h(1000), m(1000), nH(1000)
   real*8 box_anchor(3), box_sides(3)
   real*8 pc
   integer i, ix, iy, iz
@@ -77,6 +77,12 @@ program testCMIFortranLibrary
   end do
   close(1)
 
+  ! persistent coupling mode: register the arrays with the library, move the
+  ! particles slightly and update the neutral fractions
+  call cmi_register_particles_dp(x, y, z, h, m, nH, int8(1000))
+  x = x + 0.001 * box_sides(1)
+  call cmi_update_neutral_fraction()
+
   ! clean up the library
   call cmi_destroy()
 
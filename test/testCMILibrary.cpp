@@ -24,8 +24,10 @@
  * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
  */
 
+#include "Assert.hpp"
 #include "CMILibrary.hpp"
 
+#include <cmath>
 #include <fstream>
 #include <vector>
 
@@ -77,6 +79,31 @@ int main(int argc, char **argv) {
   }
   ofile.close();
 
+  // persistent coupling mode: register the arrays with the library and update
+  // the neutral fractions a few times for particles that move slightly
+  double cold_average = 0.;
+  for (uint_fast32_t i = 0; i < 1000; ++i) {
+    cold_average += nH[i];
+  }
+  cold_average *= 0.001;
+  cmi_register_particles_dp(x.data(), y.data(), z.data(), h.data(), m.data(),
+                            nH.data(), 1000);
+  for (uint_fast8_t istep = 0; istep < 3; ++istep) {
+    for (uint_fast32_t i = 0; i < 1000; ++i) {
+      x[i] += 0.001 * box_sides[0];
+    }
+    cmi_update_neutral_fraction();
+    double warm_average = 0.;
+    for (uint_fast32_t i = 0; i < 1000; ++i) {
+      assert_condition(nH[i] >= 0. && nH[i] <= 1.);
+      warm_average += nH[i];
+    }
+    warm_average *= 0.001;
+    cmac_status("Average neutral fraction: %g (cold start: %g).", warm_average,
+                cold_average);
+    assert_condition(std::abs(warm_average - cold_average) < 0.1);
+  }
+
   // clean up the library
   cmi_destroy();
 
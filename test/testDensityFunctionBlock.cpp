@@ -0,0 +1,131 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file testDensityFunctionBlock.cpp
+ *
+ * @brief Unit test for DensityFunction::evaluate_block().
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "Assert.hpp"
+#include "BondiProfileDensityFunction.hpp"
+#include "DiscPatchDensityFunction.hpp"
+#include "HomogeneousDensityFunction.hpp"
+#include "HydroDensitySubGrid.hpp"
+#include "InterpolatedDensityFunction.hpp"
+#include "ParameterFile.hpp"
+
+/**
+ * @brief Check that the block evaluation of the given DensityFunction gives
+ * exactly the same result as the per cell evaluation.
+ *
+ * @param density_function DensityFunction to test.
+ * @param box Dimensions of the subgrid (in m; first 3 elements are the anchor,
+ * last 3 the side lengths).
+ */
+void check_block(DensityFunction &density_function, double box[6]) {
+
+  // use a different number of cells in every direction to catch index errors
+  const CoordinateVector< int_fast32_t > ncell(4, 6, 8);
+  HydroDensitySubGrid reference(box, ncell);
+  HydroDensitySubGrid blockgrid(box, ncell);
+
+  DensityFunctionBlock reference_block =
+      reference.get_density_function_block();
+  for (auto it = reference.begin(); it != reference.end(); ++it) {
+    reference_block.set_values(it.get_index(), density_function(it));
+  }
+
+  DensityFunctionBlock block = blockgrid.get_density_function_block();
+  assert_condition(block.has_hydro());
+  assert_condition(block.get_total_number_of_cells() == 4 * 6 * 8);
+  assert_condition(density_function.evaluate_block(block));
+
+  auto it = blockgrid.hydro_begin();
+  for (auto refit = reference.hydro_begin(); refit != reference.hydro_end();
+       ++refit) {
+    const IonizationVariables &ref_vars = refit.get_ionization_variables();
+    const IonizationVariables &vars = it.get_ionization_variables();
+    assert_condition(vars.get_number_density() ==
+                     ref_vars.get_number_density());
+    assert_condition(vars.get_dust_density() == ref_vars.get_dust_density());
+    assert_condition(vars.get_temperature() == ref_vars.get_temperature());
+    for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+      assert_condition(vars.get_ionic_fraction(ion) ==
+                       ref_vars.get_ionic_fraction(ion));
+    }
+    const CoordinateVector<> ref_velocity =
+        refit.get_hydro_variables().get_primitives_velocity();
+    const CoordinateVector<> velocity =
+        it.get_hydro_variables().get_primitives_velocity();
+    assert_condition(velocity.x() == ref_velocity.x());
+    assert_condition(velocity.y() == ref_velocity.y());
+    assert_condition(velocity.z() == ref_velocity.z());
+    ++it;
+  }
+}
+
+/**
+ * @brief Unit test for DensityFunction::evaluate_block().
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  /// HomogeneousDensityFunction
+  {
+    HomogeneousDensityFunction density_function(1.e8, 4000., 0.5, 0.01);
+    double box[6] = {0., 0., 0., 1., 1., 1.};
+    check_block(density_function, box);
+    cmac_status("HomogeneousDensityFunction OK.");
+  }
+
+  /// BondiProfileDensityFunction
+  {
+    ParameterFile params;
+    BondiProfileDensityFunction density_function(params);
+    // stay away from the central singularity
+    double box[6] = {1.e13, -2.e13, 3.e13, 1.e14, 2.e14, 3.e14};
+    check_block(density_function, box);
+    cmac_status("BondiProfileDensityFunction OK.");
+  }
+
+  /// DiscPatchDensityFunction
+  {
+    ParameterFile params;
+    DiscPatchDensityFunction density_function(params);
+    double box[6] = {0., 0., -3.086e19, 3.086e19, 3.086e19, 6.172e19};
+    check_block(density_function, box);
+    cmac_status("DiscPatchDensityFunction OK.");
+  }
+
+  /// InterpolatedDensityFunction
+  {
+    InterpolatedDensityFunction density_function(
+        "test_interpolated_density.txt", 4000.);
+    density_function.initialize();
+    double box[6] = {0.1, 0.2, 0.05, 0.5, 0.6, 0.9};
+    check_block(density_function, box);
+    cmac_status("InterpolatedDensityFunction OK.");
+  }
+
+  return 0;
+}
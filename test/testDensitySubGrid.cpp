@@ -30,6 +30,47 @@
 #include "RandomGenerator.hpp"
 
 #include <fstream>
+#include <vector>
+
+/**
+ * @brief Generate a random photon packet inside the given box.
+ *
+ * @param box Box (anchor and sides, in m).
+ * @param random_generator RandomGenerator to use.
+ * @return Photon packet.
+ */
+inline PhotonPacket generate_photon(const double box[6],
+                                    RandomGenerator &random_generator) {
+
+  PhotonPacket photon;
+
+  photon.set_energy(3.288e15 +
+                    1.e15 * random_generator.get_uniform_random_double());
+  for (int_fast32_t i = 0; i < NUMBER_OF_IONNAMES; ++i) {
+    photon.set_photoionization_cross_section(i, 0.);
+  }
+  photon.set_photoionization_cross_section(ION_H_n, 6.3e-22);
+#ifdef HAS_HELIUM
+  photon.set_photoionization_cross_section(ION_He_n, 1.e-22);
+#endif
+
+  const double cost = 2. * random_generator.get_uniform_random_double() - 1.;
+  const double phi = 2. * M_PI * random_generator.get_uniform_random_double();
+  const double sint = std::sqrt(std::max(1. - cost * cost, 0.));
+  const CoordinateVector<> d(sint * std::cos(phi), sint * std::sin(phi), cost);
+
+  const CoordinateVector<> position(
+      box[0] + box[3] * random_generator.get_uniform_random_double(),
+      box[1] + box[4] * random_generator.get_uniform_random_double(),
+      box[2] + box[5] * random_generator.get_uniform_random_double());
+
+  photon.set_position(position);
+  photon.set_direction(d);
+  photon.set_weight(1.);
+  photon.set_target_optical_depth(
+      -std::log(random_generator.get_uniform_random_double()));
+  return photon;
+}
 
 /**
  * @brief Unit test for the DensitySubGrid class.
@@ -78,7 +119,7 @@ int main(int argc, char **argv) {
       photon.set_weight(1.);
       photon.set_target_optical_depth(tau);
 
-      grid.interact(photon, TRAVELDIRECTION_INSIDE);
+      grid.interact(photon, TRAVELDIRECTION_INSIDE, -1.);
     }
 
     for (auto cellit = grid.begin(); cellit != grid.end(); ++cellit) {
@@ -88,8 +129,8 @@ int main(int argc, char **argv) {
       const double alphaH = 4.e-19;
       const double nH = cellit.get_ionization_variables().get_number_density();
       const double xH =
-          IonizationStateCalculator::compute_ionization_state_hydrogen(alphaH,
-                                                                       jH, nH);
+          IonizationStateCalculator::compute_ionization_state_hydrogen(
+              alphaH, jH, nH, 0., -1., 0.);
       cellit.get_ionization_variables().set_ionic_fraction(ION_H_n, xH);
       cellit.get_ionization_variables().reset_mean_intensities();
     }
@@ -117,6 +158,82 @@ int main(int argc, char **argv) {
     }
   }
 
+  /// check that batched traversal is bitwise identical to single photon
+  /// traversal
+  {
+    const double max_photon_distances[2] = {-1., 1.e17};
+    for (uint_fast32_t itest = 0; itest < 2; ++itest) {
+      DensitySubGrid grid_single(box, ncell);
+      DensitySubGrid grid_batch(box, ncell);
+      auto it = grid_single.begin();
+      auto it2 = grid_batch.begin();
+      while (it != grid_single.end()) {
+        const double nH = 1.e8 * random_generator.get_uniform_random_double();
+        const double xH = random_generator.get_uniform_random_double();
+        it.get_ionization_variables().set_number_density(nH);
+        it.get_ionization_variables().set_ionic_fraction(ION_H_n, xH);
+        it2.get_ionization_variables().set_number_density(nH);
+        it2.get_ionization_variables().set_ionic_fraction(ION_H_n, xH);
+        ++it;
+        ++it2;
+      }
+      // make sure the traversal variables are up to date
+      grid_single.reset_intensities();
+      grid_batch.reset_intensities();
+
+      // use a number of photons that is not a multiple of the batch size
+      const uint_fast32_t number_of_photons =
+          100 * DENSITYSUBGRID_BATCH_LANES + 3;
+      std::vector< PhotonPacket > photons_single(number_of_photons);
+      std::vector< PhotonPacket > photons_batch(number_of_photons);
+      for (uint_fast32_t i = 0; i < number_of_photons; ++i) {
+        photons_single[i] = generate_photon(box, random_generator);
+        photons_batch[i] = photons_single[i];
+      }
+
+      std::vector< int_fast32_t > results_single(number_of_photons);
+      std::vector< int_fast32_t > results_batch(number_of_photons);
+      for (uint_fast32_t i = 0; i < number_of_photons; ++i) {
+        results_single[i] =
+            grid_single.interact(photons_single[i], TRAVELDIRECTION_INSIDE,
+                                 max_photon_distances[itest]);
+      }
+      DensitySubGrid::PathBuffer path_buffer;
+      grid_batch.interact_batch(photons_batch.data(), number_of_photons,
+                                TRAVELDIRECTION_INSIDE,
+                                max_photon_distances[itest],
+                                results_batch.data(), path_buffer);
+
+      for (uint_fast32_t i = 0; i < number_of_photons; ++i) {
+        assert_condition(results_single[i] == results_batch[i]);
+        const CoordinateVector<> p_single = photons_single[i].get_position();
+        const CoordinateVector<> p_batch = photons_batch[i].get_position();
+        assert_condition(p_single.x() == p_batch.x());
+        assert_condition(p_single.y() == p_batch.y());
+        assert_condition(p_single.z() == p_batch.z());
+        assert_condition(photons_single[i].get_target_optical_depth() ==
+                         photons_batch[i].get_target_optical_depth());
+        assert_condition(photons_single[i].get_distance_travelled() ==
+                         photons_batch[i].get_distance_travelled());
+      }
+
+      it = grid_single.begin();
+      it2 = grid_batch.begin();
+      while (it != grid_single.end()) {
+        for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+          assert_condition(
+              it.get_ionization_variables().get_mean_intensity(ion) ==
+              it2.get_ionization_variables().get_mean_intensity(ion));
+        }
+        assert_condition(
+            it.get_ionization_variables().get_heating(HEATINGTERM_H) ==
+            it2.get_ionization_variables().get_heating(HEATINGTERM_H));
+        ++it;
+        ++it2;
+      }
+    }
+  }
+
   std::ofstream ofile("testDensitySubGrid_output.txt");
   ofile << "# x (m)\ty (m)\tz (m)\txH\tnH (m^-3)\n";
   grid.print_intensities(ofile);
@@ -28,6 +28,7 @@
 #include "DensitySubGridCreator.hpp"
 #include "HomogeneousDensityFunction.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <vector>
 
@@ -74,6 +75,52 @@ int main(int argc, char **argv) {
     }
   }
 
+  /// write restart file with a binary checkpoint
+  {
+    auto cellit = (*grid_creator.begin()).begin();
+    cellit.get_ionization_variables().set_temperature(4000.);
+    RestartWriter writer("test_densitysubgridcreator_checkpoint.restart");
+    CheckpointWriter checkpoint_writer("test_densitysubgridcreator.grid");
+    grid_creator.write_restart_file(writer, &checkpoint_writer);
+    assert_condition(checkpoint_writer.get_number_of_blocks() ==
+                     grid_creator.number_of_original_subgrids());
+    checkpoint_writer.write();
+  }
+
+  /// read restart file with a binary checkpoint
+  {
+    RestartReader reader("test_densitysubgridcreator_checkpoint.restart");
+    CheckpointReader checkpoint_reader("test_densitysubgridcreator.grid");
+    DensitySubGridCreator< DensitySubGrid > grid_creator2(reader,
+                                                          &checkpoint_reader);
+    assert_condition(grid_creator.number_of_original_subgrids() ==
+                     grid_creator2.number_of_original_subgrids());
+    auto gridit = grid_creator.begin();
+    auto gridit2 = grid_creator2.begin();
+    while (gridit != grid_creator.original_end() &&
+           gridit2 != grid_creator2.original_end()) {
+      assert_condition((*gridit).get_number_of_cells() ==
+                       (*gridit2).get_number_of_cells());
+      auto cellit2 = (*gridit2).begin();
+      for (auto cellit = (*gridit).begin(); cellit != (*gridit).end();
+           ++cellit) {
+        assert_condition(
+            cellit.get_ionization_variables().get_number_density() ==
+            cellit2.get_ionization_variables().get_number_density());
+        assert_condition(
+            cellit.get_ionization_variables().get_temperature() ==
+            cellit2.get_ionization_variables().get_temperature());
+        ++cellit2;
+      }
+      ++gridit;
+      ++gridit2;
+    }
+    assert_condition((*grid_creator2.begin())
+                         .begin()
+                         .get_ionization_variables()
+                         .get_temperature() == 4000.);
+  }
+
   std::ofstream ofile("testDensitySubGridCreator_grid.txt");
   for (auto gridit = grid_creator.begin(); gridit != grid_creator.all_end();
        ++gridit) {
@@ -361,5 +408,128 @@ int main(int argc, char **argv) {
   assert_condition(grid131.get_neighbour(TRAVELDIRECTION_FACE_Z_N) == 128);
   assert_condition(grid131.get_neighbour(TRAVELDIRECTION_FACE_Z_P) == 84);
 
+  /// incremental copy updates
+  {
+    std::vector< uint_fast8_t > current_levels;
+    grid_creator.get_copy_levels(current_levels);
+    assert_condition(current_levels == copy_levels);
+    assert_condition(!grid_creator.update_copies(copy_levels));
+
+    // grow the copies of 82, remove the copies of 83 and add copies for a
+    // subgrid that did not have any
+    std::vector< uint_fast8_t > new_levels(
+        grid_creator.number_of_original_subgrids(), 0);
+    new_levels[82] = 3;
+    new_levels[5] = 1;
+    grid_creator.restrict_copy_levels(new_levels);
+    assert_condition(new_levels[82] == 3);
+    assert_condition(new_levels[83] == 2);
+    assert_condition(new_levels[84] == 1);
+    assert_condition(new_levels[5] == 1);
+    DensitySubGrid *copy82 = &*grid_creator.get_subgrid(128);
+    assert_condition(grid_creator.update_copies(new_levels));
+    grid_creator.get_copy_levels(current_levels);
+    assert_condition(current_levels == new_levels);
+    // the existing copy of 82 is reused
+    auto copies = grid_creator.get_subgrid(82).get_copies();
+    assert_condition(&*copies.first == copy82);
+
+    // the result should be the same as when creating the copies from scratch
+    DensitySubGridCreator< DensitySubGrid > reference_creator(
+        Box<>(box_anchor, box_sides), ncell, nsubgrid,
+        CoordinateVector< bool >(false));
+    reference_creator.initialize(density_function);
+    reference_creator.create_copies(new_levels);
+    assert_condition(reference_creator.number_of_actual_subgrids() ==
+                     grid_creator.number_of_actual_subgrids());
+    for (uint_fast32_t igrid = 0;
+         igrid < grid_creator.number_of_actual_subgrids(); ++igrid) {
+      DensitySubGrid &subgrid = *grid_creator.get_subgrid(igrid);
+      DensitySubGrid &reference = *reference_creator.get_subgrid(igrid);
+      for (int_fast32_t i = 0; i < TRAVELDIRECTION_NUMBER; ++i) {
+        assert_condition(subgrid.get_neighbour(i) ==
+                         reference.get_neighbour(i));
+      }
+    }
+
+    // a subgrid that dominates the computational cost gets the maximum
+    // allowed copy level, copies of subgrids without cost are removed one
+    // level at a time
+    for (auto it = grid_creator.begin(); it != grid_creator.all_end(); ++it) {
+      (*it).reset_computational_cost();
+    }
+    (*grid_creator.get_subgrid(42)).add_computational_cost(1000);
+    (*grid_creator.get_subgrid(0)).add_computational_cost(1);
+    grid_creator.compute_adaptive_copy_levels(4, 2, new_levels);
+    assert_condition(new_levels[42] == 2);
+    assert_condition(new_levels[0] == 0);
+    assert_condition(new_levels[82] == 2);
+    assert_condition(new_levels[5] == 1);
+    assert_condition(grid_creator.update_copies(new_levels));
+    grid_creator.get_copy_levels(current_levels);
+    assert_condition(current_levels == new_levels);
+  }
+
+  /// sphere searches
+  for (uint_fast8_t periodic = 0; periodic < 2; ++periodic) {
+    DensitySubGridCreator< DensitySubGrid > search_creator(
+        Box<>(box_anchor, box_sides), ncell, nsubgrid,
+        CoordinateVector< bool >(periodic == 1));
+    search_creator.initialize(density_function);
+
+    const CoordinateVector<> centre(0.03, 0.41, 0.77);
+    const double radius = 0.3;
+    const std::vector< std::pair< uint_fast32_t, uint_fast32_t > > cells =
+        search_creator.cells_within_radius(centre, radius);
+
+    // brute force reference (the radius is smaller than half the box, so that
+    // every cell is included at most once)
+    std::vector< std::pair< uint_fast32_t, uint_fast32_t > > reference;
+    for (uint_fast32_t igrid = 0;
+         igrid < search_creator.number_of_original_subgrids(); ++igrid) {
+      DensitySubGrid &subgrid = *search_creator.get_subgrid(igrid);
+      for (auto cellit = subgrid.begin(); cellit != subgrid.end(); ++cellit) {
+        CoordinateVector<> d = cellit.get_cell_midpoint() - centre;
+        if (periodic == 1) {
+          for (uint_fast8_t i = 0; i < 3; ++i) {
+            d[i] -= std::round(d[i] / box_sides[i]) * box_sides[i];
+          }
+        }
+        if (d.norm() <= radius) {
+          reference.push_back(std::make_pair(igrid, cellit.get_index()));
+        }
+      }
+    }
+    assert_condition(cells.size() == reference.size());
+    std::vector< std::pair< uint_fast32_t, uint_fast32_t > > sorted_cells(
+        cells);
+    std::sort(sorted_cells.begin(), sorted_cells.end());
+    assert_condition(sorted_cells == reference);
+
+    // growing the sphere in steps returns every cell once, in order of
+    // increasing distance
+    DensitySubGridCreator< DensitySubGrid >::SphereSearch search(
+        search_creator, centre);
+    std::vector< std::pair< uint_fast32_t, uint_fast32_t > > grown_cells;
+    double last_distance = 0.;
+    for (uint_fast32_t istep = 1; istep <= 10; ++istep) {
+      search.grow(0.1 * radius * istep,
+                  [&grown_cells, &last_distance](const uint_fast32_t igrid,
+                                                 const uint_fast32_t icell,
+                                                 const double distance) {
+                    assert_condition(distance >= last_distance);
+                    last_distance = distance;
+                    grown_cells.push_back(std::make_pair(igrid, icell));
+                  });
+    }
+    assert_condition(grown_cells == cells);
+    assert_condition(!search.is_complete());
+
+    // a sphere that contains the entire box
+    search.grow(2., [](const uint_fast32_t igrid, const uint_fast32_t icell,
+                       const double distance) {});
+    assert_condition(search.is_complete() == (periodic == 0));
+  }
+
   return 0;
 }
@@ -0,0 +1,113 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file testDomainDecomposition.cpp
+ *
+ * @brief Unit test for the DomainDecomposition class.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "Assert.hpp"
+#include "DomainDecomposition.hpp"
+#include "RandomGenerator.hpp"
+
+/**
+ * @brief Unit test for the DomainDecomposition class.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  /// equal costs: every domain gets the same number of subgrids
+  {
+    const CoordinateVector< int_fast32_t > layout(8, 8, 8);
+    DomainDecomposition decomposition(layout, 4);
+    decomposition.decompose();
+
+    std::vector< uint_fast32_t > counts(4, 0);
+    for (uint_fast32_t i = 0; i < 512; ++i) {
+      const int_fast32_t domain = decomposition.get_domain(i);
+      assert_condition(domain >= 0 && domain < 4);
+      ++counts[domain];
+    }
+    for (uint_fast32_t i = 0; i < 4; ++i) {
+      assert_condition(counts[i] == 128);
+      assert_condition(decomposition.get_load(i) == 128.);
+    }
+    assert_condition(decomposition.get_load_imbalance() == 1.);
+  }
+
+  /// random costs: the load imbalance stays within bounds and the result is
+  /// deterministic
+  {
+    const CoordinateVector< int_fast32_t > layout(8, 8, 8);
+    RandomGenerator random_generator(42);
+    std::vector< double > costs(512);
+    for (uint_fast32_t i = 0; i < 512; ++i) {
+      costs[i] = 1. + random_generator.get_uniform_random_double();
+    }
+    domain_graph_t graph(512);
+    for (uint_fast32_t i = 0; i < 511; ++i) {
+      const double weight = random_generator.get_uniform_random_double();
+      graph[i].push_back(std::make_pair(i + 1, weight));
+      graph[i + 1].push_back(std::make_pair(i, weight));
+    }
+
+    DomainDecomposition decomposition(layout, 3);
+    decomposition.decompose(costs, graph);
+    assert_condition(decomposition.get_load_imbalance() < 1.05);
+
+    DomainDecomposition decomposition2(layout, 3);
+    decomposition2.decompose(costs, graph);
+    for (uint_fast32_t i = 0; i < 512; ++i) {
+      assert_condition(decomposition.get_domain(i) ==
+                       decomposition2.get_domain(i));
+    }
+  }
+
+  /// refinement: a heavy connection is not cut if the tolerance allows it
+  {
+    const CoordinateVector< int_fast32_t > layout(4, 1, 1);
+    const std::vector< double > costs(4, 1.);
+    domain_graph_t graph(4);
+    const double weights[3] = {1., 10., 1.};
+    for (uint_fast32_t i = 0; i < 3; ++i) {
+      graph[i].push_back(std::make_pair(i + 1, weights[i]));
+      graph[i + 1].push_back(std::make_pair(i, weights[i]));
+    }
+
+    // a strict tolerance forces a perfectly balanced decomposition
+    DomainDecomposition strict(layout, 2);
+    strict.decompose(costs, graph);
+    assert_condition(strict.get_domain(0) == strict.get_domain(1));
+    assert_condition(strict.get_domain(2) == strict.get_domain(3));
+    assert_condition(strict.get_edge_cut(graph) == 20.);
+
+    // a loose tolerance allows us to avoid cutting the heavy connection
+    DomainDecomposition loose(layout, 2, 0.6);
+    loose.decompose(costs, graph);
+    assert_condition(loose.get_domain(1) == loose.get_domain(2));
+    assert_condition(loose.get_edge_cut(graph) == 2.);
+    assert_condition(loose.get_load_imbalance() == 1.5);
+  }
+
+  return 0;
+}
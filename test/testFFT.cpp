@@ -0,0 +1,77 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file testFFT.cpp
+ *
+ * @brief Unit test for the FFT class.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "Assert.hpp"
+#include "FFT.hpp"
+#include "RandomGenerator.hpp"
+
+/**
+ * @brief Unit test for the FFT class.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  RandomGenerator random_generator(42);
+
+  // powers of 2 and 4, small prime factors and a large prime
+  const size_t sizes[9] = {1, 2, 3, 8, 12, 30, 64, 100, 97};
+  for (uint_fast32_t isize = 0; isize < 9; ++isize) {
+    const size_t size = sizes[isize];
+    FFT fft(size);
+    assert_condition(fft.get_size() == size);
+
+    std::vector< std::complex< double > > data(size), work(size);
+    for (size_t i = 0; i < size; ++i) {
+      data[i] =
+          std::complex< double >(random_generator.get_uniform_random_double(),
+                                 random_generator.get_uniform_random_double());
+    }
+    const std::vector< std::complex< double > > input(data);
+
+    // compare with a direct DFT
+    fft.transform(data.data(), work.data());
+    for (size_t k = 0; k < size; ++k) {
+      std::complex< double > reference(0.);
+      for (size_t j = 0; j < size; ++j) {
+        const double phase = -2. * M_PI * ((j * k) % size) / size;
+        reference +=
+            input[j] * std::complex< double >(std::cos(phase), std::sin(phase));
+      }
+      assert_condition(std::abs(data[k] - reference) < 1.e-10 * size);
+    }
+
+    // the backward transform undoes the forward transform (up to a factor
+    // size)
+    fft.transform(data.data(), work.data(), true);
+    for (size_t i = 0; i < size; ++i) {
+      assert_condition(std::abs(data[i] / double(size) - input[i]) < 1.e-12);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,188 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file testFFTPoissonSolver.cpp
+ *
+ * @brief Unit test for the FFTPoissonSolver class.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "Assert.hpp"
+#include "FFTPoissonSolver.hpp"
+#include "RandomGenerator.hpp"
+
+#include <algorithm>
+
+/**
+ * @brief Unit test for the FFTPoissonSolver class.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  const double G = PhysicalConstants::get_physical_constant(
+      PHYSICALCONSTANT_NEWTON_CONSTANT);
+  RandomGenerator random_generator(42);
+
+  /// isolated boundaries: the potential equals the direct sum
+  {
+    const CoordinateVector< int_fast32_t > ncell(8, 6, 5);
+    const double h = 0.25;
+    const Box<> box(CoordinateVector<>(-1.), CoordinateVector<>(2., 1.5, 1.25));
+
+    // random masses, with the cells in a random order
+    std::vector< size_t > order(ncell.x() * ncell.y() * ncell.z());
+    for (size_t i = 0; i < order.size(); ++i) {
+      order[i] = i;
+    }
+    for (size_t i = order.size() - 1; i > 0; --i) {
+      const size_t j = random_generator.get_uniform_random_double() * (i + 1);
+      std::swap(order[i], order[std::min(i, j)]);
+    }
+    std::vector< CoordinateVector<> > positions(order.size());
+    std::vector< double > masses(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+      const int_fast32_t ix = order[i] / (ncell.y() * ncell.z());
+      const int_fast32_t iy = (order[i] / ncell.z()) % ncell.y();
+      const int_fast32_t iz = order[i] % ncell.z();
+      positions[i] = box.get_anchor() +
+                     CoordinateVector<>((ix + 0.5) * h, (iy + 0.5) * h,
+                                        (iz + 0.5) * h);
+      masses[i] = 1.e30 * (0.5 + random_generator.get_uniform_random_double());
+    }
+
+    FFTPoissonSolver solver(box, ncell, false);
+    assert_condition(solver.get_mesh_size().x() == 16);
+    solver.build(positions, masses);
+    assert_condition(solver.get_number_of_particles() == order.size());
+    std::vector< CoordinateVector<> > accelerations;
+    std::vector< double > potentials;
+    solver.compute_accelerations(accelerations, potentials);
+
+    const double sqrt3 = std::sqrt(3.);
+    const double self_potential =
+        -G * (3. * std::log((sqrt3 + 1.) / (sqrt3 - 1.)) - 0.5 * M_PI) / h;
+    std::vector< double > reference(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+      double potential = self_potential * masses[i];
+      for (size_t j = 0; j < order.size(); ++j) {
+        if (i != j) {
+          potential -= G * masses[j] / (positions[i] - positions[j]).norm();
+        }
+      }
+      reference[order[i]] = potential;
+      assert_values_equal_rel(potentials[i], potential, 1.e-10);
+    }
+
+    // the accelerations are finite differences of the potential
+    for (size_t i = 0; i < order.size(); ++i) {
+      const int_fast32_t index[3] = {
+          int_fast32_t(order[i] / (ncell.y() * ncell.z())),
+          int_fast32_t((order[i] / ncell.z()) % ncell.y()),
+          int_fast32_t(order[i] % ncell.z())};
+      const size_t stride[3] = {size_t(ncell.y() * ncell.z()),
+                                size_t(ncell.z()), 1};
+      for (uint_fast8_t j = 0; j < 3; ++j) {
+        const size_t left =
+            (index[j] > 0) ? order[i] - stride[j] : order[i];
+        const size_t right =
+            (index[j] < ncell[j] - 1) ? order[i] + stride[j] : order[i];
+        const double distance =
+            (index[j] > 0 && index[j] < ncell[j] - 1) ? 2. * h : h;
+        const double acceleration =
+            (reference[left] - reference[right]) / distance;
+        assert_condition(std::abs(accelerations[i][j] - acceleration) <
+                         1.e-10 * accelerations[i].norm());
+      }
+    }
+
+    // update the masses: the result is linear in the masses
+    for (size_t i = 0; i < masses.size(); ++i) {
+      masses[i] *= 2.;
+    }
+    solver.update_masses(masses);
+    std::vector< double > new_potentials;
+    solver.compute_accelerations(accelerations, new_potentials);
+    for (size_t i = 0; i < masses.size(); ++i) {
+      assert_values_equal_rel(new_potentials[i], 2. * potentials[i], 1.e-10);
+    }
+  }
+
+  /// periodic boundaries: a density perturbation with known potential
+  {
+    const CoordinateVector< int_fast32_t > ncell(16, 12, 8);
+    const Box<> box(CoordinateVector<>(0.), CoordinateVector<>(4., 3., 2.));
+    const CoordinateVector<> h(0.25);
+    const double cell_volume = h.x() * h.y() * h.z();
+    const double kx = 2. * M_PI / box.get_sides().x();
+    const double ky = 4. * M_PI / box.get_sides().y();
+    const double rho0 = 1.e-20;
+    const double A = 0.1;
+
+    std::vector< CoordinateVector<> > positions;
+    std::vector< double > masses;
+    for (int_fast32_t ix = 0; ix < ncell.x(); ++ix) {
+      for (int_fast32_t iy = 0; iy < ncell.y(); ++iy) {
+        for (int_fast32_t iz = 0; iz < ncell.z(); ++iz) {
+          const CoordinateVector<> x((ix + 0.5) * h.x(), (iy + 0.5) * h.y(),
+                                     (iz + 0.5) * h.z());
+          positions.push_back(x);
+          masses.push_back(rho0 * cell_volume *
+                           (1. + A * std::sin(kx * x.x()) +
+                            A * std::cos(ky * x.y())));
+        }
+      }
+    }
+
+    FFTPoissonSolver solver(box, ncell, true);
+    solver.build(positions, masses);
+    std::vector< CoordinateVector<> > accelerations;
+    std::vector< double > potentials;
+    solver.compute_accelerations(accelerations, potentials);
+
+    for (size_t i = 0; i < positions.size(); ++i) {
+      const CoordinateVector<> x = positions[i];
+      const double phi_x = -4. * M_PI * G * rho0 * A / (kx * kx);
+      const double phi_y = -4. * M_PI * G * rho0 * A / (ky * ky);
+      const double potential =
+          phi_x * std::sin(kx * x.x()) + phi_y * std::cos(ky * x.y());
+      assert_condition(std::abs(potentials[i] - potential) <
+                       1.e-10 * std::abs(phi_x));
+      // central difference of the analytic potential
+      const double ax = -phi_x *
+                        (std::sin(kx * (x.x() + h.x())) -
+                         std::sin(kx * (x.x() - h.x()))) /
+                        (2. * h.x());
+      const double ay = -phi_y *
+                        (std::cos(ky * (x.y() + h.y())) -
+                         std::cos(ky * (x.y() - h.y()))) /
+                        (2. * h.y());
+      assert_condition(std::abs(accelerations[i].x() - ax) <
+                       1.e-10 * std::abs(phi_x * kx));
+      assert_condition(std::abs(accelerations[i].y() - ay) <
+                       1.e-10 * std::abs(phi_y * ky));
+      assert_condition(std::abs(accelerations[i].z()) <
+                       1.e-10 * std::abs(phi_x * kx));
+    }
+  }
+
+  return 0;
+}
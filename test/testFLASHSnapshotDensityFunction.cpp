@@ -24,6 +24,7 @@
  * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
  */
 #include "Assert.hpp"
+#include "DensitySubGrid.hpp"
 #include "FLASHSnapshotDensityFunction.hpp"
 
 /**
@@ -65,6 +66,50 @@ int main(int argc, char **argv) {
   }
   assert_values_equal(xi2, 0.0106294);
 
+  /// streaming mode
+  {
+    // use a very small buffer to make sure blocks are swapped out
+    FLASHSnapshotDensityFunction streamed_density("FLASHtest.hdf5", -1., false,
+                                                  true, 2);
+    streamed_density.initialize();
+
+    for (uint_fast32_t i = 0; i < np; ++i) {
+      CoordinateVector<> p((i + 0.5) * 0.02 / np, (i + 0.5) * 0.01 / np,
+                           (i + 0.5) * 0.01 / np);
+      DummyCell cell(p.x(), p.y(), p.z());
+      DensityValues vals = density(cell);
+      DensityValues streamed_vals = streamed_density(cell);
+      assert_condition(streamed_vals.get_number_density() ==
+                       vals.get_number_density());
+      assert_condition(streamed_vals.get_temperature() ==
+                       vals.get_temperature());
+    }
+
+    // block evaluation for a subgrid that covers the entire box
+    double box[6] = {0., 0., 0., 0.02, 0.01, 0.01};
+    const CoordinateVector< int_fast32_t > ncell(32, 16, 16);
+    DensitySubGrid reference(box, ncell);
+    DensitySubGrid subgrid(box, ncell);
+    DensityFunctionBlock reference_block =
+        reference.get_density_function_block();
+    for (auto it = reference.begin(); it != reference.end(); ++it) {
+      reference_block.set_values(it.get_index(), density(it));
+    }
+    DensityFunctionBlock block = subgrid.get_density_function_block();
+    assert_condition(streamed_density.evaluate_block(block));
+    auto it = subgrid.begin();
+    for (auto refit = reference.begin(); refit != reference.end(); ++refit) {
+      const IonizationVariables &ref_vars = refit.get_ionization_variables();
+      const IonizationVariables &vars = it.get_ionization_variables();
+      assert_condition(vars.get_number_density() ==
+                       ref_vars.get_number_density());
+      assert_condition(vars.get_temperature() == ref_vars.get_temperature());
+      ++it;
+    }
+
+    streamed_density.free();
+  }
+
   density.free();
 
   return 0;
@@ -28,10 +28,13 @@
 #include "CartesianDensityGrid.hpp"
 #include "CoordinateVector.hpp"
 #include "DensityFunction.hpp"
+#include "DensitySubGridCreator.hpp"
 #include "GadgetDensityGridWriter.hpp"
 #include "HDF5Tools.hpp"
 #include "HomogeneousDensityFunction.hpp"
 #include "TerminalLog.hpp"
+
+#include <sstream>
 #include <vector>
 
 /**
@@ -213,5 +216,112 @@ int main(int argc, char **argv) {
     HDF5Tools::close_file(file);
   }
 
+  /// asynchronous subgrid output
+  {
+    const Box<> box(CoordinateVector<>(-0.5), CoordinateVector<>(1.));
+    DensitySubGridCreator< DensitySubGrid > grid_creator(
+        box, CoordinateVector< int_fast32_t >(16),
+        CoordinateVector< int_fast32_t >(4), CoordinateVector< bool >(false));
+    HomogeneousDensityFunction density_function;
+    density_function.initialize();
+    grid_creator.initialize(density_function);
+    // give every cell a different temperature
+    uint_fast32_t cell_index = 0;
+    for (auto gridit = grid_creator.begin();
+         gridit != grid_creator.original_end(); ++gridit) {
+      for (auto cellit = (*gridit).begin(); cellit != (*gridit).end();
+           ++cellit) {
+        cellit.get_ionization_variables().set_temperature(cell_index);
+        ++cell_index;
+      }
+    }
+
+    uint_fast32_t fields[DENSITYGRIDFIELD_NUMBER];
+    for (int_fast32_t property = 0; property < DENSITYGRIDFIELD_NUMBER;
+         ++property) {
+      fields[property] = 0;
+    }
+    fields[DENSITYGRIDFIELD_COORDINATES] = true;
+    fields[DENSITYGRIDFIELD_NUMBER_DENSITY] = true;
+    fields[DENSITYGRIDFIELD_TEMPERATURE] = true;
+    fields[DENSITYGRIDFIELD_NEUTRAL_FRACTION] = 1;
+
+    ParameterFile params("test.param");
+    {
+      GadgetDensityGridWriter writer("testsubgrid", ".", false,
+                                     DensityGridWriterFields(fields));
+      writer.write(grid_creator, 0, params);
+    }
+    // write a few snapshots with every filter, so that both snapshot buffers
+    // are used
+    for (int_fast32_t filter = HDF5Tools::HDF5COMPRESSIONFILTER_NONE;
+         filter <= HDF5Tools::HDF5COMPRESSIONFILTER_SHUFFLE_DEFLATE;
+         ++filter) {
+      std::stringstream prefix;
+      prefix << "testsubgrid_async" << filter << "_";
+      GadgetDensityGridWriter writer(prefix.str(), ".", false,
+                                     DensityGridWriterFields(fields), nullptr,
+                                     3, false, true, 100, filter, 6);
+      for (uint_fast32_t counter = 0; counter < 3; ++counter) {
+        writer.write(grid_creator, counter, params, counter);
+      }
+    }
+
+    HDF5Tools::HDF5File file = HDF5Tools::open_file(
+        "testsubgrid000.hdf5", HDF5Tools::HDF5FILEMODE_READ);
+    HDF5Tools::HDF5Group group = HDF5Tools::open_group(file, "PartType0");
+    const std::vector< CoordinateVector<> > reference_coordinates =
+        HDF5Tools::read_dataset< CoordinateVector<> >(group, "Coordinates");
+    const std::vector< double > reference_temperatures =
+        HDF5Tools::read_dataset< double >(group, "Temperature");
+    const std::vector< double > reference_neutral_fractions =
+        HDF5Tools::read_dataset< double >(group, "NeutralFractionH");
+    HDF5Tools::close_group(group);
+    HDF5Tools::close_file(file);
+    assert_condition(reference_temperatures.size() == 4096);
+    for (uint_fast32_t i = 0; i < reference_temperatures.size(); ++i) {
+      assert_condition(reference_temperatures[i] == i);
+    }
+
+    for (int_fast32_t filter = HDF5Tools::HDF5COMPRESSIONFILTER_NONE;
+         filter <= HDF5Tools::HDF5COMPRESSIONFILTER_SHUFFLE_DEFLATE;
+         ++filter) {
+      for (uint_fast32_t counter = 0; counter < 3; ++counter) {
+        std::stringstream filename;
+        filename << "testsubgrid_async" << filter << "_00" << counter
+                 << ".hdf5";
+        file = HDF5Tools::open_file(filename.str(),
+                                    HDF5Tools::HDF5FILEMODE_READ);
+
+        group = HDF5Tools::open_group(file, "Header");
+        const std::vector< uint32_t > numpart =
+            HDF5Tools::read_attribute< std::vector< uint32_t > >(
+                group, "NumPart_Total");
+        assert_condition(numpart[0] == 4096);
+        const double time = HDF5Tools::read_attribute< double >(group, "Time");
+        assert_condition(time == counter);
+        HDF5Tools::close_group(group);
+
+        group = HDF5Tools::open_group(file, "PartType0");
+        const std::vector< CoordinateVector<> > coordinates =
+            HDF5Tools::read_dataset< CoordinateVector<> >(group,
+                                                          "Coordinates");
+        const std::vector< double > temperatures =
+            HDF5Tools::read_dataset< double >(group, "Temperature");
+        const std::vector< double > neutral_fractions =
+            HDF5Tools::read_dataset< double >(group, "NeutralFractionH");
+        assert_condition(coordinates.size() == reference_coordinates.size());
+        for (uint_fast32_t i = 0; i < reference_coordinates.size(); ++i) {
+          assert_condition(coordinates[i] == reference_coordinates[i]);
+          assert_condition(temperatures[i] == reference_temperatures[i]);
+          assert_condition(neutral_fractions[i] ==
+                           reference_neutral_fractions[i]);
+        }
+        HDF5Tools::close_group(group);
+        HDF5Tools::close_file(file);
+      }
+    }
+  }
+
   return 0;
 }
@@ -0,0 +1,113 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file testHDF5DensityFunction.cpp
+ *
+ * @brief Unit test for the HDF5DensityFunction class.
+ *
+ * We write a small snapshot file and check that the streaming mode gives
+ * exactly the same result as reading the entire snapshot into memory.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "Assert.hpp"
+#include "DensitySubGrid.hpp"
+#include "HDF5DensityFunction.hpp"
+#include "HDF5Tools.hpp"
+
+/**
+ * @brief Unit test for the HDF5DensityFunction class.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  const CoordinateVector< uint_fast32_t > ncell(8, 6, 4);
+  const Box<> box(CoordinateVector<>(0.), CoordinateVector<>(1.));
+
+  // write the snapshot
+  {
+    HDF5Tools::initialize();
+    HDF5Tools::HDF5File file = HDF5Tools::open_file(
+        "test_hdf5densityfunction.hdf5", HDF5Tools::HDF5FILEMODE_WRITE);
+    HDF5Tools::HDF5Group group = HDF5Tools::create_group(file, "PartType0");
+    const uint_fast32_t size = ncell.x() * ncell.y() * ncell.z();
+    std::vector< double > number_densities(size);
+    std::vector< double > temperatures(size);
+    for (uint_fast32_t i = 0; i < size; ++i) {
+      number_densities[i] = 1.e6 * (i + 1.);
+      temperatures[i] = 100. * i;
+    }
+    HDF5Tools::write_dataset< double >(group, "NumberDensity",
+                                       number_densities);
+    HDF5Tools::write_dataset< double >(group, "Temperature", temperatures);
+    HDF5Tools::close_group(group);
+    HDF5Tools::close_file(file);
+  }
+
+  HDF5DensityFunction density_function("test_hdf5densityfunction.hdf5", ncell,
+                                       true, 0.01, 1., box);
+  HDF5DensityFunction streamed_density_function(
+      "test_hdf5densityfunction.hdf5", ncell, true, 0.01, 1., box, true);
+
+  assert_condition(streamed_density_function.get_total_hydrogen_number() ==
+                   density_function.get_total_hydrogen_number());
+
+  // a subgrid that only partially overlaps with the snapshot cells
+  double subgrid_box[6] = {0.1, 0.2, 0.3, 0.5, 0.6, 0.4};
+  const CoordinateVector< int_fast32_t > subgrid_ncell(6, 5, 7);
+  DensitySubGrid reference(subgrid_box, subgrid_ncell);
+  DensitySubGrid subgrid(subgrid_box, subgrid_ncell);
+
+  // the block evaluation is only available in streaming mode
+  DensityFunctionBlock reference_block =
+      reference.get_density_function_block();
+  assert_condition(!density_function.evaluate_block(reference_block));
+  for (auto it = reference.begin(); it != reference.end(); ++it) {
+    const DensityValues values = density_function(it);
+    const DensityValues streamed_values = streamed_density_function(it);
+    assert_condition(streamed_values.get_number_density() ==
+                     values.get_number_density());
+    assert_condition(streamed_values.get_temperature() ==
+                     values.get_temperature());
+    reference_block.set_values(it.get_index(), values);
+  }
+
+  DensityFunctionBlock block = subgrid.get_density_function_block();
+  assert_condition(streamed_density_function.evaluate_block(block));
+  auto it = subgrid.begin();
+  for (auto refit = reference.begin(); refit != reference.end(); ++refit) {
+    const IonizationVariables &ref_vars = refit.get_ionization_variables();
+    const IonizationVariables &vars = it.get_ionization_variables();
+    assert_condition(vars.get_number_density() ==
+                     ref_vars.get_number_density());
+    assert_condition(vars.get_dust_density() == ref_vars.get_dust_density());
+    assert_condition(vars.get_temperature() == ref_vars.get_temperature());
+    assert_condition(vars.get_ionic_fraction(ION_H_n) ==
+                     ref_vars.get_ionic_fraction(ION_H_n));
+    ++it;
+  }
+
+  streamed_density_function.free();
+  density_function.free();
+
+  return 0;
+}
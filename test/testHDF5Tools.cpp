@@ -156,6 +156,21 @@ int main(int argc, char **argv) {
     ctest = coordinateblock[{{0, 2}}];
     assert_values_equal(ctest, 0.10086706479716455);
 
+    std::vector< hsize_t > dimensions =
+        HDF5Tools::get_dataset_dimensions(group, "Coordinates");
+    assert_condition(dimensions.size() == 2);
+    assert_condition(dimensions[0] == 100);
+    assert_condition(dimensions[1] == 3);
+
+    // read a hyperslab containing the y and z coordinates of particles 10-19
+    double hyperslab[20];
+    HDF5Tools::read_dataset_hyperslab< double >(group, "Coordinates", {10, 1},
+                                                {10, 2}, hyperslab);
+    for (uint_fast8_t i = 0; i < 10; ++i) {
+      assert_condition(hyperslab[2 * i] == coordinates[10 + i].y());
+      assert_condition(hyperslab[2 * i + 1] == coordinates[10 + i].z());
+    }
+
     HDF5Tools::close_group(group);
 
     HDF5Tools::HDF5Dictionary< double > ddictionary =
@@ -290,6 +305,23 @@ int main(int argc, char **argv) {
       assert_condition(vvtest2[i].z() == vvtest[i].z());
     }
 
+    // interpret the 100 doubles as a 4x5x5 grid and read a 2x3x2 box
+    const hsize_t grid_size[3] = {4, 5, 5};
+    const hsize_t box_offset[3] = {1, 2, 3};
+    const hsize_t box_size[3] = {2, 3, 2};
+    double boxtest[12];
+    HDF5Tools::read_dataset_box< double >(group, "Test doubles", grid_size,
+                                          box_offset, box_size, boxtest);
+    for (uint_fast8_t ix = 0; ix < 2; ++ix) {
+      for (uint_fast8_t iy = 0; iy < 3; ++iy) {
+        for (uint_fast8_t iz = 0; iz < 2; ++iz) {
+          const uint_fast32_t index =
+              ((ix + 1) * 5 + (iy + 2)) * 5 + (iz + 3);
+          assert_condition(boxtest[(ix * 3 + iy) * 2 + iz] == dvtest[index]);
+        }
+      }
+    }
+
     std::vector< double > blocktest =
         HDF5Tools::read_dataset< double >(group, "BlockTest");
     for (uint_fast8_t i = 0; i < 100; ++i) {
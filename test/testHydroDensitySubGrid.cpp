@@ -26,9 +26,74 @@
 
 #include "Assert.hpp"
 #include "HydroDensitySubGrid.hpp"
+#include "RandomGenerator.hpp"
 
 #include <fstream>
 
+/**
+ * @brief Check that HydroDensitySubGrid::inner_flux_sweep_batch() gives the
+ * same result as HydroDensitySubGrid::inner_flux_sweep_scalar().
+ *
+ * @param hydro Hydro instance to use.
+ */
+void check_flux_sweep(const Hydro &hydro) {
+
+  // use a different number of cells in every direction, so that not all
+  // interfaces fit in a complete batch
+  const double box[6] = {0., 0., 0., 1., 1., 1.};
+  const CoordinateVector< int_fast32_t > ncell(7, 5, 6);
+  HydroDensitySubGrid grid(box, ncell);
+  HydroDensitySubGrid reference(box, ncell);
+
+  RandomGenerator random_generator(42);
+  auto refit = reference.hydro_begin();
+  for (auto it = grid.hydro_begin(); it != grid.hydro_end(); ++it) {
+    double density = 0.1 + random_generator.get_uniform_random_double();
+    // add some vacuum cells to test the fallback for the vacuum Riemann
+    // problem
+    if (random_generator.get_uniform_random_double() < 0.1) {
+      density = 0.;
+    }
+    const CoordinateVector<> velocity(
+        random_generator.get_uniform_random_double() - 0.5,
+        random_generator.get_uniform_random_double() - 0.5,
+        random_generator.get_uniform_random_double() - 0.5);
+    const double pressure = 0.1 + random_generator.get_uniform_random_double();
+    it.get_hydro_variables().set_primitives_density(density);
+    it.get_hydro_variables().set_primitives_velocity(velocity);
+    it.get_hydro_variables().set_primitives_pressure(pressure);
+    refit.get_hydro_variables().set_primitives_density(density);
+    refit.get_hydro_variables().set_primitives_velocity(velocity);
+    refit.get_hydro_variables().set_primitives_pressure(pressure);
+    ++refit;
+  }
+
+  const double dt = 0.01;
+  grid.initialize_hydrodynamic_variables(hydro, false);
+  reference.initialize_hydrodynamic_variables(hydro, false);
+  grid.inner_gradient_sweep(hydro);
+  reference.inner_gradient_sweep(hydro);
+  grid.apply_slope_limiter(hydro);
+  reference.apply_slope_limiter(hydro);
+  grid.predict_primitive_variables(hydro, 0.5 * dt);
+  reference.predict_primitive_variables(hydro, 0.5 * dt);
+
+  grid.inner_flux_sweep_batch(hydro, dt);
+  reference.inner_flux_sweep_scalar(hydro, dt);
+
+  refit = reference.hydro_begin();
+  for (auto it = grid.hydro_begin(); it != grid.hydro_end(); ++it) {
+    for (uint_fast8_t i = 0; i < 5; ++i) {
+      // both versions are bitwise identical, unless the compiler contracts
+      // floating point operations differently in the vectorized code
+      assert_values_equal_tol(it.get_hydro_variables().delta_conserved(i),
+                              refit.get_hydro_variables().delta_conserved(i),
+                              1.e-12);
+    }
+    ++refit;
+  }
+}
+
 /**
  * @brief Unit test for the HydroDensitySubGrid class.
  *
@@ -57,7 +122,10 @@ int main(int argc, char **argv) {
   }
 
   const double dt = 0.001;
-  const Hydro hydro(5. / 3., 100., 1.e4, 1.e99, false);
+  const Abundances abundances;
+  const Hydro hydro(5. / 3., 100., 1.e4, 1.e99, false, abundances);
+
+  check_flux_sweep(hydro);
   const InflowHydroBoundary inflow_boundary;
   const ReflectiveHydroBoundary reflective_boundary;
 
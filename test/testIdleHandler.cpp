@@ -0,0 +1,136 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file testIdleHandler.cpp
+ *
+ * @brief Unit test for the IdleHandler class.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "Assert.hpp"
+#include "IdleHandler.hpp"
+#include "OpenMP.hpp"
+#include "TaskQueue.hpp"
+#include "ThreadSafeVector.hpp"
+
+/**
+ * @brief Unit test for the IdleHandler class.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  /// backoff and parking
+  {
+    IdleHandler idle_handler(4, 2, 100);
+    IdleHandler::Backoff backoff;
+
+    // a notification between prepare_wait() and wait() prevents parking
+    const uint_fast64_t old_epoch = idle_handler.prepare_wait();
+    idle_handler.notify();
+    for (uint_fast32_t i = 0; i < 10; ++i) {
+      idle_handler.wait(backoff, old_epoch);
+    }
+    assert_condition(idle_handler.get_number_of_parks() == 0);
+
+    // without notifications, the thread parks after the spin and yield steps
+    backoff.reset();
+    const uint_fast64_t epoch = idle_handler.prepare_wait();
+    for (uint_fast32_t i = 0; i < 6; ++i) {
+      idle_handler.wait(backoff, epoch);
+    }
+    assert_condition(idle_handler.get_number_of_parks() == 0);
+    idle_handler.wait(backoff, epoch);
+    assert_condition(idle_handler.get_number_of_parks() == 1);
+    idle_handler.wait(backoff, epoch);
+    assert_condition(idle_handler.get_number_of_parks() == 2);
+
+    // threads never park after the end of the parallel region
+    idle_handler.finish();
+    assert_condition(idle_handler.is_finished());
+    const uint_fast64_t final_epoch = idle_handler.prepare_wait();
+    idle_handler.wait(backoff, final_epoch);
+    assert_condition(idle_handler.get_number_of_parks() == 2);
+  }
+
+  /// termination check lock
+  {
+    IdleHandler idle_handler;
+    assert_condition(idle_handler.try_lock_termination_check());
+    assert_condition(!idle_handler.try_lock_termination_check());
+    idle_handler.unlock_termination_check();
+    assert_condition(idle_handler.try_lock_termination_check());
+    assert_condition(!idle_handler.is_finished());
+  }
+
+  /// producer and idle consumers
+  {
+    const size_t number_of_tasks = 1000;
+    IdleHandler idle_handler(4, 4, 1000);
+    ThreadSafeVector< Task > tasks(number_of_tasks);
+    TaskQueue queue(number_of_tasks);
+    AtomicValue< size_t > number_produced(0);
+    AtomicValue< size_t > number_done(0);
+
+#ifdef HAVE_OPENMP
+#pragma omp parallel default(shared)
+#endif
+    {
+      const int_fast32_t thread_id = get_thread_index();
+      IdleHandler::Backoff backoff;
+      while (!idle_handler.is_finished()) {
+        if (thread_id == 0 && number_produced.value() < number_of_tasks) {
+          // slowly produce new tasks
+          const size_t itask = tasks.get_free_element();
+          queue.add_task(itask);
+          number_produced.pre_increment();
+          idle_handler.notify();
+        }
+
+        const uint_fast64_t epoch = idle_handler.prepare_wait();
+        size_t itask = queue.get_task(tasks);
+        while (itask != NO_TASK) {
+          backoff.reset();
+          tasks.free_element(itask);
+          number_done.pre_increment();
+          itask = queue.get_task(tasks);
+        }
+
+        if (idle_handler.try_lock_termination_check()) {
+          if (number_done.value() == number_of_tasks) {
+            idle_handler.finish();
+          } else {
+            idle_handler.unlock_termination_check();
+          }
+        }
+        if (!idle_handler.is_finished() &&
+            (thread_id != 0 || number_produced.value() == number_of_tasks)) {
+          idle_handler.wait(backoff, epoch);
+        }
+      }
+    }
+
+    assert_condition(number_done.value() == number_of_tasks);
+    assert_condition(queue.size() == 0);
+  }
+
+  return 0;
+}
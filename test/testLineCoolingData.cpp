@@ -25,6 +25,7 @@
  */
 #include "Assert.hpp"
 #include "LineCoolingData.hpp"
+#include "LineCoolingTable.hpp"
 #include "UnitConverter.hpp"
 #include "Utilities.hpp"
 #include <cinttypes>
@@ -148,6 +149,47 @@ int main(int argc, char **argv) {
     }
   }
 
+  // element cooling and tabulated line cooling
+  {
+    LineCoolingTable table(data, 1000., 1.e5, 400, 1., 1.e14, 280, 1.e-3);
+    std::ifstream file("linecool_testdata.txt");
+    std::string line;
+    while (getline(file, line)) {
+      std::istringstream lstream(line);
+
+      double T, ne, abundances[13];
+
+      lstream >> T >> ne;
+      for (uint_fast8_t i = 0; i < 13; ++i) {
+        lstream >> abundances[i];
+      }
+      ne = UnitConverter::to_SI< QUANTITY_NUMBER_DENSITY >(ne, "cm^-3");
+
+      const double cool = data.get_cooling(T, ne, abundances);
+
+      double element_cooling[LINECOOLINGDATA_NUMELEMENTS];
+      data.get_element_cooling(T, ne, element_cooling);
+      double element_cool = 0.;
+      for (uint_fast8_t i = 0; i < 13; ++i) {
+        element_cool += abundances[i] * element_cooling[i];
+      }
+      assert_values_equal_rel(element_cool, cool, 1.e-12);
+
+      assert_values_equal_rel(table.get_cooling(T, ne, abundances), cool,
+                              1.e-3);
+    }
+
+    // values outside the table range are computed exactly
+    double abundances[13];
+    for (uint_fast8_t i = 0; i < 13; ++i) {
+      abundances[i] = 1.e-4;
+    }
+    assert_condition(table.get_cooling(500., 1.e8, abundances) ==
+                     data.get_cooling(500., 1.e8, abundances));
+    assert_condition(table.get_cooling(1.e4, 0., abundances) ==
+                     data.get_cooling(1.e4, 0., abundances));
+  }
+
   // linestr
   {
     std::ifstream file("linestr_testdata.txt");
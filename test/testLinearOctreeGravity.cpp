@@ -0,0 +1,215 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file testLinearOctreeGravity.cpp
+ *
+ * @brief Unit test for the LinearOctreeGravity class.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "Assert.hpp"
+#include "LinearOctreeGravity.hpp"
+#include "RandomGenerator.hpp"
+
+#include <cmath>
+#include <vector>
+
+/**
+ * @brief Compute the accelerations and potentials using direct summation.
+ *
+ * @param positions Particle positions (in m).
+ * @param masses Particle masses (in kg).
+ * @param accelerations Accelerations (in m s^-2).
+ * @param potentials Potentials (in m^2 s^-2).
+ */
+void direct_summation(const std::vector< CoordinateVector<> > &positions,
+                      const std::vector< double > &masses,
+                      std::vector< CoordinateVector<> > &accelerations,
+                      std::vector< double > &potentials) {
+
+  const double G = PhysicalConstants::get_physical_constant(
+      PHYSICALCONSTANT_NEWTON_CONSTANT);
+  accelerations.assign(positions.size(), CoordinateVector<>(0.));
+  potentials.assign(positions.size(), 0.);
+  for (size_t i = 0; i < positions.size(); ++i) {
+    for (size_t j = 0; j < positions.size(); ++j) {
+      if (i != j) {
+        const CoordinateVector<> r = positions[i] - positions[j];
+        const double inverse_r = 1. / r.norm();
+        accelerations[i] -=
+            G * masses[j] * inverse_r * inverse_r * inverse_r * r;
+        potentials[i] -= G * masses[j] * inverse_r;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Get the RMS and maximum relative acceleration error.
+ *
+ * @param reference Reference accelerations (in m s^-2).
+ * @param accelerations Accelerations to test (in m s^-2).
+ * @param rms_error Output RMS relative error.
+ * @param max_error Output maximum relative error.
+ */
+void get_errors(const std::vector< CoordinateVector<> > &reference,
+                const std::vector< CoordinateVector<> > &accelerations,
+                double &rms_error, double &max_error) {
+
+  rms_error = 0.;
+  max_error = 0.;
+  for (size_t i = 0; i < reference.size(); ++i) {
+    const double error =
+        (accelerations[i] - reference[i]).norm() / reference[i].norm();
+    rms_error += error * error;
+    max_error = std::max(max_error, error);
+  }
+  rms_error = std::sqrt(rms_error / reference.size());
+}
+
+/**
+ * @brief Unit test for the LinearOctreeGravity class.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  const Box<> box(CoordinateVector<>(-1.), CoordinateVector<>(2., 2., 1.));
+  RandomGenerator random_generator(42);
+
+  // random particles, clustered towards the centre of the box
+  const size_t number_of_particles = 2000;
+  std::vector< CoordinateVector<> > positions(number_of_particles);
+  std::vector< double > masses(number_of_particles);
+  for (size_t i = 0; i < number_of_particles; ++i) {
+    const double r = std::pow(random_generator.get_uniform_random_double(), 2);
+    for (uint_fast8_t j = 0; j < 3; ++j) {
+      positions[i][j] =
+          box.get_anchor()[j] +
+          (0.5 + r * (random_generator.get_uniform_random_double() - 0.5)) *
+              box.get_sides()[j];
+    }
+    masses[i] = 1.e30 * (0.5 + random_generator.get_uniform_random_double());
+  }
+  std::vector< CoordinateVector<> > reference_accelerations;
+  std::vector< double > reference_potentials;
+  direct_summation(positions, masses, reference_accelerations,
+                   reference_potentials);
+
+  /// an opening angle of 0 reduces to direct summation
+  {
+    LinearOctreeGravity tree(box, 0., 4);
+    tree.build(positions, masses);
+    assert_condition(tree.get_number_of_particles() == number_of_particles);
+    assert_condition(tree.get_number_of_leaves() > 1);
+
+    std::vector< CoordinateVector<> > accelerations;
+    std::vector< double > potentials;
+    tree.compute_accelerations(accelerations, potentials);
+    double rms_error, max_error;
+    get_errors(reference_accelerations, accelerations, rms_error, max_error);
+    assert_condition(max_error < 1.e-10);
+    for (size_t i = 0; i < number_of_particles; ++i) {
+      assert_values_equal_rel(potentials[i], reference_potentials[i], 1.e-10);
+    }
+  }
+
+  /// accuracy of the multipole expansion
+  {
+    double previous_rms_error = 0.;
+    const double opening_angles[3] = {0.3, 0.5, 0.8};
+    const double tolerances[3] = {2.e-4, 1.e-3, 5.e-3};
+    for (uint_fast32_t itheta = 0; itheta < 3; ++itheta) {
+      LinearOctreeGravity tree(box, opening_angles[itheta]);
+      tree.build(positions, masses);
+      std::vector< CoordinateVector<> > accelerations;
+      std::vector< double > potentials;
+      tree.compute_accelerations(accelerations, potentials);
+      double rms_error, max_error;
+      get_errors(reference_accelerations, accelerations, rms_error, max_error);
+      cmac_status("theta = %g: RMS error: %g, max error: %g",
+                  opening_angles[itheta], rms_error, max_error);
+      assert_condition(rms_error < tolerances[itheta]);
+      assert_condition(rms_error >= previous_rms_error);
+      previous_rms_error = rms_error;
+      for (size_t i = 0; i < number_of_particles; ++i) {
+        assert_values_equal_rel(potentials[i], reference_potentials[i],
+                                tolerances[itheta]);
+      }
+    }
+  }
+
+  /// regular grid and in place mass updates
+  {
+    const Box<> grid_box(CoordinateVector<>(0.), CoordinateVector<>(1.));
+    const uint_fast32_t ncell = 12;
+    std::vector< CoordinateVector<> > grid_positions;
+    std::vector< double > grid_masses;
+    for (uint_fast32_t ix = 0; ix < ncell; ++ix) {
+      for (uint_fast32_t iy = 0; iy < ncell; ++iy) {
+        for (uint_fast32_t iz = 0; iz < ncell; ++iz) {
+          grid_positions.push_back(
+              CoordinateVector<>((ix + 0.5) / ncell, (iy + 0.5) / ncell,
+                                 (iz + 0.5) / ncell));
+          grid_masses.push_back(1.e30);
+        }
+      }
+    }
+
+    LinearOctreeGravity tree(grid_box, 0.5);
+    tree.build(grid_positions, grid_masses);
+
+    // change the masses
+    for (size_t i = 0; i < grid_masses.size(); ++i) {
+      grid_masses[i] =
+          1.e30 * (1. + 10. * random_generator.get_uniform_random_double());
+    }
+    const size_t number_of_nodes = tree.get_number_of_nodes();
+    tree.update_masses(grid_masses);
+    assert_condition(tree.get_number_of_nodes() == number_of_nodes);
+    std::vector< CoordinateVector<> > updated_accelerations;
+    std::vector< double > updated_potentials;
+    tree.compute_accelerations(updated_accelerations, updated_potentials);
+
+    // compare with a tree built from scratch and with direct summation
+    LinearOctreeGravity new_tree(grid_box, 0.5);
+    new_tree.build(grid_positions, grid_masses);
+    std::vector< CoordinateVector<> > accelerations;
+    std::vector< double > potentials;
+    new_tree.compute_accelerations(accelerations, potentials);
+    for (size_t i = 0; i < grid_masses.size(); ++i) {
+      assert_condition(updated_accelerations[i] == accelerations[i]);
+      assert_condition(updated_potentials[i] == potentials[i]);
+    }
+
+    std::vector< CoordinateVector<> > grid_reference_accelerations;
+    std::vector< double > grid_reference_potentials;
+    direct_summation(grid_positions, grid_masses, grid_reference_accelerations,
+                     grid_reference_potentials);
+    double rms_error, max_error;
+    get_errors(grid_reference_accelerations, updated_accelerations, rms_error,
+               max_error);
+    cmac_status("grid: RMS error: %g, max error: %g", rms_error, max_error);
+    assert_condition(rms_error < 1.e-3);
+  }
+
+  return 0;
+}
@@ -26,8 +26,84 @@
 
 #include "Assert.hpp"
 #include "MemorySpace.hpp"
+#include "RandomGenerator.hpp"
+#include "TravelDirections.hpp"
 
+#include <cmath>
 #include <omp.h>
+#include <vector>
+
+/**
+ * @brief Generate a random photon packet.
+ *
+ * @param random_generator RandomGenerator to use.
+ * @return Random photon packet.
+ */
+inline PhotonPacket generate_photon(RandomGenerator &random_generator) {
+
+  PhotonPacket photon;
+  photon.set_position(
+      CoordinateVector<>(random_generator.get_uniform_random_double(),
+                         random_generator.get_uniform_random_double(),
+                         random_generator.get_uniform_random_double()));
+  photon.set_direction(
+      CoordinateVector<>(random_generator.get_uniform_random_double() - 0.5,
+                         random_generator.get_uniform_random_double() - 0.5,
+                         random_generator.get_uniform_random_double() - 0.5));
+  photon.set_target_optical_depth(
+      -std::log(random_generator.get_uniform_random_double()));
+  for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+    photon.set_photoionization_cross_section(
+        ion, 1.e-22 * random_generator.get_uniform_random_double());
+  }
+  photon.set_dust_opacity(random_generator.get_uniform_random_double());
+  photon.set_energy(3.288e15 *
+                    (1. + random_generator.get_uniform_random_double()));
+  photon.set_weight(random_generator.get_uniform_random_double());
+  photon.set_distance_travelled(random_generator.get_uniform_random_double());
+  photon.set_source_index(random_generator.get_random_integer() % 1000);
+  photon.set_scatter_counter(random_generator.get_random_integer() % 10);
+  photon.set_type(PHOTONTYPE_DIFFUSE_HI);
+  return photon;
+}
+
+/**
+ * @brief Check that the given photon packet was stored correctly.
+ *
+ * Double precision properties need to be exactly the same, single precision
+ * properties (only stored in single precision if USE_COMPACT_PHOTON_BUFFER is
+ * defined) need to be the same up to single precision round off.
+ *
+ * @param reference Original photon packet.
+ * @param photon Stored photon packet.
+ */
+inline void check_photon(const PhotonPacket &reference,
+                         const PhotonPacket &photon) {
+
+  for (uint_fast8_t idim = 0; idim < 3; ++idim) {
+    assert_condition(photon.get_position()[idim] ==
+                     reference.get_position()[idim]);
+    assert_values_equal_rel(photon.get_direction()[idim],
+                            reference.get_direction()[idim], 1.e-6);
+  }
+  assert_condition(photon.get_target_optical_depth() ==
+                   reference.get_target_optical_depth());
+  for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+    assert_values_equal_rel(photon.get_photoionization_cross_section(ion),
+                            reference.get_photoionization_cross_section(ion),
+                            1.e-6);
+  }
+  assert_values_equal_rel(photon.get_dust_opacity(),
+                          reference.get_dust_opacity(), 1.e-6);
+  assert_condition(photon.get_energy() == reference.get_energy());
+  assert_condition(photon.get_weight() == reference.get_weight());
+  assert_condition(photon.get_distance_travelled() ==
+                   reference.get_distance_travelled());
+  assert_condition(photon.get_source_index() == reference.get_source_index());
+  assert_condition(photon.get_scatter_counter() ==
+                   reference.get_scatter_counter());
+  assert_condition(photon.get_type() == reference.get_type());
+}
 
 /**
  * @brief Unit test for the MemorySpace class.
@@ -63,5 +139,51 @@ int main(int argc, char **argv) {
     }
   }
 
+  // check that MemorySpace::add_photons() correctly copies photon packets and
+  // starts a new buffer when the target buffer is full
+  {
+    MemorySpace space(10);
+    RandomGenerator random_generator(42);
+
+    const uint_fast32_t number_of_photons = (3 * PHOTONBUFFER_SIZE) / 4;
+    std::vector< PhotonPacket > reference(2 * number_of_photons);
+    PhotonBuffer input_buffer;
+    input_buffer.grow(number_of_photons);
+    for (uint_fast32_t i = 0; i < number_of_photons; ++i) {
+      reference[i] = generate_photon(random_generator);
+      reference[number_of_photons + i] = reference[i];
+      input_buffer.set_photon(i, reference[i]);
+    }
+
+    const size_t first_index = space.get_free_buffer();
+    space[first_index].set_subgrid_index(42);
+    space[first_index].set_direction(TRAVELDIRECTION_CORNER_NPN);
+    assert_condition(space.add_photons(first_index, input_buffer) ==
+                     first_index);
+    const size_t second_index = space.add_photons(first_index, input_buffer);
+    assert_condition(second_index != first_index);
+
+    const PhotonBuffer &first_buffer = space[first_index];
+    const PhotonBuffer &second_buffer = space[second_index];
+    assert_condition(first_buffer.size() == PHOTONBUFFER_SIZE);
+    assert_condition(second_buffer.size() ==
+                     2 * number_of_photons - PHOTONBUFFER_SIZE);
+    assert_condition(second_buffer.get_subgrid_index() == 42);
+    assert_condition(second_buffer.get_direction() ==
+                     TRAVELDIRECTION_CORNER_NPN);
+
+    PhotonPacket photon;
+    for (uint_fast32_t i = 0; i < first_buffer.size(); ++i) {
+      first_buffer.get_photon(i, photon);
+      check_photon(reference[i], photon);
+    }
+    for (uint_fast32_t i = 0; i < second_buffer.size(); ++i) {
+      second_buffer.get_photon(i, photon);
+      check_photon(reference[PHOTONBUFFER_SIZE + i], photon);
+    }
+
+    cmac_status("Memory per photon buffer: %zu bytes.", sizeof(PhotonBuffer));
+  }
+
   return 0;
 }
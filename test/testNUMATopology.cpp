@@ -0,0 +1,127 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file testNUMATopology.cpp
+ *
+ * @brief Unit test for the NUMATopology class and locality aware stealing.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "Assert.hpp"
+#include "NUMATopology.hpp"
+#include "Scheduler.hpp"
+#include "TaskQueue.hpp"
+#include "ThreadSafeVector.hpp"
+
+#include <vector>
+
+/**
+ * @brief Unit test for the NUMATopology class and locality aware stealing.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  // two domains with 4 cores each
+  std::vector< std::vector< int_fast32_t > > domain_cores(2);
+  for (int_fast32_t i = 0; i < 4; ++i) {
+    domain_cores[0].push_back(i);
+    domain_cores[1].push_back(4 + i);
+  }
+
+  /// thread to domain and core mapping
+  {
+    const NUMATopology topology(domain_cores, 8);
+    assert_condition(topology.get_number_of_domains() == 2);
+    assert_condition(topology.get_number_of_threads() == 8);
+    for (int_fast32_t i = 0; i < 8; ++i) {
+      assert_condition(topology.get_domain(i) == i / 4);
+      assert_condition(topology.get_core(i) == i);
+    }
+
+    // threads in the same domain come first, starting from the next thread
+    const std::vector< int_fast32_t > &order1 = topology.get_steal_order(1);
+    const int_fast32_t reference1[7] = {2, 3, 0, 4, 5, 6, 7};
+    assert_condition(order1.size() == 7);
+    for (int_fast32_t i = 0; i < 7; ++i) {
+      assert_condition(order1[i] == reference1[i]);
+    }
+    const std::vector< int_fast32_t > &order7 = topology.get_steal_order(7);
+    const int_fast32_t reference7[7] = {4, 5, 6, 0, 1, 2, 3};
+    assert_condition(order7.size() == 7);
+    for (int_fast32_t i = 0; i < 7; ++i) {
+      assert_condition(order7[i] == reference7[i]);
+    }
+  }
+
+  /// more threads than cores and fewer threads than domains
+  {
+    const NUMATopology topology(domain_cores, 10);
+    assert_condition(topology.get_domain(4) == 0);
+    assert_condition(topology.get_core(4) == 0);
+    assert_condition(topology.get_domain(5) == 1);
+    assert_condition(topology.get_core(5) == 4);
+    assert_condition(topology.get_core(9) == 4);
+
+    const NUMATopology single_thread(domain_cores, 1);
+    assert_condition(single_thread.get_domain(0) == 0);
+    assert_condition(single_thread.get_steal_order(0).empty());
+  }
+
+  /// detected topology
+  {
+    const NUMATopology topology(2);
+    assert_condition(topology.get_number_of_domains() > 0);
+    assert_condition(topology.get_steal_order(0).size() == 1);
+  }
+
+  /// locality aware stealing
+  {
+    const NUMATopology topology(domain_cores, 4);
+    ThreadSafeVector< Task > tasks(10);
+    std::vector< TaskQueue * > queues(4);
+    for (int_fast32_t i = 0; i < 4; ++i) {
+      queues[i] = new TaskQueue(10);
+    }
+    // thread 0 and 1 are in domain 0, thread 2 and 3 in domain 1
+    const size_t task_remote = tasks.get_free_element();
+    queues[2]->add_task(task_remote);
+    const size_t task_local = tasks.get_free_element();
+    queues[1]->add_task(task_local);
+
+    bool remote = true;
+    uint_fast32_t task =
+        Scheduler::steal_task(0, queues, tasks, topology, remote);
+    assert_condition(task == task_local);
+    assert_condition(!remote);
+    task = Scheduler::steal_task(0, queues, tasks, topology, remote);
+    assert_condition(task == task_remote);
+    assert_condition(remote);
+    task = Scheduler::steal_task(0, queues, tasks, topology, remote);
+    assert_condition(task == NO_TASK);
+
+    for (int_fast32_t i = 0; i < 4; ++i) {
+      delete queues[i];
+    }
+  }
+
+  return 0;
+}
@@ -29,6 +29,8 @@
 #include "Error.hpp"
 #include "Octree.hpp"
 #include "Utilities.hpp"
+#include <algorithm>
+#include <cfloat>
 #include <fstream>
 #include <vector>
 
@@ -169,5 +171,159 @@ int main(int argc, char **argv) {
     }
   }
 
+  // other query types, for a larger number of positions and different leaf
+  // sizes
+  numpos = 10000;
+  positions.resize(numpos);
+  hs.resize(numpos);
+  for (uint_fast32_t i = 0; i < numpos; ++i) {
+    positions[i] = Utilities::random_position();
+    hs[i] = 0.05 * Utilities::random_double();
+  }
+  // add a few duplicate positions
+  for (uint_fast32_t i = 0; i < 20; ++i) {
+    positions[numpos - 1 - i] = positions[0];
+  }
+  for (uint_fast8_t iperiodic = 0; iperiodic < 2; ++iperiodic) {
+    const bool periodic = (iperiodic == 1);
+    for (uint_fast32_t leaf_size = 1; leaf_size < 100; leaf_size *= 4) {
+      Octree tree(positions, box, periodic, leaf_size);
+      tree.set_auxiliaries(hs, Octree::max< double >);
+
+      std::vector< CoordinateVector<> > centres(64);
+      for (uint_fast32_t i = 0; i < 64; ++i) {
+        // a block of 4x4x4 points close to the box boundary
+        centres[i] = CoordinateVector<>(0.005 + 0.01 * (i / 16),
+                                        0.3 + 0.01 * ((i / 4) % 4),
+                                        0.99 - 0.01 * (i % 4));
+      }
+      std::vector< std::vector< uint_fast32_t > > ngbs_block;
+      tree.get_ngbs_block(centres, ngbs_block);
+      assert_condition(ngbs_block.size() == centres.size());
+
+      std::vector< uint_fast32_t > ngbs_tree;
+      std::vector< uint_fast32_t > ngbs_sphere;
+      for (uint_fast32_t j = 0; j < centres.size(); ++j) {
+        const CoordinateVector<> &centre = centres[j];
+        std::vector< uint_fast32_t > ngbs_brute_force;
+        std::vector< uint_fast32_t > ngbs_sphere_brute_force;
+        uint_fast32_t closest_brute_force = 0;
+        double rmin = DBL_MAX;
+        for (uint_fast32_t i = 0; i < numpos; ++i) {
+          double r;
+          if (periodic) {
+            r = box.periodic_distance(positions[i], centre).norm();
+          } else {
+            r = (positions[i] - centre).norm();
+          }
+          if (r < hs[i]) {
+            ngbs_brute_force.push_back(i);
+          }
+          if (r < hs[i] + 0.02) {
+            ngbs_sphere_brute_force.push_back(i);
+          }
+          if (r < rmin) {
+            rmin = r;
+            closest_brute_force = i;
+          }
+        }
+
+        // the buffer should be reused and cleared by every query
+        tree.get_ngbs(centre, ngbs_tree);
+        std::sort(ngbs_tree.begin(), ngbs_tree.end());
+        assert_condition(ngbs_tree == ngbs_brute_force);
+
+        std::sort(ngbs_block[j].begin(), ngbs_block[j].end());
+        assert_condition(ngbs_block[j] == ngbs_brute_force);
+
+        tree.get_ngbs_sphere(centre, 0.02, ngbs_sphere);
+        std::sort(ngbs_sphere.begin(), ngbs_sphere.end());
+        assert_condition(ngbs_sphere == ngbs_sphere_brute_force);
+
+        uint_fast32_t number_of_calls = 0;
+        tree.for_each_ngb(centre, [&number_of_calls](const uint_fast32_t) {
+          ++number_of_calls;
+        });
+        assert_condition(number_of_calls == ngbs_brute_force.size());
+
+        const uint_fast32_t closest = tree.get_closest_ngb(centre);
+        if (periodic) {
+          assert_condition(
+              box.periodic_distance(positions[closest], centre).norm() ==
+              rmin);
+        } else {
+          assert_condition((positions[closest] - centre).norm() == rmin);
+        }
+        if (closest != closest_brute_force) {
+          cmac_status("Different closest neighbour at the same distance.");
+        }
+      }
+    }
+  }
+
+  // refit: move the positions slightly and check that the refitted tree still
+  // finds the correct neighbours
+  for (uint_fast8_t iperiodic = 0; iperiodic < 2; ++iperiodic) {
+    const bool periodic = (iperiodic == 1);
+    std::vector< CoordinateVector<> > moving_positions(positions);
+    Octree tree(moving_positions, box, periodic);
+    tree.set_auxiliaries(hs, Octree::max< double >);
+
+    // the bounding boxes of the positions are smaller than the original leaves
+    assert_condition(tree.refit() <= 1.);
+
+    for (uint_fast32_t i = 0; i < numpos; ++i) {
+      for (uint_fast8_t j = 0; j < 3; ++j) {
+        moving_positions[i][j] += 0.02 * (Utilities::random_double() - 0.5);
+        if (periodic) {
+          if (moving_positions[i][j] < 0.) {
+            moving_positions[i][j] += 1.;
+          }
+          if (moving_positions[i][j] >= 1.) {
+            moving_positions[i][j] -= 1.;
+          }
+        }
+      }
+      hs[i] *= 0.9 + 0.2 * Utilities::random_double();
+    }
+    const double volume_ratio = tree.refit();
+    cmac_status("Leaf volume ratio after refit: %g.", volume_ratio);
+    tree.set_auxiliaries(hs, Octree::max< double >);
+
+    std::vector< uint_fast32_t > ngbs_tree;
+    for (uint_fast32_t j = 0; j < 64; ++j) {
+      const CoordinateVector<> centre(0.005 + 0.01 * (j / 16),
+                                      0.3 + 0.01 * ((j / 4) % 4),
+                                      0.99 - 0.01 * (j % 4));
+      std::vector< uint_fast32_t > ngbs_brute_force;
+      double rmin = DBL_MAX;
+      for (uint_fast32_t i = 0; i < numpos; ++i) {
+        double r;
+        if (periodic) {
+          r = box.periodic_distance(moving_positions[i], centre).norm();
+        } else {
+          r = (moving_positions[i] - centre).norm();
+        }
+        if (r < hs[i]) {
+          ngbs_brute_force.push_back(i);
+        }
+        rmin = std::min(rmin, r);
+      }
+
+      tree.get_ngbs(centre, ngbs_tree);
+      std::sort(ngbs_tree.begin(), ngbs_tree.end());
+      assert_condition(ngbs_tree == ngbs_brute_force);
+
+      const uint_fast32_t closest = tree.get_closest_ngb(centre);
+      if (periodic) {
+        assert_condition(
+            box.periodic_distance(moving_positions[closest], centre).norm() ==
+            rmin);
+      } else {
+        assert_condition((moving_positions[closest] - centre).norm() == rmin);
+      }
+    }
+  }
+
   return 0;
 }
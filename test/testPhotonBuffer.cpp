@@ -69,7 +69,7 @@ int main(int argc, char **argv) {
   test_buffer.set_direction(random_generator.get_random_integer() %
                             TRAVELDIRECTION_NUMBER);
   for (uint_fast32_t i = 0; i < test_buffer.size(); ++i) {
-    PhotonPacket &photon = test_buffer[i];
+    PhotonPacket photon = PhotonPacket();
     photon.set_position(
         CoordinateVector<>(random_generator.get_uniform_random_double(),
                            random_generator.get_uniform_random_double(),
@@ -81,6 +81,7 @@ int main(int argc, char **argv) {
     photon.set_weight(random_generator.get_uniform_random_double());
     photon.set_target_optical_depth(
         random_generator.get_uniform_random_double());
+    test_buffer.set_photon(i, photon);
   }
 
   // now communicate:
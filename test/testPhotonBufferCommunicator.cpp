@@ -0,0 +1,124 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file testPhotonBufferCommunicator.cpp
+ *
+ * @brief Unit test for the PhotonBufferCommunicator class.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+
+#include "Assert.hpp"
+#include "PhotonBufferCommunicator.hpp"
+#include "RandomGenerator.hpp"
+#include "TravelDirections.hpp"
+
+#include <mpi.h>
+
+/**
+ * @brief Unit test for the PhotonBufferCommunicator class.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  // MPI initialisation
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_SERIALIZED, &provided);
+  int rank_get, size_get;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank_get);
+  MPI_Comm_size(MPI_COMM_WORLD, &size_get);
+  const int_fast32_t MPI_rank = rank_get;
+  const int_fast32_t MPI_size = size_get;
+
+  if (MPI_rank == 0) {
+    if (MPI_size > 1) {
+      cmac_status("Running on %" PRIiFAST32 " processes.", MPI_size);
+    } else {
+      cmac_status("Running on a single process.");
+    }
+  }
+
+  // make sure we have at least 2 processes
+  assert_condition(MPI_size > 1);
+
+  MemorySpace buffers(100);
+  PhotonBufferCommunicator communicator;
+
+  // every process completes 1 photon packet
+  communicator.start(MPI_size);
+
+  // every process sends a buffer to the next process
+  PhotonBuffer send_buffer;
+  send_buffer.grow(10 + MPI_rank);
+  send_buffer.set_subgrid_index(MPI_rank);
+  send_buffer.set_direction(TRAVELDIRECTION_FACE_X_P);
+  RandomGenerator random_generator(42 + MPI_rank);
+  for (uint_fast32_t i = 0; i < send_buffer.size(); ++i) {
+    PhotonPacket photon = PhotonPacket();
+    photon.set_position(
+        CoordinateVector<>(random_generator.get_uniform_random_double(),
+                           random_generator.get_uniform_random_double(),
+                           random_generator.get_uniform_random_double()));
+    photon.set_direction(CoordinateVector<>(1., 0., 0.));
+    photon.set_weight(MPI_rank);
+    send_buffer.set_photon(i, photon);
+  }
+  communicator.send(send_buffer, (MPI_rank + 1) % MPI_size);
+  // the buffer was copied and can be reused immediately
+  send_buffer.reset();
+
+  // receive the buffer sent by the previous process
+  std::vector< size_t > buffer_indices(
+      communicator.get_number_of_receives());
+  uint_fast32_t number_received = 0;
+  while (number_received == 0) {
+    number_received = communicator.receive(buffers, buffer_indices.data());
+  }
+  assert_condition(number_received == 1);
+  const int_fast32_t source = (MPI_rank + MPI_size - 1) % MPI_size;
+  const PhotonBuffer &recv_buffer = buffers[buffer_indices[0]];
+  assert_condition(recv_buffer.size() ==
+                   static_cast< uint_fast32_t >(10 + source));
+  assert_condition(recv_buffer.get_subgrid_index() ==
+                   static_cast< size_t >(source));
+  assert_condition(recv_buffer.get_direction() == TRAVELDIRECTION_FACE_X_P);
+  PhotonPacket photon;
+  for (uint_fast32_t i = 0; i < recv_buffer.size(); ++i) {
+    recv_buffer.get_photon(i, photon);
+    assert_condition(photon.get_weight() == source);
+  }
+  buffers.free_buffer(buffer_indices[0]);
+
+  // termination: we only finish once all processes have completed their
+  // photon packet
+  assert_condition(!communicator.is_finished(0));
+  while (!communicator.is_finished(1)) {
+  }
+
+  communicator.finish();
+
+  if (MPI_rank == 0) {
+    cmac_status("Test successful.");
+  }
+
+  return MPI_Finalize();
+}
@@ -36,6 +36,7 @@
 #include "UnitConverter.hpp"
 #include "Utilities.hpp"
 #include "VernerCrossSections.hpp"
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 #include <vector>
@@ -142,6 +143,96 @@ double FGspectrum(double *nuarr, double *earr, double nu) {
              (nu - nuarr[inu - 1]) / (nuarr[inu] - nuarr[inu - 1]);
 }
 
+/**
+ * @brief Compare the frequencies sampled from the given spectrum with
+ * frequencies sampled by inversion of the cumulative distribution of the given
+ * luminosity function, using a two sample chi squared test.
+ *
+ * The reference cumulative distribution is computed on a fine frequency grid,
+ * so that this test checks both the alias table sampling and the stochastic
+ * selection of the temperature table used by temperature dependent spectra.
+ *
+ * @param spectrum PhotonSourceSpectrum to test.
+ * @param temperature Temperature passed on to the spectrum (in K).
+ * @param luminosity Luminosity function, taking a frequency in units of
+ * 13.6 eV as single argument.
+ * @param min_frequency Lower limit of the spectrum (in units of 13.6 eV).
+ * @param max_frequency Upper limit of the spectrum (in units of 13.6 eV).
+ * @param random_generator RandomGenerator to use.
+ */
+template < typename _luminosity_function_ >
+void check_distribution(const PhotonSourceSpectrum &spectrum,
+                        const double temperature,
+                        _luminosity_function_ luminosity,
+                        const double min_frequency, const double max_frequency,
+                        RandomGenerator &random_generator) {
+
+  const uint_fast32_t number_of_nodes = 10001;
+  std::vector< double > nodes(number_of_nodes);
+  std::vector< double > cumulative_distribution(number_of_nodes);
+  cumulative_distribution[0] = 0.;
+  nodes[0] = min_frequency;
+  for (uint_fast32_t i = 1; i < number_of_nodes; ++i) {
+    nodes[i] = min_frequency +
+               i * (max_frequency - min_frequency) / (number_of_nodes - 1.);
+    cumulative_distribution[i] =
+        cumulative_distribution[i - 1] +
+        0.5 * (luminosity(nodes[i - 1]) + luminosity(nodes[i])) *
+            (nodes[i] - nodes[i - 1]);
+  }
+  for (uint_fast32_t i = 0; i < number_of_nodes; ++i) {
+    cumulative_distribution[i] /= cumulative_distribution.back();
+  }
+
+  const uint_fast32_t number_of_samples = 1000000;
+  const uint_fast32_t number_of_bins = 100;
+  std::vector< double > counts_spectrum(number_of_bins, 0.);
+  std::vector< double > counts_reference(number_of_bins, 0.);
+  const double inverse_bin_width =
+      number_of_bins / (max_frequency - min_frequency);
+  for (uint_fast32_t i = 0; i < number_of_samples; ++i) {
+    // we manually convert from Hz to 13.6 eV for efficiency reasons
+    const double nu_spectrum =
+        spectrum.get_random_frequency(random_generator, temperature) /
+        3.288465385e15;
+    const double x = random_generator.get_uniform_random_double();
+    const uint_fast32_t inu = Utilities::locate(
+        x, cumulative_distribution.data(), number_of_nodes);
+    const double nu_reference =
+        nodes[inu] + (nodes[inu + 1] - nodes[inu]) *
+                         (x - cumulative_distribution[inu]) /
+                         (cumulative_distribution[inu + 1] -
+                          cumulative_distribution[inu]);
+    const int_fast32_t ispectrum =
+        (nu_spectrum - min_frequency) * inverse_bin_width;
+    const int_fast32_t ireference =
+        (nu_reference - min_frequency) * inverse_bin_width;
+    counts_spectrum[std::max(
+        int_fast32_t(0),
+        std::min(ispectrum, int_fast32_t(number_of_bins - 1)))] += 1.;
+    counts_reference[std::max(
+        int_fast32_t(0),
+        std::min(ireference, int_fast32_t(number_of_bins - 1)))] += 1.;
+  }
+
+  double chi2 = 0.;
+  uint_fast32_t degrees_of_freedom = 0;
+  for (uint_fast32_t i = 0; i < number_of_bins; ++i) {
+    const double sum = counts_spectrum[i] + counts_reference[i];
+    if (sum > 0.) {
+      const double diff = counts_spectrum[i] - counts_reference[i];
+      chi2 += diff * diff / sum;
+      ++degrees_of_freedom;
+    }
+  }
+  --degrees_of_freedom;
+  cmac_status("T: %g K, chi2: %g (%" PRIuFAST32 " degrees of freedom)",
+              temperature, chi2, degrees_of_freedom);
+  // the chi2 value has a standard deviation of sqrt(2 * degrees_of_freedom)
+  assert_condition(chi2 < degrees_of_freedom +
+                              5. * std::sqrt(2. * degrees_of_freedom));
+}
+
 /**
  * @brief Unit test for the PhotonSourceSpectrum interface and its
  * implementations.
@@ -227,6 +318,17 @@ int main(int argc, char **argv) {
            << tolerance << "\n";
       assert_values_equal_rel(tval, bval, tolerance);
     }
+
+    // compare with inversion sampling of the exact spectrum, both in between
+    // two temperature tables and close to the edges of the temperature range
+    for (const double Tcheck : {2000., T, 9060., 14900.}) {
+      check_distribution(
+          spectrum, Tcheck,
+          [&cross_sections, Tcheck](const double nu) {
+            return HLyc_luminosity(cross_sections, Tcheck, nu);
+          },
+          1., 4., random_generator);
+    }
   }
 
   // HeliumLymanContinuumSpectrum
@@ -265,6 +367,18 @@ int main(int argc, char **argv) {
            << tolerance << "\n";
       assert_values_equal_rel(tval, bval, tolerance);
     }
+
+#ifdef HAS_HELIUM
+    // compare with inversion sampling of the exact spectrum
+    for (const double Tcheck : {2000., T, 9060., 14900.}) {
+      check_distribution(
+          spectrum, Tcheck,
+          [&cross_sections, Tcheck](const double nu) {
+            return HeLyc_luminosity(cross_sections, Tcheck, nu);
+          },
+          1.81, 4., random_generator);
+    }
+#endif
   }
 
   // HeliumTwoPhotonContinuumSpectrum
@@ -279,7 +393,7 @@ int main(int argc, char **argv) {
     for (uint_fast8_t i = 0; i < 100; ++i) {
       counts[i] = 0;
     }
-    uint_fast32_t numsample = 1000000;
+    uint_fast32_t numsample = 4000000;
     for (uint_fast32_t i = 0; i < numsample; ++i) {
       // we manually convert from Hz to 13.6 eV for efficiency reasons
       double rand_freq =
@@ -300,6 +414,13 @@ int main(int argc, char **argv) {
            << tolerance << "\n";
       assert_values_equal_rel(tval, bval, tolerance);
     }
+
+    // compare with inversion sampling of the tabulated spectrum
+    check_distribution(spectrum, 0.,
+                       [&yHe2q, &AHe2q](const double nu) {
+                         return He2pc_luminosity(yHe2q, AHe2q, nu);
+                       },
+                       1., 1.6, random_generator);
   }
 
   // FaucherGiguerePhotonSourceSpectrum
@@ -343,7 +464,7 @@ int main(int argc, char **argv) {
     for (uint_fast8_t i = 0; i < 101; ++i) {
       counts[i] = 0;
     }
-    uint_fast32_t numsample = 1000000;
+    uint_fast32_t numsample = 4000000;
     for (uint_fast32_t i = 0; i < numsample; ++i) {
       // we manually convert from Hz to 13.6 eV for efficiency reasons
       double rand_freq =
@@ -0,0 +1,191 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file testPrivateIntensityBuffers.cpp
+ *
+ * @brief Unit test for the PrivateIntensityBuffers class.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "Assert.hpp"
+#include "DensitySubGrid.hpp"
+#include "PrivateIntensityBuffers.hpp"
+#include "RandomGenerator.hpp"
+
+#include <cmath>
+#include <omp.h>
+#include <vector>
+
+/*! @brief Number of photon packets used during the test. */
+#define TESTPRIVATEINTENSITYBUFFERS_NPHOTON 20000
+
+/*! @brief Number of threads used during the test. */
+#define TESTPRIVATEINTENSITYBUFFERS_NTHREAD 4
+
+/**
+ * @brief Unit test for the PrivateIntensityBuffers class.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  /// basic block management
+  {
+    PrivateIntensityBuffers buffers(2, 3, 10);
+    const uint_fast32_t block_size =
+        10 * PRIVATEINTENSITYBUFFERS_ACCUMULATOR_SIZE;
+    assert_condition(buffers.get_number_of_blocks() == 0);
+    assert_condition(buffers.get_existing_block(1, 2) == nullptr);
+    double *block = buffers.get_block(1, 2);
+    assert_condition(buffers.get_number_of_blocks() == 1);
+    assert_condition(buffers.get_existing_block(1, 2) == block);
+    assert_condition(buffers.get_existing_block(0, 2) == nullptr);
+    for (uint_fast32_t i = 0; i < block_size; ++i) {
+      assert_condition(block[i] == 0.);
+      block[i] = i;
+    }
+    // asking for the same block again does not allocate a new block
+    assert_condition(buffers.get_block(1, 2) == block);
+    assert_condition(buffers.get_number_of_blocks() == 1);
+    buffers.reset_block(block);
+    for (uint_fast32_t i = 0; i < block_size; ++i) {
+      assert_condition(block[i] == 0.);
+    }
+    assert_condition(buffers.get_memory_size() >=
+                     block_size * sizeof(double));
+
+    // released blocks are freed and reallocated on demand
+    buffers.get_block(0, 0);
+    buffers.reset_block_counters();
+    assert_condition(buffers.get_number_of_used_blocks() == 2);
+    assert_condition(buffers.get_number_of_blocks() == 0);
+    assert_condition(buffers.get_used_memory_size() >=
+                     2 * block_size * sizeof(double));
+    buffers.release_block(1, 2);
+    buffers.release_block(0, 0);
+    assert_condition(buffers.get_existing_block(1, 2) == nullptr);
+    assert_condition(buffers.get_existing_block(0, 0) == nullptr);
+    assert_condition(buffers.get_memory_size() <
+                     block_size * sizeof(double));
+    block = buffers.get_block(1, 2);
+    assert_condition(buffers.get_number_of_blocks() == 1);
+    for (uint_fast32_t i = 0; i < block_size; ++i) {
+      assert_condition(block[i] == 0.);
+    }
+  }
+
+  /// maximum number of blocks per thread
+  {
+    PrivateIntensityBuffers buffers(2, 3, 10, 2);
+    double *block0 = buffers.get_block(0, 0);
+    double *block1 = buffers.get_block(0, 1);
+    assert_condition(block0 != nullptr && block1 != nullptr);
+    assert_condition(buffers.get_block(0, 2) == nullptr);
+    // existing blocks are still accessible
+    assert_condition(buffers.get_block(0, 1) == block1);
+    // the cap is per thread
+    assert_condition(buffers.get_block(1, 2) != nullptr);
+    assert_condition(buffers.get_number_of_blocks() == 3);
+    // once the blocks are released, new blocks can be allocated
+    buffers.reset_block_counters();
+    buffers.release_block(0, 0);
+    buffers.release_block(0, 1);
+    buffers.release_block(1, 2);
+    assert_condition(buffers.get_block(0, 2) != nullptr);
+  }
+
+  /// concurrent traversal of the same subgrid
+  const double box[6] = {-1.543e17, -1.543e17, -1.543e17,
+                         3.086e17,  3.086e17,  3.086e17};
+  const CoordinateVector< int_fast32_t > ncell(16, 16, 16);
+  DensitySubGrid reference_grid(box, ncell);
+  DensitySubGrid grid(box, ncell);
+  for (auto cellit = reference_grid.begin(); cellit != reference_grid.end();
+       ++cellit) {
+    cellit.get_ionization_variables().set_number_density(1.e8);
+    cellit.get_ionization_variables().set_ionic_fraction(ION_H_n, 1.e-4);
+  }
+  for (auto cellit = grid.begin(); cellit != grid.end(); ++cellit) {
+    cellit.get_ionization_variables().set_number_density(1.e8);
+    cellit.get_ionization_variables().set_ionic_fraction(ION_H_n, 1.e-4);
+  }
+  reference_grid.reset_intensities();
+  grid.reset_intensities();
+
+  std::vector< PhotonPacket > photons(TESTPRIVATEINTENSITYBUFFERS_NPHOTON);
+  RandomGenerator random_generator(42);
+  for (uint_fast32_t i = 0; i < TESTPRIVATEINTENSITYBUFFERS_NPHOTON; ++i) {
+    PhotonPacket &photon = photons[i];
+    photon.set_energy(3.288e15);
+    for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+      photon.set_photoionization_cross_section(ion, 0.);
+    }
+    const double cost = 2. * random_generator.get_uniform_random_double() - 1.;
+    const double phi = 2. * M_PI * random_generator.get_uniform_random_double();
+    const double sint = std::sqrt(std::max(1. - cost * cost, 0.));
+    photon.set_position(CoordinateVector<>(0.));
+    photon.set_direction(CoordinateVector<>(sint * std::cos(phi),
+                                            sint * std::sin(phi), cost));
+    photon.set_photoionization_cross_section(ION_H_n, 6.3e-22);
+    photon.set_weight(1.);
+    photon.set_target_optical_depth(
+        -std::log(random_generator.get_uniform_random_double()));
+  }
+
+  for (uint_fast32_t i = 0; i < TESTPRIVATEINTENSITYBUFFERS_NPHOTON; ++i) {
+    PhotonPacket photon(photons[i]);
+    reference_grid.interact(photon, TRAVELDIRECTION_INSIDE, 0.);
+  }
+
+  PrivateIntensityBuffers buffers(TESTPRIVATEINTENSITYBUFFERS_NTHREAD, 1,
+                                  grid.get_number_of_cells());
+  omp_set_num_threads(TESTPRIVATEINTENSITYBUFFERS_NTHREAD);
+#pragma omp parallel for default(shared)
+  for (uint_fast32_t i = 0; i < TESTPRIVATEINTENSITYBUFFERS_NPHOTON; ++i) {
+    double *accumulators = buffers.get_block(omp_get_thread_num(), 0);
+    PhotonPacket photon(photons[i]);
+    grid.interact(photon, TRAVELDIRECTION_INSIDE, 0., accumulators);
+  }
+  for (int_fast32_t ithread = 0; ithread < TESTPRIVATEINTENSITYBUFFERS_NTHREAD;
+       ++ithread) {
+    double *block = buffers.get_existing_block(ithread, 0);
+    if (block != nullptr) {
+      grid.add_intensities(block);
+      buffers.release_block(ithread, 0);
+    }
+  }
+
+  auto reference_it = reference_grid.begin();
+  for (auto cellit = grid.begin(); cellit != grid.end(); ++cellit) {
+    const double reference_value =
+        reference_it.get_ionization_variables().get_mean_intensity(ION_H_n);
+    const double value =
+        cellit.get_ionization_variables().get_mean_intensity(ION_H_n);
+    assert_values_equal_rel(value, reference_value, 1.e-12);
+    assert_values_equal_rel(
+        cellit.get_ionization_variables().get_heating(HEATINGTERM_H),
+        reference_it.get_ionization_variables().get_heating(HEATINGTERM_H),
+        1.e-12);
+    ++reference_it;
+  }
+
+  return 0;
+}
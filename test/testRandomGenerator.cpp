@@ -24,7 +24,105 @@
  * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
  */
 #include "Assert.hpp"
+#include "PhiloxRandomGenerator.hpp"
 #include "RandomGenerator.hpp"
+#include "RanluxRandomGenerator.hpp"
+#include "Xoshiro256PlusPlusRandomGenerator.hpp"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Test the given random number generator algorithm.
+ *
+ * @param name Name of the algorithm.
+ */
+template < typename _generator_ > void test_algorithm(const std::string name) {
+
+  cmac_status("Testing %s...", name.c_str());
+
+  /// Basic test
+  {
+    _generator_ generator(42);
+
+    double mean_random = 0.;
+    uint_fast32_t num = 1000000;
+    double weight = 1. / num;
+    for (uint_fast32_t i = 0; i < num; ++i) {
+      const double x = generator.get_uniform_random_double();
+      assert_condition(x >= 0. && x < 1.);
+      mean_random += weight * x;
+    }
+    assert_values_equal_tol(mean_random, 0.5, 1.e-3);
+  }
+
+  /// Seed test: generators with consecutive seeds (like the per thread
+  /// generators) should produce uncorrelated streams
+  {
+    _generator_ generator_A(42);
+    _generator_ generator_B(43);
+
+    const uint_fast32_t num = 1000000;
+    double sumA = 0.;
+    double sumB = 0.;
+    double sumAB = 0.;
+    for (uint_fast32_t i = 0; i < num; ++i) {
+      const double xA = generator_A.get_uniform_random_double() - 0.5;
+      const double xB = generator_B.get_uniform_random_double() - 0.5;
+      sumA += xA;
+      sumB += xB;
+      sumAB += xA * xB;
+    }
+    // the correlation coefficient has a standard deviation of 1/sqrt(num)
+    const double correlation =
+        12. * (sumAB / num - sumA * sumB / (1. * num * num));
+    assert_condition(std::abs(correlation) < 5. / std::sqrt(1. * num));
+  }
+
+  /// Batch test: fill_uniform() should produce the same sequence as
+  /// successive single draws, irrespective of the batch sizes
+  {
+    _generator_ generator_A(42);
+    _generator_ generator_B(42);
+
+    std::vector< double > values(1000);
+    for (uint_fast32_t batch_size = 1; batch_size < 1000; batch_size += 37) {
+      generator_B.fill_uniform(values.data(), batch_size);
+      for (uint_fast32_t i = 0; i < batch_size; ++i) {
+        assert_condition(values[i] == generator_A.get_uniform_random_double());
+      }
+      // also check that odd numbers of single draws are handled correctly
+      generator_A.get_uniform_random_double();
+      generator_B.get_uniform_random_double();
+    }
+  }
+
+  /// restart test
+  {
+    _generator_ generator_A(42);
+
+    double sum = 0.;
+    for (uint_fast32_t i = 0; i < 1e6 + 1; ++i) {
+      sum += generator_A.get_uniform_random_double();
+    }
+
+    {
+      RestartWriter restart_writer("randomgenerator.dump");
+      generator_A.write_restart_file(restart_writer);
+    }
+
+    {
+      RestartReader restart_reader("randomgenerator.dump");
+      _generator_ generator_B(restart_reader);
+
+      for (uint_fast32_t i = 0; i < 1e3; ++i) {
+        assert_condition(generator_A.get_uniform_random_double() ==
+                         generator_B.get_uniform_random_double());
+      }
+    }
+  }
+}
 
 /**
  * @brief Unit test for the RandomGenerator.
@@ -35,6 +133,28 @@
  */
 int main(int argc, char **argv) {
 
+  /// Philox4x32-10 known answer tests (Random123 kat_vectors)
+  {
+    uint32_t counter[4] = {0, 0, 0, 0};
+    PhiloxRandomGenerator::philox4x32_10(counter, 0);
+    assert_condition(counter[0] == 0x6627e8d5u);
+    assert_condition(counter[1] == 0xe169c58du);
+    assert_condition(counter[2] == 0xbc57ac4cu);
+    assert_condition(counter[3] == 0x9b00dbd8u);
+  }
+  {
+    uint32_t counter[4] = {0x243f6a88u, 0x85a308d3u, 0x13198a2eu, 0x03707344u};
+    PhiloxRandomGenerator::philox4x32_10(counter, 0x299f31d0a4093822ull);
+    assert_condition(counter[0] == 0xd16cfe09u);
+    assert_condition(counter[1] == 0x94fdccebu);
+    assert_condition(counter[2] == 0x5001e420u);
+    assert_condition(counter[3] == 0x24126ea1u);
+  }
+
+  test_algorithm< RanluxRandomGenerator >("ranlxs2");
+  test_algorithm< Xoshiro256PlusPlusRandomGenerator >("xoshiro256++");
+  test_algorithm< PhiloxRandomGenerator >("Philox4x32-10");
+
   /// Basic test
   {
     RandomGenerator generator(42);
@@ -83,5 +203,33 @@ int main(int argc, char **argv) {
     }
   }
 
+  /// backwards compatibility: restart files written by the original ranlxs2
+  /// generator (without algorithm tag) can still be read by the default
+  /// RandomGenerator, and are refused by the other algorithms
+  {
+    RanluxRandomGenerator generator_A(42);
+    for (uint_fast32_t i = 0; i < 1e3; ++i) {
+      generator_A.get_uniform_random_double();
+    }
+
+    {
+      RestartWriter restart_writer("randomgenerator_untagged.dump");
+      generator_A.write_restart_file(restart_writer);
+    }
+
+#if !defined(USE_PHILOX_RANDOM_GENERATOR) &&                                   \
+    !defined(USE_XOSHIRO_RANDOM_GENERATOR)
+    {
+      RestartReader restart_reader("randomgenerator_untagged.dump");
+      RandomGenerator generator_B(restart_reader);
+
+      for (uint_fast32_t i = 0; i < 1e3; ++i) {
+        assert_condition(generator_A.get_uniform_random_double() ==
+                         generator_B.get_uniform_random_double());
+      }
+    }
+#endif
+  }
+
   return 0;
 }
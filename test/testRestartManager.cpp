@@ -31,6 +31,9 @@
 #include "RestartManager.hpp"
 #include "Timer.hpp"
 
+#include <fstream>
+#include <vector>
+
 /**
  * @brief Unit test for RestartManager.
  *
@@ -149,5 +152,98 @@ int main(int argc, char **argv) {
     delete reader;
   }
 
+  /// part 3: binary checkpoint file
+  {
+    std::vector< double > doubles(10000);
+    for (size_t i = 0; i < doubles.size(); ++i) {
+      doubles[i] = 0.5 * i;
+    }
+    // odd size to test the remainder of the checksum
+    std::vector< char > chars(37);
+    for (size_t i = 0; i < chars.size(); ++i) {
+      chars[i] = 'a' + (i % 26);
+    }
+    {
+      CheckpointWriter writer("test_checkpoint.grid");
+      assert_condition(writer.add_block(doubles.data(), doubles.size(),
+                                        sizeof(double)) == 0);
+      assert_condition(writer.add_block(chars.data(), chars.size(), 1) == 1);
+      const size_t file_size = writer.write();
+      assert_condition(file_size % CHECKPOINTFORMAT_ALIGNMENT == 0);
+    }
+    {
+      CheckpointReader reader("test_checkpoint.grid");
+      assert_condition(reader.get_number_of_blocks() == 2);
+      assert_condition(reader.verify_block(0));
+      assert_condition(reader.verify_block(1));
+      std::vector< double > doubles2(doubles.size());
+      reader.read_block(0, doubles2.data(), doubles2.size());
+      for (size_t i = 0; i < doubles.size(); ++i) {
+        assert_condition(doubles2[i] == doubles[i]);
+      }
+      std::vector< char > chars2(chars.size());
+      reader.read_block(1, chars2.data(), chars2.size());
+      for (size_t i = 0; i < chars.size(); ++i) {
+        assert_condition(chars2[i] == chars[i]);
+      }
+    }
+
+    // corrupt a single byte in the first block and make sure this is
+    // detected
+    {
+      std::fstream file("test_checkpoint.grid",
+                        std::ios::binary | std::ios::in | std::ios::out);
+      file.seekp(CHECKPOINTFORMAT_ALIGNMENT + 1234);
+      file.put(42);
+    }
+    {
+      CheckpointReader reader("test_checkpoint.grid");
+      assert_condition(!reader.verify_block(0));
+      assert_condition(reader.verify_block(1));
+    }
+  }
+
+  /// part 4: checkpoint tag and backups without checkpoint file
+  {
+    RestartManager checkpoint_manager(".", 0., 1, 3600., "", true);
+    assert_condition(checkpoint_manager.use_binary_checkpoint());
+
+    // the first restart file has no checkpoint tag, the second one has
+    {
+      RestartWriter *writer = checkpoint_manager.get_restart_writer();
+      Box<> box(0., 1.);
+      box.write_restart_file(*writer);
+      delete writer;
+    }
+    {
+      // backing up a restart file without checkpoint file is not an error
+      RestartWriter *writer = checkpoint_manager.get_restart_writer();
+      const uint64_t checkpoint_tag = RESTARTMANAGER_CHECKPOINT_TAG;
+      writer->write(checkpoint_tag);
+      Box<> box(0., 1.);
+      box.write_restart_file(*writer);
+      delete writer;
+    }
+
+    {
+      RestartReader reader("restart.0.back");
+      assert_condition(reader.peek< uint64_t >() !=
+                       RESTARTMANAGER_CHECKPOINT_TAG);
+      Box<> box(reader);
+      assert_condition(box.get_anchor().x() == 0.);
+      assert_condition(box.get_sides().x() == 1.);
+    }
+    {
+      RestartReader *reader = checkpoint_manager.get_restart_reader();
+      assert_condition(reader->peek< uint64_t >() ==
+                       RESTARTMANAGER_CHECKPOINT_TAG);
+      reader->read< uint64_t >();
+      Box<> box(*reader);
+      assert_condition(box.get_anchor().x() == 0.);
+      assert_condition(box.get_sides().x() == 1.);
+      delete reader;
+    }
+  }
+
   return 0;
 }
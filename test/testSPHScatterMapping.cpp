@@ -0,0 +1,183 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file testSPHScatterMapping.cpp
+ *
+ * @brief Unit test for the SPHScatterMapping class.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "Assert.hpp"
+#include "HomogeneousDensityFunction.hpp"
+#include "RandomGenerator.hpp"
+#include "SPHScatterMapping.hpp"
+
+#include <vector>
+
+/**
+ * @brief Get the total mass on the given grid.
+ *
+ * @param grid_creator Grid.
+ * @return Total mass in all cells of the grid (in kg).
+ */
+static double
+get_total_mass(DensitySubGridCreator< DensitySubGrid > &grid_creator) {
+  double total_mass = 0.;
+  for (auto gridit = grid_creator.begin();
+       gridit != grid_creator.original_end(); ++gridit) {
+    for (auto cellit = (*gridit).begin(); cellit != (*gridit).end();
+         ++cellit) {
+      total_mass += cellit.get_ionization_variables().get_number_density() *
+                    cellit.get_volume() * 1.6737236e-27;
+    }
+  }
+  return total_mass;
+}
+
+/**
+ * @brief Unit test for the SPHScatterMapping class.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  const Box<> box(CoordinateVector<>(0.), CoordinateVector<>(1.));
+  const CoordinateVector< int_fast32_t > ncell(32, 32, 32);
+  const CoordinateVector< int_fast32_t > nsubgrid(4, 4, 4);
+  // zero background density, so that all mass on the grid was deposited
+  HomogeneousDensityFunction density_function(0., 8000.);
+
+  // set up particles that are completely inside the box, with a few particles
+  // that are larger than a subgrid
+  const size_t numpart = 1000;
+  RandomGenerator random_generator(42);
+  std::vector< CoordinateVector<> > positions(numpart);
+  std::vector< double > masses(numpart);
+  std::vector< double > smoothing_lengths(numpart);
+  std::vector< double > temperatures(numpart, 5000.);
+  double total_mass = 0.;
+  for (size_t i = 0; i < numpart; ++i) {
+    positions[i][0] = 0.35 + 0.3 * random_generator.get_uniform_random_double();
+    positions[i][1] = 0.35 + 0.3 * random_generator.get_uniform_random_double();
+    positions[i][2] = 0.35 + 0.3 * random_generator.get_uniform_random_double();
+    masses[i] = 1. + random_generator.get_uniform_random_double();
+    if (i % 100 == 0) {
+      smoothing_lengths[i] = 0.15;
+    } else {
+      smoothing_lengths[i] =
+          0.005 + 0.05 * random_generator.get_uniform_random_double();
+    }
+    total_mass += masses[i];
+  }
+
+  // smoothing lengths are half the kernel support
+  SPHScatterMapping mapping(positions, masses, smoothing_lengths, 1.,
+                            &temperatures);
+
+  /// kernel fractions
+  {
+    DensitySubGridCreator< DensitySubGrid > grid_creator(
+        box, ncell, nsubgrid, CoordinateVector< bool >(false));
+
+    for (size_t i = 0; i < numpart; i += 97) {
+      const auto fractions = mapping.get_kernel_fractions(i, grid_creator);
+      assert_condition(fractions.size() > 0);
+      double fraction_sum = 0.;
+      for (size_t j = 0; j < fractions.size(); ++j) {
+        fraction_sum += std::get< 2 >(fractions[j]);
+      }
+      assert_values_equal_rel(fraction_sum, 1., 1.e-12);
+    }
+
+    // a particle with a kernel that is completely contained inside a single
+    // cell deposits all its mass in that cell
+    std::vector< CoordinateVector<> > single_position(
+        1, CoordinateVector<>(0.5 + 0.5 / 32.));
+    std::vector< double > single_mass(1, 1.);
+    std::vector< double > single_smoothing_length(1, 0.1 / 32.);
+    SPHScatterMapping single_mapping(single_position, single_mass,
+                                     single_smoothing_length, 1.);
+    const auto fractions =
+        single_mapping.get_kernel_fractions(0, grid_creator);
+    assert_condition(fractions.size() == 1);
+    assert_condition(std::get< 2 >(fractions[0]) == 1.);
+  }
+
+  /// non-periodic deposition
+  {
+    DensitySubGridCreator< DensitySubGrid > grid_creator(
+        box, ncell, nsubgrid, CoordinateVector< bool >(false));
+    grid_creator.initialize(density_function);
+    mapping.deposit(grid_creator);
+
+    assert_values_equal_rel(get_total_mass(grid_creator), total_mass, 1.e-10);
+
+    for (auto gridit = grid_creator.begin();
+         gridit != grid_creator.original_end(); ++gridit) {
+      for (auto cellit = (*gridit).begin(); cellit != (*gridit).end();
+           ++cellit) {
+        const IonizationVariables &ionization_variables =
+            cellit.get_ionization_variables();
+        if (ionization_variables.get_number_density() > 0.) {
+          assert_values_equal_rel(ionization_variables.get_temperature(),
+                                  5000., 1.e-10);
+        } else {
+          assert_condition(ionization_variables.get_temperature() == 8000.);
+        }
+      }
+    }
+  }
+
+  /// periodic deposition: move the particles close to the box boundaries, so
+  /// that their kernels wrap around
+  {
+    for (size_t i = 0; i < numpart; ++i) {
+      for (uint_fast8_t j = 0; j < 3; ++j) {
+        positions[i][j] -= 0.5;
+        if (positions[i][j] < 0.) {
+          positions[i][j] += 1.;
+        }
+      }
+    }
+
+    DensitySubGridCreator< DensitySubGrid > grid_creator(
+        box, ncell, nsubgrid, CoordinateVector< bool >(true));
+    grid_creator.initialize(density_function);
+    mapping.deposit(grid_creator);
+
+    assert_values_equal_rel(get_total_mass(grid_creator), total_mass, 1.e-10);
+  }
+
+  /// periodic deposition on a grid with a number of subgrids that is not a
+  /// multiple of 3
+  {
+    DensitySubGridCreator< DensitySubGrid > grid_creator(
+        box, CoordinateVector< int_fast32_t >(40, 32, 20),
+        CoordinateVector< int_fast32_t >(5, 4, 2),
+        CoordinateVector< bool >(true));
+    grid_creator.initialize(density_function);
+    mapping.deposit(grid_creator);
+
+    assert_values_equal_rel(get_total_mass(grid_creator), total_mass, 1.e-10);
+  }
+
+  return 0;
+}
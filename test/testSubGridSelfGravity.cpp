@@ -0,0 +1,107 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file testSubGridSelfGravity.cpp
+ *
+ * @brief Unit test for compute_self_gravity().
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "Assert.hpp"
+#include "HomogeneousDensityFunction.hpp"
+#include "LinearOctreeGravity.hpp"
+#include "RandomGenerator.hpp"
+#include "SubGridSelfGravity.hpp"
+
+#include <vector>
+
+/**
+ * @brief Unit test for compute_self_gravity().
+ *
+ * We check that the gravitational potential stored in every cell follows the
+ * convention of the original Barnes-Hut tree (half the cell mass times the
+ * potential, computed with G = 6.6743e-11 m^3 kg^-1 s^-2), so that the sum
+ * over all cells is the total potential energy used in the sink formation
+ * criterion.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  const Box<> box(CoordinateVector<>(0.), CoordinateVector<>(1.));
+  DensitySubGridCreator< HydroDensitySubGrid > grid_creator(
+      box, CoordinateVector< int_fast32_t >(4),
+      CoordinateVector< int_fast32_t >(2), CoordinateVector< bool >(false));
+  HomogeneousDensityFunction density_function;
+  grid_creator.initialize(density_function);
+
+  RandomGenerator random_generator(42);
+  std::vector< CoordinateVector<> > positions;
+  std::vector< double > masses;
+  for (auto gridit = grid_creator.begin();
+       gridit != grid_creator.original_end(); ++gridit) {
+    for (auto it = (*gridit).hydro_begin(); it != (*gridit).hydro_end();
+         ++it) {
+      const double mass = 1. + random_generator.get_uniform_random_double();
+      it.get_hydro_variables().set_conserved_mass(mass);
+      positions.push_back(it.get_cell_midpoint());
+      masses.push_back(mass);
+    }
+  }
+
+  // an opening angle of zero means that the tree walk reduces to a direct
+  // summation
+  LinearOctreeGravity solver(box, 0., 1, 6.6743e-11);
+  compute_self_gravity(grid_creator, solver, false, true);
+
+  const double G = 6.6743e-11;
+  double total_potential_energy = 0.;
+  for (size_t i = 0; i < positions.size(); ++i) {
+    for (size_t j = i + 1; j < positions.size(); ++j) {
+      total_potential_energy -=
+          G * masses[i] * masses[j] / (positions[i] - positions[j]).norm();
+    }
+  }
+
+  size_t index = 0;
+  double total_potential = 0.;
+  for (auto gridit = grid_creator.begin();
+       gridit != grid_creator.original_end(); ++gridit) {
+    for (auto it = (*gridit).hydro_begin(); it != (*gridit).hydro_end();
+         ++it) {
+      double potential = 0.;
+      for (size_t j = 0; j < positions.size(); ++j) {
+        if (j != index) {
+          potential -= G * masses[j] / (positions[index] - positions[j]).norm();
+        }
+      }
+      const double cell_potential =
+          it.get_hydro_variables().get_gravitational_potential();
+      assert_values_equal_rel(cell_potential,
+                              0.5 * masses[index] * potential, 1.e-12);
+      total_potential += cell_potential;
+      ++index;
+    }
+  }
+  assert_values_equal_rel(total_potential, total_potential_energy, 1.e-12);
+
+  return 0;
+}
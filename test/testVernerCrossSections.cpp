@@ -26,6 +26,8 @@
 #include "Assert.hpp"
 #include "ElementNames.hpp"
 #include "Error.hpp"
+#include "RandomGenerator.hpp"
+#include "TabulatedCrossSections.hpp"
 #include "UnitConverter.hpp"
 #include "VernerCrossSections.hpp"
 #include <fstream>
@@ -35,6 +37,9 @@
 /**
  * @brief Unit test for the VernerCrossSections class.
  *
+ * We also test the TabulatedCrossSections class by comparing the interpolated
+ * Verner cross sections with the exact values.
+ *
  * @param argc Number of command line arguments.
  * @param argv Command line arguments.
  * @return Exit code: 0 on success.
@@ -166,5 +171,46 @@ int main(int argc, char **argv) {
     }
   }
 
+  /// tabulated cross sections
+  {
+    const double minimum_frequency =
+        UnitConverter::to_SI< QUANTITY_FREQUENCY >(13.6, "eV");
+    const double maximum_frequency =
+        UnitConverter::to_SI< QUANTITY_FREQUENCY >(100., "eV");
+    const double tolerance = 1.e-4;
+    TabulatedCrossSections tabulated_cross_sections(
+        new VernerCrossSections(), minimum_frequency, maximum_frequency, 4096,
+        tolerance);
+
+    cmac_status("%" PRIuFAST32 " bins require an exact evaluation.",
+                tabulated_cross_sections.get_number_of_exact_bins());
+    assert_condition(tabulated_cross_sections.get_number_of_exact_bins() <
+                     4096 / 10);
+
+    // we also sample frequencies outside the tabulated range
+    RandomGenerator random_generator(42);
+    double tabulated[NUMBER_OF_IONNAMES];
+    double exact[NUMBER_OF_IONNAMES];
+    for (uint_fast32_t i = 0; i < 100000; ++i) {
+      const double e =
+          minimum_frequency *
+          (0.9 + 1.2 * random_generator.get_uniform_random_double() *
+                     maximum_frequency / minimum_frequency);
+      double tabulated_dust_opacity, exact_dust_opacity;
+      tabulated_cross_sections.get_cross_sections(e, tabulated,
+                                                  tabulated_dust_opacity);
+      cross_sections.get_cross_sections(e, exact, exact_dust_opacity);
+      for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+        assert_values_equal_rel(exact[ion], tabulated[ion], tolerance);
+        assert_condition(tabulated[ion] ==
+                         tabulated_cross_sections.get_cross_section(ion, e));
+      }
+      assert_values_equal_rel(exact_dust_opacity, tabulated_dust_opacity,
+                              tolerance);
+      assert_condition(tabulated_dust_opacity ==
+                       tabulated_cross_sections.get_dust_opacity(e));
+    }
+  }
+
   return 0;
 }
@@ -24,6 +24,7 @@
  * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
  */
 #include "Assert.hpp"
+#include "TabulatedRecombinationRates.hpp"
 #include "UnitConverter.hpp"
 #include "VernerRecombinationRates.hpp"
 #include <fstream>
@@ -40,6 +41,8 @@
 int main(int argc, char **argv) {
 
   VernerRecombinationRates recombination_rates;
+  TabulatedRecombinationRates tabulated_rates(new VernerRecombinationRates(),
+                                              1000., 1.e5, 400, 1.e-4);
 
   std::ifstream file("verner_rec_testdata.txt");
   std::string line;
@@ -146,6 +149,15 @@ int main(int argc, char **argv) {
               "cm^3s^-1"),
           alphaSp3, tolerance);
 #endif
+
+      // the tabulated rates agree with the exact rates up to roughly the
+      // table tolerance (the error is only checked at a few points per bin),
+      // and are exact outside the table range
+      for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+        assert_values_equal_rel(
+            tabulated_rates.get_recombination_rate(ion, T),
+            recombination_rates.get_recombination_rate(ion, T), 2.e-4);
+      }
     }
   }
 
@@ -0,0 +1,216 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file testWorkStealingTaskQueue.cpp
+ *
+ * @brief Unit test for the WorkStealingTaskQueue class.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+
+/*! @brief Number of tasks used during the test. */
+#define TESTWORKSTEALINGTASKQUEUE_NTASK 10000
+
+/*! @brief Number of dependencies shared by the tasks. */
+#define TESTWORKSTEALINGTASKQUEUE_NLOCK 8
+
+/*! @brief Number of threads used during the test. */
+#define TESTWORKSTEALINGTASKQUEUE_NTHREAD 4
+
+#include "Assert.hpp"
+#include "Scheduler.hpp"
+#include "ThreadSafeVector.hpp"
+#include "WorkStealingTaskQueue.hpp"
+
+#include <cmath>
+#include <omp.h>
+
+/**
+ * @brief Unit test for the WorkStealingTaskQueue class.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  /// basic single thread deque and inbox behaviour
+  {
+    ThreadSafeVector< Task > tasks(10);
+    // the serial region counts as thread 0, so adding to a queue owned by
+    // thread 0 uses the deque, while adding to a queue owned by thread 1
+    // uses the inbox
+    WorkStealingTaskQueue queue0(10, "queue 0", 0);
+    WorkStealingTaskQueue queue1(10, "queue 1", 1);
+    for (uint_fast32_t i = 0; i < 4; ++i) {
+      const size_t itask = tasks.get_free_element();
+      queue0.add_task(itask);
+      queue1.add_task(itask);
+    }
+    assert_condition(queue0.size() == 4);
+    assert_condition(queue1.size() == 4);
+
+    // the owner gets the newest task first
+    assert_condition(queue0.get_task(tasks) == 3);
+    // thieves get the oldest task first
+    assert_condition(queue0.try_get_task(tasks) == 0);
+    // the inbox is first in first out
+    assert_condition(queue1.get_task(tasks) == 0);
+    assert_condition(queue1.get_task(tasks) == 1);
+    assert_condition(queue0.size() == 2);
+    assert_condition(queue1.size() == 2);
+
+    // tasks with a locked dependency are deferred until the lock is released
+    ThreadLock lock;
+    lock.lock();
+    tasks[1].set_dependency(&lock);
+    tasks[2].set_dependency(&lock);
+    assert_condition(queue0.get_task(tasks) == NO_TASK);
+    assert_condition(queue0.size() == 2);
+    lock.unlock();
+    const size_t itask = queue0.get_task(tasks);
+    assert_condition(itask == 1 || itask == 2);
+    assert_condition(queue0.get_task(tasks) == NO_TASK);
+    tasks[itask].unlock_dependency();
+    assert_condition(queue0.get_task(tasks) == 3 - itask);
+    assert_condition(queue0.size() == 0);
+  }
+
+  /// a queue with a full deque and a full inbox can defer all of its tasks
+  {
+    ThreadSafeVector< Task > tasks(32);
+    ThreadLock lock;
+    lock.lock();
+    WorkStealingTaskQueue queue(16, "full queue", 0);
+    for (uint_fast32_t i = 0; i < 32; ++i) {
+      const size_t itask = tasks.get_free_element();
+      tasks[itask].set_dependency(&lock);
+      if (i < 16) {
+        queue.add_task(itask);
+      }
+    }
+    // tasks added by another thread end up in the inbox
+#pragma omp parallel num_threads(2)
+    {
+      if (omp_get_thread_num() == 1) {
+        for (uint_fast32_t i = 16; i < 32; ++i) {
+          queue.add_task(i);
+        }
+      }
+    }
+    assert_condition(queue.size() == 32);
+
+    // all dependencies are locked, so all tasks are deferred
+    assert_condition(queue.get_task(tasks) == NO_TASK);
+    assert_condition(queue.size() == 32);
+
+    lock.unlock();
+    for (uint_fast32_t i = 0; i < 32; ++i) {
+      const size_t itask = queue.get_task(tasks);
+      assert_condition(itask != NO_TASK);
+      tasks[itask].unlock_dependency();
+    }
+    assert_condition(queue.get_task(tasks) == NO_TASK);
+    assert_condition(queue.size() == 0);
+  }
+
+  /// multi-threaded execution with stealing and dependencies
+  omp_set_num_threads(TESTWORKSTEALINGTASKQUEUE_NTHREAD);
+
+  // each task will do a lot of random computations (result stored in the
+  // task subgrid variable to make sure it is not optimised out) and will set
+  // the corresponding flag in the array to true to mark it as done
+  // the first half of the tasks is added before the parallel region starts,
+  // the second half is added by the threads that execute the first half, so
+  // that we test both the deque and the inbox
+  bool flags[TESTWORKSTEALINGTASKQUEUE_NTASK];
+  ThreadSafeVector< Task > tasks(TESTWORKSTEALINGTASKQUEUE_NTASK);
+  std::vector< ThreadLock > locks(TESTWORKSTEALINGTASKQUEUE_NLOCK);
+  std::vector< AtomicValue< uint_fast32_t > > lock_users(
+      TESTWORKSTEALINGTASKQUEUE_NLOCK);
+  std::vector< WorkStealingTaskQueue * > queues(
+      TESTWORKSTEALINGTASKQUEUE_NTHREAD);
+  for (uint_fast32_t i = 0; i < TESTWORKSTEALINGTASKQUEUE_NTHREAD; ++i) {
+    queues[i] =
+        new WorkStealingTaskQueue(TESTWORKSTEALINGTASKQUEUE_NTASK, "", i);
+  }
+  for (uint_fast32_t i = 0; i < TESTWORKSTEALINGTASKQUEUE_NTASK; ++i) {
+    flags[i] = false;
+    const size_t itask = tasks.get_free_element();
+    Task &task = tasks[itask];
+    task.set_type(i % TASKTYPE_NUMBER);
+    task.set_buffer(i);
+    task.set_dependency(&locks[i % TESTWORKSTEALINGTASKQUEUE_NLOCK]);
+    if (i < TESTWORKSTEALINGTASKQUEUE_NTASK / 2) {
+      queues[i % TESTWORKSTEALINGTASKQUEUE_NTHREAD]->add_task(itask);
+    }
+  }
+
+  AtomicValue< uint_fast32_t > number_done(0);
+#pragma omp parallel default(shared)
+  {
+    const int_fast32_t this_thread = omp_get_thread_num();
+    while (number_done.value() < TESTWORKSTEALINGTASKQUEUE_NTASK) {
+      size_t itask = queues[this_thread]->get_task(tasks);
+      if (itask == NO_TASK) {
+        itask = Scheduler::steal_task(this_thread, queues, tasks);
+      }
+      if (itask != NO_TASK) {
+        Task &task = tasks[itask];
+        task.start(this_thread);
+        // make sure no other thread is executing a task with the same
+        // dependency
+        const size_t ilock =
+            task.get_buffer() % TESTWORKSTEALINGTASKQUEUE_NLOCK;
+        assert_condition(lock_users[ilock].pre_increment() == 1);
+        size_t value = 0;
+        for (uint_fast32_t i = 0; i < 1000; ++i) {
+          value += 10 * std::cos(0.002 * M_PI * i);
+        }
+        task.set_subgrid(value);
+        assert_condition(!task.done());
+        const size_t buffer = task.get_buffer();
+        assert_condition(flags[buffer] == false);
+        flags[buffer] = true;
+        lock_users[ilock].pre_decrement();
+        task.stop();
+        task.unlock_dependency();
+        if (buffer < TESTWORKSTEALINGTASKQUEUE_NTASK / 2) {
+          queues[buffer % TESTWORKSTEALINGTASKQUEUE_NTHREAD]->add_task(
+              buffer + TESTWORKSTEALINGTASKQUEUE_NTASK / 2);
+        }
+        number_done.pre_increment();
+      }
+    }
+  }
+
+  // now check:
+  //  - that the queues are empty
+  for (uint_fast32_t i = 0; i < TESTWORKSTEALINGTASKQUEUE_NTHREAD; ++i) {
+    assert_condition(queues[i]->size() == 0);
+    delete queues[i];
+  }
+  //  - that all tasks were executed
+  for (uint_fast32_t i = 0; i < TESTWORKSTEALINGTASKQUEUE_NTASK; ++i) {
+    assert_condition(tasks[i].done());
+    assert_condition(flags[i]);
+  }
+
+  return 0;
+}
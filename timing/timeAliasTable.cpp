@@ -0,0 +1,237 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file timeAliasTable.cpp
+ *
+ * @brief Timing test that compares frequency sampling using a binary search in
+ * the cumulative distribution with sampling using alias tables.
+ *
+ * The test draws a large number of photon packet frequencies from a tabulated
+ * spectrum with the same resolution as the tabulated PhotonSourceSpectrum
+ * implementations, both for a single spectrum (source emission) and for a
+ * temperature dependent spectrum (reemission).
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "AliasTable.hpp"
+#include "RandomGenerator.hpp"
+#include "TimingTools.hpp"
+#include "Utilities.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/*! @brief Number of frequency nodes in the tabulated spectra. */
+#define TIMEALIASTABLE_NUMBER_OF_FREQUENCIES 1000
+
+/*! @brief Number of temperature bins in the reemission spectra. */
+#define TIMEALIASTABLE_NUMBER_OF_TEMPERATURES 100
+
+/*! @brief Number of photon packet frequencies drawn in every test. */
+#define TIMEALIASTABLE_NUMBER_OF_PACKETS 10000000
+
+/*! @brief Size of a photon batch for the batched sampling test. */
+#define TIMEALIASTABLE_BATCH_SIZE 200
+
+/**
+ * @brief Fill the given cumulative distribution with a black body like
+ * spectrum at the given temperature.
+ *
+ * @param frequencies Frequency nodes (in 13.6 eV).
+ * @param temperature Temperature (in K).
+ * @param cumulative_distribution Cumulative distribution to fill.
+ */
+inline void make_spectrum(const std::vector< double > &frequencies,
+                          const double temperature,
+                          std::vector< double > &cumulative_distribution) {
+  cumulative_distribution[0] = 0.;
+  for (uint_fast32_t i = 1; i < frequencies.size(); ++i) {
+    const double nu = 0.5 * (frequencies[i - 1] + frequencies[i]);
+    cumulative_distribution[i] =
+        cumulative_distribution[i - 1] +
+        nu * nu * std::exp(-157919.667 * (nu - 1.) / temperature) *
+            (frequencies[i] - frequencies[i - 1]);
+  }
+  for (uint_fast32_t i = 0; i < frequencies.size(); ++i) {
+    cumulative_distribution[i] /= cumulative_distribution.back();
+  }
+}
+
+/**
+ * @brief Timing test that compares frequency sampling using a binary search in
+ * the cumulative distribution with sampling using alias tables.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  timingtools_init("timeAliasTable", argc, argv);
+
+  std::vector< double > frequencies(TIMEALIASTABLE_NUMBER_OF_FREQUENCIES);
+  for (uint_fast32_t i = 0; i < TIMEALIASTABLE_NUMBER_OF_FREQUENCIES; ++i) {
+    frequencies[i] = 1. + 3. * i / (TIMEALIASTABLE_NUMBER_OF_FREQUENCIES - 1.);
+  }
+  std::vector< double > temperatures(TIMEALIASTABLE_NUMBER_OF_TEMPERATURES);
+  std::vector< std::vector< double > > cumulative_distributions(
+      TIMEALIASTABLE_NUMBER_OF_TEMPERATURES,
+      std::vector< double >(TIMEALIASTABLE_NUMBER_OF_FREQUENCIES));
+  std::vector< AliasTable > alias_tables(TIMEALIASTABLE_NUMBER_OF_TEMPERATURES);
+  for (uint_fast32_t iT = 0; iT < TIMEALIASTABLE_NUMBER_OF_TEMPERATURES; ++iT) {
+    temperatures[iT] =
+        1500. + (iT + 0.5) * 13500. / TIMEALIASTABLE_NUMBER_OF_TEMPERATURES;
+    make_spectrum(frequencies, temperatures[iT], cumulative_distributions[iT]);
+    alias_tables[iT].initialize(cumulative_distributions[iT].data(),
+                                TIMEALIASTABLE_NUMBER_OF_FREQUENCIES);
+  }
+  const std::vector< double > &cumulative_distribution =
+      cumulative_distributions[TIMEALIASTABLE_NUMBER_OF_TEMPERATURES / 2];
+  const AliasTable &alias_table =
+      alias_tables[TIMEALIASTABLE_NUMBER_OF_TEMPERATURES / 2];
+
+  timingtools_print_header("Source emission (%i packets, %i frequencies).",
+                           TIMEALIASTABLE_NUMBER_OF_PACKETS,
+                           TIMEALIASTABLE_NUMBER_OF_FREQUENCIES);
+
+  double checksum = 0.;
+  timingtools_start_timing_block("binary search") {
+    RandomGenerator random_generator(42);
+    timingtools_start_timing();
+    for (uint_fast32_t i = 0; i < TIMEALIASTABLE_NUMBER_OF_PACKETS; ++i) {
+      const double x = random_generator.get_uniform_random_double();
+      const uint_fast32_t inu =
+          Utilities::locate(x, cumulative_distribution.data(),
+                            TIMEALIASTABLE_NUMBER_OF_FREQUENCIES);
+      checksum += frequencies[inu] +
+                  (frequencies[inu + 1] - frequencies[inu]) *
+                      (x - cumulative_distribution[inu]) /
+                      (cumulative_distribution[inu + 1] -
+                       cumulative_distribution[inu]);
+    }
+    timingtools_stop_timing();
+  }
+  timingtools_end_timing_block("binary search");
+  timingtools_print("Average frequency: %g",
+                    checksum / (timingtools_num_sample *
+                                TIMEALIASTABLE_NUMBER_OF_PACKETS));
+
+  checksum = 0.;
+  timingtools_start_timing_block("alias table") {
+    RandomGenerator random_generator(42);
+    timingtools_start_timing();
+    for (uint_fast32_t i = 0; i < TIMEALIASTABLE_NUMBER_OF_PACKETS; ++i) {
+      checksum += alias_table.sample_linear(
+          random_generator.get_uniform_random_double(), frequencies.data());
+    }
+    timingtools_stop_timing();
+  }
+  timingtools_end_timing_block("alias table");
+  timingtools_print("Average frequency: %g",
+                    checksum / (timingtools_num_sample *
+                                TIMEALIASTABLE_NUMBER_OF_PACKETS));
+
+  checksum = 0.;
+  timingtools_start_timing_block("alias table (batched)") {
+    RandomGenerator random_generator(42);
+    double batch[TIMEALIASTABLE_BATCH_SIZE];
+    timingtools_start_timing();
+    for (uint_fast32_t i = 0; i < TIMEALIASTABLE_NUMBER_OF_PACKETS;
+         i += TIMEALIASTABLE_BATCH_SIZE) {
+      for (uint_fast32_t j = 0; j < TIMEALIASTABLE_BATCH_SIZE; ++j) {
+        batch[j] = alias_table.sample_linear(
+            random_generator.get_uniform_random_double(), frequencies.data());
+      }
+      for (uint_fast32_t j = 0; j < TIMEALIASTABLE_BATCH_SIZE; ++j) {
+        checksum += batch[j];
+      }
+    }
+    timingtools_stop_timing();
+  }
+  timingtools_end_timing_block("alias table (batched)");
+  timingtools_print("Average frequency: %g",
+                    checksum / (timingtools_num_sample *
+                                TIMEALIASTABLE_NUMBER_OF_PACKETS));
+
+  timingtools_print_header(
+      "Reemission (%i packets, %i frequencies, %i temperatures).",
+      TIMEALIASTABLE_NUMBER_OF_PACKETS, TIMEALIASTABLE_NUMBER_OF_FREQUENCIES,
+      TIMEALIASTABLE_NUMBER_OF_TEMPERATURES);
+
+  checksum = 0.;
+  timingtools_start_timing_block("binary search") {
+    RandomGenerator random_generator(42);
+    timingtools_start_timing();
+    for (uint_fast32_t i = 0; i < TIMEALIASTABLE_NUMBER_OF_PACKETS; ++i) {
+      const double temperature =
+          2000. + 10000. * random_generator.get_uniform_random_double();
+      const uint_fast32_t iT =
+          Utilities::locate(temperature, temperatures.data(),
+                            TIMEALIASTABLE_NUMBER_OF_TEMPERATURES);
+      const double x = random_generator.get_uniform_random_double();
+      const uint_fast32_t inu1 =
+          Utilities::locate(x, cumulative_distributions[iT].data(),
+                            TIMEALIASTABLE_NUMBER_OF_FREQUENCIES);
+      const uint_fast32_t inu2 =
+          Utilities::locate(x, cumulative_distributions[iT + 1].data(),
+                            TIMEALIASTABLE_NUMBER_OF_FREQUENCIES);
+      checksum += frequencies[inu1] +
+                  (temperature - temperatures[iT]) *
+                      (frequencies[inu2] - frequencies[inu1]) /
+                      (temperatures[iT + 1] - temperatures[iT]);
+    }
+    timingtools_stop_timing();
+  }
+  timingtools_end_timing_block("binary search");
+  timingtools_print("Average frequency: %g",
+                    checksum / (timingtools_num_sample *
+                                TIMEALIASTABLE_NUMBER_OF_PACKETS));
+
+  checksum = 0.;
+  timingtools_start_timing_block("alias table") {
+    RandomGenerator random_generator(42);
+    const double inverse_temperature_step =
+        TIMEALIASTABLE_NUMBER_OF_TEMPERATURES / 13500.;
+    timingtools_start_timing();
+    for (uint_fast32_t i = 0; i < TIMEALIASTABLE_NUMBER_OF_PACKETS; ++i) {
+      const double temperature =
+          2000. + 10000. * random_generator.get_uniform_random_double();
+      double uT = (temperature - temperatures[0]) * inverse_temperature_step;
+      uT = std::max(0.,
+                    std::min(uT, TIMEALIASTABLE_NUMBER_OF_TEMPERATURES - 1.));
+      uint_fast32_t iT = uT;
+      if (iT == TIMEALIASTABLE_NUMBER_OF_TEMPERATURES - 1) {
+        --iT;
+      }
+      if (random_generator.get_uniform_random_double() < uT - iT) {
+        ++iT;
+      }
+      checksum += alias_tables[iT].sample_linear(
+          random_generator.get_uniform_random_double(), frequencies.data());
+    }
+    timingtools_stop_timing();
+  }
+  timingtools_end_timing_block("alias table");
+  timingtools_print("Average frequency: %g",
+                    checksum / (timingtools_num_sample *
+                                TIMEALIASTABLE_NUMBER_OF_PACKETS));
+
+  return 0;
+}
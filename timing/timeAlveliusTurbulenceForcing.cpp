@@ -0,0 +1,123 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file timeAlveliusTurbulenceForcing.cpp
+ *
+ * @brief Timing test for the AlveliusTurbulenceForcing.
+ *
+ * We apply the forcing to a 64^3 grid consisting of 4^3 subgrids, for an
+ * increasing maximum wave number (and hence number of modes), using both the
+ * direct and the separable evaluation.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "AlveliusTurbulenceForcing.hpp"
+#include "TimingTools.hpp"
+
+#include <vector>
+
+/*! @brief Number of subgrids in every dimension. */
+#define TIMEALVELIUSTURBULENCEFORCING_NSUBGRID 4
+
+/*! @brief Number of cells in every dimension of a single subgrid. */
+#define TIMEALVELIUSTURBULENCEFORCING_NCELL 16
+
+/**
+ * @brief Apply the given forcing to all subgrids.
+ *
+ * @param forcing AlveliusTurbulenceForcing to apply.
+ * @param subgrids Subgrids.
+ */
+static void apply_forcing(const AlveliusTurbulenceForcing &forcing,
+                          std::vector< HydroDensitySubGrid * > &subgrids) {
+
+  const size_t number_of_subgrids = subgrids.size();
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+  for (size_t igrid = 0; igrid < number_of_subgrids; ++igrid) {
+    forcing.add_turbulent_forcing(igrid, *subgrids[igrid]);
+  }
+}
+
+/**
+ * @brief Timing test for the AlveliusTurbulenceForcing.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  timingtools_init("timeAlveliusTurbulenceForcing", argc, argv);
+
+  const int_fast32_t nsubgrid = TIMEALVELIUSTURBULENCEFORCING_NSUBGRID;
+  const int_fast32_t ncell = TIMEALVELIUSTURBULENCEFORCING_NCELL;
+  const double subgrid_side = 1. / nsubgrid;
+  std::vector< HydroDensitySubGrid * > subgrids(nsubgrid * nsubgrid * nsubgrid);
+  for (int_fast32_t igrid = 0; igrid < nsubgrid * nsubgrid * nsubgrid;
+       ++igrid) {
+    const int_fast32_t ix = igrid / (nsubgrid * nsubgrid);
+    const int_fast32_t iy = (igrid / nsubgrid) % nsubgrid;
+    const int_fast32_t iz = igrid % nsubgrid;
+    double box[6] = {ix * subgrid_side, iy * subgrid_side, iz * subgrid_side,
+                     subgrid_side,      subgrid_side,      subgrid_side};
+    subgrids[igrid] = new HydroDensitySubGrid(
+        box, CoordinateVector< int_fast32_t >(ncell));
+    for (auto cellit = subgrids[igrid]->hydro_begin();
+         cellit != subgrids[igrid]->hydro_end(); ++cellit) {
+      cellit.get_hydro_variables().conserved(0) = 1.;
+    }
+  }
+
+  const double kmax_values[5] = {2., 3., 4., 6., 8.};
+  for (uint_fast8_t ik = 0; ik < 5; ++ik) {
+    const double kmax = kmax_values[ik];
+    AlveliusTurbulenceForcing direct(nsubgrid, ncell, Box<>(0., 1.), 1., kmax,
+                                     0.5 * kmax, 0.2, 1., 42, 1.e-6, 0.);
+    AlveliusTurbulenceForcing separable(nsubgrid, ncell, Box<>(0., 1.), 1.,
+                                        kmax, 0.5 * kmax, 0.2, 1., 42, 1.e-6,
+                                        0., true);
+    direct.update_turbulence(1.e-6);
+    separable.update_turbulence(1.e-6);
+
+    timingtools_print_header("Maximum wave number %g: %zu modes", kmax,
+                             direct.get_number_of_modes());
+
+    timingtools_start_timing_block("direct evaluation") {
+      timingtools_start_timing();
+      apply_forcing(direct, subgrids);
+      timingtools_stop_timing();
+    }
+    timingtools_end_timing_block("direct evaluation");
+
+    timingtools_start_timing_block("separable evaluation") {
+      timingtools_start_timing();
+      apply_forcing(separable, subgrids);
+      timingtools_stop_timing();
+    }
+    timingtools_end_timing_block("separable evaluation");
+  }
+
+  for (size_t igrid = 0; igrid < subgrids.size(); ++igrid) {
+    delete subgrids[igrid];
+  }
+
+  return 0;
+}
@@ -0,0 +1,220 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file timeCMILibrary.cpp
+ *
+ * @brief Timing test for repeated calls to the CMILibrary.
+ *
+ * We mimic a coupled SPH simulation in which the particles move slightly in
+ * between calls to the library, and compare the time spent in recomputing the
+ * neutral fractions from scratch (cmi_compute_neutral_fraction_dp()) with the
+ * time spent in the persistent coupling mode (cmi_register_particles_dp() and
+ * cmi_update_neutral_fraction()).
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "CMILibrary.hpp"
+#include "RandomGenerator.hpp"
+#include "TimingTools.hpp"
+
+#include <vector>
+
+/*! @brief Number of particles in every dimension. */
+#define TIMECMILIBRARY_NPART1D 16
+
+/*! @brief Number of coupling steps. */
+#define TIMECMILIBRARY_NSTEP 10
+
+/**
+ * @brief Particle set that evolves slowly in a periodic box.
+ */
+class EvolvingParticles {
+public:
+  /*! @brief Anchor of the box (in m). */
+  double _box_anchor[3];
+
+  /*! @brief Side lengths of the box (in m). */
+  double _box_sides[3];
+
+  /*! @brief X coordinates (in m). */
+  std::vector< double > _x;
+
+  /*! @brief Y coordinates (in m). */
+  std::vector< double > _y;
+
+  /*! @brief Z coordinates (in m). */
+  std::vector< double > _z;
+
+  /*! @brief Smoothing lengths (in m). */
+  std::vector< double > _h;
+
+  /*! @brief Masses (in kg). */
+  std::vector< double > _m;
+
+  /*! @brief Neutral fractions. */
+  std::vector< double > _nH;
+
+  /*! @brief Random generator used to move the particles. */
+  RandomGenerator _random_generator;
+
+  /**
+   * @brief Constructor.
+   *
+   * Sets up a perturbed lattice of particles in the same box as the one in
+   * test_CMI_library.param.
+   */
+  EvolvingParticles() : _random_generator(42) {
+
+    const double pc = 3.086e16;
+    const uint_fast32_t npart1d = TIMECMILIBRARY_NPART1D;
+    const uint_fast32_t npart = npart1d * npart1d * npart1d;
+    for (uint_fast8_t i = 0; i < 3; ++i) {
+      _box_anchor[i] = -5. * pc;
+      _box_sides[i] = 10. * pc;
+    }
+    _x.resize(npart);
+    _y.resize(npart);
+    _z.resize(npart);
+    _h.resize(npart, 2. * _box_sides[0] / npart1d);
+    // 100. cm^-3 * (10.pc)^3 * 1.67*10^{-27} kg / npart
+    _m.resize(npart, 4.9e33 / npart);
+    _nH.resize(npart, 0.);
+    const double dx = 1. / npart1d;
+    for (uint_fast32_t i = 0; i < npart; ++i) {
+      const uint_fast32_t ix = i / (npart1d * npart1d);
+      const uint_fast32_t iy = (i / npart1d) % npart1d;
+      const uint_fast32_t iz = i % npart1d;
+      _x[i] = _box_anchor[0] +
+              dx * (ix + _random_generator.get_uniform_random_double()) *
+                  _box_sides[0];
+      _y[i] = _box_anchor[1] +
+              dx * (iy + _random_generator.get_uniform_random_double()) *
+                  _box_sides[1];
+      _z[i] = _box_anchor[2] +
+              dx * (iz + _random_generator.get_uniform_random_double()) *
+                  _box_sides[2];
+    }
+  }
+
+  /**
+   * @brief Move all particles by a small random displacement.
+   */
+  void move() {
+    const double dx = 0.01 * _box_sides[0] / TIMECMILIBRARY_NPART1D;
+    for (size_t i = 0; i < _x.size(); ++i) {
+      _x[i] = wrap(
+          _x[i] + dx * (_random_generator.get_uniform_random_double() - 0.5),
+          0);
+      _y[i] = wrap(
+          _y[i] + dx * (_random_generator.get_uniform_random_double() - 0.5),
+          1);
+      _z[i] = wrap(
+          _z[i] + dx * (_random_generator.get_uniform_random_double() - 0.5),
+          2);
+    }
+  }
+
+  /**
+   * @brief Apply periodic boundary conditions to the given coordinate.
+   *
+   * @param x Coordinate (in m).
+   * @param i Index of the coordinate direction.
+   * @return Coordinate inside the box (in m).
+   */
+  double wrap(double x, const uint_fast8_t i) const {
+    if (x < _box_anchor[i]) {
+      x += _box_sides[i];
+    }
+    if (x >= _box_anchor[i] + _box_sides[i]) {
+      x -= _box_sides[i];
+    }
+    return x;
+  }
+
+  /**
+   * @brief Get the average neutral fraction.
+   *
+   * @return Average neutral fraction.
+   */
+  double get_average_neutral_fraction() const {
+    double average = 0.;
+    for (size_t i = 0; i < _nH.size(); ++i) {
+      average += _nH[i];
+    }
+    return average / _nH.size();
+  }
+};
+
+/**
+ * @brief Timing test for repeated calls to the CMILibrary.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  timingtools_init("timeCMILibrary", argc, argv);
+
+  timingtools_print_header("%i coupling steps for %i^3 particles",
+                           TIMECMILIBRARY_NSTEP, TIMECMILIBRARY_NPART1D);
+
+  timingtools_start_timing_block("cold start") {
+    EvolvingParticles particles;
+    cmi_init_periodic_dp("test_CMI_library.param", timingtools_num_threads, 1.,
+                         1., particles._box_anchor, particles._box_sides,
+                         "centroid", false);
+    timingtools_start_timing();
+    for (uint_fast32_t istep = 0; istep < TIMECMILIBRARY_NSTEP; ++istep) {
+      particles.move();
+      cmi_compute_neutral_fraction_dp(
+          particles._x.data(), particles._y.data(), particles._z.data(),
+          particles._h.data(), particles._m.data(), particles._nH.data(),
+          particles._x.size());
+    }
+    timingtools_stop_timing();
+    cmi_destroy();
+    timingtools_print("Average neutral fraction: %g.",
+                      particles.get_average_neutral_fraction());
+  }
+  timingtools_end_timing_block("cold start");
+
+  timingtools_start_timing_block("persistent coupling") {
+    EvolvingParticles particles;
+    cmi_init_periodic_dp("test_CMI_library.param", timingtools_num_threads, 1.,
+                         1., particles._box_anchor, particles._box_sides,
+                         "centroid", false);
+    cmi_register_particles_dp(particles._x.data(), particles._y.data(),
+                              particles._z.data(), particles._h.data(),
+                              particles._m.data(), particles._nH.data(),
+                              particles._x.size());
+    timingtools_start_timing();
+    for (uint_fast32_t istep = 0; istep < TIMECMILIBRARY_NSTEP; ++istep) {
+      particles.move();
+      cmi_update_neutral_fraction();
+    }
+    timingtools_stop_timing();
+    cmi_destroy();
+    timingtools_print("Average neutral fraction: %g.",
+                      particles.get_average_neutral_fraction());
+  }
+  timingtools_end_timing_block("persistent coupling");
+
+  return 0;
+}
@@ -0,0 +1,130 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file timeDensityFunctionBlock.cpp
+ *
+ * @brief Timing test for DensityFunction::evaluate_block().
+ *
+ * We initialize a 64^3 grid consisting of 4^3 subgrids using a number of
+ * DensityFunction implementations, once by calling operator() for every cell
+ * and once by calling evaluate_block() for every subgrid.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "BondiProfileDensityFunction.hpp"
+#include "DiscPatchDensityFunction.hpp"
+#include "HomogeneousDensityFunction.hpp"
+#include "HydroDensitySubGrid.hpp"
+#include "ParameterFile.hpp"
+#include "TimingTools.hpp"
+
+#include <vector>
+
+/*! @brief Number of subgrids in every dimension. */
+#define TIMEDENSITYFUNCTIONBLOCK_NSUBGRID 4
+
+/*! @brief Number of cells in every dimension of a single subgrid. */
+#define TIMEDENSITYFUNCTIONBLOCK_NCELL 16
+
+/**
+ * @brief Timing test for DensityFunction::evaluate_block().
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  timingtools_init("timeDensityFunctionBlock", argc, argv);
+
+  const int_fast32_t nsubgrid = TIMEDENSITYFUNCTIONBLOCK_NSUBGRID;
+  const int_fast32_t ncell = TIMEDENSITYFUNCTIONBLOCK_NCELL;
+  // 1 kpc box centred on the origin, but offset a bit to avoid the Bondi
+  // singularity
+  const double box_side = 3.086e19;
+  const double subgrid_side = box_side / nsubgrid;
+  std::vector< HydroDensitySubGrid * > subgrids(nsubgrid * nsubgrid * nsubgrid);
+  for (int_fast32_t igrid = 0; igrid < nsubgrid * nsubgrid * nsubgrid;
+       ++igrid) {
+    const int_fast32_t ix = igrid / (nsubgrid * nsubgrid);
+    const int_fast32_t iy = (igrid / nsubgrid) % nsubgrid;
+    const int_fast32_t iz = igrid % nsubgrid;
+    double box[6] = {-0.49 * box_side + ix * subgrid_side,
+                     -0.49 * box_side + iy * subgrid_side,
+                     -0.49 * box_side + iz * subgrid_side,
+                     subgrid_side,
+                     subgrid_side,
+                     subgrid_side};
+    subgrids[igrid] =
+        new HydroDensitySubGrid(box, CoordinateVector< int_fast32_t >(ncell));
+  }
+
+  ParameterFile params;
+  HomogeneousDensityFunction homogeneous;
+  DiscPatchDensityFunction disc_patch(params);
+  BondiProfileDensityFunction bondi(params);
+  DensityFunction *density_functions[3] = {&homogeneous, &disc_patch, &bondi};
+  const char *names[3] = {"HomogeneousDensityFunction",
+                          "DiscPatchDensityFunction",
+                          "BondiProfileDensityFunction"};
+
+  const size_t number_of_subgrids = subgrids.size();
+  for (uint_fast8_t ifunc = 0; ifunc < 3; ++ifunc) {
+    DensityFunction &density_function = *density_functions[ifunc];
+
+    timingtools_print_header("%s", names[ifunc]);
+
+    timingtools_start_timing_block("per cell evaluation") {
+      timingtools_start_timing();
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+      for (size_t igrid = 0; igrid < number_of_subgrids; ++igrid) {
+        DensityFunctionBlock block =
+            subgrids[igrid]->get_density_function_block();
+        for (auto it = subgrids[igrid]->begin(); it != subgrids[igrid]->end();
+             ++it) {
+          block.set_values(it.get_index(), density_function(it));
+        }
+      }
+      timingtools_stop_timing();
+    }
+    timingtools_end_timing_block("per cell evaluation");
+
+    timingtools_start_timing_block("block evaluation") {
+      timingtools_start_timing();
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+      for (size_t igrid = 0; igrid < number_of_subgrids; ++igrid) {
+        DensityFunctionBlock block =
+            subgrids[igrid]->get_density_function_block();
+        density_function.evaluate_block(block);
+      }
+      timingtools_stop_timing();
+    }
+    timingtools_end_timing_block("block evaluation");
+  }
+
+  for (size_t igrid = 0; igrid < subgrids.size(); ++igrid) {
+    delete subgrids[igrid];
+  }
+
+  return 0;
+}
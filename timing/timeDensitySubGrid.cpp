@@ -0,0 +1,181 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file timeDensitySubGrid.cpp
+ *
+ * @brief Timing test that compares single photon packet traversal through a
+ * DensitySubGrid with batched traversal.
+ *
+ * The setup mimics the Stromgren benchmark: a uniform hydrogen only density
+ * field with a central source. Photon packets are emitted from the centre of
+ * the subgrid in photon buffer sized batches and traversed until they are
+ * absorbed or leave the subgrid.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "DensitySubGrid.hpp"
+#include "PhotonBuffer.hpp"
+#include "RandomGenerator.hpp"
+#include "TimingTools.hpp"
+
+#include <cmath>
+#include <vector>
+
+/*! @brief Number of cells in every dimension of the subgrid. */
+#define TIMEDENSITYSUBGRID_NUMBER_OF_CELLS 32
+
+/*! @brief Number of photon packets traversed in every test. */
+#define TIMEDENSITYSUBGRID_NUMBER_OF_PHOTONS 2000000
+
+/**
+ * @brief Generate a batch of photon packets at the centre of the given box.
+ *
+ * @param box Box (anchor and sides, in m).
+ * @param random_generator RandomGenerator to use.
+ * @param photons Photon packets to initialise.
+ * @param number_of_photons Number of photon packets.
+ */
+inline void generate_photons(const double box[6],
+                             RandomGenerator &random_generator,
+                             PhotonPacket *photons,
+                             const uint_fast32_t number_of_photons) {
+
+  const CoordinateVector<> centre(box[0] + 0.5 * box[3],
+                                  box[1] + 0.5 * box[4],
+                                  box[2] + 0.5 * box[5]);
+  for (uint_fast32_t i = 0; i < number_of_photons; ++i) {
+    PhotonPacket &photon = photons[i];
+    const double cost = 2. * random_generator.get_uniform_random_double() - 1.;
+    const double phi = 2. * M_PI * random_generator.get_uniform_random_double();
+    const double sint = std::sqrt(std::max(1. - cost * cost, 0.));
+    photon.set_position(centre);
+    photon.set_direction(
+        CoordinateVector<>(sint * std::cos(phi), sint * std::sin(phi), cost));
+    photon.set_energy(3.288e15);
+    for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+      photon.set_photoionization_cross_section(ion, 0.);
+    }
+    photon.set_photoionization_cross_section(ION_H_n, 6.3e-22);
+    photon.set_weight(1.);
+    photon.set_distance_travelled(0.);
+    photon.set_target_optical_depth(
+        -std::log(random_generator.get_uniform_random_double()));
+  }
+}
+
+/**
+ * @brief Create a subgrid with a Stromgren benchmark like density field.
+ *
+ * @param box Box (anchor and sides, in m).
+ * @return Pointer to a newly created subgrid (memory management is transferred
+ * to the caller).
+ */
+inline DensitySubGrid *make_grid(const double box[6]) {
+
+  const CoordinateVector< int_fast32_t > ncell(
+      TIMEDENSITYSUBGRID_NUMBER_OF_CELLS);
+  DensitySubGrid *grid = new DensitySubGrid(box, ncell);
+  for (auto cellit = grid->begin(); cellit != grid->end(); ++cellit) {
+    const CoordinateVector<> x =
+        cellit.get_cell_midpoint() -
+        CoordinateVector<>(box[0] + 0.5 * box[3], box[1] + 0.5 * box[4],
+                           box[2] + 0.5 * box[5]);
+    cellit.get_ionization_variables().set_number_density(1.e8);
+    // ionized region of roughly half the box size
+    cellit.get_ionization_variables().set_ionic_fraction(
+        ION_H_n, (x.norm() < 0.25 * box[3]) ? 1.e-4 : 0.9);
+  }
+  grid->reset_intensities();
+  return grid;
+}
+
+/**
+ * @brief Timing test that compares single photon packet traversal through a
+ * DensitySubGrid with batched traversal.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  timingtools_init("timeDensitySubGrid", argc, argv);
+
+  const double box[6] = {-1.543e17, -1.543e17, -1.543e17,
+                         3.086e17,  3.086e17,  3.086e17};
+
+  timingtools_print_header(
+      "Photon traversal (%i^3 cells, %i photon packets, batch size %i).",
+      TIMEDENSITYSUBGRID_NUMBER_OF_CELLS, TIMEDENSITYSUBGRID_NUMBER_OF_PHOTONS,
+      DENSITYSUBGRID_BATCH_LANES);
+
+  double total_time = 0.;
+  double checksum = 0.;
+  timingtools_start_timing_block("single photon traversal") {
+    DensitySubGrid *grid = make_grid(box);
+    RandomGenerator random_generator(42);
+    PhotonPacket photons[PHOTONBUFFER_SIZE];
+    for (uint_fast32_t i = 0; i < TIMEDENSITYSUBGRID_NUMBER_OF_PHOTONS;
+         i += PHOTONBUFFER_SIZE) {
+      generate_photons(box, random_generator, photons, PHOTONBUFFER_SIZE);
+      timingtools_start_timing();
+      for (uint_fast32_t j = 0; j < PHOTONBUFFER_SIZE; ++j) {
+        checksum += grid->interact(photons[j], TRAVELDIRECTION_INSIDE, -1.);
+      }
+      timingtools_stop_timing();
+      total_time += timingtools_timer.value();
+    }
+    delete grid;
+  }
+  timingtools_end_timing_block("single photon traversal");
+  timingtools_print("%g photon packets/s (checksum: %g)",
+                    timingtools_num_sample *
+                        TIMEDENSITYSUBGRID_NUMBER_OF_PHOTONS / total_time,
+                    checksum);
+
+  total_time = 0.;
+  checksum = 0.;
+  timingtools_start_timing_block("batched traversal") {
+    DensitySubGrid *grid = make_grid(box);
+    RandomGenerator random_generator(42);
+    PhotonPacket photons[PHOTONBUFFER_SIZE];
+    int_fast32_t results[PHOTONBUFFER_SIZE];
+    DensitySubGrid::PathBuffer path_buffer;
+    for (uint_fast32_t i = 0; i < TIMEDENSITYSUBGRID_NUMBER_OF_PHOTONS;
+         i += PHOTONBUFFER_SIZE) {
+      generate_photons(box, random_generator, photons, PHOTONBUFFER_SIZE);
+      timingtools_start_timing();
+      grid->interact_batch(photons, PHOTONBUFFER_SIZE, TRAVELDIRECTION_INSIDE,
+                           -1., results, path_buffer);
+      for (uint_fast32_t j = 0; j < PHOTONBUFFER_SIZE; ++j) {
+        checksum += results[j];
+      }
+      timingtools_stop_timing();
+      total_time += timingtools_timer.value();
+    }
+    delete grid;
+  }
+  timingtools_end_timing_block("batched traversal");
+  timingtools_print("%g photon packets/s (checksum: %g)",
+                    timingtools_num_sample *
+                        TIMEDENSITYSUBGRID_NUMBER_OF_PHOTONS / total_time,
+                    checksum);
+
+  return 0;
+}
@@ -0,0 +1,166 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file timeFFTPoissonSolver.cpp
+ *
+ * @brief Timing test that compares the FFTPoissonSolver with the
+ * LinearOctreeGravity tree for regular grids of different resolutions.
+ *
+ * For every resolution, we time a full FFT solve (with isolated boundaries)
+ * and a tree walk (the tree is only built once, as in the simulation), and we
+ * check the accuracy of both methods for a random subset of the cells against
+ * direct summation.
+ *
+ * Run with e.g. "-t 16" to obtain scaling results for 1 to 16 threads.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "FFTPoissonSolver.hpp"
+#include "LinearOctreeGravity.hpp"
+#include "RandomGenerator.hpp"
+#include "TimingTools.hpp"
+
+#include <cmath>
+#include <sstream>
+#include <vector>
+
+/*! @brief Number of resolutions to test. */
+#define TIMEFFTPOISSONSOLVER_NUMBER_OF_RESOLUTIONS 3
+
+/*! @brief Number of cells that is used to check the accuracy. */
+#define TIMEFFTPOISSONSOLVER_NUMBER_OF_CHECKS 100
+
+/**
+ * @brief Get the RMS relative acceleration error for a random subset of the
+ * cells.
+ *
+ * @param positions Cell positions (in m).
+ * @param masses Cell masses (in kg).
+ * @param accelerations Accelerations to check (in m s^-2).
+ * @param random_generator RandomGenerator used to select the cells.
+ * @return RMS relative acceleration error.
+ */
+double get_rms_error(const std::vector< CoordinateVector<> > &positions,
+                     const std::vector< double > &masses,
+                     const std::vector< CoordinateVector<> > &accelerations,
+                     RandomGenerator &random_generator) {
+
+  const double G = PhysicalConstants::get_physical_constant(
+      PHYSICALCONSTANT_NEWTON_CONSTANT);
+  double rms_error = 0.;
+  for (uint_fast32_t icheck = 0; icheck < TIMEFFTPOISSONSOLVER_NUMBER_OF_CHECKS;
+       ++icheck) {
+    const size_t i =
+        random_generator.get_uniform_random_double() * positions.size();
+    CoordinateVector<> reference;
+    for (size_t j = 0; j < positions.size(); ++j) {
+      if (j != i) {
+        const CoordinateVector<> r = positions[i] - positions[j];
+        const double inverse_r = 1. / r.norm();
+        reference -= G * masses[j] * inverse_r * inverse_r * inverse_r * r;
+      }
+    }
+    const double error =
+        (accelerations[i] - reference).norm() / reference.norm();
+    rms_error += error * error;
+  }
+  return std::sqrt(rms_error / TIMEFFTPOISSONSOLVER_NUMBER_OF_CHECKS);
+}
+
+/**
+ * @brief Timing test that compares the FFTPoissonSolver with the
+ * LinearOctreeGravity tree for regular grids of different resolutions.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  timingtools_init("timeFFTPoissonSolver", argc, argv);
+
+  const Box<> box(CoordinateVector<>(0.), CoordinateVector<>(3.086e17));
+  RandomGenerator random_generator(42);
+
+  const int_fast32_t resolutions[TIMEFFTPOISSONSOLVER_NUMBER_OF_RESOLUTIONS] = {
+      16, 32, 64};
+  for (uint_fast32_t ires = 0;
+       ires < TIMEFFTPOISSONSOLVER_NUMBER_OF_RESOLUTIONS; ++ires) {
+
+    const int_fast32_t ncell = resolutions[ires];
+    timingtools_print_header("Self-gravity for %i^3 cells", int(ncell));
+
+    // centrally concentrated density field with some noise
+    std::vector< CoordinateVector<> > positions;
+    std::vector< double > masses;
+    const double sigma = box.get_sides().x() / 6.;
+    const CoordinateVector<> centre = box.get_anchor() + 0.5 * box.get_sides();
+    for (int_fast32_t ix = 0; ix < ncell; ++ix) {
+      for (int_fast32_t iy = 0; iy < ncell; ++iy) {
+        for (int_fast32_t iz = 0; iz < ncell; ++iz) {
+          const CoordinateVector<> x =
+              box.get_anchor() +
+              CoordinateVector<>((ix + 0.5) / ncell, (iy + 0.5) / ncell,
+                                 (iz + 0.5) / ncell) *
+                  box.get_sides().x();
+          const double r2 = (x - centre).norm2();
+          positions.push_back(x);
+          masses.push_back(
+              1.e30 * (0.1 + std::exp(-0.5 * r2 / (sigma * sigma))) *
+              (0.95 + 0.1 * random_generator.get_uniform_random_double()));
+        }
+      }
+    }
+
+    std::stringstream fft_filename, tree_filename;
+    fft_filename << "scaling_fft_poisson_" << ncell << ".txt";
+    tree_filename << "scaling_fft_poisson_tree_" << ncell << ".txt";
+
+    FFTPoissonSolver solver(box, CoordinateVector< int_fast32_t >(ncell),
+                            false);
+    solver.build(positions, masses);
+    std::vector< CoordinateVector<> > fft_accelerations;
+    std::vector< double > fft_potentials;
+    timingtools_start_scaling_block("FFT solve") {
+      timingtools_start_timing();
+      solver.compute_accelerations(fft_accelerations, fft_potentials);
+      timingtools_stop_timing();
+    }
+    timingtools_end_scaling_block("FFT solve", fft_filename.str());
+
+    LinearOctreeGravity tree(box, 0.5);
+    tree.build(positions, masses);
+    std::vector< CoordinateVector<> > tree_accelerations;
+    std::vector< double > tree_potentials;
+    timingtools_start_scaling_block("tree walk") {
+      timingtools_start_timing();
+      tree.compute_accelerations(tree_accelerations, tree_potentials);
+      timingtools_stop_timing();
+    }
+    timingtools_end_scaling_block("tree walk", tree_filename.str());
+
+    timingtools_print("Relative acceleration error: FFT: %g, tree: %g",
+                      get_rms_error(positions, masses, fft_accelerations,
+                                    random_generator),
+                      get_rms_error(positions, masses, tree_accelerations,
+                                    random_generator));
+  }
+
+  return 0;
+}
@@ -0,0 +1,173 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file timeGadgetDensityGridWriter.cpp
+ *
+ * @brief Timing test that compares the synchronous and asynchronous subgrid
+ * snapshot output of the GadgetDensityGridWriter.
+ *
+ * For the asynchronous writer, we time both the part of the write that blocks
+ * the simulation (packing the fields) and the total time until the file is
+ * written. Run with e.g. "-t 16" to obtain scaling results for the packing for
+ * 1 to 16 threads.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "DensitySubGridCreator.hpp"
+#include "GadgetDensityGridWriter.hpp"
+#include "HDF5Tools.hpp"
+#include "HomogeneousDensityFunction.hpp"
+#include "HydroDensitySubGrid.hpp"
+#include "RandomGenerator.hpp"
+#include "TimingTools.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+/*! @brief Number of cells in every dimension. */
+#define TIMEGADGETDENSITYGRIDWRITER_NCELL 64
+
+/*! @brief Number of subgrids in every dimension. */
+#define TIMEGADGETDENSITYGRIDWRITER_NSUBGRID 8
+
+/**
+ * @brief Get the size of the file with the given name.
+ *
+ * @param filename Name of the file.
+ * @return Size of the file (in bytes).
+ */
+size_t get_file_size(const std::string filename) {
+  std::ifstream file(filename, std::ios::binary | std::ios::ate);
+  return file.tellg();
+}
+
+/**
+ * @brief Timing test that compares the synchronous and asynchronous subgrid
+ * snapshot output of the GadgetDensityGridWriter.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  timingtools_init("timeGadgetDensityGridWriter", argc, argv);
+
+  const Box<> box(CoordinateVector<>(0.), CoordinateVector<>(3.086e17));
+  DensitySubGridCreator< HydroDensitySubGrid > grid_creator(
+      box, CoordinateVector< int_fast32_t >(TIMEGADGETDENSITYGRIDWRITER_NCELL),
+      CoordinateVector< int_fast32_t >(TIMEGADGETDENSITYGRIDWRITER_NSUBGRID),
+      CoordinateVector< bool >(false));
+  HomogeneousDensityFunction density_function;
+  density_function.initialize();
+  grid_creator.initialize(density_function);
+
+  // fill the grid with noisy values, so that compression is not trivial
+  RandomGenerator random_generator(42);
+  for (auto gridit = grid_creator.begin();
+       gridit != grid_creator.original_end(); ++gridit) {
+    for (auto cellit = (*gridit).hydro_begin();
+         cellit != (*gridit).hydro_end(); ++cellit) {
+      const double noise = random_generator.get_uniform_random_double();
+      cellit.get_ionization_variables().set_temperature(8000. * (1. + noise));
+      cellit.get_ionization_variables().set_ionic_fraction(ION_H_n,
+                                                           1.e-6 * noise);
+      HydroVariables &hydro_variables = cellit.get_hydro_variables();
+      hydro_variables.set_primitives_density(1.e-21 * (1. + noise));
+      hydro_variables.set_primitives_pressure(1.e-12 * (1. + noise));
+      hydro_variables.set_primitives_velocity(CoordinateVector<>(
+          1.e3 * random_generator.get_uniform_random_double(),
+          1.e3 * random_generator.get_uniform_random_double(),
+          1.e3 * random_generator.get_uniform_random_double()));
+    }
+  }
+
+  uint_fast32_t flags[DENSITYGRIDFIELD_NUMBER];
+  for (int_fast32_t property = 0; property < DENSITYGRIDFIELD_NUMBER;
+       ++property) {
+    flags[property] = 0;
+  }
+  flags[DENSITYGRIDFIELD_COORDINATES] = true;
+  flags[DENSITYGRIDFIELD_NUMBER_DENSITY] = true;
+  flags[DENSITYGRIDFIELD_TEMPERATURE] = true;
+  flags[DENSITYGRIDFIELD_NEUTRAL_FRACTION] = 1;
+  flags[DENSITYGRIDFIELD_DENSITY] = true;
+  flags[DENSITYGRIDFIELD_VELOCITIES] = true;
+  flags[DENSITYGRIDFIELD_PRESSURE] = true;
+  const DensityGridWriterFields fields(flags);
+  ParameterFile params;
+
+  timingtools_print_header("Snapshot output for %i^3 cells",
+                           TIMEGADGETDENSITYGRIDWRITER_NCELL);
+
+  for (uint_fast8_t compression = 0; compression < 2; ++compression) {
+    std::stringstream name;
+    name << "synchronous writer, compression "
+         << (compression ? "enabled" : "disabled");
+    timingtools_start_timing_block(name.str().c_str()) {
+      GadgetDensityGridWriter writer("timesnapshot_sync", ".", true, fields,
+                                     nullptr, 3, compression);
+      timingtools_start_timing();
+      writer.write(grid_creator, compression, params);
+      timingtools_stop_timing();
+    }
+    timingtools_end_timing_block(name.str().c_str());
+    std::stringstream filename;
+    filename << "timesnapshot_sync00" << static_cast< int >(compression)
+             << ".hdf5";
+    timingtools_print("File size: %zu bytes",
+                      get_file_size(filename.str()));
+  }
+
+  timingtools_start_scaling_block("asynchronous writer, blocking part") {
+    GadgetDensityGridWriter writer("timesnapshot_async", ".", true, fields,
+                                   nullptr, 3, false, true);
+    timingtools_start_timing();
+    writer.write(grid_creator, 0, params);
+    timingtools_stop_timing();
+  }
+  timingtools_end_scaling_block("asynchronous writer, blocking part",
+                                "scaling_async_snapshot_packing.txt");
+
+  for (int_fast32_t filter = HDF5Tools::HDF5COMPRESSIONFILTER_NONE;
+       filter <= HDF5Tools::HDF5COMPRESSIONFILTER_SHUFFLE_DEFLATE; ++filter) {
+    std::stringstream name;
+    name << "asynchronous writer, total, filter "
+         << HDF5Tools::get_compression_filter_name(filter);
+    timingtools_start_timing_block(name.str().c_str()) {
+      timingtools_start_timing();
+      {
+        GadgetDensityGridWriter writer("timesnapshot_async", ".", true, fields,
+                                       nullptr, 3, false, true, 1024, filter,
+                                       4);
+        writer.write(grid_creator, filter, params);
+        // the destructor waits for the write to finish
+      }
+      timingtools_stop_timing();
+    }
+    timingtools_end_timing_block(name.str().c_str());
+    std::stringstream filename;
+    filename << "timesnapshot_async00" << filter << ".hdf5";
+    timingtools_print("File size: %zu bytes",
+                      get_file_size(filename.str()));
+  }
+
+  return 0;
+}
@@ -0,0 +1,139 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file timeLinearOctreeGravity.cpp
+ *
+ * @brief Scaling test for the LinearOctreeGravity self-gravity solver.
+ *
+ * We time the tree construction, the in place update of the node moments and
+ * the tree walk for the cells of a regular grid with a random density field,
+ * and check the accuracy of the tree walk for a random subset of the cells
+ * against direct summation.
+ *
+ * Run with e.g. "-t 16" to obtain scaling results for 1 to 16 threads.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "LinearOctreeGravity.hpp"
+#include "RandomGenerator.hpp"
+#include "TimingTools.hpp"
+
+#include <cmath>
+#include <vector>
+
+/*! @brief Number of cells in every dimension. */
+#define TIMELINEAROCTREEGRAVITY_NCELL 64
+
+/*! @brief Number of cells that is used to check the accuracy. */
+#define TIMELINEAROCTREEGRAVITY_NUMBER_OF_CHECKS 100
+
+/*! @brief Opening angle. */
+#define TIMELINEAROCTREEGRAVITY_OPENING_ANGLE 0.5
+
+/**
+ * @brief Scaling test for the LinearOctreeGravity self-gravity solver.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  timingtools_init("timeLinearOctreeGravity", argc, argv);
+
+  const uint_fast32_t ncell = TIMELINEAROCTREEGRAVITY_NCELL;
+  const Box<> box(CoordinateVector<>(0.), CoordinateVector<>(3.086e17));
+  const double cell_mass = 1.e30;
+  RandomGenerator random_generator(42);
+  std::vector< CoordinateVector<> > positions;
+  std::vector< double > masses;
+  for (uint_fast32_t ix = 0; ix < ncell; ++ix) {
+    for (uint_fast32_t iy = 0; iy < ncell; ++iy) {
+      for (uint_fast32_t iz = 0; iz < ncell; ++iz) {
+        positions.push_back(box.get_anchor() +
+                            CoordinateVector<>((ix + 0.5) / ncell,
+                                               (iy + 0.5) / ncell,
+                                               (iz + 0.5) / ncell) *
+                                box.get_sides().x());
+        masses.push_back(cell_mass *
+                         (0.1 + random_generator.get_uniform_random_double()));
+      }
+    }
+  }
+
+  timingtools_print_header("Self-gravity for %i^3 cells (opening angle %g)",
+                           TIMELINEAROCTREEGRAVITY_NCELL,
+                           TIMELINEAROCTREEGRAVITY_OPENING_ANGLE);
+
+  LinearOctreeGravity tree(box, TIMELINEAROCTREEGRAVITY_OPENING_ANGLE);
+  timingtools_start_scaling_block("tree construction") {
+    timingtools_start_timing();
+    tree.build(positions, masses);
+    timingtools_stop_timing();
+  }
+  timingtools_end_scaling_block("tree construction",
+                                "scaling_octree_construction.txt");
+  timingtools_print("%zu nodes, %zu leaves, %zu levels",
+                    tree.get_number_of_nodes(), tree.get_number_of_leaves(),
+                    tree.get_number_of_levels());
+
+  timingtools_start_scaling_block("moment update") {
+    timingtools_start_timing();
+    tree.update_masses(masses);
+    timingtools_stop_timing();
+  }
+  timingtools_end_scaling_block("moment update", "scaling_octree_update.txt");
+
+  std::vector< CoordinateVector<> > accelerations;
+  std::vector< double > potentials;
+  timingtools_start_scaling_block("tree walk") {
+    timingtools_start_timing();
+    tree.compute_accelerations(accelerations, potentials);
+    timingtools_stop_timing();
+  }
+  timingtools_end_scaling_block("tree walk", "scaling_octree_walk.txt");
+
+  // check the accuracy for a random subset of the cells
+  const double G = PhysicalConstants::get_physical_constant(
+      PHYSICALCONSTANT_NEWTON_CONSTANT);
+  double rms_error = 0.;
+  double max_error = 0.;
+  for (uint_fast32_t icheck = 0;
+       icheck < TIMELINEAROCTREEGRAVITY_NUMBER_OF_CHECKS; ++icheck) {
+    const size_t i =
+        random_generator.get_uniform_random_double() * positions.size();
+    CoordinateVector<> reference;
+    for (size_t j = 0; j < positions.size(); ++j) {
+      if (j != i) {
+        const CoordinateVector<> r = positions[i] - positions[j];
+        const double inverse_r = 1. / r.norm();
+        reference -= G * masses[j] * inverse_r * inverse_r * inverse_r * r;
+      }
+    }
+    const double error = (accelerations[i] - reference).norm() /
+                         reference.norm();
+    rms_error += error * error;
+    max_error = std::max(max_error, error);
+  }
+  rms_error = std::sqrt(rms_error / TIMELINEAROCTREEGRAVITY_NUMBER_OF_CHECKS);
+  timingtools_print("Relative acceleration error: RMS %g, max %g", rms_error,
+                    max_error);
+
+  return 0;
+}
@@ -0,0 +1,347 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file timeNUMAPlacement.cpp
+ *
+ * @brief Timing test for NUMA aware subgrid placement, thread pinning and
+ * locality aware task stealing.
+ *
+ * The test mimics the memory access pattern of the photon traversal phase of
+ * the task-based algorithm: every task sweeps over the memory of the subgrid
+ * it acts on and then spawns a new task for a nearby subgrid, which is added
+ * to the queue of the thread that owns that subgrid. We compare
+ *  - the default setup: subgrid memory is allocated by a single thread,
+ *    subgrids are distributed over the threads in a round robin fashion,
+ *    threads are not pinned and steal from any other thread,
+ *  - the NUMA aware setup restricted to the cores of the first NUMA domain
+ *    (a single socket),
+ *  - the NUMA aware setup using all NUMA domains: threads are pinned,
+ *    contiguous blocks of subgrids are first touched by their home thread and
+ *    stealing prefers threads in the same NUMA domain.
+ *
+ * For every setup, we report the task throughput and the fraction of tasks
+ * that accessed subgrid memory in another NUMA domain than that of the core
+ * that executed the task (Linux only).
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "NUMATopology.hpp"
+#include "OpenMP.hpp"
+#include "Scheduler.hpp"
+#include "TaskQueue.hpp"
+#include "ThreadLock.hpp"
+#include "ThreadSafeVector.hpp"
+#include "Timer.hpp"
+#include "TimingTools.hpp"
+#include "WorkStealingTaskQueue.hpp"
+
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*! @brief Number of subgrids. */
+#define TIMENUMAPLACEMENT_NUMBER_OF_SUBGRIDS 512
+
+/*! @brief Number of doubles stored in a single subgrid (256 KB per subgrid, so
+ *  that all subgrids together do not fit in the cache). */
+#define TIMENUMAPLACEMENT_SUBGRID_SIZE 32768
+
+/*! @brief Number of tasks that are present at the start of the test. */
+#define TIMENUMAPLACEMENT_NUMBER_OF_ROOT_TASKS 2000
+
+/*! @brief Number of tasks that is spawned from every root task. */
+#define TIMENUMAPLACEMENT_NUMBER_OF_GENERATIONS 20
+
+/*! @brief Size of the task space and the queues. */
+#define TIMENUMAPLACEMENT_QUEUE_SIZE                                           \
+  (TIMENUMAPLACEMENT_NUMBER_OF_ROOT_TASKS * 2)
+
+/**
+ * @brief Get the NUMA node that contains the memory at the given address.
+ *
+ * @param address Address (should have been touched already).
+ * @return NUMA node, or -1 if the node could not be determined.
+ */
+inline int_fast32_t get_memory_node(void *address) {
+#if defined(__linux__) && defined(SYS_get_mempolicy)
+  // MPOL_F_NODE | MPOL_F_ADDR
+  int node = -1;
+  if (syscall(SYS_get_mempolicy, &node, nullptr, 0, address, 3) == 0) {
+    return node;
+  }
+#endif
+  return -1;
+}
+
+/**
+ * @brief Get the NUMA node of the core that runs the calling thread.
+ *
+ * @return NUMA node, or -1 if the node could not be determined.
+ */
+inline int_fast32_t get_thread_node() {
+#if defined(__linux__) && defined(SYS_getcpu)
+  unsigned int cpu, node;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+    return node;
+  }
+#endif
+  return -1;
+}
+
+/**
+ * @brief Get the subgrid that a task with the given index and generation
+ * acts on.
+ *
+ * Subsequent generations move to a nearby subgrid (in index order), like
+ * photon packets that move to a neighbouring subgrid.
+ *
+ * @param root Index of the root task.
+ * @param generation Generation of the task.
+ * @return Subgrid index.
+ */
+inline size_t get_subgrid(const size_t root, const size_t generation) {
+  size_t hash = root * 2654435761u + generation * 40503u;
+  hash ^= hash >> 13;
+  hash *= 0x5bd1e995;
+  hash ^= hash >> 15;
+  return (root * 7 + generation * (1 + hash % 3)) %
+         TIMENUMAPLACEMENT_NUMBER_OF_SUBGRIDS;
+}
+
+/**
+ * @brief Run the task graph.
+ *
+ * @param number_of_threads Number of threads.
+ * @param topology NUMA topology to use (nullptr for the default setup).
+ * @param remote_fraction Fraction of the tasks that accessed remote memory.
+ * @param checksum Sum of all memory that was read (to make sure the sweeps
+ * are not optimised away).
+ * @return Time spent executing tasks (in s).
+ */
+inline double run_task_graph(const int_fast32_t number_of_threads,
+                             const NUMATopology *topology,
+                             double &remote_fraction, double &checksum) {
+
+  set_number_of_threads(number_of_threads);
+
+  std::vector< ThreadTaskQueue * > queues(number_of_threads);
+  for (int_fast32_t i = 0; i < number_of_threads; ++i) {
+#ifdef USE_WORK_STEALING
+    queues[i] = new WorkStealingTaskQueue(TIMENUMAPLACEMENT_QUEUE_SIZE, "", i);
+#else
+    queues[i] = new TaskQueue(TIMENUMAPLACEMENT_QUEUE_SIZE);
+#endif
+  }
+  TaskQueue shared_queue(TIMENUMAPLACEMENT_QUEUE_SIZE);
+  ThreadSafeVector< Task > tasks(TIMENUMAPLACEMENT_QUEUE_SIZE);
+  std::vector< ThreadLock > locks(TIMENUMAPLACEMENT_NUMBER_OF_SUBGRIDS);
+  std::vector< double * > subgrids(TIMENUMAPLACEMENT_NUMBER_OF_SUBGRIDS,
+                                   nullptr);
+  std::vector< int_fast32_t > owners(TIMENUMAPLACEMENT_NUMBER_OF_SUBGRIDS, 0);
+  std::vector< int_fast32_t > memory_nodes(
+      TIMENUMAPLACEMENT_NUMBER_OF_SUBGRIDS, -1);
+
+  if (topology != nullptr) {
+    // pin the threads and let every thread first touch its own contiguous
+    // block of subgrids
+#ifdef HAVE_OPENMP
+#pragma omp parallel default(shared)
+#endif
+    {
+      const int_fast32_t thread_id = get_thread_index();
+      topology->pin_thread(thread_id);
+      for (size_t i = 0; i < TIMENUMAPLACEMENT_NUMBER_OF_SUBGRIDS; ++i) {
+        const int_fast32_t owner =
+            (i * number_of_threads) / TIMENUMAPLACEMENT_NUMBER_OF_SUBGRIDS;
+        if (owner == thread_id) {
+          subgrids[i] = new double[TIMENUMAPLACEMENT_SUBGRID_SIZE];
+          for (size_t j = 0; j < TIMENUMAPLACEMENT_SUBGRID_SIZE; ++j) {
+            subgrids[i][j] = 1.;
+          }
+          owners[i] = owner;
+        }
+      }
+    }
+  } else {
+    for (size_t i = 0; i < TIMENUMAPLACEMENT_NUMBER_OF_SUBGRIDS; ++i) {
+      subgrids[i] = new double[TIMENUMAPLACEMENT_SUBGRID_SIZE];
+      for (size_t j = 0; j < TIMENUMAPLACEMENT_SUBGRID_SIZE; ++j) {
+        subgrids[i][j] = 1.;
+      }
+      owners[i] = i % number_of_threads;
+    }
+  }
+  for (size_t i = 0; i < TIMENUMAPLACEMENT_NUMBER_OF_SUBGRIDS; ++i) {
+    memory_nodes[i] = get_memory_node(subgrids[i]);
+  }
+
+  for (size_t iroot = 0; iroot < TIMENUMAPLACEMENT_NUMBER_OF_ROOT_TASKS;
+       ++iroot) {
+    const size_t itask = tasks.get_free_element();
+    Task &task = tasks[itask];
+    const size_t isubgrid = get_subgrid(iroot, 0);
+    task.set_subgrid(iroot);
+    task.set_buffer(0);
+    task.set_dependency(&locks[isubgrid]);
+    queues[owners[isubgrid]]->add_task(itask);
+  }
+
+  const size_t total_number_of_tasks =
+      TIMENUMAPLACEMENT_NUMBER_OF_ROOT_TASKS *
+      (TIMENUMAPLACEMENT_NUMBER_OF_GENERATIONS + 1);
+  AtomicValue< size_t > number_done(0);
+  AtomicValue< size_t > number_remote(0);
+  Scheduler scheduler(tasks, queues, shared_queue, topology);
+  double sum = 0.;
+  Timer timer;
+  timer.start();
+#ifdef HAVE_OPENMP
+#pragma omp parallel default(shared) reduction(+ : sum)
+#endif
+  {
+    const int_fast32_t thread_id = get_thread_index();
+    while (number_done.value() < total_number_of_tasks) {
+      const size_t itask = scheduler.get_task(thread_id);
+      if (itask != NO_TASK) {
+        Task &task = tasks[itask];
+        const size_t iroot = task.get_subgrid();
+        const size_t generation = task.get_buffer();
+        const size_t isubgrid = get_subgrid(iroot, generation);
+
+        if (memory_nodes[isubgrid] != get_thread_node()) {
+          number_remote.pre_increment();
+        }
+
+        // sweep over the subgrid memory
+        double *subgrid = subgrids[isubgrid];
+        for (size_t j = 0; j < TIMENUMAPLACEMENT_SUBGRID_SIZE; ++j) {
+          sum += subgrid[j];
+          subgrid[j] = 1. + 1.e-10 * j;
+        }
+
+        task.unlock_dependency();
+        tasks.free_element(itask);
+
+        if (generation < TIMENUMAPLACEMENT_NUMBER_OF_GENERATIONS) {
+          const size_t inew = tasks.get_free_element();
+          Task &new_task = tasks[inew];
+          const size_t inext = get_subgrid(iroot, generation + 1);
+          new_task.set_subgrid(iroot);
+          new_task.set_buffer(generation + 1);
+          new_task.set_dependency(&locks[inext]);
+          queues[owners[inext]]->add_task(inew);
+        }
+        number_done.pre_increment();
+      }
+    }
+  }
+  const double time = timer.stop();
+  checksum = sum;
+  remote_fraction =
+      static_cast< double >(number_remote.value()) / total_number_of_tasks;
+
+  for (size_t i = 0; i < TIMENUMAPLACEMENT_NUMBER_OF_SUBGRIDS; ++i) {
+    delete[] subgrids[i];
+  }
+  for (int_fast32_t i = 0; i < number_of_threads; ++i) {
+    delete queues[i];
+  }
+  return time;
+}
+
+/**
+ * @brief Run the task graph a number of times and print the average
+ * throughput and remote access fraction.
+ *
+ * @param name Name of the setup.
+ * @param number_of_threads Number of threads.
+ * @param topology NUMA topology to use (nullptr for the default setup).
+ * @param number_of_samples Number of times to run the task graph.
+ */
+inline void time_setup(const std::string name,
+                       const int_fast32_t number_of_threads,
+                       const NUMATopology *topology,
+                       const uint_fast32_t number_of_samples) {
+
+  timingtools_print_header("%s (%" PRIiFAST32 " threads)", name.c_str(),
+                           number_of_threads);
+  const size_t total_number_of_tasks =
+      TIMENUMAPLACEMENT_NUMBER_OF_ROOT_TASKS *
+      (TIMENUMAPLACEMENT_NUMBER_OF_GENERATIONS + 1);
+  double total_time = 0.;
+  double total_remote_fraction = 0.;
+  for (uint_fast32_t isample = 0; isample < number_of_samples; ++isample) {
+    double remote_fraction, checksum;
+    total_time += run_task_graph(number_of_threads, topology, remote_fraction,
+                                 checksum);
+    total_remote_fraction += remote_fraction;
+    if (checksum <= 0.) {
+      cmac_error("Wrong checksum!");
+    }
+  }
+  timingtools_print("Throughput: %g tasks/s, remote access fraction: %g",
+                    number_of_samples * total_number_of_tasks / total_time,
+                    total_remote_fraction / number_of_samples);
+}
+
+/**
+ * @brief Timing test for NUMA aware subgrid placement, thread pinning and
+ * locality aware task stealing.
+ *
+ * By default, all available cores are used. The number of threads for the
+ * default setup and the NUMA aware setup on all domains can be set using
+ * the -t command line option.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  timingtools_init("timeNUMAPlacement", argc, argv);
+
+  const std::vector< std::vector< int_fast32_t > > all_domains =
+      NUMATopology::detect_domains();
+  int_fast32_t number_of_threads = 0;
+  for (size_t i = 0; i < all_domains.size(); ++i) {
+    number_of_threads += all_domains[i].size();
+  }
+  if (timingtools_num_threads > 1) {
+    number_of_threads = timingtools_num_threads;
+  }
+  timingtools_print("Found %zu NUMA domain(s).", all_domains.size());
+
+  time_setup("default", number_of_threads, nullptr, timingtools_num_sample);
+
+  const std::vector< std::vector< int_fast32_t > > first_domain(
+      1, all_domains[0]);
+  const NUMATopology single_socket(first_domain, all_domains[0].size());
+  time_setup("NUMA aware, first domain only", all_domains[0].size(),
+             &single_socket, timingtools_num_sample);
+
+  const NUMATopology all_sockets(all_domains, number_of_threads);
+  time_setup("NUMA aware, all domains", number_of_threads, &all_sockets,
+             timingtools_num_sample);
+
+  return 0;
+}
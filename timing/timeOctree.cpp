@@ -0,0 +1,224 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file timeOctree.cpp
+ *
+ * @brief Timing test for the Octree.
+ *
+ * We build the tree for a random distribution of particles with smoothing
+ * lengths that contain roughly 64 neighbours, and time neighbour queries for
+ * the cell midpoints of a regular grid, using the different query types. The
+ * number of particles can be changed using TIMEOCTREE_NUMBER_OF_PARTICLES
+ * (values up to 1e8 require about 10 GB of memory).
+ *
+ * Run with e.g. "-t 16" to obtain scaling results for 1 to 16 threads.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "Octree.hpp"
+#include "RandomGenerator.hpp"
+#include "TimingTools.hpp"
+
+#include <cmath>
+#include <vector>
+
+/*! @brief Number of particles. */
+#define TIMEOCTREE_NUMBER_OF_PARTICLES 1000000
+
+/*! @brief Number of cells in every dimension. */
+#define TIMEOCTREE_NCELL 64
+
+/*! @brief Number of cells in every dimension of a block of cells that is
+ *  queried at once. */
+#define TIMEOCTREE_BLOCK_SIZE 4
+
+/**
+ * @brief Timing test for the Octree.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  timingtools_init("timeOctree", argc, argv);
+
+  const size_t number_of_particles = TIMEOCTREE_NUMBER_OF_PARTICLES;
+  const Box<> box(CoordinateVector<>(0.), CoordinateVector<>(1.));
+  // smoothing length for which the kernel on average contains 64 particles
+  const double h_mean =
+      std::cbrt(64. * 3. / (4. * M_PI * number_of_particles));
+  RandomGenerator random_generator(42);
+  std::vector< CoordinateVector<> > positions(number_of_particles);
+  std::vector< double > smoothing_lengths(number_of_particles);
+  for (size_t i = 0; i < number_of_particles; ++i) {
+    positions[i][0] = random_generator.get_uniform_random_double();
+    positions[i][1] = random_generator.get_uniform_random_double();
+    positions[i][2] = random_generator.get_uniform_random_double();
+    smoothing_lengths[i] =
+        h_mean * (0.5 + random_generator.get_uniform_random_double());
+  }
+
+  const uint_fast32_t ncell = TIMEOCTREE_NCELL;
+  const uint_fast32_t nblock = TIMEOCTREE_BLOCK_SIZE;
+  const uint_fast32_t number_of_blocks = ncell / nblock;
+  std::vector< CoordinateVector<> > cells(ncell * ncell * ncell);
+  // cells are stored block by block, so that the cells of a block are
+  // contiguous
+  for (uint_fast32_t ix = 0; ix < ncell; ++ix) {
+    for (uint_fast32_t iy = 0; iy < ncell; ++iy) {
+      for (uint_fast32_t iz = 0; iz < ncell; ++iz) {
+        const uint_fast32_t iblock =
+            ((ix / nblock) * number_of_blocks + iy / nblock) *
+                number_of_blocks +
+            iz / nblock;
+        const uint_fast32_t icell =
+            ((ix % nblock) * nblock + iy % nblock) * nblock + iz % nblock;
+        cells[iblock * nblock * nblock * nblock + icell] =
+            CoordinateVector<>((ix + 0.5) / ncell, (iy + 0.5) / ncell,
+                               (iz + 0.5) / ncell);
+      }
+    }
+  }
+  const size_t number_of_cells = cells.size();
+
+  timingtools_print_header("Octree for %zu particles, %i^3 queries",
+                           number_of_particles, TIMEOCTREE_NCELL);
+
+  Octree *tree = nullptr;
+  timingtools_start_scaling_block("tree construction") {
+    delete tree;
+    timingtools_start_timing();
+    tree = new Octree(positions, box, true);
+    tree->set_auxiliaries(smoothing_lengths, Octree::max< double >);
+    timingtools_stop_timing();
+  }
+  timingtools_end_scaling_block("tree construction",
+                                "scaling_ngb_octree_construction.txt");
+  timingtools_print("%zu nodes", tree->get_number_of_nodes());
+
+  // reference: neighbour counts using the version that returns a new vector
+  std::vector< uint_fast32_t > reference_counts(number_of_cells, 0);
+  timingtools_start_scaling_block("vector queries") {
+    timingtools_start_timing();
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+    for (size_t i = 0; i < number_of_cells; ++i) {
+      const std::vector< uint_fast32_t > ngbs = tree->get_ngbs(cells[i]);
+      reference_counts[i] = ngbs.size();
+    }
+    timingtools_stop_timing();
+  }
+  timingtools_end_scaling_block("vector queries",
+                                "scaling_ngb_octree_vector_queries.txt");
+  size_t total_count = 0;
+  for (size_t i = 0; i < number_of_cells; ++i) {
+    total_count += reference_counts[i];
+  }
+  timingtools_print("%g neighbours per query",
+                    1. * total_count / number_of_cells);
+
+  std::vector< uint_fast32_t > counts(number_of_cells, 0);
+  timingtools_start_scaling_block("buffer queries") {
+    timingtools_start_timing();
+#ifdef HAVE_OPENMP
+#pragma omp parallel default(shared)
+#endif
+    {
+      std::vector< uint_fast32_t > ngbs;
+#ifdef HAVE_OPENMP
+#pragma omp for
+#endif
+      for (size_t i = 0; i < number_of_cells; ++i) {
+        tree->get_ngbs(cells[i], ngbs);
+        counts[i] = ngbs.size();
+      }
+    }
+    timingtools_stop_timing();
+  }
+  timingtools_end_scaling_block("buffer queries",
+                                "scaling_ngb_octree_buffer_queries.txt");
+  for (size_t i = 0; i < number_of_cells; ++i) {
+    if (counts[i] != reference_counts[i]) {
+      cmac_error("Wrong number of neighbours for buffer query!");
+    }
+  }
+
+  timingtools_start_scaling_block("callback queries") {
+    timingtools_start_timing();
+#ifdef HAVE_OPENMP
+#pragma omp parallel for default(shared)
+#endif
+    for (size_t i = 0; i < number_of_cells; ++i) {
+      uint_fast32_t count = 0;
+      tree->for_each_ngb(cells[i],
+                         [&count](const uint_fast32_t) { ++count; });
+      counts[i] = count;
+    }
+    timingtools_stop_timing();
+  }
+  timingtools_end_scaling_block("callback queries",
+                                "scaling_ngb_octree_callback_queries.txt");
+  for (size_t i = 0; i < number_of_cells; ++i) {
+    if (counts[i] != reference_counts[i]) {
+      cmac_error("Wrong number of neighbours for callback query!");
+    }
+  }
+
+  const uint_fast32_t block_size = nblock * nblock * nblock;
+  const uint_fast32_t total_number_of_blocks =
+      number_of_blocks * number_of_blocks * number_of_blocks;
+  timingtools_start_scaling_block("block queries") {
+    timingtools_start_timing();
+#ifdef HAVE_OPENMP
+#pragma omp parallel default(shared)
+#endif
+    {
+      std::vector< CoordinateVector<> > block(block_size);
+#ifdef HAVE_OPENMP
+#pragma omp for
+#endif
+      for (uint_fast32_t iblock = 0; iblock < total_number_of_blocks;
+           ++iblock) {
+        const size_t offset = iblock * block_size;
+        for (uint_fast32_t j = 0; j < block_size; ++j) {
+          block[j] = cells[offset + j];
+          counts[offset + j] = 0;
+        }
+        tree->for_each_ngb_block(
+            block, [&counts, &offset](const size_t j, const uint_fast32_t) {
+              ++counts[offset + j];
+            });
+      }
+    }
+    timingtools_stop_timing();
+  }
+  timingtools_end_scaling_block("block queries",
+                                "scaling_ngb_octree_block_queries.txt");
+  for (size_t i = 0; i < number_of_cells; ++i) {
+    if (counts[i] != reference_counts[i]) {
+      cmac_error("Wrong number of neighbours for block query!");
+    }
+  }
+
+  delete tree;
+
+  return 0;
+}
@@ -0,0 +1,167 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file timePhotonBuffer.cpp
+ *
+ * @brief Timing test for PhotonBuffer.
+ *
+ * We time the copying of photon packets between buffers, as done by
+ * MemorySpace::add_photons() for every outgoing buffer of a traversal task, and
+ * the storage and retrieval of individual photon packets. Compare the results
+ * with and without the COMPACT_PHOTON_BUFFER CMake option.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "MemorySpace.hpp"
+#include "RandomGenerator.hpp"
+#include "TimingTools.hpp"
+
+#include <vector>
+
+/*! @brief Number of photon packets copied in every test. */
+#define TIMEPHOTONBUFFER_NUMBER_OF_PHOTONS 100000000
+
+/*! @brief Number of buffers that are in use at the same time in the add
+ *  photons test. This should be large enough to make sure the buffers do not
+ *  fit in the cache, as in a real simulation. */
+#define TIMEPHOTONBUFFER_NUMBER_OF_ACTIVE_BUFFERS 2048
+
+/**
+ * @brief Fill the given buffer with random photon packets.
+ *
+ * @param random_generator RandomGenerator to use.
+ * @param buffer PhotonBuffer to fill.
+ */
+inline void fill_buffer(RandomGenerator &random_generator,
+                        PhotonBuffer &buffer) {
+
+  buffer.reset();
+  buffer.grow(PHOTONBUFFER_SIZE);
+  PhotonPacket photon;
+  for (uint_fast32_t i = 0; i < PHOTONBUFFER_SIZE; ++i) {
+    photon.set_position(
+        CoordinateVector<>(random_generator.get_uniform_random_double(),
+                           random_generator.get_uniform_random_double(),
+                           random_generator.get_uniform_random_double()));
+    photon.set_direction(CoordinateVector<>(
+        random_generator.get_uniform_random_double() - 0.5,
+        random_generator.get_uniform_random_double() - 0.5,
+        random_generator.get_uniform_random_double() - 0.5));
+    photon.set_target_optical_depth(
+        random_generator.get_uniform_random_double());
+    for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+      photon.set_photoionization_cross_section(
+          ion, 1.e-22 * random_generator.get_uniform_random_double());
+    }
+    photon.set_dust_opacity(0.);
+    photon.set_energy(3.288e15);
+    photon.set_weight(1.);
+    photon.set_distance_travelled(0.);
+    photon.set_source_index(0);
+    photon.set_scatter_counter(0);
+    photon.set_type(PHOTONTYPE_PRIMARY);
+    buffer.set_photon(i, photon);
+  }
+}
+
+/**
+ * @brief Timing test for PhotonBuffer.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  timingtools_init("timePhotonBuffer", argc, argv);
+
+  timingtools_print_header("PhotonBuffer (%zu bytes, %i photon packets).",
+                           sizeof(PhotonBuffer), PHOTONBUFFER_SIZE);
+
+  double checksum = 0.;
+  timingtools_start_timing_block("add photons") {
+    RandomGenerator random_generator(42);
+    MemorySpace space(2 * TIMEPHOTONBUFFER_NUMBER_OF_ACTIVE_BUFFERS);
+    PhotonBuffer input_buffers[2];
+    fill_buffer(random_generator, input_buffers[0]);
+    fill_buffer(random_generator, input_buffers[1]);
+    // full buffers that are kept in use, in order of creation
+    std::vector< size_t > full_buffers;
+    full_buffers.reserve(TIMEPHOTONBUFFER_NUMBER_OF_ACTIVE_BUFFERS);
+    uint_fast32_t oldest_buffer = 0;
+    size_t index = space.get_free_buffer();
+    timingtools_start_timing();
+    for (uint_fast32_t i = 0; i < TIMEPHOTONBUFFER_NUMBER_OF_PHOTONS;
+         i += PHOTONBUFFER_SIZE / 2) {
+      // add half a buffer, so that we alternate between partial copies and
+      // copies that require a new buffer
+      PhotonBuffer &input_buffer = input_buffers[i % 2];
+      input_buffer.grow(PHOTONBUFFER_SIZE / 2);
+      const size_t new_index = space.add_photons(index, input_buffer);
+      if (new_index != index) {
+        // keep the full buffer and free the oldest full buffer if there are
+        // too many
+        if (full_buffers.size() < TIMEPHOTONBUFFER_NUMBER_OF_ACTIVE_BUFFERS) {
+          full_buffers.push_back(index);
+        } else {
+          checksum += space[full_buffers[oldest_buffer]].size();
+          space.free_buffer(full_buffers[oldest_buffer]);
+          full_buffers[oldest_buffer] = index;
+          oldest_buffer =
+              (oldest_buffer + 1) % TIMEPHOTONBUFFER_NUMBER_OF_ACTIVE_BUFFERS;
+        }
+        index = new_index;
+      }
+    }
+    timingtools_stop_timing();
+  }
+  timingtools_end_timing_block("add photons");
+  timingtools_print("%i photon packets per sample (checksum: %g)",
+                    TIMEPHOTONBUFFER_NUMBER_OF_PHOTONS, checksum);
+
+  checksum = 0.;
+  timingtools_start_timing_block("get and set photon") {
+    RandomGenerator random_generator(42);
+    PhotonBuffer buffers[2];
+    fill_buffer(random_generator, buffers[0]);
+    buffers[1].grow(PHOTONBUFFER_SIZE);
+    PhotonPacket photon;
+    timingtools_start_timing();
+    for (uint_fast32_t i = 0; i < TIMEPHOTONBUFFER_NUMBER_OF_PHOTONS;
+         i += PHOTONBUFFER_SIZE) {
+      const PhotonBuffer &input_buffer = buffers[(i / PHOTONBUFFER_SIZE) % 2];
+      PhotonBuffer &output_buffer = buffers[1 - (i / PHOTONBUFFER_SIZE) % 2];
+      for (uint_fast32_t j = 0; j < PHOTONBUFFER_SIZE; ++j) {
+        input_buffer.get_photon(j, photon);
+        photon.add_distance_travelled(1.);
+        output_buffer.set_photon(j, photon);
+      }
+    }
+    timingtools_stop_timing();
+    for (uint_fast32_t j = 0; j < PHOTONBUFFER_SIZE; ++j) {
+      buffers[0].get_photon(j, photon);
+      checksum += photon.get_distance_travelled();
+    }
+  }
+  timingtools_end_timing_block("get and set photon");
+  timingtools_print("%i photon packets per sample (checksum: %g)",
+                    TIMEPHOTONBUFFER_NUMBER_OF_PHOTONS, checksum);
+
+  return 0;
+}
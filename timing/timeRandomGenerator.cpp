@@ -0,0 +1,147 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file timeRandomGenerator.cpp
+ *
+ * @brief Timing test that compares the different random number generator
+ * algorithms that can be used by RandomGenerator.
+ *
+ * For every algorithm, we time the generation of a large number of random
+ * numbers, both using single draws and using batches, and the generation of
+ * photon packets (an isotropic direction, an optical depth and a frequency per
+ * packet) in photon buffer sized batches, as done by the source photon tasks.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "PhiloxRandomGenerator.hpp"
+#include "RanluxRandomGenerator.hpp"
+#include "TimingTools.hpp"
+#include "Xoshiro256PlusPlusRandomGenerator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+/*! @brief Number of random numbers drawn in the draw tests. */
+#define TIMERANDOMGENERATOR_NUMBER_OF_DRAWS 100000000
+
+/*! @brief Size of a batch of random numbers. */
+#define TIMERANDOMGENERATOR_BATCH_SIZE 800
+
+/*! @brief Number of photon packets generated in the photon test. */
+#define TIMERANDOMGENERATOR_NUMBER_OF_PHOTONS 10000000
+
+/*! @brief Number of photon packets in a photon buffer. */
+#define TIMERANDOMGENERATOR_PHOTON_BATCH_SIZE 200
+
+/**
+ * @brief Time the given random number generator algorithm.
+ *
+ * @param name Name of the algorithm.
+ * @param timingtools_num_sample Number of samples for every timing block.
+ */
+template < typename _generator_ >
+void time_algorithm(const std::string name,
+                    const uint_fast32_t timingtools_num_sample) {
+
+  timingtools_print_header("%s", name.c_str());
+
+  double checksum = 0.;
+  timingtools_start_timing_block("single draws") {
+    _generator_ generator(42);
+    timingtools_start_timing();
+    for (uint_fast32_t i = 0; i < TIMERANDOMGENERATOR_NUMBER_OF_DRAWS; ++i) {
+      checksum += generator.get_uniform_random_double();
+    }
+    timingtools_stop_timing();
+  }
+  timingtools_end_timing_block("single draws");
+  timingtools_print("%i draws per sample, average: %g",
+                    TIMERANDOMGENERATOR_NUMBER_OF_DRAWS,
+                    checksum / (timingtools_num_sample *
+                                TIMERANDOMGENERATOR_NUMBER_OF_DRAWS));
+
+  checksum = 0.;
+  timingtools_start_timing_block("batched draws") {
+    _generator_ generator(42);
+    double batch[TIMERANDOMGENERATOR_BATCH_SIZE];
+    timingtools_start_timing();
+    for (uint_fast32_t i = 0; i < TIMERANDOMGENERATOR_NUMBER_OF_DRAWS;
+         i += TIMERANDOMGENERATOR_BATCH_SIZE) {
+      generator.fill_uniform(batch, TIMERANDOMGENERATOR_BATCH_SIZE);
+      for (uint_fast32_t j = 0; j < TIMERANDOMGENERATOR_BATCH_SIZE; ++j) {
+        checksum += batch[j];
+      }
+    }
+    timingtools_stop_timing();
+  }
+  timingtools_end_timing_block("batched draws");
+  timingtools_print("%i draws per sample, average: %g",
+                    TIMERANDOMGENERATOR_NUMBER_OF_DRAWS,
+                    checksum / (timingtools_num_sample *
+                                TIMERANDOMGENERATOR_NUMBER_OF_DRAWS));
+
+  checksum = 0.;
+  timingtools_start_timing_block("photon packets") {
+    _generator_ generator(42);
+    double batch[4 * TIMERANDOMGENERATOR_PHOTON_BATCH_SIZE];
+    timingtools_start_timing();
+    for (uint_fast32_t i = 0; i < TIMERANDOMGENERATOR_NUMBER_OF_PHOTONS;
+         i += TIMERANDOMGENERATOR_PHOTON_BATCH_SIZE) {
+      generator.fill_uniform(batch, 4 * TIMERANDOMGENERATOR_PHOTON_BATCH_SIZE);
+      for (uint_fast32_t j = 0; j < TIMERANDOMGENERATOR_PHOTON_BATCH_SIZE;
+           ++j) {
+        const double cost = 2. * batch[4 * j] - 1.;
+        const double sint = std::sqrt(std::max(1. - cost * cost, 0.));
+        const double phi = 2. * M_PI * batch[4 * j + 1];
+        const double tau = -std::log(batch[4 * j + 2]);
+        const double frequency = 13.6 + 40. * batch[4 * j + 3];
+        checksum += sint * std::cos(phi) + sint * std::sin(phi) + cost +
+                    tau * frequency;
+      }
+    }
+    timingtools_stop_timing();
+  }
+  timingtools_end_timing_block("photon packets");
+  timingtools_print("%i photon packets per sample, checksum: %g",
+                    TIMERANDOMGENERATOR_NUMBER_OF_PHOTONS,
+                    checksum / (timingtools_num_sample *
+                                TIMERANDOMGENERATOR_NUMBER_OF_PHOTONS));
+}
+
+/**
+ * @brief Timing test that compares the different random number generator
+ * algorithms that can be used by RandomGenerator.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  timingtools_init("timeRandomGenerator", argc, argv);
+
+  time_algorithm< RanluxRandomGenerator >("ranlxs2", timingtools_num_sample);
+  time_algorithm< Xoshiro256PlusPlusRandomGenerator >("xoshiro256++",
+                                                      timingtools_num_sample);
+  time_algorithm< PhiloxRandomGenerator >("Philox4x32-10",
+                                          timingtools_num_sample);
+
+  return 0;
+}
@@ -21,13 +21,39 @@
  *
  * @brief Timing test for the Riemann solver.
  *
+ * Apart from timing the individual Riemann solvers, we also compare the
+ * scalar and batched versions of the HLLC solver, and the scalar and batched
+ * versions of the inner flux sweep of a HydroDensitySubGrid. The batched
+ * versions are only faster if the compiler can vectorize them (see the CMake
+ * option BATCHED_HYDRO).
+ *
  * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
  */
 #include "ExactRiemannSolver.hpp"
 #include "HLLCRiemannSolver.hpp"
+#include "HydroDensitySubGrid.hpp"
 #include "TimingTools.hpp"
 #include <vector>
 
+/*! @brief Number of cells in every dimension of the subgrid used to time the
+ *  flux sweep. */
+#define TIMERIEMANNSOLVER_NCELL 32
+
+/*! @brief Number of flux sweeps per timing sample. */
+#define TIMERIEMANNSOLVER_NSWEEP 10
+
+/**
+ * @brief Primitive variables of a batch of left and right states, in the
+ * format expected by HLLCRiemannSolver::solve_for_flux_batch().
+ */
+struct StateBatch {
+  /*! @brief Left state primitive variables. */
+  double WL[5][HLLCRIEMANNSOLVER_BATCH_SIZE];
+
+  /*! @brief Right state primitive variables. */
+  double WR[5][HLLCRIEMANNSOLVER_BATCH_SIZE];
+};
+
 /**
  * @brief Timing test for the Riemann solver.
  *
@@ -93,4 +119,122 @@ int main(int argc, char **argv) {
     timingtools_stop_timing();
   }
   timingtools_end_timing_block("HLLCRiemannSolver");
+
+  timingtools_print_header("HLLC solver: scalar versus batch");
+
+  // gather the states into batches, with interface normals along the x axis
+  const uint_fast32_t batch_size = HLLCRIEMANNSOLVER_BATCH_SIZE;
+  const uint_fast32_t num_batch = num_test / batch_size;
+  std::vector< StateBatch > batches(num_batch);
+  for (uint_fast32_t i = 0; i < num_batch * batch_size; ++i) {
+    const uint_fast32_t iplus = (i + 1) % num_test;
+    StateBatch &batch = batches[i / batch_size];
+    const uint_fast32_t k = i % batch_size;
+    batch.WL[0][k] = rho[i];
+    batch.WL[1][k] = u[i].x();
+    batch.WL[2][k] = u[i].y();
+    batch.WL[3][k] = u[i].z();
+    batch.WL[4][k] = P[i];
+    batch.WR[0][k] = rho[iplus];
+    batch.WR[1][k] = u[iplus].x();
+    batch.WR[2][k] = u[iplus].y();
+    batch.WR[3][k] = u[iplus].z();
+    batch.WR[4][k] = P[iplus];
+  }
+  const CoordinateVector<> xnormal(1., 0., 0.);
+  const CoordinateVector<> zero_vface;
+  double mflux_sum = 0.;
+
+  timingtools_start_timing_block("HLLCRiemannSolver scalar") {
+    timingtools_start_timing();
+    for (uint_fast32_t i = 0; i < num_batch * batch_size; ++i) {
+      const uint_fast32_t iplus = (i + 1) % num_test;
+      hllc_solver.solve_for_flux(rho[i], u[i], P[i], rho[iplus], u[iplus],
+                                 P[iplus], mflux, pflux, Eflux, xnormal,
+                                 zero_vface);
+      mflux_sum += mflux;
+    }
+    timingtools_stop_timing();
+  }
+  timingtools_end_timing_block("HLLCRiemannSolver scalar");
+  timingtools_print("Total mass flux: %g.", mflux_sum);
+
+  mflux_sum = 0.;
+  timingtools_start_timing_block("HLLCRiemannSolver batch") {
+    double mflux_batch[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    double pflux_batch[3][HLLCRIEMANNSOLVER_BATCH_SIZE];
+    double Eflux_batch[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    bool fallback[HLLCRIEMANNSOLVER_BATCH_SIZE];
+    timingtools_start_timing();
+    for (uint_fast32_t ibatch = 0; ibatch < num_batch; ++ibatch) {
+      hllc_solver.solve_for_flux_batch(0, batches[ibatch].WL,
+                                       batches[ibatch].WR, mflux_batch,
+                                       pflux_batch, Eflux_batch, fallback);
+      for (uint_fast32_t k = 0; k < batch_size; ++k) {
+        mflux_sum += mflux_batch[k];
+      }
+    }
+    timingtools_stop_timing();
+  }
+  timingtools_end_timing_block("HLLCRiemannSolver batch");
+  timingtools_print("Total mass flux: %g.", mflux_sum);
+
+  timingtools_print_header("HydroDensitySubGrid inner flux sweep, %i^3 cells",
+                           TIMERIEMANNSOLVER_NCELL);
+
+  // set up a subgrid with random primitive variables and gradients
+  const double box[6] = {0., 0., 0., 1., 1., 1.};
+  const CoordinateVector< int_fast32_t > ncell(TIMERIEMANNSOLVER_NCELL);
+  HydroDensitySubGrid grid(box, ncell);
+  for (auto it = grid.hydro_begin(); it != grid.hydro_end(); ++it) {
+    HydroVariables &hydro_variables = it.get_hydro_variables();
+    hydro_variables.set_primitives_density(0.125 +
+                                           Utilities::random_double() * 0.875);
+    hydro_variables.set_primitives_velocity(CoordinateVector<>(
+        2. * Utilities::random_double() - 1.,
+        2. * Utilities::random_double() - 1.,
+        2. * Utilities::random_double() - 1.));
+    hydro_variables.set_primitives_pressure(0.1 +
+                                            Utilities::random_double() * 0.9);
+  }
+  const Abundances abundances;
+  const Hydro hydro(5. / 3., 100., 1.e4, 1.e99, false, abundances);
+  const double dt = 0.001;
+  grid.initialize_hydrodynamic_variables(hydro, false);
+  grid.inner_gradient_sweep(hydro);
+  grid.apply_slope_limiter(hydro);
+  grid.predict_primitive_variables(hydro, 0.5 * dt);
+
+  const double num_cell_updates =
+      static_cast< double >(TIMERIEMANNSOLVER_NSWEEP) *
+      TIMERIEMANNSOLVER_NCELL * TIMERIEMANNSOLVER_NCELL *
+      TIMERIEMANNSOLVER_NCELL * timingtools_num_sample;
+
+  double sweep_time = 0.;
+  timingtools_start_timing_block("inner_flux_sweep_scalar") {
+    timingtools_start_timing();
+    for (uint_fast32_t isweep = 0; isweep < TIMERIEMANNSOLVER_NSWEEP;
+         ++isweep) {
+      grid.inner_flux_sweep_scalar(hydro, dt);
+    }
+    timingtools_stop_timing();
+    sweep_time += timingtools_timer.value();
+  }
+  timingtools_end_timing_block("inner_flux_sweep_scalar");
+  timingtools_print("%g cell updates per second.",
+                    num_cell_updates / sweep_time);
+
+  sweep_time = 0.;
+  timingtools_start_timing_block("inner_flux_sweep_batch") {
+    timingtools_start_timing();
+    for (uint_fast32_t isweep = 0; isweep < TIMERIEMANNSOLVER_NSWEEP;
+         ++isweep) {
+      grid.inner_flux_sweep_batch(hydro, dt);
+    }
+    timingtools_stop_timing();
+    sweep_time += timingtools_timer.value();
+  }
+  timingtools_end_timing_block("inner_flux_sweep_batch");
+  timingtools_print("%g cell updates per second.",
+                    num_cell_updates / sweep_time);
 }
@@ -0,0 +1,302 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file timeSPHScatterMapping.cpp
+ *
+ * @brief Timing test that compares the default gather mapping of SPH snapshot
+ * density functions with the SPHScatterMapping.
+ *
+ * We time the mapping of the Phantom test snapshot and of a larger synthetic
+ * Gadget snapshot (a Gaussian cloud in a uniform background) onto a subgrid
+ * based grid, and compare the total mass on the grid with the total particle
+ * mass. Run with e.g. "-t 16" to obtain scaling results for 1 to 16 threads.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "DensitySubGridCreator.hpp"
+#include "GadgetSnapshotDensityFunction.hpp"
+#include "HDF5Tools.hpp"
+#include "PhantomSnapshotDensityFunction.hpp"
+#include "RandomGenerator.hpp"
+#include "SPHScatterMapping.hpp"
+#include "TimingTools.hpp"
+
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+/*! @brief Number of particles in the synthetic snapshot. */
+#define TIMESPHSCATTERMAPPING_NUMBER_OF_PARTICLES 200000
+
+/*! @brief Number of neighbours used to set the smoothing lengths in the
+ *  synthetic snapshot. */
+#define TIMESPHSCATTERMAPPING_NUMBER_OF_NEIGHBOURS 50.
+
+/**
+ * @brief Get the total mass on the given grid.
+ *
+ * @param grid_creator Grid.
+ * @return Total mass in all cells of the grid (in kg).
+ */
+double get_total_mass(DensitySubGridCreator< DensitySubGrid > &grid_creator) {
+  double total_mass = 0.;
+  for (auto gridit = grid_creator.begin();
+       gridit != grid_creator.original_end(); ++gridit) {
+    for (auto cellit = (*gridit).begin(); cellit != (*gridit).end();
+         ++cellit) {
+      total_mass += cellit.get_ionization_variables().get_number_density() *
+                    cellit.get_volume() * 1.6737236e-27;
+    }
+  }
+  return total_mass;
+}
+
+/**
+ * @brief Map the given density function onto a new grid.
+ *
+ * @param density_function DensityFunction to map.
+ * @param box Simulation box (in m).
+ * @param ncell Number of cells in each dimension.
+ * @param nsubgrid Number of subgrids in each dimension.
+ * @param periodic Periodicity flags.
+ * @return Total mass on the grid (in kg).
+ */
+double map_density(DensityFunction &density_function, const Box<> &box,
+                   const CoordinateVector< int_fast32_t > ncell,
+                   const CoordinateVector< int_fast32_t > nsubgrid,
+                   const CoordinateVector< bool > periodic) {
+
+  DensitySubGridCreator< DensitySubGrid > grid_creator(box, ncell, nsubgrid,
+                                                       periodic);
+  grid_creator.initialize(density_function);
+  const SPHScatterMapping *scatter_mapping =
+      density_function.get_scatter_mapping();
+  if (scatter_mapping != nullptr) {
+    scatter_mapping->deposit(grid_creator);
+  }
+  return get_total_mass(grid_creator);
+}
+
+/**
+ * @brief Write a synthetic Gadget snapshot with a Gaussian cloud in a uniform
+ * background.
+ *
+ * @param filename Name of the snapshot file.
+ * @param box_size Size of the periodic box (in m).
+ * @return Total mass of all particles (in kg).
+ */
+double write_snapshot(const std::string filename, const double box_size) {
+
+  const uint_fast32_t numpart = TIMESPHSCATTERMAPPING_NUMBER_OF_PARTICLES;
+  const uint_fast32_t numcloud = 0.8 * numpart;
+  const double sigma = 0.1 * box_size;
+  const double particle_mass = 1.e30;
+  const double volume = box_size * box_size * box_size;
+  const double background_density = (numpart - numcloud) / volume;
+  const double cloud_norm =
+      numcloud / std::pow(2. * M_PI * sigma * sigma, 1.5);
+
+  RandomGenerator random_generator(42);
+  std::vector< CoordinateVector<> > positions(numpart);
+  std::vector< double > masses(numpart, particle_mass);
+  std::vector< double > smoothing_lengths(numpart);
+  std::vector< double > densities(numpart);
+  std::vector< double > temperatures(numpart, 8000.);
+  for (uint_fast32_t i = 0; i < numpart; ++i) {
+    CoordinateVector<> x;
+    if (i < numcloud) {
+      for (uint_fast8_t j = 0; j < 3; ++j) {
+        // Box-Muller transform
+        const double u1 =
+            std::max(random_generator.get_uniform_random_double(), DBL_MIN);
+        const double u2 = random_generator.get_uniform_random_double();
+        x[j] = 0.5 * box_size +
+               sigma * std::sqrt(-2. * std::log(u1)) * std::cos(2. * M_PI * u2);
+        x[j] -= std::floor(x[j] / box_size) * box_size;
+      }
+    } else {
+      x[0] = random_generator.get_uniform_random_double() * box_size;
+      x[1] = random_generator.get_uniform_random_double() * box_size;
+      x[2] = random_generator.get_uniform_random_double() * box_size;
+    }
+    positions[i] = x;
+    const double r2 = (x - CoordinateVector<>(0.5 * box_size)).norm2();
+    const double number_density =
+        background_density +
+        cloud_norm * std::exp(-0.5 * r2 / (sigma * sigma));
+    densities[i] = particle_mass * number_density;
+    // the Gadget smoothing length is the kernel support
+    smoothing_lengths[i] =
+        std::cbrt(0.75 * TIMESPHSCATTERMAPPING_NUMBER_OF_NEIGHBOURS /
+                  (M_PI * number_density));
+  }
+
+  HDF5Tools::HDF5File file =
+      HDF5Tools::open_file(filename, HDF5Tools::HDF5FILEMODE_WRITE);
+  HDF5Tools::HDF5Group group = HDF5Tools::create_group(file, "RuntimePars");
+  int32_t periodic = 1;
+  HDF5Tools::write_attribute< int32_t >(group, "PeriodicBoundariesOn",
+                                        periodic);
+  HDF5Tools::close_group(group);
+  group = HDF5Tools::create_group(file, "Header");
+  CoordinateVector<> box_sides(box_size);
+  HDF5Tools::write_attribute< CoordinateVector<> >(group, "BoxSize",
+                                                   box_sides);
+  HDF5Tools::close_group(group);
+  group = HDF5Tools::create_group(file, "Units");
+  double unit_length = 100.;
+  double unit_mass = 1000.;
+  double unit_temperature = 1.;
+  HDF5Tools::write_attribute< double >(group, "Unit length in cgs (U_L)",
+                                       unit_length);
+  HDF5Tools::write_attribute< double >(group, "Unit mass in cgs (U_M)",
+                                       unit_mass);
+  HDF5Tools::write_attribute< double >(group, "Unit temperature in cgs (U_T)",
+                                       unit_temperature);
+  HDF5Tools::close_group(group);
+  group = HDF5Tools::create_group(file, "PartType0");
+  HDF5Tools::write_dataset< CoordinateVector<> >(group, "Coordinates",
+                                                 positions);
+  HDF5Tools::write_dataset< double >(group, "Masses", masses);
+  HDF5Tools::write_dataset< double >(group, "SmoothingLength",
+                                     smoothing_lengths);
+  HDF5Tools::write_dataset< double >(group, "Density", densities);
+  HDF5Tools::write_dataset< double >(group, "Temperature", temperatures);
+  HDF5Tools::close_group(group);
+  HDF5Tools::close_file(file);
+
+  return numpart * particle_mass;
+}
+
+/**
+ * @brief Timing test that compares the default gather mapping of SPH snapshot
+ * density functions with the SPHScatterMapping.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  timingtools_init("timeSPHScatterMapping", argc, argv);
+
+  /// Phantom test snapshot
+  {
+    timingtools_print_header("Phantom test snapshot");
+
+    PhantomSnapshotDensityFunction gather_function("Phantomtest.dat", 8000.,
+                                                   false, false);
+    gather_function.initialize();
+    PhantomSnapshotDensityFunction scatter_function(
+        "Phantomtest.dat", 8000., false, false, false, "", true);
+    scatter_function.initialize();
+
+    // the grid covers the particles and their kernels
+    CoordinateVector<> minpos(DBL_MAX);
+    CoordinateVector<> maxpos(-DBL_MAX);
+    double total_mass = 0.;
+    for (uint_fast32_t i = 0; i < gather_function.get_number_of_particles();
+         ++i) {
+      const CoordinateVector<> x = gather_function.get_position(i);
+      const double h = 2. * gather_function.get_smoothing_length(i);
+      minpos = CoordinateVector<>::min(minpos, x - CoordinateVector<>(h));
+      maxpos = CoordinateVector<>::max(maxpos, x + CoordinateVector<>(h));
+      total_mass += gather_function.get_mass(i);
+    }
+    const CoordinateVector<> sides = maxpos - minpos;
+    const Box<> box(minpos - 0.005 * sides, 1.01 * sides);
+    const CoordinateVector< int_fast32_t > ncell(64);
+    const CoordinateVector< int_fast32_t > nsubgrid(8);
+    const CoordinateVector< bool > periodic(false);
+
+    double gather_mass = 0.;
+    timingtools_start_scaling_block("Phantom gather") {
+      timingtools_start_timing();
+      gather_mass = map_density(gather_function, box, ncell, nsubgrid,
+                                periodic);
+      timingtools_stop_timing();
+    }
+    timingtools_end_scaling_block("Phantom gather",
+                                  "scaling_sph_phantom_gather.txt");
+
+    double scatter_mass = 0.;
+    timingtools_start_scaling_block("Phantom scatter") {
+      timingtools_start_timing();
+      scatter_mass = map_density(scatter_function, box, ncell, nsubgrid,
+                                 periodic);
+      timingtools_stop_timing();
+    }
+    timingtools_end_scaling_block("Phantom scatter",
+                                  "scaling_sph_phantom_scatter.txt");
+
+    timingtools_print("Relative mass error: gather: %g, scatter: %g",
+                      std::abs(gather_mass - total_mass) / total_mass,
+                      std::abs(scatter_mass - total_mass) / total_mass);
+  }
+
+  /// synthetic Gadget snapshot
+  {
+    timingtools_print_header("Synthetic Gadget snapshot with %i particles",
+                             TIMESPHSCATTERMAPPING_NUMBER_OF_PARTICLES);
+
+    const double box_size = 3.086e16;
+    const double total_mass =
+        write_snapshot("timeSPHScatterMapping.hdf5", box_size);
+
+    GadgetSnapshotDensityFunction gather_function(
+        "timeSPHScatterMapping.hdf5", true, 0., 0., 0., false, 0., false, 0.7,
+        false);
+    gather_function.initialize();
+    GadgetSnapshotDensityFunction scatter_function(
+        "timeSPHScatterMapping.hdf5", true, 0., 0., 0., false, 0., false, 0.7,
+        true);
+    scatter_function.initialize();
+
+    const Box<> box(CoordinateVector<>(0.), CoordinateVector<>(box_size));
+    const CoordinateVector< int_fast32_t > ncell(64);
+    const CoordinateVector< int_fast32_t > nsubgrid(8);
+    const CoordinateVector< bool > periodic(true);
+
+    double gather_mass = 0.;
+    timingtools_start_scaling_block("Gadget gather") {
+      timingtools_start_timing();
+      gather_mass = map_density(gather_function, box, ncell, nsubgrid,
+                                periodic);
+      timingtools_stop_timing();
+    }
+    timingtools_end_scaling_block("Gadget gather",
+                                  "scaling_sph_gadget_gather.txt");
+
+    double scatter_mass = 0.;
+    timingtools_start_scaling_block("Gadget scatter") {
+      timingtools_start_timing();
+      scatter_mass = map_density(scatter_function, box, ncell, nsubgrid,
+                                 periodic);
+      timingtools_stop_timing();
+    }
+    timingtools_end_scaling_block("Gadget scatter",
+                                  "scaling_sph_gadget_scatter.txt");
+
+    timingtools_print("Relative mass error: gather: %g, scatter: %g",
+                      std::abs(gather_mass - total_mass) / total_mass,
+                      std::abs(scatter_mass - total_mass) / total_mass);
+  }
+
+  return 0;
+}
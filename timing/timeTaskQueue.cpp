@@ -0,0 +1,232 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file timeTaskQueue.cpp
+ *
+ * @brief Timing test that compares the locked TaskQueue and the lock-free
+ * WorkStealingTaskQueue as per thread queues.
+ *
+ * The test mimics the photon traversal phase of the task-based algorithm:
+ * every task locks the subgrid it acts on, does a small amount of work, and
+ * then spawns a new task for a neighbouring subgrid, which is added to the
+ * queue of the thread that owns that subgrid.
+ *
+ * Run with e.g. "-t 128" to obtain scaling results for 1 to 128 threads.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "OpenMP.hpp"
+#include "Scheduler.hpp"
+#include "TaskQueue.hpp"
+#include "ThreadLock.hpp"
+#include "ThreadSafeVector.hpp"
+#include "TimingTools.hpp"
+#include "WorkStealingTaskQueue.hpp"
+
+#include <cmath>
+#include <vector>
+
+/*! @brief Number of subgrids (dependencies). */
+#define TIMETASKQUEUE_NUMBER_OF_SUBGRIDS 512
+
+/*! @brief Number of tasks that are present at the start of the test. */
+#define TIMETASKQUEUE_NUMBER_OF_ROOT_TASKS 10000
+
+/*! @brief Number of tasks that is spawned from every root task. */
+#define TIMETASKQUEUE_NUMBER_OF_GENERATIONS 20
+
+/*! @brief Size of the task space and the queues. */
+#define TIMETASKQUEUE_QUEUE_SIZE                                               \
+  (TIMETASKQUEUE_NUMBER_OF_ROOT_TASKS * 2)
+
+/**
+ * @brief Create a per thread queue of the given type.
+ *
+ * @param size Size of the queue.
+ * @param owner Owning thread.
+ * @param queue Dummy argument used to select the queue type.
+ * @return Pointer to a newly created queue.
+ */
+inline TaskQueue *create_queue(const size_t size, const int_fast32_t owner,
+                               TaskQueue *queue) {
+  return new TaskQueue(size);
+}
+
+/**
+ * @brief Create a per thread queue of the given type.
+ *
+ * @param size Size of the queue.
+ * @param owner Owning thread.
+ * @param queue Dummy argument used to select the queue type.
+ * @return Pointer to a newly created queue.
+ */
+inline WorkStealingTaskQueue *create_queue(const size_t size,
+                                           const int_fast32_t owner,
+                                           WorkStealingTaskQueue *queue) {
+  return new WorkStealingTaskQueue(size, "", owner);
+}
+
+/**
+ * @brief Get the subgrid that a task with the given index and generation
+ * acts on.
+ *
+ * Subgrids are chosen pseudo-randomly, but deterministically, so that both
+ * queue types execute exactly the same task graph.
+ *
+ * @param root Index of the root task.
+ * @param generation Generation of the task.
+ * @return Subgrid index.
+ */
+inline size_t get_subgrid(const size_t root, const size_t generation) {
+  size_t hash = root * 2654435761u + generation * 40503u;
+  hash ^= hash >> 13;
+  hash *= 0x5bd1e995;
+  hash ^= hash >> 15;
+  return hash % TIMETASKQUEUE_NUMBER_OF_SUBGRIDS;
+}
+
+/**
+ * @brief Run the task graph using the given per thread queues.
+ *
+ * @param queues Per thread queues.
+ * @param number_of_threads Number of threads that execute the task graph.
+ * @return Total number of executed tasks.
+ */
+template < typename _queue_type_ >
+inline size_t run_task_graph(std::vector< _queue_type_ * > &queues,
+                             const int_fast32_t number_of_threads) {
+
+  ThreadSafeVector< Task > tasks(TIMETASKQUEUE_QUEUE_SIZE);
+  std::vector< ThreadLock > locks(TIMETASKQUEUE_NUMBER_OF_SUBGRIDS);
+
+  // the task subgrid variable stores the root task index, the buffer variable
+  // the generation
+  for (size_t iroot = 0; iroot < TIMETASKQUEUE_NUMBER_OF_ROOT_TASKS; ++iroot) {
+    const size_t itask = tasks.get_free_element();
+    Task &task = tasks[itask];
+    const size_t isubgrid = get_subgrid(iroot, 0);
+    task.set_subgrid(iroot);
+    task.set_buffer(0);
+    task.set_dependency(&locks[isubgrid]);
+    queues[isubgrid % number_of_threads]->add_task(itask);
+  }
+
+  const size_t total_number_of_tasks = TIMETASKQUEUE_NUMBER_OF_ROOT_TASKS *
+                                       (TIMETASKQUEUE_NUMBER_OF_GENERATIONS + 1);
+  AtomicValue< size_t > number_done(0);
+  AtomicValue< size_t > checksum(0);
+#ifdef HAVE_OPENMP
+#pragma omp parallel default(shared)
+#endif
+  {
+    const int_fast32_t thread_id = get_thread_index();
+    while (number_done.value() < total_number_of_tasks) {
+      size_t itask = queues[thread_id]->get_task(tasks);
+      if (itask == NO_TASK) {
+        itask = Scheduler::steal_task(thread_id, queues, tasks);
+      }
+      if (itask != NO_TASK) {
+        Task &task = tasks[itask];
+        const size_t iroot = task.get_subgrid();
+        const size_t generation = task.get_buffer();
+
+        // some dummy work
+        double value = 0.;
+        for (uint_fast32_t i = 0; i < 100; ++i) {
+          value += std::sqrt(0.01 * (i + iroot));
+        }
+        checksum.post_add(value > 0.);
+
+        task.unlock_dependency();
+        tasks.free_element(itask);
+
+        if (generation < TIMETASKQUEUE_NUMBER_OF_GENERATIONS) {
+          const size_t inew = tasks.get_free_element();
+          Task &new_task = tasks[inew];
+          const size_t isubgrid = get_subgrid(iroot, generation + 1);
+          new_task.set_subgrid(iroot);
+          new_task.set_buffer(generation + 1);
+          new_task.set_dependency(&locks[isubgrid]);
+          queues[isubgrid % number_of_threads]->add_task(inew);
+        }
+        number_done.pre_increment();
+      }
+    }
+  }
+
+  return checksum.value();
+}
+
+/**
+ * @brief Run the task graph for the given queue type and the given number of
+ * threads.
+ *
+ * @param number_of_threads Number of threads.
+ * @return Total number of executed tasks.
+ */
+template < typename _queue_type_ >
+inline size_t time_queue(const int_fast32_t number_of_threads) {
+
+  std::vector< _queue_type_ * > queues(number_of_threads);
+  for (int_fast32_t i = 0; i < number_of_threads; ++i) {
+    queues[i] = create_queue(TIMETASKQUEUE_QUEUE_SIZE, i,
+                             static_cast< _queue_type_ * >(nullptr));
+  }
+  const size_t number_of_tasks = run_task_graph(queues, number_of_threads);
+  for (int_fast32_t i = 0; i < number_of_threads; ++i) {
+    delete queues[i];
+  }
+  return number_of_tasks;
+}
+
+/**
+ * @brief Timing test that compares the locked TaskQueue and the lock-free
+ * WorkStealingTaskQueue as per thread queues.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  timingtools_init("timeTaskQueue", argc, argv);
+
+  timingtools_print_header(
+      "Task queue scaling test (%i tasks on %i subgrids).",
+      TIMETASKQUEUE_NUMBER_OF_ROOT_TASKS *
+          (TIMETASKQUEUE_NUMBER_OF_GENERATIONS + 1),
+      TIMETASKQUEUE_NUMBER_OF_SUBGRIDS);
+
+  timingtools_start_scaling_block("TaskQueue") {
+    timingtools_start_timing();
+    time_queue< TaskQueue >(timingtools_current_num_threads + 1);
+    timingtools_stop_timing();
+  }
+  timingtools_end_scaling_block("TaskQueue", "scaling_TaskQueue.txt");
+
+  timingtools_start_scaling_block("WorkStealingTaskQueue") {
+    timingtools_start_timing();
+    time_queue< WorkStealingTaskQueue >(timingtools_current_num_threads + 1);
+    timingtools_stop_timing();
+  }
+  timingtools_end_scaling_block("WorkStealingTaskQueue",
+                                "scaling_WorkStealingTaskQueue.txt");
+
+  return 0;
+}
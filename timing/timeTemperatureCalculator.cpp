@@ -0,0 +1,220 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2026 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file timeTemperatureCalculator.cpp
+ *
+ * @brief Timing test for the temperature calculation.
+ *
+ * We compute the temperature for a set of cells with random densities and
+ * radiation fields, using the exact line cooling and recombination rates, and
+ * using a LineCoolingTable and TabulatedRecombinationRates. For both, we time
+ * a first pass that starts from an initial temperature guess, and a second
+ * pass with the same radiation field that starts from the result of the first
+ * pass, with and without the warm start convergence check.
+ *
+ * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
+ */
+#include "Abundances.hpp"
+#include "ChargeTransferRates.hpp"
+#include "CollisionalRates.hpp"
+#include "LineCoolingData.hpp"
+#include "LineCoolingTable.hpp"
+#include "RandomGenerator.hpp"
+#include "TabulatedRecombinationRates.hpp"
+#include "TemperatureCalculator.hpp"
+#include "TimingTools.hpp"
+#include "VernerRecombinationRates.hpp"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+/*! @brief Number of cells in every test. */
+#define TIMETEMPERATURECALCULATOR_NUMBER_OF_CELLS 20000
+
+/**
+ * @brief Initialize the given cells with random densities and radiation
+ * fields.
+ *
+ * @param cells Cells to initialize.
+ */
+inline void initialize_cells(std::vector< IonizationVariables > &cells) {
+
+  RandomGenerator random_generator(42);
+  for (size_t i = 0; i < cells.size(); ++i) {
+    IonizationVariables &cell = cells[i];
+    cell.set_number_density(
+        std::pow(10., 6. + 4. * random_generator.get_uniform_random_double()));
+    cell.set_temperature(8000.);
+    const double jscale = std::pow(
+        10., -10. + 3. * random_generator.get_uniform_random_double());
+    for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+      cell.set_mean_intensity(
+          ion,
+          jscale * (0.5 + random_generator.get_uniform_random_double()));
+    }
+    cell.set_heating(HEATINGTERM_H, 4.e-19 * jscale);
+#ifdef HAS_HELIUM
+    cell.set_heating(HEATINGTERM_He, 8.e-19 * jscale);
+#endif
+  }
+}
+
+/**
+ * @brief Compute the temperature for all cells.
+ *
+ * The radiation field is reset before the computation, since
+ * TemperatureCalculator::calculate_temperature() does not preserve it.
+ *
+ * @param calculator TemperatureCalculator to use.
+ * @param initial_cells Cells containing the radiation field.
+ * @param cells Cells to update.
+ * @return Average temperature of the cells (in K).
+ */
+inline double compute_temperatures(
+    const TemperatureCalculator &calculator,
+    const std::vector< IonizationVariables > &initial_cells,
+    std::vector< IonizationVariables > &cells) {
+
+  for (size_t i = 0; i < cells.size(); ++i) {
+    for (int_fast32_t ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+      cells[i].set_mean_intensity(ion,
+                                  initial_cells[i].get_mean_intensity(ion));
+    }
+    for (int_fast32_t heating_term = 0; heating_term < NUMBER_OF_HEATINGTERMS;
+         ++heating_term) {
+      cells[i].set_heating(heating_term,
+                           initial_cells[i].get_heating(heating_term));
+    }
+  }
+
+  double average_temperature = 0.;
+  for (size_t i = 0; i < cells.size(); ++i) {
+    calculator.calculate_temperature(cells[i], 1., 1., CoordinateVector<>(),
+                                     0.);
+    average_temperature += cells[i].get_temperature();
+  }
+  return average_temperature / cells.size();
+}
+
+/**
+ * @brief Time the temperature calculation with the given line cooling table
+ * and recombination rates.
+ *
+ * @param name Name of the test.
+ * @param line_cooling_data LineCoolingData to use.
+ * @param tabulate Use a LineCoolingTable?
+ * @param recombination_rates RecombinationRates to use.
+ * @param timingtools_num_sample Number of samples for every timing block.
+ */
+void time_temperature_calculator(const std::string name,
+                                 const LineCoolingData &line_cooling_data,
+                                 const bool tabulate,
+                                 const RecombinationRates &recombination_rates,
+                                 const uint_fast32_t timingtools_num_sample) {
+
+  timingtools_print_header("%s", name.c_str());
+
+  const Abundances abundances(0.1, 2.2e-4, 4.e-5, 3.3e-4, 5.e-5, 9.e-6);
+  const ChargeTransferRates charge_transfer_rates;
+  const CollisionalRates collisional_rates;
+  const TemperatureCalculator calculator(
+      true, 0, 1., abundances, 1.e-3, 100, 1., 0., 1., 0., 4000., false,
+      line_cooling_data, recombination_rates, charge_transfer_rates,
+      collisional_rates, nullptr,
+      tabulate ? new LineCoolingTable(line_cooling_data, 1000., 1.e5, 400, 1.,
+                                      1.e14, 280, 1.e-3)
+               : nullptr,
+      nullptr, false);
+  const TemperatureCalculator warm_start_calculator(
+      true, 0, 1., abundances, 1.e-3, 100, 1., 0., 1., 0., 4000., false,
+      line_cooling_data, recombination_rates, charge_transfer_rates,
+      collisional_rates, nullptr,
+      tabulate ? new LineCoolingTable(line_cooling_data, 1000., 1.e5, 400, 1.,
+                                      1.e14, 280, 1.e-3)
+               : nullptr,
+      nullptr, true);
+
+  std::vector< IonizationVariables > initial_cells(
+      TIMETEMPERATURECALCULATOR_NUMBER_OF_CELLS);
+  initialize_cells(initial_cells);
+
+  double average_temperature = 0.;
+  timingtools_start_timing_block("first pass") {
+    std::vector< IonizationVariables > cells(initial_cells);
+    timingtools_start_timing();
+    average_temperature = compute_temperatures(calculator, initial_cells, cells);
+    timingtools_stop_timing();
+  }
+  timingtools_end_timing_block("first pass");
+  timingtools_print("%i cells, average temperature: %g K",
+                    TIMETEMPERATURECALCULATOR_NUMBER_OF_CELLS,
+                    average_temperature);
+
+  std::vector< IonizationVariables > converged_cells(initial_cells);
+  compute_temperatures(calculator, initial_cells, converged_cells);
+
+  timingtools_start_timing_block("second pass") {
+    std::vector< IonizationVariables > cells(converged_cells);
+    timingtools_start_timing();
+    average_temperature = compute_temperatures(calculator, initial_cells, cells);
+    timingtools_stop_timing();
+  }
+  timingtools_end_timing_block("second pass");
+  timingtools_print("%i cells, average temperature: %g K",
+                    TIMETEMPERATURECALCULATOR_NUMBER_OF_CELLS,
+                    average_temperature);
+
+  timingtools_start_timing_block("second pass (warm start)") {
+    std::vector< IonizationVariables > cells(converged_cells);
+    timingtools_start_timing();
+    average_temperature =
+        compute_temperatures(warm_start_calculator, initial_cells, cells);
+    timingtools_stop_timing();
+  }
+  timingtools_end_timing_block("second pass (warm start)");
+  timingtools_print("%i cells, average temperature: %g K",
+                    TIMETEMPERATURECALCULATOR_NUMBER_OF_CELLS,
+                    average_temperature);
+}
+
+/**
+ * @brief Timing test for the temperature calculation.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  timingtools_init("timeTemperatureCalculator", argc, argv);
+
+  const LineCoolingData line_cooling_data;
+  const VernerRecombinationRates recombination_rates;
+  time_temperature_calculator("exact rates", line_cooling_data, false,
+                              recombination_rates, timingtools_num_sample);
+
+  const TabulatedRecombinationRates tabulated_recombination_rates(
+      new VernerRecombinationRates(), 1000., 1.e5, 400, 1.e-4);
+  time_temperature_calculator("tabulated rates", line_cooling_data, true,
+                              tabulated_recombination_rates,
+                              timingtools_num_sample);
+
+  return 0;
+}